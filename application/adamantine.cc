@@ -8,6 +8,8 @@
 #include "adamantine.hh"
 
 #include "utils.hh"
+#include <binding_report.hh>
+#include <preprocessing_cache.hh>
 #include <validate_input_database.hh>
 
 #ifdef ADAMANTINE_WITH_ADIAK
@@ -48,6 +50,7 @@ int main(int argc, char *argv[])
   initialize_timers(communicator, timers);
   timers[adamantine::main].start();
   bool profiling = false;
+  std::string timer_filename;
   try
   {
     namespace boost_po = boost::program_options;
@@ -84,6 +87,11 @@ int main(int argc, char *argv[])
       std::cerr << exception.what() << std::endl;
       return 0;
     }
+    // In batch mode, the cache is set up for every case since the cases can
+    // override the inputs.
+    bool const batch_calc = database.count("batch") != 0;
+    if (!batch_calc)
+      adamantine::use_preprocessing_cache(communicator, database);
 
 #ifdef ADAMANTINE_WITH_CALIPER
     cali::ConfigManager caliper_manager;
@@ -96,6 +104,11 @@ int main(int argc, char *argv[])
       // PropertyTreeInput profiling.timer
       if (profiling_database.get("timer", false))
         profiling = true;
+      // PropertyTreeInput profiling.timer_file
+      timer_filename = profiling_database.get<std::string>("timer_file", "");
+      // PropertyTreeInput profiling.binding_report
+      if (profiling_database.get("binding_report", false))
+        adamantine::print_binding_report(communicator, std::cout);
 #ifdef ADAMANTINE_WITH_CALIPER
       // PropertyTreeInput profiling.caliper
       auto caliper_optional_string =
@@ -127,7 +140,14 @@ int main(int argc, char *argv[])
 
     if (dim == 2)
     {
-      if (ensemble_calc)
+      if (batch_calc)
+      {
+        if (rank == 0)
+          std::cout << "Starting batch simulation" << std::endl;
+        run_batch<2, dealii::MemorySpace::Host>(communicator, database,
+                                                timers);
+      }
+      else if (ensemble_calc)
       {
         if (rank == 0)
           std::cout << "Starting ensemble simulation" << std::endl;
@@ -143,7 +163,14 @@ int main(int argc, char *argv[])
     }
     else
     {
-      if (ensemble_calc)
+      if (batch_calc)
+      {
+        if (rank == 0)
+          std::cout << "Starting batch simulation" << std::endl;
+        run_batch<3, dealii::MemorySpace::Host>(communicator, database,
+                                                timers);
+      }
+      else if (ensemble_calc)
       {
         if (rank == 0)
           std::cout << "Starting ensemble simulation" << std::endl;
@@ -199,8 +226,7 @@ int main(int argc, char *argv[])
 
   timers[adamantine::main].stop();
   if (profiling == true)
-    for (auto &timer : timers)
-      timer.print();
+    adamantine::print_timers(communicator, timers, timer_filename);
 
 #ifdef ADAMANTINE_WITH_ADIAK
   adiak::fini();
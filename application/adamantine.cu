@@ -6,6 +6,8 @@
  */
 
 #include "adamantine.hh"
+#include <binding_report.hh>
+#include <preprocessing_cache.hh>
 #include <validate_input_database.hh>
 
 #ifdef ADAMANTINE_WITH_ADIAK
@@ -81,6 +83,11 @@ int main(int argc, char *argv[])
       std::cerr << exception.what() << std::endl;
       return 0;
     }
+    // In batch mode, the cache is set up for every case since the cases can
+    // override the inputs.
+    bool const batch_calc = database.count("batch") != 0;
+    if (!batch_calc)
+      adamantine::use_preprocessing_cache(communicator, database);
 
 #ifdef ADAMANTINE_WITH_CALIPER
     cali::ConfigManager caliper_manager;
@@ -93,6 +100,9 @@ int main(int argc, char *argv[])
       // PropertyTreeInput profiling.timer
       if (profiling_database.get("timer", false))
         profiling = true;
+      // PropertyTreeInput profiling.binding_report
+      if (profiling_database.get("binding_report", false))
+        adamantine::print_binding_report(communicator, std::cout);
 #ifdef ADAMANTINE_WITH_CALIPER
       // PropertyTreeInput profiling.caliper
       auto caliper_optional_string =
@@ -135,7 +145,22 @@ int main(int argc, char *argv[])
 
     if (dim == 2)
     {
-      if (ensemble_calc)
+      if (batch_calc)
+      {
+        if (rank == 0)
+          std::cout << "Starting batch simulation" << std::endl;
+        if (memory_space == "device")
+        {
+          run_batch<2, dealii::MemorySpace::CUDA>(communicator, database,
+                                                  timers);
+        }
+        else
+        {
+          run_batch<2, dealii::MemorySpace::Host>(communicator, database,
+                                                  timers);
+        }
+      }
+      else if (ensemble_calc)
       {
         if (rank == 0)
           std::cout << "Starting ensemble simulation" << std::endl;
@@ -161,7 +186,22 @@ int main(int argc, char *argv[])
     }
     else
     {
-      if (ensemble_calc)
+      if (batch_calc)
+      {
+        if (rank == 0)
+          std::cout << "Starting batch simulation" << std::endl;
+        if (memory_space == "device")
+        {
+          run_batch<3, dealii::MemorySpace::CUDA>(communicator, database,
+                                                  timers);
+        }
+        else
+        {
+          run_batch<3, dealii::MemorySpace::Host>(communicator, database,
+                                                  timers);
+        }
+      }
+      else if (ensemble_calc)
       {
         if (rank == 0)
           std::cout << "Starting ensemble simulation" << std::endl;
@@ -9,30 +9,43 @@
 #define ADAMANTINE_HH
 
 #include "types.hh"
+#include <AsynchronousOutput.hh>
 #include <DataAssimilator.hh>
 #include <ExperimentalData.hh>
 #include <Geometry.hh>
+#include <HostStagingBuffer.hh>
 #include <MaterialProperty.hh>
 #include <MechanicalPhysics.hh>
+#include <MechanicalSolveScheduler.hh>
+#include <MeltPoolMonitor.hh>
 #include <MemoryBlock.hh>
+#include <MemoryReport.hh>
+#include <PerformanceLog.hh>
 #include <PointCloud.hh>
 #include <PostProcessor.hh>
 #include <RayTracing.hh>
+#include <TemperatureProbes.hh>
 #include <ThermalPhysics.hh>
 #include <ThermalPhysicsInterface.hh>
 #include <Timer.hh>
 #include <ensemble_management.hh>
 #include <experimental_data_utils.hh>
 #include <material_deposition.hh>
+#include <preprocessing_cache.hh>
 #include <utils.hh>
+#include <validate_input_database.hh>
 
 #include <deal.II/base/index_set.h>
+#include <deal.II/base/memory_consumption.h>
 #include <deal.II/base/mpi.h>
+#include <deal.II/base/parallel.h>
 #include <deal.II/base/types.h>
 #include <deal.II/distributed/cell_data_transfer.templates.h>
 #include <deal.II/distributed/solution_transfer.h>
+#include <deal.II/dofs/dof_tools.h>
 #include <deal.II/grid/filtered_iterator.h>
 #include <deal.II/grid/grid_refinement.h>
+#include <deal.II/lac/affine_constraints.h>
 #include <deal.II/lac/trilinos_sparse_matrix.h>
 #include <deal.II/lac/vector_operation.h>
 #include <deal.II/numerics/error_estimator.h>
@@ -41,7 +54,13 @@
 #include <boost/property_tree/info_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
 #include <memory>
+#include <tuple>
 #include <type_traits>
 #include <unordered_map>
 
@@ -224,27 +243,39 @@ inline void initialize_timers(MPI_Comm const &communicator,
                               std::vector<adamantine::Timer> &timers)
 {
   timers.push_back(adamantine::Timer(communicator, "Main"));
-  timers.push_back(adamantine::Timer(communicator, "Refinement"));
-  timers.push_back(adamantine::Timer(communicator, "Add Material, Search"));
-  timers.push_back(adamantine::Timer(communicator, "Add Material, Activate"));
   timers.push_back(
-      adamantine::Timer(communicator, "Data Assimilation, Exp. Data"));
+      adamantine::Timer(communicator, "Refinement", adamantine::main));
   timers.push_back(
-      adamantine::Timer(communicator, "Data Assimilation, DOF Mapping"));
-  timers.push_back(
-      adamantine::Timer(communicator, "Data Assimilation, Cov. Sparsity"));
-  timers.push_back(
-      adamantine::Timer(communicator, "Data Assimilation, Exp. Cov."));
-  timers.push_back(
-      adamantine::Timer(communicator, "Data Assimilation, Update Ensemble"));
-  timers.push_back(adamantine::Timer(communicator, "Evolve One Time Step"));
+      adamantine::Timer(communicator, "DoF Renumbering", adamantine::main));
+  timers.push_back(adamantine::Timer(communicator, "Add Material, Search",
+                                     adamantine::main));
+  timers.push_back(adamantine::Timer(communicator, "Add Material, Activate",
+                                     adamantine::main));
+  timers.push_back(adamantine::Timer(
+      communicator, "Data Assimilation, Exp. Data", adamantine::main));
+  timers.push_back(adamantine::Timer(
+      communicator, "Data Assimilation, DOF Mapping", adamantine::main));
   timers.push_back(adamantine::Timer(
-      communicator, "Evolve One Time Step: evaluate_thermal_physics"));
+      communicator, "Data Assimilation, Cov. Sparsity", adamantine::main));
   timers.push_back(adamantine::Timer(
-      communicator, "Evolve One Time Step: id_minus_tau_J_inverse"));
+      communicator, "Data Assimilation, Exp. Cov.", adamantine::main));
   timers.push_back(adamantine::Timer(
-      communicator, "Evolve One Time Step: evaluate_material_properties"));
-  timers.push_back(adamantine::Timer(communicator, "Output"));
+      communicator, "Data Assimilation, Update Ensemble", adamantine::main));
+  timers.push_back(adamantine::Timer(communicator, "Evolve One Time Step",
+                                     adamantine::main));
+  timers.push_back(adamantine::Timer(
+      communicator, "Evolve One Time Step: evaluate_thermal_physics",
+      adamantine::evol_time));
+  timers.push_back(adamantine::Timer(
+      communicator, "Evolve One Time Step: id_minus_tau_J_inverse",
+      adamantine::evol_time));
+  timers.push_back(adamantine::Timer(
+      communicator, "Evolve One Time Step: evaluate_material_properties",
+      adamantine::evol_time));
+  timers.push_back(
+      adamantine::Timer(communicator, "Output", adamantine::main));
+  timers.push_back(
+      adamantine::Timer(communicator, "Checkpoint", adamantine::main));
 }
 
 template <int dim, int fe_degree, typename MemorySpaceType,
@@ -346,13 +377,17 @@ initialize_thermal_physics(
   }
 }
 
+// If target_levels is not empty, it gives the level, indexed by
+// active_cell_index(), that each cell must be refined to. Only the
+// Triangulation and the DoFHandler are updated between the refinement cycles.
 template <int dim, typename MemorySpaceType>
 void refine_and_transfer(
     std::unique_ptr<adamantine::ThermalPhysicsInterface<dim, MemorySpaceType>>
         &thermal_physics,
     adamantine::MaterialProperty<dim, MemorySpaceType> &material_properties,
     dealii::DoFHandler<dim> &dof_handler,
-    dealii::LA::distributed::Vector<double, MemorySpaceType> &solution)
+    dealii::LA::distributed::Vector<double, MemorySpaceType> &solution,
+    std::vector<int> const &target_levels = {})
 {
 #ifdef ADAMANTINE_WITH_CALIPER
   CALI_CXX_MARK_FUNCTION;
@@ -369,38 +404,63 @@ void refine_and_transfer(
   thermal_physics->set_state_to_material_properties();
 
   // Transfer of the solution
-  dealii::parallel::distributed::SolutionTransfer<
-      dim, dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>>
-      solution_transfer(dof_handler);
+  using SolutionTransfer = dealii::parallel::distributed::SolutionTransfer<
+      dim, dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>>;
+  auto solution_transfer = std::make_unique<SolutionTransfer>(dof_handler);
 
   // Transfer material state
   unsigned int const direction_data_size = 2;
   unsigned int const phase_history_data_size = 1;
+  unsigned int const target_level_data_size = 1;
   unsigned int constexpr n_material_states = adamantine::g_n_material_states;
+  unsigned int const data_size_per_cell =
+      n_material_states + direction_data_size + phase_history_data_size +
+      target_level_data_size;
+  unsigned int const target_level_index = data_size_per_cell - 1;
   std::vector<std::vector<double>> data_to_transfer;
-  std::vector<double> dummy_cell_data(n_material_states + direction_data_size +
-                                          phase_history_data_size,
+  std::vector<double> dummy_cell_data(data_size_per_cell,
                                       std::numeric_limits<double>::infinity());
+  // On the device, the material state is copied to a pinned buffer on the host
+  // while the constraints are applied to the solution.
   adamantine::MemoryBlockView<double, MemorySpaceType> material_state_view =
       material_properties.get_state();
-  adamantine::MemoryBlock<double, dealii::MemorySpace::Host>
-      material_state_host(material_state_view.extent(0),
-                          material_state_view.extent(1));
-  typename decltype(material_state_view)::memory_space memspace;
-  adamantine::deep_copy(material_state_host.data(), dealii::MemorySpace::Host{},
-                        material_state_view.data(), memspace,
-                        material_state_view.size());
+  adamantine::HostStagingBuffer<double, MemorySpaceType> material_state_host;
+  material_state_host.reinit(material_state_view.extent(0),
+                             material_state_view.extent(1));
+  material_state_host.copy_from(material_state_view.data());
+
+  // Prepare for refinement of the solution
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+      solution_host;
+  if constexpr (std::is_same_v<MemorySpaceType, dealii::MemorySpace::Host>)
+  {
+    // We need to apply the constraints before the mesh transfer
+    thermal_physics->get_affine_constraints().distribute(solution);
+    // We need to update the ghost values before we can do the interpolation on
+    // the new mesh.
+    solution.update_ghost_values();
+  }
+  else
+  {
+    solution_host.reinit(solution.get_partitioner());
+    solution_host.import(solution, dealii::VectorOperation::insert);
+    // We need to apply the constraints before the mesh transfer
+    thermal_physics->get_affine_constraints().distribute(solution_host);
+    // We need to update the ghost values before we can do the interpolation on
+    // the new mesh.
+    solution_host.update_ghost_values();
+  }
 
+  material_state_host.wait();
   adamantine::MemoryBlockView<double, dealii::MemorySpace::Host>
-      state_host_view(material_state_host);
+      state_host_view = material_state_host.get_view();
   unsigned int cell_id = 0;
   unsigned int activated_cell_id = 0;
   for (auto const &cell : dof_handler.active_cell_iterators())
   {
     if (cell->is_locally_owned())
     {
-      std::vector<double> cell_data(n_material_states + direction_data_size +
-                                    phase_history_data_size);
+      std::vector<double> cell_data(data_size_per_cell);
       for (unsigned int i = 0; i < n_material_states; ++i)
         cell_data[i] = state_host_view(i, cell_id);
       if (cell->active_fe_index() == 0)
@@ -425,6 +485,9 @@ void refine_and_transfer(
         cell_data[n_material_states + direction_data_size] =
             std::numeric_limits<double>::infinity();
       }
+      cell_data[target_level_index] =
+          target_levels.empty() ? -1.
+                                : target_levels[cell->active_cell_index()];
       data_to_transfer.push_back(cell_data);
       ++cell_id;
     }
@@ -437,34 +500,15 @@ void refine_and_transfer(
   // Prepare the Triangulation and the diffent data transfer objects for
   // refinement
   triangulation.prepare_coarsening_and_refinement();
-  // Prepare for refinement of the solution
-  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
-      solution_host;
   if constexpr (std::is_same_v<MemorySpaceType, dealii::MemorySpace::Host>)
-  {
-    // We need to apply the constraints before the mesh transfer
-    thermal_physics->get_affine_constraints().distribute(solution);
-    // We need to update the ghost values before we can do the interpolation on
-    // the new mesh.
-    solution.update_ghost_values();
-    solution_transfer.prepare_for_coarsening_and_refinement(solution);
-  }
+    solution_transfer->prepare_for_coarsening_and_refinement(solution);
   else
-  {
-    solution_host.reinit(solution.get_partitioner());
-    solution_host.import(solution, dealii::VectorOperation::insert);
-    // We need to apply the constraints before the mesh transfer
-    thermal_physics->get_affine_constraints().distribute(solution_host);
-    // We need to update the ghost values before we can do the interpolation on
-    // the new mesh.
-    solution_host.update_ghost_values();
-    solution_transfer.prepare_for_coarsening_and_refinement(solution_host);
-  }
+    solution_transfer->prepare_for_coarsening_and_refinement(solution_host);
 
-  dealii::parallel::distributed::CellDataTransfer<
-      dim, dim, std::vector<std::vector<double>>>
-      cell_data_trans(triangulation);
-  cell_data_trans.prepare_for_coarsening_and_refinement(data_to_transfer);
+  using CellDataTransfer = dealii::parallel::distributed::CellDataTransfer<
+      dim, dim, std::vector<std::vector<double>>>;
+  auto cell_data_trans = std::make_unique<CellDataTransfer>(triangulation);
+  cell_data_trans->prepare_for_coarsening_and_refinement(data_to_transfer);
 
 #ifdef ADAMANTINE_WITH_CALIPER
   CALI_MARK_BEGIN("refine triangulation");
@@ -475,6 +519,79 @@ void refine_and_transfer(
   CALI_MARK_END("refine triangulation");
 #endif
 
+  std::vector<std::vector<double>> transferred_data(
+      triangulation.n_active_cells(), std::vector<double>(data_size_per_cell));
+  cell_data_trans->unpack(transferred_data);
+
+  // Execute the remaining refinement cycles needed to reach the target levels.
+  // The children inherit the target level of their parent through the cell
+  // data transfer. Only the DoFHandler is updated between the cycles and the
+  // solution is kept on the host.
+  while (!target_levels.empty())
+  {
+    unsigned int n_flagged_cells = 0;
+    unsigned int total_cell_id = 0;
+    for (auto const &cell : triangulation.active_cell_iterators())
+    {
+      if (cell->is_locally_owned() &&
+          (cell->level() < transferred_data[total_cell_id][target_level_index]))
+      {
+        cell->set_refine_flag();
+        ++n_flagged_cells;
+      }
+      ++total_cell_id;
+    }
+    if (dealii::Utilities::MPI::sum(n_flagged_cells,
+                                    triangulation.get_communicator()) == 0)
+      break;
+
+    // Interpolate the solution on the intermediate mesh
+    dof_handler.distribute_dofs(dof_handler.get_fe_collection());
+    dealii::IndexSet locally_relevant_dofs;
+    dealii::DoFTools::extract_locally_relevant_dofs(dof_handler,
+                                                    locally_relevant_dofs);
+    dealii::AffineConstraints<double> hanging_node_constraints(
+        locally_relevant_dofs);
+    dealii::DoFTools::make_hanging_node_constraints(dof_handler,
+                                                    hanging_node_constraints);
+    hanging_node_constraints.close();
+    dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+        intermediate_solution(dof_handler.locally_owned_dofs(),
+                              locally_relevant_dofs,
+                              triangulation.get_communicator());
+    solution_transfer->interpolate(intermediate_solution);
+    hanging_node_constraints.distribute(intermediate_solution);
+    intermediate_solution.update_ghost_values();
+    solution_host.swap(intermediate_solution);
+
+    data_to_transfer.assign(triangulation.n_active_cells(), dummy_cell_data);
+    total_cell_id = 0;
+    for (auto const &cell : triangulation.active_cell_iterators())
+    {
+      if (cell->is_locally_owned())
+        data_to_transfer[total_cell_id] = transferred_data[total_cell_id];
+      ++total_cell_id;
+    }
+
+    triangulation.prepare_coarsening_and_refinement();
+    solution_transfer = std::make_unique<SolutionTransfer>(dof_handler);
+    solution_transfer->prepare_for_coarsening_and_refinement(solution_host);
+    cell_data_trans = std::make_unique<CellDataTransfer>(triangulation);
+    cell_data_trans->prepare_for_coarsening_and_refinement(data_to_transfer);
+
+#ifdef ADAMANTINE_WITH_CALIPER
+    CALI_MARK_BEGIN("refine triangulation");
+#endif
+    triangulation.execute_coarsening_and_refinement();
+#ifdef ADAMANTINE_WITH_CALIPER
+    CALI_MARK_END("refine triangulation");
+#endif
+
+    transferred_data.assign(triangulation.n_active_cells(),
+                            std::vector<double>(data_size_per_cell));
+    cell_data_trans->unpack(transferred_data);
+  }
+
   // Update the AffineConstraints and resize the solution
   thermal_physics->setup_dofs();
   thermal_physics->initialize_dof_vector(solution);
@@ -482,28 +599,11 @@ void refine_and_transfer(
   // Update MaterialProperty DoFHandler and resize the state vectors
   material_properties.reinit_dofs();
 
-  // Interpolate the solution
-  if constexpr (std::is_same_v<MemorySpaceType, dealii::MemorySpace::Host>)
-  {
-    solution_transfer.interpolate(solution);
-  }
-  else
-  {
-    solution_host.reinit(solution.get_partitioner());
-    solution_transfer.interpolate(solution_host);
-    solution.import(solution_host, dealii::VectorOperation::insert);
-  }
-
-  // Unpack the material state and repopulate the material state
-  std::vector<std::vector<double>> transferred_data(
-      triangulation.n_active_cells(),
-      std::vector<double>(n_material_states + direction_data_size +
-                          phase_history_data_size));
-  cell_data_trans.unpack(transferred_data);
+  // Repopulate the material state
   material_state_view = material_properties.get_state();
   material_state_host.reinit(material_state_view.extent(0),
                              material_state_view.extent(1));
-  state_host_view.reinit(material_state_host);
+  state_host_view = material_state_host.get_view();
   unsigned int total_cell_id = 0;
   cell_id = 0;
   std::vector<double> transferred_cos;
@@ -536,6 +636,22 @@ void refine_and_transfer(
     ++total_cell_id;
   }
 
+  // Copy the data back to material_property. On the device, the copy overlaps
+  // with the interpolation of the solution.
+  material_state_host.copy_to(material_state_view.data());
+
+  // Interpolate the solution
+  if constexpr (std::is_same_v<MemorySpaceType, dealii::MemorySpace::Host>)
+  {
+    solution_transfer->interpolate(solution);
+  }
+  else
+  {
+    solution_host.reinit(solution.get_partitioner());
+    solution_transfer->interpolate(solution_host);
+    solution.import(solution_host, dealii::VectorOperation::insert);
+  }
+
   // Update the deposition cos and sin
   thermal_physics->set_material_deposition_orientation(transferred_cos,
                                                        transferred_sin);
@@ -543,12 +659,8 @@ void refine_and_transfer(
   // Update the melted indicator
   thermal_physics->set_has_melted_vector(has_melted);
 
-  // Copy the data back to material_property
-  adamantine::deep_copy(material_state_view.data(), memspace,
-                        material_state_host.data(), dealii::MemorySpace::Host{},
-                        material_state_view.size());
-
   // Update the material states in the ThermalOperator
+  material_state_host.wait();
   thermal_physics->get_state_from_material_properties();
 
 #if ADAMANTINE_DEBUG
@@ -589,6 +701,17 @@ compute_cells_to_refine(
   std::vector<typename dealii::parallel::distributed::Triangulation<
       dim>::active_cell_iterator>
       cells_to_refine;
+  std::vector<typename dealii::parallel::distributed::Triangulation<
+      dim>::active_cell_iterator>
+      locally_owned_cells;
+  for (auto cell :
+       dealii::filter_iterators(triangulation.active_cell_iterators(),
+                                dealii::IteratorFilters::LocallyOwnedCell()))
+    locally_owned_cells.push_back(cell);
+  unsigned int const n_cells = locally_owned_cells.size();
+  // The sources are evaluated by several threads. Each thread only flags its
+  // own cells and the flagged cells are gathered in order afterwards.
+  std::vector<char> refine(n_cells);
   for (unsigned int i = 0; i < n_time_steps; ++i)
   {
     double const current_time = time + static_cast<double>(i) /
@@ -597,30 +720,323 @@ compute_cells_to_refine(
     for (auto &beam : heat_sources)
     {
       beam->update_time(current_time);
-      for (auto cell : dealii::filter_iterators(
-               triangulation.active_cell_iterators(),
-               dealii::IteratorFilters::LocallyOwnedCell()))
-      {
-        // Check the value at the center of the cell faces. For most cases this
-        // should be sufficient, but if the beam is small compared to the
-        // coarsest mesh we may need to add other points to check (e.g.
-        // quadrature points, vertices).
-        for (unsigned int f = 0; f < cell->reference_cell().n_faces(); ++f)
-        {
-          if (beam->value(cell->face(f)->center(), current_source_height) >
-              refinement_beam_cutoff)
+      dealii::parallel::apply_to_subranges(
+          0u, n_cells,
+          [&](unsigned int const begin, unsigned int const end)
           {
-            cells_to_refine.push_back(cell);
-            break;
-          }
-        }
-      }
+            for (unsigned int c = begin; c < end; ++c)
+            {
+              auto const &cell = locally_owned_cells[c];
+              refine[c] = false;
+              // Check the value at the center of the cell faces. For most
+              // cases this should be sufficient, but if the beam is small
+              // compared to the coarsest mesh we may need to add other points
+              // to check (e.g. quadrature points, vertices).
+              for (unsigned int f = 0; f < cell->reference_cell().n_faces();
+                   ++f)
+              {
+                if (beam->value(cell->face(f)->center(),
+                                current_source_height) >
+                    refinement_beam_cutoff)
+                {
+                  refine[c] = true;
+                  break;
+                }
+              }
+            }
+          },
+          adamantine::host_loop_grain_size);
+      for (unsigned int c = 0; c < n_cells; ++c)
+        if (refine[c])
+          cells_to_refine.push_back(locally_owned_cells[c]);
     }
   }
 
   return cells_to_refine;
 }
 
+template <int dim>
+bool beams_near_corridor_end(
+    std::vector<std::shared_ptr<adamantine::HeatSource<dim>>> &heat_sources,
+    double const time, double const time_step,
+    double const next_refinement_time, double const refine_margin)
+{
+  // The mesh has been refined along the paths of the beams up to
+  // next_refinement_time. A new refinement is necessary when a beam that is
+  // turned on gets closer than refine_margin to the end of this corridor. The
+  // length of the corridor left in front of the beam is computed along the
+  // scan path, the distance to the end point is not enough when the path turns
+  // back.
+  for (auto &beam : heat_sources)
+  {
+    adamantine::ScanPath const &scan_path = beam->get_scan_path();
+    double const beam_time = time + time_step;
+    // Heat sources without scan path (cube) use the refinement times.
+    if (scan_path.get_segment_list().empty())
+    {
+      if (beam_time > next_refinement_time)
+        return true;
+      continue;
+    }
+
+    // A beam that is turned off does not need a refined mesh.
+    if (!(scan_path.get_power_modifier(beam_time) > 0.))
+      continue;
+
+    if (beam_time >= next_refinement_time)
+      return true;
+
+    double remaining_length = 0.;
+    dealii::Point<3> previous_position = scan_path.value(beam_time);
+    for (double t = beam_time; t < next_refinement_time;)
+    {
+      t = std::min(t + time_step, next_refinement_time);
+      dealii::Point<3> const position = scan_path.value(t);
+      remaining_length += position.distance(previous_position);
+      if (remaining_length > refine_margin)
+        break;
+      previous_position = position;
+    }
+    if (remaining_length <= refine_margin)
+      return true;
+  }
+
+  return false;
+}
+
+// Return the first time in [time, end_time) at which the power of the beam is
+// not zero. If the beam stays off, return std::numeric_limits<double>::max().
+template <int dim>
+double next_power_on_time(adamantine::HeatSource<dim> &beam, double const time,
+                          double const end_time)
+{
+  auto const &segment_list = beam.get_scan_path().get_segment_list();
+  // Heat sources without scan path (cube) are always on.
+  if (segment_list.empty())
+    return time;
+
+  // Search the segments overlapping with [time, end_time). The segment i
+  // starts at the end time of the segment i-1.
+  auto segment_it = std::upper_bound(
+      segment_list.begin(), segment_list.end(), time,
+      [](double const t, adamantine::ScanPathSegment const &segment)
+      { return t < segment.end_time; });
+  for (; segment_it != segment_list.end(); ++segment_it)
+  {
+    double const segment_start = segment_it == segment_list.begin()
+                                     ? std::numeric_limits<double>::lowest()
+                                     : std::prev(segment_it)->end_time;
+    if (segment_start >= end_time)
+      break;
+    if (segment_it->power_modifier > 0.)
+      return std::max(segment_start, time);
+  }
+
+  return std::numeric_limits<double>::max();
+}
+
+// Shorten the time step so that it ends at the next deposition time.
+inline double limit_time_step_to_deposition(
+    std::vector<double> const &deposition_times, double const time,
+    double time_step)
+{
+  double const eps = time_step / 1e12;
+  auto const next_deposition = std::upper_bound(
+      deposition_times.begin(), deposition_times.end(), time + eps);
+  if ((next_deposition != deposition_times.end()) &&
+      (*next_deposition < time + time_step))
+    time_step = *next_deposition - time;
+
+  return time_step;
+}
+
+// Shorten the time step so that it ends at the next event: the end of a
+// segment of the scan path of a beam, which is also where the power of the
+// beam changes, or a deposition time. The steps then never straddle an event.
+template <int dim>
+double limit_time_step_to_events(
+    std::vector<std::shared_ptr<adamantine::HeatSource<dim>>> &heat_sources,
+    std::vector<double> const &deposition_times, double const time,
+    double time_step)
+{
+  double const eps = time_step / 1e12;
+  for (auto &beam : heat_sources)
+  {
+    auto const &segment_list = beam->get_scan_path().get_segment_list();
+    auto const next_segment_end = std::upper_bound(
+        segment_list.begin(), segment_list.end(), time + eps,
+        [](double const t, adamantine::ScanPathSegment const &segment)
+        { return t < segment.end_time; });
+    if ((next_segment_end != segment_list.end()) &&
+        (next_segment_end->end_time < time + time_step))
+      time_step = next_segment_end->end_time - time;
+  }
+
+  return limit_time_step_to_deposition(deposition_times, time, time_step);
+}
+
+// Return the time step to use after a time step of size aligned_time_step.
+// When the time step was shortened by limit_time_step_to_events(), the guess of
+// the time stepping method is based on the shortened step and the time step
+// that was scheduled before the alignment is used again. Otherwise, the guess,
+// e.g., the one of the error controller of an embedded method, is kept.
+inline double restore_scheduled_time_step(double const time_step_guess,
+                                          double const scheduled_time_step,
+                                          double const aligned_time_step)
+{
+  if (aligned_time_step < scheduled_time_step)
+    return std::max(time_step_guess, scheduled_time_step);
+
+  return time_step_guess;
+}
+
+// Return the time up to which the material is activated when some material is
+// deposited during the time step ending at time_step_end. The boxes deposited
+// within activation_window are activated at the same time but the boxes past
+// the end of the deposition window have not been created yet, so they cannot
+// be activated early.
+inline double activation_window_end(double const time_step_end,
+                                    double const activation_window,
+                                    double const deposition_window_end)
+{
+  return std::min(time_step_end + activation_window, deposition_window_end);
+}
+
+// Limit the adaptive time step of an implicit method. While a beam is turned
+// on, the time step cannot be larger than beam_time_step. The time step is
+// also shortened so that it ends when a beam turns on or when material is
+// deposited.
+template <int dim>
+double limit_adaptive_time_step(
+    std::vector<std::shared_ptr<adamantine::HeatSource<dim>>> &heat_sources,
+    std::vector<double> const &deposition_times, double const time,
+    double time_step, double const beam_time_step)
+{
+  for (auto &beam : heat_sources)
+  {
+    double const power_on_time =
+        next_power_on_time(*beam, time, time + time_step);
+    if (power_on_time <= time)
+      time_step = std::min(time_step, beam_time_step);
+    else if (power_on_time < time + time_step)
+      time_step = power_on_time - time;
+  }
+
+  return limit_time_step_to_deposition(deposition_times, time, time_step);
+}
+
+// Return the time step of the dwell period starting at time, i.e., while all
+// the beams are off. The returned time step is at most time_step and it ends
+// when a beam turns on or when material is deposited. Return zero if a beam is
+// on.
+template <int dim>
+double compute_dwell_time_step(
+    std::vector<std::shared_ptr<adamantine::HeatSource<dim>>> &heat_sources,
+    std::vector<double> const &deposition_times, double const time,
+    double time_step)
+{
+  for (auto &beam : heat_sources)
+  {
+    double const power_on_time =
+        next_power_on_time(*beam, time, time + time_step);
+    if (power_on_time <= time)
+      return 0.;
+    time_step = std::min(time_step, power_on_time - time);
+  }
+
+  return limit_time_step_to_deposition(deposition_times, time, time_step);
+}
+
+// Return the number of cells flagged for coarsening.
+template <int dim, typename MemorySpaceType>
+unsigned int flag_dormant_cells(
+    dealii::DoFHandler<dim> const &dof_handler,
+    dealii::LA::distributed::Vector<double, MemorySpaceType> const &solution,
+    std::vector<std::shared_ptr<adamantine::HeatSource<dim>>> &heat_sources,
+    double const time, double const next_refinement_time,
+    unsigned int const n_time_steps, double const dormant_temperature,
+    double const dormant_temperature_variation, double const dormant_distance)
+{
+  // Positions of the beams between time and next_refinement_time
+  std::vector<dealii::Point<3>> beam_positions;
+  for (auto &beam : heat_sources)
+  {
+    adamantine::ScanPath const &scan_path = beam->get_scan_path();
+    if (scan_path.get_segment_list().empty())
+      continue;
+    for (unsigned int i = 0; i <= n_time_steps; ++i)
+    {
+      double const current_time = time + static_cast<double>(i) /
+                                             static_cast<double>(n_time_steps) *
+                                             (next_refinement_time - time);
+      beam_positions.push_back(scan_path.value(current_time));
+    }
+  }
+
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+      solution_host(solution.get_partitioner());
+  if constexpr (std::is_same_v<MemorySpaceType, dealii::MemorySpace::Host>)
+    solution_host = solution;
+  else
+    solution_host.import(solution, dealii::VectorOperation::insert);
+  solution_host.update_ghost_values();
+
+  // A cell is dormant if its temperature is low, almost uniform, and if it is
+  // far from the upcoming paths of the beams. The dormant cells are flagged for
+  // coarsening. Because the temperature is almost uniform, interpolating it on
+  // the coarse cell loses little energy.
+  unsigned int n_dormant_cells = 0;
+  double const dormant_distance_squared = dormant_distance * dormant_distance;
+  std::vector<dealii::types::global_dof_index> local_dof_indices;
+  for (auto const &cell : dealii::filter_iterators(
+           dof_handler.active_cell_iterators(),
+           dealii::IteratorFilters::LocallyOwnedCell()))
+  {
+    if ((cell->level() == 0) || (cell->active_fe_index() != 0))
+      continue;
+
+    local_dof_indices.resize(cell->get_fe().dofs_per_cell);
+    cell->get_dof_indices(local_dof_indices);
+    double min_temperature = std::numeric_limits<double>::max();
+    double max_temperature = std::numeric_limits<double>::lowest();
+    for (auto const dof : local_dof_indices)
+    {
+      min_temperature = std::min(min_temperature, solution_host(dof));
+      max_temperature = std::max(max_temperature, solution_host(dof));
+    }
+    if ((max_temperature >= dormant_temperature) ||
+        (max_temperature - min_temperature >= dormant_temperature_variation))
+      continue;
+
+    dealii::Point<dim> const center = cell->center();
+    bool close_to_beams = false;
+    for (auto const &position : beam_positions)
+    {
+      double const dx = center[adamantine::axis<dim>::x] - position[0];
+      double const dz = center[adamantine::axis<dim>::z] - position[2];
+      double distance_squared = dx * dx + dz * dz;
+      if constexpr (dim == 3)
+      {
+        double const dy = center[adamantine::axis<dim>::y] - position[1];
+        distance_squared += dy * dy;
+      }
+      if (distance_squared < dormant_distance_squared)
+      {
+        close_to_beams = true;
+        break;
+      }
+    }
+    if (close_to_beams)
+      continue;
+
+    cell->clear_refine_flag();
+    cell->set_coarsen_flag();
+    ++n_dormant_cells;
+  }
+
+  return n_dormant_cells;
+}
+
 template <int dim, int fe_degree, typename MemorySpaceType>
 void refine_mesh(
     std::unique_ptr<adamantine::ThermalPhysicsInterface<dim, MemorySpaceType>>
@@ -645,6 +1061,12 @@ void refine_mesh(
   double refining_fraction = 0.6;
   // PropertyTreeInput refinement.heat_cell_ratio
   double cells_fraction = refinement_database.get("heat_cell_ratio", 1.);
+  // The gradient indicator is computed by the MatrixFree operator in the memory
+  // space of the solution.
+  // PropertyTreeInput refinement.error_indicator
+  bool const gradient_indicator =
+      refinement_database.get<std::string>("error_indicator", "kelly") ==
+      "gradient";
   dealii::parallel::distributed::Triangulation<dim> &triangulation =
       dynamic_cast<dealii::parallel::distributed::Triangulation<dim> &>(
           const_cast<dealii::Triangulation<dim> &>(
@@ -665,7 +1087,9 @@ void refine_mesh(
   {
     // Estimate the error. For simplicity, always use dealii::QGauss
     dealii::Vector<float> estimated_error_per_cell =
-        estimate_error(triangulation, dof_handler, fe_degree, solution);
+        gradient_indicator
+            ? thermal_physics->compute_gradient_indicator(solution)
+            : estimate_error(triangulation, dof_handler, fe_degree, solution);
 
     // Flag the cells for refinement.
     unsigned int new_n_cells = static_cast<unsigned int>(
@@ -701,7 +1125,70 @@ void refine_mesh(
                 thermal_physics.get())
                 ->get_current_source_height();
 
-  for (unsigned int i = 0; i < n_beam_refinements; ++i)
+  // Cells closer than coarsen_margin to one of the beams, at the current time,
+  // are not coarsened. This avoids coarsening cells that the beam has just left
+  // and that are still hot.
+  // PropertyTreeInput refinement.coarsen_margin
+  double const coarsen_margin = refinement_database.get("coarsen_margin", 0.);
+  std::vector<adamantine::HeatSourceData<dim>> beam_data;
+  for (auto &beam : heat_sources)
+  {
+    beam->update_time(time);
+    beam_data.push_back(beam->get_data());
+  }
+  // The distance is measured in the plane of the scan path.
+  auto close_to_beams = [&](dealii::Point<dim> const &point, double margin)
+  {
+    for (auto const &data : beam_data)
+    {
+      if (data.type == adamantine::HeatSourceType::cube)
+        continue;
+      double const dx = point[adamantine::axis<dim>::x] -
+                        data.beam_center[adamantine::axis<dim>::x];
+      double distance_squared = dx * dx;
+      if constexpr (dim == 3)
+      {
+        double const dy = point[adamantine::axis<dim>::y] -
+                          data.beam_center[adamantine::axis<dim>::y];
+        distance_squared += dy * dy;
+      }
+      if (distance_squared < margin * margin)
+        return true;
+    }
+    return false;
+  };
+
+  // Cells in the dormant region, i.e. cold material far from the upcoming paths
+  // of the beams, are coarsened during the first beam refinement.
+  // PropertyTreeInput refinement.dormant_temperature
+  boost::optional<double> const dormant_temperature =
+      refinement_database.get_optional<double>("dormant_temperature");
+  // PropertyTreeInput refinement.dormant_temperature_variation
+  double const dormant_temperature_variation =
+      refinement_database.get("dormant_temperature_variation", 1.);
+  // PropertyTreeInput refinement.dormant_distance
+  double const dormant_distance =
+      refinement_database.get("dormant_distance", 0.);
+  auto flag_dormant_region = [&]()
+  {
+    flag_dormant_cells(dof_handler, solution, heat_sources, time,
+                       next_refinement_time, time_steps_refinement,
+                       *dormant_temperature, dormant_temperature_variation,
+                       dormant_distance);
+  };
+
+  // PropertyTreeInput refinement.single_pass_beam_refinement
+  const bool single_pass_beam_refinement =
+      refinement_database.get<bool>("single_pass_beam_refinement", false);
+  // When the beam refinement is done in a single pass, the cells on the paths
+  // of the beams are computed once on the current mesh and all their children
+  // are refined up to the final level. Thus, ThermalPhysics and
+  // MaterialProperty are rebuilt only once instead of n_beam_refinements times.
+  unsigned int const n_beam_passes =
+      (single_pass_beam_refinement && (n_beam_refinements > 0))
+          ? 1
+          : n_beam_refinements;
+  for (unsigned int i = 0; i < n_beam_passes; ++i)
   {
     // Compute the cells to be refined.
     std::vector<typename dealii::parallel::distributed::Triangulation<
@@ -714,34 +1201,261 @@ void refine_mesh(
     const bool coarsen_after_beam =
         refinement_database.get<bool>("coarsen_after_beam", false);
 
-    // If coarsening is allowed, set the coarsening flag everywhere
+    // If coarsening is allowed, set the coarsening flag everywhere except
+    // close to the current position of the beams.
     if (coarsen_after_beam)
     {
       for (auto cell : dealii::filter_iterators(
                triangulation.active_cell_iterators(),
                dealii::IteratorFilters::LocallyOwnedCell()))
       {
-        if (cell->level() > 0)
+        if ((cell->level() > 0) &&
+            !close_to_beams(cell->center(), coarsen_margin))
           cell->set_coarsen_flag();
       }
     }
 
+    if (dormant_temperature && (i == 0))
+      flag_dormant_region();
+
     // Flag the cells for refinement.
+    std::vector<int> target_levels;
+    if (single_pass_beam_refinement)
+      target_levels.resize(triangulation.n_active_cells(), -1);
     for (auto &cell : cells_to_refine)
     {
-      if (coarsen_after_beam)
-        cell->clear_coarsen_flag();
+      cell->clear_coarsen_flag();
       if (cell->level() < max_level)
         cell->set_refine_flag();
+      if (single_pass_beam_refinement)
+        target_levels[cell->active_cell_index()] = std::min(
+            cell->level() + static_cast<int>(n_beam_refinements), max_level);
     }
 
     // Execute the refinement and transfer the solution onto the new mesh.
+    refine_and_transfer(thermal_physics, material_properties, dof_handler,
+                        solution, target_levels);
+  }
+
+  // Without beam refinement, the dormant region needs its own coarsening.
+  if (dormant_temperature && (n_beam_passes == 0))
+  {
+    flag_dormant_region();
     refine_and_transfer(thermal_physics, material_properties, dof_handler,
                         solution);
   }
-
-  // Recompute the inverse of the mass matrix
+
+  // Recompute the inverse of the mass matrix
+  thermal_physics->compute_inverse_mass_matrix();
+}
+
+template <int dim, typename MemorySpaceType>
+void repartition(
+    std::unique_ptr<adamantine::ThermalPhysicsInterface<dim, MemorySpaceType>>
+        &thermal_physics,
+    adamantine::MaterialProperty<dim, MemorySpaceType> &material_properties,
+    dealii::LA::distributed::Vector<double, MemorySpaceType> &solution)
+{
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_CXX_MARK_FUNCTION;
+#endif
+  // Without any refinement flag, execute_coarsening_and_refinement only
+  // repartitions the mesh using the cell weights.
+  dealii::DoFHandler<dim> &dof_handler = thermal_physics->get_dof_handler();
+  refine_and_transfer(thermal_physics, material_properties, dof_handler,
+                      solution);
+  thermal_physics->compute_inverse_mass_matrix();
+}
+
+// Write a checkpoint of the thermal simulation. The refinement of the mesh,
+// the active FE indices, the solution, and the data of the cells are saved
+// with the Triangulation in the files starting with filename so that the
+// simulation can be restarted on a different number of processors. The
+// variables of the time loop in restart_database are written by the first
+// processor in filename.restart.
+template <int dim, typename MemorySpaceType>
+void write_checkpoint(
+    std::string const &filename,
+    std::unique_ptr<adamantine::ThermalPhysicsInterface<dim, MemorySpaceType>>
+        &thermal_physics,
+    adamantine::MaterialProperty<dim, MemorySpaceType> &material_properties,
+    dealii::LA::distributed::Vector<double, MemorySpaceType> const &solution,
+    boost::property_tree::ptree const &restart_database)
+{
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_CXX_MARK_FUNCTION;
+#endif
+
+  dealii::DoFHandler<dim> &dof_handler = thermal_physics->get_dof_handler();
+  dealii::parallel::distributed::Triangulation<dim> &triangulation =
+      dynamic_cast<dealii::parallel::distributed::Triangulation<dim> &>(
+          const_cast<dealii::Triangulation<dim> &>(
+              dof_handler.get_triangulation()));
+
+  // Save the solution with the constraints applied
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+      solution_host(solution.get_partitioner());
+  if constexpr (std::is_same_v<MemorySpaceType, dealii::MemorySpace::Host>)
+    solution_host = solution;
+  else
+    solution_host.import(solution, dealii::VectorOperation::insert);
+  thermal_physics->get_affine_constraints().distribute(solution_host);
+  solution_host.update_ghost_values();
+
+  // Save the material state, the deposition cos and sin, and the melted
+  // indicator. The last three are only defined on the activated cells.
+  thermal_physics->set_state_to_material_properties();
+  adamantine::MemoryBlockView<double, MemorySpaceType> material_state_view =
+      material_properties.get_state();
+  adamantine::HostStagingBuffer<double, MemorySpaceType> material_state_host;
+  material_state_host.reinit(material_state_view.extent(0),
+                             material_state_view.extent(1));
+  material_state_host.copy_from(material_state_view.data());
+  material_state_host.wait();
+  adamantine::MemoryBlockView<double, dealii::MemorySpace::Host>
+      state_host_view = material_state_host.get_view();
+  unsigned int constexpr n_material_states = adamantine::g_n_material_states;
+  unsigned int constexpr data_size_per_cell = n_material_states + 3;
+  std::vector<std::vector<double>> cell_data(
+      triangulation.n_active_cells(),
+      std::vector<double>(data_size_per_cell,
+                          std::numeric_limits<double>::infinity()));
+  unsigned int cell_id = 0;
+  unsigned int activated_cell_id = 0;
+  for (auto const &cell :
+       dealii::filter_iterators(dof_handler.active_cell_iterators(),
+                                dealii::IteratorFilters::LocallyOwnedCell()))
+  {
+    std::vector<double> &data = cell_data[cell->active_cell_index()];
+    for (unsigned int i = 0; i < n_material_states; ++i)
+      data[i] = state_host_view(i, cell_id);
+    if (cell->active_fe_index() == 0)
+    {
+      data[n_material_states] =
+          thermal_physics->get_deposition_cos(activated_cell_id);
+      data[n_material_states + 1] =
+          thermal_physics->get_deposition_sin(activated_cell_id);
+      data[n_material_states + 2] =
+          thermal_physics->get_has_melted(activated_cell_id) ? 1. : 0.;
+      ++activated_cell_id;
+    }
+    ++cell_id;
+  }
+
+  // The data is attached to the Triangulation in the same order as it is
+  // read in read_checkpoint.
+  dof_handler.prepare_for_serialization_of_active_fe_indices();
+  dealii::parallel::distributed::SolutionTransfer<
+      dim, dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>>
+      solution_transfer(dof_handler);
+  solution_transfer.prepare_for_serialization(solution_host);
+  dealii::parallel::distributed::CellDataTransfer<
+      dim, dim, std::vector<std::vector<double>>>
+      cell_data_transfer(triangulation);
+  cell_data_transfer.prepare_for_serialization(cell_data);
+  triangulation.save(filename);
+
+  // The variables of the time loop are written last so that a checkpoint that
+  // has not been written completely cannot be used to restart.
+  if (dealii::Utilities::MPI::this_mpi_process(
+          triangulation.get_communicator()) == 0)
+  {
+    boost::property_tree::info_parser::write_info(filename + ".restart",
+                                                  restart_database);
+  }
+}
+
+// Read the checkpoint written by write_checkpoint and return the variables of
+// the time loop. The Triangulation must only contain the coarse mesh.
+template <int dim, typename MemorySpaceType>
+boost::property_tree::ptree read_checkpoint(
+    std::string const &filename,
+    std::unique_ptr<adamantine::ThermalPhysicsInterface<dim, MemorySpaceType>>
+        &thermal_physics,
+    adamantine::MaterialProperty<dim, MemorySpaceType> &material_properties,
+    dealii::LA::distributed::Vector<double, MemorySpaceType> &solution)
+{
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_CXX_MARK_FUNCTION;
+#endif
+
+  ASSERT_THROW(std::filesystem::exists(filename + ".restart"),
+               "Error: The checkpoint " + filename + " does not exist.");
+  boost::property_tree::ptree restart_database;
+  boost::property_tree::info_parser::read_info(filename + ".restart",
+                                               restart_database);
+
+  dealii::DoFHandler<dim> &dof_handler = thermal_physics->get_dof_handler();
+  dealii::parallel::distributed::Triangulation<dim> &triangulation =
+      dynamic_cast<dealii::parallel::distributed::Triangulation<dim> &>(
+          const_cast<dealii::Triangulation<dim> &>(
+              dof_handler.get_triangulation()));
+  ASSERT_THROW(triangulation.n_levels() == 1,
+               "Error: The mesh must not be refined before reading the "
+               "checkpoint.");
+  triangulation.load(filename);
+  dof_handler.deserialize_active_fe_indices();
+
+  // Read the solution
+  thermal_physics->setup_dofs();
+  thermal_physics->initialize_dof_vector(solution);
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+      solution_host(solution.get_partitioner());
+  dealii::parallel::distributed::SolutionTransfer<
+      dim, dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>>
+      solution_transfer(dof_handler);
+  solution_transfer.deserialize(solution_host);
+  if constexpr (std::is_same_v<MemorySpaceType, dealii::MemorySpace::Host>)
+    solution = solution_host;
+  else
+    solution.import(solution_host, dealii::VectorOperation::insert);
+
+  // Read the data of the cells
+  unsigned int constexpr n_material_states = adamantine::g_n_material_states;
+  unsigned int constexpr data_size_per_cell = n_material_states + 3;
+  std::vector<std::vector<double>> cell_data(
+      triangulation.n_active_cells(), std::vector<double>(data_size_per_cell));
+  dealii::parallel::distributed::CellDataTransfer<
+      dim, dim, std::vector<std::vector<double>>>
+      cell_data_transfer(triangulation);
+  cell_data_transfer.deserialize(cell_data);
+
+  material_properties.reinit_dofs();
+  adamantine::MemoryBlockView<double, MemorySpaceType> material_state_view =
+      material_properties.get_state();
+  adamantine::HostStagingBuffer<double, MemorySpaceType> material_state_host;
+  material_state_host.reinit(material_state_view.extent(0),
+                             material_state_view.extent(1));
+  adamantine::MemoryBlockView<double, dealii::MemorySpace::Host>
+      state_host_view = material_state_host.get_view();
+  std::vector<double> deposition_cos;
+  std::vector<double> deposition_sin;
+  std::vector<bool> has_melted;
+  unsigned int cell_id = 0;
+  for (auto const &cell :
+       dealii::filter_iterators(dof_handler.active_cell_iterators(),
+                                dealii::IteratorFilters::LocallyOwnedCell()))
+  {
+    std::vector<double> const &data = cell_data[cell->active_cell_index()];
+    for (unsigned int i = 0; i < n_material_states; ++i)
+      state_host_view(i, cell_id) = data[i];
+    if (cell->active_fe_index() == 0)
+    {
+      deposition_cos.push_back(data[n_material_states]);
+      deposition_sin.push_back(data[n_material_states + 1]);
+      has_melted.push_back(data[n_material_states + 2] > 0.5);
+    }
+    ++cell_id;
+  }
+  material_state_host.copy_to(material_state_view.data());
+  thermal_physics->set_material_deposition_orientation(deposition_cos,
+                                                       deposition_sin);
+  thermal_physics->set_has_melted_vector(has_melted);
+  material_state_host.wait();
+  thermal_physics->get_state_from_material_properties();
   thermal_physics->compute_inverse_mass_matrix();
+
+  return restart_database;
 }
 
 template <int dim, typename MemorySpaceType>
@@ -837,6 +1551,46 @@ void refine_mesh(
   }
 }
 
+template <int dim, typename MemorySpaceType>
+void add_memory_consumption(
+    adamantine::MemoryReport &memory_report,
+    dealii::parallel::distributed::Triangulation<dim> const &triangulation,
+    adamantine::MaterialProperty<dim, MemorySpaceType> const
+        &material_properties,
+    std::unique_ptr<
+        adamantine::ThermalPhysicsInterface<dim, MemorySpaceType>> const
+        &thermal_physics,
+    std::vector<std::vector<
+        typename dealii::DoFHandler<dim>::active_cell_iterator>> const
+        &elements_to_activate)
+{
+  memory_report.add("triangulation", triangulation.memory_consumption());
+  memory_report.add("material_properties",
+                    material_properties.memory_consumption());
+  thermal_physics->add_memory_consumption(memory_report);
+  std::size_t elements_to_activate_size =
+      elements_to_activate.capacity() * sizeof(elements_to_activate[0]);
+  for (auto const &elements : elements_to_activate)
+    elements_to_activate_size += elements.capacity() * sizeof(elements[0]);
+  memory_report.add("elements_to_activate", elements_to_activate_size);
+}
+
+template <int dim>
+void add_deposition_memory_consumption(
+    adamantine::MemoryReport &memory_report,
+    std::vector<dealii::BoundingBox<dim>> const &material_deposition_boxes,
+    std::vector<double> const &deposition_times,
+    std::vector<double> const &deposition_cos,
+    std::vector<double> const &deposition_sin)
+{
+  memory_report.add(
+      "deposition_boxes",
+      material_deposition_boxes.capacity() * sizeof(dealii::BoundingBox<dim>) +
+          dealii::MemoryConsumption::memory_consumption(deposition_times) +
+          dealii::MemoryConsumption::memory_consumption(deposition_cos) +
+          dealii::MemoryConsumption::memory_consumption(deposition_sin));
+}
+
 template <int dim, typename MemorySpaceType>
 std::pair<dealii::LinearAlgebra::distributed::Vector<double,
                                                      dealii::MemorySpace::Host>,
@@ -893,6 +1647,8 @@ run(MPI_Comm const &communicator, boost::property_tree::ptree const &database,
     thermal_physics = initialize_thermal_physics<dim>(
         fe_degree, quadrature_type, communicator, database, geometry,
         material_properties);
+    thermal_physics->set_dof_renumbering_timer(
+        timers[adamantine::dof_renumbering]);
     heat_sources = thermal_physics->get_heat_sources();
     post_processor_database.put("thermal_output", true);
   }
@@ -926,10 +1682,16 @@ run(MPI_Comm const &communicator, boost::property_tree::ptree const &database,
     // PropertyTreeInput discretization.mechanical.fe_degree
     unsigned int const fe_degree =
         discretization_database.get<unsigned int>("mechanical.fe_degree");
+    // PropertyTreeInput discretization.mechanical.matrix_free
+    bool const matrix_free =
+        discretization_database.get("mechanical.matrix_free", false);
+    // PropertyTreeInput discretization.mechanical.preconditioner
+    bool const use_amg = discretization_database.get<std::string>(
+                             "mechanical.preconditioner", "ssor") == "amg";
     mechanical_physics =
         std::make_unique<adamantine::MechanicalPhysics<dim, MemorySpaceType>>(
             communicator, fe_degree, geometry, material_properties,
-            material_reference_temps);
+            material_reference_temps, false, matrix_free, use_amg);
     post_processor_database.put("mechanical_output", true);
   }
 
@@ -953,16 +1715,88 @@ run(MPI_Comm const &communicator, boost::property_tree::ptree const &database,
                        : mechanical_physics->get_dof_handler());
   }
 
+  // Create the MeltPoolMonitor
+  // PropertyTreeInput post_processor.melt_pool_output
+  bool const melt_pool_output =
+      use_thermal_physics &&
+      post_processor_database.get("melt_pool_output", false);
+  std::unique_ptr<adamantine::MeltPoolMonitor<dim>> melt_pool_monitor;
+  if (melt_pool_output)
+  {
+    melt_pool_monitor = std::make_unique<adamantine::MeltPoolMonitor<dim>>(
+        communicator, material_database,
+        post_processor_database.get<std::string>("filename_prefix") +
+            ".melt_pool.csv");
+  }
+
+  // Create the TemperatureProbes
+  // PropertyTreeInput post_processor.probes
+  bool const probe_output =
+      use_thermal_physics && (post_processor_database.count("probes") != 0);
+  std::unique_ptr<adamantine::TemperatureProbes<dim>> temperature_probes;
+  if (probe_output)
+  {
+    temperature_probes = std::make_unique<adamantine::TemperatureProbes<dim>>(
+        communicator, post_processor_database);
+  }
+
+  // Create the PerformanceLog
+  // PropertyTreeInput profiling.performance_log
+  bool const performance_output =
+      use_thermal_physics && database.get("profiling.performance_log", false);
+  std::unique_ptr<adamantine::PerformanceLog> performance_log;
+  if (performance_output)
+  {
+    performance_log = std::make_unique<adamantine::PerformanceLog>(
+        communicator,
+        post_processor_database.get<std::string>("filename_prefix") +
+            ".performance.csv");
+  }
+
+  // Create the MemoryReport
+  // PropertyTreeInput profiling.memory_report
+  bool const memory_output =
+      use_thermal_physics && database.get("profiling.memory_report", false);
+  // PropertyTreeInput profiling.time_steps_between_memory_report
+  unsigned int const time_steps_memory_report =
+      database.get("profiling.time_steps_between_memory_report", 100);
+  std::unique_ptr<adamantine::MemoryReport> memory_report;
+  if (memory_output)
+  {
+    memory_report = std::make_unique<adamantine::MemoryReport>(
+        communicator, post_processor_database.get<std::string>(
+                          "filename_prefix") +
+                          ".memory.csv");
+  }
+
+  // Restart the simulation from a checkpoint
+  // PropertyTreeInput restart.filename_prefix
+  boost::optional<std::string> const restart_filename =
+      database.get_optional<std::string>("restart.filename_prefix");
+  ASSERT_THROW(!restart_filename || use_thermal_physics,
+               "Error: Only the thermal simulations can be restarted.");
+  boost::property_tree::ptree restart_database;
+
   dealii::LA::distributed::Vector<double, MemorySpaceType> temperature;
   dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
       displacement;
   if (use_thermal_physics)
   {
-    thermal_physics->setup_dofs();
-    thermal_physics->update_material_deposition_orientation();
-    thermal_physics->compute_inverse_mass_matrix();
-    thermal_physics->initialize_dof_vector(initial_temperature, temperature);
-    thermal_physics->get_state_from_material_properties();
+    if (restart_filename)
+    {
+      restart_database =
+          read_checkpoint(restart_filename.get(), thermal_physics,
+                          material_properties, temperature);
+    }
+    else
+    {
+      thermal_physics->setup_dofs();
+      thermal_physics->update_material_deposition_orientation();
+      thermal_physics->compute_inverse_mass_matrix();
+      thermal_physics->initialize_dof_vector(initial_temperature,
+                                             temperature);
+      thermal_physics->get_state_from_material_properties();
+    }
   }
 
   if (use_mechanical_physics)
@@ -989,25 +1823,58 @@ run(MPI_Comm const &communicator, boost::property_tree::ptree const &database,
   unsigned int n_time_step = 0;
   double time = 0.;
 
-  // Output the initial solution
-  output_pvtu(*post_processor, n_time_step, time, thermal_physics, temperature,
-              mechanical_physics, displacement, material_properties, timers);
+  // Output the initial solution. After a restart, the time loop continues
+  // after the time step of the checkpoint.
+  if (restart_filename)
+  {
+    progress = restart_database.get<unsigned int>("progress");
+    n_time_step = restart_database.get<unsigned int>("n_time_step");
+    time = restart_database.get<double>("time");
+  }
+  else
+  {
+    output_pvtu(*post_processor, n_time_step, time, thermal_physics,
+                temperature, mechanical_physics, displacement,
+                material_properties, timers);
+  }
   ++n_time_step;
 
-  // Create the bounding boxes used for material deposition
+  // Create the bounding boxes used for material deposition. If a deposition
+  // time window is given, the boxes are only created over the window ahead of
+  // the current time and the window is moved during the simulation.
+  // PropertyTreeInput geometry.deposition_time_window
+  double const deposition_time_window =
+      geometry_database.get("deposition_time_window", 0.);
+  double deposition_window_end = deposition_time_window > 0.
+                                     ? time + deposition_time_window
+                                     : std::numeric_limits<double>::max();
   auto [material_deposition_boxes, deposition_times, deposition_cos,
         deposition_sin] =
-      adamantine::create_material_deposition_boxes<dim>(geometry_database,
-                                                        heat_sources);
+      adamantine::create_material_deposition_boxes<dim>(
+          geometry_database, heat_sources,
+          std::numeric_limits<double>::lowest(), deposition_window_end);
 
   // Unless we use an embedded method, we know in advance the time step.
   // Thus we can get for each time step, the list of elements that we will
-  // need to activate. This list will be invalidated every time we refine the
-  // mesh.
-  timers[adamantine::add_material_search].start();
-  auto elements_to_activate = adamantine::get_elements_to_activate(
-      thermal_physics->get_dof_handler(), material_deposition_boxes);
-  timers[adamantine::add_material_search].stop();
+  // need to activate. The elements are only searched for the boxes deposited
+  // before the next refinement. This list will be invalidated every time we
+  // refine the mesh or move the deposition window.
+  std::vector<
+      std::vector<typename dealii::DoFHandler<dim>::active_cell_iterator>>
+      elements_to_activate;
+  std::ptrdiff_t searched_boxes_end = 0;
+  // Indices of the boxes that intersect the locally owned cells. Only these
+  // boxes are searched. The list is recomputed when the mesh or the boxes
+  // change, i.e., when searched_boxes_end is reset.
+  std::vector<unsigned int> local_deposition_boxes;
+  // When material is activated, the boxes deposited within
+  // activation_window of the end of the time step are activated at the same
+  // time to reduce the number of times the physics is rebuilt. The boxes
+  // deposited before activated_time have already been activated.
+  // PropertyTreeInput geometry.activation_window
+  double const activation_window =
+      geometry_database.get("activation_window", 0.);
+  double activated_time = std::numeric_limits<double>::lowest();
 
   // Extract the time-stepping database
   boost::property_tree::ptree time_stepping_database =
@@ -1016,6 +1883,30 @@ run(MPI_Comm const &communicator, boost::property_tree::ptree const &database,
   double time_step = time_stepping_database.get<double>("time_step");
   // PropertyTreeInput time_stepping.duration
   double const duration = time_stepping_database.get<double>("duration");
+  // When the time step of an implicit method is adaptive, the input time step
+  // is used while the beams are on.
+  double const beam_time_step = time_step;
+  // PropertyTreeInput time_stepping.adaptive_time_step
+  bool const adaptive_time_step =
+      use_thermal_physics &&
+      time_stepping_database.get("adaptive_time_step", false);
+  // While the beams are off and no material is deposited, e.g. during the
+  // inter-layer dwell, the time step is increased up to dwell_time_step.
+  // PropertyTreeInput time_stepping.dwell_time_step
+  double const dwell_time_step =
+      use_thermal_physics ? time_stepping_database.get("dwell_time_step", 0.)
+                          : 0.;
+  // PropertyTreeInput time_stepping.align_with_events
+  bool const align_with_events =
+      use_thermal_physics &&
+      time_stepping_database.get("align_with_events", false);
+  bool dwelling = false;
+  if (restart_filename)
+  {
+    time_step = restart_database.get<double>("time_step");
+    dwelling = restart_database.get<bool>("dwelling");
+    thermal_physics->set_dwell_mode(dwelling);
+  }
 
   // Extract the refinement database
   boost::property_tree::ptree refinement_database =
@@ -1023,11 +1914,83 @@ run(MPI_Comm const &communicator, boost::property_tree::ptree const &database,
   // PropertyTreeInput refinement.time_steps_between_refinement
   unsigned int const time_steps_refinement =
       refinement_database.get("time_steps_between_refinement", 10);
+  // PropertyTreeInput refinement.beam_position_trigger
+  bool const beam_position_trigger =
+      refinement_database.get("beam_position_trigger", false);
+  // PropertyTreeInput refinement.refine_margin
+  double const refine_margin = refinement_database.get("refine_margin", 0.);
+  // The load imbalance is the ratio between the maximum and the average time
+  // spent by the processors evolving the solution since the last check.
+  // PropertyTreeInput refinement.load_imbalance_threshold
+  double const load_imbalance_threshold =
+      refinement_database.get("load_imbalance_threshold", 0.);
+  double last_evolve_time = 0.;
+  // When the cells of the layer being deposited are weighted, the mesh is
+  // repartitioned at the beginning of every layer so that the layer is split
+  // between all the processors.
+  // PropertyTreeInput refinement.layer_weight
+  double const layer_weight = refinement_database.get("layer_weight", 1.);
+  // PropertyTreeInput geometry.deposition_height
+  double const layer_thickness =
+      geometry_database.get("deposition_height", 0.);
+  double layer_height = std::numeric_limits<double>::lowest();
   // PropertyTreeInput post_processor.time_steps_between_output
   unsigned int const time_steps_output =
       post_processor_database.get("time_steps_between_output", 1);
+  // PropertyTreeInput post_processor.time_steps_between_melt_pool_output
+  unsigned int const time_steps_melt_pool =
+      post_processor_database.get("time_steps_between_melt_pool_output", 1);
+  // PropertyTreeInput post_processor.time_steps_between_probe_output
+  unsigned int const time_steps_probes =
+      post_processor_database.get("time_steps_between_probe_output", 1);
+  // PropertyTreeInput checkpoint.filename_prefix
+  boost::optional<std::string> const checkpoint_filename =
+      database.get_optional<std::string>("checkpoint.filename_prefix");
+  ASSERT_THROW(!checkpoint_filename || use_thermal_physics,
+               "Error: Only the thermal simulations can be checkpointed.");
+  // PropertyTreeInput checkpoint.time_steps_between_checkpoint
+  unsigned int const time_steps_checkpoint =
+      checkpoint_filename ? database.get<unsigned int>(
+                                "checkpoint.time_steps_between_checkpoint")
+                          : 0;
+  // The mechanical problem is solved on events that are decoupled from the
+  // thermal time steps. By default, it is solved every time the solution is
+  // written.
+  adamantine::MechanicalSolveScheduler mechanical_solve_scheduler(
+      time_stepping_database, time_steps_output);
+  auto const compute_max_temperature = [&]()
+  {
+    return (use_thermal_physics &&
+            mechanical_solve_scheduler.temperature_trigger())
+               ? temperature.linfty_norm()
+               : 0.;
+  };
+  // The mechanical problem has been solved before the time loop
+  if (use_mechanical_physics)
+    mechanical_solve_scheduler.mechanical_solved(compute_max_temperature());
+  // On the device, the output can be copied to the host while the next time
+  // step is computed. It is then written after that time step or before the
+  // mesh changes, whichever comes first.
+  // PropertyTreeInput post_processor.asynchronous_output
+  bool const asynchronous_output =
+      std::is_same_v<MemorySpaceType, dealii::MemorySpace::CUDA> &&
+      use_thermal_physics && !use_mechanical_physics &&
+      post_processor_database.get("asynchronous_output", false);
+  adamantine::AsynchronousOutput<dim, MemorySpaceType> pending_output;
+  auto const finish_output = [&]()
+  {
+    if (pending_output.pending())
+    {
+      timers[adamantine::output].start();
+      pending_output.finish(*post_processor, *thermal_physics,
+                            material_properties);
+      timers[adamantine::output].stop();
+    }
+  };
 
-  double next_refinement_time = time;
+  double next_refinement_time =
+      restart_filename ? restart_database.get<double>("next_refinement_time")
+                       : time;
   // PropertyTreeInput materials.new_material_temperature
   double const new_material_temperature =
       database.get("materials.new_material_temperature", 300.);
@@ -1046,11 +2009,18 @@ run(MPI_Comm const &communicator, boost::property_tree::ptree const &database,
 
     // Refine the mesh after time_steps_refinement time steps or when time
     // is greater or equal than the next predicted time for refinement. This
-    // is necessary when using an embedded method.
-    if ((((n_time_step % time_steps_refinement) == 0) ||
-         (time >= next_refinement_time)) &&
-        use_thermal_physics)
+    // is necessary when using an embedded method. If beam_position_trigger is
+    // true, the mesh is only refined when a beam gets close to the end of the
+    // refined corridor.
+    bool const refine_now =
+        beam_position_trigger
+            ? beams_near_corridor_end(heat_sources, time, time_step,
+                                      next_refinement_time, refine_margin)
+            : (((n_time_step % time_steps_refinement) == 0) ||
+               (time >= next_refinement_time));
+    if (refine_now && use_thermal_physics)
     {
+      finish_output();
       next_refinement_time = time + time_steps_refinement * time_step;
       timers[adamantine::refine].start();
       refine_mesh(thermal_physics, material_properties, temperature,
@@ -1061,32 +2031,134 @@ run(MPI_Comm const &communicator, boost::property_tree::ptree const &database,
         std::cout << "n_dofs: " << thermal_physics->get_dof_handler().n_dofs()
                   << std::endl;
 
-      timers[adamantine::add_material_search].start();
-      elements_to_activate = adamantine::get_elements_to_activate(
-          thermal_physics->get_dof_handler(), material_deposition_boxes);
+      // The elements to activate need to be searched on the new mesh.
+      searched_boxes_end = 0;
+    }
+    else if (use_thermal_physics && (load_imbalance_threshold > 0.) &&
+             ((n_time_step % time_steps_refinement) == 0))
+    {
+      // Repartition the mesh if the work is not balanced between the
+      // processors.
+      double const evolve_time =
+          boost::chrono::duration_cast<boost::chrono::milliseconds>(
+              timers[adamantine::evol_time].get_elapsed_time())
+              .count();
+      dealii::Utilities::MPI::MinMaxAvg const evolve_time_stats =
+          dealii::Utilities::MPI::min_max_avg(evolve_time - last_evolve_time,
+                                              communicator);
+      last_evolve_time = evolve_time;
+      if ((evolve_time_stats.avg > 0.) &&
+          (evolve_time_stats.max / evolve_time_stats.avg >
+           load_imbalance_threshold))
+      {
+        finish_output();
+        timers[adamantine::refine].start();
+        repartition(thermal_physics, material_properties, temperature);
+        timers[adamantine::refine].stop();
+        if ((rank == 0) && (verbose_output == true))
+          std::cout << "Repartition the mesh, load imbalance: "
+                    << evolve_time_stats.max / evolve_time_stats.avg
+                    << std::endl;
 
-      timers[adamantine::add_material_search].stop();
+        // The elements to activate need to be searched on the new mesh.
+        searched_boxes_end = 0;
+      }
+    }
+
+    if (use_thermal_physics && (layer_weight != 1.))
+    {
+      double source_height = std::numeric_limits<double>::lowest();
+      for (auto const &source : heat_sources)
+        source_height =
+            std::max(source_height, source->get_current_height(time));
+      if (source_height > layer_height + 0.5 * layer_thickness)
+      {
+        layer_height = source_height;
+        finish_output();
+        timers[adamantine::refine].start();
+        repartition(thermal_physics, material_properties, temperature);
+        timers[adamantine::refine].stop();
+        if ((rank == 0) && (verbose_output == true))
+          std::cout << "Repartition the mesh for the layer at height "
+                    << layer_height << std::endl;
+
+        // The elements to activate need to be searched on the new mesh.
+        searched_boxes_end = 0;
+      }
     }
 
-    // Add material if necessary.
     // We use an epsilon to get the "expected" behavior when the deposition
     // time and the time match should match exactly but don't because of
     // floating point accuracy.
-    timers[adamantine::add_material_activate].start();
-
     double const eps = time_step / 1e12;
+
+    // Move the deposition window when the time step goes past its end. The
+    // boxes that have already been deposited are dropped.
+    if (time + time_step > deposition_window_end)
+    {
+      deposition_window_end = time + time_step + deposition_time_window;
+      timers[adamantine::add_material_search].start();
+      std::tie(material_deposition_boxes, deposition_times, deposition_cos,
+               deposition_sin) =
+          adamantine::create_material_deposition_boxes<dim>(
+              geometry_database, heat_sources, time - eps,
+              deposition_window_end);
+      searched_boxes_end = 0;
+      timers[adamantine::add_material_search].stop();
+    }
+
+    // The time step is shortened to end at the next event but the scheduled
+    // time step is used again after the event.
+    double const scheduled_time_step = time_step;
+    if (align_with_events)
+      time_step = limit_time_step_to_events(heat_sources, deposition_times,
+                                            time, time_step);
+
     auto activation_start =
         std::lower_bound(deposition_times.begin(), deposition_times.end(),
-                         time - eps) -
+                         std::max(time, activated_time) - eps) -
         deposition_times.begin();
     auto activation_end =
         std::lower_bound(deposition_times.begin(), deposition_times.end(),
                          time + time_step - eps) -
         deposition_times.begin();
+    if ((activation_window > 0.) && (activation_start < activation_end))
+    {
+      activated_time = activation_window_end(
+          time + time_step, activation_window, deposition_window_end);
+      activation_end =
+          std::lower_bound(deposition_times.begin(), deposition_times.end(),
+                           activated_time - eps) -
+          deposition_times.begin();
+    }
+
+    // Search the elements to activate for all the boxes deposited before the
+    // next refinement.
+    if (use_thermal_physics && (activation_end > searched_boxes_end))
+    {
+      timers[adamantine::add_material_search].start();
+      if (searched_boxes_end == 0)
+        local_deposition_boxes = adamantine::get_local_deposition_boxes(
+            thermal_physics->get_dof_handler(), material_deposition_boxes);
+      searched_boxes_end =
+          std::max(activation_end,
+                   std::lower_bound(deposition_times.begin(),
+                                    deposition_times.end(),
+                                    next_refinement_time - eps) -
+                       deposition_times.begin());
+      elements_to_activate = adamantine::get_elements_to_activate(
+          thermal_physics->get_dof_handler(), material_deposition_boxes,
+          local_deposition_boxes, activation_start, searched_boxes_end);
+      timers[adamantine::add_material_search].stop();
+    }
+
+    // Add material if necessary.
+    timers[adamantine::add_material_activate].start();
     if (activation_start < activation_end)
     {
       if (use_thermal_physics)
       {
+        finish_output();
         // For now assume that all deposited material has never been melted
         // (may or may not be reasonable)
         std::vector<bool> has_melted(deposition_cos.size(), false);
@@ -1096,6 +2168,14 @@ run(MPI_Comm const &communicator, boost::property_tree::ptree const &database,
                                       activation_start, activation_end,
                                       new_material_temperature, temperature);
       }
+      if (use_mechanical_physics && mechanical_solve_scheduler.layer_trigger())
+      {
+        for (auto i = activation_start; i < activation_end; ++i)
+          mechanical_solve_scheduler.add_deposited_material(
+              material_deposition_boxes[i]
+                  .get_boundary_points()
+                  .second[adamantine::axis<dim>::z]);
+      }
     }
 
     if ((rank == 0) && (verbose_output == true) &&
@@ -1121,8 +2201,8 @@ run(MPI_Comm const &communicator, boost::property_tree::ptree const &database,
     // used. Note that this is a problem when adding material because it
     // means that the amount of material that needs to be added is not
     // known.
-#if ADAMANTINE_DEBUG
     double const old_time = time;
+#if ADAMANTINE_DEBUG
     bool const adding_material =
         (activation_start == activation_end) ? false : true;
 #endif
@@ -1138,9 +2218,11 @@ run(MPI_Comm const &communicator, boost::property_tree::ptree const &database,
     // Solve the (thermo-)mechanical problem
     if (use_mechanical_physics)
     {
-      // Since there is no history dependence in the model, only calculate
-      // mechanics when outputting
-      if (n_time_step % time_steps_output == 0)
+      // Since there is no history dependence in the model, the mechanical
+      // problem only needs to be solved when the scheduler requests it.
+      double const max_temperature = compute_max_temperature();
+      if (mechanical_solve_scheduler.solve_now(n_time_step, max_temperature,
+                                               time >= duration - eps))
       {
         if (use_thermal_physics)
         {
@@ -1158,6 +2240,7 @@ run(MPI_Comm const &communicator, boost::property_tree::ptree const &database,
           mechanical_physics->setup_dofs();
         }
         displacement = mechanical_physics->solve();
+        mechanical_solve_scheduler.mechanical_solved(max_temperature);
       }
     }
 
@@ -1167,10 +2250,35 @@ run(MPI_Comm const &communicator, boost::property_tree::ptree const &database,
 #endif
     timers[adamantine::evol_time].stop();
 
+    // Write the output of the previous time step once its copy to the host
+    // has overlapped with this time step.
+    finish_output();
+
     // Get the new time step
     if (use_thermal_physics)
     {
-      time_step = thermal_physics->get_delta_t_guess();
+      time_step = restore_scheduled_time_step(
+          thermal_physics->get_delta_t_guess(), scheduled_time_step,
+          time_step);
+      if (adaptive_time_step)
+        time_step = limit_adaptive_time_step(heat_sources, deposition_times,
+                                             time, time_step, beam_time_step);
+      if (dwell_time_step > 0.)
+      {
+        // The dwell period stops at the end of the deposition window so that
+        // the deposition times are known. Short dwell periods are ignored. At
+        // the end of a dwell period, the input time step is used again.
+        double const dwell_step = compute_dwell_time_step(
+            heat_sources, deposition_times, time,
+            std::min(dwell_time_step, deposition_window_end - time));
+        bool const dwell = dwell_step > beam_time_step;
+        if (dwell)
+          time_step = dwell_step;
+        else if (dwelling)
+          time_step = beam_time_step;
+        dwelling = dwell;
+        thermal_physics->set_dwell_mode(dwelling);
+      }
     }
     else
     {
@@ -1190,6 +2298,67 @@ run(MPI_Comm const &communicator, boost::property_tree::ptree const &database,
       }
     }
 
+    // Record the size of the problem, the iterations of the solvers, and the
+    // time spent in the time step
+    if (performance_output)
+    {
+      adamantine::TimeStepRecord record;
+      record.time_step = n_time_step;
+      record.time = time;
+      record.delta_t = time - old_time;
+      record.n_active_cells =
+          geometry.get_triangulation().n_global_active_cells();
+      record.n_dofs = thermal_physics->get_dof_handler().n_dofs();
+      record.n_linear_iterations = thermal_physics->get_n_linear_iterations();
+      record.n_newton_iterations = thermal_physics->get_n_newton_iterations();
+      performance_log->write_time_step(record, timers);
+    }
+
+    // Write the memory used by each subsystem on every processor
+    if (memory_output && (n_time_step % time_steps_memory_report == 0))
+    {
+      add_memory_consumption(*memory_report, geometry.get_triangulation(),
+                             material_properties, thermal_physics,
+                             elements_to_activate);
+      add_deposition_memory_consumption(*memory_report,
+                                        material_deposition_boxes,
+                                        deposition_times, deposition_cos,
+                                        deposition_sin);
+      memory_report->write(n_time_step, time);
+    }
+
+    // Compute the metrics of the melt pool and evaluate the temperature at the
+    // probes
+    bool const write_melt_pool =
+        melt_pool_output && (n_time_step % time_steps_melt_pool == 0);
+    bool const write_probes =
+        probe_output && (n_time_step % time_steps_probes == 0);
+    if (write_melt_pool || write_probes)
+    {
+      timers[adamantine::output].start();
+      auto const write_host_output = [&](auto const &host_temperature)
+      {
+        if (write_melt_pool)
+          melt_pool_monitor->write_metrics(
+              time, thermal_physics->get_dof_handler(), host_temperature);
+        if (write_probes)
+          temperature_probes->write_values(
+              time, thermal_physics->get_dof_handler(), host_temperature);
+      };
+      if constexpr (std::is_same_v<MemorySpaceType, dealii::MemorySpace::Host>)
+      {
+        write_host_output(temperature);
+      }
+      else
+      {
+        dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+            temperature_host(temperature.get_partitioner());
+        temperature_host.import(temperature, dealii::VectorOperation::insert);
+        write_host_output(temperature_host);
+      }
+      timers[adamantine::output].stop();
+    }
+
     // Output the solution
     if (n_time_step % time_steps_output == 0)
     {
@@ -1197,9 +2366,39 @@ run(MPI_Comm const &communicator, boost::property_tree::ptree const &database,
       {
         thermal_physics->set_state_to_material_properties();
       }
-      output_pvtu(*post_processor, n_time_step, time, thermal_physics,
-                  temperature, mechanical_physics, displacement,
-                  material_properties, timers);
+      if (asynchronous_output)
+      {
+        timers[adamantine::output].start();
+        pending_output.start(n_time_step, time, temperature,
+                             material_properties.get_state());
+        timers[adamantine::output].stop();
+      }
+      else
+      {
+        output_pvtu(*post_processor, n_time_step, time, thermal_physics,
+                    temperature, mechanical_physics, displacement,
+                    material_properties, timers);
+      }
+    }
+
+    // Write a checkpoint. The files of each checkpoint are kept so that a
+    // checkpoint is never overwritten while it is being written.
+    if (checkpoint_filename && (n_time_step % time_steps_checkpoint == 0))
+    {
+      finish_output();
+      timers[adamantine::checkpoint].start();
+      boost::property_tree::ptree checkpoint_database;
+      checkpoint_database.put("n_time_step", n_time_step);
+      checkpoint_database.put("time", time);
+      checkpoint_database.put("time_step", time_step);
+      checkpoint_database.put("dwelling", dwelling);
+      checkpoint_database.put("next_refinement_time", next_refinement_time);
+      checkpoint_database.put("progress", progress);
+      write_checkpoint(checkpoint_filename.get() + "." +
+                           std::to_string(n_time_step),
+                       thermal_physics, material_properties, temperature,
+                       checkpoint_database);
+      timers[adamantine::checkpoint].stop();
     }
     ++n_time_step;
   }
@@ -1207,6 +2406,7 @@ run(MPI_Comm const &communicator, boost::property_tree::ptree const &database,
   CALI_CXX_MARK_LOOP_END(main_loop_id);
 #endif
 
+  finish_output();
   post_processor->write_pvd();
 
   // This is only used for integration test
@@ -1240,6 +2440,128 @@ run(MPI_Comm const &communicator, boost::property_tree::ptree const &database,
   }
 }
 
+/**
+ * Gather the augmented states of the ensemble members of all the groups. The
+ * processors of @p column_communicator own the same dofs and they are ordered
+ * by group. The gathered members use the partitioner of the first member of @p
+ * local_ensemble.
+ */
+inline std::vector<dealii::LA::distributed::BlockVector<double>>
+gather_ensemble(MPI_Comm const &column_communicator,
+                std::vector<dealii::LA::distributed::BlockVector<double>> const
+                    &local_ensemble)
+{
+  unsigned int const base_state_size =
+      local_ensemble[0].block(0).locally_owned_size();
+  unsigned int const augmented_state_size = local_ensemble[0].block(1).size();
+  adamantine::ASSERT_THROW(
+      dealii::Utilities::MPI::min(base_state_size, column_communicator) ==
+          dealii::Utilities::MPI::max(base_state_size, column_communicator),
+      "Error: The meshes of the groups are partitioned differently.");
+  unsigned int const member_size = base_state_size + augmented_state_size;
+
+  std::vector<double> local_buffer(local_ensemble.size() * member_size);
+  for (unsigned int member = 0; member < local_ensemble.size(); ++member)
+  {
+    double *member_buffer = local_buffer.data() + member * member_size;
+    for (unsigned int i = 0; i < base_state_size; ++i)
+      member_buffer[i] = local_ensemble[member].block(0).local_element(i);
+    for (unsigned int i = 0; i < augmented_state_size; ++i)
+      member_buffer[base_state_size + i] = local_ensemble[member].block(1)[i];
+  }
+
+  std::vector<unsigned int> const n_members =
+      dealii::Utilities::MPI::all_gather(
+          column_communicator,
+          static_cast<unsigned int>(local_ensemble.size()));
+  std::vector<int> counts(n_members.size());
+  std::vector<int> displacements(n_members.size() + 1, 0);
+  unsigned int ensemble_size = 0;
+  for (unsigned int i = 0; i < n_members.size(); ++i)
+  {
+    counts[i] = n_members[i] * member_size;
+    displacements[i + 1] = displacements[i] + counts[i];
+    ensemble_size += n_members[i];
+  }
+  std::vector<double> buffer(displacements.back());
+  MPI_Allgatherv(local_buffer.data(), local_buffer.size(), MPI_DOUBLE,
+                 buffer.data(), counts.data(), displacements.data(),
+                 MPI_DOUBLE, column_communicator);
+
+  std::vector<dealii::LA::distributed::BlockVector<double>> ensemble(
+      ensemble_size);
+  for (unsigned int member = 0; member < ensemble_size; ++member)
+  {
+    ensemble[member].reinit(2);
+    ensemble[member].block(0).reinit(
+        local_ensemble[0].block(0).get_partitioner());
+    ensemble[member].block(1).reinit(augmented_state_size);
+    ensemble[member].collect_sizes();
+    double const *member_buffer = buffer.data() + member * member_size;
+    for (unsigned int i = 0; i < base_state_size; ++i)
+      ensemble[member].block(0).local_element(i) = member_buffer[i];
+    for (unsigned int i = 0; i < augmented_state_size; ++i)
+      ensemble[member].block(1)[i] = member_buffer[base_state_size + i];
+  }
+
+  return ensemble;
+}
+
+/**
+ * Copy the augmented states of the members of the group, starting with @p
+ * first_member, from the gathered @p ensemble to @p local_ensemble.
+ */
+inline void scatter_ensemble(
+    std::vector<dealii::LA::distributed::BlockVector<double>> const &ensemble,
+    unsigned int const first_member,
+    std::vector<dealii::LA::distributed::BlockVector<double>> &local_ensemble)
+{
+  for (unsigned int member = 0; member < local_ensemble.size(); ++member)
+  {
+    auto const &gathered_member = ensemble[first_member + member];
+    auto &local_member = local_ensemble[member];
+    unsigned int const base_state_size =
+        local_member.block(0).locally_owned_size();
+    for (unsigned int i = 0; i < base_state_size; ++i)
+      local_member.block(0).local_element(i) =
+          gathered_member.block(0).local_element(i);
+    for (unsigned int i = 0; i < local_member.block(1).size(); ++i)
+      local_member.block(1)[i] = gathered_member.block(1)[i];
+  }
+}
+
+/**
+ * Store the temperature of an idle ensemble member in single precision. The
+ * difference with the mean temperature, which is kept in double precision in
+ * @p offset, is stored so that the rounding error is proportional to the
+ * variation of the temperature and not to the temperature itself. The entries
+ * of @p temperature are released and @p stored keeps its partitioner.
+ */
+inline void store_in_single_precision(
+    dealii::LA::distributed::Vector<double> &temperature,
+    dealii::LA::distributed::Vector<float> &stored, double &offset)
+{
+  offset = temperature.size() > 0 ? temperature.mean_value() : 0.;
+  temperature.add(-offset);
+  stored.reinit(temperature.get_partitioner());
+  stored.copy_locally_owned_data_from(temperature);
+  temperature.reinit(0);
+}
+
+/**
+ * Restore the temperature of an ensemble member stored by
+ * store_in_single_precision(). The ghost entries are not set.
+ */
+inline void restore_from_single_precision(
+    dealii::LA::distributed::Vector<float> &stored, double const offset,
+    dealii::LA::distributed::Vector<double> &temperature)
+{
+  temperature.reinit(stored.get_partitioner());
+  temperature.copy_locally_owned_data_from(stored);
+  temperature.add(offset);
+  stored.reinit(0);
+}
+
 template <int dim, typename MemorySpaceType>
 std::vector<dealii::LA::distributed::BlockVector<double>>
 run_ensemble(MPI_Comm const &communicator,
@@ -1354,15 +2676,44 @@ run_ensemble(MPI_Comm const &communicator,
           ensemble_size, beam_0_absorption_mean, beam_0_absorption_stddev);
 
   // Create a new property tree database for each ensemble member
-  std::vector<boost::property_tree::ptree> database_ensemble(ensemble_size,
-                                                             database);
+  // ------ Distribute the ensemble members between the groups -----
+  // PropertyTreeInput ensemble.n_groups
+  unsigned int const n_groups = ensemble_database.get("n_groups", 1u);
+  unsigned int const n_procs =
+      dealii::Utilities::MPI::n_mpi_processes(communicator);
+  adamantine::ASSERT_THROW(
+      (n_groups > 0) && (n_procs % n_groups == 0) &&
+          (n_groups <= ensemble_size),
+      "Error: The number of groups must divide the number of processors and it "
+      "cannot be larger than the ensemble size.");
+  // Each group of processors evolves a contiguous subset of the ensemble
+  // members on its own copy of the mesh. Because the meshes of all the groups
+  // are built and refined identically, processors with the same rank in their
+  // group own the same dofs. They communicate through the column communicator
+  // to gather the members of all the groups for the data assimilation.
+  unsigned int const group_size = n_procs / n_groups;
+  unsigned int const group = rank / group_size;
+  MPI_Comm group_communicator = communicator;
+  MPI_Comm column_communicator = MPI_COMM_SELF;
+  if (n_groups > 1)
+  {
+    MPI_Comm_split(communicator, group, rank, &group_communicator);
+    MPI_Comm_split(communicator, rank % group_size, group,
+                   &column_communicator);
+  }
+  unsigned int const first_member = group * ensemble_size / n_groups;
+  unsigned int const local_ensemble_size =
+      (group + 1) * ensemble_size / n_groups - first_member;
+
+  std::vector<boost::property_tree::ptree> database_ensemble(
+      local_ensemble_size, database);
 
   std::vector<std::unique_ptr<
       adamantine::ThermalPhysicsInterface<dim, MemorySpaceType>>>
-      thermal_physics_ensemble(ensemble_size);
+      thermal_physics_ensemble(local_ensemble_size);
 
   std::vector<std::vector<std::shared_ptr<adamantine::HeatSource<dim>>>>
-      heat_sources_ensemble(ensemble_size);
+      heat_sources_ensemble(local_ensemble_size);
 
   std::vector<std::unique_ptr<adamantine::Geometry<dim>>> geometry_ensemble;
 
@@ -1375,7 +2726,7 @@ run_ensemble(MPI_Comm const &communicator,
 
   // Create the vector of augmented state vectors
   std::vector<dealii::LA::distributed::BlockVector<double>>
-      solution_augmented_ensemble(ensemble_size);
+      solution_augmented_ensemble(local_ensemble_size);
 
   // Give names to the blocks in the augmented state vector
   int constexpr base_state = 0;
@@ -1414,7 +2765,49 @@ run_ensemble(MPI_Comm const &communicator,
   }
   adamantine::DataAssimilator data_assimilator(data_assimilation_database);
 
-  for (unsigned int member = 0; member < ensemble_size; ++member)
+  // The temperature of the members can be stored in single precision while
+  // they are idle, i.e., while the other members are evolved or output. Only
+  // one member at a time is then stored in double precision. The analysis
+  // needs all the members in double precision at once, so with data
+  // assimilation the single precision storage would not lower the peak memory
+  // and would only round the members after every time step. The members are
+  // then kept in double precision during the whole forecast.
+  // PropertyTreeInput ensemble.single_precision_storage
+  bool single_precision_storage =
+      ensemble_database.get("single_precision_storage", false);
+  if (single_precision_storage && assimilate_data)
+  {
+    single_precision_storage = false;
+    if (rank == 0)
+      std::cout << "Warning: ensemble.single_precision_storage is ignored "
+                   "when data is assimilated."
+                << std::endl;
+  }
+  std::vector<dealii::LA::distributed::Vector<float>> stored_ensemble(
+      single_precision_storage ? local_ensemble_size : 0);
+  std::vector<double> stored_offsets(stored_ensemble.size(), 0.);
+  auto restore_member = [&](unsigned int const member)
+  {
+    if (single_precision_storage)
+    {
+      restore_from_single_precision(
+          stored_ensemble[member], stored_offsets[member],
+          solution_augmented_ensemble[member].block(base_state));
+      solution_augmented_ensemble[member].collect_sizes();
+    }
+  };
+  auto store_member = [&](unsigned int const member)
+  {
+    if (single_precision_storage)
+    {
+      store_in_single_precision(
+          solution_augmented_ensemble[member].block(base_state),
+          stored_ensemble[member], stored_offsets[member]);
+      solution_augmented_ensemble[member].collect_sizes();
+    }
+  };
+
+  for (unsigned int member = 0; member < local_ensemble_size; ++member)
   {
     // Resize the augmented ensemble block vector to have two blocks
     solution_augmented_ensemble[member].reinit(2);
@@ -1424,11 +2817,11 @@ run_ensemble(MPI_Comm const &communicator,
     {
       // PropertyTreeInput sources.beam_0.max_power
       database_ensemble[member].put("sources.beam_0.max_power",
-                                    beam_0_max_power[member]);
+                                    beam_0_max_power[first_member + member]);
 
       // PropertyTreeInput sources.beam_0.absorption_efficiency
       database_ensemble[member].put("sources.beam_0.absorption_efficiency",
-                                    beam_0_absorption[member]);
+                                    beam_0_absorption[first_member + member]);
 
       // Populate the parameter augmentation block of the augmented state
       // ensemble
@@ -1448,13 +2841,13 @@ run_ensemble(MPI_Comm const &communicator,
               adamantine::AugmentedStateParameters::beam_0_absorption)
           {
             solution_augmented_ensemble[member].block(augmented_state)[index] =
-                beam_0_absorption[member];
+                beam_0_absorption[first_member + member];
           }
           else if (augmented_state_parameters.at(index) ==
                    adamantine::AugmentedStateParameters::beam_0_max_power)
           {
             solution_augmented_ensemble[member].block(augmented_state)[index] =
-                beam_0_max_power[member];
+                beam_0_max_power[first_member + member];
           }
         }
       }
@@ -1463,16 +2856,19 @@ run_ensemble(MPI_Comm const &communicator,
     solution_augmented_ensemble[member].collect_sizes();
 
     geometry_ensemble.push_back(std::make_unique<adamantine::Geometry<dim>>(
-        communicator, geometry_database));
+        group_communicator, geometry_database));
 
     material_properties_ensemble.push_back(
         std::make_unique<adamantine::MaterialProperty<dim, MemorySpaceType>>(
-            communicator, geometry_ensemble.back()->get_triangulation(),
+            group_communicator, geometry_ensemble.back()->get_triangulation(),
             material_database));
 
     thermal_physics_ensemble[member] = initialize_thermal_physics<dim>(
-        fe_degree, quadrature_type, communicator, database_ensemble[member],
-        *geometry_ensemble[member], *material_properties_ensemble[member]);
+        fe_degree, quadrature_type, group_communicator,
+        database_ensemble[member], *geometry_ensemble[member],
+        *material_properties_ensemble[member]);
+    thermal_physics_ensemble[member]->set_dof_renumbering_timer(
+        timers[adamantine::dof_renumbering]);
     heat_sources_ensemble[member] =
         thermal_physics_ensemble[member]->get_heat_sources();
 
@@ -1481,7 +2877,7 @@ run_ensemble(MPI_Comm const &communicator,
     thermal_physics_ensemble[member]->compute_inverse_mass_matrix();
 
     thermal_physics_ensemble[member]->initialize_dof_vector(
-        initial_temperature[member],
+        initial_temperature[first_member + member],
         solution_augmented_ensemble[member].block(base_state));
 
     solution_augmented_ensemble[member].collect_sizes();
@@ -1492,8 +2888,9 @@ run_ensemble(MPI_Comm const &communicator,
     post_processor_database.put("thermal_output", true);
     post_processor_ensemble.push_back(
         std::make_unique<adamantine::PostProcessor<dim>>(
-            communicator, post_processor_database,
-            thermal_physics_ensemble[member]->get_dof_handler(), member));
+            group_communicator, post_processor_database,
+            thermal_physics_ensemble[member]->get_dof_handler(),
+            first_member + member));
   }
 
   // PostProcessor for outputting the experimental data
@@ -1504,7 +2901,7 @@ run_ensemble(MPI_Comm const &communicator,
   post_processor_expt_database.put("filename_prefix", expt_file_prefix);
   post_processor_expt_database.put("thermal_output", true);
   adamantine::PostProcessor<dim> post_processor_expt(
-      communicator, post_processor_expt_database,
+      group_communicator, post_processor_expt_database,
       thermal_physics_ensemble[0]->get_dof_handler());
 
   // ----- Read the experimental data -----
@@ -1574,13 +2971,14 @@ run_ensemble(MPI_Comm const &communicator,
       mechanical_physics;
   dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
       displacement;
-  for (unsigned int member = 0; member < ensemble_size; ++member)
+  for (unsigned int member = 0; member < local_ensemble_size; ++member)
   {
     output_pvtu(*post_processor_ensemble[member], n_time_step, time,
                 thermal_physics_ensemble[member],
                 solution_augmented_ensemble[member].block(base_state),
                 mechanical_physics, displacement,
                 *material_properties_ensemble[member], timers);
+    store_member(member);
   }
 
   // ----- Increment the time step -----
@@ -1590,41 +2988,77 @@ run_ensemble(MPI_Comm const &communicator,
   // PropertyTreeInput refinement.time_steps_between_refinement
   unsigned int const time_steps_refinement =
       refinement_database.get("time_steps_between_refinement", 10);
+  // PropertyTreeInput refinement.beam_position_trigger
+  bool const beam_position_trigger =
+      refinement_database.get("beam_position_trigger", false);
+  // PropertyTreeInput refinement.refine_margin
+  double const refine_margin = refinement_database.get("refine_margin", 0.);
   double next_refinement_time = time;
   // PropertyTreeInput time_stepping.time_step
   double time_step = time_stepping_database.get<double>("time_step");
   // PropertyTreeInput time_stepping.duration
   double const duration = time_stepping_database.get<double>("duration");
+  // PropertyTreeInput time_stepping.align_with_events
+  bool const align_with_events =
+      time_stepping_database.get("align_with_events", false);
   // PropertyTreeInput post_processor.time_steps_between_output
   unsigned int const time_steps_output =
       post_processor_database.get("time_steps_between_output", 1);
+  // PropertyTreeInput profiling.memory_report
+  bool const memory_output = database.get("profiling.memory_report", false);
+  // PropertyTreeInput profiling.time_steps_between_memory_report
+  unsigned int const time_steps_memory_report =
+      database.get("profiling.time_steps_between_memory_report", 100);
+  std::unique_ptr<adamantine::MemoryReport> memory_report;
+  if (memory_output)
+  {
+    memory_report = std::make_unique<adamantine::MemoryReport>(
+        communicator, post_processor_database.get<std::string>(
+                          "filename_prefix") +
+                          ".memory.csv");
+  }
 
   // ----- Deposit material -----
   // For now assume that all ensemble members share the same geometry (they
   // have independent adamantine::Geometry objects, but all are constructed
   // from identical parameters), base new additions on the 0th ensemble member
+  // PropertyTreeInput geometry.deposition_time_window
+  double const deposition_time_window =
+      geometry_database.get("deposition_time_window", 0.);
+  double deposition_window_end = deposition_time_window > 0.
+                                     ? time + deposition_time_window
+                                     : std::numeric_limits<double>::max();
   auto [material_deposition_boxes, deposition_times, deposition_cos,
         deposition_sin] =
       adamantine::create_material_deposition_boxes<dim>(
-          geometry_database, heat_sources_ensemble[0]);
+          geometry_database, heat_sources_ensemble[0],
+          std::numeric_limits<double>::lowest(), deposition_window_end);
 
   // Unless we use an embedded method, we know in advance the time step.
 
   // Thus we can get for each time step, the list of elements that we will
-  // need to activate. This list will be invalidated every time we refine the
-  // mesh.
-  timers[adamantine::add_material_search].start();
+  // need to activate. The elements are only searched for the boxes deposited
+  // before the next refinement. This list will be invalidated every time we
+  // refine the mesh or move the deposition window.
   std::vector<std::vector<
       std::vector<typename dealii::DoFHandler<dim>::active_cell_iterator>>>
-      elements_to_activate_ensemble(ensemble_size);
-  for (unsigned int member = 0; member < ensemble_size; ++member)
-  {
-    elements_to_activate_ensemble[member] =
-        adamantine::get_elements_to_activate(
-            thermal_physics_ensemble[member]->get_dof_handler(),
-            material_deposition_boxes);
-  }
-  timers[adamantine::add_material_search].stop();
+      elements_to_activate_ensemble(local_ensemble_size);
+  std::ptrdiff_t searched_boxes_end = 0;
+  // The boxes deposited within activation_window of the end of the time step
+  // are activated at the same time. The boxes deposited before activated_time
+  // have already been activated.
+  // PropertyTreeInput geometry.activation_window
+  double const activation_window =
+      geometry_database.get("activation_window", 0.);
+  double activated_time = std::numeric_limits<double>::lowest();
+
+  // The search structure of the experimental points, the covariance sparsity
+  // pattern, and the observation covariance matrix are only rebuilt when the
+  // mesh or the number of observations change.
+  bool mesh_changed = true;
+  std::unique_ptr<adamantine::ExperimentToDofMapper<dim>> expt_to_dof_mapper;
+  dealii::SparsityPattern R_pattern;
+  dealii::SparseMatrix<double> R;
 
   // ----- Main time stepping loop -----
   if (rank == 0)
@@ -1644,20 +3078,42 @@ run_ensemble(MPI_Comm const &communicator,
     // ----- Refine the mesh if necessary -----
     // Refine the mesh after time_steps_refinement time steps or when time
     // is greater or equal than the next predicted time for refinement. This
-    // is necessary when using an embedded method.
-    if (((n_time_step % time_steps_refinement) == 0) ||
-        (time >= next_refinement_time))
+    // is necessary when using an embedded method. If beam_position_trigger is
+    // true, the mesh is only refined when a beam of one of the members gets
+    // close to the end of the refined corridor.
+    bool refine_now = ((n_time_step % time_steps_refinement) == 0) ||
+                      (time >= next_refinement_time);
+    if (beam_position_trigger)
+    {
+      refine_now = false;
+      for (unsigned int member = 0; member < local_ensemble_size; ++member)
+        refine_now = refine_now ||
+                     beams_near_corridor_end(heat_sources_ensemble[member],
+                                             time, time_step,
+                                             next_refinement_time,
+                                             refine_margin);
+      // All the groups need to refine their mesh at the same time.
+      if (n_groups > 1)
+      {
+        unsigned int const refine_group = refine_now ? 1 : 0;
+        refine_now =
+            dealii::Utilities::MPI::max(refine_group, communicator) == 1;
+      }
+    }
+    if (refine_now)
     {
       next_refinement_time = time + time_steps_refinement * time_step;
       timers[adamantine::refine].start();
 
-      for (unsigned int member = 0; member < ensemble_size; ++member)
+      for (unsigned int member = 0; member < local_ensemble_size; ++member)
       {
+        restore_member(member);
         refine_mesh(thermal_physics_ensemble[member],
                     *material_properties_ensemble[member],
                     solution_augmented_ensemble[member].block(base_state),
                     heat_sources_ensemble[member], time, next_refinement_time,
                     time_steps_refinement, refinement_database);
+        store_member(member);
       }
 
       timers[adamantine::refine].stop();
@@ -1666,48 +3122,105 @@ run_ensemble(MPI_Comm const &communicator,
                   << thermal_physics_ensemble[0]->get_dof_handler().n_dofs()
                   << std::endl;
 
-      // ----- Add material if necessary -----
-      timers[adamantine::add_material_search].start();
-      for (unsigned int member = 0; member < ensemble_size; ++member)
-      {
-        elements_to_activate_ensemble[member] =
-            adamantine::get_elements_to_activate(
-                thermal_physics_ensemble[member]->get_dof_handler(),
-                material_deposition_boxes);
+      for (unsigned int member = 0; member < local_ensemble_size; ++member)
         solution_augmented_ensemble[member].collect_sizes();
-      }
-      timers[adamantine::add_material_search].stop();
+
+      // The elements to activate need to be searched on the new mesh.
+      searched_boxes_end = 0;
+      mesh_changed = true;
     }
 
     // We use an epsilon to get the "expected" behavior when the deposition
     // time and the time match should match exactly but don't because of
     // floating point accuracy.
-    timers[adamantine::add_material_activate].start();
-
     double const eps = time_step / 1e12;
+
+    // Move the deposition window when the time step goes past its end. The
+    // boxes that have already been deposited are dropped.
+    if (time + time_step > deposition_window_end)
+    {
+      deposition_window_end = time + time_step + deposition_time_window;
+      timers[adamantine::add_material_search].start();
+      std::tie(material_deposition_boxes, deposition_times, deposition_cos,
+               deposition_sin) =
+          adamantine::create_material_deposition_boxes<dim>(
+              geometry_database, heat_sources_ensemble[0], time - eps,
+              deposition_window_end);
+      searched_boxes_end = 0;
+      timers[adamantine::add_material_search].stop();
+    }
+
+    // Like the deposition times, the events are given by the 0th member.
+    double const scheduled_time_step = time_step;
+    if (align_with_events)
+    {
+      time_step = limit_time_step_to_events(
+          heat_sources_ensemble[0], deposition_times, time, time_step);
+      if (n_groups > 1)
+        time_step = dealii::Utilities::MPI::min(time_step, communicator);
+    }
+
     auto activation_start =
         std::lower_bound(deposition_times.begin(), deposition_times.end(),
-                         time - eps) -
+                         std::max(time, activated_time) - eps) -
         deposition_times.begin();
     auto activation_end =
         std::lower_bound(deposition_times.begin(), deposition_times.end(),
                          time + time_step - eps) -
         deposition_times.begin();
+    if ((activation_window > 0.) && (activation_start < activation_end))
+    {
+      activated_time = activation_window_end(
+          time + time_step, activation_window, deposition_window_end);
+      activation_end =
+          std::lower_bound(deposition_times.begin(), deposition_times.end(),
+                           activated_time - eps) -
+          deposition_times.begin();
+    }
+
+    // ----- Add material if necessary -----
+    // Search the elements to activate for all the boxes deposited before the
+    // next refinement.
+    if (activation_end > searched_boxes_end)
+    {
+      timers[adamantine::add_material_search].start();
+      searched_boxes_end =
+          std::max(activation_end,
+                   std::lower_bound(deposition_times.begin(),
+                                    deposition_times.end(),
+                                    next_refinement_time - eps) -
+                       deposition_times.begin());
+      for (unsigned int member = 0; member < local_ensemble_size; ++member)
+      {
+        elements_to_activate_ensemble[member] =
+            adamantine::get_elements_to_activate(
+                thermal_physics_ensemble[member]->get_dof_handler(),
+                material_deposition_boxes, activation_start,
+                searched_boxes_end);
+      }
+      timers[adamantine::add_material_search].stop();
+    }
+
+    timers[adamantine::add_material_activate].start();
     if (activation_start < activation_end)
-      for (unsigned int member = 0; member < ensemble_size; ++member)
+      for (unsigned int member = 0; member < local_ensemble_size; ++member)
       {
         // For now assume that all deposited material has never been melted
         // (may or may not be reasonable)
         std::vector<bool> has_melted(deposition_cos.size(), false);
 
+        restore_member(member);
         thermal_physics_ensemble[member]->add_material(
             elements_to_activate_ensemble[member], deposition_cos,
             deposition_sin, has_melted, activation_start, activation_end,
-            new_material_temperature[member],
+            new_material_temperature[first_member + member],
             solution_augmented_ensemble[member].block(base_state));
 
         solution_augmented_ensemble[member].collect_sizes();
+        store_member(member);
       }
+    if (activation_start < activation_end)
+      mesh_changed = true;
 
     if ((rank == 0) && (verbose_output == true) &&
         (activation_end - activation_start > 0))
@@ -1729,11 +3242,13 @@ run_ensemble(MPI_Comm const &communicator,
 #endif
     timers[adamantine::evol_time].start();
 
-    for (unsigned int member = 0; member < ensemble_size; ++member)
+    for (unsigned int member = 0; member < local_ensemble_size; ++member)
     {
+      restore_member(member);
       time = thermal_physics_ensemble[member]->evolve_one_time_step(
           old_time, time_step,
           solution_augmented_ensemble[member].block(base_state), timers);
+      store_member(member);
     }
 
 #if ADAMANTINE_DEBUG
@@ -1745,15 +3260,25 @@ run_ensemble(MPI_Comm const &communicator,
     // ----- Get the new time step size -----
     // Needs to be the same for all ensemble members, obtained from the 0th
     // member
-    time_step = thermal_physics_ensemble[0]->get_delta_t_guess();
+    time_step = restore_scheduled_time_step(
+        thermal_physics_ensemble[0]->get_delta_t_guess(), scheduled_time_step,
+        time_step);
+    // The groups need to stay synchronized.
+    if (n_groups > 1)
+    {
+      time = dealii::Utilities::MPI::min(time, communicator);
+      time_step = dealii::Utilities::MPI::min(time_step, communicator);
+    }
 
     // ----- Perform data assimilation -----
     if (assimilate_data)
     {
-      for (unsigned int member = 0; member < ensemble_size; ++member)
+      for (unsigned int member = 0; member < local_ensemble_size; ++member)
       {
+        restore_member(member);
         thermal_physics_ensemble[member]->get_affine_constraints().distribute(
             solution_augmented_ensemble[member].block(base_state));
+        store_member(member);
       }
 
       // Currently assume that all frames are synced so that the 0th camera
@@ -1779,13 +3304,27 @@ run_ensemble(MPI_Comm const &communicator,
           std::cout << "Performing data assimilation at time " << time << "..."
                     << std::endl;
 
+        // The analysis needs all the members at once.
+        for (unsigned int member = 0; member < local_ensemble_size; ++member)
+          restore_member(member);
+
+        // Gather the members of all the groups. Every group then performs the
+        // same data assimilation on the whole ensemble.
+        std::vector<dealii::LA::distributed::BlockVector<double>>
+            gathered_augmented_ensemble;
+        if (n_groups > 1)
+          gathered_augmented_ensemble = gather_ensemble(
+              column_communicator, solution_augmented_ensemble);
+        auto &augmented_ensemble = n_groups > 1 ? gathered_augmented_ensemble
+                                                : solution_augmented_ensemble;
+
         // Print out the augmented parameters
         if (rank == 0)
         {
           for (unsigned int member = 0; member < ensemble_size; ++member)
           {
             std::cout << "Old parameters for member " << member << ": ";
-            for (auto param : solution_augmented_ensemble[member].block(1))
+            for (auto param : augmented_ensemble[member].block(1))
               std::cout << param << " ";
 
             std::cout << std::endl;
@@ -1796,11 +3335,16 @@ run_ensemble(MPI_Comm const &communicator,
 #ifdef ADAMANTINE_WITH_CALIPER
         CALI_MARK_BEGIN("da_experimental_data");
 #endif
+        if (mesh_changed)
+          experimental_data->mesh_changed();
         auto points_values = experimental_data->get_points_values();
         auto const &thermal_dof_handler =
             thermal_physics_ensemble[0]->get_dof_handler();
-        auto expt_to_dof_mapping = adamantine::get_expt_to_dof_mapping(
-            points_values, thermal_dof_handler);
+        if (mesh_changed)
+          expt_to_dof_mapper =
+              std::make_unique<adamantine::ExperimentToDofMapper<dim>>(
+                  thermal_dof_handler);
+        auto expt_to_dof_mapping = expt_to_dof_mapper->map(points_values);
         if (rank == 0)
         {
           std::cout << "Number expt sites mapped to DOFs: "
@@ -1824,25 +3368,22 @@ run_ensemble(MPI_Comm const &communicator,
               solution_augmented_ensemble[0].block(base_state));
           temperature_expt.add(1.0e10);
           adamantine::set_with_experimental_data(
-              communicator, points_values, expt_to_dof_mapping,
+              group_communicator, points_values, expt_to_dof_mapping,
               temperature_expt, verbose_output);
 
           thermal_physics_ensemble[0]->get_affine_constraints().distribute(
               temperature_expt);
-          post_processor_expt.write_thermal_output(
-              n_time_step, time, temperature_expt,
-              material_properties_ensemble[0]->get_state(),
-              material_properties_ensemble[0]->get_dofs_map(),
-              material_properties_ensemble[0]->get_dof_handler());
+          if (group == 0)
+            post_processor_expt.write_thermal_output(
+                n_time_step, time, temperature_expt,
+                material_properties_ensemble[0]->get_state(),
+                material_properties_ensemble[0]->get_dofs_map(),
+                material_properties_ensemble[0]->get_dof_handler());
         }
 
-        // NOTE: As is, this updates the dof mapping and covariance sparsity
-        // pattern for every data assimilation operation. Strictly, this is
-        // only necessary if the mesh changes (both updates) or the locations
-        // of observations changes (the dof mapping). In practice, changes to
-        // the mesh due to deposition likely cause the updates to be required
-        // for each operation. If this is a bottleneck, it can be fixed in the
-        // future.
+        // The observation matrix is only rebuilt by the DataAssimilator if the
+        // dof mapping has changed. The covariance sparsity pattern is only
+        // updated if the mesh has changed since the last data assimilation.
         timers[adamantine::da_dof_mapping].start();
 #ifdef ADAMANTINE_WITH_CALIPER
         CALI_MARK_BEGIN("da_dof_mapping");
@@ -1857,13 +3398,19 @@ run_ensemble(MPI_Comm const &communicator,
 #ifdef ADAMANTINE_WITH_CALIPER
         CALI_MARK_BEGIN("da_covariance_sparsity");
 #endif
-        data_assimilator.update_covariance_sparsity_pattern<dim>(
-            thermal_dof_handler,
-            solution_augmented_ensemble[0].block(augmented_state).size());
+        if (mesh_changed)
+        {
+          data_assimilator.update_covariance_sparsity_pattern<dim>(
+              thermal_dof_handler,
+              solution_augmented_ensemble[0].block(augmented_state).size());
+          mesh_changed = false;
+        }
+        data_assimilator.update_local_observations<dim>(group_communicator,
+                                                        points_values.points);
 #ifdef ADAMANTINE_WITH_CALIPER
         CALI_MARK_END("da_covariance_sparsity");
 #endif
-        timers[adamantine::da_covariance_sparsity].start();
+        timers[adamantine::da_covariance_sparsity].stop();
 
         unsigned int experimental_data_size = points_values.values.size();
 
@@ -1877,18 +3424,21 @@ run_ensemble(MPI_Comm const &communicator,
             "estimated_uncertainty", 0.0);
         variance_entries = variance_entries * variance_entries;
 
-        dealii::SparsityPattern pattern(experimental_data_size,
-                                        experimental_data_size, 1);
-        for (unsigned int i = 0; i < experimental_data_size; ++i)
+        if (R.empty() || (R.m() != experimental_data_size))
         {
-          pattern.add(i, i);
-        }
-        pattern.compress();
+          R.clear();
+          R_pattern.reinit(experimental_data_size, experimental_data_size, 1);
+          for (unsigned int i = 0; i < experimental_data_size; ++i)
+          {
+            R_pattern.add(i, i);
+          }
+          R_pattern.compress();
 
-        dealii::SparseMatrix<double> R(pattern);
-        for (unsigned int i = 0; i < experimental_data_size; ++i)
-        {
-          R.add(i, i, variance_entries);
+          R.reinit(R_pattern);
+          for (unsigned int i = 0; i < experimental_data_size; ++i)
+          {
+            R.add(i, i, variance_entries);
+          }
         }
 #ifdef ADAMANTINE_WITH_CALIPER
         CALI_MARK_END("da_obs_covariance");
@@ -1900,15 +3450,18 @@ run_ensemble(MPI_Comm const &communicator,
 #ifdef ADAMANTINE_WITH_CALIPER
         CALI_MARK_BEGIN("da_update_ensemble");
 #endif
-        data_assimilator.update_ensemble(
-            communicator, solution_augmented_ensemble, points_values.values, R);
+        data_assimilator.update_ensemble(group_communicator, augmented_ensemble,
+                                         points_values.values, R);
+        if (n_groups > 1)
+          scatter_ensemble(gathered_augmented_ensemble, first_member,
+                           solution_augmented_ensemble);
 #ifdef ADAMANTINE_WITH_CALIPER
         CALI_MARK_END("da_update_ensemble");
 #endif
         timers[adamantine::da_update_ensemble].stop();
 
         // Extract the parameters from the augmented state
-        for (unsigned int member = 0; member < ensemble_size; ++member)
+        for (unsigned int member = 0; member < local_ensemble_size; ++member)
         {
           for (unsigned int index = 0;
                index < augmented_state_parameters.size(); ++index)
@@ -1944,16 +3497,19 @@ run_ensemble(MPI_Comm const &communicator,
           for (unsigned int member = 0; member < ensemble_size; ++member)
           {
             std::cout << "New parameters for member " << member << ": ";
-            for (auto param : solution_augmented_ensemble[member].block(1))
+            for (auto param : augmented_ensemble[member].block(1))
               std::cout << param << " ";
 
             std::cout << std::endl;
           }
         }
+
+        for (unsigned int member = 0; member < local_ensemble_size; ++member)
+          store_member(member);
       }
 
       // Update the heat source in the ThermalPhysics objects
-      for (unsigned int member = 0; member < ensemble_size; ++member)
+      for (unsigned int member = 0; member < local_ensemble_size; ++member)
       {
         thermal_physics_ensemble[member]->update_physics_parameters(
             database_ensemble[member].get_child("sources"));
@@ -1976,15 +3532,44 @@ run_ensemble(MPI_Comm const &communicator,
     // ----- Output the solution -----
     if (n_time_step % time_steps_output == 0)
     {
-      for (unsigned int member = 0; member < ensemble_size; ++member)
+      for (unsigned int member = 0; member < local_ensemble_size; ++member)
       {
         thermal_physics_ensemble[member]->set_state_to_material_properties();
+        restore_member(member);
         output_pvtu(*post_processor_ensemble[member], n_time_step, time,
                     thermal_physics_ensemble[member],
                     solution_augmented_ensemble[member].block(base_state),
                     mechanical_physics, displacement,
                     *material_properties_ensemble[member], timers);
+        store_member(member);
+      }
+    }
+
+    // ----- Write the memory used by each subsystem -----
+    // The entries of the ensemble members owned by a processor are summed.
+    if (memory_output && (n_time_step % time_steps_memory_report == 0))
+    {
+      for (unsigned int member = 0; member < local_ensemble_size; ++member)
+      {
+        add_memory_consumption(
+            *memory_report, geometry_ensemble[member]->get_triangulation(),
+            *material_properties_ensemble[member],
+            thermal_physics_ensemble[member],
+            elements_to_activate_ensemble[member]);
+        memory_report->add(
+            "ensemble_solution",
+            solution_augmented_ensemble[member].memory_consumption());
+        if (single_precision_storage)
+          memory_report->add("ensemble_solution",
+                             stored_ensemble[member].memory_consumption());
       }
+      add_deposition_memory_consumption(*memory_report,
+                                        material_deposition_boxes,
+                                        deposition_times, deposition_cos,
+                                        deposition_sin);
+      memory_report->add("data_assimilator",
+                         data_assimilator.memory_consumption());
+      memory_report->write(n_time_step, time);
     }
 
     ++n_time_step;
@@ -1994,15 +3579,22 @@ run_ensemble(MPI_Comm const &communicator,
   CALI_CXX_MARK_LOOP_END(main_loop_id);
 #endif
 
-  for (unsigned int member = 0; member < ensemble_size; ++member)
+  for (unsigned int member = 0; member < local_ensemble_size; ++member)
   {
     post_processor_ensemble[member]->write_pvd();
+    restore_member(member);
   }
 
-  // This is only used for integration test
+  // The group communicator is not freed because it is used by the returned
+  // solution.
+  if (n_groups > 1)
+    MPI_Comm_free(&column_communicator);
+
+  // This is only used for integration test. When the ensemble is distributed
+  // between groups, only the members of the group are returned.
   if constexpr (std::is_same_v<MemorySpaceType, dealii::MemorySpace::Host>)
   {
-    for (unsigned int member = 0; member < ensemble_size; ++member)
+    for (unsigned int member = 0; member < local_ensemble_size; ++member)
     {
       thermal_physics_ensemble[member]->get_affine_constraints().distribute(
           solution_augmented_ensemble[member].block(base_state));
@@ -2014,9 +3606,9 @@ run_ensemble(MPI_Comm const &communicator,
     // NOTE: Currently unused. Added for the future case where run_ensemble is
     // functional on the device.
     std::vector<dealii::LA::distributed::BlockVector<double>>
-        solution_augmented_ensemble_host(ensemble_size);
+        solution_augmented_ensemble_host(local_ensemble_size);
 
-    for (unsigned int member = 0; member < ensemble_size; ++member)
+    for (unsigned int member = 0; member < local_ensemble_size; ++member)
     {
       solution_augmented_ensemble[member].reinit(2);
 
@@ -2040,4 +3632,105 @@ run_ensemble(MPI_Comm const &communicator,
     return solution_augmented_ensemble_host;
   }
 }
+
+/**
+ * Put the leaves of @p overrides in @p database. The keys of @p overrides can
+ * be nested trees or dotted paths.
+ */
+inline void apply_batch_overrides(boost::property_tree::ptree &database,
+                                  boost::property_tree::ptree const &overrides,
+                                  std::string const &path = "")
+{
+  for (auto const &[key, value] : overrides)
+  {
+    std::string const full_path = path.empty() ? key : path + "." + key;
+    if (value.empty())
+      database.put(full_path, value.data());
+    else
+      apply_batch_overrides(database, value, full_path);
+  }
+}
+
+/**
+ * Run all the cases of the batch file one after the other in the same
+ * process. Each case is the base input modified by a set of overrides. MPI,
+ * Kokkos, and the profiling tools are initialized once and the geometry, the
+ * material deposition, and the scan paths are read from the preprocessing
+ * cache. The wall time and the temperature of each case are appended to
+ * filename_prefix.batch.csv.
+ */
+template <int dim, typename MemorySpaceType>
+void run_batch(MPI_Comm const &communicator,
+               boost::property_tree::ptree const &database,
+               std::vector<adamantine::Timer> &timers)
+{
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_CXX_MARK_FUNCTION;
+#endif
+
+  unsigned int const rank =
+      dealii::Utilities::MPI::this_mpi_process(communicator);
+
+  // PropertyTreeInput batch.cases_file
+  std::string const cases_filename =
+      database.get<std::string>("batch.cases_file");
+  adamantine::wait_for_file(cases_filename,
+                            "Waiting for batch file: " + cases_filename);
+  boost::property_tree::ptree cases_database;
+  boost::property_tree::info_parser::read_info(cases_filename, cases_database);
+
+  // The base input is shared by all the cases. The preprocessing cache is
+  // always used so that only the first case reads the mesh, the material
+  // deposition, and the scan paths.
+  boost::property_tree::ptree base_database = database;
+  base_database.erase("batch");
+  // PropertyTreeInput post_processor.filename_prefix
+  std::string const filename_prefix =
+      base_database.get<std::string>("post_processor.filename_prefix");
+  if (base_database.count("preprocessing_cache") == 0)
+    base_database.put("preprocessing_cache.directory",
+                      filename_prefix + ".batch_cache");
+  // PropertyTreeInput checkpoint.filename_prefix
+  boost::optional<std::string> checkpoint_prefix =
+      base_database.get_optional<std::string>("checkpoint.filename_prefix");
+
+  std::string const results_filename = filename_prefix + ".batch.csv";
+  if (rank == 0)
+  {
+    std::ofstream results_file(results_filename);
+    results_file << "case,wall_time,max_temperature,mean_temperature\n";
+  }
+
+  for (auto const &[case_name, overrides] : cases_database)
+  {
+    if (rank == 0)
+      std::cout << "Starting batch case " << case_name << std::endl;
+
+    // Each case writes its own files.
+    boost::property_tree::ptree case_database = base_database;
+    case_database.put("post_processor.filename_prefix",
+                      filename_prefix + "." + case_name);
+    if (checkpoint_prefix)
+      case_database.put("checkpoint.filename_prefix",
+                        checkpoint_prefix.get() + "." + case_name);
+    apply_batch_overrides(case_database, overrides);
+    adamantine::validate_input_database(case_database);
+    adamantine::use_preprocessing_cache(communicator, case_database);
+
+    auto const start = std::chrono::steady_clock::now();
+    auto const solution =
+        run<dim, MemorySpaceType>(communicator, case_database, timers);
+    std::chrono::duration<double> const wall_time =
+        std::chrono::steady_clock::now() - start;
+
+    double const max_temperature = solution.first.linfty_norm();
+    double const mean_temperature = solution.first.mean_value();
+    if (rank == 0)
+    {
+      std::ofstream results_file(results_filename, std::ios::app);
+      results_file << case_name << "," << wall_time.count() << ","
+                   << max_temperature << "," << mean_temperature << "\n";
+    }
+  }
+}
 #endif
@@ -0,0 +1,37 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <ScanPath.hh>
+
+#include <exception>
+#include <iostream>
+
+// Convert a scan path file in the segment or the event_series format to the
+// binary format. The binary file uses the endianness of the machine.
+int main(int argc, char *argv[])
+{
+  if (argc != 4)
+  {
+    std::cerr << "Usage: " << argv[0]
+              << " scan_path_file segment|event_series binary_scan_path_file"
+              << std::endl;
+    return 1;
+  }
+
+  try
+  {
+    adamantine::ScanPath scan_path(argv[1], argv[2]);
+    scan_path.write_binary_scan_path(argv[3]);
+  }
+  catch (std::exception &exception)
+  {
+    std::cerr << exception.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,91 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <DataAssimilator.hh>
+#include <Geometry.hh>
+
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/lac/sparsity_pattern.h>
+
+#include <random>
+
+#include "benchmark_setup.hh"
+
+void update_ensemble(benchmark::State &state, std::string const &method)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  adamantine::Geometry<2> geometry(communicator,
+                                   geometry_database<2>(state.range(0)));
+  dealii::FE_Q<2> fe(1);
+  dealii::DoFHandler<2> dof_handler(geometry.get_triangulation());
+  dof_handler.distribute_dofs(fe);
+  unsigned int const n_dofs = dof_handler.n_dofs();
+
+  // Every tenth dof is observed.
+  unsigned int const n_members = state.range(1);
+  unsigned int const expt_size = n_dofs / 10;
+  std::pair<std::vector<int>, std::vector<int>> expt_to_dof_mapping;
+  for (unsigned int i = 0; i < expt_size; ++i)
+  {
+    expt_to_dof_mapping.first.push_back(i);
+    expt_to_dof_mapping.second.push_back(10 * i);
+  }
+  std::vector<double> expt_data(expt_size, 310.);
+
+  dealii::SparsityPattern pattern(expt_size, expt_size, 1);
+  for (unsigned int i = 0; i < expt_size; ++i)
+    pattern.add(i, i);
+  pattern.compress();
+  dealii::SparseMatrix<double> R(pattern);
+  for (unsigned int i = 0; i < expt_size; ++i)
+    R.set(i, i, 1.);
+
+  boost::property_tree::ptree database;
+  database.put("method", method);
+  database.put("localization_cutoff_distance", 1e-3);
+  database.put("localization_cutoff_function", "gaspari_cohn");
+  adamantine::DataAssimilator data_assimilator(database);
+  data_assimilator.update_covariance_sparsity_pattern<2>(dof_handler, 0);
+  data_assimilator.update_dof_mapping<2>(expt_to_dof_mapping);
+
+  std::mt19937 generator(0);
+  std::normal_distribution<double> distribution(300., 5.);
+  std::vector<dealii::LA::distributed::BlockVector<double>> ensemble(
+      n_members);
+  for (auto &member : ensemble)
+  {
+    member.reinit(2);
+    member.block(0).reinit(n_dofs);
+    member.collect_sizes();
+  }
+
+  for (auto _ : state)
+  {
+    // The ensemble is reset so that every iteration does the same work.
+    state.PauseTiming();
+    for (auto &member : ensemble)
+      for (unsigned int i = 0; i < n_dofs; ++i)
+        member.block(0)[i] = distribution(generator);
+    state.ResumeTiming();
+
+    data_assimilator.update_ensemble(communicator, ensemble, expt_data, R);
+  }
+
+  // Each member is read and written.
+  set_throughput(state, static_cast<double>(n_dofs) * n_members,
+                 2 * sizeof(double));
+}
+
+BENCHMARK_CAPTURE(update_ensemble, enkf, std::string("enkf"))
+    ->Args({32, 10})
+    ->Args({64, 50});
+BENCHMARK_CAPTURE(update_ensemble, etkf, std::string("etkf"))
+    ->Args({32, 10})
+    ->Args({64, 50});
+
+#include "main.cc"
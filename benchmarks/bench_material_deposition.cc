@@ -0,0 +1,69 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <Geometry.hh>
+#include <material_deposition.hh>
+
+#include <deal.II/fe/fe_nothing.h>
+#include <deal.II/fe/fe_q.h>
+
+#include "benchmark_setup.hh"
+
+template <int dim>
+void elements_to_activate(benchmark::State &state)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  unsigned int const n_divisions = state.range(0);
+  auto const database = geometry_database<dim>(n_divisions);
+  adamantine::Geometry<dim> geometry(communicator, database);
+  dealii::hp::FECollection<dim> fe_collection;
+  fe_collection.push_back(dealii::FE_Q<dim>(1));
+  fe_collection.push_back(dealii::FE_Nothing<dim>());
+  dealii::DoFHandler<dim> dof_handler(geometry.get_triangulation());
+  dof_handler.distribute_dofs(fe_collection);
+
+  // One box per cell of the top layer of the domain.
+  double const length = database.get<double>("length");
+  double const height = database.get<double>("height");
+  double const width = (dim == 3) ? database.get<double>("width") : 0.;
+  double const dx = length / n_divisions;
+  double const dz = height / n_divisions;
+  double const dy = width / n_divisions;
+  std::vector<dealii::BoundingBox<dim>> boxes;
+  unsigned int const n_y = (dim == 3) ? n_divisions : 1;
+  for (unsigned int j = 0; j < n_y; ++j)
+    for (unsigned int i = 0; i < n_divisions; ++i)
+    {
+      dealii::Point<dim> min_point;
+      dealii::Point<dim> max_point;
+      min_point[0] = i * dx;
+      max_point[0] = (i + 1) * dx;
+      min_point[dim - 1] = height - dz;
+      max_point[dim - 1] = height;
+      if constexpr (dim == 3)
+      {
+        min_point[1] = j * dy;
+        max_point[1] = (j + 1) * dy;
+      }
+      boxes.emplace_back(std::make_pair(min_point, max_point));
+    }
+
+  for (auto _ : state)
+  {
+    auto elements = adamantine::get_elements_to_activate(dof_handler, boxes);
+    benchmark::DoNotOptimize(elements.data());
+  }
+  state.SetItemsProcessed(state.iterations() * boxes.size());
+  state.counters["cells"] =
+      geometry.get_triangulation().n_global_active_cells();
+}
+
+BENCHMARK_TEMPLATE(elements_to_activate, 2)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(elements_to_activate, 3)->Arg(16)->Arg(32);
+
+#include "main.cc"
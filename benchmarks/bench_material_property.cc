@@ -0,0 +1,54 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <Geometry.hh>
+#include <MaterialProperty.hh>
+
+#include <deal.II/fe/fe_q.h>
+
+#include "benchmark_setup.hh"
+
+template <int dim, int fe_degree>
+void material_property_update(benchmark::State &state)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  adamantine::Geometry<dim> geometry(communicator,
+                                     geometry_database<dim>(state.range(0)));
+  auto const &triangulation = geometry.get_triangulation();
+  for (auto cell : triangulation.cell_iterators())
+  {
+    cell->set_material_id(0);
+    cell->set_user_index(static_cast<int>(adamantine::MaterialState::powder));
+  }
+  adamantine::MaterialProperty<dim, dealii::MemorySpace::Host>
+      material_properties(communicator, triangulation,
+                          material_property_database());
+
+  dealii::FE_Q<dim> fe(fe_degree);
+  dealii::DoFHandler<dim> dof_handler(triangulation);
+  dof_handler.distribute_dofs(fe);
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+      temperature(dof_handler.locally_owned_dofs(), communicator);
+  // Half of the domain is in the mushy zone.
+  for (unsigned int i = 0; i < temperature.locally_owned_size(); ++i)
+    temperature.local_element(i) = (i % 2 == 0) ? 300. : 1690.;
+
+  for (auto _ : state)
+    material_properties.update(dof_handler, temperature);
+
+  // The temperature is read and the ratio of each state is written.
+  set_throughput(state, dof_handler.n_dofs(),
+                 (1 + adamantine::g_n_material_states) * sizeof(double));
+}
+
+BENCHMARK_TEMPLATE(material_property_update, 2, 1)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(material_property_update, 2, 2)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(material_property_update, 3, 1)->Arg(16)->Arg(32);
+BENCHMARK_TEMPLATE(material_property_update, 3, 2)->Arg(16)->Arg(32);
+
+#include "main.cc"
@@ -0,0 +1,77 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include "../application/adamantine.hh"
+
+#include "benchmark_setup.hh"
+
+using Host = dealii::MemorySpace::Host;
+
+template <int dim>
+void mesh_refine_and_transfer(benchmark::State &state)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  adamantine::Geometry<dim> geometry(communicator,
+                                     geometry_database<dim>(state.range(0)));
+  adamantine::MaterialProperty<dim, Host> material_properties(
+      communicator, geometry.get_triangulation(),
+      material_property_database());
+
+  boost::property_tree::ptree database;
+  database.put("sources.n_beams", 1);
+  database.put("sources.beam_0.type", "goldak");
+  database.put("sources.beam_0.depth", 1e-3);
+  database.put("sources.beam_0.diameter", 2e-3);
+  database.put("sources.beam_0.max_power", 1200.);
+  database.put("sources.beam_0.absorption_efficiency", 0.3);
+  database.put("sources.beam_0.scan_path_file", "scan_path.txt");
+  database.put("sources.beam_0.scan_path_file_format", "segment");
+  database.put("boundary.type", "adiabatic");
+  database.put("time_stepping.method", "forward_euler");
+  std::unique_ptr<adamantine::ThermalPhysicsInterface<dim, Host>>
+      thermal_physics = initialize<dim, 2, Host, dealii::QGauss<1>>(
+          communicator, database, geometry, material_properties);
+  thermal_physics->setup_dofs();
+  thermal_physics->update_material_deposition_orientation();
+  thermal_physics->compute_inverse_mass_matrix();
+  dealii::LA::distributed::Vector<double, Host> solution;
+  thermal_physics->initialize_dof_vector(300., solution);
+  thermal_physics->get_state_from_material_properties();
+
+  dealii::DoFHandler<dim> &dof_handler = thermal_physics->get_dof_handler();
+  double const n_dofs = dof_handler.n_dofs();
+  double const half_length = 6e-3;
+  for (auto _ : state)
+  {
+    // Refine the left half of the domain and coarsen it back.
+    for (auto const &cell : dealii::filter_iterators(
+             dof_handler.active_cell_iterators(),
+             dealii::IteratorFilters::LocallyOwnedCell()))
+      if (cell->center()[0] < half_length)
+        cell->set_refine_flag();
+    refine_and_transfer(thermal_physics, material_properties, dof_handler,
+                        solution);
+
+    for (auto const &cell : dealii::filter_iterators(
+             dof_handler.active_cell_iterators(),
+             dealii::IteratorFilters::LocallyOwnedCell()))
+      if (cell->level() > 0)
+        cell->set_coarsen_flag();
+    refine_and_transfer(thermal_physics, material_properties, dof_handler,
+                        solution);
+  }
+
+  // The solution and the material states are read and written twice.
+  set_throughput(state, n_dofs,
+                 4 * (1 + adamantine::g_n_material_states) * sizeof(double));
+}
+
+BENCHMARK_TEMPLATE(mesh_refine_and_transfer, 2)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(mesh_refine_and_transfer, 3)->Arg(8)->Arg(16);
+
+#include "main.cc"
@@ -0,0 +1,56 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <ScanPath.hh>
+
+#include <fstream>
+
+#include "benchmark_setup.hh"
+
+/**
+ * Write a raster scan path made of @p n_segments lines and return the name of
+ * the file.
+ */
+std::string write_raster_scan_path(unsigned int n_segments)
+{
+  std::string const filename =
+      "bench_scan_path_" + std::to_string(n_segments) + ".txt";
+  std::ofstream file(filename);
+  file << "Number of path segments\n" << n_segments + 1 << "\n";
+  file << "Mode x y z pmod param\n";
+  file << "1 0 0 0 0 1e-6\n";
+  for (unsigned int i = 0; i < n_segments; ++i)
+  {
+    double const x = (i % 2 == 0) ? 0.01 : 0.;
+    double const y = (i + 1) * 1e-4;
+    file << "0 " << x << " " << y << " 0 1 0.8\n";
+  }
+
+  return filename;
+}
+
+void scan_path_value(benchmark::State &state)
+{
+  unsigned int const n_segments = state.range(0);
+  adamantine::ScanPath scan_path(write_raster_scan_path(n_segments),
+                                 "segment");
+  double const end_time = scan_path.get_segment_list().back().end_time;
+
+  // The times are increasing like during a simulation.
+  unsigned int const n_evaluations = 1000;
+  double const dt = end_time / n_evaluations;
+  for (auto _ : state)
+  {
+    for (unsigned int i = 0; i < n_evaluations; ++i)
+      benchmark::DoNotOptimize(scan_path.value(i * dt));
+  }
+  state.SetItemsProcessed(state.iterations() * n_evaluations);
+}
+
+BENCHMARK(scan_path_value)->Arg(10)->Arg(1000)->Arg(100000);
+
+#include "main.cc"
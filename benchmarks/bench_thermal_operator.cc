@@ -0,0 +1,137 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <Geometry.hh>
+#include <MaterialProperty.hh>
+#include <ThermalOperator.hh>
+
+#include <deal.II/base/quadrature_lib.h>
+#include <deal.II/fe/fe_nothing.h>
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/matrix_free/fe_evaluation.h>
+
+#include "benchmark_setup.hh"
+
+using Host = dealii::MemorySpace::Host;
+
+/**
+ * Build the ThermalOperator of a box divided in state.range(0) cells along
+ * each axis and call @p kernel with it.
+ */
+template <int dim, int fe_degree, typename Kernel>
+void run_thermal_operator(benchmark::State &state, Kernel kernel)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  adamantine::Geometry<dim> geometry(communicator,
+                                     geometry_database<dim>(state.range(0)));
+  dealii::hp::FECollection<dim> fe_collection;
+  fe_collection.push_back(dealii::FE_Q<dim>(fe_degree));
+  fe_collection.push_back(dealii::FE_Nothing<dim>());
+  dealii::DoFHandler<dim> dof_handler(geometry.get_triangulation());
+  dof_handler.distribute_dofs(fe_collection);
+  dealii::AffineConstraints<double> affine_constraints;
+  affine_constraints.close();
+  dealii::hp::QCollection<1> q_collection;
+  q_collection.push_back(dealii::QGauss<1>(fe_degree + 1));
+  q_collection.push_back(dealii::QGauss<1>(1));
+
+  adamantine::MaterialProperty<dim, Host> material_properties(
+      communicator, geometry.get_triangulation(),
+      material_property_database());
+  auto heat_sources = goldak_heat_sources<dim>();
+
+  adamantine::ThermalOperator<dim, fe_degree, Host> thermal_operator(
+      communicator, adamantine::BoundaryType::adiabatic, material_properties,
+      heat_sources);
+  unsigned int const n_cells =
+      geometry.get_triangulation().n_locally_owned_active_cells();
+  std::vector<double> deposition_cos(n_cells, 1.);
+  std::vector<double> deposition_sin(n_cells, 0.);
+  thermal_operator.reinit(dof_handler, affine_constraints, q_collection);
+  thermal_operator.set_material_deposition_orientation(deposition_cos,
+                                                       deposition_sin);
+  thermal_operator.compute_inverse_mass_matrix(dof_handler, affine_constraints);
+  thermal_operator.get_state_from_material_properties();
+
+  kernel(thermal_operator, heat_sources);
+}
+
+template <int dim, int fe_degree>
+void thermal_operator_vmult(benchmark::State &state)
+{
+  run_thermal_operator<dim, fe_degree>(
+      state, [&](auto &thermal_operator, auto const &)
+      {
+        dealii::LA::distributed::Vector<double, Host> src;
+        dealii::LA::distributed::Vector<double, Host> dst;
+        thermal_operator.initialize_dof_vector(src);
+        thermal_operator.initialize_dof_vector(dst);
+        src = 300.;
+
+        for (auto _ : state)
+        {
+          thermal_operator.vmult(dst, src);
+          benchmark::DoNotOptimize(dst.begin());
+          benchmark::ClobberMemory();
+        }
+
+        // src is read, dst is written, and the inverse of the mass matrix is
+        // read.
+        set_throughput(state, thermal_operator.m(), 3 * sizeof(double));
+      });
+}
+
+template <int dim, int fe_degree>
+void heat_source_assembly(benchmark::State &state)
+{
+  run_thermal_operator<dim, fe_degree>(
+      state,
+      [&](auto &thermal_operator, auto const &heat_sources)
+      {
+        // Evaluate the heat source at all the quadrature points as done when
+        // the right-hand side is assembled.
+        auto const &matrix_free = thermal_operator.get_matrix_free();
+        auto const cell_range = matrix_free.create_cell_subrange_hp_by_index(
+            std::make_pair(0u, matrix_free.n_cell_batches()), 0);
+        dealii::FEEvaluation<dim, fe_degree, fe_degree + 1, 1, double> fe_eval(
+            matrix_free);
+        double const height =
+            heat_sources[0]->get_scan_path().value(0.)[dim - 1];
+        heat_sources[0]->update_time(1e-3);
+
+        for (auto _ : state)
+        {
+          dealii::VectorizedArray<double> sum = 0.;
+          for (unsigned int cell = cell_range.first; cell < cell_range.second;
+               ++cell)
+          {
+            fe_eval.reinit(cell);
+            for (unsigned int q = 0; q < fe_eval.n_q_points; ++q)
+              sum += heat_sources[0]->value(fe_eval.quadrature_point(q),
+                                            height);
+          }
+          benchmark::DoNotOptimize(sum);
+        }
+
+        // The coordinates of the quadrature points are read.
+        set_throughput(state, thermal_operator.m(), dim * sizeof(double));
+      });
+}
+
+BENCHMARK_TEMPLATE(thermal_operator_vmult, 2, 1)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(thermal_operator_vmult, 2, 2)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(thermal_operator_vmult, 2, 3)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(thermal_operator_vmult, 2, 4)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(thermal_operator_vmult, 3, 1)->Arg(16)->Arg(32);
+BENCHMARK_TEMPLATE(thermal_operator_vmult, 3, 2)->Arg(16)->Arg(32);
+BENCHMARK_TEMPLATE(thermal_operator_vmult, 3, 3)->Arg(16)->Arg(32);
+BENCHMARK_TEMPLATE(thermal_operator_vmult, 3, 4)->Arg(16)->Arg(32);
+BENCHMARK_TEMPLATE(heat_source_assembly, 2, 2)->Arg(256);
+BENCHMARK_TEMPLATE(heat_source_assembly, 3, 2)->Arg(32);
+
+#include "main.cc"
@@ -0,0 +1,83 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <Geometry.hh>
+#include <MaterialProperty.hh>
+#include <ThermalOperatorDevice.hh>
+
+#include <deal.II/base/quadrature_lib.h>
+#include <deal.II/fe/fe_nothing.h>
+#include <deal.II/fe/fe_q.h>
+
+#include "benchmark_setup.hh"
+
+using Device = dealii::MemorySpace::CUDA;
+
+template <int dim, int fe_degree>
+void thermal_operator_device_vmult(benchmark::State &state)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  adamantine::Geometry<dim> geometry(communicator,
+                                     geometry_database<dim>(state.range(0)));
+  dealii::hp::FECollection<dim> fe_collection;
+  fe_collection.push_back(dealii::FE_Q<dim>(fe_degree));
+  fe_collection.push_back(dealii::FE_Nothing<dim>());
+  dealii::DoFHandler<dim> dof_handler(geometry.get_triangulation());
+  dof_handler.distribute_dofs(fe_collection);
+  dealii::AffineConstraints<double> affine_constraints;
+  affine_constraints.close();
+  dealii::hp::QCollection<1> q_collection;
+  q_collection.push_back(dealii::QGauss<1>(fe_degree + 1));
+  q_collection.push_back(dealii::QGauss<1>(1));
+
+  adamantine::MaterialProperty<dim, Device> material_properties(
+      communicator, geometry.get_triangulation(),
+      material_property_database());
+
+  std::vector<std::shared_ptr<adamantine::HeatSource<dim>>> heat_sources;
+  adamantine::ThermalOperatorDevice<dim, fe_degree, Device> thermal_operator(
+      communicator, adamantine::BoundaryType::adiabatic, material_properties,
+      heat_sources);
+  thermal_operator.compute_inverse_mass_matrix(dof_handler, affine_constraints);
+  unsigned int const n_cells =
+      geometry.get_triangulation().n_locally_owned_active_cells();
+  std::vector<double> deposition_cos(n_cells, 1.);
+  std::vector<double> deposition_sin(n_cells, 0.);
+  thermal_operator.reinit(dof_handler, affine_constraints, q_collection);
+  thermal_operator.set_material_deposition_orientation(deposition_cos,
+                                                       deposition_sin);
+  thermal_operator.get_state_from_material_properties();
+
+  dealii::LA::distributed::Vector<double, Device> src;
+  dealii::LA::distributed::Vector<double, Device> dst;
+  auto const &matrix_free = thermal_operator.get_matrix_free();
+  matrix_free.initialize_dof_vector(src);
+  matrix_free.initialize_dof_vector(dst);
+  src = 300.;
+
+  for (auto _ : state)
+  {
+    thermal_operator.vmult(dst, src);
+    // The kernels are asynchronous
+    cudaDeviceSynchronize();
+  }
+
+  // src is read, dst is written, and the inverse of the mass matrix is read.
+  set_throughput(state, thermal_operator.m(), 3 * sizeof(double));
+}
+
+BENCHMARK_TEMPLATE(thermal_operator_device_vmult, 2, 1)->Arg(256)->Arg(1024);
+BENCHMARK_TEMPLATE(thermal_operator_device_vmult, 2, 2)->Arg(256)->Arg(1024);
+BENCHMARK_TEMPLATE(thermal_operator_device_vmult, 2, 3)->Arg(256)->Arg(1024);
+BENCHMARK_TEMPLATE(thermal_operator_device_vmult, 2, 4)->Arg(256)->Arg(1024);
+BENCHMARK_TEMPLATE(thermal_operator_device_vmult, 3, 1)->Arg(32)->Arg(64);
+BENCHMARK_TEMPLATE(thermal_operator_device_vmult, 3, 2)->Arg(32)->Arg(64);
+BENCHMARK_TEMPLATE(thermal_operator_device_vmult, 3, 3)->Arg(32)->Arg(64);
+BENCHMARK_TEMPLATE(thermal_operator_device_vmult, 3, 4)->Arg(32)->Arg(64);
+
+#include "main.cc"
@@ -0,0 +1,102 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef BENCHMARK_SETUP_HH
+#define BENCHMARK_SETUP_HH
+
+#include <GoldakHeatSource.hh>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Return the database of a box divided in @p n_divisions cells along each
+ * axis.
+ */
+template <int dim>
+boost::property_tree::ptree geometry_database(unsigned int n_divisions)
+{
+  boost::property_tree::ptree database;
+  database.put("import_mesh", false);
+  database.put("length", 12e-3);
+  database.put("length_divisions", n_divisions);
+  database.put("height", 6e-3);
+  database.put("height_divisions", n_divisions);
+  if constexpr (dim == 3)
+  {
+    database.put("width", 12e-3);
+    database.put("width_divisions", n_divisions);
+  }
+
+  return database;
+}
+
+/**
+ * Return the database of a single material with a phase change so that the
+ * update of the material states is not trivial.
+ */
+inline boost::property_tree::ptree material_property_database()
+{
+  boost::property_tree::ptree database;
+  database.put("property_format", "polynomial");
+  database.put("n_materials", 1);
+  for (std::string state : {"solid", "powder", "liquid"})
+  {
+    std::string const prefix = "material_0." + state;
+    database.put(prefix + ".density", 7904.);
+    database.put(prefix + ".specific_heat", 714.);
+    database.put(prefix + ".thermal_conductivity_x", 31.4);
+    database.put(prefix + ".thermal_conductivity_y", 31.4);
+    database.put(prefix + ".thermal_conductivity_z", 31.4);
+  }
+  database.put("material_0.solidus", 1675.);
+  database.put("material_0.liquidus", 1708.);
+  database.put("material_0.latent_heat", 290000.);
+
+  return database;
+}
+
+/**
+ * Return a Goldak heat source following @p scan_path_file.
+ */
+template <int dim>
+std::vector<std::shared_ptr<adamantine::HeatSource<dim>>>
+goldak_heat_sources(std::string const &scan_path_file = "scan_path.txt")
+{
+  boost::property_tree::ptree database;
+  database.put("depth", 1e-3);
+  database.put("absorption_efficiency", 0.3);
+  database.put("diameter", 2e-3);
+  database.put("max_power", 1200.);
+  database.put("scan_path_file", scan_path_file);
+  database.put("scan_path_file_format", "segment");
+  std::vector<std::shared_ptr<adamantine::HeatSource<dim>>> heat_sources = {
+      std::make_shared<adamantine::GoldakHeatSource<dim>>(database)};
+
+  return heat_sources;
+}
+
+/**
+ * Add the throughput counters to @p state. @p n_dofs is the number of dofs
+ * processed by one iteration and @p bytes_per_dof is an estimate of the memory
+ * traffic per dof. The effective bandwidth is reported as bytes_per_second.
+ */
+inline void set_throughput(benchmark::State &state, double n_dofs,
+                           double bytes_per_dof)
+{
+  state.counters["dofs_per_second"] = benchmark::Counter(
+      n_dofs, benchmark::Counter::kIsIterationInvariantRate);
+  state.SetBytesProcessed(static_cast<int64_t>(
+      state.iterations() * n_dofs * bytes_per_dof));
+}
+
+#endif
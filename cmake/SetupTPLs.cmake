@@ -26,3 +26,9 @@ if (ADAMANTINE_ENABLE_CALIPER)
   add_compile_definitions(ADAMANTINE_WITH_CALIPER)
   message(STATUS "Found Caliper: ${caliper_INSTALL_PREFIX}")
 endif()
+
+#### Google Benchmark ########################################################
+if (ADAMANTINE_ENABLE_BENCHMARKS)
+  find_package(benchmark REQUIRED PATHS ${BENCHMARK_DIR})
+  message(STATUS "Found Google Benchmark: ${benchmark_DIR}")
+endif()
@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2023, the adamantine authors.
+#
+# This file is subject to the Modified BSD License and may not be distributed
+# without copyright and license information. Please refer to the file LICENSE
+# for the text and further information on this license.
+
+"""Run adamantine on a multi-layer 3D build at several numbers of processors
+and write a scaling report.
+
+In a strong scaling study, the mesh is the same for all the runs. In a weak
+scaling study, the domain is extended along the length with the number of
+processors so that the number of cells per processor is constant. All the runs
+perform the same number of time steps. The timers and the performance log
+written by adamantine are collected in scaling_report.csv and
+scaling_report.md in the output directory.
+"""
+
+import argparse
+import csv
+import json
+import os
+import string
+import subprocess
+import sys
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--adamantine", required=True,
+                        help="path to the adamantine executable")
+    parser.add_argument("--mode", choices=["strong", "weak"], required=True)
+    parser.add_argument("--memory-space", choices=["host", "device"],
+                        default="host")
+    parser.add_argument("--n-processes", default="1,2,4,8",
+                        help="comma separated numbers of processors")
+    parser.add_argument("--mpiexec", default="mpiexec")
+    parser.add_argument("--mpiexec-numproc-flag", default="-n")
+    parser.add_argument("--length-divisions", type=int, default=40,
+                        help="number of cells along the length for a strong "
+                        "scaling study or per processor for a weak scaling "
+                        "study")
+    parser.add_argument("--width-divisions", type=int, default=20)
+    parser.add_argument("--n-layers", type=int, default=4)
+    parser.add_argument("--n-time-steps", type=int, default=200)
+    parser.add_argument("--fe-degree", type=int, default=2)
+    parser.add_argument("--output-dir", default="scaling")
+    return parser.parse_args()
+
+
+# Size of the cells and thickness of the layers in meters
+CELL_SIZE = 2e-4
+SUBSTRATE_DIVISIONS = 5
+TIME_STEP = 0.6e-4
+SCAN_SPEED = 1.0
+HATCH_SPACING = 4e-4
+
+
+def write_scan_path(filename, length, width, substrate_height, n_layers):
+    """Write a raster scan path along the length of the domain. Each layer is
+    scanned with parallel lines separated by HATCH_SPACING."""
+    segments = []
+    for layer in range(n_layers):
+        z = substrate_height + (layer + 1) * CELL_SIZE
+        n_lines = max(1, int(width / HATCH_SPACING))
+        for line in range(n_lines):
+            y = (line + 0.5) * width / n_lines
+            start, end = (0.0, length) if line % 2 == 0 else (length, 0.0)
+            # Move the beam without power to the start of the line
+            segments.append((1, start, y, z, 0, 1e-6))
+            segments.append((0, end, y, z, 1, SCAN_SPEED))
+    with open(filename, "w") as scan_path:
+        scan_path.write("Number of path segments\n")
+        scan_path.write("{}\n".format(len(segments)))
+        scan_path.write("Mode x y z pmod param\n")
+        for segment in segments:
+            scan_path.write(
+                "{} {:.6g} {:.6g} {:.6g} {} {:.6g}\n".format(*segment))
+
+
+def write_input(template, run_dir, args, n_processes):
+    length_divisions = args.length_divisions
+    if args.mode == "weak":
+        length_divisions *= n_processes
+    length = length_divisions * CELL_SIZE
+    width = args.width_divisions * CELL_SIZE
+    substrate_height = SUBSTRATE_DIVISIONS * CELL_SIZE
+    height_divisions = SUBSTRATE_DIVISIONS + args.n_layers
+    scan_path_file = os.path.join(run_dir, "scan_path.txt")
+    write_scan_path(scan_path_file, length, width, substrate_height,
+                    args.n_layers)
+
+    values = {
+        "length": length,
+        "height": height_divisions * CELL_SIZE,
+        "width": width,
+        "length_divisions": length_divisions,
+        "height_divisions": height_divisions,
+        "width_divisions": args.width_divisions,
+        "substrate_height": substrate_height,
+        "cell_size": CELL_SIZE,
+        "layer_thickness": CELL_SIZE,
+        "scan_path_file": scan_path_file,
+        "duration": args.n_time_steps * TIME_STEP,
+        "time_step": TIME_STEP,
+        "n_time_steps": args.n_time_steps,
+        "filename_prefix": os.path.join(run_dir, "output"),
+        "fe_degree": args.fe_degree,
+        "memory_space": args.memory_space,
+    }
+    input_file = os.path.join(run_dir, "input.info")
+    with open(input_file, "w") as f:
+        f.write(template.substitute(values))
+
+    return input_file
+
+
+def flatten_timers(timers, result):
+    for timer in timers:
+        result[timer["section"]] = timer
+        flatten_timers(timer["children"], result)
+    return result
+
+
+def read_run(run_dir):
+    prefix = os.path.join(run_dir, "output")
+    with open(prefix + ".timers.json") as f:
+        timers = flatten_timers(json.load(f)["timers"], {})
+    with open(prefix + ".performance.csv") as f:
+        steps = list(csv.DictReader(f))
+    return timers, steps
+
+
+def main():
+    args = parse_args()
+    n_processes_list = [int(n) for n in args.n_processes.split(",")]
+    script_dir = os.path.dirname(os.path.abspath(__file__))
+    with open(os.path.join(script_dir, "multilayer_3d.info.in")) as f:
+        template = string.Template(f.read())
+
+    study = "{}_{}".format(args.mode, args.memory_space)
+    rows = []
+    for n_processes in n_processes_list:
+        run_dir = os.path.abspath(
+            os.path.join(args.output_dir, study, "np_{}".format(n_processes)))
+        os.makedirs(run_dir, exist_ok=True)
+        input_file = write_input(template, run_dir, args, n_processes)
+        command = [args.mpiexec, args.mpiexec_numproc_flag, str(n_processes),
+                   args.adamantine, "--input-file=" + input_file]
+        print(" ".join(command), flush=True)
+        with open(os.path.join(run_dir, "adamantine.log"), "w") as log:
+            subprocess.run(command, stdout=log, stderr=subprocess.STDOUT,
+                           check=True)
+
+        timers, steps = read_run(run_dir)
+        # The wall time is given by the slowest processor
+        evolve = timers["Evolve One Time Step"]
+        dofs_per_second = [float(step["dofs_per_second"]) for step in steps]
+        rows.append({
+            "n_processes": n_processes,
+            "n_active_cells": steps[-1]["n_active_cells"],
+            "n_dofs": steps[-1]["n_dofs"],
+            "main_time": timers["Main"]["max"] / 1000.,
+            "evolve_time": evolve["max"] / 1000.,
+            "evolve_imbalance": evolve["imbalance"],
+            "output_time": timers["Output"]["max"] / 1000.,
+            "mean_dofs_per_second":
+                sum(dofs_per_second) / max(len(dofs_per_second), 1),
+        })
+
+    # The efficiency is relative to the smallest number of processors
+    reference = rows[0]
+    for row in rows:
+        ratio = row["n_processes"] / reference["n_processes"]
+        speedup = reference["evolve_time"] / row["evolve_time"]
+        row["efficiency"] = speedup / ratio if args.mode == "strong" \
+            else speedup
+
+    columns = ["n_processes", "n_active_cells", "n_dofs", "main_time",
+               "evolve_time", "evolve_imbalance", "output_time",
+               "mean_dofs_per_second", "efficiency"]
+    report = os.path.join(args.output_dir, study, "scaling_report")
+    with open(report + ".csv", "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=columns)
+        writer.writeheader()
+        writer.writerows(rows)
+    with open(report + ".md", "w") as f:
+        f.write("# {} scaling, memory space {}\n\n".format(
+            args.mode.capitalize(), args.memory_space))
+        f.write("Times in seconds of the slowest processor.\n\n")
+        f.write("| " + " | ".join(columns) + " |\n")
+        f.write("|" + "---|" * len(columns) + "\n")
+        for row in rows:
+            f.write("| " + " | ".join(
+                "{:.4g}".format(row[c]) if isinstance(row[c], float)
+                else str(row[c]) for c in columns) + " |\n")
+    print("Report written in " + report + ".md")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
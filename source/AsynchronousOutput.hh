@@ -0,0 +1,159 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef ASYNCHRONOUS_OUTPUT_HH
+#define ASYNCHRONOUS_OUTPUT_HH
+
+#include <HostStagingBuffer.hh>
+#include <MaterialProperty.hh>
+#include <MemoryBlock.hh>
+#include <MemoryBlockView.hh>
+#include <PostProcessor.hh>
+#include <ThermalPhysicsInterface.hh>
+#include <utils.hh>
+
+#include <deal.II/base/partitioner.h>
+#include <deal.II/lac/la_parallel_vector.h>
+
+#include <memory>
+
+namespace adamantine
+{
+/**
+ * Output of the thermal simulation whose writing is deferred. start() takes a
+ * snapshot of the temperature and of the material state and copies it
+ * asynchronously to pinned buffers on the host. The output is written by
+ * finish(). On the device, this allows the copy to overlap with the next time
+ * step. finish() needs to be called before the mesh or the degrees of freedom
+ * change.
+ */
+template <int dim, typename MemorySpaceType>
+class AsynchronousOutput
+{
+public:
+  /**
+   * Start the copy of @p temperature and @p state to the host.
+   */
+  void start(unsigned int n_time_step, double time,
+             dealii::LA::distributed::Vector<double, MemorySpaceType> const
+                 &temperature,
+             MemoryBlockView<double, MemorySpaceType> const &state);
+
+  /**
+   * Wait for the copy started by start() and write the output. Do nothing if
+   * there is no output pending.
+   */
+  void
+  finish(PostProcessor<dim> &post_processor,
+         ThermalPhysicsInterface<dim, MemorySpaceType> &thermal_physics,
+         MaterialProperty<dim, MemorySpaceType> const &material_properties);
+
+  /**
+   * Return true if start() has been called and finish() has not.
+   */
+  bool pending() const;
+
+private:
+  /**
+   * Flag set to true when an output is pending.
+   */
+  bool _pending = false;
+  /**
+   * Time step of the pending output.
+   */
+  unsigned int _n_time_step = 0;
+  /**
+   * Time of the pending output.
+   */
+  double _time = 0.;
+  /**
+   * Partitioner of the temperature of the pending output.
+   */
+  std::shared_ptr<dealii::Utilities::MPI::Partitioner const> _partitioner;
+  /**
+   * Copies of the temperature and of the material state that are not modified
+   * by the next time step while they are transferred to the host.
+   */
+  MemoryBlock<double, MemorySpaceType> _temperature_snapshot;
+  MemoryBlock<double, MemorySpaceType> _state_snapshot;
+  /**
+   * Buffers on the host receiving the snapshots.
+   */
+  HostStagingBuffer<double, MemorySpaceType> _temperature_buffer;
+  HostStagingBuffer<double, MemorySpaceType> _state_buffer;
+};
+
+template <int dim, typename MemorySpaceType>
+void AsynchronousOutput<dim, MemorySpaceType>::start(
+    unsigned int n_time_step, double time,
+    dealii::LA::distributed::Vector<double, MemorySpaceType> const
+        &temperature,
+    MemoryBlockView<double, MemorySpaceType> const &state)
+{
+  ASSERT(!_pending, "The previous output has not been written.");
+  _n_time_step = n_time_step;
+  _time = time;
+  _partitioner = temperature.get_partitioner();
+
+  // The snapshots are taken in the order of the work already launched. The
+  // buffers then wait for the snapshots before copying them.
+  unsigned int const local_size = temperature.locally_owned_size();
+  if (_temperature_snapshot.size() != local_size)
+    _temperature_snapshot.reinit(local_size);
+  deep_copy(_temperature_snapshot.data(), MemorySpaceType{},
+            temperature.get_values(), MemorySpaceType{}, local_size);
+  _temperature_buffer.reinit(local_size);
+  _temperature_buffer.copy_from(_temperature_snapshot.data());
+
+  if ((_state_snapshot.extent(0) != state.extent(0)) ||
+      (_state_snapshot.extent(1) != state.extent(1)))
+    _state_snapshot.reinit(state.extent(0), state.extent(1));
+  deep_copy(_state_snapshot.data(), MemorySpaceType{}, state.data(),
+            MemorySpaceType{}, state.size());
+  _state_buffer.reinit(state.extent(0), state.extent(1));
+  _state_buffer.copy_from(_state_snapshot.data());
+
+  _pending = true;
+}
+
+template <int dim, typename MemorySpaceType>
+void AsynchronousOutput<dim, MemorySpaceType>::finish(
+    PostProcessor<dim> &post_processor,
+    ThermalPhysicsInterface<dim, MemorySpaceType> &thermal_physics,
+    MaterialProperty<dim, MemorySpaceType> const &material_properties)
+{
+  if (!_pending)
+    return;
+
+  _temperature_buffer.wait();
+  _state_buffer.wait();
+
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+      temperature_host(_partitioner);
+  MemoryBlockView<double, dealii::MemorySpace::Host> temperature_view =
+      _temperature_buffer.get_view();
+  unsigned int const local_size = temperature_host.locally_owned_size();
+  for (unsigned int i = 0; i < local_size; ++i)
+    temperature_host.local_element(i) = temperature_view(i);
+  thermal_physics.get_affine_constraints().distribute(temperature_host);
+
+  post_processor.write_thermal_output(
+      _n_time_step, _time, temperature_host, _state_buffer.get_view(),
+      material_properties.get_dofs_map(),
+      material_properties.get_dof_handler());
+
+  _pending = false;
+}
+
+template <int dim, typename MemorySpaceType>
+inline bool AsynchronousOutput<dim, MemorySpaceType>::pending() const
+{
+  return _pending;
+}
+} // namespace adamantine
+
+#endif
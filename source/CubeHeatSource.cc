@@ -1,4 +1,4 @@
-/* Copyright (c) 2020 - 2022, the adamantine authors.
+/* Copyright (c) 2020 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -58,6 +58,66 @@ double CubeHeatSource<dim>::value(dealii::Point<dim> const &point,
   return 0.;
 }
 
+template <int dim>
+template <typename Number>
+dealii::VectorizedArray<Number> CubeHeatSource<dim>::vectorized_value(
+    dealii::Point<dim, dealii::VectorizedArray<Number>> const &points) const
+{
+  dealii::VectorizedArray<Number> const zero =
+      dealii::make_vectorized_array<Number>(0.);
+  if (!_source_on)
+    return zero;
+
+  // Zero the lanes that are outside of the cube.
+  dealii::VectorizedArray<Number> heat_source =
+      dealii::make_vectorized_array<Number>(_value);
+  for (int i = 0; i < dim; ++i)
+  {
+    heat_source =
+        dealii::compare_and_apply_mask<dealii::SIMDComparison::less_than>(
+            points[i], dealii::make_vectorized_array<Number>(_min_point[i]),
+            zero, heat_source);
+    heat_source =
+        dealii::compare_and_apply_mask<dealii::SIMDComparison::greater_than>(
+            points[i], dealii::make_vectorized_array<Number>(_max_point[i]),
+            zero, heat_source);
+  }
+
+  return heat_source;
+}
+
+template <int dim>
+dealii::VectorizedArray<double> CubeHeatSource<dim>::value(
+    dealii::Point<dim, dealii::VectorizedArray<double>> const &points,
+    double const /*height*/) const
+{
+  return vectorized_value(points);
+}
+
+template <int dim>
+dealii::VectorizedArray<float> CubeHeatSource<dim>::value(
+    dealii::Point<dim, dealii::VectorizedArray<float>> const &points,
+    double const /*height*/) const
+{
+  return vectorized_value(points);
+}
+
+template <int dim>
+HeatSourceData<dim> CubeHeatSource<dim>::get_data() const
+{
+  HeatSourceData<dim> data;
+  data.type = HeatSourceType::cube;
+  // Turning off the source is equivalent to a zero value.
+  data.value = _source_on ? _value : 0.;
+  for (int i = 0; i < dim; ++i)
+  {
+    data.min_point[i] = _min_point[i];
+    data.max_point[i] = _max_point[i];
+  }
+
+  return data;
+}
+
 template <int dim>
 double CubeHeatSource<dim>::get_current_height(double const /*time*/) const
 {
@@ -1,4 +1,4 @@
-/* Copyright (c) 2020 - 2021, the adamantine authors.
+/* Copyright (c) 2020 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -45,6 +45,26 @@ public:
    */
   double value(dealii::Point<dim> const &point,
                double const /*height*/) const final;
+
+  /**
+   * Return the value of the source for a batch of points.
+   */
+  dealii::VectorizedArray<double>
+  value(dealii::Point<dim, dealii::VectorizedArray<double>> const &points,
+        double const /*height*/) const final;
+
+  /**
+   * Return the value of the source for a batch of single precision points.
+   */
+  dealii::VectorizedArray<float>
+  value(dealii::Point<dim, dealii::VectorizedArray<float>> const &points,
+        double const /*height*/) const final;
+
+  /**
+   * Return the description of the heat source at the current time.
+   */
+  HeatSourceData<dim> get_data() const final;
+
   /**
    * Compute the current height of the where the heat source meets the material
    * (i.e. the current scan path height).
@@ -52,6 +72,13 @@ public:
   double get_current_height(double const time) const final;
 
 private:
+  /**
+   * Implementation of the batched value functions.
+   */
+  template <typename Number>
+  dealii::VectorizedArray<Number> vectorized_value(
+      dealii::Point<dim, dealii::VectorizedArray<Number>> const &points) const;
+
   bool _source_on = false;
   double _start_time;
   double _end_time;
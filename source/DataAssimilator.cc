@@ -9,9 +9,11 @@
 #include <utils.hh>
 
 #include <deal.II/arborx/distributed_tree.h>
+#include <deal.II/base/memory_consumption.h>
 #include <deal.II/dofs/dof_tools.h>
 #include <deal.II/fe/mapping_q1.h>
 #include <deal.II/lac/block_vector.h>
+#include <deal.II/lac/lapack_full_matrix.h>
 #include <deal.II/lac/linear_operator_tools.h>
 #include <deal.II/lac/trilinos_sparse_matrix.h>
 
@@ -45,6 +47,14 @@ DataAssimilator::DataAssimilator(boost::property_tree::ptree const &database)
           database.get_optional<double>("solver.convergence_tolerance"))
     _solver_control.set_tolerance(*tolerance);
 
+  // PropertyTreeInput data_assimilation.solver.method
+  std::string const solver_method = database.get("solver.method", "gmres");
+  ASSERT_THROW(boost::iequals(solver_method, "gmres") ||
+                   boost::iequals(solver_method, "cholesky"),
+               "Error: Unknown data assimilation solver. Valid options are "
+               "'gmres' and 'cholesky'.");
+  _direct_kalman_gain_solve = boost::iequals(solver_method, "cholesky");
+
   // PropertyTreeInput data_assimilation.localization_cutoff_distance
   _localization_cutoff_distance = database.get(
       "localization_cutoff_distance", std::numeric_limits<double>::max());
@@ -71,6 +81,29 @@ DataAssimilator::DataAssimilator(boost::property_tree::ptree const &database)
                  "Error: Unknown localization cutoff function. Valid options "
                  "are 'gaspari_cohn', 'step_function', and 'none'.");
   }
+
+  // PropertyTreeInput data_assimilation.method
+  std::string method = database.get("method", "enkf");
+  if (boost::iequals(method, "enkf"))
+  {
+    _ensemble_filter = EnsembleFilter::enkf;
+  }
+  else if (boost::iequals(method, "etkf"))
+  {
+    _ensemble_filter = EnsembleFilter::etkf;
+  }
+  else if (boost::iequals(method, "letkf"))
+  {
+    _ensemble_filter = EnsembleFilter::letkf;
+    ASSERT_THROW(_localization_cutoff_distance <
+                     std::numeric_limits<double>::max(),
+                 "Error: The LETKF requires a localization cutoff distance.");
+  }
+  else
+  {
+    ASSERT_THROW(false, "Error: Unknown data assimilation method. Valid "
+                        "options are 'enkf', 'etkf', and 'letkf'.");
+  }
 }
 
 void DataAssimilator::update_ensemble(
@@ -105,6 +138,51 @@ void DataAssimilator::update_ensemble(
   auto bandwidth = R.get_sparsity_pattern().bandwidth();
   bool const R_is_diagonal = bandwidth == 0 ? true : false;
 
+  if (_ensemble_filter == EnsembleFilter::etkf)
+  {
+    // Update the ensemble, x = mean(x) + X T
+    if (rank == 0)
+      std::cout << "Applying the ensemble transform..." << std::endl;
+
+#ifdef ADAMANTINE_WITH_CALIPER
+    CALI_MARK_BEGIN("da_apply_ensemble_transform");
+#endif
+
+    apply_ensemble_transform(communicator, augmented_state_ensemble, expt_data,
+                             R, R_is_diagonal);
+
+#ifdef ADAMANTINE_WITH_CALIPER
+    CALI_MARK_END("da_apply_ensemble_transform");
+#endif
+
+    return;
+  }
+
+  if (_ensemble_filter == EnsembleFilter::letkf)
+  {
+    ASSERT_THROW(R_is_diagonal,
+                 "Error: The LETKF requires a diagonal observation covariance "
+                 "matrix.");
+
+    // Update the ensemble, x = mean(x) + X T, using a different transform for
+    // each dof
+    if (rank == 0)
+      std::cout << "Applying the local ensemble transform..." << std::endl;
+
+#ifdef ADAMANTINE_WITH_CALIPER
+    CALI_MARK_BEGIN("da_apply_local_ensemble_transform");
+#endif
+
+    apply_local_ensemble_transform(communicator, augmented_state_ensemble,
+                                   expt_data, R);
+
+#ifdef ADAMANTINE_WITH_CALIPER
+    CALI_MARK_END("da_apply_local_ensemble_transform");
+#endif
+
+    return;
+  }
+
   // Get the perturbed innovation, ( y+u - Hx )
   // This is determined using the unaugmented state because the parameters are
   // not observable
@@ -178,15 +256,23 @@ DataAssimilator::apply_kalman_gain(
   unsigned int augmented_state_size = _sim_size + _parameter_size;
 
   /*
-   * Currently this function uses GMRES to apply the inverse of HPH^T+R in the
-   * Kalman gain calculation for each ensemble member individually. Depending
-   * on the size of the datasets, the number of ensembles, and other factors
-   * doing a direct solve of (HPH^T+R)^-1 once and then applying to the
-   * perturbed innovation from each ensemble member might be more efficient.
+   * By default, this function uses GMRES to apply the inverse of HPH^T+R in
+   * the Kalman gain calculation for each ensemble member individually.
+   * Depending on the size of the datasets, the number of ensembles, and other
+   * factors, the direct solve, which factorizes HPH^T+R once and applies it to
+   * the perturbed innovation of every member, can be more efficient.
    */
-  dealii::SparsityPattern pattern_H(_expt_size, augmented_state_size,
-                                    _expt_size);
-  auto H = calc_H(pattern_H);
+  // The observation matrix is only rebuilt when the observations or the mesh
+  // have changed.
+  if (!_H_is_up_to_date || (_H.m() != _expt_size) ||
+      (_H.n() != augmented_state_size))
+  {
+    _H.clear();
+    _pattern_H.reinit(_expt_size, augmented_state_size, _expt_size);
+    _H = calc_H(_pattern_H);
+    _H_is_up_to_date = true;
+  }
+  auto const &H = _H;
   auto P = calc_sample_covariance_sparse(augmented_state_ensemble);
 
   ASSERT(H.n() == P.m(), "Matrices dimensions not compatible");
@@ -205,6 +291,41 @@ DataAssimilator::apply_kalman_gain(
       _num_ensemble_members,
       dealii::LA::distributed::BlockVector<double>(block_sizes));
 
+  if (_direct_kalman_gain_solve)
+  {
+    // Assemble HPH^T+R in the observation space and factorize it once. Since
+    // H selects the observed dofs, the entries of HPH^T are read directly
+    // from P. All the perturbed innovations are then solved at once.
+    dealii::LAPACKFullMatrix<double> HPH_plus_R(_expt_size);
+    for (auto H_i = H.begin(); H_i != H.end(); ++H_i)
+      for (auto H_j = H.begin(); H_j != H.end(); ++H_j)
+        HPH_plus_R(H_i->row(), H_j->row()) +=
+            H_i->value() * H_j->value() * P.el(H_i->column(), H_j->column());
+    for (auto R_ij = R.begin(); R_ij != R.end(); ++R_ij)
+      HPH_plus_R(R_ij->row(), R_ij->column()) += R_ij->value();
+    HPH_plus_R.compute_cholesky_factorization();
+
+    dealii::LAPACKFullMatrix<double> innovations(_expt_size,
+                                                 _num_ensemble_members);
+    for (unsigned int member = 0; member < _num_ensemble_members; ++member)
+      for (unsigned int i = 0; i < _expt_size; ++i)
+        innovations(i, member) = perturbed_innovation[member][i];
+    HPH_plus_R.solve(innovations);
+
+    const auto op_PH_T = op_P * dealii::transpose_operator(op_H);
+    dealii::Vector<double> weights(_expt_size);
+    for (unsigned int member = 0; member < _num_ensemble_members; ++member)
+    {
+      for (unsigned int i = 0; i < _expt_size; ++i)
+        weights[i] = innovations(i, member);
+      dealii::Vector<double> const temporary = op_PH_T * weights;
+      for (unsigned int i = 0; i < augmented_state_size; ++i)
+        output[member](i) = temporary(i);
+    }
+
+    return output;
+  }
+
   // Create non-member versions of these for use in the lambda function
   auto solver_control = _solver_control;
   auto additional_data = _additional_data;
@@ -242,6 +363,270 @@ DataAssimilator::apply_kalman_gain(
   return output;
 }
 
+void DataAssimilator::apply_ensemble_transform(
+    MPI_Comm const &communicator,
+    std::vector<dealii::LA::distributed::BlockVector<double>>
+        &augmented_state_ensemble,
+    std::vector<double> const &expt_data, dealii::SparseMatrix<double> const &R,
+    bool const R_is_diagonal)
+{
+  unsigned int const n_members = _num_ensemble_members;
+
+  // Compute the anomalies of the ensemble X and of the observed ensemble
+  // Y = HX. The innovation of the ensemble mean, y - H mean(x), is stored in
+  // the last column of Y.
+  dealii::FullMatrix<double> const anomalies =
+      calc_ensemble_anomalies(augmented_state_ensemble);
+  dealii::FullMatrix<double> expt_anomalies =
+      calc_observed_ensemble(communicator, augmented_state_ensemble);
+  for (unsigned int i = 0; i < _expt_size; ++i)
+  {
+    double mean = 0.;
+    for (unsigned int member = 0; member < n_members; ++member)
+      mean += expt_anomalies(i, member);
+    mean /= n_members;
+    for (unsigned int member = 0; member < n_members; ++member)
+      expt_anomalies(i, member) -= mean;
+    expt_anomalies(i, n_members) = expt_data[i] - mean;
+  }
+
+  // Apply R^-1 to Y and to the innovation
+  dealii::FullMatrix<double> R_inv_expt_anomalies(expt_anomalies);
+  if (R_is_diagonal)
+  {
+    for (unsigned int i = 0; i < _expt_size; ++i)
+    {
+      double const R_inv = 1. / R(i, i);
+      for (unsigned int j = 0; j < n_members + 1; ++j)
+        R_inv_expt_anomalies(i, j) *= R_inv;
+    }
+  }
+  else
+  {
+    dealii::FullMatrix<double> R_full(_expt_size);
+    R_full.copy_from(R);
+    dealii::LAPACKFullMatrix<double> R_lapack(_expt_size);
+    R_lapack = R_full;
+    R_lapack.compute_cholesky_factorization();
+    dealii::LAPACKFullMatrix<double> rhs(_expt_size, n_members + 1);
+    rhs = R_inv_expt_anomalies;
+    R_lapack.solve(rhs);
+    R_inv_expt_anomalies = rhs;
+  }
+
+  // Compute Y^T R^-1 Y and Y^T R^-1 (y - H mean(x)). These are the only
+  // products involving the observations, the rest of the analysis is done in
+  // the ensemble space. The last row of the product is not used.
+  dealii::FullMatrix<double> ensemble_products(n_members + 1);
+  expt_anomalies.Tmmult(ensemble_products, R_inv_expt_anomalies);
+
+  // The increments X (T - I) are computed one row at a time so that they are
+  // never stored for the whole ensemble.
+  dealii::FullMatrix<double> const transform =
+      calc_ensemble_transform(ensemble_products);
+  for (unsigned int row = 0; row < anomalies.m(); ++row)
+    add_row_increments(row, anomalies, transform, augmented_state_ensemble);
+}
+
+void DataAssimilator::apply_local_ensemble_transform(
+    MPI_Comm const &communicator,
+    std::vector<dealii::LA::distributed::BlockVector<double>>
+        &augmented_state_ensemble,
+    std::vector<double> const &expt_data, dealii::SparseMatrix<double> const &R)
+{
+  ASSERT_THROW(_expt_is_owned.size() == _expt_size,
+               "Error: The local observations have not been updated.");
+
+  unsigned int const n_members = _num_ensemble_members;
+
+  dealii::FullMatrix<double> const anomalies =
+      calc_ensemble_anomalies(augmented_state_ensemble);
+  unsigned int const n_state_rows =
+      augmented_state_ensemble[0]
+          .locally_owned_elements()
+          .get_view(0, _sim_size)
+          .n_elements();
+  ASSERT(n_state_rows + 1 == _local_observation_offsets.size(),
+         "The local observations do not match the mesh.");
+
+  // Compute the observed anomalies Y = HX. The innovation of the ensemble mean,
+  // y - H mean(x), is stored in the last column of Y.
+  dealii::FullMatrix<double> expt_anomalies =
+      calc_observed_ensemble(communicator, augmented_state_ensemble);
+  std::vector<double> R_inv(_expt_size);
+  for (unsigned int i = 0; i < _expt_size; ++i)
+  {
+    double mean = 0.;
+    for (unsigned int member = 0; member < n_members; ++member)
+      mean += expt_anomalies(i, member);
+    mean /= n_members;
+    for (unsigned int member = 0; member < n_members; ++member)
+      expt_anomalies(i, member) -= mean;
+    expt_anomalies(i, n_members) = expt_data[i] - mean;
+    R_inv[i] = 1. / R(i, i);
+  }
+
+  // Accumulate the localized R^-1 weighted products of the rows of Y
+  auto accumulate_products =
+      [&](unsigned int const i, double const weight,
+          dealii::FullMatrix<double> &ensemble_products)
+  {
+    for (unsigned int k = 0; k < n_members; ++k)
+    {
+      double const weighted_anomaly = weight * expt_anomalies(i, k);
+      for (unsigned int l = 0; l < n_members + 1; ++l)
+        ensemble_products(k, l) += weighted_anomaly * expt_anomalies(i, l);
+    }
+  };
+
+  // Local analysis of the locally owned dofs. The dofs without observations
+  // within the cutoff distance are not modified. The anomalies are not modified
+  // by the analysis so the increments of each row are added directly to the
+  // members.
+  dealii::FullMatrix<double> ensemble_products(n_members, n_members + 1);
+  for (unsigned int row = 0; row < n_state_rows; ++row)
+  {
+    unsigned int const begin = _local_observation_offsets[row];
+    unsigned int const end = _local_observation_offsets[row + 1];
+    if (begin == end)
+      continue;
+
+    ensemble_products = 0.;
+    for (unsigned int j = begin; j < end; ++j)
+    {
+      unsigned int const i = _local_observation_indices[j];
+      accumulate_products(i, _local_observation_scalings[j] * R_inv[i],
+                          ensemble_products);
+    }
+    add_row_increments(row, anomalies,
+                       calc_ensemble_transform(ensemble_products),
+                       augmented_state_ensemble);
+  }
+
+  // The augmented parameters are not localized
+  if (anomalies.m() > n_state_rows)
+  {
+    ensemble_products = 0.;
+    for (unsigned int i = 0; i < _expt_size; ++i)
+      accumulate_products(i, R_inv[i], ensemble_products);
+    dealii::FullMatrix<double> const transform =
+        calc_ensemble_transform(ensemble_products);
+    for (unsigned int row = n_state_rows; row < anomalies.m(); ++row)
+      add_row_increments(row, anomalies, transform, augmented_state_ensemble);
+  }
+}
+
+dealii::FullMatrix<double> DataAssimilator::calc_observed_ensemble(
+    MPI_Comm const &communicator,
+    std::vector<dealii::LA::distributed::BlockVector<double>> const
+        &augmented_state_ensemble) const
+{
+  // Each observation is evaluated by the processor that owns the closest dof
+  // and the observed ensemble is then shared with all the processors. Without
+  // the owners, the observations are evaluated locally, which is only valid on
+  // a single processor.
+  bool const use_owners = _expt_is_owned.size() == _expt_size;
+  ASSERT_THROW(use_owners ||
+                   (dealii::Utilities::MPI::n_mpi_processes(communicator) == 1),
+               "Error: The owners of the observations have not been updated.");
+
+  // The parameters are not observable, only the base state is used to compute
+  // the observations
+  int constexpr base_state = 0;
+  dealii::FullMatrix<double> observed_ensemble(_expt_size,
+                                               _num_ensemble_members + 1);
+  for (unsigned int member = 0; member < _num_ensemble_members; ++member)
+  {
+    dealii::Vector<double> const temporary =
+        calc_Hx(augmented_state_ensemble[member].block(base_state));
+    for (unsigned int i = 0; i < _expt_size; ++i)
+      if (!use_owners || _expt_is_owned[i])
+        observed_ensemble(i, member) = temporary[i];
+  }
+  if (use_owners && (observed_ensemble.n_elements() > 0))
+    MPI_Allreduce(MPI_IN_PLACE, &observed_ensemble(0, 0),
+                  observed_ensemble.n_elements(), MPI_DOUBLE, MPI_SUM,
+                  communicator);
+
+  return observed_ensemble;
+}
+
+dealii::FullMatrix<double> DataAssimilator::calc_ensemble_transform(
+    dealii::FullMatrix<double> const &ensemble_products) const
+{
+  unsigned int const n_members = _num_ensemble_members;
+
+  // Compute the eigendecomposition of (N-1) I + Y^T R^-1 Y = U S U^T. Since the
+  // matrix is symmetric positive definite, it is given by the SVD.
+  dealii::LAPACKFullMatrix<double> ensemble_matrix(n_members);
+  for (unsigned int i = 0; i < n_members; ++i)
+    for (unsigned int j = 0; j < n_members; ++j)
+      ensemble_matrix(i, j) = ensemble_products(i, j);
+  for (unsigned int i = 0; i < n_members; ++i)
+    ensemble_matrix(i, i) += n_members - 1.;
+  ensemble_matrix.compute_svd();
+  dealii::LAPACKFullMatrix<double> const &U = ensemble_matrix.get_svd_u();
+
+  // Compute the weights of the mean, w = U S^-1 U^T Y^T R^-1 (y - H mean(x)),
+  // and the transform of the anomalies, W = U [(N-1) S^-1]^1/2 U^T.
+  dealii::Vector<double> projected_innovation(n_members);
+  for (unsigned int l = 0; l < n_members; ++l)
+  {
+    for (unsigned int i = 0; i < n_members; ++i)
+      projected_innovation[l] += U(i, l) * ensemble_products(i, n_members);
+    projected_innovation[l] /= ensemble_matrix.singular_value(l);
+  }
+  dealii::Vector<double> mean_weights(n_members);
+  for (unsigned int i = 0; i < n_members; ++i)
+    for (unsigned int l = 0; l < n_members; ++l)
+      mean_weights[i] += U(i, l) * projected_innovation[l];
+
+  // The analysis of member k is mean(x) + X (w + W_k) = x_k + X (w + W_k - e_k)
+  dealii::Vector<double> transform_scaling(n_members);
+  for (unsigned int l = 0; l < n_members; ++l)
+    transform_scaling[l] =
+        std::sqrt((n_members - 1.) / ensemble_matrix.singular_value(l));
+  dealii::FullMatrix<double> transform(n_members);
+  for (unsigned int i = 0; i < n_members; ++i)
+  {
+    for (unsigned int k = 0; k < n_members; ++k)
+    {
+      double value = 0.;
+      for (unsigned int l = 0; l < n_members; ++l)
+        value += U(i, l) * U(k, l) * transform_scaling[l];
+      transform(i, k) = mean_weights[i] + value - (i == k ? 1. : 0.);
+    }
+  }
+
+  return transform;
+}
+
+void DataAssimilator::add_row_increments(
+    unsigned int const row, dealii::FullMatrix<double> const &anomalies,
+    dealii::FullMatrix<double> const &transform,
+    std::vector<dealii::LA::distributed::BlockVector<double>>
+        &augmented_state_ensemble) const
+{
+  // Find the block and the local index of the row. The rows are ordered by
+  // block like in calc_ensemble_anomalies().
+  unsigned int b = 0;
+  unsigned int i = row;
+  while (i >= augmented_state_ensemble[0].block(b).locally_owned_size())
+  {
+    i -= augmented_state_ensemble[0].block(b).locally_owned_size();
+    ++b;
+  }
+
+  double const *anomalies_row = &anomalies(row, 0);
+  for (unsigned int k = 0; k < _num_ensemble_members; ++k)
+  {
+    double increment = 0.;
+    for (unsigned int l = 0; l < _num_ensemble_members; ++l)
+      increment += anomalies_row[l] * transform(l, k);
+    augmented_state_ensemble[k].block(b).local_element(i) += increment;
+  }
+}
+
 dealii::SparseMatrix<double>
 DataAssimilator::calc_H(dealii::SparsityPattern &pattern) const
 {
@@ -273,7 +658,11 @@ void DataAssimilator::update_dof_mapping(
     std::pair<std::vector<int>, std::vector<int>> const &expt_to_dof_mapping)
 {
   _expt_size = expt_to_dof_mapping.first.size();
-  _expt_to_dof_mapping = expt_to_dof_mapping;
+  if (expt_to_dof_mapping != _expt_to_dof_mapping)
+  {
+    _expt_to_dof_mapping = expt_to_dof_mapping;
+    _H_is_up_to_date = false;
+  }
 }
 
 template <int dim>
@@ -284,9 +673,32 @@ void DataAssimilator::update_covariance_sparsity_pattern(
   _sim_size = dof_handler.n_dofs();
   _parameter_size = parameter_size;
   unsigned int augmented_state_size = _sim_size + _parameter_size;
+  // The dofs may have been renumbered
+  _H_is_up_to_date = false;
+  _covariance_distance_map.clear();
 
   auto [dof_indices, support_points] = get_dof_to_support_mapping(dof_handler);
 
+  // The ensemble transform filters do not use the covariance matrix. They only
+  // need the support points of the locally owned dofs to find the owner of
+  // each observation and, for the LETKF, the local observations.
+  if ((_ensemble_filter == EnsembleFilter::etkf) ||
+      (_ensemble_filter == EnsembleFilter::letkf))
+  {
+    _locally_owned_dofs = dof_handler.locally_owned_dofs();
+    _support_points.assign(3 * _locally_owned_dofs.n_elements(), 0.);
+    for (unsigned int i = 0; i < dof_indices.size(); ++i)
+    {
+      unsigned int const row =
+          _locally_owned_dofs.index_within_set(dof_indices[i]);
+      for (int d = 0; d < dim; ++d)
+        _support_points[3 * row + d] = support_points[i][d];
+    }
+    _expt_is_owned.clear();
+
+    return;
+  }
+
   // Perform the spatial search using ArborX
   auto communicator = dof_handler.get_communicator();
   dealii::ArborXWrappers::DistributedTree distributed_tree(communicator,
@@ -359,13 +771,125 @@ void DataAssimilator::update_covariance_sparsity_pattern(
   _covariance_sparsity_pattern.compress();
 }
 
+template <int dim>
+void DataAssimilator::update_local_observations(
+    MPI_Comm const &communicator,
+    std::vector<dealii::Point<dim>> const &expt_points)
+{
+  if (_ensemble_filter == EnsembleFilter::enkf)
+    return;
+
+  unsigned int const n_local_dofs = _support_points.size() / 3;
+  auto support_point = [&](unsigned int const row)
+  {
+    dealii::Point<dim> point;
+    for (int d = 0; d < dim; ++d)
+      point[d] = _support_points[3 * row + d];
+    return point;
+  };
+
+  // The mapping only contains the observations found on this processor, it is
+  // empty if the processor owns no dof. The number of observations is the same
+  // on every processor.
+  _expt_size = expt_points.size();
+
+  // Each observation is evaluated by the processor that owns the closest dof.
+  // Ties are broken by the lowest rank.
+  struct DistanceRank
+  {
+    double distance;
+    int rank;
+  };
+  int const my_rank = dealii::Utilities::MPI::this_mpi_process(communicator);
+  std::vector<DistanceRank> closest_dofs(
+      _expt_size, {std::numeric_limits<double>::max(), my_rank});
+  for (unsigned int i = 0; i < _expt_to_dof_mapping.first.size(); ++i)
+  {
+    unsigned int const expt_index = _expt_to_dof_mapping.first[i];
+    unsigned int const row =
+        _locally_owned_dofs.index_within_set(_expt_to_dof_mapping.second[i]);
+    closest_dofs[expt_index].distance =
+        expt_points[expt_index].distance(support_point(row));
+  }
+  MPI_Allreduce(MPI_IN_PLACE, closest_dofs.data(), _expt_size, MPI_DOUBLE_INT,
+                MPI_MINLOC, communicator);
+  _expt_is_owned.resize(_expt_size);
+  for (unsigned int i = 0; i < _expt_size; ++i)
+    _expt_is_owned[i] = closest_dofs[i].rank == my_rank;
+
+  // The ETKF does not localize the observations
+  if (_ensemble_filter == EnsembleFilter::etkf)
+    return;
+
+  // Search the observations within the cutoff distance of each locally owned
+  // dof
+  std::vector<std::pair<dealii::Point<dim, double>, double>> spheres;
+  for (unsigned int row = 0; row < n_local_dofs; ++row)
+    spheres.push_back({support_point(row), _localization_cutoff_distance});
+  dealii::ArborXWrappers::BVH bvh(expt_points);
+  dealii::ArborXWrappers::SphereIntersectPredicate sph_intersect(spheres);
+  auto [indices, offsets] = bvh.query(sph_intersect);
+
+  _local_observation_offsets.assign(n_local_dofs + 1, 0);
+  _local_observation_indices.clear();
+  _local_observation_scalings.clear();
+  if (offsets.size() != 0)
+  {
+    for (unsigned int row = 0; row < n_local_dofs; ++row)
+    {
+      for (int j = offsets[row]; j < offsets[row + 1]; ++j)
+      {
+        double const scaling = calc_localization_scaling(
+            expt_points[indices[j]].distance(support_point(row)));
+        if (scaling > 0.)
+        {
+          _local_observation_indices.push_back(indices[j]);
+          _local_observation_scalings.push_back(scaling);
+        }
+      }
+      _local_observation_offsets[row + 1] = _local_observation_indices.size();
+    }
+  }
+}
+
+std::size_t DataAssimilator::memory_consumption() const
+{
+  // The sample covariance matrix only exists during update_ensemble but it is
+  // the largest object allocated by the data assimilation. Its size is
+  // estimated from the number of entries of the sparsity pattern.
+  std::size_t size =
+      _covariance_sparsity_pattern.memory_consumption() +
+      _covariance_sparsity_pattern.n_nonzero_elements() * sizeof(double);
+  // Each node of the map stores a key, a value, and three pointers.
+  size += _covariance_distance_map.size() *
+          (sizeof(std::pair<unsigned int, unsigned int>) + sizeof(double) +
+           3 * sizeof(void *));
+  size += _pattern_H.memory_consumption() + _H.memory_consumption();
+  size += _locally_owned_dofs.memory_consumption() +
+          dealii::MemoryConsumption::memory_consumption(_support_points) +
+          dealii::MemoryConsumption::memory_consumption(
+              _local_observation_offsets) +
+          dealii::MemoryConsumption::memory_consumption(
+              _local_observation_indices) +
+          dealii::MemoryConsumption::memory_consumption(
+              _local_observation_scalings) +
+          _expt_is_owned.capacity() / 8;
+  size += dealii::MemoryConsumption::memory_consumption(
+              _expt_to_dof_mapping.first) +
+          dealii::MemoryConsumption::memory_consumption(
+              _expt_to_dof_mapping.second);
+
+  return size;
+}
+
 dealii::Vector<double> DataAssimilator::calc_Hx(
     dealii::LA::distributed::Vector<double> const &sim_ensemble_member) const
 {
   dealii::Vector<double> out_vec(_expt_size);
 
-  // Loop through the observation map to get the observation indices
-  for (unsigned int i = 0; i < _expt_size; ++i)
+  // Loop through the observation map to get the observation indices. The map
+  // may contain fewer entries than observations in parallel.
+  for (unsigned int i = 0; i < _expt_to_dof_mapping.first.size(); ++i)
   {
     auto sim_index = _expt_to_dof_mapping.second[i];
     auto expt_index = _expt_to_dof_mapping.first[i];
@@ -435,41 +959,110 @@ double DataAssimilator::gaspari_cohn_function(double const r) const
   }
 }
 
-dealii::TrilinosWrappers::SparseMatrix
-DataAssimilator::calc_sample_covariance_sparse(
+double DataAssimilator::calc_localization_scaling(double const dist) const
+{
+  if (_localization_cutoff_function == LocalizationCutoff::gaspari_cohn)
+  {
+    return gaspari_cohn_function(2.0 * dist / _localization_cutoff_distance);
+  }
+  else if (_localization_cutoff_function == LocalizationCutoff::step_function)
+  {
+    if (dist <= _localization_cutoff_distance)
+      return 1.0;
+    else
+      return 0.0;
+  }
+  else
+  {
+    return 1.0;
+  }
+}
+
+dealii::FullMatrix<double> DataAssimilator::calc_ensemble_anomalies(
     std::vector<dealii::LA::distributed::BlockVector<double>> const
         &vec_ensemble) const
 {
   unsigned int const local_size = vec_ensemble[0].locally_owned_size();
+  unsigned int const n_blocks = vec_ensemble[0].n_blocks();
 
-  // Calculate the mean
-  dealii::Vector<double> mean(local_size);
-  auto sum = vec_ensemble[0];
-  for (unsigned int sample = 1; sample < _num_ensemble_members; ++sample)
+  // The anomalies of a dof are stored contiguously so that the covariance
+  // entries are computed from contiguous rows.
+  dealii::FullMatrix<double> anomalies(local_size, _num_ensemble_members);
+  for (unsigned int member = 0; member < _num_ensemble_members; ++member)
   {
-    sum += vec_ensemble[sample];
+    unsigned int row = 0;
+    for (unsigned int b = 0; b < n_blocks; ++b)
+    {
+      auto const &block = vec_ensemble[member].block(b);
+      unsigned int const block_local_size = block.locally_owned_size();
+      for (unsigned int i = 0; i < block_local_size; ++i, ++row)
+        anomalies(row, member) = block.local_element(i);
+    }
   }
-  unsigned int ii = 0;
-  for (auto index : sum.locally_owned_elements())
+
+  for (unsigned int row = 0; row < local_size; ++row)
   {
-    mean[ii] = sum[index] / _num_ensemble_members;
-    ++ii;
+    double *anomalies_row = &anomalies(row, 0);
+    double mean = 0.;
+    for (unsigned int k = 0; k < _num_ensemble_members; ++k)
+      mean += anomalies_row[k];
+    mean /= _num_ensemble_members;
+    for (unsigned int k = 0; k < _num_ensemble_members; ++k)
+      anomalies_row[k] -= mean;
+  }
+
+  return anomalies;
+}
+
+dealii::TrilinosWrappers::SparseMatrix
+DataAssimilator::calc_sample_covariance_sparse(
+    std::vector<dealii::LA::distributed::BlockVector<double>> const
+        &vec_ensemble) const
+{
+  dealii::IndexSet const locally_owned_elements =
+      vec_ensemble[0].locally_owned_elements();
+  dealii::FullMatrix<double> const anomalies =
+      calc_ensemble_anomalies(vec_ensemble);
+
+  // The rows and the columns associated with the augmented parameters are
+  // dense. They are computed at once using a matrix-matrix product.
+  unsigned int const n_state_rows =
+      locally_owned_elements.get_view(0, _sim_size).n_elements();
+  unsigned int const n_parameter_rows = anomalies.m() - n_state_rows;
+  dealii::FullMatrix<double> parameter_covariance;
+  if (n_parameter_rows > 0)
+  {
+    dealii::FullMatrix<double> parameter_anomalies(n_parameter_rows,
+                                                   _num_ensemble_members);
+    parameter_anomalies.fill(anomalies, 0, 0, n_state_rows, 0);
+    parameter_covariance.reinit(n_parameter_rows, anomalies.m());
+    parameter_anomalies.mTmult(parameter_covariance, anomalies);
   }
 
   dealii::TrilinosWrappers::SparseMatrix cov(_covariance_sparsity_pattern);
 
-  unsigned int pos = 0;
-  for (auto conv_iter = cov.begin(); conv_iter != cov.end(); ++conv_iter, ++pos)
+  for (auto conv_iter = cov.begin(); conv_iter != cov.end(); ++conv_iter)
   {
     unsigned int i = conv_iter->row();
     unsigned int j = conv_iter->column();
+    unsigned int const local_i = locally_owned_elements.index_within_set(i);
+    unsigned int const local_j = locally_owned_elements.index_within_set(j);
 
-    // Do the element-wise matrix multiply by hand
     double element_value = 0;
-    for (unsigned int k = 0; k < _num_ensemble_members; ++k)
+    if (i >= _sim_size)
+    {
+      element_value = parameter_covariance(local_i - n_state_rows, local_j);
+    }
+    else if (j >= _sim_size)
+    {
+      element_value = parameter_covariance(local_j - n_state_rows, local_i);
+    }
+    else
     {
-      element_value +=
-          (vec_ensemble[k][i] - mean[i]) * (vec_ensemble[k][j] - mean[j]);
+      double const *anomalies_i = &anomalies(local_i, 0);
+      double const *anomalies_j = &anomalies(local_j, 0);
+      for (unsigned int k = 0; k < _num_ensemble_members; ++k)
+        element_value += anomalies_i[k] * anomalies_j[k];
     }
 
     element_value /= (_num_ensemble_members - 1.0);
@@ -479,23 +1072,7 @@ DataAssimilator::calc_sample_covariance_sparse(
     if (i < _sim_size && j < _sim_size)
     {
       double dist = _covariance_distance_map.find(std::make_pair(i, j))->second;
-      if (_localization_cutoff_function == LocalizationCutoff::gaspari_cohn)
-      {
-        localization_scaling =
-            gaspari_cohn_function(2.0 * dist / _localization_cutoff_distance);
-      }
-      else if (_localization_cutoff_function ==
-               LocalizationCutoff::step_function)
-      {
-        if (dist <= _localization_cutoff_distance)
-          localization_scaling = 1.0;
-        else
-          localization_scaling = 0.0;
-      }
-      else
-      {
-        localization_scaling = 1.0;
-      }
+      localization_scaling = calc_localization_scaling(dist);
     }
     else
     {
@@ -519,5 +1096,11 @@ template void DataAssimilator::update_covariance_sparsity_pattern<2>(
 template void DataAssimilator::update_covariance_sparsity_pattern<3>(
     dealii::DoFHandler<3> const &dof_handler,
     const unsigned int parameter_size);
+template void DataAssimilator::update_local_observations<2>(
+    MPI_Comm const &communicator,
+    std::vector<dealii::Point<2>> const &expt_points);
+template void DataAssimilator::update_local_observations<3>(
+    MPI_Comm const &communicator,
+    std::vector<dealii::Point<3>> const &expt_points);
 
 } // namespace adamantine
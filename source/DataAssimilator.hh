@@ -39,6 +39,23 @@ enum class LocalizationCutoff
   none
 };
 
+/**
+ * Enum for the different ensemble filters. The 'enkf' option corresponds to
+ * the stochastic ensemble Kalman filter with perturbed observations. The
+ * 'etkf' option corresponds to the ensemble transform Kalman filter which
+ * performs the analysis in the space spanned by the ensemble members, see Hunt,
+ * Kostelich, and Szunyogh, Physica D, 230, 2007. The 'letkf' option corresponds
+ * to the local ensemble transform Kalman filter from the same reference, where
+ * the analysis of each dof only uses the observations within the localization
+ * cutoff distance.
+ */
+enum class EnsembleFilter
+{
+  enkf,
+  etkf,
+  letkf
+};
+
 enum class AugmentedStateParameters
 {
   beam_0_absorption,
@@ -93,7 +110,8 @@ public:
    * This updates the internal mapping between the indices of the entries in
    * expt_data and the indices of the entries in the sim_data ensemble members
    * in updateEnsemble. This must be called before updateEnsemble whenever there
-   * are changes to the simulation mesh or the observation locations.
+   * are changes to the simulation mesh or the observation locations. The
+   * observation matrix is only rebuilt if the mapping has changed.
    */
   template <int dim>
   void update_dof_mapping(
@@ -109,6 +127,27 @@ public:
   update_covariance_sparsity_pattern(dealii::DoFHandler<dim> const &dof_handler,
                                      const unsigned int parameter_size);
 
+  /**
+   * This updates the processor that evaluates each observation when using the
+   * ETKF or the LETKF and, for the LETKF, the observations used by the local
+   * analysis of each locally owned dof. It does nothing for the EnKF. This
+   * must be called before updateEnsemble whenever the observations change,
+   * after update_dof_mapping and update_covariance_sparsity_pattern. The
+   * number of observations is given by @p expt_points, so it is the same on
+   * all the processors, including those without locally owned dofs.
+   */
+  template <int dim>
+  void update_local_observations(
+      MPI_Comm const &communicator,
+      std::vector<dealii::Point<dim>> const &expt_points);
+
+  /**
+   * Return an estimate of the memory in bytes used by the covariance sparsity
+   * pattern, the covariance matrix assembled during an update, the distance
+   * map, the observation matrix, and the local observations.
+   */
+  std::size_t memory_consumption() const;
+
 private:
   /**
    * This calculates the Kalman gain and applies it to the perturbed innovation.
@@ -119,6 +158,59 @@ private:
       dealii::SparseMatrix<double> const &R,
       std::vector<dealii::Vector<double>> const &perturbed_innovation);
 
+  /**
+   * This updates the ensemble using the ensemble transform Kalman filter. The
+   * analysis is performed in the space spanned by the ensemble members, so
+   * neither the sample covariance nor HPH^T is formed.
+   */
+  void apply_ensemble_transform(
+      MPI_Comm const &communicator,
+      std::vector<dealii::LA::distributed::BlockVector<double>>
+          &augmented_state_ensemble,
+      std::vector<double> const &expt_data,
+      dealii::SparseMatrix<double> const &R, bool const R_is_diagonal);
+
+  /**
+   * This updates the ensemble using the local ensemble transform Kalman
+   * filter. Each processor performs the analysis of its locally owned dofs.
+   * The augmented parameters use all the observations.
+   */
+  void apply_local_ensemble_transform(
+      MPI_Comm const &communicator,
+      std::vector<dealii::LA::distributed::BlockVector<double>>
+          &augmented_state_ensemble,
+      std::vector<double> const &expt_data,
+      dealii::SparseMatrix<double> const &R);
+
+  /**
+   * This calculates the observed ensemble HX in the first N columns of the
+   * returned matrix, which has one row per observation. The last column is
+   * zero. The matrix is the same on all the processors.
+   */
+  dealii::FullMatrix<double> calc_observed_ensemble(
+      MPI_Comm const &communicator,
+      std::vector<dealii::LA::distributed::BlockVector<double>> const
+          &augmented_state_ensemble) const;
+
+  /**
+   * This calculates the transform T - I of the ensemble transform Kalman filter
+   * given Y^T R^-1 Y in the first N columns of @p ensemble_products and
+   * Y^T R^-1 (y - H mean(x)) in the last column. The analysis of the ensemble
+   * is then x + X (T - I).
+   */
+  dealii::FullMatrix<double> calc_ensemble_transform(
+      dealii::FullMatrix<double> const &ensemble_products) const;
+
+  /**
+   * This adds the increments X (T - I) of the row @p row of the @p anomalies,
+   * i.e., of one locally owned element, to the ensemble members.
+   */
+  void add_row_increments(
+      unsigned int const row, dealii::FullMatrix<double> const &anomalies,
+      dealii::FullMatrix<double> const &transform,
+      std::vector<dealii::LA::distributed::BlockVector<double>>
+          &augmented_state_ensemble) const;
+
   /**
    * This calculates the observation matrix.
    */
@@ -149,6 +241,22 @@ private:
    */
   double gaspari_cohn_function(double const r) const;
 
+  /**
+   * This calculates the factor reducing the covariance between two points at
+   * a distance @p dist using the localization cutoff function.
+   */
+  double calc_localization_scaling(double const dist) const;
+
+  /**
+   * This calculates the anomalies, i.e. the deviations from the ensemble mean,
+   * of the locally owned elements of an input ensemble of vectors
+   * (vec_ensemble). The anomalies are stored in a dense matrix with one row
+   * per locally owned element and one column per ensemble member.
+   */
+  dealii::FullMatrix<double> calc_ensemble_anomalies(
+      std::vector<dealii::LA::distributed::BlockVector<double>> const
+          &vec_ensemble) const;
+
   /**
    * This calculates the sample covariance for an input ensemble of vectors
    * (vec_ensemble). Currently this is tied to the simulation ensemble, through
@@ -203,6 +311,44 @@ private:
    */
   LocalizationCutoff _localization_cutoff_function;
 
+  /**
+   * The ensemble filter used to update the ensemble.
+   */
+  EnsembleFilter _ensemble_filter;
+
+  /**
+   * If true, the EnKF factorizes HPH^T+R once per assimilation instead of
+   * using a GMRES solve for each perturbed innovation.
+   */
+  bool _direct_kalman_gain_solve = false;
+
+  /**
+   * The locally owned dofs of the simulation (LETKF only).
+   */
+  dealii::IndexSet _locally_owned_dofs;
+
+  /**
+   * The coordinates of the support points of the locally owned dofs, three per
+   * dof (LETKF only).
+   */
+  std::vector<double> _support_points;
+
+  /**
+   * The observations used by the local analysis of each locally owned dof,
+   * stored in compressed row format, and the associated localization factors
+   * (LETKF only).
+   */
+  std::vector<unsigned int> _local_observation_offsets;
+  std::vector<unsigned int> _local_observation_indices;
+  std::vector<double> _local_observation_scalings;
+
+  /**
+   * Flag set to true for the observations that are evaluated by this
+   * processor, i.e. the observations whose closest dof is locally owned
+   * (LETKF only).
+   */
+  std::vector<bool> _expt_is_owned;
+
   /**
    * The pseudo-random number generator, used for the perturbations to the
    * innovation vectors.
@@ -224,6 +370,22 @@ private:
    */
   std::pair<std::vector<int>, std::vector<int>> _expt_to_dof_mapping;
 
+  /**
+   * The sparsity pattern of the observation matrix.
+   */
+  dealii::SparsityPattern _pattern_H;
+
+  /**
+   * The observation matrix. It is cached between the data assimilations and
+   * it is rebuilt when the observations or the mesh change.
+   */
+  dealii::SparseMatrix<double> _H;
+
+  /**
+   * Flag set to true when _H matches the current observations and mesh.
+   */
+  bool _H_is_up_to_date = false;
+
   /**
    * Standardized settings for the GMRES solver needed for the matrix inversion
    * in the Kalman gain calculation.
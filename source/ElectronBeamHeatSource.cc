@@ -1,4 +1,4 @@
-/* Copyright (c) 2020 - 2022, the adamantine authors.
+/* Copyright (c) 2020 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -22,8 +22,9 @@ ElectronBeamHeatSource<dim>::ElectronBeamHeatSource(
 template <int dim>
 void ElectronBeamHeatSource<dim>::update_time(double time)
 {
-  _beam_center = this->_scan_path.value(time);
-  double segment_power_modifier = this->_scan_path.get_power_modifier(time);
+  double segment_power_modifier = 0.;
+  this->compute_beam_motion(time, _beam_center, _beam_displacement,
+                            segment_power_modifier);
   _alpha =
       -this->_beam.absorption_efficiency * this->_beam.max_power *
       segment_power_modifier * _log_01 /
@@ -34,6 +35,11 @@ template <int dim>
 double ElectronBeamHeatSource<dim>::value(dealii::Point<dim> const &point,
                                           double const height) const
 {
+  // The source averaged along the segment covered by the beam is computed by
+  // the same function as on the device.
+  if (_beam_displacement.norm_square() > 0.)
+    return compute_heat_source(get_data(), &point[0], height);
+
   double const z = point[axis<dim>::z] - height;
   if ((z + this->_beam.depth) < 0.)
   {
@@ -41,15 +47,16 @@ double ElectronBeamHeatSource<dim>::value(dealii::Point<dim> const &point,
   }
   else
   {
-    double const distribution_z = -3. * std::pow(z / this->_beam.depth, 2) -
-                                  2. * (z / this->_beam.depth) + 1.;
+    double const z_over_depth = z / this->_beam.depth;
+    double const distribution_z =
+        -3. * z_over_depth * z_over_depth - 2. * z_over_depth + 1.;
 
-    double xpy_squared =
-        std::pow(point[axis<dim>::x] - _beam_center[axis<dim>::x], 2);
-    if (dim == 3)
+    double const dx = point[axis<dim>::x] - _beam_center[axis<dim>::x];
+    double xpy_squared = dx * dx;
+    if constexpr (dim == 3)
     {
-      xpy_squared +=
-          std::pow(point[axis<dim>::y] - _beam_center[axis<dim>::y], 2);
+      double const dy = point[axis<dim>::y] - _beam_center[axis<dim>::y];
+      xpy_squared += dy * dy;
     }
 
     // Electron beam heat source equation
@@ -60,6 +67,89 @@ double ElectronBeamHeatSource<dim>::value(dealii::Point<dim> const &point,
     return heat_source;
   }
 }
+
+template <int dim>
+template <typename Number>
+dealii::VectorizedArray<Number> ElectronBeamHeatSource<dim>::vectorized_value(
+    dealii::Point<dim, dealii::VectorizedArray<Number>> const &points,
+    double const height) const
+{
+  if (_beam_displacement.norm_square() > 0.)
+  {
+    // The averaged source is evaluated one lane at a time.
+    HeatSourceData<dim> const data = get_data();
+    dealii::VectorizedArray<Number> heat_source;
+    for (unsigned int lane = 0;
+         lane < dealii::VectorizedArray<Number>::size(); ++lane)
+    {
+      double point[dim];
+      for (int d = 0; d < dim; ++d)
+        point[d] = points[d][lane];
+      heat_source[lane] = compute_heat_source(data, point, height);
+    }
+
+    return heat_source;
+  }
+
+  dealii::VectorizedArray<Number> const z = points[axis<dim>::z] - height;
+  dealii::VectorizedArray<Number> const z_over_depth = z / this->_beam.depth;
+  dealii::VectorizedArray<Number> const distribution_z =
+      -3. * z_over_depth * z_over_depth - 2. * z_over_depth + 1.;
+
+  dealii::VectorizedArray<Number> const dx =
+      points[axis<dim>::x] - _beam_center[axis<dim>::x];
+  dealii::VectorizedArray<Number> xpy_squared = dx * dx;
+  if constexpr (dim == 3)
+  {
+    dealii::VectorizedArray<Number> const dy =
+        points[axis<dim>::y] - _beam_center[axis<dim>::y];
+    xpy_squared += dy * dy;
+  }
+
+  // Electron beam heat source equation
+  dealii::VectorizedArray<Number> const heat_source =
+      _alpha * std::exp(_log_01 * xpy_squared / this->_beam.radius_squared) *
+      distribution_z;
+
+  // The source is zero deeper than the depth of the beam.
+  dealii::VectorizedArray<Number> const zero =
+      dealii::make_vectorized_array<Number>(0.);
+  return dealii::compare_and_apply_mask<dealii::SIMDComparison::less_than>(
+      z + this->_beam.depth, zero, zero, heat_source);
+}
+
+template <int dim>
+dealii::VectorizedArray<double> ElectronBeamHeatSource<dim>::value(
+    dealii::Point<dim, dealii::VectorizedArray<double>> const &points,
+    double const height) const
+{
+  return vectorized_value(points, height);
+}
+
+template <int dim>
+dealii::VectorizedArray<float> ElectronBeamHeatSource<dim>::value(
+    dealii::Point<dim, dealii::VectorizedArray<float>> const &points,
+    double const height) const
+{
+  return vectorized_value(points, height);
+}
+
+template <int dim>
+HeatSourceData<dim> ElectronBeamHeatSource<dim>::get_data() const
+{
+  HeatSourceData<dim> data;
+  data.type = HeatSourceType::electron_beam;
+  for (unsigned int d = 0; d < 3; ++d)
+  {
+    data.beam_center[d] = _beam_center[d];
+    data.beam_displacement[d] = _beam_displacement[d];
+  }
+  data.alpha = _alpha;
+  data.depth = this->_beam.depth;
+  data.radius_squared = this->_beam.radius_squared;
+
+  return data;
+}
 } // namespace adamantine
 
 INSTANTIATE_DIM(ElectronBeamHeatSource)
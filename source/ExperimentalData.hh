@@ -30,6 +30,13 @@ public:
    * Return the Points and their associated value (temperature).
    */
   virtual PointsValues<dim> get_points_values() = 0;
+
+  /**
+   * Signal that the mesh has been refined or that cells have been activated
+   * since the last call to get_points_values(). The default implementation
+   * does nothing.
+   */
+  virtual void mesh_changed() {}
 };
 
 } // namespace adamantine
@@ -0,0 +1,196 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef FRAME_PREFETCHER_HH
+#define FRAME_PREFETCHER_HH
+
+#include <utils.hh>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace adamantine
+{
+/**
+ * Read the frames of the experimental data on a helper thread. The frames are
+ * read in order, from the first frame to the last frame, and at most @p
+ * queue_size frames that have not been requested yet are kept in memory. The
+ * thread waits for all the files of a frame to exist before parsing them. The
+ * functions given to the constructor are called on the helper thread.
+ */
+template <typename FrameType>
+class FramePrefetcher
+{
+public:
+  /**
+   * Constructor. @p get_filenames returns the names of the files of a frame
+   * and @p parse_files reads these files. Start reading @p first_frame.
+   */
+  FramePrefetcher(
+      std::function<std::vector<std::string>(unsigned int)> get_filenames,
+      std::function<FrameType(std::vector<std::string> const &)> parse_files,
+      unsigned int first_frame, unsigned int last_frame,
+      unsigned int queue_size);
+
+  FramePrefetcher(FramePrefetcher const &) = delete;
+
+  FramePrefetcher &operator=(FramePrefetcher const &) = delete;
+
+  /**
+   * Destructor. Stop the helper thread even if it is waiting for a file.
+   */
+  ~FramePrefetcher();
+
+  /**
+   * Return the next frame. Block until it has been read. If the helper thread
+   * has failed to read the frame, the exception is rethrown.
+   */
+  FrameType next();
+
+private:
+  /**
+   * Function executed by the helper thread.
+   */
+  void prefetch();
+
+  std::function<std::vector<std::string>(unsigned int)> _get_filenames;
+  std::function<FrameType(std::vector<std::string> const &)> _parse_files;
+  unsigned int _next_frame;
+  unsigned int _last_frame;
+  unsigned int _queue_size;
+  /**
+   * Frames that have been read but not requested yet.
+   */
+  std::deque<FrameType> _frames;
+  /**
+   * Flag set to true when the helper thread has read the last frame or has
+   * failed.
+   */
+  bool _done = false;
+  /**
+   * Flag set to true to stop the helper thread.
+   */
+  bool _stop = false;
+  /**
+   * Exception thrown by the helper thread.
+   */
+  std::exception_ptr _exception;
+  std::mutex _mutex;
+  std::condition_variable _condition_variable;
+  std::thread _thread;
+};
+
+template <typename FrameType>
+FramePrefetcher<FrameType>::FramePrefetcher(
+    std::function<std::vector<std::string>(unsigned int)> get_filenames,
+    std::function<FrameType(std::vector<std::string> const &)> parse_files,
+    unsigned int first_frame, unsigned int last_frame, unsigned int queue_size)
+    : _get_filenames(get_filenames), _parse_files(parse_files),
+      _next_frame(first_frame), _last_frame(last_frame),
+      _queue_size(queue_size)
+{
+  ASSERT_THROW(_queue_size > 0, "The queue of frames cannot be empty.");
+  _thread = std::thread(&FramePrefetcher<FrameType>::prefetch, this);
+}
+
+template <typename FrameType>
+FramePrefetcher<FrameType>::~FramePrefetcher()
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _condition_variable.notify_all();
+  _thread.join();
+}
+
+template <typename FrameType>
+FrameType FramePrefetcher<FrameType>::next()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  _condition_variable.wait(lock, [this] { return !_frames.empty() || _done; });
+  if (_frames.empty())
+  {
+    if (_exception)
+      std::rethrow_exception(_exception);
+    ASSERT_THROW(false, "All the experimental frames have already been read.");
+  }
+
+  FrameType frame = std::move(_frames.front());
+  _frames.pop_front();
+  lock.unlock();
+  // Let the helper thread read the next frame
+  _condition_variable.notify_all();
+
+  return frame;
+}
+
+template <typename FrameType>
+void FramePrefetcher<FrameType>::prefetch()
+{
+  try
+  {
+    for (; _next_frame <= _last_frame; ++_next_frame)
+    {
+      // Wait for room in the queue
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _condition_variable.wait(
+            lock, [this] { return _stop || (_frames.size() < _queue_size); });
+        if (_stop)
+          return;
+      }
+
+      // Wait for the files to be written. Contrary to wait_for_file, the
+      // thread sleeps between checks so that it does not compete with the
+      // simulation.
+      auto const filenames = _get_filenames(_next_frame);
+      for (auto const &filename : filenames)
+      {
+        while (!std::filesystem::exists(filename))
+        {
+          {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_stop)
+              return;
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+      }
+
+      // Parse the files without holding the lock
+      FrameType frame = _parse_files(filenames);
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _frames.push_back(std::move(frame));
+      }
+      _condition_variable.notify_all();
+    }
+  }
+  catch (...)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _exception = std::current_exception();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _done = true;
+  }
+  _condition_variable.notify_all();
+}
+} // namespace adamantine
+
+#endif
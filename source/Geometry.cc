@@ -13,12 +13,223 @@
 #include <types.hh>
 #include <utils.hh>
 
+#include <deal.II/base/mpi.h>
 #include <deal.II/grid/filtered_iterator.h>
 #include <deal.II/grid/grid_generator.h>
 #include <deal.II/grid/grid_in.h>
+#include <deal.II/grid/grid_tools.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
 
 namespace adamantine
 {
+namespace
+{
+/**
+ * Append the vertices and the ids of @p cell_data to @p buffer. Each cell is
+ * stored as its number of vertices, the vertices, the material id (or the
+ * boundary id), and the manifold id.
+ */
+template <int structdim>
+void pack_cell_data(std::vector<dealii::CellData<structdim>> const &cell_data,
+                    std::vector<unsigned int> &buffer)
+{
+  buffer.push_back(cell_data.size());
+  for (auto const &cell : cell_data)
+  {
+    buffer.push_back(cell.vertices.size());
+    buffer.insert(buffer.end(), cell.vertices.begin(), cell.vertices.end());
+    buffer.push_back(cell.material_id);
+    buffer.push_back(cell.manifold_id);
+  }
+}
+
+/**
+ * Extract the cells packed by pack_cell_data() starting at @p pos. @p pos is
+ * moved past the cells.
+ */
+template <int structdim>
+std::vector<dealii::CellData<structdim>>
+unpack_cell_data(std::vector<unsigned int> const &buffer, std::size_t &pos)
+{
+  std::vector<dealii::CellData<structdim>> cell_data(buffer[pos++]);
+  for (auto &cell : cell_data)
+  {
+    cell.vertices.resize(buffer[pos++]);
+    for (auto &vertex : cell.vertices)
+      vertex = buffer[pos++];
+    cell.material_id = buffer[pos++];
+    cell.manifold_id = buffer[pos++];
+  }
+
+  return cell_data;
+}
+
+/**
+ * Read the mesh file with GridIn and pack the description of the coarse mesh
+ * in @p vertices_buffer and @p cells_buffer.
+ */
+template <int dim>
+void read_mesh_file(std::string const &mesh_file,
+                    typename dealii::GridIn<dim>::Format grid_in_format,
+                    std::vector<double> &vertices_buffer,
+                    std::vector<unsigned int> &cells_buffer)
+{
+  dealii::Triangulation<dim> serial_triangulation;
+  dealii::GridIn<dim> grid_in;
+  grid_in.attach_triangulation(serial_triangulation);
+  grid_in.read(mesh_file, grid_in_format);
+  auto const [vertices, cells, subcell_data] =
+      dealii::GridTools::get_coarse_mesh_description(serial_triangulation);
+  vertices_buffer.reserve(dim * vertices.size());
+  for (auto const &vertex : vertices)
+    for (unsigned int d = 0; d < dim; ++d)
+      vertices_buffer.push_back(vertex[d]);
+  pack_cell_data(cells, cells_buffer);
+  pack_cell_data(subcell_data.boundary_lines, cells_buffer);
+  pack_cell_data(subcell_data.boundary_quads, cells_buffer);
+}
+
+// First characters of the coarse mesh cache
+char constexpr mesh_cache_magic[8] = {'a', 'd', 'a', 'm', 'm', 'e', 's', 'h'};
+
+/**
+ * Write the packed coarse mesh in the binary file @p cache_file. The file uses
+ * the endianness of the machine. The file is written with
+ * write_file_atomically.
+ */
+void write_mesh_cache(std::string const &cache_file,
+                      std::vector<double> const &vertices_buffer,
+                      std::vector<unsigned int> const &cells_buffer)
+{
+  write_file_atomically(
+      cache_file,
+      [&](std::string const &tmp_file)
+      {
+        std::ofstream file(tmp_file, std::ios::binary);
+        ASSERT_THROW(file.good(), "Error: Cannot open " + tmp_file + ".");
+        file.write(mesh_cache_magic, sizeof(mesh_cache_magic));
+        std::array<std::uint64_t, 2> const sizes = {
+            {vertices_buffer.size(), cells_buffer.size()}};
+        file.write(reinterpret_cast<char const *>(sizes.data()),
+                   sizeof(sizes));
+        file.write(reinterpret_cast<char const *>(vertices_buffer.data()),
+                   vertices_buffer.size() * sizeof(double));
+        file.write(reinterpret_cast<char const *>(cells_buffer.data()),
+                   cells_buffer.size() * sizeof(unsigned int));
+        file.close();
+        ASSERT_THROW(file.good(), "Error: Cannot write " + tmp_file + ".");
+      });
+}
+
+/**
+ * Read the packed coarse mesh written by write_mesh_cache().
+ */
+void read_mesh_cache(std::string const &cache_file,
+                     std::vector<double> &vertices_buffer,
+                     std::vector<unsigned int> &cells_buffer)
+{
+  std::ifstream file(cache_file, std::ios::binary);
+  std::array<char, sizeof(mesh_cache_magic)> magic;
+  std::array<std::uint64_t, 2> sizes = {{0, 0}};
+  file.read(magic.data(), magic.size());
+  file.read(reinterpret_cast<char *>(sizes.data()), sizeof(sizes));
+  ASSERT_THROW(file.good() &&
+                   std::equal(magic.begin(), magic.end(), mesh_cache_magic),
+               "Error: " + cache_file + " is not a mesh cache.");
+  vertices_buffer.resize(sizes[0]);
+  cells_buffer.resize(sizes[1]);
+  file.read(reinterpret_cast<char *>(vertices_buffer.data()),
+            vertices_buffer.size() * sizeof(double));
+  file.read(reinterpret_cast<char *>(cells_buffer.data()),
+            cells_buffer.size() * sizeof(unsigned int));
+  ASSERT_THROW(file.good(), "Error: " + cache_file + " is truncated.");
+}
+
+/**
+ * Read the mesh on the first processor of @p communicator and create the
+ * coarse mesh of @p triangulation on all the processors. The file is parsed
+ * only once and the description of the coarse cells is broadcast, instead of
+ * reading the file in a serial Triangulation on every processor and copying
+ * it. If @p cache_file is not empty, the description of the coarse cells is
+ * read from @p cache_file when it exists and it is written to it otherwise.
+ */
+template <int dim>
+void read_mesh(MPI_Comm const &communicator, std::string const &mesh_file,
+               typename dealii::GridIn<dim>::Format grid_in_format,
+               std::string const &cache_file,
+               dealii::parallel::distributed::Triangulation<dim> &triangulation)
+{
+  unsigned int const root = 0;
+  std::vector<double> vertices_buffer;
+  std::vector<unsigned int> cells_buffer;
+  std::string error_message;
+  if (dealii::Utilities::MPI::this_mpi_process(communicator) == root)
+  {
+    // The error is thrown on all the processors after the broadcast.
+    try
+    {
+      if (!cache_file.empty() && std::filesystem::exists(cache_file))
+      {
+        read_mesh_cache(cache_file, vertices_buffer, cells_buffer);
+      }
+      else
+      {
+        read_mesh_file<dim>(mesh_file, grid_in_format, vertices_buffer,
+                            cells_buffer);
+        if (!cache_file.empty())
+          write_mesh_cache(cache_file, vertices_buffer, cells_buffer);
+      }
+    }
+    catch (std::exception const &exception)
+    {
+      error_message = exception.what();
+    }
+  }
+
+  // Broadcast the size of the buffers and then the buffers. The broadcast of
+  // the buffers is split in chunks if they are too large for a single MPI
+  // call.
+  std::array<std::size_t, 3> buffer_sizes = {
+      {vertices_buffer.size(), cells_buffer.size(), error_message.size()}};
+  dealii::Utilities::MPI::broadcast(buffer_sizes.data(), buffer_sizes.size(),
+                                    root, communicator);
+  if (buffer_sizes[2] > 0)
+  {
+    error_message.resize(buffer_sizes[2]);
+    dealii::Utilities::MPI::broadcast(error_message.data(),
+                                      error_message.size(), root, communicator);
+    ASSERT_THROW(false, "Error: Cannot read the mesh " + mesh_file + ". " +
+                            error_message);
+  }
+  vertices_buffer.resize(buffer_sizes[0]);
+  cells_buffer.resize(buffer_sizes[1]);
+  dealii::Utilities::MPI::broadcast(vertices_buffer.data(),
+                                    vertices_buffer.size(), root, communicator);
+  dealii::Utilities::MPI::broadcast(cells_buffer.data(), cells_buffer.size(),
+                                    root, communicator);
+
+  std::vector<dealii::Point<dim>> vertices(vertices_buffer.size() / dim);
+  for (unsigned int i = 0; i < vertices.size(); ++i)
+    for (unsigned int d = 0; d < dim; ++d)
+      vertices[i][d] = vertices_buffer[dim * i + d];
+  std::size_t pos = 0;
+  auto const cells = unpack_cell_data<dim>(cells_buffer, pos);
+  dealii::SubCellData subcell_data;
+  subcell_data.boundary_lines = unpack_cell_data<1>(cells_buffer, pos);
+  subcell_data.boundary_quads = unpack_cell_data<2>(cells_buffer, pos);
+
+  triangulation.create_triangulation(vertices, cells, subcell_data);
+}
+} // namespace
+
 template <int dim>
 Geometry<dim>::Geometry(MPI_Comm const &communicator,
                         boost::property_tree::ptree const &database)
@@ -33,9 +244,6 @@ Geometry<dim>::Geometry(MPI_Comm const &communicator,
     std::string mesh_file = database.get<std::string>("mesh_file");
     // PropertyTreeInput geometry.mesh_format
     std::string mesh_format = database.get<std::string>("mesh_format");
-    dealii::Triangulation<dim> serial_triangulation;
-    dealii::GridIn<dim> grid_in;
-    grid_in.attach_triangulation(serial_triangulation);
     typename dealii::GridIn<dim>::Format grid_in_format;
     if (mesh_format == "abaqus")
     {
@@ -86,8 +294,10 @@ Geometry<dim>::Geometry(MPI_Comm const &communicator,
       grid_in_format = dealii::GridIn<dim>::Format::Default;
     }
 
-    grid_in.read(mesh_file, grid_in_format);
-    _triangulation.copy_triangulation(serial_triangulation);
+    // PropertyTreeInput geometry.coarse_mesh_cache_file
+    std::string const cache_file = database.get("coarse_mesh_cache_file", "");
+    read_mesh(communicator, mesh_file, grid_in_format, cache_file,
+              _triangulation);
   }
   else
   {
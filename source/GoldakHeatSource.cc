@@ -1,4 +1,4 @@
-/* Copyright (c) 2020 - 2022, the adamantine authors.
+/* Copyright (c) 2020 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -22,8 +22,9 @@ GoldakHeatSource<dim>::GoldakHeatSource(
 template <int dim>
 void GoldakHeatSource<dim>::update_time(double time)
 {
-  _beam_center = this->_scan_path.value(time);
-  double segment_power_modifier = this->_scan_path.get_power_modifier(time);
+  double segment_power_modifier = 0.;
+  this->compute_beam_motion(time, _beam_center, _beam_displacement,
+                            segment_power_modifier);
   _alpha = 2.0 * this->_beam.absorption_efficiency * this->_beam.max_power *
            segment_power_modifier /
            (this->_beam.radius_squared * this->_beam.depth * _pi_over_3_to_1p5);
@@ -33,6 +34,11 @@ template <int dim>
 double GoldakHeatSource<dim>::value(dealii::Point<dim> const &point,
                                     double const height) const
 {
+  // The source averaged along the segment covered by the beam is computed by
+  // the same function as on the device.
+  if (_beam_displacement.norm_square() > 0.)
+    return compute_heat_source(get_data(), &point[0], height);
+
   double const z = point[axis<dim>::z] - height;
   if ((z + this->_beam.depth) < 0.)
   {
@@ -40,21 +46,102 @@ double GoldakHeatSource<dim>::value(dealii::Point<dim> const &point,
   }
   else
   {
-    double xpy_squared =
-        std::pow(point[axis<dim>::x] - _beam_center[axis<dim>::x], 2);
-    if (dim == 3)
+    double const dx = point[axis<dim>::x] - _beam_center[axis<dim>::x];
+    double xpy_squared = dx * dx;
+    if constexpr (dim == 3)
     {
-      xpy_squared +=
-          std::pow(point[axis<dim>::y] - _beam_center[axis<dim>::y], 2);
+      double const dy = point[axis<dim>::y] - _beam_center[axis<dim>::y];
+      xpy_squared += dy * dy;
     }
+    double const z_over_depth = z / this->_beam.depth;
 
     // Goldak heat source equation
     double heat_source =
         _alpha * std::exp(-3.0 * xpy_squared / this->_beam.radius_squared +
-                          -3.0 * std::pow(z / this->_beam.depth, 2));
+                          -3.0 * z_over_depth * z_over_depth);
+
+    return heat_source;
+  }
+}
+
+template <int dim>
+template <typename Number>
+dealii::VectorizedArray<Number> GoldakHeatSource<dim>::vectorized_value(
+    dealii::Point<dim, dealii::VectorizedArray<Number>> const &points,
+    double const height) const
+{
+  if (_beam_displacement.norm_square() > 0.)
+  {
+    // The averaged source is evaluated one lane at a time.
+    HeatSourceData<dim> const data = get_data();
+    dealii::VectorizedArray<Number> heat_source;
+    for (unsigned int lane = 0;
+         lane < dealii::VectorizedArray<Number>::size(); ++lane)
+    {
+      double point[dim];
+      for (int d = 0; d < dim; ++d)
+        point[d] = points[d][lane];
+      heat_source[lane] = compute_heat_source(data, point, height);
+    }
 
     return heat_source;
   }
+
+  dealii::VectorizedArray<Number> const z = points[axis<dim>::z] - height;
+  dealii::VectorizedArray<Number> const dx =
+      points[axis<dim>::x] - _beam_center[axis<dim>::x];
+  dealii::VectorizedArray<Number> xpy_squared = dx * dx;
+  if constexpr (dim == 3)
+  {
+    dealii::VectorizedArray<Number> const dy =
+        points[axis<dim>::y] - _beam_center[axis<dim>::y];
+    xpy_squared += dy * dy;
+  }
+  dealii::VectorizedArray<Number> const z_over_depth = z / this->_beam.depth;
+
+  // Goldak heat source equation
+  dealii::VectorizedArray<Number> const heat_source =
+      _alpha * std::exp(-3.0 * xpy_squared / this->_beam.radius_squared +
+                        -3.0 * z_over_depth * z_over_depth);
+
+  // The source is zero deeper than the depth of the beam.
+  dealii::VectorizedArray<Number> const zero =
+      dealii::make_vectorized_array<Number>(0.);
+  return dealii::compare_and_apply_mask<dealii::SIMDComparison::less_than>(
+      z + this->_beam.depth, zero, zero, heat_source);
+}
+
+template <int dim>
+dealii::VectorizedArray<double> GoldakHeatSource<dim>::value(
+    dealii::Point<dim, dealii::VectorizedArray<double>> const &points,
+    double const height) const
+{
+  return vectorized_value(points, height);
+}
+
+template <int dim>
+dealii::VectorizedArray<float> GoldakHeatSource<dim>::value(
+    dealii::Point<dim, dealii::VectorizedArray<float>> const &points,
+    double const height) const
+{
+  return vectorized_value(points, height);
+}
+
+template <int dim>
+HeatSourceData<dim> GoldakHeatSource<dim>::get_data() const
+{
+  HeatSourceData<dim> data;
+  data.type = HeatSourceType::goldak;
+  for (unsigned int d = 0; d < 3; ++d)
+  {
+    data.beam_center[d] = _beam_center[d];
+    data.beam_displacement[d] = _beam_displacement[d];
+  }
+  data.alpha = _alpha;
+  data.depth = this->_beam.depth;
+  data.radius_squared = this->_beam.radius_squared;
+
+  return data;
 }
 } // namespace adamantine
 
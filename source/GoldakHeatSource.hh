@@ -1,4 +1,4 @@
-/* Copyright (c) 2020 - 2022, the adamantine authors.
+/* Copyright (c) 2020 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -45,8 +45,37 @@ public:
   double value(dealii::Point<dim> const &point,
                double const height) const final;
 
+  /**
+   * Returns the value of the heat source at a batch of points.
+   */
+  dealii::VectorizedArray<double>
+  value(dealii::Point<dim, dealii::VectorizedArray<double>> const &points,
+        double const height) const final;
+
+  /**
+   * Returns the value of the heat source at a batch of single precision
+   * points.
+   */
+  dealii::VectorizedArray<float>
+  value(dealii::Point<dim, dealii::VectorizedArray<float>> const &points,
+        double const height) const final;
+
+  /**
+   * Return the description of the heat source at the current time.
+   */
+  HeatSourceData<dim> get_data() const final;
+
 private:
+  /**
+   * Implementation of the batched value functions.
+   */
+  template <typename Number>
+  dealii::VectorizedArray<Number> vectorized_value(
+      dealii::Point<dim, dealii::VectorizedArray<Number>> const &points,
+      double const height) const;
+
   dealii::Point<3> _beam_center;
+  dealii::Tensor<1, 3> _beam_displacement;
   double _alpha;
   double const _pi_over_3_to_1p5 = std::pow(dealii::numbers::PI / 3.0, 1.5);
 };
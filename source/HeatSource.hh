@@ -1,4 +1,4 @@
-/* Copyright (c) 2020 - 2021, the adamantine authors.
+/* Copyright (c) 2020 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -9,10 +9,15 @@
 #define HEAT_SOURCE_HH
 
 #include <BeamHeatSourceProperties.hh>
+#include <HeatSourceData.hh>
 #include <ScanPath.hh>
 #include <types.hh>
 
 #include <deal.II/base/point.h>
+#include <deal.II/base/tensor.h>
+#include <deal.II/base/vectorization.h>
+
+#include <algorithm>
 
 namespace adamantine
 {
@@ -74,6 +79,29 @@ public:
    */
   virtual double value(dealii::Point<dim> const &point,
                        double const height) const = 0;
+
+  /**
+   * Compute the heat source at all the points of a batch given the current
+   * height of the object being manufactured. A single virtual call evaluates
+   * every lane of @p points.
+   */
+  virtual dealii::VectorizedArray<double>
+  value(dealii::Point<dim, dealii::VectorizedArray<double>> const &points,
+        double const height) const = 0;
+
+  /**
+   * Same as above for a batch of single precision points.
+   */
+  virtual dealii::VectorizedArray<float>
+  value(dealii::Point<dim, dealii::VectorizedArray<float>> const &points,
+        double const height) const = 0;
+
+  /**
+   * Return the description of the heat source at the current time as plain old
+   * data that can be copied to and evaluated on the device.
+   */
+  virtual HeatSourceData<dim> get_data() const = 0;
+
   /**
    * Return the scan path for the heat source.
    */
@@ -91,7 +119,28 @@ public:
    */
   virtual void set_beam_properties(boost::property_tree::ptree const &database);
 
+  /**
+   * Average the source over the interval [@p start_time, @p end_time] when
+   * update_time is called with a time inside the interval. The beam is assumed
+   * to move along the straight segment between its positions at both ends of
+   * the interval and the power is averaged over the interval. Outside of the
+   * interval, the source is evaluated at the given time.
+   */
+  void set_time_integration_interval(double const start_time,
+                                     double const end_time);
+
 protected:
+  /**
+   * Compute the position of the beam, its displacement, and the power modifier
+   * at @p time. If @p time is inside the time integration interval, the
+   * position is the one at the start of the interval, the displacement the one
+   * during the interval, and the power modifier is averaged over the interval.
+   * Otherwise, the displacement is zero.
+   */
+  void compute_beam_motion(double const time, dealii::Point<3> &beam_center,
+                           dealii::Tensor<1, 3> &beam_displacement,
+                           double &power_modifier) const;
+
   /**
    * Structure of the physical properties of the beam heat source.
    */
@@ -101,6 +150,16 @@ protected:
    * The scan path for the heat source.
    */
   ScanPath _scan_path;
+
+  /**
+   * Start of the time integration interval.
+   */
+  double _integration_start_time = 0.;
+
+  /**
+   * End of the time integration interval.
+   */
+  double _integration_end_time = 0.;
 };
 
 template <int dim>
@@ -122,6 +181,41 @@ inline void HeatSource<dim>::set_beam_properties(
   _beam.set_from_database(database);
 }
 
+template <int dim>
+inline void
+HeatSource<dim>::set_time_integration_interval(double const start_time,
+                                               double const end_time)
+{
+  _integration_start_time = start_time;
+  _integration_end_time = end_time;
+}
+
+template <int dim>
+inline void HeatSource<dim>::compute_beam_motion(
+    double const time, dealii::Point<3> &beam_center,
+    dealii::Tensor<1, 3> &beam_displacement, double &power_modifier) const
+{
+  if ((_integration_end_time > _integration_start_time) &&
+      (time >= _integration_start_time) && (time <= _integration_end_time))
+  {
+    // The beam does not move after the end of the scan path.
+    double const scan_end_time = _scan_path.get_segment_list().back().end_time;
+    double const end_time = std::min(_integration_end_time, scan_end_time);
+    beam_center = _scan_path.value(_integration_start_time);
+    beam_displacement = end_time > _integration_start_time
+                            ? _scan_path.value(end_time) - beam_center
+                            : dealii::Tensor<1, 3>();
+    power_modifier = _scan_path.get_average_power_modifier(
+        _integration_start_time, _integration_end_time);
+  }
+  else
+  {
+    beam_center = _scan_path.value(time);
+    beam_displacement = dealii::Tensor<1, 3>();
+    power_modifier = _scan_path.get_power_modifier(time);
+  }
+}
+
 } // namespace adamantine
 
 #endif
@@ -0,0 +1,236 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef HEAT_SOURCE_DATA_HH
+#define HEAT_SOURCE_DATA_HH
+
+#include <types.hh>
+#include <utils.hh>
+
+#include <algorithm>
+#include <cmath>
+
+namespace adamantine
+{
+/**
+ * Enum on the different types of heat source.
+ */
+enum class HeatSourceType
+{
+  goldak,
+  electron_beam,
+  cube
+};
+
+/**
+ * Plain old data describing a heat source at a given time. Contrary to
+ * HeatSource, this structure does not have virtual functions and it can be
+ * copied to and evaluated on the device.
+ */
+template <int dim>
+struct HeatSourceData
+{
+  /**
+   * Type of the heat source.
+   */
+  HeatSourceType type = HeatSourceType::goldak;
+  /**
+   * Current position of the beam (Goldak and electron beam only).
+   */
+  double beam_center[3] = {0., 0., 0.};
+  /**
+   * Displacement of the beam during the time integration interval (Goldak and
+   * electron beam only). If it is not zero, the source is averaged along the
+   * segment between beam_center and beam_center + beam_displacement.
+   */
+  double beam_displacement[3] = {0., 0., 0.};
+  /**
+   * Scaling factor of the beam at the current time (Goldak and electron beam
+   * only).
+   */
+  double alpha = 0.;
+  /**
+   * Depth of the beam (Goldak and electron beam only).
+   */
+  double depth = 0.;
+  /**
+   * Square of the beam radius (Goldak and electron beam only).
+   */
+  double radius_squared = 0.;
+  /**
+   * Value of the source inside the cube (cube only).
+   */
+  double value = 0.;
+  /**
+   * Corners of the cube (cube only).
+   */
+  double min_point[dim] = {};
+  double max_point[dim] = {};
+};
+
+/**
+ * Compute the lateral distribution exp(-coefficient r^2 / R^2) of the beam
+ * described by @p source at @p point, where r is the distance to the center of
+ * the beam in the plane of the scan path and R the radius of the beam. If the
+ * beam moves during the time integration interval, the distribution is
+ * averaged analytically along the segment covered by the beam.
+ */
+template <int dim>
+ADAMANTINE_HOST_DEV inline double
+compute_lateral_distribution(HeatSourceData<dim> const &source,
+                             double const *point, double const coefficient)
+{
+  double const dx = point[axis<dim>::x] - source.beam_center[axis<dim>::x];
+  double const ex = source.beam_displacement[axis<dim>::x];
+  double xpy_squared = dx * dx;
+  double along = dx * ex;
+  double length_squared = ex * ex;
+  if constexpr (dim == 3)
+  {
+    double const dy = point[axis<dim>::y] - source.beam_center[axis<dim>::y];
+    double const ey = source.beam_displacement[axis<dim>::y];
+    xpy_squared += dy * dy;
+    along += dy * ey;
+    length_squared += ey * ey;
+  }
+
+  // When the beam moves by less than a tenth of its radius, the distribution
+  // at the middle of the segment is accurate enough. This also avoids the
+  // cancellation in the difference of the error functions.
+  if (length_squared < 1e-2 * source.radius_squared)
+  {
+    return std::exp(-coefficient *
+                    (xpy_squared - along + 0.25 * length_squared) /
+                    source.radius_squared);
+  }
+
+  double const length = std::sqrt(length_squared);
+  along /= length;
+  double const difference = xpy_squared - along * along;
+  double const normal_squared = difference > 0. ? difference : 0.;
+  double const scaling = std::sqrt(coefficient / source.radius_squared);
+  double constexpr sqrt_pi = 1.772453850905516027;
+
+  return std::exp(-coefficient * normal_squared / source.radius_squared) *
+         sqrt_pi / (2. * scaling * length) *
+         (std::erf(scaling * along) - std::erf(scaling * (along - length)));
+}
+
+/**
+ * Compute the value of the heat source described by @p source at @p point
+ * given the current @p height of the object being manufactured. This function
+ * matches HeatSource::value for each type of heat source.
+ */
+template <int dim>
+ADAMANTINE_HOST_DEV inline double
+compute_heat_source(HeatSourceData<dim> const &source, double const *point,
+                    double const height)
+{
+  if (source.type == HeatSourceType::cube)
+  {
+    for (int i = 0; i < dim; ++i)
+    {
+      if ((point[i] < source.min_point[i]) || (point[i] > source.max_point[i]))
+        return 0.;
+    }
+
+    return source.value;
+  }
+
+  double const z = point[axis<dim>::z] - height;
+  if ((z + source.depth) < 0.)
+    return 0.;
+
+  double const z_over_depth = z / source.depth;
+
+  if (source.type == HeatSourceType::goldak)
+  {
+    return source.alpha * compute_lateral_distribution(source, point, 3.0) *
+           std::exp(-3.0 * z_over_depth * z_over_depth);
+  }
+
+  // Electron beam
+  double constexpr log_01 = -2.302585092994045684;
+  double const distribution_z =
+      -3. * z_over_depth * z_over_depth - 2. * z_over_depth + 1.;
+
+  return source.alpha * compute_lateral_distribution(source, point, -log_01) *
+         distribution_z;
+}
+
+/**
+ * Compute the axis-aligned box, in the coordinates of the mesh, outside of
+ * which the heat source described by @p source is smaller than @p cutoff given
+ * the current @p height of the object being manufactured. The corners of the
+ * box are written in @p min_point and @p max_point. Return false if the source
+ * is smaller than @p cutoff everywhere. For the electron beam, the box stops at
+ * a third of the depth above @p height, where the vertical distribution becomes
+ * negative.
+ */
+template <int dim>
+inline bool compute_heat_source_bounding_box(HeatSourceData<dim> const &source,
+                                             double const height,
+                                             double const cutoff,
+                                             double *min_point,
+                                             double *max_point)
+{
+  if (source.type == HeatSourceType::cube)
+  {
+    if (source.value == 0.)
+      return false;
+
+    for (int i = 0; i < dim; ++i)
+    {
+      min_point[i] = source.min_point[i];
+      max_point[i] = source.max_point[i];
+    }
+
+    return true;
+  }
+
+  double constexpr log_01 = -2.302585092994045684;
+  // The maximum of the vertical distribution of the electron beam is 4/3.
+  double const max_value = source.type == HeatSourceType::goldak
+                               ? source.alpha
+                               : 4. / 3. * source.alpha;
+  if (!(max_value > cutoff))
+    return false;
+
+  double const log_ratio = std::log(max_value / cutoff);
+  double radius = 0.;
+  if (source.type == HeatSourceType::goldak)
+  {
+    radius = std::sqrt(source.radius_squared * log_ratio / 3.);
+    double const half_height = source.depth * std::sqrt(log_ratio / 3.);
+    min_point[axis<dim>::z] = height - std::min(source.depth, half_height);
+    max_point[axis<dim>::z] = height + half_height;
+  }
+  else
+  {
+    radius = std::sqrt(source.radius_squared * log_ratio / -log_01);
+    min_point[axis<dim>::z] = height - source.depth;
+    max_point[axis<dim>::z] = height + source.depth / 3.;
+  }
+
+  // The box covers the segment traveled by the beam during the time
+  // integration interval.
+  auto const lateral_bounds = [&](int const i)
+  {
+    double const start = source.beam_center[i];
+    double const end = start + source.beam_displacement[i];
+    min_point[i] = std::min(start, end) - radius;
+    max_point[i] = std::max(start, end) + radius;
+  };
+  lateral_bounds(axis<dim>::x);
+  if constexpr (dim == 3)
+    lateral_bounds(axis<dim>::y);
+
+  return true;
+}
+} // namespace adamantine
+
+#endif
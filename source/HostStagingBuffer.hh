@@ -0,0 +1,158 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef HOST_STAGING_BUFFER_HH
+#define HOST_STAGING_BUFFER_HH
+
+#include <MemoryBlockView.hh>
+#include <utils.hh>
+
+#include <deal.II/base/memory_space.h>
+
+#include <vector>
+
+namespace adamantine
+{
+/**
+ * Buffer on the host used to stage the data of a MemoryBlock that lives in @p
+ * MemorySpaceType, e.g. to transfer the data using deal.II functions that only
+ * work on the host. On the host, the copies are synchronous. On the device, the
+ * buffer is pinned and the copies are asynchronous so that they can overlap
+ * with work on the host. wait() needs to be called before the data on the
+ * destination is used.
+ */
+template <typename Number, typename MemorySpaceType>
+class HostStagingBuffer
+{
+public:
+  /**
+   * Resize the buffer. The memory is only reallocated if the buffer grows.
+   */
+  void reinit(unsigned int dim_0, unsigned int dim_1 = 0)
+  {
+    _dim_0 = dim_0;
+    _dim_1 = dim_1;
+    _data.resize(dim_1 == 0 ? dim_0 : dim_0 * dim_1);
+  }
+
+  /**
+   * Copy the data of @p input to the buffer.
+   */
+  void copy_from(Number const *input)
+  {
+    deep_copy(_data.data(), dealii::MemorySpace::Host{}, input,
+              dealii::MemorySpace::Host{}, _data.size());
+  }
+
+  /**
+   * Copy the data of the buffer to @p output.
+   */
+  void copy_to(Number *output) const
+  {
+    deep_copy(output, dealii::MemorySpace::Host{}, _data.data(),
+              dealii::MemorySpace::Host{}, _data.size());
+  }
+
+  /**
+   * Wait for the copies to be done.
+   */
+  void wait() const {}
+
+  /**
+   * Return a view of the buffer.
+   */
+  MemoryBlockView<Number, dealii::MemorySpace::Host> get_view()
+  {
+    return MemoryBlockView<Number, dealii::MemorySpace::Host>(_data.data(),
+                                                              _dim_0, _dim_1);
+  }
+
+private:
+  unsigned int _dim_0 = 0;
+  unsigned int _dim_1 = 0;
+  std::vector<Number> _data;
+};
+
+#ifdef __CUDACC__
+template <typename Number>
+class HostStagingBuffer<Number, dealii::MemorySpace::CUDA>
+{
+public:
+  HostStagingBuffer()
+  {
+    // The stream does not synchronize with the default stream. The copies
+    // explicitly wait for the work already launched on the default stream.
+    AssertCuda(cudaStreamCreateWithFlags(&_stream, cudaStreamNonBlocking));
+    AssertCuda(cudaEventCreateWithFlags(&_event, cudaEventDisableTiming));
+  }
+
+  HostStagingBuffer(HostStagingBuffer const &) = delete;
+
+  HostStagingBuffer &operator=(HostStagingBuffer const &) = delete;
+
+  ~HostStagingBuffer()
+  {
+    cudaStreamSynchronize(_stream);
+    if (_data != nullptr)
+      cudaFreeHost(_data);
+    cudaEventDestroy(_event);
+    cudaStreamDestroy(_stream);
+  }
+
+  void reinit(unsigned int dim_0, unsigned int dim_1 = 0)
+  {
+    _dim_0 = dim_0;
+    _dim_1 = dim_1;
+    _size = dim_1 == 0 ? dim_0 : dim_0 * dim_1;
+    if (_size > _capacity)
+    {
+      AssertCuda(cudaStreamSynchronize(_stream));
+      if (_data != nullptr)
+        AssertCuda(cudaFreeHost(_data));
+      AssertCuda(cudaMallocHost(reinterpret_cast<void **>(&_data),
+                                _size * sizeof(Number)));
+      _capacity = _size;
+    }
+  }
+
+  void copy_from(Number const *input)
+  {
+    AssertCuda(cudaEventRecord(_event, 0));
+    AssertCuda(cudaStreamWaitEvent(_stream, _event, 0));
+    AssertCuda(cudaMemcpyAsync(_data, input, _size * sizeof(Number),
+                               cudaMemcpyDeviceToHost, _stream));
+  }
+
+  void copy_to(Number *output) const
+  {
+    AssertCuda(cudaEventRecord(_event, 0));
+    AssertCuda(cudaStreamWaitEvent(_stream, _event, 0));
+    AssertCuda(cudaMemcpyAsync(output, _data, _size * sizeof(Number),
+                               cudaMemcpyHostToDevice, _stream));
+  }
+
+  void wait() const { AssertCuda(cudaStreamSynchronize(_stream)); }
+
+  MemoryBlockView<Number, dealii::MemorySpace::Host> get_view()
+  {
+    return MemoryBlockView<Number, dealii::MemorySpace::Host>(_data, _dim_0,
+                                                              _dim_1);
+  }
+
+private:
+  unsigned int _dim_0 = 0;
+  unsigned int _dim_1 = 0;
+  unsigned int _size = 0;
+  unsigned int _capacity = 0;
+  Number *_data = nullptr;
+  cudaStream_t _stream;
+  cudaEvent_t _event;
+};
+#endif
+} // namespace adamantine
+
+#endif
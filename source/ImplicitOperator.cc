@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2021, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -9,6 +9,8 @@
 #include <instantiation.hh>
 #include <utils.hh>
 
+#include <type_traits>
+
 namespace adamantine
 {
 template <typename MemorySpaceType>
@@ -23,6 +25,8 @@ void ImplicitOperator<MemorySpaceType>::vmult(
     dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
     dealii::LA::distributed::Vector<double, MemorySpaceType> const &src) const
 {
+  ASSERT(_inverse_mass_matrix != nullptr,
+         "The inverse of the mass matrix has not been set.");
   if (_jfnk == true)
   {
     dealii::LA::distributed::Vector<double, MemorySpaceType> tmp_dst(
@@ -69,6 +73,28 @@ void ImplicitOperator<MemorySpaceType>::Tvmult_add(
   ASSERT_THROW_NOT_IMPLEMENTED();
 }
 
+template <typename MemorySpaceType>
+void ImplicitOperator<MemorySpaceType>::compute_inverse_diagonal(
+    dealii::LA::distributed::Vector<double, MemorySpaceType> &diagonal) const
+{
+  ASSERT(_inverse_mass_matrix != nullptr,
+         "The inverse of the mass matrix has not been set.");
+  diagonal.scale(*_inverse_mass_matrix);
+  diagonal *= -_tau;
+  diagonal.add(1.);
+
+  if constexpr (std::is_same_v<MemorySpaceType, dealii::MemorySpace::Host>)
+  {
+    unsigned int const local_size = diagonal.locally_owned_size();
+    for (unsigned int i = 0; i < local_size; ++i)
+      diagonal.local_element(i) = 1. / diagonal.local_element(i);
+  }
+  else
+  {
+    ASSERT_THROW_NOT_IMPLEMENTED();
+  }
+}
+
 // Instantiation
 template class ImplicitOperator<dealii::MemorySpace::Host>;
 #ifdef ADAMANTINE_HAVE_CUDA
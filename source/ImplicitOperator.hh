@@ -56,6 +56,15 @@ public:
       std::shared_ptr<dealii::LA::distributed::Vector<double, MemorySpaceType>>
           inverse_mass_matrix);
 
+  /**
+   * Given the diagonal of the Jacobian of \f$F\f$, compute in place the
+   * inverse of the diagonal of the operator \f$I-\tau M^{-1}
+   * \frac{F}{dy}\f$. This is used by the Jacobi and the Chebyshev
+   * preconditioners.
+   */
+  void compute_inverse_diagonal(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &diagonal) const;
+
 private:
   /**
    * Flag to switch between Jacobian-Free Newton Krylov method and exact
@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2021, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -9,3 +9,33 @@
 #include <instantiation.hh>
 
 INSTANTIATE_DIM_HOST(MaterialProperty)
+
+// Instantiate the set_state functions used by the single and the double
+// precision ThermalOperator.
+namespace adamantine
+{
+template void MaterialProperty<2, dealii::MemorySpace::Host>::set_state(
+    dealii::Table<2, dealii::VectorizedArray<float>> const &liquid_ratio,
+    dealii::Table<2, dealii::VectorizedArray<float>> const &powder_ratio,
+    std::map<typename dealii::DoFHandler<2>::cell_iterator,
+             std::pair<unsigned int, unsigned int>> &cell_it_to_mf_cell_map,
+    dealii::DoFHandler<2> const &dof_handler);
+template void MaterialProperty<2, dealii::MemorySpace::Host>::set_state(
+    dealii::Table<2, dealii::VectorizedArray<double>> const &liquid_ratio,
+    dealii::Table<2, dealii::VectorizedArray<double>> const &powder_ratio,
+    std::map<typename dealii::DoFHandler<2>::cell_iterator,
+             std::pair<unsigned int, unsigned int>> &cell_it_to_mf_cell_map,
+    dealii::DoFHandler<2> const &dof_handler);
+template void MaterialProperty<3, dealii::MemorySpace::Host>::set_state(
+    dealii::Table<2, dealii::VectorizedArray<float>> const &liquid_ratio,
+    dealii::Table<2, dealii::VectorizedArray<float>> const &powder_ratio,
+    std::map<typename dealii::DoFHandler<3>::cell_iterator,
+             std::pair<unsigned int, unsigned int>> &cell_it_to_mf_cell_map,
+    dealii::DoFHandler<3> const &dof_handler);
+template void MaterialProperty<3, dealii::MemorySpace::Host>::set_state(
+    dealii::Table<2, dealii::VectorizedArray<double>> const &liquid_ratio,
+    dealii::Table<2, dealii::VectorizedArray<double>> const &powder_ratio,
+    std::map<typename dealii::DoFHandler<3>::cell_iterator,
+             std::pair<unsigned int, unsigned int>> &cell_it_to_mf_cell_map,
+    dealii::DoFHandler<3> const &dof_handler);
+} // namespace adamantine
@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2022, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -15,6 +15,7 @@
 
 #include <deal.II/base/aligned_vector.h>
 #include <deal.II/base/memory_space.h>
+#include <deal.II/base/partitioner.h>
 #include <deal.II/base/types.h>
 #include <deal.II/distributed/tria.h>
 #include <deal.II/dofs/dof_accessor.h>
@@ -28,7 +29,9 @@
 
 #include <array>
 #include <limits>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 namespace adamantine
 {
@@ -105,6 +108,13 @@ public:
    */
   void reinit_dofs();
 
+  /**
+   * Return an estimate of the number of bytes used by the material states, the
+   * material properties, and the DoFHandler. The MemoryBlocks are allocated in
+   * MemorySpaceType.
+   */
+  std::size_t memory_consumption() const;
+
   /**
    * Update the material state, i.e, the ratio of liquid, powder, and solid and
    * the material properties given the field of temperature.
@@ -123,15 +133,19 @@ public:
           &temperature);
 
   /**
-   * Compute a material property at a quadrature point for a mix of states.
+   * Compute a material property at a quadrature point for a mix of states. The
+   * format of the material properties, @p use_table, and the order of the
+   * polynomials are known at compile time. The polynomials are evaluated using
+   * Horner's method. The coefficients are mixed in double precision and the
+   * polynomials are evaluated using the floating point type @p Number.
    */
-  dealii::VectorizedArray<double> compute_material_property(
+  template <bool use_table, unsigned int order = polynomial_order,
+            typename Number = double>
+  dealii::VectorizedArray<Number> compute_material_property(
       StateProperty state_property,
       dealii::types::material_id const *material_id,
-      dealii::VectorizedArray<double> const *state_ratios,
-      dealii::VectorizedArray<double> const &temperature,
-      dealii::AlignedVector<dealii::VectorizedArray<double>> const
-          &temperature_powers) const;
+      dealii::VectorizedArray<Number> const *state_ratios,
+      dealii::VectorizedArray<Number> const &temperature) const;
 
   /**
    * Compute a material property at a quadrature point for a mix of states.
@@ -158,6 +172,16 @@ public:
       typename dealii::Triangulation<dim>::active_cell_iterator const &cell,
       MaterialState material_state) const;
 
+  /**
+   * Compute the average of the temperature on every cell.
+   */
+  // This cannot be private due to limitation of lambda function with CUDA
+  dealii::LA::distributed::Vector<double, MemorySpaceType>
+  compute_average_temperature(
+      dealii::DoFHandler<dim> const &temperature_dof_handler,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const
+          &temperature);
+
   /**
    * Set the values in _state from the values of the user index of the
    * Triangulation.
@@ -168,9 +192,10 @@ public:
   /**
    * Set the ratio of the material states from ThermalOperator.
    */
+  template <typename Number>
   void set_state(
-      dealii::Table<2, dealii::VectorizedArray<double>> const &liquid_ratio,
-      dealii::Table<2, dealii::VectorizedArray<double>> const &powder_ratio,
+      dealii::Table<2, dealii::VectorizedArray<Number>> const &liquid_ratio,
+      dealii::Table<2, dealii::VectorizedArray<Number>> const &powder_ratio,
       std::map<typename dealii::DoFHandler<dim>::cell_iterator,
                std::pair<unsigned int, unsigned int>> &cell_it_to_mf_cell_map,
       dealii::DoFHandler<dim> const &dof_handler);
@@ -185,6 +210,14 @@ public:
                std::vector<unsigned int>> const &_cell_it_to_mf_pos,
       dealii::DoFHandler<dim> const &dof_handler);
 
+  /**
+   * Clear the mapping between the quadrature points of ThermalOperatorDevice
+   * and the cells cached by set_state_device(). This function needs to be
+   * called every time the MatrixFree object of ThermalOperatorDevice is
+   * reinitialized.
+   */
+  void clear_state_device_mapping();
+
   /**
    * Return the underlying the DoFHandler.
    */
@@ -201,7 +234,9 @@ public:
   }
 
   /**
-   * Compute a property from a table given the temperature.
+   * Compute a property from a table given the temperature. The table has been
+   * preprocessed by fill_properties() so that the lookup is done in constant
+   * time.
    */
   static ADAMANTINE_HOST_DEV double compute_property_from_table(
       MemoryBlockView<double, MemorySpaceType> const
@@ -227,20 +262,22 @@ private:
   void fill_properties(boost::property_tree::ptree const &database);
 
   /**
-   * Return the index of the dof associated to the cell.
+   * Return the index of the dof associated to the cell, i.e., the local index
+   * of the cell.
    */
   dealii::types::global_dof_index get_dof_index(
       typename dealii::Triangulation<dim>::active_cell_iterator const &cell)
       const;
 
   /**
-   * Compute the average of the temperature on every cell.
+   * Compute the weights and the local indices used to average the temperature
+   * on every cell. The arrays are only recomputed when the partitioner of @p
+   * temperature changes.
    */
-  dealii::LA::distributed::Vector<double, MemorySpaceType>
-  compute_average_temperature(
+  void update_average_temperature_weights(
       dealii::DoFHandler<dim> const &temperature_dof_handler,
       dealii::LA::distributed::Vector<double, MemorySpaceType> const
-          &temperature) const;
+          &temperature);
 
   /**
    * MPI communicator.
@@ -253,7 +290,9 @@ private:
   bool _use_table;
   /**
    * MemoryBlock that stores the thermal material properties which have been set
-   * using tables.
+   * using tables. For each interval of the table, we store the temperature
+   * where the next interval starts and the intercept and the slope of the
+   * linear interpolation.
    */
   MemoryBlock<double, MemorySpaceType> _state_property_tables;
   /**
@@ -310,6 +349,41 @@ private:
    * Mapping between the degrees of freedom and the local index of the cells.
    */
   std::unordered_map<dealii::types::global_dof_index, unsigned int> _dofs_map;
+  /**
+   * Local index of the locally owned cells indexed by the active cell index.
+   * The local index of the other cells is invalid_unsigned_int.
+   */
+  std::vector<unsigned int> _local_cell_indices;
+  /**
+   * Material id of the locally owned cells. The cells are ordered like the
+   * degrees of freedom of _mp_dof_handler.
+   */
+  MemoryBlock<dealii::types::material_id, MemorySpaceType> _material_ids;
+  /**
+   * Partitioner of the temperature used to compute _average_dof_indices and
+   * _average_weights.
+   */
+  std::shared_ptr<dealii::Utilities::MPI::Partitioner const>
+      _average_partitioner;
+  /**
+   * Local indices of the temperature degrees of freedom of the locally owned
+   * cells.
+   */
+  MemoryBlock<unsigned int, MemorySpaceType> _average_dof_indices;
+  /**
+   * Weights of the temperature degrees of freedom in the average temperature
+   * of the locally owned cells. The weights are zero for FE_Nothing cells.
+   */
+  MemoryBlock<double, MemorySpaceType> _average_weights;
+  /**
+   * Position of the quadrature points of ThermalOperatorDevice of every cell
+   * with material, cached by set_state_device().
+   */
+  MemoryBlock<unsigned int, MemorySpaceType> _state_device_mapping;
+  /**
+   * Index of the cells with material in _state, cached by set_state_device().
+   */
+  MemoryBlock<unsigned int, MemorySpaceType> _state_device_mp_dofs;
 };
 
 template <int dim, typename MemorySpaceType>
@@ -322,6 +396,72 @@ inline double MaterialProperty<dim, MemorySpaceType>::get(
   return _properties_view(material_id, static_cast<unsigned int>(property));
 }
 
+template <int dim, typename MemorySpaceType>
+template <bool use_table, unsigned int order, typename Number>
+inline dealii::VectorizedArray<Number>
+MaterialProperty<dim, MemorySpaceType>::compute_material_property(
+    StateProperty state_property, dealii::types::material_id const *material_id,
+    dealii::VectorizedArray<Number> const *state_ratios,
+    dealii::VectorizedArray<Number> const &temperature) const
+{
+  static_assert(order <= polynomial_order,
+                "The order of the polynomial is larger than the maximum order "
+                "supported.");
+
+  unsigned int constexpr n_lanes = dealii::VectorizedArray<Number>::size();
+  unsigned int const property_index = static_cast<unsigned int>(state_property);
+
+  if constexpr (use_table)
+  {
+    MemoryBlockView<double, MemorySpaceType> state_property_tables_view(
+        _state_property_tables);
+    dealii::VectorizedArray<Number> value = 0.0;
+    for (unsigned int material_state = 0; material_state < g_n_material_states;
+         ++material_state)
+    {
+      for (unsigned int n = 0; n < n_lanes; ++n)
+      {
+        value[n] += state_ratios[material_state][n] *
+                    compute_property_from_table(
+                        state_property_tables_view, material_id[n],
+                        material_state, property_index, temperature[n]);
+      }
+    }
+
+    return value;
+  }
+  else
+  {
+    MemoryBlockView<double, MemorySpaceType> state_property_polynomials_view(
+        _state_property_polynomials);
+    // The polynomial of the mix of states is the weighted sum of the
+    // polynomials of each state. We first gather the coefficients of this
+    // polynomial and then we evaluate it once using Horner's method.
+    std::array<dealii::VectorizedArray<Number>, order + 1> coefficients;
+    for (unsigned int i = 0; i <= order; ++i)
+    {
+      for (unsigned int n = 0; n < n_lanes; ++n)
+      {
+        double coef = 0.;
+        for (unsigned int material_state = 0;
+             material_state < g_n_material_states; ++material_state)
+        {
+          coef += state_ratios[material_state][n] *
+                  state_property_polynomials_view(
+                      material_id[n], material_state, property_index, i);
+        }
+        coefficients[i][n] = coef;
+      }
+    }
+
+    dealii::VectorizedArray<Number> value = coefficients[order];
+    for (unsigned int i = order; i > 0; --i)
+      value = value * temperature + coefficients[i - 1];
+
+    return value;
+  }
+}
+
 template <int dim, typename MemorySpaceType>
 inline MemoryBlockView<double, MemorySpaceType>
 MaterialProperty<dim, MemorySpaceType>::get_properties()
@@ -361,14 +501,21 @@ inline dealii::types::global_dof_index
 MaterialProperty<dim, MemorySpaceType>::get_dof_index(
     typename dealii::Triangulation<dim>::active_cell_iterator const &cell) const
 {
-  // Get a DoFCellAccessor from a Triangulation::active_cell_iterator.
-  dealii::DoFAccessor<dim, dim, dim, false> dof_accessor(
-      &_mp_dof_handler.get_triangulation(), cell->level(), cell->index(),
-      &_mp_dof_handler);
-  std::vector<dealii::types::global_dof_index> mp_dof(1.);
-  dof_accessor.get_dof_indices(mp_dof);
-
-  return _dofs_map.at(mp_dof[0]);
+  ASSERT(cell->active_cell_index() < _local_cell_indices.size(),
+         "The cell does not belong to the triangulation of MaterialProperty.");
+  unsigned int const local_index =
+      _local_cell_indices[cell->active_cell_index()];
+  ASSERT(local_index != dealii::numbers::invalid_unsigned_int,
+         "The cell is not locally owned.");
+
+  return local_index;
+}
+
+template <int dim, typename MemorySpaceType>
+inline void MaterialProperty<dim, MemorySpaceType>::clear_state_device_mapping()
+{
+  _state_device_mapping.reinit(0);
+  _state_device_mp_dofs.reinit(0);
 }
 
 template <int dim, typename MemorySpaceType>
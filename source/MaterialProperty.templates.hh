@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2022, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -12,6 +12,8 @@
 #include <deal.II/base/aligned_vector.h>
 #include <deal.II/base/array_view.h>
 #include <deal.II/base/cuda.h>
+#include <deal.II/base/memory_consumption.h>
+#include <deal.II/base/parallel.h>
 #include <deal.II/base/point.h>
 #include <deal.II/base/quadrature_lib.h>
 #include <deal.II/base/types.h>
@@ -30,52 +32,14 @@
 #include <algorithm>
 #include <type_traits>
 
+#ifdef ADAMANTINE_WITH_CALIPER
+#include <caliper/cali.h>
+#endif
+
 namespace adamantine
 {
 namespace internal
 {
-template <int dim>
-void compute_average(
-    unsigned int const n_q_points, unsigned int const dofs_per_cell,
-    dealii::DoFHandler<dim> const &mp_dof_handler,
-    dealii::DoFHandler<dim> const &temperature_dof_handler,
-    dealii::hp::FEValues<dim> &hp_fe_values,
-    dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> const
-        &temperature,
-    dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
-        &temperature_average)
-{
-  std::vector<dealii::types::global_dof_index> mp_dof_indices(1);
-  std::vector<dealii::types::global_dof_index> enth_dof_indices(dofs_per_cell);
-  auto mp_cell = mp_dof_handler.begin_active();
-  auto mp_end_cell = mp_dof_handler.end();
-  auto enth_cell = temperature_dof_handler.begin_active();
-  for (; mp_cell != mp_end_cell; ++enth_cell, ++mp_cell)
-  {
-    ASSERT(mp_cell->is_locally_owned() == enth_cell->is_locally_owned(),
-           "Internal Error");
-    if ((mp_cell->is_locally_owned()) && (enth_cell->active_fe_index() == 0))
-    {
-      hp_fe_values.reinit(enth_cell);
-      dealii::FEValues<dim> const &fe_values =
-          hp_fe_values.get_present_fe_values();
-      mp_cell->get_dof_indices(mp_dof_indices);
-      dealii::types::global_dof_index const mp_dof_index = mp_dof_indices[0];
-      enth_cell->get_dof_indices(enth_dof_indices);
-      double volume = 0.;
-      for (unsigned int q = 0; q < n_q_points; ++q)
-        for (unsigned int i = 0; i < dofs_per_cell; ++i)
-        {
-          volume += fe_values.shape_value(i, q) * fe_values.JxW(q);
-          temperature_average[mp_dof_index] +=
-              fe_values.shape_value(i, q) * temperature[enth_dof_indices[i]] *
-              fe_values.JxW(q);
-        }
-      temperature_average[mp_dof_index] /= volume;
-    }
-  }
-}
-
 template <typename MemorySpaceType>
 double get_value(MemoryBlock<double, MemorySpaceType> const &memory_block,
                  unsigned int i, unsigned int j)
@@ -85,31 +49,6 @@ double get_value(MemoryBlock<double, MemorySpaceType> const &memory_block,
 }
 
 #ifdef __CUDACC__
-template <int dim>
-void compute_average(
-    unsigned int const n_q_points, unsigned int const dofs_per_cell,
-    dealii::DoFHandler<dim> const &mp_dof_handler,
-    dealii::DoFHandler<dim> const &temperature_dof_handler,
-    dealii::hp::FEValues<dim> &hp_fe_values,
-    dealii::LA::distributed::Vector<double, dealii::MemorySpace::CUDA> const
-        &temperature,
-    dealii::LA::distributed::Vector<double, dealii::MemorySpace::CUDA>
-        &temperature_average)
-{
-  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
-      temperature_host(temperature.get_partitioner());
-  temperature_host.import(temperature, dealii::VectorOperation::insert);
-  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
-      temperature_average_host(temperature_average.get_partitioner());
-  temperature_average_host = 0.;
-  compute_average(n_q_points, dofs_per_cell, mp_dof_handler,
-                  temperature_dof_handler, hp_fe_values, temperature_host,
-                  temperature_average_host);
-
-  temperature_average.import(temperature_average_host,
-                             dealii::VectorOperation::insert);
-}
-
 template <>
 double get_value<dealii::MemorySpace::CUDA>(
     MemoryBlock<double, dealii::MemorySpace::CUDA> const &memory_block,
@@ -202,18 +141,29 @@ void MaterialProperty<dim, MemorySpaceType>::reinit_dofs()
 {
   _mp_dof_handler.distribute_dofs(_fe);
 
-  // Initialize _dofs_map
+  // Initialize _dofs_map and _local_cell_indices
   _dofs_map.clear();
+  _local_cell_indices.assign(
+      _mp_dof_handler.get_triangulation().n_active_cells(),
+      dealii::numbers::invalid_unsigned_int);
   unsigned int i = 0;
   std::vector<dealii::types::global_dof_index> mp_dof(1);
+  std::vector<dealii::types::material_id> material_ids;
   for (auto cell :
        dealii::filter_iterators(_mp_dof_handler.active_cell_iterators(),
                                 dealii::IteratorFilters::LocallyOwnedCell()))
   {
     cell->get_dof_indices(mp_dof);
     _dofs_map[mp_dof[0]] = i;
+    _local_cell_indices[cell->active_cell_index()] = i;
+    material_ids.push_back(cell->material_id());
     ++i;
   }
+  _material_ids.reinit(material_ids);
+
+  // The cached index maps are not valid anymore.
+  _average_partitioner.reset();
+  clear_state_device_mapping();
 
   _state.reinit(g_n_material_states, _dofs_map.size());
 #ifdef ADAMANTINE_DEBUG
@@ -232,39 +182,59 @@ void MaterialProperty<dim, MemorySpaceType>::reinit_dofs()
 #endif
 }
 
+template <int dim, typename MemorySpaceType>
+std::size_t MaterialProperty<dim, MemorySpaceType>::memory_consumption() const
+{
+  // The nodes of the unordered_map store the pair and a pointer to the next
+  // node.
+  std::size_t const dofs_map_size =
+      _dofs_map.size() * (sizeof(typename decltype(_dofs_map)::value_type) +
+                          sizeof(void *)) +
+      _dofs_map.bucket_count() * sizeof(void *);
+
+  return _state_property_tables.memory_consumption() +
+         _state_property_polynomials.memory_consumption() +
+         _properties.memory_consumption() + _state.memory_consumption() +
+         _property_values.memory_consumption() +
+         _mechanical_properties_tables_host.memory_consumption() +
+         _mechanical_properties_polynomials_host.memory_consumption() +
+         _mechanical_properties_host.memory_consumption() +
+         _mp_dof_handler.memory_consumption() + dofs_map_size +
+         dealii::MemoryConsumption::memory_consumption(_local_cell_indices) +
+         _material_ids.memory_consumption() +
+         _average_dof_indices.memory_consumption() +
+         _average_weights.memory_consumption() +
+         _state_device_mapping.memory_consumption() +
+         _state_device_mp_dofs.memory_consumption();
+}
+
 template <int dim, typename MemorySpaceType>
 void MaterialProperty<dim, MemorySpaceType>::update(
     dealii::DoFHandler<dim> const &temperature_dof_handler,
     dealii::LA::distributed::Vector<double, MemorySpaceType> const &temperature)
 {
-  auto temperature_average =
-      compute_average_temperature(temperature_dof_handler, temperature);
-  _property_values.reinit(g_n_thermal_state_properties, _dofs_map.size());
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_CXX_MARK_SCOPE("phase_change");
+#endif
+  // The average temperature, the state of the material, and the material
+  // properties are computed in a single kernel. The index maps used by the
+  // kernel are cached until the mesh changes.
+  update_average_temperature_weights(temperature_dof_handler, temperature);
+  temperature.update_ghost_values();
+  unsigned int const n_cells = _dofs_map.size();
+  if ((_property_values.extent(0) != g_n_thermal_state_properties) ||
+      (_property_values.extent(1) != n_cells))
+    _property_values.reinit(g_n_thermal_state_properties, n_cells);
   _property_values.set_zero();
 
-  std::vector<dealii::types::global_dof_index> mp_dofs;
-  std::vector<dealii::types::material_id> material_ids;
-  for (auto cell :
-       dealii::filter_iterators(_mp_dof_handler.active_cell_iterators(),
-                                dealii::IteratorFilters::LocallyOwnedCell()))
-  {
-    std::vector<dealii::types::global_dof_index> mp_dof(1);
-    cell->get_dof_indices(mp_dof);
-    mp_dofs.push_back(_dofs_map.at(mp_dof[0]));
-    material_ids.push_back(cell->material_id());
-  }
-
-  unsigned int const material_ids_size = material_ids.size();
-  MemoryBlock<dealii::types::material_id, MemorySpaceType> material_ids_block(
-      material_ids);
+  double const *temperature_local = temperature.get_values();
   MemoryBlockView<dealii::types::material_id, MemorySpaceType>
-      material_ids_view(material_ids_block);
-  MemoryBlock<dealii::types::global_dof_index, MemorySpaceType> mp_dofs_block(
-      mp_dofs);
-  MemoryBlockView<dealii::types::global_dof_index, MemorySpaceType>
-      mp_dofs_view(mp_dofs_block);
-
-  double *temperature_average_local = temperature_average.get_values();
+      material_ids_view(_material_ids);
+  MemoryBlockView<unsigned int, MemorySpaceType> average_dof_indices_view(
+      _average_dof_indices);
+  MemoryBlockView<double, MemorySpaceType> average_weights_view(
+      _average_weights);
+  unsigned int const dofs_per_cell = _average_weights.extent(1);
 
   MemoryBlockView<double, MemorySpaceType> state_property_polynomials_view(
       _state_property_polynomials);
@@ -277,7 +247,7 @@ void MaterialProperty<dim, MemorySpaceType>::update(
 
   bool use_table = _use_table;
   for_each(
-      MemorySpaceType{}, material_ids_size,
+      MemorySpaceType{}, n_cells,
       [=] ADAMANTINE_HOST_DEV(int i)
       {
         unsigned int constexpr liquid =
@@ -294,19 +264,25 @@ void MaterialProperty<dim, MemorySpaceType>::update(
         dealii::types::material_id material_id = material_ids_view(i);
         double const solidus = properties_view(material_id, prop_solidus);
         double const liquidus = properties_view(material_id, prop_liquidus);
-        unsigned int const dof = mp_dofs_view(i);
+        unsigned int const dof = i;
+
+        // Compute the average temperature on the cell.
+        double temperature_average = 0.;
+        for (unsigned int j = 0; j < dofs_per_cell; ++j)
+          temperature_average +=
+              average_weights_view(i, j) *
+              temperature_local[average_dof_indices_view(i, j)];
 
         // First determine the ratio of liquid.
         double liquid_ratio = -1.;
         double powder_ratio = -1.;
         double solid_ratio = -1.;
-        if (temperature_average_local[dof] < solidus)
+        if (temperature_average < solidus)
           liquid_ratio = 0.;
-        else if (temperature_average_local[dof] > liquidus)
+        else if (temperature_average > liquidus)
           liquid_ratio = 1.;
         else
-          liquid_ratio =
-              (temperature_average_local[dof] - solidus) / (liquidus - solidus);
+          liquid_ratio = (temperature_average - solidus) / (liquidus - solidus);
         // Because the powder can only become liquid, the solid can only
         // become liquid, and the liquid can only become solid, the ratio of
         // powder can only decrease.
@@ -332,27 +308,31 @@ void MaterialProperty<dim, MemorySpaceType>::update(
                   state_view(material_state, dof) *
                   compute_property_from_table(
                       state_property_tables_view, material_id, material_state,
-                      property, temperature_average_local[dof]);
+                      property, temperature_average);
             }
           }
         }
         else
         {
+          // Evaluate the polynomial of the mix of states using Horner's
+          // method.
           for (unsigned int property = 0;
                property < g_n_thermal_state_properties; ++property)
           {
-            for (unsigned int material_state = 0;
-                 material_state < g_n_material_states; ++material_state)
+            double value = 0.;
+            for (int k = polynomial_order; k >= 0; --k)
             {
-              for (unsigned int i = 0; i <= polynomial_order; ++i)
+              double coef = 0.;
+              for (unsigned int material_state = 0;
+                   material_state < g_n_material_states; ++material_state)
               {
-                property_values_view(property, dof) +=
-                    state_view(material_state, dof) *
-                    state_property_polynomials_view(material_id, material_state,
-                                                    property, i) *
-                    std::pow(temperature_average_local[dof], i);
+                coef += state_view(material_state, dof) *
+                        state_property_polynomials_view(
+                            material_id, material_state, property, k);
               }
+              value = value * temperature_average + coef;
             }
+            property_values_view(property, dof) += value;
           }
         }
 
@@ -385,7 +365,7 @@ void MaterialProperty<dim, MemorySpaceType>::update(
                 StateProperty::radiation_heat_transfer_coef);
         unsigned int const radiation_temperature_infty_prop =
             static_cast<unsigned int>(Property::radiation_temperature_infty);
-        double const T = temperature_average_local[dof];
+        double const T = temperature_average;
         double const T_infty =
             properties_view(material_id, radiation_temperature_infty_prop);
         double const emissivity = property_values_view(emissivity_prop, dof);
@@ -404,16 +384,28 @@ void MaterialProperty<dim, MemorySpaceType>::
         dealii::LA::distributed::Vector<double, MemorySpaceType> const
             &temperature)
 {
-  auto temperature_average =
-      compute_average_temperature(temperature_dof_handler, temperature);
-  _property_values.reinit(g_n_thermal_state_properties, _dofs_map.size());
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_CXX_MARK_SCOPE("boundary_material_properties");
+#endif
+  // The average temperature and the properties are computed in a single
+  // kernel like in update().
+  update_average_temperature_weights(temperature_dof_handler, temperature);
+  temperature.update_ghost_values();
+  unsigned int const n_cells = _dofs_map.size();
+  if ((_property_values.extent(0) != g_n_thermal_state_properties) ||
+      (_property_values.extent(1) != n_cells))
+    _property_values.reinit(g_n_thermal_state_properties, n_cells);
   _property_values.set_zero();
 
-  std::vector<dealii::types::global_dof_index> mp_dof(1);
-  // We don't need to loop over all the active cells. We only need to loop over
-  // the cells at the boundary and at the interface with FE_Nothing. However, to
-  // do this we need to use the temperature_dof_handler instead of the
-  // _mp_dof_handler.
+  double const *temperature_local = temperature.get_values();
+  MemoryBlockView<dealii::types::material_id, MemorySpaceType>
+      material_ids_view(_material_ids);
+  MemoryBlockView<unsigned int, MemorySpaceType> average_dof_indices_view(
+      _average_dof_indices);
+  MemoryBlockView<double, MemorySpaceType> average_weights_view(
+      _average_weights);
+  unsigned int const dofs_per_cell = _average_weights.extent(1);
+
   MemoryBlockView<double, MemorySpaceType> state_property_polynomials_view(
       _state_property_polynomials);
   MemoryBlockView<double, MemorySpaceType> properties_view(_properties);
@@ -422,127 +414,83 @@ void MaterialProperty<dim, MemorySpaceType>::
       _property_values);
   MemoryBlockView<double, MemorySpaceType> state_property_tables_view(
       _state_property_tables);
-  for (auto cell :
-       dealii::filter_iterators(_mp_dof_handler.active_cell_iterators(),
-                                dealii::IteratorFilters::LocallyOwnedCell()))
-  {
-    dealii::types::material_id material_id = cell->material_id();
 
-    cell->get_dof_indices(mp_dof);
-    unsigned int const dof = _dofs_map.at(mp_dof[0]);
-    if (_use_table)
-    {
-      // We only care about properties that are used to compute the boundary
-      // condition. So we start at 3.
-      for (unsigned int property = 3; property < g_n_thermal_state_properties;
-           ++property)
-      {
-        for (unsigned int material_state = 0;
-             material_state < g_n_material_states; ++material_state)
-        {
-          property_values_view(property, dof) +=
-              state_view(material_state, dof) *
-              compute_property_from_table(
-                  state_property_tables_view, material_id, material_state,
-                  property, temperature_average.local_element(dof));
-        }
-      }
-    }
-    else
-    {
-      // We only care about properties that are used to compute the boundary
-      // condition. So we start at 3.
-      for (unsigned int property = 3; property < g_n_thermal_state_properties;
-           ++property)
+  bool use_table = _use_table;
+  for_each(
+      MemorySpaceType{}, n_cells,
+      [=] ADAMANTINE_HOST_DEV(int i)
       {
-        for (unsigned int material_state = 0;
-             material_state < g_n_material_states; ++material_state)
+        dealii::types::material_id material_id = material_ids_view(i);
+        unsigned int const dof = i;
+
+        // Compute the average temperature on the cell.
+        double temperature_average = 0.;
+        for (unsigned int j = 0; j < dofs_per_cell; ++j)
+          temperature_average +=
+              average_weights_view(i, j) *
+              temperature_local[average_dof_indices_view(i, j)];
+
+        // We only care about properties that are used to compute the boundary
+        // condition. So we start at 3.
+        if (use_table)
         {
-          for (unsigned int i = 0; i <= polynomial_order; ++i)
+          for (unsigned int property = 3;
+               property < g_n_thermal_state_properties; ++property)
           {
-            property_values_view(property, dof) +=
-                state_view(material_state, dof) *
-                state_property_polynomials_view(material_id, material_state,
-                                                property, i) *
-                std::pow(temperature_average.local_element(dof), i);
+            for (unsigned int material_state = 0;
+                 material_state < g_n_material_states; ++material_state)
+            {
+              property_values_view(property, dof) +=
+                  state_view(material_state, dof) *
+                  compute_property_from_table(
+                      state_property_tables_view, material_id, material_state,
+                      property, temperature_average);
+            }
           }
         }
-      }
-    }
-
-    // The radiation heat transfer coefficient is not a real material property
-    // but it is derived from other material properties:
-    // h_rad = emissitivity * stefan-boltzmann constant * (T + T_infty) (T^2 +
-    // T^2_infty).
-    unsigned int const emissivity_prop =
-        static_cast<unsigned int>(StateProperty::emissivity);
-    unsigned int const radiation_heat_transfer_coef_prop =
-        static_cast<unsigned int>(StateProperty::radiation_heat_transfer_coef);
-    unsigned int const radiation_temperature_infty_prop =
-        static_cast<unsigned int>(Property::radiation_temperature_infty);
-    double const T = temperature_average.local_element(dof);
-    double const T_infty =
-        properties_view(material_id, radiation_temperature_infty_prop);
-    double const emissivity = property_values_view(emissivity_prop, dof);
-    property_values_view(radiation_heat_transfer_coef_prop, dof) =
-        emissivity * Constant::stefan_boltzmann * (T + T_infty) *
-        (T * T + T_infty * T_infty);
-  }
-}
-
-template <int dim, typename MemorySpaceType>
-dealii::VectorizedArray<double>
-MaterialProperty<dim, MemorySpaceType>::compute_material_property(
-    StateProperty state_property, dealii::types::material_id const *material_id,
-    dealii::VectorizedArray<double> const *state_ratios,
-    dealii::VectorizedArray<double> const &temperature,
-    dealii::AlignedVector<dealii::VectorizedArray<double>> const
-        &temperature_powers) const
-{
-  dealii::VectorizedArray<double> value = 0.0;
-  unsigned int const property_index = static_cast<unsigned int>(state_property);
-  MemoryBlockView<double, MemorySpaceType> state_property_polynomials_view(
-      _state_property_polynomials);
-  MemoryBlockView<double, MemorySpaceType> state_property_tables_view(
-      _state_property_tables);
-
-  if (_use_table)
-  {
-    for (unsigned int material_state = 0; material_state < g_n_material_states;
-         ++material_state)
-    {
-      for (unsigned int n = 0; n < dealii::VectorizedArray<double>::size(); ++n)
-      {
-        const dealii::types::material_id m_id = material_id[n];
-
-        value[n] += state_ratios[material_state][n] *
-                    compute_property_from_table(state_property_tables_view,
-                                                m_id, material_state,
-                                                property_index, temperature[n]);
-      }
-    }
-  }
-  else
-  {
-    for (unsigned int material_state = 0; material_state < g_n_material_states;
-         ++material_state)
-    {
-      for (unsigned int n = 0; n < dealii::VectorizedArray<double>::size(); ++n)
-      {
-        dealii::types::material_id m_id = material_id[n];
-
-        for (unsigned int i = 0; i <= polynomial_order; ++i)
+        else
         {
-          value[n] += state_ratios[material_state][n] *
-                      state_property_polynomials_view(m_id, material_state,
-                                                      property_index, i) *
-                      temperature_powers[i][n];
+          // Evaluate the polynomial of the mix of states using Horner's
+          // method.
+          for (unsigned int property = 3;
+               property < g_n_thermal_state_properties; ++property)
+          {
+            double value = 0.;
+            for (int k = polynomial_order; k >= 0; --k)
+            {
+              double coef = 0.;
+              for (unsigned int material_state = 0;
+                   material_state < g_n_material_states; ++material_state)
+              {
+                coef += state_view(material_state, dof) *
+                        state_property_polynomials_view(
+                            material_id, material_state, property, k);
+              }
+              value = value * temperature_average + coef;
+            }
+            property_values_view(property, dof) += value;
+          }
         }
-      }
-    }
-  }
 
-  return value;
+        // The radiation heat transfer coefficient is not a real material
+        // property but it is derived from other material properties: h_rad =
+        // emissitivity * stefan-boltzmann constant * (T + T_infty) (T^2 +
+        // T^2_infty).
+        unsigned int const emissivity_prop =
+            static_cast<unsigned int>(StateProperty::emissivity);
+        unsigned int const radiation_heat_transfer_coef_prop =
+            static_cast<unsigned int>(
+                StateProperty::radiation_heat_transfer_coef);
+        unsigned int const radiation_temperature_infty_prop =
+            static_cast<unsigned int>(Property::radiation_temperature_infty);
+        double const T = temperature_average;
+        double const T_infty =
+            properties_view(material_id, radiation_temperature_infty_prop);
+        double const emissivity = property_values_view(emissivity_prop, dof);
+        property_values_view(radiation_heat_transfer_coef_prop, dof) =
+            emissivity * Constant::stefan_boltzmann * (T + T_infty) *
+            (T * T + T_infty * T_infty);
+      });
 }
 
 template <int dim, typename MemorySpaceType>
@@ -573,18 +521,18 @@ MaterialProperty<dim, MemorySpaceType>::compute_material_property(
   }
   else
   {
-    for (unsigned int material_state = 0; material_state < g_n_material_states;
-         ++material_state)
+    // Evaluate the polynomial of the mix of states using Horner's method.
+    for (int i = polynomial_order; i >= 0; --i)
     {
-      dealii::types::material_id m_id = material_id;
-
-      for (unsigned int i = 0; i <= polynomial_order; ++i)
+      double coef = 0.;
+      for (unsigned int material_state = 0;
+           material_state < g_n_material_states; ++material_state)
       {
-        value += state_ratios[material_state] *
-                 state_property_polynomials_view(m_id, material_state,
-                                                 property_index, i) *
-                 std::pow(temperature, i);
+        coef += state_ratios[material_state] *
+                state_property_polynomials_view(material_id, material_state,
+                                                property_index, i);
       }
+      value = value * temperature + coef;
     }
   }
 
@@ -592,9 +540,10 @@ MaterialProperty<dim, MemorySpaceType>::compute_material_property(
 }
 
 template <int dim, typename MemorySpaceType>
+template <typename Number>
 void MaterialProperty<dim, MemorySpaceType>::set_state(
-    dealii::Table<2, dealii::VectorizedArray<double>> const &liquid_ratio,
-    dealii::Table<2, dealii::VectorizedArray<double>> const &powder_ratio,
+    dealii::Table<2, dealii::VectorizedArray<Number>> const &liquid_ratio,
+    dealii::Table<2, dealii::VectorizedArray<Number>> const &powder_ratio,
     std::map<typename dealii::DoFHandler<dim>::cell_iterator,
              std::pair<unsigned int, unsigned int>> &cell_it_to_mf_cell_map,
     dealii::DoFHandler<dim> const &dof_handler)
@@ -602,33 +551,53 @@ void MaterialProperty<dim, MemorySpaceType>::set_state(
   auto const powder_state = static_cast<unsigned int>(MaterialState::powder);
   auto const liquid_state = static_cast<unsigned int>(MaterialState::liquid);
   auto const solid_state = static_cast<unsigned int>(MaterialState::solid);
-  std::vector<dealii::types::global_dof_index> mp_dof(1.);
 
-  MemoryBlockView<double, MemorySpaceType> state_view(_state);
+  // The cells are gathered first so that the states can be computed by
+  // several threads. The map is only read in the threaded loop.
+  std::vector<typename dealii::DoFHandler<dim>::active_cell_iterator> cells;
   for (auto const &cell :
        dealii::filter_iterators(dof_handler.active_cell_iterators(),
                                 dealii::IteratorFilters::LocallyOwnedCell()))
-  {
-    typename dealii::Triangulation<dim>::active_cell_iterator cell_tria(cell);
-    auto mp_dof_index = get_dof_index(cell_tria);
-    auto const &mf_cell_vector = cell_it_to_mf_cell_map[cell];
-    unsigned int const n_q_points = dof_handler.get_fe().tensor_degree() + 1;
-    double liquid_ratio_sum = 0.;
-    double powder_ratio_sum = 0.;
-    for (unsigned int q = 0; q < n_q_points; ++q)
-    {
-      liquid_ratio_sum +=
-          liquid_ratio(mf_cell_vector.first, q)[mf_cell_vector.second];
-      powder_ratio_sum +=
-          powder_ratio(mf_cell_vector.first, q)[mf_cell_vector.second];
-    }
-    state_view(liquid_state, mp_dof_index) = liquid_ratio_sum / n_q_points;
-    state_view(powder_state, mp_dof_index) = powder_ratio_sum / n_q_points;
-    state_view(solid_state, mp_dof_index) =
-        std::max(1. - state_view(liquid_state, mp_dof_index) -
-                     state_view(powder_state, mp_dof_index),
-                 0.);
-  }
+    cells.push_back(cell);
+
+  MemoryBlockView<double, MemorySpaceType> state_view(_state);
+  unsigned int const n_q_points = dof_handler.get_fe().tensor_degree() + 1;
+  dealii::parallel::apply_to_subranges(
+      0u, static_cast<unsigned int>(cells.size()),
+      [&](unsigned int const begin, unsigned int const end)
+      {
+        for (unsigned int i = begin; i < end; ++i)
+        {
+          typename dealii::Triangulation<dim>::active_cell_iterator cell_tria(
+              cells[i]);
+          auto mp_dof_index = get_dof_index(cell_tria);
+          // Cells that are not in the map use the first lane of the first
+          // batch.
+          auto const mf_cell_it = cell_it_to_mf_cell_map.find(cells[i]);
+          std::pair<unsigned int, unsigned int> const mf_cell_vector =
+              (mf_cell_it != cell_it_to_mf_cell_map.end())
+                  ? mf_cell_it->second
+                  : std::pair<unsigned int, unsigned int>();
+          double liquid_ratio_sum = 0.;
+          double powder_ratio_sum = 0.;
+          for (unsigned int q = 0; q < n_q_points; ++q)
+          {
+            liquid_ratio_sum +=
+                liquid_ratio(mf_cell_vector.first, q)[mf_cell_vector.second];
+            powder_ratio_sum +=
+                powder_ratio(mf_cell_vector.first, q)[mf_cell_vector.second];
+          }
+          state_view(liquid_state, mp_dof_index) =
+              liquid_ratio_sum / n_q_points;
+          state_view(powder_state, mp_dof_index) =
+              powder_ratio_sum / n_q_points;
+          state_view(solid_state, mp_dof_index) =
+              std::max(1. - state_view(liquid_state, mp_dof_index) -
+                           state_view(powder_state, mp_dof_index),
+                       0.);
+        }
+      },
+      host_loop_grain_size);
 }
 
 #ifdef __CUDACC__
@@ -640,52 +609,51 @@ void MaterialProperty<dim, MemorySpaceType>::set_state_device(
              std::vector<unsigned int>> const &_cell_it_to_mf_pos,
     dealii::DoFHandler<dim> const &dof_handler)
 {
-  // Create a mapping between the matrix free dofs and material property dofs
-  std::vector<dealii::types::global_dof_index> mp_dof(1.);
+  // Create a mapping between the matrix free dofs and material property dofs.
+  // The mapping is cached until the mesh or the MatrixFree object changes.
   unsigned int const n_q_points = dof_handler.get_fe().tensor_degree() + 1;
-  MemoryBlock<unsigned int, dealii::MemorySpace::Host> mapping_host(
-      _state.extent(1), n_q_points);
-  MemoryBlockView<unsigned, dealii::MemorySpace::Host> mapping_host_view(
-      mapping_host);
-  MemoryBlock<double, dealii::MemorySpace::Host> mp_dof_host_block(
-      _state.extent(1));
-  MemoryBlockView<double, dealii::MemorySpace::Host> mp_dof_host_view(
-      mp_dof_host_block);
-  // We only loop over the part of the domain which has material, i.e., not over
-  // FE_Nothing cell. This is because _cell_it_to_mf_pos does not exist for
-  // FE_Nothing cells. However, we have set the state of the material on the
-  // entire domain. This is not a problem since that state is unchanged and does
-  // not need to be updated.
-  unsigned int cell_i = 0;
-  for (auto const &cell : dealii::filter_iterators(
-           dof_handler.active_cell_iterators(),
-           dealii::IteratorFilters::ActiveFEIndexEqualTo(0, true)))
+  if (_state_device_mp_dofs.size() == 0)
   {
-    typename dealii::Triangulation<dim>::active_cell_iterator cell_tria(cell);
-    auto mp_dof_index = get_dof_index(cell_tria);
-    auto const &mf_cell_vector = _cell_it_to_mf_pos.at(cell);
-    for (unsigned int q = 0; q < n_q_points; ++q)
+    MemoryBlock<unsigned int, dealii::MemorySpace::Host> mapping_host(
+        _state.extent(1), n_q_points);
+    MemoryBlockView<unsigned, dealii::MemorySpace::Host> mapping_host_view(
+        mapping_host);
+    std::vector<unsigned int> mp_dofs_host;
+    // We only loop over the part of the domain which has material, i.e., not
+    // over FE_Nothing cell. This is because _cell_it_to_mf_pos does not exist
+    // for FE_Nothing cells. However, we have set the state of the material on
+    // the entire domain. This is not a problem since that state is unchanged
+    // and does not need to be updated.
+    for (auto const &cell : dealii::filter_iterators(
+             dof_handler.active_cell_iterators(),
+             dealii::IteratorFilters::ActiveFEIndexEqualTo(0, true)))
     {
-      mapping_host_view(cell_i, q) = mf_cell_vector[q];
+      typename dealii::Triangulation<dim>::active_cell_iterator cell_tria(cell);
+      auto const &mf_cell_vector = _cell_it_to_mf_pos.at(cell);
+      for (unsigned int q = 0; q < n_q_points; ++q)
+      {
+        mapping_host_view(mp_dofs_host.size(), q) = mf_cell_vector[q];
+      }
+      mp_dofs_host.push_back(get_dof_index(cell_tria));
     }
-    mp_dof_host_view(cell_i) = mp_dof_index;
-    ++cell_i;
+    _state_device_mapping.reinit(mapping_host);
+    _state_device_mp_dofs.reinit(mp_dofs_host);
   }
+  unsigned int const n_cells = _state_device_mp_dofs.size();
 
-  MemoryBlock<unsigned int, dealii::MemorySpace::CUDA> mapping(mapping_host);
-  MemoryBlockView<unsigned, dealii::MemorySpace::CUDA> mapping_view(mapping);
+  MemoryBlockView<unsigned, dealii::MemorySpace::CUDA> mapping_view(
+      _state_device_mapping);
   MemoryBlockView<double, dealii::MemorySpace::CUDA> liquid_ratio_view(
       liquid_ratio);
   MemoryBlockView<double, dealii::MemorySpace::CUDA> powder_ratio_view(
       powder_ratio);
-  MemoryBlock<double, dealii::MemorySpace::CUDA> mp_dof_block(
-      mp_dof_host_block);
-  MemoryBlockView<double, dealii::MemorySpace::CUDA> mp_dof_view(mp_dof_block);
+  MemoryBlockView<unsigned int, dealii::MemorySpace::CUDA> mp_dof_view(
+      _state_device_mp_dofs);
   MemoryBlockView<double, dealii::MemorySpace::CUDA> state_view(_state);
   auto const powder_state = static_cast<unsigned int>(MaterialState::powder);
   auto const liquid_state = static_cast<unsigned int>(MaterialState::liquid);
   auto const solid_state = static_cast<unsigned int>(MaterialState::solid);
-  for_each(MemorySpaceType{}, cell_i,
+  for_each(MemorySpaceType{}, n_cells,
            [=] ADAMANTINE_HOST_DEV(int i) mutable
            {
              double liquid_ratio_sum = 0.;
@@ -717,9 +685,7 @@ void MaterialProperty<dim, MemorySpaceType>::set_initial_state()
        dealii::filter_iterators(_mp_dof_handler.active_cell_iterators(),
                                 dealii::IteratorFilters::LocallyOwnedCell()))
   {
-    std::vector<dealii::types::global_dof_index> mp_dof(1);
-    cell->get_dof_indices(mp_dof);
-    mp_dofs.push_back(_dofs_map.at(mp_dof[0]));
+    mp_dofs.push_back(_local_cell_indices[cell->active_cell_index()]);
     user_indices.push_back(cell->user_index());
   }
 
@@ -772,7 +738,8 @@ void MaterialProperty<dim, MemorySpaceType>::fill_properties(
   if (_use_table)
   {
     _state_property_tables.reinit(n_material_ids, g_n_material_states,
-                                  g_n_thermal_state_properties, table_size, 2);
+                                  g_n_thermal_state_properties, table_size + 1,
+                                  3);
     state_property_tables_host.reinit(n_material_ids, g_n_material_states,
                                       g_n_thermal_state_properties, table_size,
                                       2);
@@ -987,29 +954,72 @@ void MaterialProperty<dim, MemorySpaceType>::fill_properties(
     }
   }
 
+  if (_use_table)
+  {
+    // Preprocess the tables so that the interval containing a temperature is
+    // found by counting the temperatures of the table that are smaller or
+    // equal to it. The lookup does not branch and it is done in constant time.
+    // For each interval, we store the temperature starting the next interval,
+    // the intercept, and the slope of the linear interpolation.
+    MemoryBlock<double, dealii::MemorySpace::Host>
+        state_property_intervals_host(n_material_ids, g_n_material_states,
+                                      g_n_thermal_state_properties,
+                                      table_size + 1, 3);
+    MemoryBlockView<double, dealii::MemorySpace::Host>
+        state_property_intervals_host_view(state_property_intervals_host);
+    for (unsigned int m = 0; m < n_material_ids; ++m)
+      for (unsigned int s = 0; s < g_n_material_states; ++s)
+        for (unsigned int p = 0; p < g_n_thermal_state_properties; ++p)
+          for (unsigned int i = 0; i <= table_size; ++i)
+          {
+            state_property_intervals_host_view(m, s, p, i, 0) =
+                i < table_size
+                    ? state_property_tables_host_view(m, s, p, i, 0)
+                    : std::numeric_limits<double>::max();
+            // Below the first temperature and above the last one, the property
+            // is constant.
+            double intercept = state_property_tables_host_view(
+                m, s, p, i == 0 ? 0 : table_size - 1, 1);
+            double slope = 0.;
+            if ((i > 0) && (i < table_size - 1))
+            {
+              double const temperature_im1 =
+                  state_property_tables_host_view(m, s, p, i - 1, 0);
+              double const temperature_i =
+                  state_property_tables_host_view(m, s, p, i, 0);
+              double const property_im1 =
+                  state_property_tables_host_view(m, s, p, i - 1, 1);
+              double const property_i =
+                  state_property_tables_host_view(m, s, p, i, 1);
+              // Intervals of zero length are never selected.
+              if (temperature_i > temperature_im1)
+                slope = (property_i - property_im1) /
+                        (temperature_i - temperature_im1);
+              intercept = property_im1 - slope * temperature_im1;
+            }
+            state_property_intervals_host_view(m, s, p, i, 1) = intercept;
+            state_property_intervals_host_view(m, s, p, i, 2) = slope;
+          }
+    deep_copy(_state_property_tables, state_property_intervals_host);
+  }
+
   // Copy the data
   deep_copy(_state_property_polynomials, state_property_polynomials_host);
-  deep_copy(_state_property_tables, state_property_tables_host);
   deep_copy(_properties, properties_host);
   _properties_view.reinit(_properties);
 }
 
-// We need to compute the average temperature on the cell because we need the
-// material properties to be uniform over the cell. If there aren't then we have
-// problems with the weak form discretization.
 template <int dim, typename MemorySpaceType>
-dealii::LA::distributed::Vector<double, MemorySpaceType>
-MaterialProperty<dim, MemorySpaceType>::compute_average_temperature(
+void MaterialProperty<dim, MemorySpaceType>::update_average_temperature_weights(
     dealii::DoFHandler<dim> const &temperature_dof_handler,
     dealii::LA::distributed::Vector<double, MemorySpaceType> const &temperature)
-    const
 {
-  // TODO: this should probably done in a matrix-free fashion.
-  // The triangulation is the same for both DoFHandler
-  dealii::LA::distributed::Vector<double, MemorySpaceType> temperature_average(
-      _mp_dof_handler.locally_owned_dofs(), temperature.get_mpi_communicator());
-  temperature.update_ghost_values();
-  temperature_average = 0.;
+  // The weights only depend on the mesh and on the finite elements. A new
+  // partitioner is created every time the degrees of freedom of the
+  // temperature are distributed.
+  if (_average_partitioner == temperature.get_partitioner())
+    return;
+
   dealii::hp::FECollection<dim> const &fe_collection =
       temperature_dof_handler.get_fe_collection();
   dealii::hp::QCollection<dim> q_collection;
@@ -1018,13 +1028,89 @@ MaterialProperty<dim, MemorySpaceType>::compute_average_temperature(
   dealii::hp::FEValues<dim> hp_fe_values(
       fe_collection, q_collection,
       dealii::UpdateFlags::update_values |
-          dealii::UpdateFlags::update_quadrature_points |
           dealii::UpdateFlags::update_JxW_values);
   unsigned int const n_q_points = q_collection.max_n_quadrature_points();
   unsigned int const dofs_per_cell = fe_collection.max_dofs_per_cell();
-  internal::compute_average(n_q_points, dofs_per_cell, _mp_dof_handler,
-                            temperature_dof_handler, hp_fe_values, temperature,
-                            temperature_average);
+  auto const &partitioner = temperature.get_partitioner();
+
+  MemoryBlock<unsigned int, dealii::MemorySpace::Host> dof_indices_host(
+      _dofs_map.size(), dofs_per_cell);
+  MemoryBlock<double, dealii::MemorySpace::Host> weights_host(_dofs_map.size(),
+                                                              dofs_per_cell);
+  dof_indices_host.set_zero();
+  weights_host.set_zero();
+  MemoryBlockView<unsigned int, dealii::MemorySpace::Host> dof_indices_view(
+      dof_indices_host);
+  MemoryBlockView<double, dealii::MemorySpace::Host> weights_view(
+      weights_host);
+
+  std::vector<dealii::types::global_dof_index> enth_dof_indices(dofs_per_cell);
+  // The triangulation is the same for both DoFHandler
+  auto mp_cell = _mp_dof_handler.begin_active();
+  auto mp_end_cell = _mp_dof_handler.end();
+  auto enth_cell = temperature_dof_handler.begin_active();
+  for (; mp_cell != mp_end_cell; ++enth_cell, ++mp_cell)
+  {
+    ASSERT(mp_cell->is_locally_owned() == enth_cell->is_locally_owned(),
+           "Internal Error");
+    if ((mp_cell->is_locally_owned()) && (enth_cell->active_fe_index() == 0))
+    {
+      hp_fe_values.reinit(enth_cell);
+      dealii::FEValues<dim> const &fe_values =
+          hp_fe_values.get_present_fe_values();
+      unsigned int const cell_i =
+          _local_cell_indices[mp_cell->active_cell_index()];
+      enth_cell->get_dof_indices(enth_dof_indices);
+      double volume = 0.;
+      for (unsigned int i = 0; i < dofs_per_cell; ++i)
+      {
+        for (unsigned int q = 0; q < n_q_points; ++q)
+          weights_view(cell_i, i) +=
+              fe_values.shape_value(i, q) * fe_values.JxW(q);
+        volume += weights_view(cell_i, i);
+        dof_indices_view(cell_i, i) =
+            partitioner->global_to_local(enth_dof_indices[i]);
+      }
+      for (unsigned int i = 0; i < dofs_per_cell; ++i)
+        weights_view(cell_i, i) /= volume;
+    }
+  }
+
+  _average_dof_indices.reinit(dof_indices_host);
+  _average_weights.reinit(weights_host);
+  _average_partitioner = partitioner;
+}
+
+// We need to compute the average temperature on the cell because we need the
+// material properties to be uniform over the cell. If there aren't then we have
+// problems with the weak form discretization.
+template <int dim, typename MemorySpaceType>
+dealii::LA::distributed::Vector<double, MemorySpaceType>
+MaterialProperty<dim, MemorySpaceType>::compute_average_temperature(
+    dealii::DoFHandler<dim> const &temperature_dof_handler,
+    dealii::LA::distributed::Vector<double, MemorySpaceType> const &temperature)
+{
+  update_average_temperature_weights(temperature_dof_handler, temperature);
+  dealii::LA::distributed::Vector<double, MemorySpaceType> temperature_average(
+      _mp_dof_handler.locally_owned_dofs(), temperature.get_mpi_communicator());
+  temperature.update_ghost_values();
+
+  double const *temperature_local = temperature.get_values();
+  double *temperature_average_local = temperature_average.get_values();
+  MemoryBlockView<unsigned int, MemorySpaceType> average_dof_indices_view(
+      _average_dof_indices);
+  MemoryBlockView<double, MemorySpaceType> average_weights_view(
+      _average_weights);
+  unsigned int const dofs_per_cell = _average_weights.extent(1);
+  for_each(MemorySpaceType{}, _dofs_map.size(),
+           [=] ADAMANTINE_HOST_DEV(int i)
+           {
+             double average = 0.;
+             for (unsigned int j = 0; j < dofs_per_cell; ++j)
+               average += average_weights_view(i, j) *
+                          temperature_local[average_dof_indices_view(i, j)];
+             temperature_average_local[i] = average;
+           });
 
   return temperature_average;
 }
@@ -1036,45 +1122,21 @@ MaterialProperty<dim, MemorySpaceType>::compute_property_from_table(
     unsigned int const material_id, unsigned int const material_state,
     unsigned int const property, double const temperature)
 {
-  if (temperature <=
-      state_property_tables_view(material_id, material_state, property, 0, 0))
+  // Count the temperatures of the table that are smaller or equal to
+  // temperature. This gives the index of the interval without branching.
+  unsigned int interval = 0;
+  for (unsigned int i = 0; i < table_size; ++i)
   {
-    return state_property_tables_view(material_id, material_state, property, 0,
-                                      1);
+    interval += static_cast<unsigned int>(
+        state_property_tables_view(material_id, material_state, property, i,
+                                   0) <= temperature);
   }
-  else
-  {
-    unsigned int i = 0;
-    unsigned int const size = state_property_tables_view.extent(3);
-    for (; i < size; ++i)
-    {
-      if (temperature < state_property_tables_view(material_id, material_state,
-                                                   property, i, 0))
-      {
-        break;
-      }
-    }
 
-    if (i >= size - 1)
-    {
-      return state_property_tables_view(material_id, material_state, property,
-                                        size - 1, 1);
-    }
-    else
-    {
-      auto tempertature_i = state_property_tables_view(
-          material_id, material_state, property, i, 0);
-      auto tempertature_im1 = state_property_tables_view(
-          material_id, material_state, property, i - 1, 0);
-      auto property_i = state_property_tables_view(material_id, material_state,
-                                                   property, i, 1);
-      auto property_im1 = state_property_tables_view(
-          material_id, material_state, property, i - 1, 1);
-      return property_im1 + (temperature - tempertature_im1) *
-                                (property_i - property_im1) /
-                                (tempertature_i - tempertature_im1);
-    }
-  }
+  return state_property_tables_view(material_id, material_state, property,
+                                    interval, 1) +
+         state_property_tables_view(material_id, material_state, property,
+                                    interval, 2) *
+             temperature;
 }
 
 } // namespace adamantine
@@ -10,6 +10,7 @@
 #include <utils.hh>
 
 #include <deal.II/base/index_set.h>
+#include <deal.II/base/mpi.h>
 #include <deal.II/base/symmetric_tensor.h>
 #include <deal.II/base/tensor.h>
 #include <deal.II/differentiation/ad.h>
@@ -22,6 +23,7 @@
 #include <deal.II/lac/affine_constraints.h>
 #include <deal.II/lac/full_matrix.h>
 #include <deal.II/lac/sparsity_tools.h>
+#include <deal.II/matrix_free/fe_evaluation.h>
 #include <deal.II/physics/elasticity/standard_tensors.h>
 
 namespace adamantine
@@ -30,23 +32,51 @@ template <int dim, typename MemorySpaceType>
 MechanicalOperator<dim, MemorySpaceType>::MechanicalOperator(
     MPI_Comm const &communicator,
     MaterialProperty<dim, MemorySpaceType> &material_properties,
-    std::vector<double> const reference_temperatures, bool include_gravity)
+    std::vector<double> const reference_temperatures, bool include_gravity,
+    bool matrix_free)
     : _communicator(communicator), _include_gravity(include_gravity),
+      _matrix_free_enabled(matrix_free),
       _reference_temperatures(reference_temperatures),
       _material_properties(material_properties)
 {
 }
 
+template <int dim, typename MemorySpaceType>
+MechanicalOperator<dim, MemorySpaceType>::~MechanicalOperator()
+{
+  _mesh_changed_connection.disconnect();
+}
+
 template <int dim, typename MemorySpaceType>
 void MechanicalOperator<dim, MemorySpaceType>::reinit(
     dealii::DoFHandler<dim> const &dof_handler,
     dealii::AffineConstraints<double> const &affine_constraints,
     dealii::hp::QCollection<dim> const &q_collection)
 {
+  bool const same_objects = (_dof_handler == &dof_handler) &&
+                            (_affine_constraints == &affine_constraints) &&
+                            (_q_collection == &q_collection);
+  // The refinement, the coarsening, and the repartitioning of the mesh change
+  // the dofs even when the elastic moduli and the number of dofs are the same.
+  if (_dof_handler != &dof_handler)
+  {
+    _mesh_changed_connection.disconnect();
+    _mesh_changed_connection =
+        dof_handler.get_triangulation().signals.any_change.connect(
+            [this]() { _mesh_changed = true; });
+    _mesh_changed = true;
+  }
   _dof_handler = &dof_handler;
   _affine_constraints = &affine_constraints;
   _q_collection = &q_collection;
-  assemble_system();
+  // The operator only needs to be rebuilt if the mesh, the active cells, or
+  // the elastic moduli have changed. Otherwise, only the right-hand-side, which
+  // depends on the temperature, is reassembled.
+  bool const moduli_changed = update_cell_moduli();
+  _matrix_changed = !same_objects || moduli_changed;
+  if (_matrix_changed)
+    assemble_matrix();
+  assemble_rhs();
 }
 
 template <int dim, typename MemorySpaceType>
@@ -55,7 +85,15 @@ void MechanicalOperator<dim, MemorySpaceType>::vmult(
     dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> const
         &src) const
 {
-  _system_matrix.vmult(dst, src);
+  if (_matrix_free_enabled)
+  {
+    dst = 0.;
+    vmult_add(dst, src);
+  }
+  else
+  {
+    _system_matrix.vmult(dst, src);
+  }
 }
 
 template <int dim, typename MemorySpaceType>
@@ -64,7 +102,11 @@ void MechanicalOperator<dim, MemorySpaceType>::Tvmult(
     dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> const
         &src) const
 {
-  _system_matrix.Tvmult(dst, src);
+  // The system of equation is symmetric so we can use vmult
+  if (_matrix_free_enabled)
+    vmult(dst, src);
+  else
+    _system_matrix.Tvmult(dst, src);
 }
 
 template <int dim, typename MemorySpaceType>
@@ -73,7 +115,22 @@ void MechanicalOperator<dim, MemorySpaceType>::vmult_add(
     dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> const
         &src) const
 {
-  _system_matrix.vmult_add(dst, src);
+  if (_matrix_free_enabled)
+  {
+    _matrix_free.cell_loop(&MechanicalOperator::cell_local_apply, this, dst,
+                           src);
+    // Because cell_loop resolves the constraints, the constrained dofs are not
+    // called they stay at zero. Thus, we need to force the value on the
+    // constrained dofs by hand.
+    std::vector<unsigned int> const &constrained_dofs =
+        _matrix_free.get_constrained_dofs();
+    for (auto &dof : constrained_dofs)
+      dst.local_element(dof) += src.local_element(dof);
+  }
+  else
+  {
+    _system_matrix.vmult_add(dst, src);
+  }
 }
 
 template <int dim, typename MemorySpaceType>
@@ -82,7 +139,11 @@ void MechanicalOperator<dim, MemorySpaceType>::Tvmult_add(
     dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> const
         &src) const
 {
-  _system_matrix.Tvmult_add(dst, src);
+  // The system of equation is symmetric so we can use vmult_add
+  if (_matrix_free_enabled)
+    vmult_add(dst, src);
+  else
+    _system_matrix.Tvmult_add(dst, src);
 }
 
 template <int dim, typename MemorySpaceType>
@@ -98,20 +159,175 @@ void MechanicalOperator<dim, MemorySpaceType>::update_temperature(
 }
 
 template <int dim, typename MemorySpaceType>
-void MechanicalOperator<dim, MemorySpaceType>::assemble_system()
+void MechanicalOperator<dim, MemorySpaceType>::compute_lame_parameters()
 {
-  // Create the sparsity pattern. Since we use a Trilinos matrix we don't need
-  // the sparsity pattern to outlive the sparse matrix.
+  unsigned int const n_cells = _matrix_free.n_cell_batches();
+  _lambda.resize(n_cells);
+  _mu.resize(n_cells);
+  _lambda.fill(dealii::make_vectorized_array(0.));
+  _mu.fill(dealii::make_vectorized_array(0.));
+  for (unsigned int cell = 0; cell < n_cells; ++cell)
+    for (unsigned int i = 0;
+         i < _matrix_free.n_active_entries_per_cell_batch(cell); ++i)
+    {
+      typename dealii::DoFHandler<dim>::cell_iterator cell_it =
+          _matrix_free.get_cell_iterator(cell, i);
+      if (cell_it->active_fe_index() != 0)
+        continue;
+      // Cast to Triangulation<dim>::cell_iterator to access the material_id
+      typename dealii::Triangulation<dim>::active_cell_iterator cell_tria(
+          cell_it);
+      _lambda[cell][i] = _material_properties.get_mechanical_property(
+          cell_tria, StateProperty::lame_first_parameter);
+      _mu[cell][i] = _material_properties.get_mechanical_property(
+          cell_tria, StateProperty::lame_second_parameter);
+    }
+}
+
+template <int dim, typename MemorySpaceType>
+void MechanicalOperator<dim, MemorySpaceType>::compute_inverse_diagonal()
+{
+  auto &diagonal = _inverse_diagonal.get_vector();
+  _matrix_free.initialize_dof_vector(diagonal);
+
+  // The diagonal is computed by applying the operator to the unit vectors of
+  // each cell and by keeping the diagonal entry of the result.
+  dealii::FEEvaluation<dim, -1, 0, dim, double> fe_eval(_matrix_free, 0, 0, 0,
+                                                        0);
+  unsigned int const dofs_per_cell = fe_eval.dofs_per_cell;
+  dealii::AlignedVector<dealii::VectorizedArray<double>> local_diagonal(
+      dofs_per_cell);
+  unsigned int const n_cells = _matrix_free.n_cell_batches();
+  for (unsigned int cell = 0; cell < n_cells; ++cell)
+  {
+    if (_matrix_free.get_cell_range_category(std::make_pair(cell, cell + 1)) !=
+        0)
+      continue;
+
+    fe_eval.reinit(cell);
+    for (unsigned int i = 0; i < dofs_per_cell; ++i)
+    {
+      for (unsigned int j = 0; j < dofs_per_cell; ++j)
+        fe_eval.begin_dof_values()[j] = dealii::make_vectorized_array(0.);
+      fe_eval.begin_dof_values()[i] = dealii::make_vectorized_array(1.);
+      local_apply(fe_eval, cell);
+      local_diagonal[i] = fe_eval.begin_dof_values()[i];
+    }
+    for (unsigned int i = 0; i < dofs_per_cell; ++i)
+      fe_eval.begin_dof_values()[i] = local_diagonal[i];
+    fe_eval.distribute_local_to_global(diagonal);
+  }
+  diagonal.compress(dealii::VectorOperation::add);
+
+  // The constrained dofs are set to one in vmult_add
+  std::vector<unsigned int> const &constrained_dofs =
+      _matrix_free.get_constrained_dofs();
+  for (auto &dof : constrained_dofs)
+    diagonal.local_element(dof) = 1.;
+
+  unsigned int const local_size = diagonal.locally_owned_size();
+  for (unsigned int k = 0; k < local_size; ++k)
+  {
+    double const value = diagonal.local_element(k);
+    diagonal.local_element(k) = value > 0. ? 1. / value : 1.;
+  }
+}
+
+template <int dim, typename MemorySpaceType>
+void MechanicalOperator<dim, MemorySpaceType>::local_apply(
+    dealii::FEEvaluation<dim, -1, 0, dim, double> &fe_eval,
+    unsigned int const cell) const
+{
+  fe_eval.evaluate(dealii::EvaluationFlags::gradients);
+  auto const &lambda = _lambda[cell];
+  auto const &mu = _mu[cell];
+  for (unsigned int q = 0; q < fe_eval.n_q_points; ++q)
+  {
+    // sigma = lambda tr(epsilon) I + 2 mu epsilon
+    auto const strain = fe_eval.get_symmetric_gradient(q);
+    auto const lambda_trace = lambda * dealii::trace(strain);
+    auto stress = (2. * mu) * strain;
+    for (unsigned int d = 0; d < dim; ++d)
+      stress[d][d] += lambda_trace;
+    fe_eval.submit_symmetric_gradient(stress, q);
+  }
+  fe_eval.integrate(dealii::EvaluationFlags::gradients);
+}
+
+template <int dim, typename MemorySpaceType>
+void MechanicalOperator<dim, MemorySpaceType>::cell_local_apply(
+    dealii::MatrixFree<dim, double> const &data,
+    dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> &dst,
+    dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> const
+        &src,
+    std::pair<unsigned int, unsigned int> const &cell_range) const
+{
+  // Get the subrange of cells associated with the fe index 0
+  std::pair<unsigned int, unsigned int> cell_subrange =
+      data.create_cell_subrange_hp_by_index(cell_range, 0);
+  if (cell_subrange.first == cell_subrange.second)
+    return;
+
+  dealii::FEEvaluation<dim, -1, 0, dim, double> fe_eval(data, 0, 0, 0, 0);
+  for (unsigned int cell = cell_subrange.first; cell < cell_subrange.second;
+       ++cell)
+  {
+    fe_eval.reinit(cell);
+    fe_eval.read_dof_values(src);
+    local_apply(fe_eval, cell);
+    fe_eval.distribute_local_to_global(dst);
+  }
+}
+
+template <int dim, typename MemorySpaceType>
+bool MechanicalOperator<dim, MemorySpaceType>::update_cell_moduli()
+{
+  // The cells that are not locally owned or that use FE_Nothing are marked
+  // with a negative value.
+  std::vector<std::array<double, 2>> cell_moduli(
+      _dof_handler->get_triangulation().n_active_cells(), {{-1., -1.}});
+  for (auto const &cell :
+       _dof_handler->active_cell_iterators() |
+           dealii::IteratorFilters::ActiveFEIndexEqualTo(0, true))
+  {
+    cell_moduli[cell->active_cell_index()] = {
+        {_material_properties.get_mechanical_property(
+             cell, StateProperty::lame_first_parameter),
+         _material_properties.get_mechanical_property(
+             cell, StateProperty::lame_second_parameter)}};
+  }
+  // The activation of cells does not change the mesh but the cells using
+  // FE_Nothing are marked in the moduli.
+  unsigned int const changed = (cell_moduli != _cell_moduli) || _mesh_changed;
+  _cell_moduli.swap(cell_moduli);
+  _mesh_changed = false;
+
+  return dealii::Utilities::MPI::max(changed, _communicator) > 0;
+}
+
+template <int dim, typename MemorySpaceType>
+void MechanicalOperator<dim, MemorySpaceType>::assemble_matrix()
+{
+  if (_matrix_free_enabled)
+  {
+    typename dealii::MatrixFree<dim, double>::AdditionalData
+        matrix_free_data;
+    matrix_free_data.tasks_parallel_scheme =
+        dealii::MatrixFree<dim, double>::AdditionalData::partition_color;
+    matrix_free_data.mapping_update_flags =
+        dealii::update_gradients | dealii::update_JxW_values;
+    _matrix_free.reinit(dealii::StaticMappingQ1<dim>::mapping, *_dof_handler,
+                        *_affine_constraints, *_q_collection,
+                        matrix_free_data);
+    compute_lame_parameters();
+    compute_inverse_diagonal();
+
+    return;
+  }
+
   auto locally_owned_dofs = _dof_handler->locally_owned_dofs();
   auto locally_relevant_dofs =
       dealii::DoFTools::extract_locally_relevant_dofs(*_dof_handler);
-  dealii::DynamicSparsityPattern dsp(locally_relevant_dofs);
-  dealii::DoFTools::make_sparsity_pattern(*_dof_handler, dsp,
-                                          *_affine_constraints, false);
-  dealii::SparsityTools::distribute_sparsity_pattern(
-      dsp, locally_owned_dofs, _communicator, locally_relevant_dofs);
-
-  _system_matrix.reinit(locally_owned_dofs, dsp, _communicator);
 
   dealii::hp::FEValues<dim> displacement_hp_fe_values(
       _dof_handler->get_fe_collection(), *_q_collection,
@@ -123,8 +339,18 @@ void MechanicalOperator<dim, MemorySpaceType>::assemble_system()
   dealii::FullMatrix<double> cell_matrix(dofs_per_cell, dofs_per_cell);
   std::vector<dealii::types::global_dof_index> local_dof_indices(dofs_per_cell);
 
+  // Create the sparsity pattern. Since we use a Trilinos matrix we don't need
+  // the sparsity pattern to outlive the sparse matrix.
+  dealii::DynamicSparsityPattern dsp(locally_relevant_dofs);
+  dealii::DoFTools::make_sparsity_pattern(*_dof_handler, dsp,
+                                          *_affine_constraints, false);
+  dealii::SparsityTools::distribute_sparsity_pattern(
+      dsp, locally_owned_dofs, _communicator, locally_relevant_dofs);
+
+  _system_matrix.reinit(locally_owned_dofs, dsp, _communicator);
+
   // Loop over the locally owned cells that are not FE_Nothing and assemble the
-  // sparse matrix and the right-hand-side
+  // sparse matrix
   for (auto const &cell :
        _dof_handler->active_cell_iterators() |
            dealii::IteratorFilters::ActiveFEIndexEqualTo(0, true))
@@ -169,6 +395,25 @@ void MechanicalOperator<dim, MemorySpaceType>::assemble_system()
         cell_matrix, local_dof_indices, _system_matrix);
   }
 
+  _system_matrix.compress(dealii::VectorOperation::add);
+}
+
+template <int dim, typename MemorySpaceType>
+void MechanicalOperator<dim, MemorySpaceType>::assemble_rhs()
+{
+  auto locally_owned_dofs = _dof_handler->locally_owned_dofs();
+  auto locally_relevant_dofs =
+      dealii::DoFTools::extract_locally_relevant_dofs(*_dof_handler);
+
+  dealii::hp::FEValues<dim> displacement_hp_fe_values(
+      _dof_handler->get_fe_collection(), *_q_collection,
+      dealii::update_values | dealii::update_gradients |
+          dealii::update_JxW_values);
+
+  unsigned int const dofs_per_cell =
+      _dof_handler->get_fe_collection().max_dofs_per_cell();
+  std::vector<dealii::types::global_dof_index> local_dof_indices(dofs_per_cell);
+
   // Assemble the rhs
   dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
       assembled_rhs(locally_owned_dofs, locally_relevant_dofs, _communicator);
@@ -319,11 +564,14 @@ void MechanicalOperator<dim, MemorySpaceType>::assemble_system()
     }
   }
 
-  _system_matrix.compress(dealii::VectorOperation::add);
   assembled_rhs.compress(dealii::VectorOperation::add);
 
-  // When solving the system, we don't want ghost entries
-  _system_rhs.reinit(_dof_handler->locally_owned_dofs(), _communicator);
+  // When solving the system, we don't want ghost entries. The matrix-free
+  // operator needs the vectors to use the partitioner of _matrix_free.
+  if (_matrix_free_enabled)
+    _matrix_free.initialize_dof_vector(_system_rhs);
+  else
+    _system_rhs.reinit(_dof_handler->locally_owned_dofs(), _communicator);
   _system_rhs = assembled_rhs;
 }
 } // namespace adamantine
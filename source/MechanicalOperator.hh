@@ -1,4 +1,4 @@
-/* Copyright (c) 2022, the adamantine authors.
+/* Copyright (c) 2022 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -11,15 +11,24 @@
 #include <MaterialProperty.hh>
 #include <Operator.hh>
 
+#include <deal.II/base/aligned_vector.h>
 #include <deal.II/base/memory_space.h>
 #include <deal.II/base/quadrature_lib.h>
+#include <deal.II/base/vectorization.h>
 #include <deal.II/dofs/dof_handler.h>
 #include <deal.II/hp/q_collection.h>
 #include <deal.II/lac/affine_constraints.h>
+#include <deal.II/lac/diagonal_matrix.h>
 #include <deal.II/lac/la_parallel_vector.h>
 #include <deal.II/lac/trilinos_sparse_matrix.h>
+#include <deal.II/matrix_free/fe_evaluation.h>
+#include <deal.II/matrix_free/matrix_free.h>
 
 #include <boost/property_tree/ptree.hpp>
+#include <boost/signals2/connection.hpp>
+
+#include <array>
+#include <vector>
 
 namespace adamantine
 {
@@ -27,6 +36,9 @@ namespace adamantine
  * This class is the operator associated with the solid mechanics equations.
  * The class is templated on the MemorySpace because it use MaterialProperty
  * which itself is templated on the MemorySpace but the operator is CPU only.
+ * The operator either assembles a sparse matrix or it is applied matrix-free.
+ * In the matrix-free case, the degree of the finite element is only known at
+ * run time and the kernels are not templated on it.
  */
 template <int dim, typename MemorySpaceType>
 class MechanicalOperator : public Operator<dealii::MemorySpace::Host>
@@ -34,12 +46,20 @@ class MechanicalOperator : public Operator<dealii::MemorySpace::Host>
 public:
   /**
    * Constructor. If the initial temperature is negative, the simulation is
-   * mechanical only. Otherwise, we solve a thermo-mechanical problem.
+   * mechanical only. Otherwise, we solve a thermo-mechanical problem. If @p
+   * matrix_free is true, the sparse matrix is not assembled and the operator
+   * is applied matrix-free.
    */
   MechanicalOperator(
       MPI_Comm const &communicator,
       MaterialProperty<dim, MemorySpaceType> &material_properties,
-      std::vector<double> reference_temperatures, bool include_gravity = false);
+      std::vector<double> reference_temperatures, bool include_gravity = false,
+      bool matrix_free = false);
+
+  /**
+   * Destructor.
+   */
+  ~MechanicalOperator();
 
   void reinit(dealii::DoFHandler<dim> const &dof_handler,
               dealii::AffineConstraints<double> const &affine_constraints,
@@ -80,15 +100,77 @@ public:
   dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> const &
   rhs() const;
 
+  /**
+   * Return the sparse matrix. This function cannot be called if the operator
+   * is matrix-free.
+   */
   dealii::TrilinosWrappers::SparseMatrix const &system_matrix() const;
 
+  /**
+   * Return true if the operator is applied matrix-free.
+   */
+  bool is_matrix_free() const;
+
+  /**
+   * Return the inverse of the diagonal of the operator. This function can only
+   * be called if the operator is matrix-free.
+   */
+  dealii::DiagonalMatrix<
+      dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>> const
+      &inverse_diagonal() const;
+
+  /**
+   * Return true if the last call to reinit() rebuilt the operator. Otherwise,
+   * only the right-hand-side was reassembled.
+   */
+  bool matrix_changed() const;
+
 private:
   /**
-   * Assemble the matrix and the right-hand-side.
+   * Compute the Lame parameters of the locally owned cells and return true if
+   * they, or the mesh, changed on any processor since the last call.
+   */
+  bool update_cell_moduli();
+
+  /**
+   * Assemble the matrix or, if the operator is matrix-free, initialize the
+   * MatrixFree object and the data associated with it.
    * @Note The 2D case does not represent any physical model but it is
    * convenient for testing.
    */
-  void assemble_system();
+  void assemble_matrix();
+
+  /**
+   * Assemble the right-hand-side.
+   */
+  void assemble_rhs();
+
+  /**
+   * Compute the Lame parameters of every cell batch of _matrix_free.
+   */
+  void compute_lame_parameters();
+
+  /**
+   * Compute _inverse_diagonal using _matrix_free.
+   */
+  void compute_inverse_diagonal();
+
+  /**
+   * Apply the operator on the cell batch @p cell. The values of the dofs are
+   * read from and written to @p fe_eval.
+   */
+  void local_apply(dealii::FEEvaluation<dim, -1, 0, dim, double> &fe_eval,
+                   unsigned int const cell) const;
+
+  /**
+   * Apply the operator on a range of cells.
+   */
+  void cell_local_apply(
+      dealii::MatrixFree<dim, double> const &data,
+      dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> &dst,
+      dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> const
+          &src,
+      std::pair<unsigned int, unsigned int> const &cell_range) const;
 
   /**
    * MPI communicator.
@@ -98,6 +180,28 @@ private:
    * Whether to include a gravitional body force in the calculation.
    */
   bool _include_gravity = false;
+  /**
+   * Whether the operator is applied matrix-free.
+   */
+  bool _matrix_free_enabled = false;
+  /**
+   * Whether the last call to reinit() rebuilt the operator.
+   */
+  bool _matrix_changed = true;
+  /**
+   * First and second Lame parameters of the active cells, indexed by the
+   * active cell index, when the operator was last built.
+   */
+  std::vector<std::array<double, 2>> _cell_moduli;
+  /**
+   * Flag is true if the mesh has changed since the operator was last built.
+   */
+  bool _mesh_changed = true;
+  /**
+   * Connection to the signal of the triangulation that is triggered when the
+   * mesh changes.
+   */
+  boost::signals2::connection _mesh_changed_connection;
   /**
    * List of initial temperatures of the material. If the length of the vector
    * is nonzero, we solve a thermo-mechanical problem.
@@ -132,6 +236,22 @@ private:
    * Matrix of the mechanical problem.
    */
   dealii::TrilinosWrappers::SparseMatrix _system_matrix;
+  /**
+   * MatrixFree object used when the operator is matrix-free.
+   */
+  dealii::MatrixFree<dim, double> _matrix_free;
+  /**
+   * First and second Lame parameters of every cell batch of _matrix_free.
+   */
+  dealii::AlignedVector<dealii::VectorizedArray<double>> _lambda;
+  dealii::AlignedVector<dealii::VectorizedArray<double>> _mu;
+  /**
+   * Inverse of the diagonal of the matrix-free operator. It is used as
+   * preconditioner.
+   */
+  dealii::DiagonalMatrix<
+      dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>>
+      _inverse_diagonal;
   /**
    * Temperature of the material.
    */
@@ -149,14 +269,14 @@ template <int dim, typename MemorySpaceType>
 inline dealii::types::global_dof_index
 MechanicalOperator<dim, MemorySpaceType>::m() const
 {
-  return _system_matrix.m();
+  return _matrix_free_enabled ? _dof_handler->n_dofs() : _system_matrix.m();
 }
 
 template <int dim, typename MemorySpaceType>
 inline dealii::types::global_dof_index
 MechanicalOperator<dim, MemorySpaceType>::n() const
 {
-  return _system_matrix.n();
+  return _matrix_free_enabled ? _dof_handler->n_dofs() : _system_matrix.n();
 }
 
 template <int dim, typename MemorySpaceType>
@@ -171,7 +291,33 @@ template <int dim, typename MemorySpaceType>
 inline dealii::TrilinosWrappers::SparseMatrix const &
 MechanicalOperator<dim, MemorySpaceType>::system_matrix() const
 {
+  ASSERT(!_matrix_free_enabled,
+         "The matrix is not assembled when the operator is matrix-free.");
+
   return _system_matrix;
 }
+
+template <int dim, typename MemorySpaceType>
+inline bool MechanicalOperator<dim, MemorySpaceType>::is_matrix_free() const
+{
+  return _matrix_free_enabled;
+}
+
+template <int dim, typename MemorySpaceType>
+inline bool MechanicalOperator<dim, MemorySpaceType>::matrix_changed() const
+{
+  return _matrix_changed;
+}
+
+template <int dim, typename MemorySpaceType>
+inline dealii::DiagonalMatrix<
+    dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>> const &
+MechanicalOperator<dim, MemorySpaceType>::inverse_diagonal() const
+{
+  ASSERT(_matrix_free_enabled,
+         "The diagonal is only computed when the operator is matrix-free.");
+
+  return _inverse_diagonal;
+}
 } // namespace adamantine
 #endif
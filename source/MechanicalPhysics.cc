@@ -11,10 +11,14 @@
 #include <deal.II/dofs/dof_tools.h>
 #include <deal.II/fe/fe_nothing.h>
 #include <deal.II/fe/fe_q.h>
+#include <deal.II/fe/mapping_q1.h>
 #include <deal.II/lac/solver_cg.h>
 #include <deal.II/lac/trilinos_precondition.h>
 #include <deal.II/numerics/vector_tools.h>
 
+#include <Epetra_MultiVector.h>
+#include <Teuchos_ParameterList.hpp>
+
 namespace adamantine
 {
 template <int dim, typename MemorySpaceType>
@@ -22,10 +26,11 @@ MechanicalPhysics<dim, MemorySpaceType>::MechanicalPhysics(
     MPI_Comm const &communicator, unsigned int fe_degree,
     Geometry<dim> &geometry,
     MaterialProperty<dim, MemorySpaceType> &material_properties,
-    std::vector<double> reference_temperatures, bool include_gravity)
+    std::vector<double> reference_temperatures, bool include_gravity,
+    bool matrix_free, bool use_amg)
     : _geometry(geometry), _material_properties(material_properties),
       _dof_handler(_geometry.get_triangulation()),
-      _include_gravity(include_gravity)
+      _include_gravity(include_gravity), _use_amg(use_amg && !matrix_free)
 {
   // Create the FECollection
   _fe_collection.push_back(
@@ -57,7 +62,7 @@ MechanicalPhysics<dim, MemorySpaceType>::MechanicalPhysics(
   _mechanical_operator =
       std::make_unique<MechanicalOperator<dim, MemorySpaceType>>(
           communicator, _material_properties, reference_temperatures,
-          include_gravity);
+          include_gravity, matrix_free);
 }
 
 template <int dim, typename MemorySpaceType>
@@ -83,6 +88,14 @@ void MechanicalPhysics<dim, MemorySpaceType>::setup_dofs()
 
   _mechanical_operator->reinit(_dof_handler, _affine_constraints,
                                _q_collection);
+  // The AMG hierarchy is reused as long as the matrix does not change. When the
+  // matrix is reinitialized, the hierarchy refers to the old Epetra matrix, so
+  // it is released right away and rebuilt before the next solve.
+  if (_mechanical_operator->matrix_changed() && _use_amg)
+  {
+    _amg_preconditioner.clear();
+    initialize_amg_preconditioner();
+  }
 }
 
 template <int dim, typename MemorySpaceType>
@@ -123,22 +136,120 @@ MechanicalPhysics<dim, MemorySpaceType>::solve()
   dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> solution(
       _mechanical_operator->rhs().get_partitioner());
 
-  unsigned int const max_iter = _dof_handler.n_dofs() / 10;
+  // The diagonal preconditioner of the matrix-free operator is weaker than
+  // SSOR, so we allow more iterations.
+  unsigned int const max_iter = _mechanical_operator->is_matrix_free()
+                                    ? _dof_handler.n_dofs()
+                                    : _dof_handler.n_dofs() / 10;
   double const tol = 1e-12 * _mechanical_operator->rhs().l2_norm();
   dealii::SolverControl solver_control(max_iter, tol);
   dealii::SolverCG<
       dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>>
       cg(solver_control);
-  // TODO Use better preconditioner
-  dealii::TrilinosWrappers::PreconditionSSOR preconditioner;
-  preconditioner.initialize(_mechanical_operator->system_matrix());
-  cg.solve(_mechanical_operator->system_matrix(), solution,
-           _mechanical_operator->rhs(), preconditioner);
+  if (_mechanical_operator->is_matrix_free())
+  {
+    cg.solve(*_mechanical_operator, solution, _mechanical_operator->rhs(),
+             _mechanical_operator->inverse_diagonal());
+  }
+  else if (_use_amg)
+  {
+    cg.solve(_mechanical_operator->system_matrix(), solution,
+             _mechanical_operator->rhs(), _amg_preconditioner);
+  }
+  else
+  {
+    dealii::TrilinosWrappers::PreconditionSSOR preconditioner;
+    preconditioner.initialize(_mechanical_operator->system_matrix());
+    cg.solve(_mechanical_operator->system_matrix(), solution,
+             _mechanical_operator->rhs(), preconditioner);
+  }
   _affine_constraints.distribute(solution);
 
   return solution;
 }
 
+template <int dim, typename MemorySpaceType>
+void MechanicalPhysics<dim, MemorySpaceType>::initialize_amg_preconditioner()
+{
+  auto const &system_matrix = _mechanical_operator->system_matrix();
+
+  // Compute the rigid body modes, i.e., the dim translations and the
+  // dim*(dim-1)/2 rotations, at the support points of the locally owned dofs.
+  // The local ordering of the Epetra_Map of the matrix is the ordering of the
+  // locally owned dofs.
+  unsigned int constexpr n_modes = dim * (dim + 1) / 2;
+  Epetra_MultiVector rigid_body_modes(
+      system_matrix.trilinos_matrix().DomainMap(), n_modes);
+  dealii::IndexSet const &locally_owned_dofs =
+      _dof_handler.locally_owned_dofs();
+  auto const &fe = _fe_collection[0];
+  std::vector<dealii::types::global_dof_index> dof_indices(
+      fe.n_dofs_per_cell());
+  for (auto const &cell :
+       dealii::filter_iterators(_dof_handler.active_cell_iterators(),
+                                dealii::IteratorFilters::LocallyOwnedCell()))
+  {
+    // Skip the cells using FE_Nothing
+    if (cell->active_fe_index() != 0)
+      continue;
+
+    cell->get_dof_indices(dof_indices);
+    for (unsigned int i = 0; i < dof_indices.size(); ++i)
+    {
+      if (!locally_owned_dofs.is_element(dof_indices[i]))
+        continue;
+
+      unsigned int const local_index =
+          locally_owned_dofs.index_within_set(dof_indices[i]);
+      unsigned int const component = fe.system_to_component_index(i).first;
+      dealii::Point<dim> const point =
+          dealii::StaticMappingQ1<dim>::mapping.transform_unit_to_real_cell(
+              cell, fe.unit_support_point(i));
+      rigid_body_modes[component][local_index] = 1.;
+      if constexpr (dim == 2)
+      {
+        rigid_body_modes[2][local_index] =
+            component == 0 ? -point[1] : point[0];
+      }
+      else
+      {
+        // Rotations around the x, y, and z axis
+        if (component == 0)
+        {
+          rigid_body_modes[4][local_index] = point[2];
+          rigid_body_modes[5][local_index] = -point[1];
+        }
+        else if (component == 1)
+        {
+          rigid_body_modes[3][local_index] = -point[2];
+          rigid_body_modes[5][local_index] = point[0];
+        }
+        else
+        {
+          rigid_body_modes[3][local_index] = point[1];
+          rigid_body_modes[4][local_index] = -point[0];
+        }
+      }
+    }
+  }
+
+  dealii::TrilinosWrappers::PreconditionAMG::AdditionalData amg_data;
+  amg_data.elliptic = true;
+  amg_data.higher_order_elements = fe.degree > 1;
+  amg_data.smoother_sweeps = 2;
+  amg_data.aggregation_threshold = 0.02;
+  Teuchos::ParameterList parameter_list;
+  std::unique_ptr<Epetra_MultiVector> distributed_constant_modes;
+  amg_data.set_parameters(parameter_list, distributed_constant_modes,
+                          system_matrix.trilinos_matrix());
+  // Replace the default near null space by the rigid body modes. ML copies the
+  // vectors when the hierarchy is built.
+  parameter_list.set("null space: type", "pre-computed");
+  parameter_list.set("null space: dimension", rigid_body_modes.NumVectors());
+  parameter_list.set("null space: vectors", rigid_body_modes.Values());
+  _amg_preconditioner.initialize(system_matrix, parameter_list);
+}
+
 } // namespace adamantine
 
 INSTANTIATE_DIM_HOST(MechanicalPhysics)
@@ -14,6 +14,7 @@
 #include <deal.II/base/quadrature_lib.h>
 #include <deal.II/fe/fe_system.h>
 #include <deal.II/hp/fe_collection.h>
+#include <deal.II/lac/trilinos_precondition.h>
 
 namespace adamantine
 {
@@ -22,13 +23,17 @@ class MechanicalPhysics
 {
 public:
   /**
-   * Constructor.
+   * Constructor. If @p matrix_free is true, the MechanicalOperator is applied
+   * matrix-free and the linear system is preconditioned using the inverse of
+   * its diagonal. Otherwise, the linear system is preconditioned using SSOR or,
+   * if @p use_amg is true, using algebraic multigrid.
    */
   MechanicalPhysics(MPI_Comm const &communicator, unsigned int fe_degree,
                     Geometry<dim> &geometry,
                     MaterialProperty<dim, MemorySpaceType> &material_properties,
                     std::vector<double> initial_temperatures,
-                    bool include_gravity = false);
+                    bool include_gravity = false, bool matrix_free = false,
+                    bool use_amg = false);
 
   /**
    * Setup the DoFHandler, the AffineConstraints, and the MechanicalOperator.
@@ -60,6 +65,12 @@ public:
   dealii::AffineConstraints<double> &get_affine_constraints();
 
 private:
+  /**
+   * Build the algebraic multigrid preconditioner using the rigid body modes as
+   * near null space.
+   */
+  void initialize_amg_preconditioner();
+
   /**
    * Associated Geometry.
    */
@@ -93,6 +104,15 @@ private:
    * Whether to include a gravitional body force in the calculation.
    */
   bool _include_gravity;
+  /**
+   * Whether to use the algebraic multigrid preconditioner.
+   */
+  bool _use_amg;
+  /**
+   * Algebraic multigrid preconditioner. It is rebuilt every time the matrix of
+   * the operator is reinitialized.
+   */
+  dealii::TrilinosWrappers::PreconditionAMG _amg_preconditioner;
 };
 
 template <int dim, typename MemorySpaceType>
@@ -0,0 +1,69 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <MechanicalSolveScheduler.hh>
+#include <utils.hh>
+
+#include <cmath>
+
+namespace adamantine
+{
+MechanicalSolveScheduler::MechanicalSolveScheduler(
+    boost::property_tree::ptree const &database,
+    unsigned int default_time_steps)
+{
+  // PropertyTreeInput time_stepping.time_steps_between_mechanical_solves
+  _time_steps_between_solves =
+      database.get("time_steps_between_mechanical_solves", default_time_steps);
+  // PropertyTreeInput time_stepping.mechanical_solve_at_new_layer
+  _solve_at_new_layer = database.get("mechanical_solve_at_new_layer", false);
+  // PropertyTreeInput time_stepping.mechanical_solve_temperature_change
+  _temperature_change = database.get("mechanical_solve_temperature_change", 0.);
+  ASSERT_THROW(_temperature_change >= 0.,
+               "Error: mechanical_solve_temperature_change must be "
+               "non-negative.");
+}
+
+void MechanicalSolveScheduler::add_deposited_material(double height)
+{
+  // The material deposited before the first layer is considered to be the
+  // substrate.
+  double const tolerance = 1e-12 * std::abs(height);
+  if (height > _deposition_height + tolerance)
+  {
+    if (_deposition_height != std::numeric_limits<double>::lowest())
+      _new_layer = true;
+    _deposition_height = height;
+  }
+}
+
+bool MechanicalSolveScheduler::solve_now(unsigned int n_time_step,
+                                         double max_temperature,
+                                         bool last_time_step) const
+{
+  if (last_time_step || !_solved_once)
+    return true;
+
+  if ((_time_steps_between_solves > 0) &&
+      (n_time_step % _time_steps_between_solves == 0))
+    return true;
+
+  if (_solve_at_new_layer && _new_layer)
+    return true;
+
+  return temperature_trigger() &&
+         (std::abs(max_temperature - _last_max_temperature) >
+          _temperature_change);
+}
+
+void MechanicalSolveScheduler::mechanical_solved(double max_temperature)
+{
+  _new_layer = false;
+  _last_max_temperature = max_temperature;
+  _solved_once = true;
+}
+} // namespace adamantine
@@ -0,0 +1,116 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef MECHANICAL_SOLVE_SCHEDULER_HH
+#define MECHANICAL_SOLVE_SCHEDULER_HH
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <limits>
+
+namespace adamantine
+{
+/**
+ * This class decides when the mechanical problem is solved during a
+ * thermo-mechanical simulation. The thermal problem is evolved at every time
+ * step while the mechanical problem is only solved on the following events:
+ *  - every given number of time steps,
+ *  - when a new layer of material starts to be deposited, i.e., when the
+ *    previous layer is complete,
+ *  - when the maximum temperature has changed by more than a given threshold
+ *    since the last mechanical solve,
+ *  - at the last time step.
+ */
+class MechanicalSolveScheduler
+{
+public:
+  /**
+   * Constructor. The options are read from the time_stepping @p database. By
+   * default, the mechanical problem is solved every @p default_time_steps time
+   * steps.
+   */
+  MechanicalSolveScheduler(boost::property_tree::ptree const &database,
+                           unsigned int default_time_steps);
+
+  /**
+   * Record that material whose top is at @p height has been deposited during
+   * the current time step. A new layer starts when the material is deposited
+   * above the material deposited previously.
+   */
+  void add_deposited_material(double height);
+
+  /**
+   * Return true if the layer trigger is enabled. add_deposited_material() only
+   * needs to be called in that case.
+   */
+  bool layer_trigger() const;
+
+  /**
+   * Return true if the temperature trigger is enabled. The maximum temperature
+   * only needs to be computed in that case.
+   */
+  bool temperature_trigger() const;
+
+  /**
+   * Return true if the mechanical problem needs to be solved at the end of the
+   * time step @p n_time_step given the current @p max_temperature.
+   */
+  bool solve_now(unsigned int n_time_step, double max_temperature,
+                 bool last_time_step) const;
+
+  /**
+   * Record that the mechanical problem has been solved when the maximum
+   * temperature was @p max_temperature.
+   */
+  void mechanical_solved(double max_temperature);
+
+private:
+  /**
+   * Number of time steps between two mechanical solves. If the value is zero,
+   * the mechanical solves are only triggered by the other events.
+   */
+  unsigned int _time_steps_between_solves;
+  /**
+   * Whether a mechanical solve is triggered when a new layer starts.
+   */
+  bool _solve_at_new_layer;
+  /**
+   * Change of the maximum temperature that triggers a mechanical solve. If the
+   * value is zero, the temperature trigger is disabled.
+   */
+  double _temperature_change;
+  /**
+   * Top of the material deposited so far.
+   */
+  double _deposition_height = std::numeric_limits<double>::lowest();
+  /**
+   * Flag set to true when a new layer has started since the last mechanical
+   * solve.
+   */
+  bool _new_layer = false;
+  /**
+   * Maximum temperature at the last mechanical solve.
+   */
+  double _last_max_temperature = 0.;
+  /**
+   * Flag set to true once the mechanical problem has been solved.
+   */
+  bool _solved_once = false;
+};
+
+inline bool MechanicalSolveScheduler::layer_trigger() const
+{
+  return _solve_at_new_layer;
+}
+
+inline bool MechanicalSolveScheduler::temperature_trigger() const
+{
+  return _temperature_change > 0.;
+}
+} // namespace adamantine
+
+#endif
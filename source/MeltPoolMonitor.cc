@@ -0,0 +1,179 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <MeltPoolMonitor.hh>
+#include <instantiation.hh>
+#include <types.hh>
+#include <utils.hh>
+
+#include <deal.II/base/mpi.h>
+#include <deal.II/fe/fe_values.h>
+#include <deal.II/grid/filtered_iterator.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace adamantine
+{
+template <int dim>
+MeltPoolMonitor<dim>::MeltPoolMonitor(
+    MPI_Comm const &communicator, boost::property_tree::ptree const &database,
+    std::string const &filename)
+    : _communicator(communicator)
+{
+  // PropertyTreeInput materials.n_materials
+  unsigned int const n_materials = database.get<unsigned int>("n_materials");
+  unsigned int n_found = 0;
+  for (dealii::types::material_id id = 0;
+       (id < dealii::numbers::invalid_material_id) && (n_found < n_materials);
+       ++id)
+  {
+    std::string const material = "material_" + std::to_string(id);
+    if (database.count(material) == 0)
+      continue;
+
+    _material_solidus.resize(id + 1, std::numeric_limits<double>::max());
+    _material_liquidus.resize(id + 1, std::numeric_limits<double>::max());
+    // PropertyTreeInput materials.material_X.solidus
+    _material_solidus[id] = database.get<double>(material + ".solidus");
+    // PropertyTreeInput materials.material_X.liquidus
+    _material_liquidus[id] = database.get<double>(material + ".liquidus");
+    ++n_found;
+  }
+
+  if (dealii::Utilities::MPI::this_mpi_process(_communicator) == 0)
+  {
+    _file.open(filename);
+    ASSERT_THROW(_file.good(), "Error: Cannot open the file " + filename + ".");
+    _file << "time,peak_temperature,length,";
+    if constexpr (dim == 3)
+      _file << "width,";
+    _file << "depth,cooling_rate\n";
+  }
+}
+
+template <int dim>
+void MeltPoolMonitor<dim>::write_metrics(
+    double time, dealii::DoFHandler<dim> const &dof_handler,
+    dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> const
+        &temperature)
+{
+  // The cooling rate can only be computed if the dofs have not changed since
+  // the last call.
+  bool const dofs_changed = temperature.get_partitioner() != _partitioner;
+  if (dofs_changed)
+    update_support_points(dof_handler, temperature);
+
+  // The minimum coordinates are negated so that all the quantities can be
+  // reduced using a single maximum.
+  unsigned int const n_metrics = 2 * dim + 2;
+  std::vector<double> local_metrics(n_metrics,
+                                    std::numeric_limits<double>::lowest());
+  unsigned int const peak_index = 2 * dim;
+  unsigned int const cooling_index = 2 * dim + 1;
+  double const delta_t = time - _old_time;
+  unsigned int const n_points = _local_indices.size();
+  for (unsigned int i = 0; i < n_points; ++i)
+  {
+    double const t = temperature.local_element(_local_indices[i]);
+    local_metrics[peak_index] = std::max(local_metrics[peak_index], t);
+    if (t > _liquidus[i])
+    {
+      for (int d = 0; d < dim; ++d)
+      {
+        local_metrics[d] = std::max(local_metrics[d], _support_points[i][d]);
+        local_metrics[dim + d] =
+            std::max(local_metrics[dim + d], -_support_points[i][d]);
+      }
+    }
+    if (!dofs_changed && (delta_t > 0.) &&
+        (_old_temperature[i] >= _solidus[i]) && (t < _solidus[i]))
+    {
+      local_metrics[cooling_index] = std::max(
+          local_metrics[cooling_index], (_old_temperature[i] - t) / delta_t);
+    }
+    _old_temperature[i] = t;
+  }
+  _old_time = time;
+
+  std::vector<double> metrics(n_metrics);
+  MPI_Reduce(local_metrics.data(), metrics.data(), n_metrics, MPI_DOUBLE,
+             MPI_MAX, 0, _communicator);
+
+  if (dealii::Utilities::MPI::this_mpi_process(_communicator) == 0)
+  {
+    // If nothing has melted, the extents are zero
+    auto const extent = [&](int d)
+    {
+      return metrics[d] > std::numeric_limits<double>::lowest()
+                 ? metrics[d] + metrics[dim + d]
+                 : 0.;
+    };
+    _metrics.peak_temperature = metrics[peak_index];
+    _metrics.length = extent(axis<dim>::x);
+    if constexpr (dim == 3)
+      _metrics.width = extent(axis<dim>::y);
+    _metrics.depth = extent(axis<dim>::z);
+    _metrics.cooling_rate = std::max(metrics[cooling_index], 0.);
+
+    _file << time << "," << _metrics.peak_temperature << ","
+          << _metrics.length << ",";
+    if constexpr (dim == 3)
+      _file << _metrics.width << ",";
+    _file << _metrics.depth << "," << _metrics.cooling_rate << "\n";
+  }
+}
+
+template <int dim>
+void MeltPoolMonitor<dim>::update_support_points(
+    dealii::DoFHandler<dim> const &dof_handler,
+    dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> const
+        &temperature)
+{
+  _partitioner = temperature.get_partitioner();
+  _local_indices.clear();
+  _support_points.clear();
+  _solidus.clear();
+  _liquidus.clear();
+
+  dealii::FiniteElement<dim> const &fe = dof_handler.get_fe(0);
+  dealii::FEValues<dim> fe_values(fe, fe.get_unit_support_points(),
+                                  dealii::update_quadrature_points);
+  std::vector<dealii::types::global_dof_index> dof_indices(
+      fe.n_dofs_per_cell());
+  std::vector<bool> visited(temperature.locally_owned_size(), false);
+  for (auto const &cell : dealii::filter_iterators(
+           dof_handler.active_cell_iterators(),
+           dealii::IteratorFilters::LocallyOwnedCell(),
+           dealii::IteratorFilters::ActiveFEIndexEqualTo(0)))
+  {
+    fe_values.reinit(cell);
+    cell->get_dof_indices(dof_indices);
+    auto const &points = fe_values.get_quadrature_points();
+    for (unsigned int i = 0; i < fe.n_dofs_per_cell(); ++i)
+    {
+      // Only the locally owned dofs are used and each dof is used once.
+      if (!_partitioner->in_local_range(dof_indices[i]))
+        continue;
+      unsigned int const local_index =
+          _partitioner->global_to_local(dof_indices[i]);
+      if (visited[local_index])
+        continue;
+      visited[local_index] = true;
+
+      _local_indices.push_back(local_index);
+      _support_points.push_back(points[i]);
+      _solidus.push_back(_material_solidus[cell->material_id()]);
+      _liquidus.push_back(_material_liquidus[cell->material_id()]);
+    }
+  }
+
+  _old_temperature.assign(_local_indices.size(), 0.);
+}
+} // namespace adamantine
+
+INSTANTIATE_DIM(MeltPoolMonitor)
@@ -0,0 +1,149 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef MELT_POOL_MONITOR_HH
+#define MELT_POOL_MONITOR_HH
+
+#include <deal.II/base/partitioner.h>
+#include <deal.II/base/point.h>
+#include <deal.II/dofs/dof_handler.h>
+#include <deal.II/lac/la_parallel_vector.h>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <fstream>
+#include <memory>
+#include <vector>
+
+namespace adamantine
+{
+/**
+ * Metrics of the melt pool at a given time.
+ */
+struct MeltPoolMetrics
+{
+  /**
+   * Maximum temperature in the domain.
+   */
+  double peak_temperature = 0.;
+  /**
+   * Extent of the melt pool along the x axis.
+   */
+  double length = 0.;
+  /**
+   * Extent of the melt pool along the y axis (3D only).
+   */
+  double width = 0.;
+  /**
+   * Extent of the melt pool along the z axis.
+   */
+  double depth = 0.;
+  /**
+   * Maximum cooling rate of the points that have cooled below the solidus
+   * since the previous metrics were computed.
+   */
+  double cooling_rate = 0.;
+};
+
+/**
+ * This class computes the metrics of the melt pool during the simulation and
+ * appends them to a csv file. The melt pool is made of the support points of
+ * the activated dofs whose temperature is above the liquidus of their
+ * material. The extents of the melt pool are measured along the axes of the
+ * mesh.
+ */
+template <int dim>
+class MeltPoolMonitor
+{
+public:
+  /**
+   * Constructor. The solidus and the liquidus of the materials are read from
+   * the materials @p database. The metrics are written in @p filename by the
+   * first processor of @p communicator.
+   */
+  MeltPoolMonitor(MPI_Comm const &communicator,
+                  boost::property_tree::ptree const &database,
+                  std::string const &filename);
+
+  /**
+   * Compute the metrics of the melt pool given the @p temperature at @p time
+   * and append them to the file. The support points are only computed again
+   * if the dofs of @p dof_handler have changed since the last call.
+   */
+  void write_metrics(
+      double time, dealii::DoFHandler<dim> const &dof_handler,
+      dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> const
+          &temperature);
+
+  /**
+   * Return the metrics computed by the last call to write_metrics(). The
+   * metrics are only valid on the first processor.
+   */
+  MeltPoolMetrics const &get_metrics() const;
+
+private:
+  /**
+   * Compute the support points of the locally owned dofs of the activated
+   * cells and the solidus and the liquidus associated to them.
+   */
+  void update_support_points(
+      dealii::DoFHandler<dim> const &dof_handler,
+      dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> const
+          &temperature);
+
+  /**
+   * MPI communicator.
+   */
+  MPI_Comm _communicator;
+  /**
+   * Solidus of each material id.
+   */
+  std::vector<double> _material_solidus;
+  /**
+   * Liquidus of each material id.
+   */
+  std::vector<double> _material_liquidus;
+  /**
+   * Partitioner of the temperature used to compute the support points. When
+   * the partitioner changes, the dofs have changed.
+   */
+  std::shared_ptr<dealii::Utilities::MPI::Partitioner const> _partitioner;
+  /**
+   * Local indices in the temperature of the locally owned dofs of the
+   * activated cells.
+   */
+  std::vector<unsigned int> _local_indices;
+  /**
+   * Support points, solidus, and liquidus associated to _local_indices.
+   */
+  std::vector<dealii::Point<dim>> _support_points;
+  std::vector<double> _solidus;
+  std::vector<double> _liquidus;
+  /**
+   * Temperature and time of the previous call to write_metrics(). They are
+   * used to compute the cooling rate.
+   */
+  std::vector<double> _old_temperature;
+  double _old_time = 0.;
+  /**
+   * Metrics computed by the last call to write_metrics().
+   */
+  MeltPoolMetrics _metrics;
+  /**
+   * Output file used by the first processor.
+   */
+  std::ofstream _file;
+};
+
+template <int dim>
+inline MeltPoolMetrics const &MeltPoolMonitor<dim>::get_metrics() const
+{
+  return _metrics;
+}
+} // namespace adamantine
+
+#endif
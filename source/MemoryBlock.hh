@@ -1,4 +1,4 @@
-/* Copyright (c) 2021-2022, the adamantine authors.
+/* Copyright (c) 2021-2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -11,13 +11,18 @@
 #include <utils.hh>
 
 #include <array>
+#include <cstddef>
 #include <ostream>
 
 namespace adamantine
 {
 /**
  * This class allocates a block of memory on the host or the device. To access
- * the underlying data use MemoryBlockView.
+ * the underlying data use MemoryBlockView. The allocation only grows: reinit()
+ * reuses the memory already allocated when the new block is not larger than
+ * the largest block allocated so far. This avoids reallocating the memory each
+ * time the mesh is refined or cells are activated. Use clear() to release the
+ * memory.
  */
 template <typename Number, typename MemorySpaceType>
 class MemoryBlock
@@ -59,22 +64,23 @@ public:
   MemoryBlock(std::vector<Number> const &input_data);
 
   /**
-   * Free the memory and reallocate new memory block.
+   * Resize the memory block. The memory is only reallocated if the block
+   * grows. The values are not preserved.
    */
   void reinit(unsigned int dim_0, unsigned int dim_1 = 0,
               unsigned int dim_2 = 0, unsigned int dim_3 = 0,
               unsigned int dim_4 = 0);
 
   /**
-   * Free the memory, reallocate new memory block, and copy the data from @p
-   * other to the correct memory space.
+   * Resize the memory block and copy the data from @p other to the correct
+   * memory space. The memory is only reallocated if the block grows.
    */
   template <typename MemorySpaceType2>
   void reinit(MemoryBlock<Number, MemorySpaceType2> const &other);
 
   /**
-   * Free the memory, reallocate new memory block, and copy the data from @p
-   * input_data to the correct memory space.
+   * Resize the memory block and copy the data from @p input_data to the
+   * correct memory space. The memory is only reallocated if the block grows.
    */
   void reinit(std::vector<Number> const &input_data);
 
@@ -89,10 +95,21 @@ public:
   void clear();
 
   /**
-   * Number of allocated elements.
+   * Number of elements in the block.
    */
   unsigned int size() const;
 
+  /**
+   * Number of elements that can be stored without reallocating the memory.
+   */
+  unsigned int capacity() const;
+
+  /**
+   * Return the number of bytes allocated by the block. The memory is allocated
+   * in MemorySpaceType.
+   */
+  std::size_t memory_consumption() const;
+
   /**
    * Return the @p i dimension.
    */
@@ -120,7 +137,14 @@ private:
   template <typename Number2, typename MemorySpaceType2>
   friend class MemoryBlockView;
 
+  /**
+   * Make sure that _size elements can be stored. The memory is only
+   * reallocated if _size is larger than _capacity.
+   */
+  void allocate();
+
   unsigned int _size = 0;
+  unsigned int _capacity = 0;
   std::array<unsigned int, n_dim> _extent = {{0, 0, 0, 0, 0}};
   Number *_data = nullptr;
 };
@@ -145,7 +169,7 @@ MemoryBlock<Number, MemorySpaceType>::MemoryBlock(unsigned int dim_0,
       _size *= _extent[i];
   }
 
-  _data = Memory<Number, MemorySpaceType>::allocate_data(_size);
+  allocate();
 }
 
 template <typename Number, typename MemorySpaceType>
@@ -154,7 +178,7 @@ MemoryBlock<Number, MemorySpaceType>::MemoryBlock(
 {
   _size = other._size;
   _extent = other._extent;
-  _data = Memory<Number, MemorySpaceType>::allocate_data(_size);
+  allocate();
   deep_copy(_data, MemorySpaceType{}, other._data, MemorySpaceType{}, _size);
 }
 
@@ -165,7 +189,7 @@ MemoryBlock<Number, MemorySpaceType>::MemoryBlock(
 {
   _size = other._size;
   _extent = other._extent;
-  _data = Memory<Number, MemorySpaceType>::allocate_data(_size);
+  allocate();
   deep_copy(_data, MemorySpaceType{}, other._data, MemorySpaceType2{}, _size);
 }
 
@@ -175,7 +199,7 @@ MemoryBlock<Number, MemorySpaceType>::MemoryBlock(
 {
   _size = input_data.size();
   _extent[0] = _size;
-  _data = Memory<Number, MemorySpaceType>::allocate_data(_size);
+  allocate();
   deep_copy(_data, MemorySpaceType{}, input_data.data(),
             dealii::MemorySpace::Host{}, _size);
 }
@@ -187,7 +211,6 @@ void MemoryBlock<Number, MemorySpaceType>::reinit(unsigned int dim_0,
                                                   unsigned int dim_3,
                                                   unsigned int dim_4)
 {
-  clear();
   _extent[0] = dim_0;
   _extent[1] = dim_1;
   _extent[2] = dim_2;
@@ -201,7 +224,7 @@ void MemoryBlock<Number, MemorySpaceType>::reinit(unsigned int dim_0,
       _size *= _extent[i];
   }
 
-  _data = Memory<Number, MemorySpaceType>::allocate_data(_size);
+  allocate();
 }
 
 template <typename Number, typename MemorySpaceType>
@@ -209,10 +232,9 @@ template <typename MemorySpaceType2>
 void MemoryBlock<Number, MemorySpaceType>::reinit(
     MemoryBlock<Number, MemorySpaceType2> const &other)
 {
-  clear();
   _size = other._size;
   _extent = other._extent;
-  _data = Memory<Number, MemorySpaceType>::allocate_data(_size);
+  allocate();
   deep_copy(*this, other);
 }
 
@@ -220,14 +242,13 @@ template <typename Number, typename MemorySpaceType>
 void MemoryBlock<Number, MemorySpaceType>::reinit(
     std::vector<Number> const &input_data)
 {
-  clear();
   _size = input_data.size();
   _extent[0] = _size;
   _extent[1] = 0;
   _extent[2] = 0;
   _extent[3] = 0;
   _extent[4] = 0;
-  _data = Memory<Number, MemorySpaceType>::allocate_data(_size);
+  allocate();
   deep_copy(_data, MemorySpaceType{}, input_data.data(),
             dealii::MemorySpace::Host{}, _size);
 }
@@ -244,18 +265,43 @@ void MemoryBlock<Number, MemorySpaceType>::clear()
   if (_data != nullptr)
   {
     _size = 0;
+    _capacity = 0;
     _extent = {{0, 0, 0, 0, 0}};
     Memory<Number, MemorySpaceType>::delete_data(_data);
     _data = nullptr;
   }
 }
 
+template <typename Number, typename MemorySpaceType>
+void MemoryBlock<Number, MemorySpaceType>::allocate()
+{
+  if ((_size > _capacity) || (_data == nullptr))
+  {
+    if (_data != nullptr)
+      Memory<Number, MemorySpaceType>::delete_data(_data);
+    _data = Memory<Number, MemorySpaceType>::allocate_data(_size);
+    _capacity = _size;
+  }
+}
+
 template <typename Number, typename MemorySpaceType>
 unsigned int MemoryBlock<Number, MemorySpaceType>::size() const
 {
   return _size;
 }
 
+template <typename Number, typename MemorySpaceType>
+unsigned int MemoryBlock<Number, MemorySpaceType>::capacity() const
+{
+  return _capacity;
+}
+
+template <typename Number, typename MemorySpaceType>
+std::size_t MemoryBlock<Number, MemorySpaceType>::memory_consumption() const
+{
+  return static_cast<std::size_t>(_capacity) * sizeof(Number);
+}
+
 template <typename Number, typename MemorySpaceType>
 unsigned int MemoryBlock<Number, MemorySpaceType>::extent(unsigned int i) const
 {
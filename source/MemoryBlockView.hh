@@ -1,4 +1,4 @@
-/* Copyright (c) 2021-2022, the adamantine authors.
+/* Copyright (c) 2021-2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -34,6 +34,15 @@ public:
   ADAMANTINE_HOST_DEV
   MemoryBlockView(MemoryBlock<Number, MemorySpaceType> const &memory_block);
 
+  /**
+   * Constructor. Create a view on the memory pointed by @p data which is
+   * subdivided in the dimensions @p dim_0 to @p dim_4.
+   */
+  ADAMANTINE_HOST_DEV
+  MemoryBlockView(Number *data, unsigned int dim_0, unsigned int dim_1 = 0,
+                  unsigned int dim_2 = 0, unsigned int dim_3 = 0,
+                  unsigned int dim_4 = 0);
+
   /**
    * Copy constructor.
    */
@@ -120,6 +129,22 @@ ADAMANTINE_HOST_DEV MemoryBlockView<Number, MemorySpaceType>::MemoryBlockView(
   _data = memory_block._data;
 }
 
+template <typename Number, typename MemorySpaceType>
+ADAMANTINE_HOST_DEV MemoryBlockView<Number, MemorySpaceType>::MemoryBlockView(
+    Number *data, unsigned int dim_0, unsigned int dim_1, unsigned int dim_2,
+    unsigned int dim_3, unsigned int dim_4)
+    : _dim_0(dim_0), _dim_1(dim_1), _dim_2(dim_2), _dim_3(dim_3),
+      _dim_4(dim_4), _data(data)
+{
+  unsigned int const extents[4] = {_dim_1, _dim_2, _dim_3, _dim_4};
+  _size = _dim_0;
+  for (unsigned int i = 0; i < 4; ++i)
+  {
+    if (extents[i] != 0)
+      _size *= extents[i];
+  }
+}
+
 template <typename Number, typename MemorySpaceType>
 ADAMANTINE_HOST_DEV MemoryBlockView<Number, MemorySpaceType>::MemoryBlockView(
     MemoryBlockView<Number, MemorySpaceType> const &memory_block_view)
@@ -0,0 +1,91 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <MemoryReport.hh>
+#include <utils.hh>
+
+#include <deal.II/base/utilities.h>
+
+#include <algorithm>
+#include <cstdint>
+
+#ifdef ADAMANTINE_HAVE_CUDA
+#include <cuda_runtime_api.h>
+#endif
+
+namespace adamantine
+{
+MemoryReport::MemoryReport(MPI_Comm const &communicator,
+                           std::string const &filename)
+    : _communicator(communicator)
+{
+  MPI_Comm_rank(_communicator, &_rank);
+  MPI_Comm_size(_communicator, &_n_processes);
+  if (_rank == 0)
+  {
+    _file.open(filename);
+    ASSERT_THROW(_file.good(), "Error: Cannot open the file " + filename + ".");
+    _file << "time_step,time,rank,subsystem,bytes\n";
+  }
+}
+
+void MemoryReport::add(std::string const &subsystem, std::size_t bytes)
+{
+  auto entry = std::find_if(_entries.begin(), _entries.end(),
+                            [&](auto const &entry)
+                            { return entry.first == subsystem; });
+  if (entry != _entries.end())
+    entry->second += bytes;
+  else
+    _entries.emplace_back(subsystem, bytes);
+}
+
+void MemoryReport::write(unsigned int time_step, double time)
+{
+  std::size_t total = 0;
+  for (auto const &entry : _entries)
+    total += entry.second;
+  _entries.emplace_back("total", total);
+
+  // The resident set size is given in kB
+  dealii::Utilities::System::MemoryStats stats;
+  dealii::Utilities::System::get_memory_stats(stats);
+  _entries.emplace_back("process_resident", stats.VmRSS * 1024);
+
+#ifdef ADAMANTINE_HAVE_CUDA
+  std::size_t free_device_memory = 0;
+  std::size_t total_device_memory = 0;
+  cudaError_t const error_code =
+      cudaMemGetInfo(&free_device_memory, &total_device_memory);
+  ASSERT_THROW(error_code == cudaSuccess,
+               std::string("Error: ") + cudaGetErrorString(error_code));
+  _entries.emplace_back("device_used",
+                        total_device_memory - free_device_memory);
+  _entries.emplace_back("device_total", total_device_memory);
+#endif
+
+  unsigned int const n_entries = _entries.size();
+  std::vector<std::uint64_t> local_bytes(n_entries);
+  for (unsigned int i = 0; i < n_entries; ++i)
+    local_bytes[i] = _entries[i].second;
+  std::vector<std::uint64_t> bytes(_rank == 0 ? n_entries * _n_processes : 0);
+  MPI_Gather(local_bytes.data(), n_entries, MPI_UINT64_T, bytes.data(),
+             n_entries, MPI_UINT64_T, 0, _communicator);
+
+  if (_rank == 0)
+  {
+    for (int rank = 0; rank < _n_processes; ++rank)
+      for (unsigned int i = 0; i < n_entries; ++i)
+        _file << time_step << "," << time << "," << rank << ","
+              << _entries[i].first << "," << bytes[rank * n_entries + i]
+              << "\n";
+    _file.flush();
+  }
+
+  _entries.clear();
+}
+} // namespace adamantine
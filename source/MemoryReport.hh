@@ -0,0 +1,88 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef MEMORY_REPORT_HH
+#define MEMORY_REPORT_HH
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <mpi.h>
+
+namespace adamantine
+{
+/**
+ * This class collects the memory used by each subsystem of the simulation and
+ * writes it to a csv file. Every line of the file contains the time step, the
+ * time, the rank of the processor, the name of the subsystem, and the number
+ * of bytes used. Besides the subsystems added by the user, the report contains
+ * the sum of the subsystems, the resident set size of the process and, for
+ * CUDA runs, the used and the total memory of the device.
+ */
+class MemoryReport
+{
+public:
+  /**
+   * Constructor. The entries of all the processors of @p communicator are
+   * written by the first processor in @p filename.
+   */
+  MemoryReport(MPI_Comm const &communicator, std::string const &filename);
+
+  /**
+   * Add the memory in bytes used by a subsystem. If the subsystem has already
+   * been added since the last call to write(), the bytes are added to the
+   * existing entry. All the processors must add the same subsystems in the
+   * same order.
+   */
+  void add(std::string const &subsystem, std::size_t bytes);
+
+  /**
+   * Gather the entries of all the processors and write them. The entries are
+   * cleared afterwards. This function is collective.
+   */
+  void write(unsigned int time_step, double time);
+
+  /**
+   * Return the entries that have been added on this processor since the last
+   * call to write().
+   */
+  std::vector<std::pair<std::string, std::size_t>> const &get_entries() const;
+
+private:
+  /**
+   * MPI communicator.
+   */
+  MPI_Comm _communicator;
+  /**
+   * Rank of the processor.
+   */
+  int _rank = 0;
+  /**
+   * Number of processors.
+   */
+  int _n_processes = 1;
+  /**
+   * Name of the subsystems and number of bytes used.
+   */
+  std::vector<std::pair<std::string, std::size_t>> _entries;
+  /**
+   * Output file.
+   */
+  std::ofstream _file;
+};
+
+inline std::vector<std::pair<std::string, std::size_t>> const &
+MemoryReport::get_entries() const
+{
+  return _entries;
+}
+} // namespace adamantine
+
+#endif
@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2021, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -9,8 +9,10 @@
 
 namespace adamantine
 {
-NewtonSolver::NewtonSolver(unsigned int max_it, double tolerance)
-    : _max_it(max_it), _tolerance(tolerance)
+NewtonSolver::NewtonSolver(unsigned int max_it, double tolerance,
+                           unsigned int max_jacobian_reuse, double stall_ratio)
+    : _max_it(max_it), _tolerance(tolerance),
+      _max_jacobian_reuse(max_jacobian_reuse), _stall_ratio(stall_ratio)
 {
 }
 
@@ -29,16 +31,31 @@ void NewtonSolver::solve(
   unsigned int i = 0;
   double residual_norm_old = residual.l2_norm();
   double residual_norm = residual_norm_old;
+  // The inverse of the Jacobian saved by a previous solve can only be used if
+  // the size of the problem has not changed.
+  if (_inv_jacobian.size() != y.size())
+    _inv_jacobian_valid = false;
   while (i < _max_it)
   {
-    dealii::LA::distributed::Vector<double> newton_step =
-        compute_inv_jacobian(y);
+    if (!_inv_jacobian_valid || (_n_jacobian_reuse >= _max_jacobian_reuse))
+    {
+      _inv_jacobian = compute_inv_jacobian(y);
+      _inv_jacobian_valid = true;
+      _n_jacobian_reuse = 0;
+      ++_n_jacobian_evaluations;
+    }
+    else
+    {
+      ++_n_jacobian_reuse;
+    }
+    dealii::LA::distributed::Vector<double> newton_step = _inv_jacobian;
     newton_step.scale(residual);
     // alpha is used for line search.
     double alpha = 1.0;
     while (residual_norm >= residual_norm_old)
     {
-      y.sadd(1.0, -alpha, newton_step);
+      y = y_old;
+      y.add(-alpha, newton_step);
       residual = compute_residual(y);
       residual_norm = residual.l2_norm();
       alpha /= 2.;
@@ -49,6 +66,11 @@ void NewtonSolver::solve(
     if (residual_norm < _tolerance)
       break;
 
+    // If the convergence stalls, the inverse of the Jacobian is recomputed at
+    // the next iteration.
+    if (residual_norm > _stall_ratio * residual_norm_old)
+      _inv_jacobian_valid = false;
+
     y_old = y;
     residual_norm_old = residual_norm;
 
@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2021, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -12,6 +12,7 @@
 
 #include <deal.II/lac/la_parallel_vector.h>
 
+#include <algorithm>
 #include <functional>
 
 namespace adamantine
@@ -21,14 +22,22 @@ class NewtonSolver
 {
   /**
    * This class implements a Newton solver with basic line search capabilities.
+   * The inverse of the Jacobian can be reused over several iterations, and
+   * over several calls to solve(), i.e., the solver can use the chord or the
+   * Shamanskii method. The inverse of the Jacobian is recomputed when the
+   * convergence stalls.
    */
 public:
   /**
    * Constructor. \p max_it is the maximal number of Newton iteration and \p
    * tolerance
-   * is the tolerance on the solution.
+   * is the tolerance on the solution. The inverse of the Jacobian is reused
+   * at most \p max_jacobian_reuse times before being recomputed. It is also
+   * recomputed when the ratio between two successive residual norms is larger
+   * than \p stall_ratio.
    */
-  NewtonSolver(unsigned int max_it, double tolerance);
+  NewtonSolver(unsigned int max_it, double tolerance,
+               unsigned int max_jacobian_reuse = 0, double stall_ratio = 0.5);
 
   /**
    * Solve non-linear problem.
@@ -46,6 +55,18 @@ public:
                  &compute_inv_jacobian,
              dealii::LA::distributed::Vector<double> &y);
 
+  /**
+   * Discard the inverse of the Jacobian saved by the previous call to solve().
+   * This needs to be called when the size of the problem changes.
+   */
+  void reset_jacobian();
+
+  /**
+   * Return the number of times the inverse of the Jacobian has been computed
+   * since the construction of the object.
+   */
+  unsigned int n_jacobian_evaluations() const;
+
 private:
   /**
    * Maximum number of iteration.
@@ -55,7 +76,69 @@ private:
    * Tolerance.
    */
   double _tolerance;
+  /**
+   * Maximum number of times the inverse of the Jacobian is reused.
+   */
+  unsigned int _max_jacobian_reuse;
+  /**
+   * Ratio between two successive residual norms above which the inverse of the
+   * Jacobian is recomputed.
+   */
+  double _stall_ratio;
+  /**
+   * Number of times the current inverse of the Jacobian has been reused.
+   */
+  unsigned int _n_jacobian_reuse = 0;
+  /**
+   * Number of times the inverse of the Jacobian has been computed.
+   */
+  unsigned int _n_jacobian_evaluations = 0;
+  /**
+   * Flag set to true when _inv_jacobian can be reused.
+   */
+  bool _inv_jacobian_valid = false;
+  /**
+   * Last inverse of the Jacobian computed.
+   */
+  dealii::LA::distributed::Vector<double> _inv_jacobian;
 };
+
+inline void NewtonSolver::reset_jacobian() { _inv_jacobian_valid = false; }
+
+inline unsigned int NewtonSolver::n_jacobian_evaluations() const
+{
+  return _n_jacobian_evaluations;
+}
+
+/**
+ * Compute the forcing term of an inexact Newton method, i.e., the relative
+ * tolerance of the linear solver, using the second choice of Eisenstat and
+ * Walker. @p residual_norm and @p previous_residual_norm are the norms of
+ * the current and of the previous Newton residual, and @p
+ * previous_forcing_term is the previous forcing term. On the first Newton
+ * iteration, @p previous_residual_norm should be zero. The result is in
+ * [@p min_forcing_term, @p max_forcing_term].
+ */
+inline double compute_forcing_term(double residual_norm,
+                                   double previous_residual_norm,
+                                   double previous_forcing_term,
+                                   double min_forcing_term,
+                                   double max_forcing_term = 0.9)
+{
+  if (previous_residual_norm <= 0.)
+    return std::max(min_forcing_term, max_forcing_term);
+
+  double const gamma = 0.9;
+  double const ratio = residual_norm / previous_residual_norm;
+  double forcing_term = gamma * ratio * ratio;
+  // Safeguard against the forcing term decreasing too fast
+  double const safeguard =
+      gamma * previous_forcing_term * previous_forcing_term;
+  if (safeguard > 0.1)
+    forcing_term = std::max(forcing_term, safeguard);
+
+  return std::max(min_forcing_term, std::min(forcing_term, max_forcing_term));
+}
 } // namespace adamantine
 
 #endif
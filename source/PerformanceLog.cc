@@ -0,0 +1,71 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <PerformanceLog.hh>
+#include <types.hh>
+#include <utils.hh>
+
+#include <array>
+
+namespace adamantine
+{
+namespace
+{
+// Sections of the time step written in the log
+std::array<Timing, 7> constexpr logged_timers = {
+    evol_time, evol_time_eval_th_ph, evol_time_J_inv,
+    evol_time_update_bound_mat_prop, refine, add_material_activate, output};
+} // namespace
+
+PerformanceLog::PerformanceLog(MPI_Comm const &communicator,
+                               std::string const &filename)
+{
+  int rank = 0;
+  MPI_Comm_rank(communicator, &rank);
+  _write = (rank == 0);
+  if (_write)
+  {
+    _file.open(filename);
+    ASSERT_THROW(_file.good(), "Error: Cannot open the file " + filename + ".");
+    _file << "time_step,time,delta_t,n_active_cells,n_dofs,"
+             "n_linear_iterations,n_newton_iterations,evolve_time,"
+             "evaluate_thermal_physics_time,linear_solve_time,"
+             "material_properties_time,refinement_time,add_material_time,"
+             "output_time,dofs_per_second\n";
+  }
+}
+
+void PerformanceLog::write_time_step(TimeStepRecord const &record,
+                                     std::vector<Timer> const &timers)
+{
+  if (!_write)
+    return;
+
+  ASSERT(timers.size() >= n_timers, "Missing timers.");
+  _previous_times.resize(logged_timers.size(), 0.);
+  _file << record.time_step << "," << record.time << "," << record.delta_t
+        << "," << record.n_active_cells << "," << record.n_dofs << ","
+        << record.n_linear_iterations << "," << record.n_newton_iterations;
+  double evolve_time = 0.;
+  for (unsigned int i = 0; i < logged_timers.size(); ++i)
+  {
+    double const elapsed_time =
+        boost::chrono::duration_cast<boost::chrono::microseconds>(
+            timers[logged_timers[i]].get_elapsed_time())
+            .count() *
+        1e-6;
+    double const section_time = elapsed_time - _previous_times[i];
+    _previous_times[i] = elapsed_time;
+    if (logged_timers[i] == evol_time)
+      evolve_time = section_time;
+    _file << "," << section_time;
+  }
+  double const dofs_per_second =
+      evolve_time > 0. ? record.n_dofs / evolve_time : 0.;
+  _file << "," << dofs_per_second << "\n";
+}
+} // namespace adamantine
@@ -0,0 +1,99 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef PERFORMANCE_LOG_HH
+#define PERFORMANCE_LOG_HH
+
+#include <Timer.hh>
+
+#include <deal.II/base/types.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+
+namespace adamantine
+{
+/**
+ * Data describing a time step recorded by PerformanceLog.
+ */
+struct TimeStepRecord
+{
+  /**
+   * Index of the time step.
+   */
+  unsigned int time_step = 0;
+  /**
+   * Time at the end of the time step.
+   */
+  double time = 0.;
+  /**
+   * Length of the time step.
+   */
+  double delta_t = 0.;
+  /**
+   * Number of active cells in the mesh.
+   */
+  dealii::types::global_cell_index n_active_cells = 0;
+  /**
+   * Number of dofs of the thermal problem.
+   */
+  dealii::types::global_dof_index n_dofs = 0;
+  /**
+   * Number of iterations of the linear solver.
+   */
+  unsigned int n_linear_iterations = 0;
+  /**
+   * Number of Newton iterations.
+   */
+  unsigned int n_newton_iterations = 0;
+};
+
+/**
+ * This class appends a line per time step to a csv file with the size of the
+ * problem, the number of iterations of the solvers, the time spent in the
+ * main sections of the time step, and the throughput of the time step in dofs
+ * per second. The times are measured by the timers of the first processor,
+ * which writes the file. No communication is involved and the file is only
+ * flushed when its buffer is full.
+ */
+class PerformanceLog
+{
+public:
+  /**
+   * Constructor. The first processor of @p communicator writes the log in @p
+   * filename.
+   */
+  PerformanceLog(MPI_Comm const &communicator, std::string const &filename);
+
+  /**
+   * Append the @p record of a time step. The time spent in each section is the
+   * difference between the elapsed time of the @p timers and their elapsed
+   * time at the previous call.
+   */
+  void write_time_step(TimeStepRecord const &record,
+                       std::vector<Timer> const &timers);
+
+private:
+  /**
+   * Flag is true if this processor writes the log.
+   */
+  bool _write;
+  /**
+   * Elapsed time in seconds of the timers at the previous call.
+   */
+  std::vector<double> _previous_times;
+  /**
+   * Output file.
+   */
+  std::ofstream _file;
+};
+} // namespace adamantine
+
+#endif
@@ -9,44 +9,23 @@
 #include <instantiation.hh>
 #include <utils.hh>
 
+#include <boost/algorithm/string/predicate.hpp>
+
 #include <fstream>
-#include <regex>
 
 namespace adamantine
 {
-template <int dim>
-PointCloud<dim>::PointCloud(
-    boost::property_tree::ptree const &experiment_database)
+namespace
 {
-  // Format of the file names: the format is pretty arbitrary, #frame and
-  // #camera are replaced by the frame and the camera number.
-  // PropertyTreeInput experiment.file
-  _data_filename = experiment_database.get<std::string>("file");
-  // PropertyTreeInput experiment.first_frame
-  _next_frame = experiment_database.get("first_frame", 0);
-  // PropertyTreeInput experiment.first_camera_id
-  _first_camera_id = experiment_database.get<unsigned int>("first_camera_id");
-  // PropertyTreeInput experiment.last_camera_id
-  _last_camera_id = experiment_database.get<int>("last_camera_id");
-}
-
+/**
+ * Read and parse the csv files of a frame.
+ */
 template <int dim>
-unsigned int PointCloud<dim>::read_next_frame()
+PointsValues<dim> read_csv_frame(std::vector<std::string> const &filenames)
 {
-  _points_values_current_frame.points.clear();
-  _points_values_current_frame.values.clear();
-  for (unsigned int camera_id = _first_camera_id;
-       camera_id < _last_camera_id + 1; ++camera_id)
+  PointsValues<dim> points_values;
+  for (auto const &filename : filenames)
   {
-    // Use regex to get the next file to read
-    std::regex camera_regex("#camera");
-    std::regex frame_regex("#frame");
-    auto filename =
-        std::regex_replace((std::regex_replace(_data_filename, camera_regex,
-                                               std::to_string(camera_id))),
-                           frame_regex, std::to_string(_next_frame));
-    wait_for_file(filename, "Waiting for the next frame: " + filename);
-
     // Read and parse the file
     std::ifstream file;
     file.open(filename);
@@ -87,11 +66,96 @@ unsigned int PointCloud<dim>::read_next_frame()
         last_pos = pos + 1;
       }
 
-      _points_values_current_frame.points.push_back(point);
-      _points_values_current_frame.values.push_back(value);
+      points_values.points.push_back(point);
+      points_values.values.push_back(value);
     }
   }
 
+  return points_values;
+}
+
+/**
+ * Read the binary files of a frame.
+ */
+template <int dim>
+PointsValues<dim> read_binary_frame(std::vector<std::string> const &filenames)
+{
+  PointsValues<dim> points_values;
+  for (auto const &filename : filenames)
+  {
+    auto const columns = read_binary_frame_file(filename, dim + 1);
+    std::size_t const n_points = columns[dim].size();
+    std::size_t const offset = points_values.points.size();
+    points_values.points.resize(offset + n_points);
+    for (std::size_t i = 0; i < n_points; ++i)
+      for (int d = 0; d < dim; ++d)
+        points_values.points[offset + i][d] = columns[d][i];
+    points_values.values.insert(points_values.values.end(),
+                                columns[dim].begin(), columns[dim].end());
+  }
+
+  return points_values;
+}
+} // namespace
+
+template <int dim>
+PointCloud<dim>::PointCloud(
+    boost::property_tree::ptree const &experiment_database)
+{
+  // Format of the file names: the format is pretty arbitrary, #frame and
+  // #camera are replaced by the frame and the camera number.
+  // PropertyTreeInput experiment.file
+  std::string data_filename = experiment_database.get<std::string>("file");
+  // PropertyTreeInput experiment.first_frame
+  _next_frame = experiment_database.get("first_frame", 0);
+  // PropertyTreeInput experiment.first_camera_id
+  unsigned int first_camera_id =
+      experiment_database.get<unsigned int>("first_camera_id");
+  // PropertyTreeInput experiment.last_camera_id
+  unsigned int last_camera_id =
+      experiment_database.get<unsigned int>("last_camera_id");
+  _camera_filenames =
+      get_camera_filenames(data_filename, first_camera_id, last_camera_id);
+
+  // PropertyTreeInput experiment.file_format
+  std::string file_format =
+      experiment_database.get<std::string>("file_format", "csv");
+  if (boost::iequals(file_format, "binary"))
+    _read_frame = read_binary_frame<dim>;
+  else
+    _read_frame = read_csv_frame<dim>;
+
+  // PropertyTreeInput experiment.prefetch_frames
+  unsigned int prefetch_frames = experiment_database.get("prefetch_frames", 0u);
+  if (prefetch_frames > 0)
+  {
+    // PropertyTreeInput experiment.last_frame
+    unsigned int last_frame =
+        experiment_database.get<unsigned int>("last_frame");
+    // The functions are executed by the helper thread and they do not capture
+    // this because the object can be moved.
+    _prefetcher = std::make_unique<FramePrefetcher<PointsValues<dim>>>(
+        [camera_filenames = _camera_filenames](unsigned int frame)
+        { return get_frame_filenames(camera_filenames, frame); },
+        _read_frame, _next_frame, last_frame, prefetch_frames);
+  }
+}
+
+template <int dim>
+unsigned int PointCloud<dim>::read_next_frame()
+{
+  if (_prefetcher)
+  {
+    _points_values_current_frame = _prefetcher->next();
+  }
+  else
+  {
+    auto filenames = get_frame_filenames(_camera_filenames, _next_frame);
+    for (auto const &filename : filenames)
+      wait_for_file(filename, "Waiting for the next frame: " + filename);
+    _points_values_current_frame = _read_frame(filenames);
+  }
+
   return _next_frame++;
 }
 
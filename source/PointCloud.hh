@@ -9,9 +9,13 @@
 #define POINT_CLOUD_HH
 
 #include <ExperimentalData.hh>
+#include <FramePrefetcher.hh>
 
 #include <deal.II/dofs/dof_handler.h>
 
+#include <functional>
+#include <memory>
+
 namespace adamantine
 {
 /**
@@ -36,17 +40,19 @@ private:
    */
   unsigned int _next_frame;
   /**
-   * ID of the first camera.
+   * File names of the frames of each camera.
    */
-  unsigned int _first_camera_id;
+  std::vector<std::string> _camera_filenames;
   /**
-   * ID of the last camera.
+   * Function that reads the files of a frame.
    */
-  unsigned int _last_camera_id;
+  std::function<PointsValues<dim>(std::vector<std::string> const &)>
+      _read_frame;
   /**
-   * Generic file name of the frames.
+   * Reader of the upcoming frames. The pointer is null if the frames are read
+   * when they are needed.
    */
-  std::string _data_filename;
+  std::unique_ptr<FramePrefetcher<PointsValues<dim>>> _prefetcher;
   /**
    * Values and associated points of the current frame.
    */
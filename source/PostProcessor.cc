@@ -7,10 +7,18 @@
 
 #include <PostProcessor.hh>
 #include <instantiation.hh>
+#include <utils.hh>
 
 #include <deal.II/grid/filtered_iterator.h>
 
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/split.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
 #include <fstream>
+#include <future>
 #include <unordered_map>
 
 namespace adamantine
@@ -75,6 +83,13 @@ PostProcessor<dim>::PostProcessor(MPI_Comm const &communicator,
   // PropertyTreeInput post_processor.additional_output_refinement
   _additional_output_refinement =
       database.get<unsigned int>("additional_output_refinement", 0);
+
+  // PropertyTreeInput post_processor.background_writing
+  _background_writing = database.get("background_writing", false);
+  _data_out = std::make_unique<dealii::DataOut<dim>>();
+
+  initialize_output_format(database);
+  initialize_output_reduction(database);
 }
 
 template <int dim>
@@ -102,6 +117,122 @@ PostProcessor<dim>::PostProcessor(
   // PropertyTreeInput post_processor.additional_output_refinement
   _additional_output_refinement =
       database.get<unsigned int>("additional_output_refinement", 0);
+
+  // PropertyTreeInput post_processor.background_writing
+  _background_writing = database.get("background_writing", false);
+  _data_out = std::make_unique<dealii::DataOut<dim>>();
+
+  initialize_output_format(database);
+  initialize_output_reduction(database);
+}
+
+template <int dim>
+PostProcessor<dim>::~PostProcessor()
+{
+  _mesh_changed_connection.disconnect();
+  // Do not rethrow the exceptions of the background task in the destructor.
+  if (_background_output.valid())
+    _background_output.wait();
+}
+
+template <int dim>
+void PostProcessor<dim>::initialize_output_format(
+    boost::property_tree::ptree const &database)
+{
+  // PropertyTreeInput post_processor.output_format
+  std::string const output_format =
+      database.get<std::string>("output_format", "vtu");
+  _hdf5_output = boost::iequals(output_format, "hdf5");
+  if (_hdf5_output)
+  {
+#ifdef DEAL_II_WITH_HDF5
+    // The mesh file is only written again after the triangulation changes.
+    // The activation of cells does not change the mesh.
+    dealii::DoFHandler<dim> *dof_handler =
+        (_thermal_dof_handler) ? _thermal_dof_handler : _mechanical_dof_handler;
+    _mesh_changed_connection =
+        dof_handler->get_triangulation().signals.any_change.connect(
+            [this]() { _mesh_changed = true; });
+#else
+    ASSERT_THROW(false, "The hdf5 output requires deal.II with HDF5.");
+#endif
+  }
+}
+
+template <int dim>
+void PostProcessor<dim>::initialize_output_reduction(
+    boost::property_tree::ptree const &database)
+{
+  // PropertyTreeInput post_processor.activated_cells_only
+  _activated_cells_only = database.get("activated_cells_only", false);
+
+  // The corners of the box are separated by a semicolon and the coordinates by
+  // commas.
+  // PropertyTreeInput post_processor.output_box
+  boost::optional<std::string> output_box_optional =
+      database.get_optional<std::string>("output_box");
+  _use_output_box = static_cast<bool>(output_box_optional);
+  if (_use_output_box)
+  {
+    std::string output_box = output_box_optional.get();
+    output_box.erase(
+        std::remove_if(output_box.begin(), output_box.end(),
+                       [](unsigned char x) { return std::isspace(x); }),
+        output_box.end());
+    std::vector<std::string> corners;
+    boost::split(corners, output_box, [](char c) { return c == ';'; });
+    ASSERT_THROW(corners.size() == 2,
+                 "Error: The output box must be defined by two corners.");
+    std::vector<dealii::Point<dim>> points(2);
+    for (unsigned int i = 0; i < 2; ++i)
+    {
+      std::vector<std::string> coordinates;
+      boost::split(coordinates, corners[i], [](char c) { return c == ','; });
+      ASSERT_THROW(coordinates.size() == dim,
+                   "Error: The corners of the output box must have " +
+                       std::to_string(dim) + " coordinates.");
+      for (int d = 0; d < dim; ++d)
+        points[i][d] = std::stod(coordinates[d]);
+    }
+    // The corners can be given in any order.
+    dealii::Point<dim> lower_corner;
+    dealii::Point<dim> upper_corner;
+    for (int d = 0; d < dim; ++d)
+    {
+      lower_corner[d] = std::min(points[0][d], points[1][d]);
+      upper_corner[d] = std::max(points[0][d], points[1][d]);
+    }
+    _output_box = dealii::BoundingBox<dim>({lower_corner, upper_corner});
+  }
+
+  // PropertyTreeInput post_processor.compression_level
+  std::string const compression_level =
+      database.get<std::string>("compression_level", "best_compression");
+  using CompressionLevel = decltype(_compression_level);
+  if (boost::iequals(compression_level, "no_compression"))
+    _compression_level = CompressionLevel::no_compression;
+  else if (boost::iequals(compression_level, "best_speed"))
+    _compression_level = CompressionLevel::best_speed;
+  else if (boost::iequals(compression_level, "default_compression"))
+    _compression_level = CompressionLevel::default_compression;
+  else
+  {
+    ASSERT_THROW(boost::iequals(compression_level, "best_compression"),
+                 "Error: Unknown compression level " + compression_level +
+                     ".");
+    _compression_level = CompressionLevel::best_compression;
+  }
+
+  // PropertyTreeInput post_processor.time_steps_between_material_output
+  _time_steps_material_output =
+      database.get("time_steps_between_material_output", 1u);
+  // PropertyTreeInput post_processor.time_steps_between_subdomain_output
+  _time_steps_subdomain_output =
+      database.get("time_steps_between_subdomain_output", 1u);
+  ASSERT_THROW((_time_steps_material_output > 0) &&
+                   (_time_steps_subdomain_output > 0),
+               "Error: The number of time steps between outputs must be "
+               "positive.");
 }
 
 template <int dim>
@@ -114,11 +245,13 @@ void PostProcessor<dim>::write_thermal_output(
     dealii::DoFHandler<dim> const &material_dof_handler)
 {
   ASSERT(_thermal_dof_handler != nullptr, "Internal Error");
-  _data_out.clear();
+  _data_out->clear();
   thermal_dataout(temperature);
-  material_dataout(state, dofs_map, material_dof_handler);
-  subdomain_dataout();
-  write_pvtu(time_step, time);
+  if (time_step % _time_steps_material_output == 0)
+    material_dataout(state, dofs_map, material_dof_handler);
+  if (time_step % _time_steps_subdomain_output == 0)
+    subdomain_dataout();
+  write_files(time_step, time);
 }
 
 template <int dim>
@@ -131,13 +264,15 @@ void PostProcessor<dim>::write_mechanical_output(
     dealii::DoFHandler<dim> const &material_dof_handler)
 {
   ASSERT(_mechanical_dof_handler != nullptr, "Internal Error");
-  _data_out.clear();
+  _data_out->clear();
   // We need the StrainPostProcessor to live until write_pvtu is done
   StrainPostProcessor<dim> strain;
   mechanical_dataout(displacement, strain);
-  material_dataout(state, dofs_map, material_dof_handler);
-  subdomain_dataout();
-  write_pvtu(time_step, time);
+  if (time_step % _time_steps_material_output == 0)
+    material_dataout(state, dofs_map, material_dof_handler);
+  if (time_step % _time_steps_subdomain_output == 0)
+    subdomain_dataout();
+  write_files(time_step, time);
 }
 
 template <int dim>
@@ -152,29 +287,49 @@ void PostProcessor<dim>::write_output(
 {
   ASSERT(_thermal_dof_handler != nullptr, "Internal Error");
   ASSERT(_mechanical_dof_handler != nullptr, "Internal Error");
-  _data_out.clear();
+  _data_out->clear();
   thermal_dataout(temperature);
   // We need the StrainPostProcessor to live until write_pvtu is done
   StrainPostProcessor<dim> strain;
   mechanical_dataout(displacement, strain);
-  material_dataout(state, dofs_map, material_dof_handler);
-  subdomain_dataout();
-  write_pvtu(time_step, time);
+  if (time_step % _time_steps_material_output == 0)
+    material_dataout(state, dofs_map, material_dof_handler);
+  if (time_step % _time_steps_subdomain_output == 0)
+    subdomain_dataout();
+  write_files(time_step, time);
 }
 
 template <int dim>
-void PostProcessor<dim>::write_pvd() const
+void PostProcessor<dim>::write_pvd()
 {
+  if (_hdf5_output)
+  {
+    _data_out->write_xdmf_file(_xdmf_entries, _filename_prefix + ".xdmf",
+                               _communicator);
+    return;
+  }
+
+  wait_for_output();
   std::ofstream output(_filename_prefix + ".pvd");
   dealii::DataOutBase::write_pvd_record(output, _times_filenames);
 }
 
+template <int dim>
+void PostProcessor<dim>::wait_for_output()
+{
+  if (_background_output.valid())
+  {
+    _background_output.get();
+    _background_data_out.reset();
+  }
+}
+
 template <int dim>
 void PostProcessor<dim>::thermal_dataout(
     dealii::LA::distributed::Vector<double> const &temperature)
 {
   temperature.update_ghost_values();
-  _data_out.add_data_vector(*_thermal_dof_handler, temperature, "temperature");
+  _data_out->add_data_vector(*_thermal_dof_handler, temperature, "temperature");
 }
 
 template <int dim>
@@ -189,12 +344,12 @@ void PostProcessor<dim>::mechanical_dataout(
       displacement_data_component_interpretation(
           dim,
           dealii::DataComponentInterpretation::component_is_part_of_vector);
-  _data_out.add_data_vector(*_mechanical_dof_handler, displacement,
+  _data_out->add_data_vector(*_mechanical_dof_handler, displacement,
                             displacement_names,
                             displacement_data_component_interpretation);
 
   // Add the strain tensor to the output
-  _data_out.add_data_vector(*_mechanical_dof_handler, displacement, strain);
+  _data_out->add_data_vector(*_mechanical_dof_handler, displacement, strain);
 
   // TODO add the stress tensor
 }
@@ -217,22 +372,27 @@ void PostProcessor<dim>::material_dataout(
       static_cast<unsigned int>(MaterialState::liquid);
   unsigned int constexpr solid_index =
       static_cast<unsigned int>(MaterialState::solid);
-  auto mp_cell = material_dof_handler.begin_active();
-  auto mp_end_cell = material_dof_handler.end();
-  std::vector<dealii::types::global_dof_index> mp_dof_indices(1);
-  for (unsigned int i = 0; mp_cell != mp_end_cell; ++i, ++mp_cell)
-    if (mp_cell->is_locally_owned())
-    {
-      mp_cell->get_dof_indices(mp_dof_indices);
-      dealii::types::global_dof_index const mp_dof_index =
-          dofs_map.at(mp_dof_indices[0]);
-      powder[i] = state(powder_index, mp_dof_index);
-      liquid[i] = state(liquid_index, mp_dof_index);
-      solid[i] = state(solid_index, mp_dof_index);
-    }
-  _data_out.add_data_vector(powder, "powder");
-  _data_out.add_data_vector(liquid, "liquid");
-  _data_out.add_data_vector(solid, "solid");
+  // The cells are gathered first so that the vectors can be filled by several
+  // threads.
+  std::vector<typename dealii::DoFHandler<dim>::active_cell_iterator> mp_cells;
+  for (auto const &mp_cell : dealii::filter_iterators(
+           material_dof_handler.active_cell_iterators(),
+           dealii::IteratorFilters::LocallyOwnedCell()))
+    mp_cells.push_back(mp_cell);
+  for_each(dealii::MemorySpace::Host{}, mp_cells.size(),
+           [&](unsigned int const c)
+           {
+             auto const &mp_cell = mp_cells[c];
+             dealii::types::global_dof_index const mp_dof_index =
+                 dofs_map.at(mp_cell->dof_index(0));
+             unsigned int const i = mp_cell->active_cell_index();
+             powder[i] = state(powder_index, mp_dof_index);
+             liquid[i] = state(liquid_index, mp_dof_index);
+             solid[i] = state(solid_index, mp_dof_index);
+           });
+  _data_out->add_data_vector(powder, "powder");
+  _data_out->add_data_vector(liquid, "liquid");
+  _data_out->add_data_vector(solid, "solid");
 }
 
 template <int dim>
@@ -247,7 +407,45 @@ void PostProcessor<dim>::subdomain_dataout()
   dealii::Vector<float> subdomain(n_active_cells);
   for (unsigned int i = 0; i < subdomain.size(); ++i)
     subdomain[i] = subdomain_id;
-  _data_out.add_data_vector(subdomain, "subdomain");
+  _data_out->add_data_vector(subdomain, "subdomain");
+}
+
+template <int dim>
+void PostProcessor<dim>::build_patches()
+{
+  if (_activated_cells_only || _use_output_box)
+  {
+    // The filter replaces the default selection of the locally owned active
+    // cells.
+    dealii::DoFHandler<dim> const *dof_handler =
+        (_thermal_dof_handler) ? _thermal_dof_handler : _mechanical_dof_handler;
+    using cell_iterator = typename dealii::Triangulation<dim>::cell_iterator;
+    _data_out->set_cell_selection(dealii::FilteredIterator<cell_iterator>(
+        [this, dof_handler](cell_iterator const &cell)
+        {
+          if (!cell->is_active() || !cell->is_locally_owned())
+            return false;
+          if (_activated_cells_only &&
+              (typename dealii::DoFHandler<dim>::cell_iterator(
+                   &cell->get_triangulation(), cell->level(), cell->index(),
+                   dof_handler)
+                   ->active_fe_index() != 0))
+            return false;
+          return !_use_output_box ||
+                 (cell->bounding_box().get_neighbor_type(_output_box) !=
+                  dealii::NeighborType::not_neighbors);
+        }));
+  }
+  _data_out->build_patches(_additional_output_refinement);
+}
+
+template <int dim>
+void PostProcessor<dim>::write_files(unsigned int time_step, double time)
+{
+  if (_hdf5_output)
+    write_hdf5(time_step, time);
+  else
+    write_pvtu(time_step, time);
 }
 
 template <int dim>
@@ -257,14 +455,13 @@ void PostProcessor<dim>::write_pvtu(unsigned int time_step, double time)
       (_thermal_dof_handler) ? _thermal_dof_handler : _mechanical_dof_handler;
   dealii::types::subdomain_id subdomain_id =
       dof_handler->get_triangulation().locally_owned_subdomain();
-  _data_out.build_patches(_additional_output_refinement);
+  build_patches();
   std::string local_filename = _filename_prefix + "." +
                                dealii::Utilities::to_string(time_step) + "." +
                                dealii::Utilities::to_string(subdomain_id);
-  std::ofstream output((local_filename + ".vtu").c_str());
   dealii::DataOutBase::VtkFlags flags(time);
-  _data_out.set_flags(flags);
-  _data_out.write_vtu(output);
+  flags.compression_level = _compression_level;
+  _data_out->set_flags(flags);
 
   unsigned int rank = dealii::Utilities::MPI::this_mpi_process(_communicator);
   if (rank == 0)
@@ -283,12 +480,78 @@ void PostProcessor<dim>::write_pvtu(unsigned int time_step, double time)
                                 dealii::Utilities::to_string(time_step) +
                                 ".pvtu";
     std::ofstream pvtu_output(pvtu_filename.c_str());
-    _data_out.write_pvtu_record(pvtu_output, filenames);
+    _data_out->write_pvtu_record(pvtu_output, filenames);
 
     // Associate the time to the time step.
     _times_filenames.push_back(
         std::pair<double, std::string>(time, pvtu_filename));
   }
+
+  if (_background_writing)
+  {
+    // The patches only depend on the data stored in the DataOut. The DataOut
+    // is handed to a background task, which compresses the patches and writes
+    // the file, and a new DataOut is used for the next output. Only one file
+    // is written in the background at a time.
+    wait_for_output();
+    _background_data_out = std::move(_data_out);
+    _data_out = std::make_unique<dealii::DataOut<dim>>();
+    _background_output = std::async(
+        std::launch::async,
+        [data_out = _background_data_out.get(),
+         filename = local_filename + ".vtu"]()
+        {
+          std::ofstream output(filename.c_str());
+          data_out->write_vtu(output);
+        });
+  }
+  else
+  {
+    std::ofstream output((local_filename + ".vtu").c_str());
+    _data_out->write_vtu(output);
+  }
+}
+
+template <int dim>
+void PostProcessor<dim>::write_hdf5(unsigned int time_step, double time)
+{
+  // All the processors write collectively to the same files. Thus, the files
+  // are not written in the background.
+  build_patches();
+  dealii::DataOutBase::DataOutFilter data_filter(
+      dealii::DataOutBase::DataOutFilterFlags(true, true));
+  _data_out->write_filtered_data(data_filter);
+
+  // Activating cells changes the mesh made of the activated cells.
+  if (_activated_cells_only)
+  {
+    dealii::DoFHandler<dim> const *dof_handler =
+        (_thermal_dof_handler) ? _thermal_dof_handler : _mechanical_dof_handler;
+    if (dof_handler->n_dofs() != _n_dofs)
+    {
+      _n_dofs = dof_handler->n_dofs();
+      _mesh_changed = true;
+    }
+  }
+  bool const write_mesh = _mesh_changed;
+  if (write_mesh)
+  {
+    _mesh_filename = _filename_prefix + ".mesh." +
+                     dealii::Utilities::to_string(time_step) + ".h5";
+    _mesh_changed = false;
+  }
+  std::string const solution_filename =
+      _filename_prefix + "." + dealii::Utilities::to_string(time_step) + ".h5";
+  _data_out->write_hdf5_parallel(data_filter, write_mesh, _mesh_filename,
+                                 solution_filename, _communicator);
+
+  // The xdmf file refers to the files using their names relative to the
+  // location of the xdmf file.
+  _xdmf_entries.push_back(_data_out->create_xdmf_entry(
+      data_filter,
+      std::filesystem::path(_mesh_filename).filename().string(),
+      std::filesystem::path(solution_filename).filename().string(), time,
+      _communicator));
 }
 } // namespace adamantine
 
@@ -11,13 +11,17 @@
 #include <MaterialProperty.hh>
 #include <types.hh>
 
+#include <deal.II/base/bounding_box.h>
 #include <deal.II/base/types.h>
 #include <deal.II/dofs/dof_handler.h>
 #include <deal.II/lac/la_parallel_vector.h>
 #include <deal.II/numerics/data_out.h>
 
 #include <boost/property_tree/ptree.hpp>
+#include <boost/signals2/connection.hpp>
 
+#include <future>
+#include <memory>
 #include <unordered_map>
 
 namespace adamantine
@@ -37,7 +41,8 @@ public:
 };
 
 /**
- * This class outputs the results using the vtu format.
+ * This class outputs the results using the vtu format or, if deal.II has been
+ * configured with HDF5, using the hdf5 and xdmf formats.
  */
 template <int dim>
 class PostProcessor
@@ -96,11 +101,33 @@ public:
                     dealii::DoFHandler<dim> const &material_dof_handler);
 
   /**
-   * Write the pvd file for Paraview.
+   * Destructor. Wait for the vtu file being written in the background.
    */
-  void write_pvd() const;
+  ~PostProcessor();
+
+  /**
+   * Write the pvd file, or the xdmf file if the output format is hdf5, for
+   * Paraview. Wait for the vtu file being written in the background.
+   */
+  void write_pvd();
+
+  /**
+   * Wait for the vtu file being written in the background. Do nothing if
+   * there is no file being written.
+   */
+  void wait_for_output();
 
 private:
+  /**
+   * Read the output format in @p database and, for the hdf5 format, start
+   * tracking the changes of the mesh.
+   */
+  void initialize_output_format(boost::property_tree::ptree const &database);
+  /**
+   * Read the options that reduce the size of the output in @p database.
+   */
+  void
+  initialize_output_reduction(boost::property_tree::ptree const &database);
   /**
    * Fill _data_out with thermal data.
    */
@@ -124,10 +151,23 @@ private:
    * Fill _data_out with subdomain data.
    */
   void subdomain_dataout();
+  /**
+   * Build the patches of the selected cells.
+   */
+  void build_patches();
+  /**
+   * Write the files of the current time step using the output format.
+   */
+  void write_files(unsigned int time_step, double time);
   /**
    * Write pvtu file.
    */
   void write_pvtu(unsigned int time_step, double time);
+  /**
+   * Write the hdf5 file of the solution and, if the mesh has changed since the
+   * last output, the hdf5 file of the mesh.
+   */
+  void write_hdf5(unsigned int time_step, double time);
 
   /**
    * MPI communicator.
@@ -152,7 +192,42 @@ private:
   /**
    * DataOut associated with the post-processing.
    */
-  dealii::DataOut<dim> _data_out;
+  std::unique_ptr<dealii::DataOut<dim>> _data_out;
+  /**
+   * Flag is true if the vtu files are written on a background thread.
+   */
+  bool _background_writing;
+  /**
+   * DataOut whose patches are being written in the background. The
+   * compression and the file system operations can then overlap with the
+   * next time steps.
+   */
+  std::unique_ptr<dealii::DataOut<dim>> _background_data_out;
+  /**
+   * Result of the task writing the vtu file in the background.
+   */
+  std::future<void> _background_output;
+  /**
+   * Flag is true if the output uses the hdf5 and xdmf formats.
+   */
+  bool _hdf5_output;
+  /**
+   * Flag is true if the mesh has changed since the last hdf5 output.
+   */
+  bool _mesh_changed = true;
+  /**
+   * Connection to the signal of the triangulation that is triggered when the
+   * mesh changes.
+   */
+  boost::signals2::connection _mesh_changed_connection;
+  /**
+   * Name of the last hdf5 file of the mesh.
+   */
+  std::string _mesh_filename;
+  /**
+   * Entries of the xdmf file, one per time step.
+   */
+  std::vector<dealii::XDMFEntry> _xdmf_entries;
   /**
    * DoFHandler associated with the thermal simulation.
    */
@@ -165,6 +240,39 @@ private:
    * Additional levels of refinement for the output.
    */
   unsigned int _additional_output_refinement;
+  /**
+   * Flag is true if only the activated cells are written.
+   */
+  bool _activated_cells_only;
+  /**
+   * Flag is true if only the cells that intersect _output_box are written.
+   */
+  bool _use_output_box;
+  /**
+   * Region of interest of the output.
+   */
+  dealii::BoundingBox<dim> _output_box;
+  /**
+   * Number of dofs at the last hdf5 output. When cells are activated, the
+   * number of dofs changes and so does the mesh of the activated cells.
+   */
+  dealii::types::global_dof_index _n_dofs = 0;
+  /**
+   * Compression level of the vtu files.
+   */
+#if DEAL_II_VERSION_GTE(9, 5, 0)
+  dealii::DataOutBase::CompressionLevel _compression_level;
+#else
+  dealii::DataOutBase::VtkFlags::ZlibCompressionLevel _compression_level;
+#endif
+  /**
+   * Number of time steps between the outputs of the material state.
+   */
+  unsigned int _time_steps_material_output;
+  /**
+   * Number of time steps between the outputs of the subdomain ids.
+   */
+  unsigned int _time_steps_subdomain_output;
 };
 } // namespace adamantine
 #endif
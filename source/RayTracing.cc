@@ -8,13 +8,14 @@
 #include <RayTracing.hh>
 #include <utils.hh>
 
-#include <deal.II/arborx/distributed_tree.h>
 #include <deal.II/grid/filtered_iterator.h>
 
+#include <boost/algorithm/string/predicate.hpp>
+
 #include <Kokkos_HostSpace.hpp>
 
 #include <fstream>
-#include <regex>
+#include <tuple>
 
 #include <ArborX_Ray.hpp>
 
@@ -78,39 +79,20 @@ struct AccessTraits<adamantine::RayNearestPredicate, PredicatesTag>
 
 namespace adamantine
 {
-RayTracing::RayTracing(boost::property_tree::ptree const &experiment_database,
-                       dealii::DoFHandler<3> const &dof_handler)
-    : _dof_handler(dof_handler)
+namespace
 {
-
-  // Format of the file names: the format is pretty arbitrary, #frame and
-  // #camera are replaced by the frame and the camera number.
-  // PropertyTreeInput experiment.file
-  _data_filename = experiment_database.get<std::string>("file");
-  // PropertyTreeInput experiment.first_frame
-  _next_frame = experiment_database.get("first_frame", 0);
-  // PropertyTreeInput experiment.first_camera_id
-  _first_camera_id = experiment_database.get<unsigned int>("first_camera_id");
-  // PropertyTreeInput experiment.last_camera_id
-  _last_camera_id = experiment_database.get<int>("last_camera_id");
-}
-
-unsigned int RayTracing::read_next_frame()
+/**
+ * Read and parse the csv files of a frame. Return the rays and their associated
+ * values.
+ */
+std::pair<std::vector<Ray<3>>, std::vector<double>>
+read_csv_frame(std::vector<std::string> const &filenames)
 {
-  _rays_current_frame.clear();
-  _values_current_frame.clear();
-  for (unsigned int camera_id = _first_camera_id;
-       camera_id < _last_camera_id + 1; ++camera_id)
+  int constexpr dim = RayTracing::dim;
+  std::vector<Ray<dim>> rays;
+  std::vector<double> values;
+  for (auto const &filename : filenames)
   {
-    // Use regex to get the next file to read
-    std::regex camera_regex("#camera");
-    std::regex frame_regex("#frame");
-    auto filename =
-        std::regex_replace((std::regex_replace(_data_filename, camera_regex,
-                                               std::to_string(camera_id))),
-                           frame_regex, std::to_string(_next_frame));
-    wait_for_file(filename, "Waiting for the next frame: " + filename);
-
     // Read and parse the file
     std::ifstream file;
     file.open(filename);
@@ -160,44 +142,183 @@ unsigned int RayTracing::read_next_frame()
       }
 
       Ray<dim> ray{point, direction};
-      _rays_current_frame.push_back(ray);
-      _values_current_frame.push_back(value);
+      rays.push_back(ray);
+      values.push_back(value);
     }
   }
 
-  return _next_frame++;
+  return {rays, values};
 }
 
-PointsValues<3> RayTracing::get_points_values()
+/**
+ * Read the binary files of a frame. Return the rays and their associated
+ * values.
+ */
+std::pair<std::vector<Ray<3>>, std::vector<double>>
+read_binary_frame(std::vector<std::string> const &filenames)
 {
-  PointsValues<dim> points_values;
+  int constexpr dim = RayTracing::dim;
+  std::vector<Ray<dim>> rays;
+  std::vector<double> values;
+  for (auto const &filename : filenames)
+  {
+    // The columns are the coordinates of the two points defining the ray
+    // followed by the value.
+    auto const columns = read_binary_frame_file(filename, 2 * dim + 1);
+    std::size_t const n_rays = columns[2 * dim].size();
+    std::size_t const offset = rays.size();
+    rays.resize(offset + n_rays);
+    for (std::size_t i = 0; i < n_rays; ++i)
+    {
+      for (int d = 0; d < dim; ++d)
+      {
+        rays[offset + i].origin[d] = columns[d][i];
+        rays[offset + i].direction[d] = columns[dim + d][i] - columns[d][i];
+      }
+    }
+    values.insert(values.end(), columns[2 * dim].begin(),
+                  columns[2 * dim].end());
+  }
+
+  return {rays, values};
+}
+} // namespace
 
-  // Perform the ray tracing to get the cells that are intersected by rays
+RayTracing::RayTracing(boost::property_tree::ptree const &experiment_database,
+                       dealii::DoFHandler<3> const &dof_handler)
+    : _dof_handler(dof_handler)
+{
 
-  // Create the bounding boxes associated to the locally owned cells with FE
-  // index = 0
+  // Format of the file names: the format is pretty arbitrary, #frame and
+  // #camera are replaced by the frame and the camera number.
+  // PropertyTreeInput experiment.file
+  std::string data_filename = experiment_database.get<std::string>("file");
+  // PropertyTreeInput experiment.first_frame
+  _next_frame = experiment_database.get("first_frame", 0);
+  // PropertyTreeInput experiment.first_camera_id
+  unsigned int first_camera_id =
+      experiment_database.get<unsigned int>("first_camera_id");
+  // PropertyTreeInput experiment.last_camera_id
+  unsigned int last_camera_id =
+      experiment_database.get<unsigned int>("last_camera_id");
+  _camera_filenames =
+      get_camera_filenames(data_filename, first_camera_id, last_camera_id);
+
+  // PropertyTreeInput experiment.file_format
+  std::string file_format =
+      experiment_database.get<std::string>("file_format", "csv");
+  if (boost::iequals(file_format, "binary"))
+    _read_frame = read_binary_frame;
+  else
+    _read_frame = read_csv_frame;
+
+  // PropertyTreeInput experiment.prefetch_frames
+  unsigned int prefetch_frames = experiment_database.get("prefetch_frames", 0u);
+  if (prefetch_frames > 0)
+  {
+    // PropertyTreeInput experiment.last_frame
+    unsigned int last_frame =
+        experiment_database.get<unsigned int>("last_frame");
+    // The functions are executed by the helper thread and they do not capture
+    // this because the object can be moved.
+    _prefetcher = std::make_unique<FramePrefetcher<
+        std::pair<std::vector<Ray<dim>>, std::vector<double>>>>(
+        [camera_filenames = _camera_filenames](unsigned int frame)
+        { return get_frame_filenames(camera_filenames, frame); },
+        _read_frame, _next_frame, last_frame, prefetch_frames);
+  }
+}
+
+unsigned int RayTracing::read_next_frame()
+{
+  if (_prefetcher)
+  {
+    std::tie(_rays_current_frame, _values_current_frame) = _prefetcher->next();
+  }
+  else
+  {
+    auto filenames = get_frame_filenames(_camera_filenames, _next_frame);
+    for (auto const &filename : filenames)
+      wait_for_file(filename, "Waiting for the next frame: " + filename);
+    std::tie(_rays_current_frame, _values_current_frame) =
+        _read_frame(filenames);
+  }
+
+  return _next_frame++;
+}
+
+void RayTracing::mesh_changed() { _search_tree_is_up_to_date = false; }
+
+void RayTracing::build_search_tree()
+{
+  // A ray coming from outside of the part enters it through a cell that is on
+  // the surface. Thus, only the locally owned cells with FE index = 0 that are
+  // on the boundary of the domain or that are next to a cell with FE index = 1
+  // need to be added to the tree.
   std::vector<dealii::BoundingBox<dim>> bounding_boxes;
-  std::vector<typename dealii::DoFHandler<dim>::active_cell_iterator>
-      cell_iterators;
+  _surface_cells.clear();
   for (auto const &cell : dealii::filter_iterators(
            _dof_handler.active_cell_iterators(),
            dealii::IteratorFilters::LocallyOwnedCell(),
            dealii::IteratorFilters::ActiveFEIndexEqualTo(0)))
   {
-    bounding_boxes.push_back(cell->bounding_box());
-    cell_iterators.push_back(cell);
+    bool on_surface = false;
+    for (auto const f : cell->face_indices())
+    {
+      if (cell->at_boundary(f))
+      {
+        on_surface = true;
+      }
+      else if (cell->face(f)->has_children())
+      {
+        for (unsigned int sf = 0; sf < cell->face(f)->n_children(); ++sf)
+        {
+          if (cell->neighbor_child_on_subface(f, sf)->active_fe_index() != 0)
+          {
+            on_surface = true;
+            break;
+          }
+        }
+      }
+      else if (cell->neighbor(f)->active_fe_index() != 0)
+      {
+        on_surface = true;
+      }
+
+      if (on_surface)
+        break;
+    }
+
+    if (on_surface)
+    {
+      bounding_boxes.push_back(cell->bounding_box());
+      _surface_cells.push_back(cell);
+    }
   }
 
-  // Use ArborX to find where the rays intersect the activated cells. All the
-  // processors have access to all the rays but we still need to use
+  // All the processors have access to all the rays but we still need to use
   // DistributedTree because some rays can be stopped by activated cells on a
-  // different processors. Since the rays are on all the processors, we don't
-  // need to communicate the results to other processors.
+  // different processors.
+  _search_tree = std::make_unique<dealii::ArborXWrappers::DistributedTree>(
+      _dof_handler.get_communicator(), bounding_boxes);
+  _search_tree_is_up_to_date = true;
+}
+
+PointsValues<3> RayTracing::get_points_values()
+{
+  PointsValues<dim> points_values;
+
+  // Perform the ray tracing to get the cells that are intersected by rays. The
+  // search tree is only rebuilt if the mesh has changed since the last frame.
+  if (!_search_tree_is_up_to_date)
+    build_search_tree();
+
+  // Use ArborX to find where the rays intersect the activated cells. Since the
+  // rays are on all the processors, we don't need to communicate the results
+  // to other processors.
   auto communicator = _dof_handler.get_communicator();
-  dealii::ArborXWrappers::DistributedTree distributed_tree(communicator,
-                                                           bounding_boxes);
   RayNearestPredicate ray_nearest(_rays_current_frame);
-  auto [indices_ranks, offset] = distributed_tree.query(ray_nearest);
+  auto [indices_ranks, offset] = _search_tree->query(ray_nearest);
 
   // Find the exact intersections points
   // See https://en.wikipedia.org/wiki/Line%E2%80%93plane_intersection
@@ -233,7 +354,7 @@ PointsValues<3> RayTracing::get_points_values()
       {
         double distance = std::numeric_limits<double>::max();
         dealii::Point<dim> intersection;
-        auto const &cell = cell_iterators[indices_ranks[j].first];
+        auto const &cell = _surface_cells[indices_ranks[j].first];
         // We know that the ray intersects the bounding box but we don't know
         // where it intersects the cells. We need to check the intersection of
         // the ray with each face of the cell.
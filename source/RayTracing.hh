@@ -9,9 +9,14 @@
 #define RAY_TRACING_HH
 
 #include <ExperimentalData.hh>
+#include <FramePrefetcher.hh>
 
+#include <deal.II/arborx/distributed_tree.h>
 #include <deal.II/dofs/dof_handler.h>
 
+#include <functional>
+#include <memory>
+
 namespace adamantine
 {
 /**
@@ -48,23 +53,35 @@ public:
 
   PointsValues<dim> get_points_values() override;
 
+  void mesh_changed() override;
+
 private:
+  /**
+   * Build the search tree of the activated cells on the surface of the part.
+   */
+  void build_search_tree();
+
   /**
    * Next frame that should be read.
    */
   unsigned int _next_frame;
   /**
-   * ID of the first camera.
+   * File names of the frames of each camera.
    */
-  unsigned int _first_camera_id;
+  std::vector<std::string> _camera_filenames;
   /**
-   * ID of the last camera.
+   * Function that reads the files of a frame.
    */
-  unsigned int _last_camera_id;
+  std::function<std::pair<std::vector<Ray<dim>>, std::vector<double>>(
+      std::vector<std::string> const &)>
+      _read_frame;
   /**
-   * Generic file name of the frames.
+   * Reader of the upcoming frames. The pointer is null if the frames are read
+   * when they are needed.
    */
-  std::string _data_filename;
+  std::unique_ptr<
+      FramePrefetcher<std::pair<std::vector<Ray<dim>>, std::vector<double>>>>
+      _prefetcher;
   /**
    * DoFHandler of the mesh we want to perform the ray tracing on.
    */
@@ -77,6 +94,21 @@ private:
    * Values associated to the rays of the current frame.
    */
   std::vector<double> _values_current_frame;
+  /**
+   * Flag set to true when the search tree matches the current mesh.
+   */
+  bool _search_tree_is_up_to_date = false;
+  /**
+   * Locally owned activated cells on the surface of the part. The order of the
+   * cells is the order of the bounding boxes in the search tree.
+   */
+  std::vector<typename dealii::DoFHandler<dim>::active_cell_iterator>
+      _surface_cells;
+  /**
+   * Search tree of the bounding boxes of the activated cells on the surface of
+   * the part on all the processors.
+   */
+  std::unique_ptr<dealii::ArborXWrappers::DistributedTree> _search_tree;
 };
 
 } // namespace adamantine
@@ -8,10 +8,65 @@
 #include <ScanPath.hh>
 #include <utils.hh>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <iterator>
 
 namespace adamantine
 {
+namespace
+{
+/**
+ * Header of the binary scan path files.
+ */
+char constexpr binary_magic[8] = {'a', 'd', 'a', 'm', 's', 'c', 'a', 'n'};
+/**
+ * Size of the header of the binary scan path files: the magic string followed
+ * by the number of segments.
+ */
+std::size_t constexpr binary_header_size =
+    sizeof(binary_magic) + sizeof(std::uint64_t);
+/**
+ * Number of doubles stored for each segment in the binary scan path files: the
+ * end time, the power modifier, and the three coordinates of the end point.
+ */
+unsigned int constexpr binary_segment_size = 5;
+
+/**
+ * Parse the numbers of @p line separated by spaces, tabs, or commas and store
+ * them in @p values. Return the number of values read. This avoids splitting
+ * the line into strings and converting each of them.
+ */
+template <std::size_t N>
+unsigned int parse_line(std::string const &line, std::array<double, N> &values)
+{
+  char const *begin = line.c_str();
+  unsigned int n_values = 0;
+  while (n_values < N)
+  {
+    while ((*begin == ' ') || (*begin == '\t') || (*begin == ','))
+      ++begin;
+    char *end = nullptr;
+    values[n_values] = std::strtod(begin, &end);
+    if (end == begin)
+      break;
+    ++n_values;
+    begin = end;
+  }
+
+  return n_values;
+}
+} // namespace
+
 ScanPath::ScanPath(std::string scan_path_file, std::string file_format)
 {
   // Parse the scan path
@@ -26,6 +81,10 @@ ScanPath::ScanPath(std::string scan_path_file, std::string file_format)
   {
     load_event_series_scan_path(scan_path_file);
   }
+  else if (file_format == "binary")
+  {
+    load_binary_scan_path(scan_path_file);
+  }
   else
   {
     ASSERT_THROW(false, "Error: Format of scan path file not recognized.");
@@ -47,23 +106,24 @@ void ScanPath::load_segment_scan_path(std::string scan_path_file)
   getline(file, line);
   // Read file as long as there are lines to read or we reached the number of
   // segments to read, whichever comes first
+  std::array<double, 6> values;
   while ((data_index < n_segments) && (getline(file, line)))
   {
-    std::vector<std::string> split_line;
-    boost::split(split_line, line, boost::is_any_of(" "),
-                 boost::token_compress_on);
+    ASSERT_THROW(parse_line(line, values) == values.size(),
+                 "Error: Line " + std::to_string(data_index + 4) +
+                     " of the scan path file is not valid.");
     ScanPathSegment segment;
 
     // Set the segment type
     ScanPathSegmentType segment_type = ScanPathSegmentType::line;
-    if (split_line[0] == "0")
+    if (values[0] == 0.)
     {
       // Check to make sure the segment isn't the first, if it is, throw an
       // exception (the first segment must be a point in the spec).
       ASSERT_THROW(_segment_list.size() > 0,
                    "Error: Scan paths must begin with a 'point' segment.");
     }
-    else if (split_line[0] == "1")
+    else if (values[0] == 1.)
     {
       segment_type = ScanPathSegmentType::point;
     }
@@ -74,29 +134,28 @@ void ScanPath::load_segment_scan_path(std::string scan_path_file)
     }
 
     // Set the segment end position
-    segment.end_point(0) = std::stod(split_line[1]);
-    segment.end_point(1) = std::stod(split_line[2]);
-    segment.end_point(2) = std::stod(split_line[3]);
+    segment.end_point(0) = values[1];
+    segment.end_point(1) = values[2];
+    segment.end_point(2) = values[3];
 
     // Set the power modifier
-    segment.power_modifier = std::stod(split_line[4]);
+    segment.power_modifier = values[4];
 
     // Set the velocity and end time
     if (segment_type == ScanPathSegmentType::point)
     {
       if (_segment_list.size() > 0)
       {
-        segment.end_time =
-            _segment_list.back().end_time + std::stod(split_line[5]);
+        segment.end_time = _segment_list.back().end_time + values[5];
       }
       else
       {
-        segment.end_time = std::stod(split_line[5]);
+        segment.end_time = values[5];
       }
     }
     else
     {
-      double velocity = std::stod(split_line[5]);
+      double velocity = values[5];
       double line_length =
           segment.end_point.distance(_segment_list.back().end_point);
       segment.end_time =
@@ -115,41 +174,130 @@ void ScanPath::load_event_series_scan_path(std::string scan_path_file)
   std::string line;
 
   double last_power = 0.0;
+  std::array<double, 5> values;
   while (getline(file, line))
   {
+    // Skip empty lines
+    unsigned int const n_values = parse_line(line, values);
+    if (n_values == 0)
+      continue;
+    ASSERT_THROW(n_values == values.size(),
+                 "Error: Line " + std::to_string(_segment_list.size() + 1) +
+                     " of the scan path file is not valid.");
+
     // For an event series the first segment is a ScanPathSegment point, then
     // the rest are ScanPathSegment lines
     ScanPathSegment segment;
 
-    std::vector<std::string> split_line;
-    boost::split(split_line, line, boost::is_any_of(" ,,"),
-                 boost::token_compress_on);
-
     // Set the segment end time
-    segment.end_time = std::stod(split_line[0]);
+    segment.end_time = values[0];
 
     // Set the segment end position
-    segment.end_point(0) = std::stod(split_line[1]);
-    segment.end_point(1) = std::stod(split_line[2]);
-    segment.end_point(2) = std::stod(split_line[3]);
+    segment.end_point(0) = values[1];
+    segment.end_point(1) = values[2];
+    segment.end_point(2) = values[3];
 
     // Set the power modifier
     segment.power_modifier = last_power;
-    last_power = std::stod(split_line[4]);
+    last_power = values[4];
 
     _segment_list.push_back(segment);
   }
 }
 
+void ScanPath::load_binary_scan_path(std::string scan_path_file)
+{
+  // Map the file in memory instead of reading it. The pages are shared by all
+  // the processes on a node that load the same file.
+  int const fd = open(scan_path_file.c_str(), O_RDONLY);
+  ASSERT_THROW(fd != -1, "Error: Cannot open " + scan_path_file + ".");
+  struct stat file_stat;
+  bool const valid_stat = fstat(fd, &file_stat) == 0;
+  std::size_t const file_size = valid_stat ? file_stat.st_size : 0;
+  void *data = file_size > 0
+                   ? mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0)
+                   : MAP_FAILED;
+  close(fd);
+  ASSERT_THROW(data != MAP_FAILED, "Error: Cannot map " + scan_path_file + ".");
+
+  char const *bytes = static_cast<char const *>(data);
+  std::uint64_t n_segments = 0;
+  bool valid_file =
+      (file_size >= binary_header_size) &&
+      (std::memcmp(bytes, binary_magic, sizeof(binary_magic)) == 0);
+  if (valid_file)
+  {
+    std::memcpy(&n_segments, bytes + sizeof(binary_magic), sizeof(n_segments));
+    std::size_t const expected_size =
+        binary_header_size + n_segments * binary_segment_size * sizeof(double);
+    valid_file = file_size == expected_size;
+  }
+
+  if (valid_file)
+  {
+    _segment_list.resize(n_segments);
+    std::array<double, binary_segment_size> values;
+    char const *segment_bytes = bytes + binary_header_size;
+    for (auto &segment : _segment_list)
+    {
+      std::memcpy(values.data(), segment_bytes, sizeof(values));
+      segment_bytes += sizeof(values);
+      segment.end_time = values[0];
+      segment.power_modifier = values[1];
+      for (unsigned int d = 0; d < 3; ++d)
+        segment.end_point[d] = values[2 + d];
+    }
+  }
+  munmap(data, file_size);
+
+  ASSERT_THROW(valid_file, "Error: " + scan_path_file +
+                              " is not a valid binary scan path.");
+}
+
+void ScanPath::write_binary_scan_path(std::string scan_path_file) const
+{
+  std::ofstream file(scan_path_file, std::ios::binary);
+  ASSERT_THROW(file.good(), "Error: Cannot open " + scan_path_file + ".");
+  file.write(binary_magic, sizeof(binary_magic));
+  std::uint64_t const n_segments = _segment_list.size();
+  file.write(reinterpret_cast<char const *>(&n_segments), sizeof(n_segments));
+  for (auto const &segment : _segment_list)
+  {
+    std::array<double, binary_segment_size> const values = {
+        {segment.end_time, segment.power_modifier, segment.end_point[0],
+         segment.end_point[1], segment.end_point[2]}};
+    file.write(reinterpret_cast<char const *>(values.data()), sizeof(values));
+  }
+}
+
 void ScanPath::update_current_segment_info(
     double time, dealii::Point<3> &segment_start_point,
     double &segment_start_time) const
 {
+  // The current segment is the first segment whose end time is not before
+  // time.
+  auto const is_current_segment = [&](unsigned int const segment)
+  {
+    return (segment < _segment_list.size()) &&
+           (time <= _segment_list[segment].end_time) &&
+           ((segment == 0) || (time > _segment_list[segment - 1].end_time));
+  };
+
   // Get to the correct segment
-  _current_segment = 0;
-  while (time > _segment_list[_current_segment].end_time)
+  if (!is_current_segment(_current_segment))
   {
-    ++_current_segment;
+    if (is_current_segment(_current_segment + 1))
+    {
+      ++_current_segment;
+    }
+    else
+    {
+      auto const segment_it = std::lower_bound(
+          _segment_list.begin(), _segment_list.end(), time,
+          [](ScanPathSegment const &segment, double const t)
+          { return segment.end_time < t; });
+      _current_segment = std::distance(_segment_list.begin(), segment_it);
+    }
   }
   // Update the start position and time for the current segment
   if (_current_segment > 0)
@@ -206,7 +354,36 @@ double ScanPath::get_power_modifier(double const &time) const
   return _segment_list[_current_segment].power_modifier;
 }
 
-std::vector<ScanPathSegment> ScanPath::get_segment_list() const
+double ScanPath::get_average_power_modifier(double const start_time,
+                                            double const end_time) const
+{
+  if (!(end_time > start_time))
+    return get_power_modifier(start_time);
+
+  // The power modifier is constant on each segment. Only the segments that
+  // overlap the interval contribute.
+  auto segment_it = std::lower_bound(
+      _segment_list.begin(), _segment_list.end(), start_time,
+      [](ScanPathSegment const &segment, double const t)
+      { return segment.end_time < t; });
+  double energy = 0.;
+  for (; segment_it != _segment_list.end(); ++segment_it)
+  {
+    double const segment_start_time = segment_it == _segment_list.begin()
+                                          ? 0.
+                                          : std::prev(segment_it)->end_time;
+    if (segment_start_time >= end_time)
+      break;
+    double const overlap = std::min(end_time, segment_it->end_time) -
+                           std::max(start_time, segment_start_time);
+    if (overlap > 0.)
+      energy += overlap * segment_it->power_modifier;
+  }
+
+  return energy / (end_time - start_time);
+}
+
+std::vector<ScanPathSegment> const &ScanPath::get_segment_list() const
 {
   return _segment_list;
 }
@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2021, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -85,10 +85,24 @@ public:
    */
   double get_power_modifier(double const &time) const;
 
+  /**
+   * Returns the power coefficient averaged over the interval [@p start_time,
+   * @p end_time]. The power is zero after the end of the scan path.
+   */
+  double get_average_power_modifier(double const start_time,
+                                    double const end_time) const;
+
   /**
    * Returns the scan path's list of segments
    */
-  std::vector<ScanPathSegment> get_segment_list() const;
+  std::vector<ScanPathSegment> const &get_segment_list() const;
+
+  /**
+   * Write the scan path in the "binary" format. This is used to convert text
+   * scan path files to the binary format. The file uses the endianness of the
+   * machine.
+   */
+  void write_binary_scan_path(std::string scan_path_file) const;
 
 private:
   /**
@@ -97,7 +111,8 @@ private:
   std::vector<ScanPathSegment> _segment_list;
 
   /**
-   * The index of the current segment in the scan path.
+   * The index of the current segment in the scan path. It is used as a cursor
+   * for the next lookup since the time usually increases monotonically.
    */
   mutable unsigned int _current_segment = 0;
 
@@ -111,8 +126,15 @@ private:
    */
   void load_event_series_scan_path(std::string scan_path_file);
 
+  /**
+   * Method to load a "binary" scan path file
+   */
+  void load_binary_scan_path(std::string scan_path_file);
+
   /**
    * Method to determine the current segment, its start point, and start time.
+   * The cached segment and the following one are checked first. Otherwise, the
+   * segment is found using a binary search on the end times.
    */
   void update_current_segment_info(double time,
                                    dealii::Point<3> &segment_start_point,
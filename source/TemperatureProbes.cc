@@ -0,0 +1,183 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <TemperatureProbes.hh>
+#include <instantiation.hh>
+#include <utils.hh>
+
+#include <deal.II/arborx/bvh.h>
+#include <deal.II/base/mpi.h>
+#include <deal.II/fe/mapping_q1.h>
+#include <deal.II/grid/filtered_iterator.h>
+#include <deal.II/matrix_free/fe_point_evaluation.h>
+
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+
+namespace adamantine
+{
+template <int dim>
+TemperatureProbes<dim>::TemperatureProbes(
+    MPI_Comm const &communicator, boost::property_tree::ptree const &database)
+    : _communicator(communicator)
+{
+  // The points are separated by semicolons and the coordinates by commas.
+  // PropertyTreeInput post_processor.probes
+  std::string probes = database.get<std::string>("probes");
+  probes.erase(std::remove_if(probes.begin(), probes.end(),
+                              [](unsigned char x) { return std::isspace(x); }),
+               probes.end());
+  std::vector<std::string> parsed_points;
+  boost::split(parsed_points, probes, [](char c) { return c == ';'; });
+  for (auto const &parsed_point : parsed_points)
+  {
+    std::vector<std::string> coordinates;
+    boost::split(coordinates, parsed_point, [](char c) { return c == ','; });
+    ASSERT_THROW(coordinates.size() == dim,
+                 "Error: The probe " + parsed_point + " does not have " +
+                     std::to_string(dim) + " coordinates.");
+    dealii::Point<dim> point;
+    for (int d = 0; d < dim; ++d)
+      point[d] = std::stod(coordinates[d]);
+    _points.push_back(point);
+  }
+
+  if (dealii::Utilities::MPI::this_mpi_process(_communicator) == 0)
+  {
+    // PropertyTreeInput post_processor.filename_prefix
+    std::string const filename =
+        database.get<std::string>("filename_prefix") + ".probes.csv";
+    _file.open(filename);
+    ASSERT_THROW(_file.good(), "Error: Cannot open the file " + filename + ".");
+    _file << "time";
+    for (unsigned int i = 0; i < _points.size(); ++i)
+      _file << ",probe_" << i;
+    _file << "\n";
+  }
+}
+
+template <int dim>
+void TemperatureProbes<dim>::write_values(
+    double time, dealii::DoFHandler<dim> const &dof_handler,
+    dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> const
+        &temperature)
+{
+  if (temperature.get_partitioner() != _partitioner)
+  {
+    _partitioner = temperature.get_partitioner();
+    locate_points(dof_handler);
+  }
+
+  // The ghost exchange is collective, so it is done on every processor even
+  // when no point is found on it.
+  temperature.update_ghost_values();
+
+  // The points that are not found on this processor keep the lowest value so
+  // that the values can be reduced using a maximum. A point on the boundary
+  // between two processors gets the same value on both of them.
+  std::vector<double> local_values(_points.size(),
+                                   std::numeric_limits<double>::lowest());
+  if (_local_points.size() > 0)
+  {
+    dealii::FiniteElement<dim> const &fe = dof_handler.get_fe(0);
+    dealii::FEPointEvaluation<1, dim> evaluator(
+        dealii::StaticMappingQ1<dim>::mapping, fe, dealii::update_values);
+    std::vector<double> cell_values(fe.n_dofs_per_cell());
+    for (unsigned int i = 0; i < _local_points.size(); ++i)
+    {
+      _cells[i]->get_dof_values(temperature, cell_values.begin(),
+                                cell_values.end());
+      evaluator.reinit(_cells[i],
+                       dealii::ArrayView<dealii::Point<dim> const>(
+                           &_unit_points[i], 1));
+      evaluator.evaluate(dealii::make_array_view(cell_values),
+                         dealii::EvaluationFlags::values);
+      local_values[_local_points[i]] = evaluator.get_value(0);
+    }
+  }
+
+  _values.resize(_points.size());
+  MPI_Reduce(local_values.data(), _values.data(), _points.size(), MPI_DOUBLE,
+             MPI_MAX, 0, _communicator);
+
+  if (dealii::Utilities::MPI::this_mpi_process(_communicator) == 0)
+  {
+    for (auto &value : _values)
+    {
+      if (value == std::numeric_limits<double>::lowest())
+        value = std::numeric_limits<double>::quiet_NaN();
+    }
+
+    _file << time;
+    for (auto const value : _values)
+      _file << "," << value;
+    _file << "\n";
+  }
+}
+
+template <int dim>
+void TemperatureProbes<dim>::locate_points(
+    dealii::DoFHandler<dim> const &dof_handler)
+{
+  _local_points.clear();
+  _cells.clear();
+  _unit_points.clear();
+
+  // Search the points in the bounding boxes of the locally owned activated
+  // cells. All the processors know all the points so the search is local.
+  std::vector<dealii::BoundingBox<dim>> bounding_boxes;
+  std::vector<typename dealii::DoFHandler<dim>::active_cell_iterator>
+      cell_iterators;
+  for (auto const &cell : dealii::filter_iterators(
+           dof_handler.active_cell_iterators(),
+           dealii::IteratorFilters::LocallyOwnedCell(),
+           dealii::IteratorFilters::ActiveFEIndexEqualTo(0)))
+  {
+    bounding_boxes.push_back(cell->bounding_box());
+    cell_iterators.push_back(cell);
+  }
+  if (bounding_boxes.size() == 0)
+    return;
+
+  dealii::ArborXWrappers::BVH bvh(bounding_boxes);
+  dealii::ArborXWrappers::PointIntersectPredicate point_intersect(_points);
+  auto [indices, offset] = bvh.query(point_intersect);
+
+  // The bounding box of a cell can be larger than the cell. The point is
+  // assigned to the first cell that contains it.
+  auto const &mapping = dealii::StaticMappingQ1<dim>::mapping;
+  double constexpr tol = 1e-10;
+  for (unsigned int i = 0; i < _points.size(); ++i)
+  {
+    for (int j = offset[i]; j < offset[i + 1]; ++j)
+    {
+      auto const &cell = cell_iterators[indices[j]];
+      dealii::Point<dim> unit_point;
+      try
+      {
+        unit_point = mapping.transform_real_to_unit_cell(cell, _points[i]);
+      }
+      catch (typename dealii::Mapping<dim>::ExcTransformationFailed &)
+      {
+        continue;
+      }
+      if (dealii::GeometryInfo<dim>::is_inside_unit_cell(unit_point, tol))
+      {
+        _local_points.push_back(i);
+        _cells.push_back(cell);
+        _unit_points.push_back(unit_point);
+        break;
+      }
+    }
+  }
+}
+} // namespace adamantine
+
+INSTANTIATE_DIM(TemperatureProbes)
@@ -0,0 +1,113 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef TEMPERATURE_PROBES_HH
+#define TEMPERATURE_PROBES_HH
+
+#include <deal.II/base/partitioner.h>
+#include <deal.II/base/point.h>
+#include <deal.II/dofs/dof_handler.h>
+#include <deal.II/lac/la_parallel_vector.h>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <fstream>
+#include <memory>
+#include <vector>
+
+namespace adamantine
+{
+/**
+ * This class evaluates the temperature at fixed points, like virtual
+ * thermocouples, and appends the values to a csv file. The cells that contain
+ * the points and the coordinates of the points in the reference cell are only
+ * computed again when the dofs change. The value of a point that is not in an
+ * activated cell is written as nan.
+ */
+template <int dim>
+class TemperatureProbes
+{
+public:
+  /**
+   * Constructor. The points are read from the post_processor @p database and
+   * the values are written in filename_prefix.probes.csv by the first
+   * processor of @p communicator.
+   */
+  TemperatureProbes(MPI_Comm const &communicator,
+                    boost::property_tree::ptree const &database);
+
+  /**
+   * Evaluate the @p temperature at the points at @p time and append the values
+   * to the file.
+   */
+  void write_values(
+      double time, dealii::DoFHandler<dim> const &dof_handler,
+      dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> const
+          &temperature);
+
+  /**
+   * Return the points.
+   */
+  std::vector<dealii::Point<dim>> const &get_points() const;
+
+  /**
+   * Return the values computed by the last call to write_values(). The values
+   * are only valid on the first processor.
+   */
+  std::vector<double> const &get_values() const;
+
+private:
+  /**
+   * Find the locally owned activated cells that contain the points.
+   */
+  void locate_points(dealii::DoFHandler<dim> const &dof_handler);
+
+  /**
+   * MPI communicator.
+   */
+  MPI_Comm _communicator;
+  /**
+   * Points where the temperature is evaluated.
+   */
+  std::vector<dealii::Point<dim>> _points;
+  /**
+   * Partitioner of the temperature used to locate the points. When the
+   * partitioner changes, the dofs have changed.
+   */
+  std::shared_ptr<dealii::Utilities::MPI::Partitioner const> _partitioner;
+  /**
+   * Indices of the points found in the locally owned cells, the cells that
+   * contain them, and their coordinates in the reference cell.
+   */
+  std::vector<unsigned int> _local_points;
+  std::vector<typename dealii::DoFHandler<dim>::active_cell_iterator> _cells;
+  std::vector<dealii::Point<dim>> _unit_points;
+  /**
+   * Values computed by the last call to write_values().
+   */
+  std::vector<double> _values;
+  /**
+   * Output file used by the first processor.
+   */
+  std::ofstream _file;
+};
+
+template <int dim>
+inline std::vector<dealii::Point<dim>> const &
+TemperatureProbes<dim>::get_points() const
+{
+  return _points;
+}
+
+template <int dim>
+inline std::vector<double> const &TemperatureProbes<dim>::get_values() const
+{
+  return _values;
+}
+} // namespace adamantine
+
+#endif
@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2022, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -17,13 +17,24 @@
 #include <deal.II/fe/mapping_q1.h>
 #include <deal.II/grid/filtered_iterator.h>
 #include <deal.II/hp/fe_values.h>
+#include <deal.II/lac/dynamic_sparsity_pattern.h>
+#include <deal.II/lac/full_matrix.h>
+#include <deal.II/lac/sparsity_tools.h>
 #include <deal.II/matrix_free/fe_evaluation.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#ifdef ADAMANTINE_WITH_CALIPER
+#include <caliper/cali.h>
+#endif
+
 namespace adamantine
 {
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-ThermalOperator<dim, fe_degree, MemorySpaceType>::ThermalOperator(
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::ThermalOperator(
     MPI_Comm const &communicator, BoundaryType boundary_type,
     MaterialProperty<dim, MemorySpaceType> &material_properties,
     std::vector<std::shared_ptr<HeatSource<dim>>> const &heat_sources)
@@ -33,7 +44,7 @@ ThermalOperator<dim, fe_degree, MemorySpaceType>::ThermalOperator(
           new dealii::LA::distributed::Vector<double, MemorySpaceType>())
 {
   _matrix_free_data.tasks_parallel_scheme =
-      dealii::MatrixFree<dim, double>::AdditionalData::partition_color;
+      dealii::MatrixFree<dim, Number>::AdditionalData::partition_color;
   _matrix_free_data.mapping_update_flags =
       dealii::update_values | dealii::update_gradients |
       dealii::update_JxW_values | dealii::update_quadrature_points;
@@ -43,31 +54,145 @@ ThermalOperator<dim, fe_degree, MemorySpaceType>::ThermalOperator(
       dealii::update_values | dealii::update_JxW_values;
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-void ThermalOperator<dim, fe_degree, MemorySpaceType>::reinit(
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::reinit(
     dealii::DoFHandler<dim> const &dof_handler,
     dealii::AffineConstraints<double> const &affine_constraints,
     dealii::hp::QCollection<1> const &q_collection)
 {
+  // In multirate mode, the cells whose level is at least _multirate_level are
+  // put in a different category so that the cell batches do not mix them with
+  // the other cells.
+  bool const multirate =
+      _multirate_level != dealii::numbers::invalid_unsigned_int;
+  if (multirate)
+  {
+    auto const &triangulation = dof_handler.get_triangulation();
+    std::vector<unsigned int> &category =
+        _matrix_free_data.cell_vectorization_category;
+    category.assign(triangulation.n_active_cells(), 0);
+    for (auto const &cell : triangulation.active_cell_iterators())
+      if (cell->level() >= static_cast<int>(_multirate_level))
+        category[cell->active_cell_index()] = 1;
+    _matrix_free_data.cell_vectorizes_categories_separately = true;
+  }
   _matrix_free.reinit(dealii::StaticMappingQ1<dim>::mapping, dof_handler,
                       affine_constraints, q_collection, _matrix_free_data);
   _affine_constraints = &affine_constraints;
-
-  // Compute mapping between DoFHandler cells and the MatrixFree cells
+  _frozen_coefficients_valid = false;
+  _linearization_point.reinit(0);
+  // The cell batches have changed, every batch is awake.
+  _cell_batch_quiet_steps.clear();
+  _sleeping_cell_batches.clear();
+
+  // Compute mapping between DoFHandler cells and the MatrixFree cells and the
+  // bounding boxes of the cell batches used to cull the heat sources.
+  // In multirate mode, also compute the ranges of the cell batches that are
+  // advanced with the small time step. Contiguous cell batches that share the
+  // same fe index are merged.
   _cell_it_to_mf_cell_map.clear();
+  _fast_cell_batch_ranges.clear();
   unsigned int const n_cells = _matrix_free.n_cell_batches();
+  _cell_batch_bounding_boxes.resize(n_cells);
+  unsigned int previous_fe_index = dealii::numbers::invalid_unsigned_int;
   for (unsigned int cell = 0; cell < n_cells; ++cell)
-    for (unsigned int i = 0;
-         i < _matrix_free.n_active_entries_per_cell_batch(cell); ++i)
+  {
+    unsigned int n_fast_lanes = 0;
+    unsigned int const n_lanes =
+        _matrix_free.n_active_entries_per_cell_batch(cell);
+    for (unsigned int i = 0; i < n_lanes; ++i)
     {
       typename dealii::DoFHandler<dim>::cell_iterator cell_it =
           _matrix_free.get_cell_iterator(cell, i);
       _cell_it_to_mf_cell_map[cell_it] = std::make_pair(cell, i);
+      if (i == 0)
+        _cell_batch_bounding_boxes[cell] = cell_it->bounding_box();
+      else
+        _cell_batch_bounding_boxes[cell].merge_with(cell_it->bounding_box());
+      if (multirate && (cell_it->level() >= static_cast<int>(_multirate_level)))
+        ++n_fast_lanes;
+    }
+
+    ASSERT_THROW((n_fast_lanes == 0) || (n_fast_lanes == n_lanes),
+                 "A cell batch mixes cells of the different multirate levels.");
+    if (n_fast_lanes > 0)
+    {
+      unsigned int const fe_index =
+          _matrix_free.get_cell_range_category(std::make_pair(cell, cell + 1));
+      if (!_fast_cell_batch_ranges.empty() &&
+          (_fast_cell_batch_ranges.back().second == cell) &&
+          (previous_fe_index == fe_index))
+        ++_fast_cell_batch_ranges.back().second;
+      else
+        _fast_cell_batch_ranges.emplace_back(cell, cell + 1);
+      previous_fe_index = fe_index;
+    }
+  }
+
+  // Compute the list of the face batches at the boundary of the activated
+  // domain. These are the only faces where the boundary conditions are applied.
+  // The face batches that touch a dof which is not locally owned, or which is
+  // constrained, are stored separately because they need the ghost values.
+  // Contiguous face batches that share the same category are merged.
+  _active_boundary_face_ranges.clear();
+  _ghosted_active_boundary_face_ranges.clear();
+  if (!(_boundary_type & BoundaryType::adiabatic))
+  {
+    dealii::IndexSet const &locally_owned_dofs =
+        dof_handler.locally_owned_dofs();
+    std::vector<dealii::types::global_dof_index> dof_indices;
+    unsigned int const n_inner_faces = _matrix_free.n_inner_face_batches();
+    auto const needs_ghost_values = [&](unsigned int const face)
+    {
+      unsigned int const n_lanes =
+          _matrix_free.n_active_entries_per_face_batch(face);
+      for (unsigned int i = 0; i < n_lanes; ++i)
+        for (bool const interior : {true, false})
+        {
+          if (!interior && (face >= n_inner_faces))
+            continue;
+          auto const cell_it =
+              _matrix_free.get_face_iterator(face, i, interior).first;
+          if (!cell_it->is_locally_owned())
+            return true;
+          dof_indices.resize(cell_it->get_fe().n_dofs_per_cell());
+          cell_it->get_dof_indices(dof_indices);
+          for (auto const dof : dof_indices)
+            if (!locally_owned_dofs.is_element(dof) ||
+                affine_constraints.is_constrained(dof))
+              return true;
+        }
+      return false;
+    };
+
+    unsigned int const n_faces =
+        n_inner_faces + _matrix_free.n_boundary_face_batches();
+    std::array<std::pair<unsigned int, unsigned int>, 2> previous_fe_index;
+    for (unsigned int face = 0; face < n_faces; ++face)
+    {
+      auto const adjacent_cells_fe_index =
+          _matrix_free.get_face_range_category(std::make_pair(face, face + 1));
+      // See face_local_apply for the different cases.
+      if ((adjacent_cells_fe_index.first == adjacent_cells_fe_index.second) ||
+          (adjacent_cells_fe_index.first != 0 &&
+           adjacent_cells_fe_index.second != 0))
+        continue;
+
+      bool const ghosted = needs_ghost_values(face);
+      auto &face_ranges = ghosted ? _ghosted_active_boundary_face_ranges
+                                  : _active_boundary_face_ranges;
+      if (!face_ranges.empty() && (face_ranges.back().second == face) &&
+          (previous_fe_index[ghosted] == adjacent_cells_fe_index))
+        ++face_ranges.back().second;
+      else
+        face_ranges.emplace_back(face, face + 1);
+      previous_fe_index[ghosted] = adjacent_cells_fe_index;
     }
+  }
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-void ThermalOperator<dim, fe_degree, MemorySpaceType>::cell_local_mass(
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::cell_local_mass(
     dealii::MatrixFree<dim, double> const &data,
     dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
     dealii::LA::distributed::Vector<double, MemorySpaceType> const &src,
@@ -100,13 +225,15 @@ void ThermalOperator<dim, fe_degree, MemorySpaceType>::cell_local_mass(
   }
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-void ThermalOperator<dim, fe_degree, MemorySpaceType>::
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
     compute_inverse_mass_matrix(
         dealii::DoFHandler<dim> const &dof_handler,
         dealii::AffineConstraints<double> const &affine_constraints)
 {
-  // Compute the inverse of the mass matrix
+  // Compute the inverse of the mass matrix. The mass matrix is only computed
+  // once, so it is always computed in double precision independently of
+  // Number.
   dealii::hp::QCollection<dim> mass_q_collection;
   mass_q_collection.push_back(dealii::QGaussLobatto<dim>(fe_degree + 1));
   mass_q_collection.push_back(dealii::QGaussLobatto<dim>(2));
@@ -146,16 +273,23 @@ void ThermalOperator<dim, fe_degree, MemorySpaceType>::
   }
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-void ThermalOperator<dim, fe_degree, MemorySpaceType>::clear()
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::clear()
 {
   _cell_it_to_mf_cell_map.clear();
+  _cell_batch_bounding_boxes.clear();
+  _active_boundary_face_ranges.clear();
+  _ghosted_active_boundary_face_ranges.clear();
+  _cell_batch_quiet_steps.clear();
+  _sleeping_cell_batches.clear();
   _matrix_free.clear();
   _inverse_mass_matrix->reinit(0);
+  _frozen_coefficients_valid = false;
+  _linearization_point.reinit(0);
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-void ThermalOperator<dim, fe_degree, MemorySpaceType>::vmult(
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::vmult(
     dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
     dealii::LA::distributed::Vector<double, MemorySpaceType> const &src) const
 {
@@ -163,8 +297,8 @@ void ThermalOperator<dim, fe_degree, MemorySpaceType>::vmult(
   vmult_add(dst, src);
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-void ThermalOperator<dim, fe_degree, MemorySpaceType>::Tvmult(
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::Tvmult(
     dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
     dealii::LA::distributed::Vector<double, MemorySpaceType> const &src) const
 {
@@ -172,110 +306,669 @@ void ThermalOperator<dim, fe_degree, MemorySpaceType>::Tvmult(
   Tvmult_add(dst, src);
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-void ThermalOperator<dim, fe_degree, MemorySpaceType>::vmult_add(
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::vmult_add(
     dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
     dealii::LA::distributed::Vector<double, MemorySpaceType> const &src) const
 {
-  // Execute the matrix-free matrix-vector multiplication
-
-  // If we use adiabatic boundary condition, we have nothing to do on the faces
-  // of the cell
-  if (_boundary_type & BoundaryType::adiabatic)
-  {
-    _matrix_free.cell_loop(&ThermalOperator::cell_local_apply, this, dst, src);
-  }
+  // The kernels save the coefficients at the quadrature points when the
+  // frozen coefficient mode is enabled and the coefficients are not held.
+  bool const save_coefficients =
+      _frozen_coefficients && !_frozen_coefficients_held;
+  if (save_coefficients)
+    allocate_frozen_coefficients();
+
+  // Execute the matrix-free matrix-vector multiplication. The format of the
+  // material properties is dispatched once here so that the kernels evaluating
+  // the material properties do not branch.
+  if (_material_properties.properties_use_table())
+    matrix_free_vmult_add<true>(dst, src);
   else
-  {
-    // MatrixFree::loop works like cell_loop but also allow computation on
-    // internal faces and boundary faces. Here, we use the same function for
-    // both cases and apply the face condition only at the boundary of the
-    // activated domain.
-    _matrix_free.loop(&ThermalOperator::cell_local_apply,
-                      &ThermalOperator::face_local_apply,
-                      &ThermalOperator::face_local_apply, this, dst, src);
-  }
+    matrix_free_vmult_add<false>(dst, src);
+  if (!_frozen_coefficients_held)
+    _frozen_coefficients_valid = _frozen_coefficients;
+  if (save_coefficients)
+    _linearization_point = src;
 
   // Because cell_loop resolves the constraints, the constrained dofs are not
   // called they stay at zero. Thus, we need to force the value on the
   // constrained dofs by hand. The variable scaling is used so that we get the
   // right order of magnitude.
   // TODO: for now the value of scaling is set to 1
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_BEGIN("thermal_constraints");
+#endif
   double const scaling = 1.;
   std::vector<unsigned int> const &constrained_dofs =
       _matrix_free.get_constrained_dofs();
   for (auto &dof : constrained_dofs)
     dst.local_element(dof) += scaling * src.local_element(dof);
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_END("thermal_constraints");
+#endif
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-void ThermalOperator<dim, fe_degree, MemorySpaceType>::Tvmult_add(
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+template <bool use_table>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    matrix_free_vmult_add(
+        dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> const &src)
+        const
+{
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_BEGIN("thermal_cell_loop");
+#endif
+  _matrix_free.cell_loop(&ThermalOperator::cell_local_apply<use_table>, this,
+                         dst, src);
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_END("thermal_cell_loop");
+#endif
+  // If we use adiabatic boundary condition, we have nothing to do on the faces
+  // of the cell. Otherwise, the boundary conditions are applied only on the
+  // faces at the boundary of the activated domain.
+  if (!(_boundary_type & BoundaryType::adiabatic))
+  {
+#ifdef ADAMANTINE_WITH_CALIPER
+    CALI_MARK_BEGIN("thermal_face_loop");
+#endif
+    active_boundary_face_loop(&ThermalOperator::face_local_apply<use_table>,
+                              dst, src);
+#ifdef ADAMANTINE_WITH_CALIPER
+    CALI_MARK_END("thermal_face_loop");
+#endif
+  }
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    inverse_mass_vmult(
+        dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> const &src)
+        const
+{
+  bool const save_coefficients =
+      _frozen_coefficients && !_frozen_coefficients_held;
+  if (save_coefficients)
+    allocate_frozen_coefficients();
+
+  if (_material_properties.properties_use_table())
+    matrix_free_inverse_mass_vmult<true>(dst, src);
+  else
+    matrix_free_inverse_mass_vmult<false>(dst, src);
+  if (!_frozen_coefficients_held)
+    _frozen_coefficients_valid = _frozen_coefficients;
+  if (save_coefficients)
+    _linearization_point = src;
+
+  // Treat the constrained dofs the same way as vmult_add followed by the
+  // scaling by the inverse of the mass matrix.
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_BEGIN("thermal_constraints");
+#endif
+  double const scaling = 1.;
+  std::vector<unsigned int> const &constrained_dofs =
+      _matrix_free.get_constrained_dofs();
+  for (auto &dof : constrained_dofs)
+    dst.local_element(dof) += scaling *
+                              _inverse_mass_matrix->local_element(dof) *
+                              src.local_element(dof);
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_END("thermal_constraints");
+#endif
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+template <bool use_table>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    matrix_free_inverse_mass_vmult(
+        dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> const &src)
+        const
+{
+  // MatrixFree calls operation_before_loop on a range of dofs before the first
+  // cell writes to it and operation_after_loop once the last cell has written
+  // to it. The entries of dst are thus zeroed and scaled while they are still
+  // in cache.
+  auto const &inverse_mass_matrix = *_inverse_mass_matrix;
+  auto const operation_before_loop =
+      [&](unsigned int const start_range, unsigned int const end_range)
+  {
+    for (unsigned int i = start_range; i < end_range; ++i)
+      dst.local_element(i) = 0.;
+  };
+  auto const operation_after_loop =
+      [&](unsigned int const start_range, unsigned int const end_range)
+  {
+    for (unsigned int i = start_range; i < end_range; ++i)
+      dst.local_element(i) *= inverse_mass_matrix.local_element(i);
+  };
+
+  if (_boundary_type & BoundaryType::adiabatic)
+  {
+#ifdef ADAMANTINE_WITH_CALIPER
+    CALI_MARK_BEGIN("thermal_cell_loop");
+#endif
+    _matrix_free.cell_loop(&ThermalOperator::cell_local_apply<use_table>, this,
+                           dst, src, operation_before_loop,
+                           operation_after_loop);
+#ifdef ADAMANTINE_WITH_CALIPER
+    CALI_MARK_END("thermal_cell_loop");
+#endif
+  }
+  else
+  {
+    // The face contributions need to be added before the scaling. Since only a
+    // few faces contribute, we zero dst and apply the faces first. The ghost
+    // values of src are kept for the cell loop: MatrixFree does not exchange
+    // them again when they are already set.
+    dst = 0.;
+    bool const src_has_ghost_elements = src.has_ghost_elements();
+#ifdef ADAMANTINE_WITH_CALIPER
+    CALI_MARK_BEGIN("thermal_face_loop");
+#endif
+    active_boundary_face_loop(&ThermalOperator::face_local_apply<use_table>,
+                              dst, src, true);
+#ifdef ADAMANTINE_WITH_CALIPER
+    CALI_MARK_END("thermal_face_loop");
+    CALI_MARK_BEGIN("thermal_cell_loop");
+#endif
+    _matrix_free.cell_loop(
+        &ThermalOperator::cell_local_apply<use_table>, this, dst, src,
+        [](unsigned int const, unsigned int const) {}, operation_after_loop);
+#ifdef ADAMANTINE_WITH_CALIPER
+    CALI_MARK_END("thermal_cell_loop");
+#endif
+    if (!src_has_ghost_elements)
+      src.zero_out_ghost_values();
+  }
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::fast_cells_vmult(
     dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
     dealii::LA::distributed::Vector<double, MemorySpaceType> const &src) const
 {
-  // The system of equation is symmetric so we can use vmult_add
-  vmult_add(dst, src);
+  if (_material_properties.properties_use_table())
+    matrix_free_fast_cells_vmult<true>(dst, src);
+  else
+    matrix_free_fast_cells_vmult<false>(dst, src);
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-void ThermalOperator<dim, fe_degree, MemorySpaceType>::update_state_ratios(
-    unsigned int cell, unsigned int q,
-    dealii::VectorizedArray<double> temperature,
-    std::array<dealii::VectorizedArray<double>, g_n_material_states>
-        &state_ratios) const
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+template <bool use_table>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    matrix_free_fast_cells_vmult(
+        dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> const &src)
+        const
 {
-  unsigned int constexpr liquid =
-      static_cast<unsigned int>(MaterialState::liquid);
-  unsigned int constexpr powder =
-      static_cast<unsigned int>(MaterialState::powder);
-  unsigned int constexpr solid =
-      static_cast<unsigned int>(MaterialState::solid);
+  // The cell batches are not processed by MatrixFree::cell_loop, so we need to
+  // take care of the ghost values ourselves. The state of src is restored at
+  // the end.
+  dst = 0.;
+  bool const src_has_ghost_elements = src.has_ghost_elements();
+  if (!src_has_ghost_elements)
+    src.update_ghost_values();
+  dst.zero_out_ghost_values();
 
-  // Loop over the vectorized arrays
-  for (unsigned int n = 0; n < temperature.size(); ++n)
+  for (auto const &cell_range : _fast_cell_batch_ranges)
+    cell_local_apply<use_table>(_matrix_free, dst, src, cell_range);
+
+  dst.compress(dealii::VectorOperation::add);
+  if (!src_has_ghost_elements)
+    src.zero_out_ghost_values();
+
+  if (!(_boundary_type & BoundaryType::adiabatic))
+    active_boundary_face_loop(&ThermalOperator::face_local_apply<use_table>,
+                              dst, src);
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::jacobian_vmult(
+    dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+    dealii::LA::distributed::Vector<double, MemorySpaceType> const &src) const
+{
+  if (!_frozen_coefficients_valid)
   {
-    // Get the material id at this point
-    dealii::types::material_id const material_id = _material_id(cell, q)[n];
+    vmult(dst, src);
+    return;
+  }
 
-    // Get the material thermodynamic properties
-    double const solidus =
-        _material_properties.get(material_id, Property::solidus);
-    double const liquidus =
-        _material_properties.get(material_id, Property::liquidus);
+  dst = 0.;
+  _matrix_free.cell_loop(&ThermalOperator::cell_local_jacobian_apply, this, dst,
+                         src);
+  if (!(_boundary_type & BoundaryType::adiabatic) &&
+      _jacobian_boundary_conditions)
+    active_boundary_face_loop(&ThermalOperator::face_local_jacobian_apply, dst,
+                              src);
+
+  // Treat the constrained dofs the same way as vmult_add.
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_BEGIN("thermal_constraints");
+#endif
+  double const scaling = 1.;
+  std::vector<unsigned int> const &constrained_dofs =
+      _matrix_free.get_constrained_dofs();
+  for (auto &dof : constrained_dofs)
+    dst.local_element(dof) += scaling * src.local_element(dof);
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_END("thermal_constraints");
+#endif
+}
 
-    // Update the state ratios
-    state_ratios[powder] = _powder_ratio(cell, q);
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    compute_jacobian_diagonal(
+        dealii::LA::distributed::Vector<double, MemorySpaceType> &diagonal)
+        const
+{
+  if (!_frozen_coefficients_valid)
+    update_frozen_coefficients();
+
+  // The kernels do not read src but MatrixFree needs a vector with the right
+  // layout.
+  dealii::LA::distributed::Vector<double, MemorySpaceType> dummy;
+  _matrix_free.initialize_dof_vector(diagonal);
+  _matrix_free.initialize_dof_vector(dummy);
+  _matrix_free.cell_loop(&ThermalOperator::cell_local_jacobian_diagonal, this,
+                         diagonal, dummy);
+  if (!(_boundary_type & BoundaryType::adiabatic) &&
+      _jacobian_boundary_conditions)
+    active_boundary_face_loop(&ThermalOperator::face_local_jacobian_diagonal,
+                              diagonal, dummy);
+
+  // jacobian_vmult copies src on the constrained dofs.
+  std::vector<unsigned int> const &constrained_dofs =
+      _matrix_free.get_constrained_dofs();
+  for (auto &dof : constrained_dofs)
+    diagonal.local_element(dof) += 1.;
+}
 
-    if (temperature[n] < solidus)
-      state_ratios[liquid][n] = 0.;
-    else if (temperature[n] > liquidus)
-      state_ratios[liquid][n] = 1.;
-    else
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    compute_jacobian_matrix(
+        dealii::TrilinosWrappers::SparseMatrix &matrix) const
+{
+  if (!_frozen_coefficients_valid)
+    update_frozen_coefficients();
+
+  dealii::DoFHandler<dim> const &dof_handler = _matrix_free.get_dof_handler();
+  if (matrix.m() == 0)
+  {
+    // Create the sparsity pattern. Since we use a Trilinos matrix we don't
+    // need the sparsity pattern to outlive the sparse matrix.
+    dealii::IndexSet const &locally_owned_dofs =
+        dof_handler.locally_owned_dofs();
+    dealii::IndexSet const locally_relevant_dofs =
+        dealii::DoFTools::extract_locally_relevant_dofs(dof_handler);
+    dealii::DynamicSparsityPattern dsp(locally_relevant_dofs);
+    dealii::DoFTools::make_sparsity_pattern(dof_handler, dsp,
+                                            *_affine_constraints, false);
+    dealii::SparsityTools::distribute_sparsity_pattern(
+        dsp, locally_owned_dofs, _communicator, locally_relevant_dofs);
+    matrix.reinit(locally_owned_dofs, dsp, _communicator);
+  }
+  else
+  {
+    matrix = 0.;
+  }
+
+  // The local matrices are computed like the diagonal, i.e., by applying the
+  // kernels to each unit vector, but every entry is kept. MatrixFree numbers
+  // the dofs of a cell lexicographically while the DoFHandler uses the
+  // numbering of the finite element.
+  dealii::FEEvaluation<dim, fe_degree, fe_degree + 1, 1, Number> fe_eval(
+      _matrix_free);
+  unsigned int const dofs_per_cell = fe_eval.dofs_per_cell;
+  std::vector<unsigned int> const lexicographic_numbering =
+      fe_eval.get_shape_info().lexicographic_numbering;
+  dealii::AlignedVector<dealii::VectorizedArray<Number>> local_matrix(
+      dofs_per_cell * dofs_per_cell);
+  dealii::FullMatrix<double> cell_matrix(dofs_per_cell, dofs_per_cell);
+  std::vector<dealii::types::global_dof_index> dof_indices(dofs_per_cell);
+  auto const distribute_local_matrices =
+      [&](unsigned int const n_lanes, auto const &get_cell_iterator)
+  {
+    for (unsigned int lane = 0; lane < n_lanes; ++lane)
+    {
+      for (unsigned int i = 0; i < dofs_per_cell; ++i)
+        for (unsigned int j = 0; j < dofs_per_cell; ++j)
+          cell_matrix(lexicographic_numbering[j], lexicographic_numbering[i]) =
+              local_matrix[i * dofs_per_cell + j][lane];
+      get_cell_iterator(lane)->get_dof_indices(dof_indices);
+      _affine_constraints->distribute_local_to_global(cell_matrix, dof_indices,
+                                                      matrix);
+    }
+  };
+
+  // The sleeping cell batches are skipped like in jacobian_vmult.
+  bool const skip_sleeping = !_sleeping_cell_batches.empty();
+  unsigned int const n_cells = _matrix_free.n_cell_batches();
+  for (unsigned int cell = 0; cell < n_cells; ++cell)
+  {
+    auto const cell_subrange = _matrix_free.create_cell_subrange_hp_by_index(
+        std::make_pair(cell, cell + 1), 0);
+    if ((cell_subrange.first == cell_subrange.second) ||
+        (skip_sleeping && _sleeping_cell_batches[cell]))
+      continue;
+
+    fe_eval.reinit(cell);
+    for (unsigned int i = 0; i < dofs_per_cell; ++i)
+    {
+      for (unsigned int j = 0; j < dofs_per_cell; ++j)
+        fe_eval.submit_dof_value(dealii::make_vectorized_array<Number>(0.), j);
+      fe_eval.submit_dof_value(dealii::make_vectorized_array<Number>(1.), i);
+      fe_eval.evaluate(dealii::EvaluationFlags::gradients);
+      for (unsigned int q = 0; q < fe_eval.n_q_points; ++q)
+      {
+        fe_eval.submit_gradient(
+            -frozen_flux(cell, q, fe_eval.get_gradient(q)), q);
+      }
+      fe_eval.integrate(dealii::EvaluationFlags::gradients);
+      for (unsigned int j = 0; j < dofs_per_cell; ++j)
+        local_matrix[i * dofs_per_cell + j] = fe_eval.get_dof_value(j);
+    }
+    distribute_local_matrices(
+        _matrix_free.n_active_entries_per_cell_batch(cell),
+        [&](unsigned int const lane)
+        { return _matrix_free.get_cell_iterator(cell, lane); });
+  }
+
+  if (!(_boundary_type & BoundaryType::adiabatic) &&
+      _jacobian_boundary_conditions)
+  {
+    // Every face batch at the boundary of the activated domain contributes,
+    // independently of where its ghost values live. See face_local_apply for
+    // the side of the face that holds the material.
+    for (auto const *face_ranges :
+         {&_active_boundary_face_ranges, &_ghosted_active_boundary_face_ranges})
+      for (auto const &face_range : *face_ranges)
+      {
+        bool const interior =
+            _matrix_free.get_face_range_category(face_range).first == 0;
+        dealii::FEFaceEvaluation<dim, fe_degree, fe_degree + 1, 1, Number>
+            fe_face_eval(_matrix_free, interior);
+        for (unsigned int face = face_range.first; face < face_range.second;
+             ++face)
+        {
+          fe_face_eval.reinit(face);
+          for (unsigned int i = 0; i < dofs_per_cell; ++i)
+          {
+            for (unsigned int j = 0; j < dofs_per_cell; ++j)
+              fe_face_eval.submit_dof_value(
+                  dealii::make_vectorized_array<Number>(0.), j);
+            fe_face_eval.submit_dof_value(
+                dealii::make_vectorized_array<Number>(1.), i);
+            fe_face_eval.evaluate(dealii::EvaluationFlags::values);
+            for (unsigned int q = 0; q < fe_face_eval.n_q_points; ++q)
+            {
+              fe_face_eval.submit_value(-_frozen_heat_transfer_coef(face, q) *
+                                            fe_face_eval.get_value(q),
+                                        q);
+            }
+            fe_face_eval.integrate(dealii::EvaluationFlags::values);
+            for (unsigned int j = 0; j < dofs_per_cell; ++j)
+              local_matrix[i * dofs_per_cell + j] =
+                  fe_face_eval.get_dof_value(j);
+          }
+          distribute_local_matrices(
+              _matrix_free.n_active_entries_per_face_batch(face),
+              [&](unsigned int const lane)
+              {
+                return _matrix_free.get_face_iterator(face, lane, interior)
+                    .first;
+              });
+        }
+      }
+  }
+
+  matrix.compress(dealii::VectorOperation::add);
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+dealii::Tensor<1, dim, dealii::VectorizedArray<Number>>
+ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::frozen_flux(
+    unsigned int const cell, unsigned int const q,
+    dealii::Tensor<1, dim, dealii::VectorizedArray<Number>> const &grad) const
+{
+  auto flux = grad;
+  if constexpr (dim == 2)
+  {
+    flux[axis<dim>::x] = _frozen_conductivity[0](cell, q) * grad[axis<dim>::x];
+    flux[axis<dim>::z] = _frozen_conductivity[1](cell, q) * grad[axis<dim>::z];
+  }
+  if constexpr (dim == 3)
+  {
+    flux[axis<dim>::x] = _frozen_conductivity[0](cell, q) * grad[axis<dim>::x] +
+                         _frozen_conductivity[1](cell, q) * grad[axis<dim>::y];
+    flux[axis<dim>::y] = _frozen_conductivity[1](cell, q) * grad[axis<dim>::x] +
+                         _frozen_conductivity[2](cell, q) * grad[axis<dim>::y];
+    flux[axis<dim>::z] = _frozen_conductivity[3](cell, q) * grad[axis<dim>::z];
+  }
+
+  return flux;
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType,
+                     Number>::update_frozen_coefficients() const
+{
+  ASSERT_THROW(_frozen_coefficients && (_linearization_point.size() > 0),
+               "The frozen coefficients require the operator to be applied "
+               "first.");
+
+  // vmult saves the coefficients at the temperature it is applied to.
+  dealii::LA::distributed::Vector<double, MemorySpaceType> dst;
+  _matrix_free.initialize_dof_vector(dst);
+  vmult(dst, _linearization_point);
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    compute_gradient_indicator(
+        dealii::LA::distributed::Vector<double, MemorySpaceType> const
+            &temperature,
+        dealii::Vector<float> &indicator) const
+{
+  indicator.reinit(
+      _matrix_free.get_dof_handler().get_triangulation().n_active_cells());
+  // The state of the ghost values of temperature is restored at the end.
+  bool const temperature_has_ghost_elements = temperature.has_ghost_elements();
+  if (!temperature_has_ghost_elements)
+    temperature.update_ghost_values();
+  // The cell batches are evaluated in SIMD and only the gradients are
+  // needed, there is no loop over the faces as with the Kelly estimator.
+  dealii::FEEvaluation<dim, fe_degree, fe_degree + 1, 1, Number> fe_eval(
+      _matrix_free);
+  unsigned int const n_cells = _matrix_free.n_cell_batches();
+  for (unsigned int cell = 0; cell < n_cells; ++cell)
+  {
+    // The lanes of a batch share the same fe index.
+    if (_matrix_free.get_cell_iterator(cell, 0)->active_fe_index() != 0)
+      continue;
+
+    fe_eval.reinit(cell);
+    fe_eval.read_dof_values(temperature);
+    fe_eval.evaluate(dealii::EvaluationFlags::gradients);
+    dealii::VectorizedArray<Number> gradient_norm_square = 0.;
+    for (unsigned int q = 0; q < fe_eval.n_q_points; ++q)
+      gradient_norm_square +=
+          fe_eval.get_gradient(q).norm_square() * fe_eval.JxW(q);
+
+    unsigned int const n_lanes =
+        _matrix_free.n_active_entries_per_cell_batch(cell);
+    for (unsigned int i = 0; i < n_lanes; ++i)
     {
-      state_ratios[liquid][n] =
-          (temperature[n] - solidus) / (liquidus - solidus);
+      auto const cell_it = _matrix_free.get_cell_iterator(cell, i);
+      indicator[cell_it->active_cell_index()] =
+          cell_it->diameter() * std::sqrt(gradient_norm_square[i]);
     }
-    // Because the powder can only become liquid, the solid can only
-    // become liquid, and the liquid can only become solid, the ratio of
-    // powder can only decrease.
-    state_ratios[powder][n] =
-        std::min(1. - state_ratios[liquid][n], state_ratios[powder][n]);
-    // Use max to make sure that we don't create matter because of
-    // round-off.
-    state_ratios[solid][n] =
-        std::max(1. - state_ratios[liquid][n] - state_ratios[powder][n], 0.);
   }
+  if (!temperature_has_ghost_elements)
+    temperature.zero_out_ghost_values();
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+std::size_t
+ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::memory_consumption()
+    const
+{
+  // The nodes of the map store the pair, the pointers to the parent and the
+  // children, and the color.
+  std::size_t const cell_map_size =
+      _cell_it_to_mf_cell_map.size() *
+      (sizeof(typename decltype(_cell_it_to_mf_cell_map)::value_type) +
+       4 * sizeof(void *));
+
+  // The elements of the vectors are trivially copyable.
+  auto const vector_size = [](auto const &vector)
+  { return vector.capacity() * sizeof(vector[0]); };
+
+  std::size_t size =
+      _matrix_free.memory_consumption() + cell_map_size +
+      _thermal_conductivity.memory_consumption() +
+      _liquid_ratio.memory_consumption() + _powder_ratio.memory_consumption() +
+      _face_powder_ratio.memory_consumption() + vector_size(_material_id) +
+      vector_size(_face_material_id) + _deposition_cos.memory_consumption() +
+      _deposition_sin.memory_consumption() +
+      vector_size(_cell_batch_bounding_boxes) +
+      vector_size(_active_boundary_face_ranges) +
+      vector_size(_ghosted_active_boundary_face_ranges) +
+      vector_size(_fast_cell_batch_ranges) +
+      vector_size(_cell_batch_quiet_steps) +
+      vector_size(_sleeping_cell_batches) +
+      _cell_batch_reference_temperature.memory_consumption() +
+      _frozen_heat_transfer_coef.memory_consumption() +
+      _linearization_point.memory_consumption();
+  for (auto const &conductivity : _frozen_conductivity)
+    size += conductivity.memory_consumption();
+  if (_inverse_mass_matrix)
+    size += _inverse_mass_matrix->memory_consumption();
+
+  return size;
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+template <typename FaceOperation>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    active_boundary_face_loop(
+        FaceOperation const face_operation,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> const &src,
+        bool const keep_src_ghost_values) const
+{
+  // The faces are not processed by MatrixFree::loop, so we need to take care of
+  // the ghost values ourselves. The faces that only touch locally owned dofs
+  // are processed while the ghost values of src are exchanged. The state of src
+  // is restored at the end unless keep_src_ghost_values is true. The exchange
+  // and the compress are collective, so every processor goes through them even
+  // when it owns no boundary face.
+  bool const src_has_ghost_elements = src.has_ghost_elements();
+  if (!src_has_ghost_elements)
+    src.update_ghost_values_start();
+  dst.zero_out_ghost_values();
+
+  for (auto const &face_range : _active_boundary_face_ranges)
+    (this->*face_operation)(_matrix_free, dst, src, face_range);
+
+  if (!src_has_ghost_elements)
+    src.update_ghost_values_finish();
+  for (auto const &face_range : _ghosted_active_boundary_face_ranges)
+    (this->*face_operation)(_matrix_free, dst, src, face_range);
+
+  dst.compress(dealii::VectorOperation::add);
+  if (!src_has_ghost_elements && !keep_src_ghost_values)
+    src.zero_out_ghost_values();
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType,
+                     Number>::allocate_frozen_coefficients() const
+{
+  unsigned int constexpr n_q_points =
+      dealii::Utilities::pow(fe_degree + 1, dim);
+  unsigned int const n_cells = _matrix_free.n_cell_batches();
+  if (_frozen_conductivity[0].size(0) != n_cells)
+  {
+    for (auto &conductivity : _frozen_conductivity)
+      conductivity.reinit(n_cells, n_q_points);
+  }
+
+  if (!(_boundary_type & BoundaryType::adiabatic))
+  {
+    unsigned int constexpr n_face_q_points =
+        dealii::Utilities::pow(fe_degree + 1, dim - 1);
+    unsigned int const n_faces = _matrix_free.n_inner_face_batches() +
+                                 _matrix_free.n_boundary_face_batches();
+    if (_frozen_heat_transfer_coef.size(0) != n_faces)
+      _frozen_heat_transfer_coef.reinit(n_faces, n_face_q_points);
+  }
+}
 
-  _liquid_ratio(cell, q) = state_ratios[liquid];
-  _powder_ratio(cell, q) = state_ratios[powder];
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::Tvmult_add(
+    dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+    dealii::LA::distributed::Vector<double, MemorySpaceType> const &src) const
+{
+  // The system of equation is symmetric so we can use vmult_add
+  vmult_add(dst, src);
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-void ThermalOperator<dim, fe_degree, MemorySpaceType>::update_face_state_ratios(
-    unsigned int face, unsigned int q,
-    dealii::VectorizedArray<double> temperature,
-    std::array<dealii::VectorizedArray<double>, g_n_material_states>
-        &face_state_ratios) const
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    gather_phase_change_properties(
+        std::array<dealii::types::material_id,
+                   dealii::VectorizedArray<Number>::size()> const &material_id,
+        PhaseChangeProperties &phase_change_properties) const
+{
+  // The solidus and the liquidus default to the largest double which cannot be
+  // represented in single precision, so the properties are clamped.
+  auto const get_property =
+      [&](dealii::types::material_id const id, Property const property)
+  {
+    return static_cast<Number>(
+        std::min(_material_properties.get(id, property),
+                 static_cast<double>(std::numeric_limits<Number>::max())));
+  };
+
+  // In most batches, all the lanes share the same material. In this case, we
+  // only need to read the properties once.
+  bool const same_material =
+      std::all_of(material_id.begin(), material_id.end(),
+                  [&](dealii::types::material_id const id)
+                  { return id == material_id[0]; });
+  if (same_material)
+  {
+    phase_change_properties.solidus =
+        get_property(material_id[0], Property::solidus);
+    phase_change_properties.liquidus =
+        get_property(material_id[0], Property::liquidus);
+    phase_change_properties.latent_heat =
+        get_property(material_id[0], Property::latent_heat);
+  }
+  else
+  {
+    for (unsigned int n = 0; n < material_id.size(); ++n)
+    {
+      phase_change_properties.solidus[n] =
+          get_property(material_id[n], Property::solidus);
+      phase_change_properties.liquidus[n] =
+          get_property(material_id[n], Property::liquidus);
+      phase_change_properties.latent_heat[n] =
+          get_property(material_id[n], Property::latent_heat);
+    }
+  }
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    compute_state_ratios(
+        dealii::VectorizedArray<Number> const &temperature,
+        dealii::VectorizedArray<Number> const &old_powder_ratio,
+        PhaseChangeProperties const &phase_change_properties,
+        std::array<dealii::VectorizedArray<Number>, g_n_material_states>
+            &state_ratios) const
 {
   unsigned int constexpr liquid =
       static_cast<unsigned int>(MaterialState::liquid);
@@ -284,98 +977,295 @@ void ThermalOperator<dim, fe_degree, MemorySpaceType>::update_face_state_ratios(
   unsigned int constexpr solid =
       static_cast<unsigned int>(MaterialState::solid);
 
-  // Loop over the vectorized arrays
-  for (unsigned int n = 0; n < temperature.size(); ++n)
-  {
-    // Get the material id at this point
-    dealii::types::material_id const material_id =
-        _face_material_id(face, q)[n];
+  auto const &solidus = phase_change_properties.solidus;
+  auto const &liquidus = phase_change_properties.liquidus;
+  auto const zero = dealii::make_vectorized_array<Number>(0.);
+  auto const one = dealii::make_vectorized_array<Number>(1.);
+
+  // The ratio of liquid is zero below the solidus, one above the liquidus, and
+  // it varies linearly in between. For lanes outside of the mushy zone, the
+  // result of the division is discarded.
+  auto const mushy_ratio = (temperature - solidus) / (liquidus - solidus);
+  state_ratios[liquid] = dealii::compare_and_apply_mask<
+      dealii::SIMDComparison::less_than>(
+      temperature, solidus, zero,
+      dealii::compare_and_apply_mask<dealii::SIMDComparison::greater_than>(
+          temperature, liquidus, one, mushy_ratio));
+  // Because the powder can only become liquid, the solid can only
+  // become liquid, and the liquid can only become solid, the ratio of
+  // powder can only decrease.
+  state_ratios[powder] = std::min(one - state_ratios[liquid], old_powder_ratio);
+  // Use max to make sure that we don't create matter because of
+  // round-off.
+  state_ratios[solid] =
+      std::max(one - state_ratios[liquid] - state_ratios[powder], zero);
+}
 
-    // Get the material thermodynamic properties
-    double const solidus =
-        _material_properties.get(material_id, Property::solidus);
-    double const liquidus =
-        _material_properties.get(material_id, Property::liquidus);
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    update_state_ratios(
+        unsigned int cell, unsigned int q,
+        dealii::VectorizedArray<Number> temperature,
+        PhaseChangeProperties const &phase_change_properties,
+        std::array<dealii::VectorizedArray<Number>, g_n_material_states>
+            &state_ratios) const
+{
+  compute_state_ratios(temperature, _powder_ratio(cell, q),
+                       phase_change_properties, state_ratios);
 
-    // Update the state ratios
-    face_state_ratios[powder] = _face_powder_ratio(face, q);
+  _liquid_ratio(cell, q) =
+      state_ratios[static_cast<unsigned int>(MaterialState::liquid)];
+  _powder_ratio(cell, q) =
+      state_ratios[static_cast<unsigned int>(MaterialState::powder)];
+}
 
-    if (temperature[n] < solidus)
-      face_state_ratios[liquid][n] = 0.;
-    else if (temperature[n] > liquidus)
-      face_state_ratios[liquid][n] = 1.;
-    else
-    {
-      face_state_ratios[liquid][n] =
-          (temperature[n] - solidus) / (liquidus - solidus);
-    }
-    // Because the powder can only become liquid, the solid can only
-    // become liquid, and the liquid can only become solid, the ratio of
-    // powder can only decrease.
-    face_state_ratios[powder][n] = std::min(1. - face_state_ratios[liquid][n],
-                                            face_state_ratios[powder][n]);
-    // Use max to make sure that we don't create matter because of
-    // round-off.
-    face_state_ratios[solid][n] = std::max(
-        1. - face_state_ratios[liquid][n] - face_state_ratios[powder][n], 0.);
-  }
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    update_face_state_ratios(
+        unsigned int face, unsigned int q,
+        dealii::VectorizedArray<Number> temperature,
+        PhaseChangeProperties const &phase_change_properties,
+        std::array<dealii::VectorizedArray<Number>, g_n_material_states>
+            &face_state_ratios) const
+{
+  compute_state_ratios(temperature, _face_powder_ratio(face, q),
+                       phase_change_properties, face_state_ratios);
 
-  _face_powder_ratio(face, q) = face_state_ratios[powder];
+  _face_powder_ratio(face, q) =
+      face_state_ratios[static_cast<unsigned int>(MaterialState::powder)];
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-dealii::VectorizedArray<double>
-ThermalOperator<dim, fe_degree, MemorySpaceType>::get_inv_rho_cp(
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+template <bool use_table>
+dealii::VectorizedArray<Number>
+ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::get_inv_rho_cp(
     std::array<dealii::types::material_id,
-               dealii::VectorizedArray<double>::size()> const &material_id,
-    std::array<dealii::VectorizedArray<double>, g_n_material_states> const
+               dealii::VectorizedArray<Number>::size()> const &material_id,
+    std::array<dealii::VectorizedArray<Number>, g_n_material_states> const
         &state_ratios,
-    dealii::VectorizedArray<double> const &temperature,
-    dealii::AlignedVector<dealii::VectorizedArray<double>> const
-        &temperature_powers) const
+    PhaseChangeProperties const &phase_change_properties,
+    dealii::VectorizedArray<Number> const &temperature) const
 {
   // Here we need the specific heat (including the latent heat contribution)
   // and the density
-
-  // First, get the state-independent material properties
-  dealii::VectorizedArray<double> solidus, liquidus, latent_heat;
-  for (unsigned int n = 0; n < solidus.size(); ++n)
-  {
-    solidus[n] = _material_properties.get(material_id[n], Property::solidus);
-    liquidus[n] = _material_properties.get(material_id[n], Property::liquidus);
-    latent_heat[n] =
-        _material_properties.get(material_id[n], Property::latent_heat);
-  }
-
-  // Now compute the state-dependent properties
-  dealii::VectorizedArray<double> density =
-      _material_properties.compute_material_property(
+  dealii::VectorizedArray<Number> density =
+      _material_properties.template compute_material_property<use_table>(
           StateProperty::density, material_id.data(), state_ratios.data(),
-          temperature, temperature_powers);
+          temperature);
 
-  dealii::VectorizedArray<double> specific_heat =
-      _material_properties.compute_material_property(
+  dealii::VectorizedArray<Number> specific_heat =
+      _material_properties.template compute_material_property<use_table>(
           StateProperty::specific_heat, material_id.data(), state_ratios.data(),
-          temperature, temperature_powers);
+          temperature);
 
-  // Add in the latent heat contribution
+  // Add in the latent heat contribution in the lanes that are in the mushy
+  // zone, i.e., when the ratio of liquid is strictly between 0 and 1.
   unsigned int constexpr liquid =
       static_cast<unsigned int>(MaterialState::liquid);
+  auto const zero = dealii::make_vectorized_array<Number>(0.);
+  auto const latent_heat_contribution =
+      phase_change_properties.latent_heat /
+      (phase_change_properties.liquidus - phase_change_properties.solidus);
+  specific_heat += dealii::compare_and_apply_mask<
+      dealii::SIMDComparison::greater_than>(
+      state_ratios[liquid], zero,
+      dealii::compare_and_apply_mask<dealii::SIMDComparison::less_than>(
+          state_ratios[liquid], dealii::make_vectorized_array<Number>(1.),
+          latent_heat_contribution, zero),
+      zero);
+
+  return 1.0 / (density * specific_heat);
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType,
+                     Number>::update_heat_source_bounding_boxes()
+{
+  _heat_source_bounding_boxes.clear();
+  if (_heat_source_cutoff <= 0.)
+    return;
+
+  for (unsigned int i = 0; i < _heat_sources.size(); ++i)
+  {
+    dealii::Point<dim> min_point;
+    dealii::Point<dim> max_point;
+    if (compute_heat_source_bounding_box(
+            _heat_sources[i]->get_data(), _current_source_height,
+            _heat_source_cutoff, &min_point[0], &max_point[0]))
+      _heat_source_bounding_boxes.emplace_back(
+          i, dealii::BoundingBox<dim>(std::make_pair(min_point, max_point)));
+  }
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+bool ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    cell_batch_intersects(unsigned int const cell,
+                          dealii::BoundingBox<dim> const &bounding_box) const
+{
+  auto const &[batch_min, batch_max] =
+      _cell_batch_bounding_boxes[cell].get_boundary_points();
+  auto const &[box_min, box_max] = bounding_box.get_boundary_points();
+  bool intersect = true;
+  for (unsigned int d = 0; d < dim; ++d)
+    intersect = intersect && (box_min[d] <= batch_max[d]) &&
+                (batch_min[d] <= box_max[d]);
+
+  return intersect;
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    update_sleeping_cell_batches(
+        dealii::LA::distributed::Vector<double, MemorySpaceType> const
+            &temperature)
+{
+  if (_sleep_time_steps == 0)
+    return;
 
-  for (unsigned int n = 0; n < specific_heat.size(); ++n)
+  // After a change of the mesh, every cell batch is awake.
+  unsigned int const n_cells = _matrix_free.n_cell_batches();
+  if (_cell_batch_quiet_steps.size() != n_cells)
+  {
+    _cell_batch_quiet_steps.assign(n_cells, 0);
+    _sleeping_cell_batches.assign(n_cells, false);
+    _cell_batch_reference_temperature.resize(n_cells);
+  }
+
+  // The change of temperature is accumulated since the beginning of the quiet
+  // period, so that a slow drift cannot keep a cell batch asleep whatever the
+  // time step. The reference temperature is the mean temperature of the batch
+  // at the beginning of the quiet period and a batch is only quiet if all its
+  // dofs are within the tolerance of the reference. Thus, the temperature of a
+  // sleeping batch is uniform and the contribution of the batch that is
+  // skipped by the operator is negligible. The dofs are shared with the
+  // neighbors, so a batch wakes up when the temperature of a neighbor moves.
+  // A cell batch close to a heat source is never quiet. Without cutoff, the
+  // heat sources are evaluated everywhere and no cell batch can fall asleep.
+  bool const temperature_has_ghost_elements = temperature.has_ghost_elements();
+  if (!temperature_has_ghost_elements)
+    temperature.update_ghost_values();
+  dealii::FEEvaluation<dim, fe_degree, fe_degree + 1, 1, Number> fe_eval(
+      _matrix_free);
+  bool mask_changed = false;
+  for (unsigned int cell = 0; cell < n_cells; ++cell)
   {
-    if (state_ratios[liquid][n] > 0.0 && (state_ratios[liquid][n] < 1.0))
+    unsigned int quiet_steps = 0;
+    if ((_heat_source_cutoff > 0.) &&
+        (_matrix_free.get_cell_range_category(
+             std::make_pair(cell, cell + 1)) == 0) &&
+        std::none_of(_heat_source_bounding_boxes.begin(),
+                     _heat_source_bounding_boxes.end(),
+                     [&](auto const &source)
+                     { return cell_batch_intersects(cell, source.second); }))
     {
-      specific_heat[n] += latent_heat[n] / (liquidus[n] - solidus[n]);
+      fe_eval.reinit(cell);
+      fe_eval.read_dof_values(temperature);
+      dealii::VectorizedArray<Number> *dof_values = fe_eval.begin_dof_values();
+      // A new quiet period starts from the current mean temperature.
+      if (_cell_batch_quiet_steps[cell] == 0)
+      {
+        dealii::VectorizedArray<Number> mean = 0.;
+        for (unsigned int i = 0; i < fe_eval.dofs_per_cell; ++i)
+          mean += dof_values[i];
+        _cell_batch_reference_temperature[cell] =
+            mean / static_cast<Number>(fe_eval.dofs_per_cell);
+      }
+      unsigned int const n_lanes =
+          _matrix_free.n_active_entries_per_cell_batch(cell);
+      double max_change = 0.;
+      for (unsigned int i = 0; i < fe_eval.dofs_per_cell; ++i)
+        for (unsigned int l = 0; l < n_lanes; ++l)
+          max_change = std::max(
+              max_change,
+              std::abs(static_cast<double>(
+                  dof_values[i][l] -
+                  _cell_batch_reference_temperature[cell][l])));
+      if (max_change < _sleep_tolerance)
+        quiet_steps = _cell_batch_quiet_steps[cell] + 1;
+    }
+
+    // The first quiet step only sets the reference temperature.
+    _cell_batch_quiet_steps[cell] = quiet_steps;
+    bool const sleeping = quiet_steps > _sleep_time_steps;
+    if (static_cast<bool>(_sleeping_cell_batches[cell]) != sleeping)
+    {
+      _sleeping_cell_batches[cell] = sleeping;
+      mask_changed = true;
     }
   }
+  if (!temperature_has_ghost_elements)
+    temperature.zero_out_ghost_values();
 
-  return 1.0 / (density * specific_heat);
+  // The frozen coefficients of the cell batches that wake up are outdated.
+  if (mask_changed)
+    _frozen_coefficients_valid = false;
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-void ThermalOperator<dim, fe_degree, MemorySpaceType>::cell_local_apply(
-    dealii::MatrixFree<dim, double> const &data,
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+unsigned int ThermalOperator<dim, fe_degree, MemorySpaceType,
+                             Number>::n_sleeping_cell_batches() const
+{
+  return std::count(_sleeping_cell_batches.begin(),
+                    _sleeping_cell_batches.end(), true);
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+bool ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    evaluate_heat_sources(
+        dealii::FEEvaluation<dim, fe_degree, fe_degree + 1, 1, Number> const
+            &fe_eval,
+        unsigned int const cell, unsigned int const n_active_lanes,
+        std::vector<unsigned int> &batch_heat_sources,
+        dealii::AlignedVector<dealii::VectorizedArray<Number>> &source) const
+{
+  if (_heat_sources.empty())
+    return false;
+
+  // Only keep the heat sources whose bounding box intersects the bounding box
+  // of the cell batch. Most of the batches are far from every beam and they are
+  // skipped without evaluating the sources at the quadrature points.
+  batch_heat_sources.clear();
+  if (_heat_source_cutoff > 0.)
+  {
+    for (auto const &[i, bounding_box] : _heat_source_bounding_boxes)
+      if (cell_batch_intersects(cell, bounding_box))
+        batch_heat_sources.push_back(i);
+
+    if (batch_heat_sources.empty())
+      return false;
+  }
+  else
+  {
+    for (unsigned int i = 0; i < _heat_sources.size(); ++i)
+      batch_heat_sources.push_back(i);
+  }
+
+  bool has_source = false;
+  for (unsigned int q = 0; q < fe_eval.n_q_points; ++q)
+  {
+    dealii::Point<dim, dealii::VectorizedArray<Number>> const q_point =
+        fe_eval.quadrature_point(q);
+    // All the lanes of the batch are evaluated in a single call per beam.
+    dealii::VectorizedArray<Number> quad_pt_source = 0.0;
+    for (auto const beam : batch_heat_sources)
+      quad_pt_source +=
+          _heat_sources[beam]->value(q_point, _current_source_height);
+    // The inactive lanes are left at zero.
+    for (unsigned int i = 0; i < n_active_lanes; ++i)
+      has_source = has_source || (quad_pt_source[i] != 0.);
+    for (unsigned int i = n_active_lanes;
+         i < dealii::VectorizedArray<Number>::size(); ++i)
+      quad_pt_source[i] = 0.;
+    source[q] = quad_pt_source;
+  }
+
+  return has_source;
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+template <bool use_table>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::cell_local_apply(
+    dealii::MatrixFree<dim, Number> const &data,
     dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
     dealii::LA::distributed::Vector<double, MemorySpaceType> const &src,
     std::pair<unsigned int, unsigned int> const &cell_range) const
@@ -384,61 +1274,79 @@ void ThermalOperator<dim, fe_degree, MemorySpaceType>::cell_local_apply(
   std::pair<unsigned int, unsigned int> cell_subrange =
       data.create_cell_subrange_hp_by_index(cell_range, 0);
 
-  dealii::FEEvaluation<dim, fe_degree, fe_degree + 1, 1, double> fe_eval(data);
-  std::array<dealii::VectorizedArray<double>, g_n_material_states>
-      state_ratios = {{dealii::make_vectorized_array(-1.0),
-                       dealii::make_vectorized_array(-1.0),
-                       dealii::make_vectorized_array(-1.0)}};
-
-  // We need powers of temperature to compute the material properties. We
-  // could compute it in MaterialProperty but because it's in a hot loop.
-  // It's really worth to compute it once and pass it when we compute a
-  // material property.
-  dealii::AlignedVector<dealii::VectorizedArray<double>> temperature_powers(
-      _material_properties.polynomial_order + 1);
+  dealii::FEEvaluation<dim, fe_degree, fe_degree + 1, 1, Number> fe_eval(data);
+  std::array<dealii::VectorizedArray<Number>, g_n_material_states>
+      state_ratios = {{dealii::make_vectorized_array<Number>(-1.0),
+                       dealii::make_vectorized_array<Number>(-1.0),
+                       dealii::make_vectorized_array<Number>(-1.0)}};
+
+  PhaseChangeProperties phase_change_properties;
+
+  // The heat sources are integrated together with the diffusion term. Since
+  // the sources are localized around the beams, most cell batches do not see
+  // any source and we can skip the integration of the values on these batches.
+  dealii::AlignedVector<dealii::VectorizedArray<Number>> source(
+      fe_eval.n_q_points);
+  std::vector<unsigned int> batch_heat_sources;
+  batch_heat_sources.reserve(_heat_sources.size());
 
   // Loop over the "cells". Note that we don't really work on a cell but on a
   // set of quadrature point.
+  bool const skip_sleeping = !_sleeping_cell_batches.empty();
   for (unsigned int cell = cell_subrange.first; cell < cell_subrange.second;
        ++cell)
   {
+    if (skip_sleeping && _sleeping_cell_batches[cell])
+      continue;
     // Reinit fe_eval on the current cell
     fe_eval.reinit(cell);
+    // The material is the same at every quadrature point of a cell, so the
+    // phase change properties are gathered once per cell batch.
+    gather_phase_change_properties(_material_id[cell],
+                                   phase_change_properties);
     // Store in a local vector the local values of src
     fe_eval.read_dof_values(src);
     // Evaluate the function and its gradient on the reference cell
     fe_eval.evaluate(dealii::EvaluationFlags::values |
                      dealii::EvaluationFlags::gradients);
+    // Compute the source term
+    bool const has_source = evaluate_heat_sources(
+        fe_eval, cell, data.n_active_entries_per_cell_batch(cell),
+        batch_heat_sources, source);
     // Apply the Jacobian of the transformation, multiply by the variable
     // coefficients and the quadrature points
     for (unsigned int q = 0; q < fe_eval.n_q_points; ++q)
     {
       auto temperature = fe_eval.get_value(q);
-      // Precompute the powers of temperature.
-      for (unsigned int i = 0; i <= _material_properties.polynomial_order; ++i)
-      {
-        // FIXME Need to cast i to double due to a limitation in deal.II 9.5
-        temperature_powers[i] = std::pow(temperature, static_cast<double>(i));
-      }
-
       // Calculate the local material properties
-      update_state_ratios(cell, q, temperature, state_ratios);
-      auto material_id = _material_id(cell, q);
-      auto inv_rho_cp = get_inv_rho_cp(material_id, state_ratios, temperature,
-                                       temperature_powers);
+      update_state_ratios(cell, q, temperature, phase_change_properties,
+                          state_ratios);
+      auto const &material_id = _material_id[cell];
+      auto inv_rho_cp = get_inv_rho_cp<use_table>(
+          material_id, state_ratios, phase_change_properties, temperature);
       auto th_conductivity_grad = fe_eval.get_gradient(q);
 
       // In 2D we only use x and z, and there are no deposition angle
       if constexpr (dim == 2)
       {
-        th_conductivity_grad[axis<dim>::x] *=
-            _material_properties.compute_material_property(
+        auto const thermal_conductivity_x =
+            _material_properties.template compute_material_property<use_table>(
                 StateProperty::thermal_conductivity_x, material_id.data(),
-                state_ratios.data(), temperature, temperature_powers);
-        th_conductivity_grad[axis<dim>::z] *=
-            _material_properties.compute_material_property(
+                state_ratios.data(), temperature);
+        auto const thermal_conductivity_z =
+            _material_properties.template compute_material_property<use_table>(
                 StateProperty::thermal_conductivity_z, material_id.data(),
-                state_ratios.data(), temperature, temperature_powers);
+                state_ratios.data(), temperature);
+        th_conductivity_grad[axis<dim>::x] *= thermal_conductivity_x;
+        th_conductivity_grad[axis<dim>::z] *= thermal_conductivity_z;
+
+        if (_frozen_coefficients && !_frozen_coefficients_held)
+        {
+          _frozen_conductivity[0](cell, q) =
+              inv_rho_cp * thermal_conductivity_x;
+          _frozen_conductivity[1](cell, q) =
+              inv_rho_cp * thermal_conductivity_z;
+        }
       }
 
       if constexpr (dim == 3)
@@ -446,16 +1354,16 @@ void ThermalOperator<dim, fe_degree, MemorySpaceType>::cell_local_apply(
         auto const th_conductivity_grad_x = th_conductivity_grad[axis<dim>::x];
         auto const th_conductivity_grad_y = th_conductivity_grad[axis<dim>::y];
         auto const thermal_conductivity_x =
-            _material_properties.compute_material_property(
+            _material_properties.template compute_material_property<use_table>(
                 StateProperty::thermal_conductivity_x, material_id.data(),
-                state_ratios.data(), temperature, temperature_powers);
+                state_ratios.data(), temperature);
         auto const thermal_conductivity_y =
-            _material_properties.compute_material_property(
+            _material_properties.template compute_material_property<use_table>(
                 StateProperty::thermal_conductivity_y, material_id.data(),
-                state_ratios.data(), temperature, temperature_powers);
+                state_ratios.data(), temperature);
 
-        auto cos = _deposition_cos(cell, q);
-        auto sin = _deposition_sin(cell, q);
+        auto const &cos = _deposition_cos[cell];
+        auto const &sin = _deposition_sin[cell];
 
         // The rotation is performed using the following formula
         //
@@ -465,57 +1373,58 @@ void ThermalOperator<dim, fe_degree, MemorySpaceType>::cell_local_apply(
         // ((x*cos^2 + y*sin^2)  ((x-y) * (sin*cos)))
         // (((x-y) * (sin*cos))  (x*sin^2 + y*cos^2))
 
+        auto const thermal_conductivity_xx =
+            thermal_conductivity_x * cos * cos +
+            thermal_conductivity_y * sin * sin;
+        auto const thermal_conductivity_xy =
+            (thermal_conductivity_x - thermal_conductivity_y) * sin * cos;
+        auto const thermal_conductivity_yy =
+            thermal_conductivity_x * sin * sin +
+            thermal_conductivity_y * cos * cos;
         th_conductivity_grad[axis<dim>::x] =
-            (thermal_conductivity_x * cos * cos +
-             thermal_conductivity_y * sin * sin) *
-                th_conductivity_grad_x +
-            ((thermal_conductivity_x - thermal_conductivity_y) * sin * cos) *
-                th_conductivity_grad_y;
+            thermal_conductivity_xx * th_conductivity_grad_x +
+            thermal_conductivity_xy * th_conductivity_grad_y;
         th_conductivity_grad[axis<dim>::y] =
-            ((thermal_conductivity_x - thermal_conductivity_y) * sin * cos) *
-                th_conductivity_grad_x +
-            (thermal_conductivity_x * sin * sin +
-             thermal_conductivity_y * cos * cos) *
-                th_conductivity_grad_y;
+            thermal_conductivity_xy * th_conductivity_grad_x +
+            thermal_conductivity_yy * th_conductivity_grad_y;
 
         // There is no deposition angle for the z axis
-        th_conductivity_grad[axis<dim>::z] *=
-            _material_properties.compute_material_property(
+        auto const thermal_conductivity_z =
+            _material_properties.template compute_material_property<use_table>(
                 StateProperty::thermal_conductivity_z, material_id.data(),
-                state_ratios.data(), temperature, temperature_powers);
+                state_ratios.data(), temperature);
+        th_conductivity_grad[axis<dim>::z] *= thermal_conductivity_z;
+
+        if (_frozen_coefficients && !_frozen_coefficients_held)
+        {
+          _frozen_conductivity[0](cell, q) =
+              inv_rho_cp * thermal_conductivity_xx;
+          _frozen_conductivity[1](cell, q) =
+              inv_rho_cp * thermal_conductivity_xy;
+          _frozen_conductivity[2](cell, q) =
+              inv_rho_cp * thermal_conductivity_yy;
+          _frozen_conductivity[3](cell, q) =
+              inv_rho_cp * thermal_conductivity_z;
+        }
       }
 
       fe_eval.submit_gradient(-inv_rho_cp * th_conductivity_grad, q);
 
-      // Compute source term
-      dealii::Point<dim, dealii::VectorizedArray<double>> const &q_point =
-          fe_eval.quadrature_point(q);
-
-      dealii::VectorizedArray<double> quad_pt_source = 0.0;
-      for (unsigned int i = 0;
-           i < _matrix_free.n_active_entries_per_cell_batch(cell); ++i)
-      {
-        dealii::Point<dim> q_point_loc;
-        for (unsigned int d = 0; d < dim; ++d)
-          q_point_loc(d) = q_point(d)[i];
-
-        for (auto &beam : _heat_sources)
-          quad_pt_source[i] += beam->value(q_point_loc, _current_source_height);
-      }
-      quad_pt_source *= inv_rho_cp;
-
-      fe_eval.submit_value(quad_pt_source, q);
+      if (has_source)
+        fe_eval.submit_value(inv_rho_cp * source[q], q);
     }
     // Sum over the quadrature points.
-    fe_eval.integrate(dealii::EvaluationFlags::values |
-                      dealii::EvaluationFlags::gradients);
+    fe_eval.integrate(has_source ? (dealii::EvaluationFlags::values |
+                                    dealii::EvaluationFlags::gradients)
+                                 : dealii::EvaluationFlags::gradients);
     fe_eval.distribute_local_to_global(dst);
   }
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-void ThermalOperator<dim, fe_degree, MemorySpaceType>::face_local_apply(
-    dealii::MatrixFree<dim, double> const &data,
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+template <bool use_table>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::face_local_apply(
+    dealii::MatrixFree<dim, Number> const &data,
     dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
     dealii::LA::distributed::Vector<double, MemorySpaceType> const &src,
     std::pair<unsigned int, unsigned int> const &face_range) const
@@ -544,30 +1453,26 @@ void ThermalOperator<dim, fe_degree, MemorySpaceType>::face_local_apply(
 
   // Create the FEFaceEvaluation object. The boolean in the constructor is used
   // to decided which cell the face should be exterior to.
-  dealii::FEFaceEvaluation<dim, fe_degree, fe_degree + 1, 1, double>
+  dealii::FEFaceEvaluation<dim, fe_degree, fe_degree + 1, 1, Number>
       fe_face_eval(data, adjacent_cells_fe_index.first == 0);
-  std::array<dealii::VectorizedArray<double>, g_n_material_states>
-      face_state_ratios = {{dealii::make_vectorized_array(-1.0),
-                            dealii::make_vectorized_array(-1.0),
-                            dealii::make_vectorized_array(-1.0)}};
+  std::array<dealii::VectorizedArray<Number>, g_n_material_states>
+      face_state_ratios = {{dealii::make_vectorized_array<Number>(-1.0),
+                            dealii::make_vectorized_array<Number>(-1.0),
+                            dealii::make_vectorized_array<Number>(-1.0)}};
   // Create variables used to compute boundary conditions.
-  auto conv_temperature_infty = dealii::make_vectorized_array<double>(0.);
-  auto conv_heat_transfer_coef = dealii::make_vectorized_array<double>(0.);
-  auto rad_temperature_infty = dealii::make_vectorized_array<double>(0.);
-  auto rad_heat_transfer_coef = dealii::make_vectorized_array<double>(0.);
-
-  // We need powers of temperature to compute the material properties. We
-  // could compute it in MaterialProperty but because it's in a hot loop.
-  // It's really worth to compute it once and pass it when we compute a
-  // material property.
-  dealii::AlignedVector<dealii::VectorizedArray<double>> temperature_powers(
-      _material_properties.polynomial_order + 1);
+  auto conv_temperature_infty = dealii::make_vectorized_array<Number>(0.);
+  auto conv_heat_transfer_coef = dealii::make_vectorized_array<Number>(0.);
+  auto rad_temperature_infty = dealii::make_vectorized_array<Number>(0.);
+  auto rad_heat_transfer_coef = dealii::make_vectorized_array<Number>(0.);
+  PhaseChangeProperties phase_change_properties;
 
   // Loop over the faces
   for (unsigned int face = face_range.first; face < face_range.second; ++face)
   {
     // Reinit fe_face_eval on the current face
     fe_face_eval.reinit(face);
+    gather_phase_change_properties(_face_material_id[face],
+                                   phase_change_properties);
     // Store in a local vector the local values of src
     fe_face_eval.read_dof_values(src);
     // Evalue the function on the reference cell
@@ -577,18 +1482,13 @@ void ThermalOperator<dim, fe_degree, MemorySpaceType>::face_local_apply(
     for (unsigned int q = 0; q < fe_face_eval.n_q_points; ++q)
     {
       auto temperature = fe_face_eval.get_value(q);
-      // Precompute the powers of temperature.
-      for (unsigned int i = 0; i <= _material_properties.polynomial_order; ++i)
-      {
-        // FIXME Need to cast i to double due to a limitation in deal.II 9.5
-        temperature_powers[i] = std::pow(temperature, static_cast<double>(i));
-      }
-
       // Compute the local_properties
-      auto material_id = _face_material_id(face, q);
-      update_face_state_ratios(face, q, temperature, face_state_ratios);
-      auto const inv_rho_cp = get_inv_rho_cp(material_id, face_state_ratios,
-                                             temperature, temperature_powers);
+      auto const &material_id = _face_material_id[face];
+      update_face_state_ratios(face, q, temperature, phase_change_properties,
+                               face_state_ratios);
+      auto const inv_rho_cp =
+          get_inv_rho_cp<use_table>(material_id, face_state_ratios,
+                                    phase_change_properties, temperature);
       if (_boundary_type & BoundaryType::convective)
       {
         for (unsigned int n = 0; n < conv_temperature_infty.size(); ++n)
@@ -597,10 +1497,9 @@ void ThermalOperator<dim, fe_degree, MemorySpaceType>::face_local_apply(
               material_id[n], Property::convection_temperature_infty);
         }
         conv_heat_transfer_coef =
-            _material_properties.compute_material_property(
+            _material_properties.template compute_material_property<use_table>(
                 StateProperty::convection_heat_transfer_coef,
-                material_id.data(), face_state_ratios.data(), temperature,
-                temperature_powers);
+                material_id.data(), face_state_ratios.data(), temperature);
       }
       if (_boundary_type & BoundaryType::radiative)
       {
@@ -615,9 +1514,9 @@ void ThermalOperator<dim, fe_degree, MemorySpaceType>::face_local_apply(
         // properties: h_rad = emissitivity * stefan-boltzmann constant * (T
         // + T_infty) (T^2 + T^2_infty).
         rad_heat_transfer_coef =
-            _material_properties.compute_material_property(
+            _material_properties.template compute_material_property<use_table>(
                 StateProperty::emissivity, material_id.data(),
-                face_state_ratios.data(), temperature, temperature_powers) *
+                face_state_ratios.data(), temperature) *
             Constant::stefan_boltzmann * (temperature + rad_temperature_infty) *
             (temperature * temperature +
              rad_temperature_infty * rad_temperature_infty);
@@ -627,6 +1526,11 @@ void ThermalOperator<dim, fe_degree, MemorySpaceType>::face_local_apply(
           -inv_rho_cp *
           (conv_heat_transfer_coef * (temperature - conv_temperature_infty) +
            rad_heat_transfer_coef * (temperature - rad_temperature_infty));
+      if (_frozen_coefficients && !_frozen_coefficients_held)
+      {
+        _frozen_heat_transfer_coef(face, q) =
+            inv_rho_cp * (conv_heat_transfer_coef + rad_heat_transfer_coef);
+      }
       fe_face_eval.submit_value(boundary_val * fe_face_eval.get_value(q), q);
     }
     // Sum over the quadrature points
@@ -635,35 +1539,216 @@ void ThermalOperator<dim, fe_degree, MemorySpaceType>::face_local_apply(
   }
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-void ThermalOperator<dim, fe_degree,
-                     MemorySpaceType>::get_state_from_material_properties()
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    cell_local_jacobian_apply(
+        dealii::MatrixFree<dim, Number> const &data,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> const &src,
+        std::pair<unsigned int, unsigned int> const &cell_range) const
+{
+  // Get the subrange of cells associated with the fe index 0
+  std::pair<unsigned int, unsigned int> cell_subrange =
+      data.create_cell_subrange_hp_by_index(cell_range, 0);
+
+  dealii::FEEvaluation<dim, fe_degree, fe_degree + 1, 1, Number> fe_eval(data);
+
+  // The coefficients do not depend on src, so we only need the gradient. The
+  // sleeping cell batches are skipped like in cell_local_apply.
+  bool const skip_sleeping = !_sleeping_cell_batches.empty();
+  for (unsigned int cell = cell_subrange.first; cell < cell_subrange.second;
+       ++cell)
+  {
+    if (skip_sleeping && _sleeping_cell_batches[cell])
+      continue;
+    fe_eval.reinit(cell);
+    fe_eval.read_dof_values(src);
+    fe_eval.evaluate(dealii::EvaluationFlags::gradients);
+    for (unsigned int q = 0; q < fe_eval.n_q_points; ++q)
+    {
+      fe_eval.submit_gradient(-frozen_flux(cell, q, fe_eval.get_gradient(q)),
+                              q);
+    }
+    fe_eval.integrate(dealii::EvaluationFlags::gradients);
+    fe_eval.distribute_local_to_global(dst);
+  }
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    face_local_jacobian_apply(
+        dealii::MatrixFree<dim, Number> const &data,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> const &src,
+        std::pair<unsigned int, unsigned int> const &face_range) const
+{
+  // Only the faces at the boundary of the activated domain contribute. See
+  // face_local_apply.
+  auto const adjacent_cells_fe_index = data.get_face_range_category(face_range);
+  if (adjacent_cells_fe_index.first == adjacent_cells_fe_index.second)
+  {
+    return;
+  }
+  if ((adjacent_cells_fe_index.first != 0 &&
+       adjacent_cells_fe_index.second != 0))
+  {
+    return;
+  }
+
+  dealii::FEFaceEvaluation<dim, fe_degree, fe_degree + 1, 1, Number>
+      fe_face_eval(data, adjacent_cells_fe_index.first == 0);
+
+  for (unsigned int face = face_range.first; face < face_range.second; ++face)
+  {
+    fe_face_eval.reinit(face);
+    fe_face_eval.read_dof_values(src);
+    fe_face_eval.evaluate(dealii::EvaluationFlags::values);
+    for (unsigned int q = 0; q < fe_face_eval.n_q_points; ++q)
+    {
+      fe_face_eval.submit_value(-_frozen_heat_transfer_coef(face, q) *
+                                    fe_face_eval.get_value(q),
+                                q);
+    }
+    fe_face_eval.integrate(dealii::EvaluationFlags::values);
+    fe_face_eval.distribute_local_to_global(dst);
+  }
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    cell_local_jacobian_diagonal(
+        dealii::MatrixFree<dim, Number> const &data,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> const &,
+        std::pair<unsigned int, unsigned int> const &cell_range) const
+{
+  // Get the subrange of cells associated with the fe index 0
+  std::pair<unsigned int, unsigned int> cell_subrange =
+      data.create_cell_subrange_hp_by_index(cell_range, 0);
+
+  dealii::FEEvaluation<dim, fe_degree, fe_degree + 1, 1, Number> fe_eval(data);
+  dealii::AlignedVector<dealii::VectorizedArray<Number>> local_diagonal(
+      fe_eval.dofs_per_cell);
+
+  // The sleeping cell batches are skipped like in cell_local_jacobian_apply.
+  bool const skip_sleeping = !_sleeping_cell_batches.empty();
+  for (unsigned int cell = cell_subrange.first; cell < cell_subrange.second;
+       ++cell)
+  {
+    if (skip_sleeping && _sleeping_cell_batches[cell])
+      continue;
+    fe_eval.reinit(cell);
+    // Apply the local operator to each unit vector and keep the diagonal
+    // entry.
+    for (unsigned int i = 0; i < fe_eval.dofs_per_cell; ++i)
+    {
+      for (unsigned int j = 0; j < fe_eval.dofs_per_cell; ++j)
+        fe_eval.submit_dof_value(dealii::make_vectorized_array<Number>(0.), j);
+      fe_eval.submit_dof_value(dealii::make_vectorized_array<Number>(1.), i);
+      fe_eval.evaluate(dealii::EvaluationFlags::gradients);
+      for (unsigned int q = 0; q < fe_eval.n_q_points; ++q)
+      {
+        fe_eval.submit_gradient(
+            -frozen_flux(cell, q, fe_eval.get_gradient(q)), q);
+      }
+      fe_eval.integrate(dealii::EvaluationFlags::gradients);
+      local_diagonal[i] = fe_eval.get_dof_value(i);
+    }
+    for (unsigned int i = 0; i < fe_eval.dofs_per_cell; ++i)
+      fe_eval.submit_dof_value(local_diagonal[i], i);
+    fe_eval.distribute_local_to_global(dst);
+  }
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    face_local_jacobian_diagonal(
+        dealii::MatrixFree<dim, Number> const &data,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> const &,
+        std::pair<unsigned int, unsigned int> const &face_range) const
+{
+  // Only the faces at the boundary of the activated domain contribute. See
+  // face_local_apply.
+  auto const adjacent_cells_fe_index = data.get_face_range_category(face_range);
+  if (adjacent_cells_fe_index.first == adjacent_cells_fe_index.second)
+  {
+    return;
+  }
+  if ((adjacent_cells_fe_index.first != 0 &&
+       adjacent_cells_fe_index.second != 0))
+  {
+    return;
+  }
+
+  dealii::FEFaceEvaluation<dim, fe_degree, fe_degree + 1, 1, Number>
+      fe_face_eval(data, adjacent_cells_fe_index.first == 0);
+  dealii::AlignedVector<dealii::VectorizedArray<Number>> local_diagonal(
+      fe_face_eval.dofs_per_cell);
+
+  for (unsigned int face = face_range.first; face < face_range.second; ++face)
+  {
+    fe_face_eval.reinit(face);
+    for (unsigned int i = 0; i < fe_face_eval.dofs_per_cell; ++i)
+    {
+      for (unsigned int j = 0; j < fe_face_eval.dofs_per_cell; ++j)
+        fe_face_eval.submit_dof_value(dealii::make_vectorized_array<Number>(0.),
+                                      j);
+      fe_face_eval.submit_dof_value(dealii::make_vectorized_array<Number>(1.),
+                                    i);
+      fe_face_eval.evaluate(dealii::EvaluationFlags::values);
+      for (unsigned int q = 0; q < fe_face_eval.n_q_points; ++q)
+      {
+        fe_face_eval.submit_value(-_frozen_heat_transfer_coef(face, q) *
+                                      fe_face_eval.get_value(q),
+                                  q);
+      }
+      fe_face_eval.integrate(dealii::EvaluationFlags::values);
+      local_diagonal[i] = fe_face_eval.get_dof_value(i);
+    }
+    for (unsigned int i = 0; i < fe_face_eval.dofs_per_cell; ++i)
+      fe_face_eval.submit_dof_value(local_diagonal[i], i);
+    fe_face_eval.distribute_local_to_global(dst);
+  }
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType,
+                     Number>::get_state_from_material_properties()
 {
+  // The material state changes so the frozen coefficients need to be
+  // recomputed.
+  _frozen_coefficients_valid = false;
+
   unsigned int const n_cells = _matrix_free.n_cell_batches();
-  dealii::FEEvaluation<dim, fe_degree, fe_degree + 1, 1, double> fe_eval(
+  dealii::FEEvaluation<dim, fe_degree, fe_degree + 1, 1, Number> fe_eval(
       _matrix_free);
 
   _liquid_ratio.reinit(n_cells, fe_eval.n_q_points);
   _powder_ratio.reinit(n_cells, fe_eval.n_q_points);
-  _material_id.reinit(n_cells, fe_eval.n_q_points);
+  _material_id.assign(n_cells, {});
 
   for (unsigned int cell = 0; cell < n_cells; ++cell)
-    for (unsigned int q = 0; q < fe_eval.n_q_points; ++q)
-      for (unsigned int i = 0;
-           i < _matrix_free.n_active_entries_per_cell_batch(cell); ++i)
+    for (unsigned int i = 0;
+         i < _matrix_free.n_active_entries_per_cell_batch(cell); ++i)
+    {
+      typename dealii::DoFHandler<dim>::cell_iterator cell_it =
+          _matrix_free.get_cell_iterator(cell, i);
+      // Cast to Triangulation<dim>::cell_iterator to access the material_id
+      typename dealii::Triangulation<dim>::active_cell_iterator cell_tria(
+          cell_it);
+
+      double const liquid_ratio = _material_properties.get_state_ratio(
+          cell_tria, MaterialState::liquid);
+      double const powder_ratio = _material_properties.get_state_ratio(
+          cell_tria, MaterialState::powder);
+      for (unsigned int q = 0; q < fe_eval.n_q_points; ++q)
       {
-        typename dealii::DoFHandler<dim>::cell_iterator cell_it =
-            _matrix_free.get_cell_iterator(cell, i);
-        // Cast to Triangulation<dim>::cell_iterator to access the material_id
-        typename dealii::Triangulation<dim>::active_cell_iterator cell_tria(
-            cell_it);
-
-        _liquid_ratio(cell, q)[i] = _material_properties.get_state_ratio(
-            cell_tria, MaterialState::liquid);
-        _powder_ratio(cell, q)[i] = _material_properties.get_state_ratio(
-            cell_tria, MaterialState::powder);
-        _material_id(cell, q)[i] = cell_tria->material_id();
+        _liquid_ratio(cell, q)[i] = liquid_ratio;
+        _powder_ratio(cell, q)[i] = powder_ratio;
       }
+      _material_id[cell][i] = cell_tria->material_id();
+    }
 
   // If we are using boundary conditions other than adiabatic, we also need to
   // update the face variables
@@ -673,11 +1758,11 @@ void ThermalOperator<dim, fe_degree,
     unsigned int const n_boundary_faces =
         _matrix_free.n_boundary_face_batches();
     unsigned int const n_faces = n_inner_faces + n_boundary_faces;
-    dealii::FEFaceEvaluation<dim, fe_degree, fe_degree + 1, 1, double>
+    dealii::FEFaceEvaluation<dim, fe_degree, fe_degree + 1, 1, Number>
         fe_face_eval(_matrix_free, true);
 
     _face_powder_ratio.reinit(n_faces, fe_face_eval.n_q_points);
-    _face_material_id.reinit(n_faces, fe_face_eval.n_q_points);
+    _face_material_id.assign(n_faces, {});
 
     for (unsigned int face = 0; face < n_inner_faces; ++face)
       for (unsigned int q = 0; q < fe_face_eval.n_q_points; ++q)
@@ -705,7 +1790,7 @@ void ThermalOperator<dim, fe_degree,
             _face_powder_ratio(face, q)[i] =
                 _material_properties.get_state_ratio(cell_tria,
                                                      MaterialState::powder);
-            _face_material_id(face, q)[i] = cell_tria->material_id();
+            _face_material_id[face][i] = cell_tria->material_id();
           }
         }
 
@@ -730,33 +1815,32 @@ void ThermalOperator<dim, fe_degree,
             _face_powder_ratio(face, q)[i] =
                 _material_properties.get_state_ratio(cell_tria,
                                                      MaterialState::powder);
-            _face_material_id(face, q)[i] = cell_tria->material_id();
+            _face_material_id[face][i] = cell_tria->material_id();
           }
         }
   }
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-void ThermalOperator<dim, fe_degree,
-                     MemorySpaceType>::set_state_to_material_properties()
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType,
+                     Number>::set_state_to_material_properties()
 {
   _material_properties.set_state(_liquid_ratio, _powder_ratio,
                                  _cell_it_to_mf_cell_map,
                                  _matrix_free.get_dof_handler());
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-void ThermalOperator<dim, fe_degree, MemorySpaceType>::
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+void ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
     set_material_deposition_orientation(
         std::vector<double> const &deposition_cos,
         std::vector<double> const &deposition_sin)
 {
   unsigned int const n_cells = _matrix_free.n_cell_batches();
-  dealii::FEEvaluation<dim, fe_degree, fe_degree + 1, 1, double> fe_eval(
-      _matrix_free);
-
-  _deposition_cos.reinit(n_cells, fe_eval.n_q_points);
-  _deposition_sin.reinit(n_cells, fe_eval.n_q_points);
+  _deposition_cos.resize(n_cells);
+  _deposition_sin.resize(n_cells);
+  _deposition_cos.fill(dealii::make_vectorized_array<Number>(0.));
+  _deposition_sin.fill(dealii::make_vectorized_array<Number>(0.));
 
   using dof_cell_iterator = typename dealii::DoFHandler<dim>::cell_iterator;
   std::map<dof_cell_iterator, unsigned int> cell_mapping;
@@ -773,21 +1857,21 @@ void ThermalOperator<dim, fe_degree, MemorySpaceType>::
          "Out-of-bound access.");
 
   for (unsigned int cell = 0; cell < n_cells; ++cell)
-    for (unsigned int q = 0; q < fe_eval.n_q_points; ++q)
-      for (unsigned int i = 0;
-           i < _matrix_free.n_active_entries_per_cell_batch(cell); ++i)
-      {
-        dof_cell_iterator cell_it = _matrix_free.get_cell_iterator(cell, i);
+    for (unsigned int i = 0;
+         i < _matrix_free.n_active_entries_per_cell_batch(cell); ++i)
+    {
+      dof_cell_iterator cell_it = _matrix_free.get_cell_iterator(cell, i);
 
-        if (cell_it->active_fe_index() == 0)
-        {
-          unsigned int const j = cell_mapping[cell_it];
-          _deposition_cos(cell, q)[i] = deposition_cos[j];
-          _deposition_sin(cell, q)[i] = deposition_sin[j];
-        }
+      if (cell_it->active_fe_index() == 0)
+      {
+        unsigned int const j = cell_mapping[cell_it];
+        _deposition_cos[cell][i] = deposition_cos[j];
+        _deposition_sin[cell][i] = deposition_sin[j];
       }
+    }
 }
 
 } // namespace adamantine
 
 INSTANTIATE_DIM_FEDEGREE_HOST(TUPLE(ThermalOperator))
+INSTANTIATE_DIM_FEDEGREE_HOST_FLOAT(TUPLE(ThermalOperator))
@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2022, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -13,16 +13,27 @@
 #include <ThermalOperatorBase.hh>
 
 #include <deal.II/base/aligned_vector.h>
+#include <deal.II/base/bounding_box.h>
+#include <deal.II/base/tensor.h>
 #include <deal.II/base/vectorization.h>
+#include <deal.II/matrix_free/fe_evaluation.h>
 #include <deal.II/matrix_free/matrix_free.h>
 
+#include <array>
+#include <vector>
+
 namespace adamantine
 {
 /**
  * This class is the operator associated with the heat equation, i.e., vmult
- * performs \f$ dst = -\nabla k \nabla src \f$.
+ * performs \f$ dst = -\nabla k \nabla src \f$. The kernels are evaluated
+ * using the floating point type @p Number while the vectors are always stored
+ * in double precision. Using float doubles the number of cells processed by
+ * each SIMD instruction and halves the memory traffic of the tables at the
+ * quadrature points.
  */
-template <int dim, int fe_degree, typename MemorySpaceType>
+template <int dim, int fe_degree, typename MemorySpaceType,
+          typename Number = double>
 class ThermalOperator final : public ThermalOperatorBase<dim, MemorySpaceType>
 {
 public:
@@ -65,7 +76,7 @@ public:
   /**
    * Return a shared pointer to the underlying MatrixFree object.
    */
-  dealii::MatrixFree<dim, double> const &get_matrix_free() const;
+  dealii::MatrixFree<dim, Number> const &get_matrix_free() const;
 
   void vmult(dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
              dealii::LA::distributed::Vector<double, MemorySpaceType> const
@@ -83,6 +94,23 @@ public:
                   dealii::LA::distributed::Vector<double, MemorySpaceType> const
                       &src) const override;
 
+  /**
+   * Compute \f$ dst = M^{-1} A src \f$. The destination vector is zeroed and
+   * scaled by the inverse of the mass matrix inside the loop over the cells,
+   * while the entries are still in cache, instead of requiring separate sweeps
+   * over the vectors.
+   */
+  void inverse_mass_vmult(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const &src)
+      const override;
+
+  /**
+   * Apply the Jacobian of the operator. If the frozen coefficient mode is
+   * enabled and the coefficients have been computed by vmult, the Jacobian is
+   * applied using these coefficients, which does not include the heat sources.
+   * Otherwise, this function calls vmult.
+   */
   void
   jacobian_vmult(dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
                  dealii::LA::distributed::Vector<double, MemorySpaceType> const
@@ -98,7 +126,7 @@ public:
 
   /**
    * Set the deposition cosine and sine angles and convert the data from
-   * std::vector to dealii::Table<2, dealii::VectorizedArray>
+   * std::vector to dealii::AlignedVector<dealii::VectorizedArray>
    */
   void set_material_deposition_orientation(
       std::vector<double> const &deposition_cos,
@@ -106,45 +134,250 @@ public:
 
   void set_time_and_source_height(double t, double height) override;
 
+  /**
+   * Enable or disable the frozen coefficient mode. In this mode, vmult saves
+   * the coefficients of the operator evaluated at the temperature @p src,
+   * i.e., at the linearization point. jacobian_vmult then reuses these
+   * coefficients instead of recomputing the material properties. The saved
+   * coefficients are invalidated when the mesh or the material state change.
+   */
+  void set_frozen_coefficients(bool frozen_coefficients) override;
+
+  /**
+   * If @p hold is true, vmult keeps the saved coefficients instead of saving
+   * the coefficients at its @p src. This is used to apply the same Jacobian
+   * during all the stages of a time step.
+   */
+  void hold_frozen_coefficients(bool hold) override;
+
+  /**
+   * Include or not the convective and radiative boundary conditions in the
+   * Jacobian applied by jacobian_vmult and in its diagonal. When they are
+   * excluded, the Jacobian with frozen coefficients is only the diffusion
+   * operator. By default, the boundary conditions are included.
+   */
+  void set_jacobian_boundary_conditions(bool boundary_conditions) override;
+
+  /**
+   * Set the level from which the cells are advanced with the small time step
+   * of the multirate time stepping. These cells are vectorized separately from
+   * the other cells, i.e., they are in a different MatrixFree category, so that
+   * fast_cells_vmult only evaluates them. This function needs to be called
+   * before reinit. If @p level is dealii::numbers::invalid_unsigned_int, the
+   * multirate mode is disabled.
+   */
+  void set_multirate_level(unsigned int level) override;
+
+  /**
+   * Apply the operator on the cell batches whose level is at least the
+   * multirate level and on the faces at the boundary of the activated domain.
+   * The constrained dofs are not modified.
+   */
+  void fast_cells_vmult(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const &src)
+      const override;
+
+  /**
+   * Set the value under which the heat sources are considered to be zero. The
+   * heat sources are only evaluated on the cell batches that intersect the
+   * region where they are larger than @p cutoff. If @p cutoff is zero, the heat
+   * sources are evaluated on every cell batch.
+   */
+  void set_heat_source_cutoff(double cutoff) override;
+
+  /**
+   * A cell batch falls asleep when the temperature of its dofs stays within
+   * @p tolerance of its mean temperature at the beginning of the quiet period
+   * during @p time_steps consecutive time steps and when it does not intersect
+   * the bounding box of a heat source. The change is accumulated over the
+   * whole quiet period, not measured per time step. The sleeping cell batches
+   * are skipped by the operator. Since the dofs are shared with the neighbors,
+   * a cell batch wakes up as soon as the temperature of one of its neighbors
+   * has moved by @p tolerance or when a heat source approaches. The mask is
+   * reset when the mesh changes.
+   */
+  void set_sleep_parameters(unsigned int time_steps, double tolerance) override;
+
+  void update_sleeping_cell_batches(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const
+          &temperature) override;
+
+  /**
+   * Return the number of sleeping cell batches.
+   */
+  unsigned int n_sleeping_cell_batches() const;
+
+  /**
+   * Compute the diagonal of the Jacobian applied by jacobian_vmult. If the
+   * frozen coefficients are outdated, e.g., because the material state changed
+   * or cell batches woke up, they are recomputed at the last linearization
+   * point.
+   */
+  void compute_jacobian_diagonal(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &diagonal)
+      const override;
+
+  /**
+   * Assemble the matrix of the Jacobian applied by jacobian_vmult using the
+   * same frozen coefficients as compute_jacobian_diagonal. The sparsity pattern
+   * is only created when @p matrix is empty, so @p matrix needs to be cleared
+   * when the dofs change. The rows of the constrained dofs only have a diagonal
+   * entry.
+   */
+  void compute_jacobian_matrix(
+      dealii::TrilinosWrappers::SparseMatrix &matrix) const override;
+
+  void compute_gradient_indicator(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const
+          &temperature,
+      dealii::Vector<float> &indicator) const override;
+
+  std::size_t memory_consumption() const override;
+
 private:
+  /**
+   * Properties of the materials in a cell/face batch that control the phase
+   * change.
+   */
+  struct PhaseChangeProperties
+  {
+    dealii::VectorizedArray<Number> solidus;
+    dealii::VectorizedArray<Number> liquidus;
+    dealii::VectorizedArray<Number> latent_heat;
+  };
+
+  /**
+   * Gather the PhaseChangeProperties of the materials of a cell/face batch.
+   * When all the lanes share the same material, the properties are read only
+   * once.
+   */
+  void gather_phase_change_properties(
+      std::array<dealii::types::material_id,
+                 dealii::VectorizedArray<Number>::size()> const &material_id,
+      PhaseChangeProperties &phase_change_properties) const;
+
+  /**
+   * Compute the ratios of the material state given the temperature and the
+   * previous ratio of powder. This function does not branch on the lanes.
+   */
+  void compute_state_ratios(
+      dealii::VectorizedArray<Number> const &temperature,
+      dealii::VectorizedArray<Number> const &old_powder_ratio,
+      PhaseChangeProperties const &phase_change_properties,
+      std::array<dealii::VectorizedArray<Number>,
+                 static_cast<unsigned int>(MaterialState::SIZE)> &state_ratios)
+      const;
+
   /**
    * Update the ratios of the material state.
    */
-  void
-  update_state_ratios(unsigned int cell, unsigned int q,
-                      dealii::VectorizedArray<double> temperature,
-                      std::array<dealii::VectorizedArray<double>,
-                                 static_cast<unsigned int>(MaterialState::SIZE)>
-                          &state_ratios) const;
+  void update_state_ratios(
+      unsigned int cell, unsigned int q,
+      dealii::VectorizedArray<Number> temperature,
+      PhaseChangeProperties const &phase_change_properties,
+      std::array<dealii::VectorizedArray<Number>,
+                 static_cast<unsigned int>(MaterialState::SIZE)> &state_ratios)
+      const;
 
   /**
    * Update the ratios of the material state at the face quadrature points.
    */
   void update_face_state_ratios(
       unsigned int face, unsigned int q,
-      dealii::VectorizedArray<double> temperature,
-      std::array<dealii::VectorizedArray<double>,
+      dealii::VectorizedArray<Number> temperature,
+      PhaseChangeProperties const &phase_change_properties,
+      std::array<dealii::VectorizedArray<Number>,
                  static_cast<unsigned int>(MaterialState::SIZE)> &state_ratios)
       const;
   /**
    * Return the value of \f$ \frac{1}{\rho C_p} \f$ for a given matrix-free
    * cell/face and quadrature point.
    */
-  dealii::VectorizedArray<double> get_inv_rho_cp(
+  template <bool use_table>
+  dealii::VectorizedArray<Number> get_inv_rho_cp(
       std::array<dealii::types::material_id,
-                 dealii::VectorizedArray<double>::size()> const &material_id,
-      std::array<dealii::VectorizedArray<double>,
+                 dealii::VectorizedArray<Number>::size()> const &material_id,
+      std::array<dealii::VectorizedArray<Number>,
                  static_cast<unsigned int>(MaterialState::SIZE)> const
           &state_ratios,
-      dealii::VectorizedArray<double> const &temperature,
-      dealii::AlignedVector<dealii::VectorizedArray<double>> const
-          &temperature_powers) const;
+      PhaseChangeProperties const &phase_change_properties,
+      dealii::VectorizedArray<Number> const &temperature) const;
+
+  /**
+   * Compute the bounding boxes of the heat sources at the current time.
+   */
+  void update_heat_source_bounding_boxes();
+
+  /**
+   * Return true if the cell batch @p cell intersects @p bounding_box.
+   */
+  bool
+  cell_batch_intersects(unsigned int const cell,
+                        dealii::BoundingBox<dim> const &bounding_box) const;
+
+  /**
+   * Evaluate the sum of the heat sources at the quadrature points of the
+   * current cell batch \p cell of \p fe_eval. Return false if the heat sources
+   * are zero at every quadrature point of the batch. In that case, \p source is
+   * either left untouched, when no heat source intersects the batch, or set to
+   * zero, so it should not be used. \p batch_heat_sources is a scratch vector
+   * used to store the indices of the heat sources that intersect the batch.
+   */
+  bool evaluate_heat_sources(
+      dealii::FEEvaluation<dim, fe_degree, fe_degree + 1, 1, Number> const
+          &fe_eval,
+      unsigned int const cell, unsigned int const n_active_lanes,
+      std::vector<unsigned int> &batch_heat_sources,
+      dealii::AlignedVector<dealii::VectorizedArray<Number>> &source) const;
+
+  /**
+   * Apply the matrix-free operator for a given format of the material
+   * properties: tables if @p use_table is true, polynomials otherwise.
+   */
+  template <bool use_table>
+  void matrix_free_vmult_add(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const &src)
+      const;
+
+  /**
+   * Same as fast_cells_vmult for a given format of the material properties.
+   */
+  template <bool use_table>
+  void matrix_free_fast_cells_vmult(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const &src)
+      const;
+
+  /**
+   * Apply @p face_operation on the face batches at the boundary of the
+   * activated domain and add the result to @p dst. If @p keep_src_ghost_values
+   * is true, the ghost values of @p src are left set on every processor.
+   */
+  template <typename FaceOperation>
+  void active_boundary_face_loop(
+      FaceOperation const face_operation,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const &src,
+      bool const keep_src_ghost_values = false) const;
+
+  /**
+   * Same as matrix_free_vmult_add but @p dst is zeroed before and scaled by
+   * the inverse of the mass matrix after the cells have contributed to it.
+   */
+  template <bool use_table>
+  void matrix_free_inverse_mass_vmult(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const &src)
+      const;
 
   /**
    * Apply the operator on a given set of quadrature points inside each cell.
    */
+  template <bool use_table>
   void cell_local_apply(
-      dealii::MatrixFree<dim, double> const &data,
+      dealii::MatrixFree<dim, Number> const &data,
       dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
       dealii::LA::distributed::Vector<double, MemorySpaceType> const &src,
       std::pair<unsigned int, unsigned int> const &cell_range) const;
@@ -152,8 +385,68 @@ private:
   /**
    * Apply the operator on a given set of quadrature points on each face.
    */
+  template <bool use_table>
   void face_local_apply(
-      dealii::MatrixFree<dim, double> const &data,
+      dealii::MatrixFree<dim, Number> const &data,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const &src,
+      std::pair<unsigned int, unsigned int> const &face_range) const;
+
+  /**
+   * Allocate the tables used to save the frozen coefficients.
+   */
+  void allocate_frozen_coefficients() const;
+
+  /**
+   * Recompute the frozen coefficients at the last linearization point.
+   */
+  void update_frozen_coefficients() const;
+
+  /**
+   * Return the product of the frozen conductivity and the gradient @p grad at
+   * the quadrature point @p q of the cell batch @p cell.
+   */
+  dealii::Tensor<1, dim, dealii::VectorizedArray<Number>>
+  frozen_flux(unsigned int cell, unsigned int q,
+              dealii::Tensor<1, dim, dealii::VectorizedArray<Number>> const
+                  &grad) const;
+
+  /**
+   * Apply the Jacobian using the frozen coefficients on a given set of
+   * quadrature points inside each cell.
+   */
+  void cell_local_jacobian_apply(
+      dealii::MatrixFree<dim, Number> const &data,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const &src,
+      std::pair<unsigned int, unsigned int> const &cell_range) const;
+
+  /**
+   * Apply the Jacobian using the frozen coefficients on a given set of
+   * quadrature points on each face.
+   */
+  void face_local_jacobian_apply(
+      dealii::MatrixFree<dim, Number> const &data,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const &src,
+      std::pair<unsigned int, unsigned int> const &face_range) const;
+
+  /**
+   * Compute the diagonal of the Jacobian using the frozen coefficients on a
+   * given set of cells.
+   */
+  void cell_local_jacobian_diagonal(
+      dealii::MatrixFree<dim, Number> const &data,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const &src,
+      std::pair<unsigned int, unsigned int> const &cell_range) const;
+
+  /**
+   * Compute the diagonal of the Jacobian using the frozen coefficients on a
+   * given set of faces.
+   */
+  void face_local_jacobian_diagonal(
+      dealii::MatrixFree<dim, Number> const &data,
       dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
       dealii::LA::distributed::Vector<double, MemorySpaceType> const &src,
       std::pair<unsigned int, unsigned int> const &face_range) const;
@@ -179,14 +472,18 @@ private:
    * Current height of the heat sources.
    */
   double _current_source_height = 0.;
+  /**
+   * Value under which the heat sources are considered to be zero.
+   */
+  double _heat_source_cutoff = 0.;
   /**
    * Data to configure the MatrixFree object.
    */
-  typename dealii::MatrixFree<dim, double>::AdditionalData _matrix_free_data;
+  typename dealii::MatrixFree<dim, Number>::AdditionalData _matrix_free_data;
   /**
    * Table of thermal conductivity coefficient.
    */
-  dealii::Table<2, dealii::VectorizedArray<double>> _thermal_conductivity;
+  dealii::Table<2, dealii::VectorizedArray<Number>> _thermal_conductivity;
   /**
    * Material properties associated with the domain.
    */
@@ -195,10 +492,43 @@ private:
    * Vector of heat sources.
    */
   std::vector<std::shared_ptr<HeatSource<dim>>> _heat_sources;
+  /**
+   * Indices and bounding boxes of the heat sources that are larger than the
+   * cutoff somewhere in the domain at the current time.
+   */
+  std::vector<std::pair<unsigned int, dealii::BoundingBox<dim>>>
+      _heat_source_bounding_boxes;
+  /**
+   * Bounding boxes of the cell batches of the MatrixFree object.
+   */
+  std::vector<dealii::BoundingBox<dim>> _cell_batch_bounding_boxes;
+  /**
+   * Number of consecutive time steps after which a quiet cell batch falls
+   * asleep. Zero disables the sleeping cell batches.
+   */
+  unsigned int _sleep_time_steps = 0;
+  /**
+   * Change of temperature under which a cell batch is quiet.
+   */
+  double _sleep_tolerance = 0.;
+  /**
+   * Number of consecutive time steps during which each cell batch has been
+   * quiet.
+   */
+  std::vector<unsigned int> _cell_batch_quiet_steps;
+  /**
+   * Flag of the cell batches that are skipped by the operator.
+   */
+  std::vector<char> _sleeping_cell_batches;
+  /**
+   * Mean temperature of each cell batch at the beginning of its quiet period.
+   */
+  dealii::AlignedVector<dealii::VectorizedArray<Number>>
+      _cell_batch_reference_temperature;
   /**
    * Underlying MatrixFree object.
    */
-  dealii::MatrixFree<dim, double> _matrix_free;
+  dealii::MatrixFree<dim, Number> _matrix_free;
   /**
    * Non-owning pointer to the AffineConstraints from ThermalPhysics.
    */
@@ -210,6 +540,20 @@ private:
    */
   std::shared_ptr<dealii::LA::distributed::Vector<double, MemorySpaceType>>
       _inverse_mass_matrix;
+  /**
+   * Ranges of face batches at the boundary of the activated domain whose dofs
+   * are all locally owned and unconstrained. The convective and radiative
+   * boundary conditions are only applied on these faces and on the faces of
+   * _ghosted_active_boundary_face_ranges. The ranges are computed in reinit.
+   */
+  std::vector<std::pair<unsigned int, unsigned int>>
+      _active_boundary_face_ranges;
+  /**
+   * Ranges of face batches at the boundary of the activated domain that need
+   * the ghost values of the source vector.
+   */
+  std::vector<std::pair<unsigned int, unsigned int>>
+      _ghosted_active_boundary_face_ranges;
   /**
    * Map between the cell iterator and the position in _inv_rho_cp table.
    */
@@ -220,94 +564,197 @@ private:
    * Table of the powder fraction inside cells; mutable so that it can be
    * changed in cell_local_apply which is const.
    */
-  mutable dealii::Table<2, dealii::VectorizedArray<double>> _liquid_ratio;
+  mutable dealii::Table<2, dealii::VectorizedArray<Number>> _liquid_ratio;
   /**
    * Table of the powder fraction inside cells; mutable so that it can be
    * changed in cell_local_apply which is const.
    */
-  mutable dealii::Table<2, dealii::VectorizedArray<double>> _powder_ratio;
+  mutable dealii::Table<2, dealii::VectorizedArray<Number>> _powder_ratio;
   /**
    * Table of the powder fraction on faces; mutable so that it can be changed in
    * face_local_apply which is const.
    */
-  mutable dealii::Table<2, dealii::VectorizedArray<double>> _face_powder_ratio;
+  mutable dealii::Table<2, dealii::VectorizedArray<Number>> _face_powder_ratio;
   /**
-   * Table of the material index inside cells; mutable so that it can be changed
-   * in cell_local_apply which is const.
+   * Material index of each cell batch. The material is constant inside a cell
+   * so it is stored once per cell batch instead of once per quadrature point.
+   * Mutable so that it can be changed in cell_local_apply which is const.
    */
-  mutable dealii::Table<2, std::array<dealii::types::material_id,
-                                      dealii::VectorizedArray<double>::size()>>
+  mutable std::vector<std::array<dealii::types::material_id,
+                                 dealii::VectorizedArray<Number>::size()>>
       _material_id;
   /**
-   * Table of the material index on faces; mutable so that it can be changed in
+   * Material index of each face batch; mutable so that it can be changed in
    * face_local_apply which is const.
    */
-  mutable dealii::Table<2, std::array<dealii::types::material_id,
-                                      dealii::VectorizedArray<double>::size()>>
+  mutable std::vector<std::array<dealii::types::material_id,
+                                 dealii::VectorizedArray<Number>::size()>>
       _face_material_id;
   /**
-   * Table of the material deposition cosine angles.
+   * Material deposition cosine angle of each cell batch.
+   */
+  dealii::AlignedVector<dealii::VectorizedArray<Number>> _deposition_cos;
+  /**
+   * Material deposition sine angle of each cell batch.
+   */
+  dealii::AlignedVector<dealii::VectorizedArray<Number>> _deposition_sin;
+  /**
+   * Number of independent components of the thermal conductivity tensor: xx
+   * and zz in 2D, xx, xy, yy, and zz in 3D.
+   */
+  static unsigned int constexpr _n_conductivity_components = dim == 2 ? 2 : 4;
+  /**
+   * If the flag is true, the coefficients are saved by vmult and reused by
+   * jacobian_vmult.
+   */
+  bool _frozen_coefficients = false;
+  /**
+   * If the flag is true, the frozen coefficients have been computed at the
+   * current linearization point; mutable so that it can be changed in vmult
+   * which is const.
+   */
+  mutable bool _frozen_coefficients_valid = false;
+  /**
+   * If the flag is true, vmult does not overwrite the frozen coefficients.
+   */
+  bool _frozen_coefficients_held = false;
+  /**
+   * Temperature at which the frozen coefficients were last computed.
+   */
+  mutable dealii::LA::distributed::Vector<double, MemorySpaceType>
+      _linearization_point;
+  /**
+   * If the flag is true, the boundary conditions are included in the Jacobian
+   * with frozen coefficients.
+   */
+  bool _jacobian_boundary_conditions = true;
+  /**
+   * Level from which the cells are advanced with the small time step of the
+   * multirate time stepping.
+   */
+  unsigned int _multirate_level = dealii::numbers::invalid_unsigned_int;
+  /**
+   * Ranges of cell batches whose level is at least _multirate_level. The
+   * ranges are computed in reinit.
+   */
+  std::vector<std::pair<unsigned int, unsigned int>> _fast_cell_batch_ranges;
+  /**
+   * Tables of the components of the thermal conductivity tensor divided by
+   * \f$ \rho C_p \f$ at the linearization point; mutable so that it can be
+   * changed in cell_local_apply which is const.
    */
-  dealii::Table<2, dealii::VectorizedArray<double>> _deposition_cos;
+  mutable std::array<dealii::Table<2, dealii::VectorizedArray<Number>>,
+                     _n_conductivity_components>
+      _frozen_conductivity;
   /**
-   * Table of the material deposition cosine angles.
+   * Table of the sum of the convective and the radiative heat transfer
+   * coefficients divided by \f$ \rho C_p \f$ at the linearization point;
+   * mutable so that it can be changed in face_local_apply which is const.
    */
-  dealii::Table<2, dealii::VectorizedArray<double>> _deposition_sin;
+  mutable dealii::Table<2, dealii::VectorizedArray<Number>>
+      _frozen_heat_transfer_coef;
 };
 
-template <int dim, int fe_degree, typename MemorySpaceType>
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
 inline dealii::types::global_dof_index
-ThermalOperator<dim, fe_degree, MemorySpaceType>::m() const
+ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::m() const
 {
   return _matrix_free.get_vector_partitioner()->size();
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
 inline dealii::types::global_dof_index
-ThermalOperator<dim, fe_degree, MemorySpaceType>::n() const
+ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::n() const
 {
   return _matrix_free.get_vector_partitioner()->size();
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
 inline std::shared_ptr<dealii::LA::distributed::Vector<double, MemorySpaceType>>
-ThermalOperator<dim, fe_degree, MemorySpaceType>::get_inverse_mass_matrix()
-    const
+ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    get_inverse_mass_matrix() const
 {
   return _inverse_mass_matrix;
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-inline dealii::MatrixFree<dim, double> const &
-ThermalOperator<dim, fe_degree, MemorySpaceType>::get_matrix_free() const
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+inline dealii::MatrixFree<dim, Number> const &
+ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    get_matrix_free() const
 {
   return _matrix_free;
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
-inline void ThermalOperator<dim, fe_degree, MemorySpaceType>::jacobian_vmult(
-    dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
-    dealii::LA::distributed::Vector<double, MemorySpaceType> const &src) const
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+inline void
+ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    set_frozen_coefficients(bool frozen_coefficients)
+{
+  _frozen_coefficients = frozen_coefficients;
+  _frozen_coefficients_valid = false;
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+inline void
+ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    hold_frozen_coefficients(bool hold)
+{
+  _frozen_coefficients_held = hold;
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+inline void
+ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    set_jacobian_boundary_conditions(bool boundary_conditions)
 {
-  vmult(dst, src);
+  _jacobian_boundary_conditions = boundary_conditions;
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
 inline void
-ThermalOperator<dim, fe_degree, MemorySpaceType>::initialize_dof_vector(
+ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::set_multirate_level(
+    unsigned int level)
+{
+  _multirate_level = level;
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+inline void
+ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::initialize_dof_vector(
     dealii::LA::distributed::Vector<double, MemorySpaceType> &vector) const
 {
   _matrix_free.initialize_dof_vector(vector);
 }
 
-template <int dim, int fe_degree, typename MemorySpaceType>
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
 inline void
-ThermalOperator<dim, fe_degree, MemorySpaceType>::set_time_and_source_height(
-    double t, double height)
+ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    set_time_and_source_height(double t, double height)
 {
   _current_source_height = height;
   for (auto &beam : _heat_sources)
     beam->update_time(t);
+  update_heat_source_bounding_boxes();
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+inline void
+ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::set_sleep_parameters(
+    unsigned int time_steps, double tolerance)
+{
+  _sleep_time_steps = time_steps;
+  _sleep_tolerance = tolerance;
+  _cell_batch_quiet_steps.clear();
+  _sleeping_cell_batches.clear();
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType, typename Number>
+inline void
+ThermalOperator<dim, fe_degree, MemorySpaceType, Number>::
+    set_heat_source_cutoff(double cutoff)
+{
+  _heat_source_cutoff = cutoff;
+  update_heat_source_bounding_boxes();
 }
 } // namespace adamantine
 
@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2022, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -13,6 +13,8 @@
 #include <deal.II/dofs/dof_handler.h>
 #include <deal.II/hp/q_collection.h>
 #include <deal.II/lac/affine_constraints.h>
+#include <deal.II/lac/trilinos_sparse_matrix.h>
+#include <deal.II/lac/vector.h>
 
 namespace adamantine
 {
@@ -52,6 +54,75 @@ public:
       std::vector<double> const &deposition_sin) = 0;
 
   virtual void set_time_and_source_height(double, double) = 0;
+
+  virtual void set_frozen_coefficients(bool frozen_coefficients) = 0;
+
+  virtual void hold_frozen_coefficients(bool hold) = 0;
+
+  virtual void set_jacobian_boundary_conditions(bool boundary_conditions) = 0;
+
+  virtual void set_multirate_level(unsigned int level) = 0;
+
+  /**
+   * Compute \f$ dst = A_f src \f$ where \f$ A_f \f$ only contains the
+   * contributions of the cells whose level is at least the multirate level and
+   * of the boundary conditions. @p dst does not need to be initialized to zero.
+   */
+  virtual void fast_cells_vmult(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const &src)
+      const = 0;
+
+  virtual void set_heat_source_cutoff(double cutoff) = 0;
+
+  /**
+   * Skip the cell batches whose temperature has changed by less than
+   * @p tolerance during @p time_steps consecutive time steps. If @p time_steps
+   * is zero, every cell batch is evaluated.
+   */
+  virtual void set_sleep_parameters(unsigned int time_steps,
+                                    double tolerance) = 0;
+
+  /**
+   * Update the list of the sleeping cell batches given the @p temperature at
+   * the end of a time step.
+   */
+  virtual void update_sleeping_cell_batches(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const
+          &temperature) = 0;
+
+  /**
+   * Compute \f$ dst = M^{-1} A src \f$ where \f$ M \f$ is the mass matrix
+   * and \f$ A \f$ the operator applied by vmult. @p dst does not need to be
+   * initialized to zero.
+   */
+  virtual void inverse_mass_vmult(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const &src)
+      const = 0;
+
+  virtual void compute_jacobian_diagonal(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &diagonal)
+      const = 0;
+
+  virtual void compute_jacobian_matrix(
+      dealii::TrilinosWrappers::SparseMatrix &matrix) const = 0;
+
+  /**
+   * Compute the refinement indicator \f$ h_K \|\nabla T\|_{L^2(K)} \f$ of
+   * the cells with material. The @p indicator is indexed by the active cell
+   * index and it is zero on the other cells.
+   */
+  virtual void compute_gradient_indicator(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const
+          &temperature,
+      dealii::Vector<float> &indicator) const = 0;
+
+  /**
+   * Return an estimate of the number of bytes used by the MatrixFree object,
+   * the coefficient tables, and the inverse of the mass matrix.
+   */
+  virtual std::size_t memory_consumption() const = 0;
 };
 } // namespace adamantine
 #endif
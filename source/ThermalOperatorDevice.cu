@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2022, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -6,16 +6,49 @@
  */
 
 #include "MaterialProperty.hh"
+#include <HeatSourceData.hh>
 #include <MemoryBlockView.hh>
 #include <ThermalOperatorDevice.hh>
 #include <instantiation.hh>
 #include <types.hh>
 
 #include <deal.II/base/cuda_size.h>
+#include <deal.II/grid/filtered_iterator.h>
 #include <deal.II/matrix_free/cuda_fe_evaluation.h>
 
+#ifdef DEAL_II_MPI_WITH_CUDA_SUPPORT
+#if __has_include(<mpi-ext.h>)
+#include <mpi-ext.h>
+#endif
+#endif
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef ADAMANTINE_WITH_CALIPER
+#include <caliper/cali.h>
+#endif
+
 namespace
 {
+/**
+ * Return true if MPI can communicate data that lives on the device. deal.II
+ * needs to be configured with GPU-aware MPI. When the MPI library can be
+ * queried at runtime, we also check that the support is enabled.
+ */
+bool gpu_aware_mpi()
+{
+#ifdef DEAL_II_MPI_WITH_CUDA_SUPPORT
+#if defined(MPIX_CUDA_AWARE_SUPPORT) && MPIX_CUDA_AWARE_SUPPORT
+  return MPIX_Query_cuda_support() == 1;
+#else
+  return true;
+#endif
+#else
+  return false;
+#endif
+}
+
 __global__ void invert_mass_matrix(double *values, unsigned int size)
 {
   unsigned int i = threadIdx.x + blockIdx.x * blockDim.x;
@@ -83,11 +116,11 @@ public:
   __device__ ThermalOperatorQuad(double inv_rho_cp, double cos, double sin,
                                  double thermal_conductivity_x,
                                  double thermal_conductivity_y,
-                                 double thermal_conductivity_z)
+                                 double thermal_conductivity_z, double source)
       : _inv_rho_cp(inv_rho_cp), _cos(cos), _sin(sin),
         _thermal_conductivity_x(thermal_conductivity_x),
         _thermal_conductivity_y(thermal_conductivity_y),
-        _thermal_conductivity_z(thermal_conductivity_z)
+        _thermal_conductivity_z(thermal_conductivity_z), _source(source)
   {
   }
 
@@ -101,6 +134,7 @@ private:
   double _thermal_conductivity_x;
   double _thermal_conductivity_y;
   double _thermal_conductivity_z;
+  double _source;
 };
 
 template <int dim, int fe_degree>
@@ -148,6 +182,48 @@ __device__ void ThermalOperatorQuad<dim, fe_degree>::operator()(
   }
 
   fe_eval->submit_gradient(-_inv_rho_cp * th_conductivity_grad);
+  fe_eval->submit_value(_inv_rho_cp * _source);
+}
+
+template <int dim, int fe_degree>
+class LocalGradientIndicatorDevice
+{
+public:
+  LocalGradientIndicatorDevice(double *indicator) : _indicator(indicator) {}
+
+  __device__ void
+  operator()(unsigned int const cell,
+             typename dealii::CUDAWrappers::MatrixFree<dim, double>::Data const
+                 *gpu_data,
+             dealii::CUDAWrappers::SharedData<dim, double> *shared_data,
+             double const *src, double *dst) const;
+
+  static const unsigned int n_dofs_1d = fe_degree + 1;
+  static const unsigned int n_local_dofs =
+      dealii::Utilities::pow(fe_degree + 1, dim);
+  static const unsigned int n_q_points =
+      dealii::Utilities::pow(fe_degree + 1, dim);
+
+private:
+  double *_indicator;
+};
+
+template <int dim, int fe_degree>
+__device__ void LocalGradientIndicatorDevice<dim, fe_degree>::operator()(
+    unsigned int const cell,
+    typename dealii::CUDAWrappers::MatrixFree<dim, double>::Data const
+        *gpu_data,
+    dealii::CUDAWrappers::SharedData<dim, double> *shared_data,
+    double const *src, double * /*dst*/) const
+{
+  unsigned int const pos = dealii::CUDAWrappers::local_q_point_id<dim, double>(
+      cell, gpu_data, n_dofs_1d, n_q_points);
+  dealii::CUDAWrappers::FEEvaluation<dim, fe_degree, fe_degree + 1, 1, double>
+      fe_eval(cell, gpu_data, shared_data);
+  fe_eval.read_dof_values(src);
+  fe_eval.evaluate(/*values*/ false, /*gradients*/ true);
+  auto const gradient = fe_eval.get_gradient();
+  _indicator[pos] = (gradient * gradient) * gpu_data->JxW[pos];
 }
 
 template <int dim, int fe_degree>
@@ -169,14 +245,26 @@ public:
       adamantine::MemoryBlockView<double, dealii::MemorySpace::CUDA>
           state_property_tables_view,
       adamantine::MemoryBlockView<double, dealii::MemorySpace::CUDA>
-          state_property_polynomials_view)
+          state_property_polynomials_view,
+      adamantine::MemoryBlockView<adamantine::HeatSourceData<dim>,
+                                  dealii::MemorySpace::CUDA>
+          heat_source_data_view,
+      double current_source_height,
+      adamantine::MemoryBlockView<double, dealii::MemorySpace::CUDA>
+          cell_geometry_view,
+      adamantine::MemoryBlockView<double, dealii::MemorySpace::CUDA>
+          unit_q_points_view)
       : _use_table(use_table), _polynomial_order(polynomial_order), _cos(cos),
         _sin(sin), _powder_ratio_view(powder_ratio_view),
         _liquid_ratio_view(liquid_ratio_view),
         _material_id_view(material_id_view), _inv_rho_cp_view(inv_rho_cp_view),
         _properties_view(properties_view),
         _state_property_tables_view(state_property_tables_view),
-        _state_property_polynomials_view(state_property_polynomials_view)
+        _state_property_polynomials_view(state_property_polynomials_view),
+        _heat_source_data_view(heat_source_data_view),
+        _current_source_height(current_source_height),
+        _cell_geometry_view(cell_geometry_view),
+        _unit_q_points_view(unit_q_points_view)
   {
   }
 
@@ -192,6 +280,17 @@ public:
   __device__ double get_inv_rho_cp(unsigned int pos, double *state_ratios,
                                    double temperature) const;
 
+  __device__ double compute_source(
+      typename dealii::CUDAWrappers::MatrixFree<dim, double>::point_type const
+          &q_point) const;
+
+  /**
+   * Return the quadrature point @p pos of an axis-aligned cell computed from
+   * the lower corner and the size of the cell.
+   */
+  __device__ typename dealii::CUDAWrappers::MatrixFree<dim, double>::point_type
+  get_cartesian_quadrature_point(unsigned int pos) const;
+
   __device__ void
   operator()(unsigned int const cell,
              typename dealii::CUDAWrappers::MatrixFree<dim, double>::Data const
@@ -226,6 +325,18 @@ private:
       _state_property_tables_view;
   adamantine::MemoryBlockView<double, dealii::MemorySpace::CUDA>
       _state_property_polynomials_view;
+  adamantine::MemoryBlockView<adamantine::HeatSourceData<dim>,
+                              dealii::MemorySpace::CUDA>
+      _heat_source_data_view;
+  double _current_source_height;
+  /**
+   * Lower corner and size of the cells when the quadrature points are not
+   * stored by MatrixFree. The view is empty otherwise.
+   */
+  adamantine::MemoryBlockView<double, dealii::MemorySpace::CUDA>
+      _cell_geometry_view;
+  adamantine::MemoryBlockView<double, dealii::MemorySpace::CUDA>
+      _unit_q_points_view;
 };
 
 template <int dim, int fe_degree>
@@ -300,18 +411,18 @@ LocalThermalOperatorDevice<dim, fe_degree>::compute_material_property(
   }
   else
   {
-    for (unsigned int material_state = 0; material_state < _n_material_states;
-         ++material_state)
+    // Evaluate the polynomial of the mix of states using Horner's method.
+    for (int i = _polynomial_order; i >= 0; --i)
     {
-      dealii::types::material_id m_id = material_id;
-
-      for (unsigned int i = 0; i <= _polynomial_order; ++i)
+      double coef = 0.;
+      for (unsigned int material_state = 0; material_state < _n_material_states;
+           ++material_state)
       {
-        value += state_ratios[material_state] *
-                 _state_property_polynomials_view(m_id, material_state,
-                                                  property_index, i) *
-                 std::pow(temperature, i);
+        coef += state_ratios[material_state] *
+                _state_property_polynomials_view(material_id, material_state,
+                                                 property_index, i);
       }
+      value = value * temperature + coef;
     }
   }
 
@@ -358,6 +469,45 @@ __device__ double LocalThermalOperatorDevice<dim, fe_degree>::get_inv_rho_cp(
   return _inv_rho_cp_view(pos);
 }
 
+template <int dim, int fe_degree>
+__device__ double LocalThermalOperatorDevice<dim, fe_degree>::compute_source(
+    typename dealii::CUDAWrappers::MatrixFree<dim, double>::point_type const
+        &q_point) const
+{
+  double point[dim];
+  for (unsigned int d = 0; d < dim; ++d)
+    point[d] = q_point[d];
+
+  double source = 0.;
+  unsigned int const n_heat_sources = _heat_source_data_view.size();
+  for (unsigned int i = 0; i < n_heat_sources; ++i)
+    source += adamantine::compute_heat_source(_heat_source_data_view(i), point,
+                                              _current_source_height);
+
+  return source;
+}
+
+template <int dim, int fe_degree>
+__device__ typename dealii::CUDAWrappers::MatrixFree<dim, double>::point_type
+LocalThermalOperatorDevice<dim, fe_degree>::get_cartesian_quadrature_point(
+    unsigned int pos) const
+{
+  // The quadrature points of a cell are stored contiguously and the index of a
+  // point in the cell follows the tensor product structure.
+  unsigned int const cell = pos / n_q_points;
+  unsigned int q = pos % n_q_points;
+  typename dealii::CUDAWrappers::MatrixFree<dim, double>::point_type q_point;
+  for (unsigned int d = 0; d < dim; ++d)
+  {
+    q_point[d] = _cell_geometry_view(cell, d) +
+                 _cell_geometry_view(cell, dim + d) *
+                     _unit_q_points_view(q % n_dofs_1d);
+    q /= n_dofs_1d;
+  }
+
+  return q_point;
+}
+
 template <int dim, int fe_degree>
 __device__ void LocalThermalOperatorDevice<dim, fe_degree>::operator()(
     unsigned int const cell,
@@ -389,11 +539,18 @@ __device__ void LocalThermalOperatorDevice<dim, fe_degree>::operator()(
       adamantine::StateProperty::thermal_conductivity_z, material_id,
       state_ratios, temperature);
 
+  double const source =
+      _cell_geometry_view.size() > 0
+          ? compute_source(get_cartesian_quadrature_point(pos))
+          : compute_source(
+                dealii::CUDAWrappers::get_quadrature_point<dim, double>(
+                    cell, gpu_data, n_dofs_1d));
+
   fe_eval.apply_for_each_quad_point(ThermalOperatorQuad<dim, fe_degree>(
       inv_rho_cp, _cos[pos], _sin[pos], thermal_conductivity_x,
-      thermal_conductivity_y, thermal_conductivity_z));
+      thermal_conductivity_y, thermal_conductivity_z, source));
 
-  fe_eval.integrate(/*values*/ false, /*gradients*/ true);
+  fe_eval.integrate(/*values*/ true, /*gradients*/ true);
   fe_eval.distribute_local_to_global(dst);
 }
 } // namespace
@@ -403,15 +560,33 @@ namespace adamantine
 template <int dim, int fe_degree, typename MemorySpaceType>
 ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::ThermalOperatorDevice(
     MPI_Comm const &communicator, BoundaryType boundary_type,
-    MaterialProperty<dim, MemorySpaceType> &material_properties)
+    MaterialProperty<dim, MemorySpaceType> &material_properties,
+    std::vector<std::shared_ptr<HeatSource<dim>>> const &heat_sources,
+    bool overlap_communication)
     : _communicator(communicator), _boundary_type(boundary_type), _m(0),
       _n_owned_cells(0), _material_properties(material_properties),
+      _heat_sources(heat_sources),
       _inverse_mass_matrix(
           new dealii::LA::distributed::Vector<double, MemorySpaceType>())
 {
-  _matrix_free_data.mapping_update_flags = dealii::update_gradients |
-                                           dealii::update_JxW_values |
-                                           dealii::update_quadrature_points;
+  // The cells are split in batches that do not need the ghost values, that are
+  // applied while the ghost values are exchanged, and batches that do. This
+  // requires MPI to work directly on the device buffers.
+  _matrix_free_data.overlap_communication_computation =
+      overlap_communication &&
+      (dealii::Utilities::MPI::n_mpi_processes(communicator) > 1) &&
+      gpu_aware_mpi();
+  AssertCuda(cudaEventCreateWithFlags(&_heat_source_copy_event,
+                                      cudaEventDisableTiming));
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType>
+ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::~ThermalOperatorDevice()
+{
+  cudaEventSynchronize(_heat_source_copy_event);
+  if (_heat_source_data_host != nullptr)
+    cudaFreeHost(_heat_source_data_host);
+  cudaEventDestroy(_heat_source_copy_event);
 }
 
 template <int dim, int fe_degree, typename MemorySpaceType>
@@ -420,6 +595,38 @@ void ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::reinit(
     dealii::AffineConstraints<double> const &affine_constraints,
     dealii::hp::QCollection<1> const &q_collection)
 {
+  // When every cell is an axis-aligned box, which is the case of the meshes
+  // built by Geometry, the quadrature points are not stored by MatrixFree.
+  // They are computed in the kernel from the lower corner and the size of the
+  // cell, which only needs 2 * dim numbers per cell instead of dim numbers per
+  // quadrature point. The vertices also need to be in the lexicographic order
+  // of the box, i.e., the first vertex is the lower corner, for the quadrature
+  // points to be in the same order as the ones of MatrixFree.
+  bool cartesian_mesh = true;
+  for (auto const &cell : dealii::filter_iterators(
+           dof_handler.active_cell_iterators(),
+           dealii::IteratorFilters::LocallyOwnedCell(),
+           dealii::IteratorFilters::ActiveFEIndexEqualTo(0)))
+  {
+    dealii::BoundingBox<dim> const box = cell->bounding_box();
+    double const tolerance = 1e-12 * cell->diameter();
+    for (unsigned int v = 0; v < cell->n_vertices(); ++v)
+      for (unsigned int d = 0; d < dim; ++d)
+      {
+        double const corner =
+            ((v >> d) & 1) == 0 ? box.lower_bound(d) : box.upper_bound(d);
+        if (std::abs(cell->vertex(v)[d] - corner) > tolerance)
+          cartesian_mesh = false;
+      }
+    if (!cartesian_mesh)
+      break;
+  }
+  _matrix_free_data.mapping_update_flags =
+      dealii::update_values | dealii::update_gradients |
+      dealii::update_JxW_values;
+  if (!cartesian_mesh)
+    _matrix_free_data.mapping_update_flags |= dealii::update_quadrature_points;
+
   dealii::IteratorFilters::ActiveFEIndexEqualTo filter(0, true);
   // deal.II does not support QCollection on GPU
   _matrix_free.reinit(dealii::StaticMappingQ1<dim>::mapping, dof_handler,
@@ -436,6 +643,7 @@ void ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::reinit(
   // Compute the mapping between DoFHandler cells and the access position in
   // MatrixFree
   _cell_it_to_mf_pos.clear();
+  _material_properties.clear_state_device_mapping();
   unsigned int constexpr n_dofs_1d = fe_degree + 1;
   unsigned int constexpr n_q_points_per_cell =
       dealii::Utilities::pow(n_dofs_1d, dim);
@@ -463,6 +671,35 @@ void ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::reinit(
       _cell_it_to_mf_pos[cell] = quad_pos;
     }
   }
+
+  _cell_geometry.clear();
+  _unit_q_points.clear();
+  if (cartesian_mesh && !_cell_it_to_mf_pos.empty())
+  {
+    unsigned int n_cells = 0;
+    for (auto const &[cell, quad_pos] : _cell_it_to_mf_pos)
+      n_cells = std::max(n_cells, quad_pos[0] / n_q_points_per_cell + 1);
+    MemoryBlock<double, dealii::MemorySpace::Host> cell_geometry_host(
+        n_cells, 2 * dim);
+    MemoryBlockView<double, dealii::MemorySpace::Host> cell_geometry_view(
+        cell_geometry_host);
+    for (auto const &[cell, quad_pos] : _cell_it_to_mf_pos)
+    {
+      unsigned int const i = quad_pos[0] / n_q_points_per_cell;
+      dealii::BoundingBox<dim> const box = cell->bounding_box();
+      for (unsigned int d = 0; d < dim; ++d)
+      {
+        cell_geometry_view(i, d) = box.lower_bound(d);
+        cell_geometry_view(i, dim + d) = box.side_length(d);
+      }
+    }
+    _cell_geometry.reinit(cell_geometry_host);
+
+    std::vector<double> unit_q_points(n_dofs_1d);
+    for (unsigned int q = 0; q < n_dofs_1d; ++q)
+      unit_q_points[q] = q_collection[0].point(q)[0];
+    _unit_q_points.reinit(unit_q_points);
+  }
 }
 
 template <int dim, int fe_degree, typename MemorySpaceType>
@@ -538,13 +775,30 @@ void ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::vmult_add(
 
   LocalThermalOperatorDevice<dim, fe_degree> local_operator(
       _material_properties.properties_use_table(),
-      _material_properties.polynomial_order, _deposition_cos.get_values(),
-      _deposition_sin.get_values(), powder_ratio_view, liquid_ratio_view,
+      _material_properties.polynomial_order, _deposition_cos.data(),
+      _deposition_sin.data(), powder_ratio_view, liquid_ratio_view,
       material_id_view, _inv_rho_cp, _material_properties.get_properties(),
       _material_properties.get_state_property_tables(),
-      _material_properties.get_state_property_polynomials());
+      _material_properties.get_state_property_polynomials(),
+      MemoryBlockView<HeatSourceData<dim>, dealii::MemorySpace::CUDA>(
+          _heat_source_data),
+      _current_source_height,
+      MemoryBlockView<double, dealii::MemorySpace::CUDA>(_cell_geometry),
+      MemoryBlockView<double, dealii::MemorySpace::CUDA>(_unit_q_points));
+  // The kernels are launched asynchronously. The CUDA kernels appear in the
+  // NVTX ranges when Caliper forwards the regions to NVTX.
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_BEGIN("thermal_cell_loop");
+#endif
   _matrix_free.cell_loop(local_operator, src, dst);
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_END("thermal_cell_loop");
+  CALI_MARK_BEGIN("thermal_constraints");
+#endif
   _matrix_free.copy_constrained_values(src, dst);
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_END("thermal_constraints");
+#endif
 }
 
 template <int dim, int fe_degree, typename MemorySpaceType>
@@ -640,10 +894,12 @@ void ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::
 {
   unsigned int const n_coefs =
       dealii::Utilities::pow(fe_degree + 1, dim) * _n_owned_cells;
-  _deposition_cos.reinit(n_coefs);
-  _deposition_sin.reinit(n_coefs);
-  dealii::LA::ReadWriteVector<double> deposition_cos_host(n_coefs);
-  dealii::LA::ReadWriteVector<double> deposition_sin_host(n_coefs);
+  MemoryBlock<double, dealii::MemorySpace::Host> deposition_cos_host(n_coefs);
+  MemoryBlock<double, dealii::MemorySpace::Host> deposition_sin_host(n_coefs);
+  MemoryBlockView<double, dealii::MemorySpace::Host> deposition_cos_host_view(
+      deposition_cos_host);
+  MemoryBlockView<double, dealii::MemorySpace::Host> deposition_sin_host_view(
+      deposition_sin_host);
 
   unsigned int constexpr n_dofs_1d = fe_degree + 1;
   unsigned int constexpr n_q_points_per_cell =
@@ -659,53 +915,115 @@ void ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::
     for (unsigned int i = 0; i < n_q_points_per_cell; ++i)
     {
       unsigned int const pos = _cell_it_to_mf_pos[cell][i];
-      deposition_cos_host[pos] = cos;
-      deposition_sin_host[pos] = sin;
+      deposition_cos_host_view(pos) = cos;
+      deposition_sin_host_view(pos) = sin;
     }
     ++local_cell_id;
   }
 
-  // Copy the coefficient to the host
-  _deposition_cos.import(deposition_cos_host, dealii::VectorOperation::insert);
-  _deposition_sin.import(deposition_sin_host, dealii::VectorOperation::insert);
+  // Move data to the device. The memory on the device is reused if it is large
+  // enough.
+  _deposition_cos.reinit(deposition_cos_host);
+  _deposition_sin.reinit(deposition_sin_host);
 }
 
 template <int dim, int fe_degree, typename MemorySpaceType>
-void ThermalOperatorDevice<dim, fe_degree,
-                           MemorySpaceType>::update_inv_rho_cp_cell()
+void ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::
+    set_time_and_source_height(double t, double height)
 {
-  MemoryBlock<double, dealii::MemorySpace::Host> inv_rho_cp_host(_inv_rho_cp);
-  MemoryBlockView<double, dealii::MemorySpace::Host> inv_rho_cp_host_view(
-      inv_rho_cp_host);
-  unsigned int constexpr n_dofs_1d = fe_degree + 1;
-  unsigned int constexpr n_q_points_per_cell =
-      dealii::Utilities::pow(n_dofs_1d, dim);
-  auto graph = _matrix_free.get_colored_graph();
-  unsigned int const n_colors = graph.size();
-  for (unsigned int color = 0; color < n_colors; ++color)
+  _current_source_height = height;
+  std::vector<HeatSourceData<dim>> heat_source_data;
+  heat_source_data.reserve(_heat_sources.size());
+  for (auto &beam : _heat_sources)
   {
-    typename dealii::CUDAWrappers::MatrixFree<dim, double>::Data gpu_data =
-        _matrix_free.get_data(color);
-    unsigned int const n_cells = gpu_data.n_cells;
-    auto gpu_data_host =
-        dealii::CUDAWrappers::copy_mf_data_to_host<dim, double>(
-            gpu_data, _matrix_free_data.mapping_update_flags);
-    for (unsigned int cell_id = 0; cell_id < n_cells; ++cell_id)
-    {
-      auto cell = graph[color][cell_id];
-      // Need to compute the average
-      double cell_inv_rho_cp = 0.;
-      for (unsigned int i = 0; i < n_q_points_per_cell; ++i)
-      {
-        unsigned int const pos = _cell_it_to_mf_pos[cell][i];
-        cell_inv_rho_cp += inv_rho_cp_host_view(pos);
-      }
-      cell_inv_rho_cp /= n_q_points_per_cell;
+    beam->update_time(t);
+    heat_source_data.push_back(beam->get_data());
+  }
 
-      _inv_rho_cp_cells[cell] = cell_inv_rho_cp;
-    }
+  // The description of the beams is small, so we copy it to the device every
+  // time it changes and reuse the allocation when possible. The copy goes
+  // through a pinned buffer so that it is queued after the kernels that have
+  // already been launched instead of waiting for them to finish. We only wait
+  // for the previous copy before overwriting the buffer.
+  unsigned int const n_sources = heat_source_data.size();
+  AssertCuda(cudaEventSynchronize(_heat_source_copy_event));
+  if (_heat_source_data.size() != n_sources)
+  {
+    _heat_source_data.reinit(n_sources);
+    if (_heat_source_data_host != nullptr)
+      AssertCuda(cudaFreeHost(_heat_source_data_host));
+    AssertCuda(
+        cudaMallocHost(reinterpret_cast<void **>(&_heat_source_data_host),
+                       n_sources * sizeof(HeatSourceData<dim>)));
+  }
+  std::copy(heat_source_data.begin(), heat_source_data.end(),
+            _heat_source_data_host);
+  AssertCuda(cudaMemcpyAsync(_heat_source_data.data(), _heat_source_data_host,
+                             n_sources * sizeof(HeatSourceData<dim>),
+                             cudaMemcpyHostToDevice, 0));
+  AssertCuda(cudaEventRecord(_heat_source_copy_event, 0));
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType>
+void ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::
+    compute_gradient_indicator(
+        dealii::LA::distributed::Vector<double, MemorySpaceType> const
+            &temperature,
+        dealii::Vector<float> &indicator) const
+{
+  indicator.reinit(
+      _matrix_free.get_dof_handler().get_triangulation().n_active_cells());
+  if (_cell_it_to_mf_pos.empty())
+    return;
+
+  // Each thread computes the contribution of its quadrature point. Only these
+  // values are copied to the host, not the temperature.
+  unsigned int n_q_points = 0;
+  for (auto const &[cell, positions] : _cell_it_to_mf_pos)
+    n_q_points = std::max(n_q_points, positions.back() + 1);
+  MemoryBlock<double, dealii::MemorySpace::CUDA> indicator_q_points(
+      n_q_points);
+  indicator_q_points.set_zero();
+  LocalGradientIndicatorDevice<dim, fe_degree> local_operator(
+      indicator_q_points.data());
+  dealii::LA::distributed::Vector<double, MemorySpaceType> dummy;
+  _matrix_free.initialize_dof_vector(dummy);
+  _matrix_free.cell_loop(local_operator, temperature, dummy);
+
+  MemoryBlock<double, dealii::MemorySpace::Host> indicator_q_points_host(
+      indicator_q_points);
+  MemoryBlockView<double, dealii::MemorySpace::Host> indicator_q_points_view(
+      indicator_q_points_host);
+  for (auto const &[cell, positions] : _cell_it_to_mf_pos)
+  {
+    double gradient_norm_square = 0.;
+    for (auto const pos : positions)
+      gradient_norm_square += indicator_q_points_view(pos);
+    indicator[cell->active_cell_index()] =
+        cell->diameter() * std::sqrt(gradient_norm_square);
   }
 }
+
+template <int dim, int fe_degree, typename MemorySpaceType>
+std::size_t
+ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::memory_consumption()
+    const
+{
+  std::size_t size =
+      _matrix_free.memory_consumption() + _liquid_ratio.memory_consumption() +
+      _powder_ratio.memory_consumption() + _material_id.memory_consumption() +
+      _inv_rho_cp.memory_consumption() + _deposition_cos.memory_consumption() +
+      _deposition_sin.memory_consumption() +
+      _heat_source_data.memory_consumption() +
+      _cell_geometry.memory_consumption() +
+      _unit_q_points.memory_consumption();
+  for (auto const &[cell, positions] : _cell_it_to_mf_pos)
+    size += sizeof(cell) + positions.capacity() * sizeof(unsigned int);
+  if (_inverse_mass_matrix)
+    size += _inverse_mass_matrix->memory_consumption();
+
+  return size;
+}
 } // namespace adamantine
 
 // Instantiate class. Note that boost macro does not play well with nvcc so
@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2022, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -8,10 +8,10 @@
 #ifndef THERMAL_OPERATOR_DEVICE_HH
 #define THERMAL_OPERATOR_DEVIcE_HH
 
+#include <HeatSource.hh>
 #include <MaterialProperty.hh>
 #include <ThermalOperatorBase.hh>
 
-#include <deal.II/lac/cuda_vector.h>
 #include <deal.II/matrix_free/cuda_matrix_free.h>
 
 namespace adamantine
@@ -21,9 +21,18 @@ class ThermalOperatorDevice final
     : public ThermalOperatorBase<dim, MemorySpaceType>
 {
 public:
+  /**
+   * Constructor. If @p overlap_communication is true and MPI is GPU-aware, the
+   * exchange of the ghost values is overlapped with the work on the cells that
+   * do not need them.
+   */
   ThermalOperatorDevice(
       MPI_Comm const &communicator, BoundaryType boundary_type,
-      MaterialProperty<dim, MemorySpaceType> &material_properties);
+      MaterialProperty<dim, MemorySpaceType> &material_properties,
+      std::vector<std::shared_ptr<HeatSource<dim>>> const &heat_sources,
+      bool overlap_communication = true);
+
+  ~ThermalOperatorDevice() override;
 
   void reinit(dealii::DoFHandler<dim> const &dof_handler,
               dealii::AffineConstraints<double> const &affine_constraints,
@@ -62,6 +71,15 @@ public:
                  dealii::LA::distributed::Vector<double, MemorySpaceType> const
                      &src) const override;
 
+  /**
+   * Compute \f$ dst = M^{-1} A src \f$ by calling vmult and scaling the
+   * result by the inverse of the mass matrix.
+   */
+  void inverse_mass_vmult(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const &src)
+      const override;
+
   std::shared_ptr<dealii::LA::distributed::Vector<double, MemorySpaceType>>
   get_inverse_mass_matrix() const override;
 
@@ -78,30 +96,93 @@ public:
 
   /**
    * Set the deposition cosine and sine angles and convert the data from
-   * std::vector to dealii::LinearAlgebra::CUDAWrappers::Vector<double>
+   * std::vector to MemoryBlock on the device.
    */
   void set_material_deposition_orientation(
       std::vector<double> const &deposition_cos,
       std::vector<double> const &deposition_sin);
 
-  void set_time_and_source_height(double, double) override
-  {
-    // TODO
-  }
+  /**
+   * Update the heat sources to time @p t and copy their description to the
+   * device. The heat sources are then evaluated directly at the quadrature
+   * points in vmult.
+   */
+  void set_time_and_source_height(double t, double height) override;
+
+  /**
+   * The frozen coefficient mode is not supported on the device. This function
+   * throws if @p frozen_coefficients is true.
+   */
+  void set_frozen_coefficients(bool frozen_coefficients) override;
+
+  /**
+   * The frozen coefficient mode is not supported on the device, so this
+   * function does nothing.
+   */
+  void hold_frozen_coefficients(bool hold) override;
+
+  /**
+   * The Jacobian is applied by vmult on the device, so this function does
+   * nothing.
+   */
+  void set_jacobian_boundary_conditions(bool boundary_conditions) override;
+
+  /**
+   * The multirate time stepping is not supported on the device. This function
+   * throws if @p level is not dealii::numbers::invalid_unsigned_int.
+   */
+  void set_multirate_level(unsigned int level) override;
+
+  /**
+   * Not implemented on the device.
+   */
+  void fast_cells_vmult(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const &src)
+      const override;
 
   /**
-   * Update \f$ \frac{1}{\rho C_p} \f$ on the cells using the values computed at
-   * the quadrature points.
+   * The heat sources are evaluated at every quadrature point on the device,
+   * so the cutoff is ignored.
    */
-  void update_inv_rho_cp_cell();
+  void set_heat_source_cutoff(double cutoff) override;
 
   /**
-   * Return the value of \f$ \frac{1}{\rho C_p} \f$ for a given cell and
-   * quadrature point.
+   * The sleeping cell batches are not supported on the device. @p time_steps
+   * must be zero.
    */
-  double
-  get_inv_rho_cp(typename dealii::DoFHandler<dim>::cell_iterator const &cell,
-                 unsigned int q) const;
+  void set_sleep_parameters(unsigned int time_steps, double tolerance) override;
+
+  /**
+   * Do nothing, every cell is evaluated on the device.
+   */
+  void update_sleeping_cell_batches(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const
+          &temperature) override;
+
+  /**
+   * Not implemented on the device.
+   */
+  void compute_jacobian_diagonal(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &diagonal)
+      const override;
+
+  /**
+   * Not implemented on the device.
+   */
+  void compute_jacobian_matrix(
+      dealii::TrilinosWrappers::SparseMatrix &matrix) const override;
+
+  /**
+   * The contributions of the quadrature points are computed on the device and
+   * summed on the host.
+   */
+  void compute_gradient_indicator(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const
+          &temperature,
+      dealii::Vector<float> &indicator) const override;
+
+  std::size_t memory_consumption() const override;
 
 private:
   /**
@@ -112,6 +193,10 @@ private:
    * Type of boundary.
    */
   BoundaryType _boundary_type;
+  /**
+   * Current height of the heat sources.
+   */
+  double _current_source_height = 0.;
   dealii::types::global_dof_index _m;
   unsigned int _n_owned_cells;
   typename dealii::CUDAWrappers::MatrixFree<dim, double>::AdditionalData
@@ -120,20 +205,47 @@ private:
    * Material properties associated with the domain.
    */
   MaterialProperty<dim, MemorySpaceType> &_material_properties;
+  /**
+   * Vector of heat sources.
+   */
+  std::vector<std::shared_ptr<HeatSource<dim>>> _heat_sources;
+  /**
+   * Description of the heat sources at the current time on the device.
+   */
+  MemoryBlock<HeatSourceData<dim>, dealii::MemorySpace::CUDA>
+      _heat_source_data;
+  /**
+   * Pinned buffer on the host used to copy the description of the heat
+   * sources to the device asynchronously.
+   */
+  HeatSourceData<dim> *_heat_source_data_host = nullptr;
+  /**
+   * Event recorded after the copy of _heat_source_data_host to the device.
+   */
+  cudaEvent_t _heat_source_copy_event;
   dealii::CUDAWrappers::MatrixFree<dim, double> _matrix_free;
   MemoryBlock<double, dealii::MemorySpace::CUDA> _liquid_ratio;
   MemoryBlock<double, dealii::MemorySpace::CUDA> _powder_ratio;
   MemoryBlock<double, dealii::MemorySpace::CUDA> _material_id;
   MemoryBlock<double, dealii::MemorySpace::CUDA> _inv_rho_cp;
-  dealii::LinearAlgebra::CUDAWrappers::Vector<double> _deposition_cos;
-  dealii::LinearAlgebra::CUDAWrappers::Vector<double> _deposition_sin;
+  MemoryBlock<double, dealii::MemorySpace::CUDA> _deposition_cos;
+  MemoryBlock<double, dealii::MemorySpace::CUDA> _deposition_sin;
+  /**
+   * Lower corner and size of the cells used to compute the quadrature points
+   * when the mesh is made of axis-aligned cells. The index of a cell is its
+   * first quadrature point position in MatrixFree divided by the number of
+   * quadrature points per cell.
+   */
+  MemoryBlock<double, dealii::MemorySpace::CUDA> _cell_geometry;
+  /**
+   * Coordinates of the quadrature points on the unit interval.
+   */
+  MemoryBlock<double, dealii::MemorySpace::CUDA> _unit_q_points;
   std::map<typename dealii::DoFHandler<dim>::cell_iterator,
            std::vector<unsigned int>>
       _cell_it_to_mf_pos;
   std::shared_ptr<dealii::LA::distributed::Vector<double, MemorySpaceType>>
       _inverse_mass_matrix;
-  std::map<typename dealii::DoFHandler<dim>::cell_iterator, double>
-      _inv_rho_cp_cells;
 };
 
 template <int dim, int fe_degree, typename MemorySpaceType>
@@ -176,15 +288,95 @@ ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::jacobian_vmult(
 }
 
 template <int dim, int fe_degree, typename MemorySpaceType>
-inline double
-ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::get_inv_rho_cp(
-    typename dealii::DoFHandler<dim>::cell_iterator const &cell,
-    unsigned int) const
+inline void ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::
+    inverse_mass_vmult(
+        dealii::LA::distributed::Vector<double, MemorySpaceType> &dst,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> const &src)
+        const
+{
+  vmult(dst, src);
+  dst.scale(*_inverse_mass_matrix);
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType>
+inline void
+ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::set_frozen_coefficients(
+    bool frozen_coefficients)
+{
+  ASSERT_THROW(!frozen_coefficients,
+               "Frozen coefficients are not supported on the device.");
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType>
+inline void ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::
+    hold_frozen_coefficients(bool /*hold*/)
+{
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType>
+inline void ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::
+    set_jacobian_boundary_conditions(bool /*boundary_conditions*/)
+{
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType>
+inline void
+ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::set_multirate_level(
+    unsigned int level)
+{
+  ASSERT_THROW(level == dealii::numbers::invalid_unsigned_int,
+               "Multirate time stepping is not supported on the device.");
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType>
+inline void ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::
+    fast_cells_vmult(
+        dealii::LA::distributed::Vector<double, MemorySpaceType> & /*dst*/,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> const
+            & /*src*/) const
+{
+  ASSERT_THROW_NOT_IMPLEMENTED();
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType>
+inline void
+ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::set_heat_source_cutoff(
+    double /*cutoff*/)
+{
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType>
+inline void
+ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::set_sleep_parameters(
+    unsigned int time_steps, double /*tolerance*/)
+{
+  ASSERT_THROW(time_steps == 0,
+               "Sleeping cells are not supported on the device.");
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType>
+inline void ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::
+    update_sleeping_cell_batches(
+        dealii::LA::distributed::Vector<double, MemorySpaceType> const
+            & /*temperature*/)
+{
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType>
+inline void ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::
+    compute_jacobian_diagonal(
+        dealii::LA::distributed::Vector<double, MemorySpaceType> & /*diagonal*/)
+        const
 {
-  auto inv_rho_cp = _inv_rho_cp_cells.find(cell);
-  ASSERT(inv_rho_cp != _inv_rho_cp_cells.end(), "Internal error");
+  ASSERT_THROW_NOT_IMPLEMENTED();
+}
 
-  return inv_rho_cp->second;
+template <int dim, int fe_degree, typename MemorySpaceType>
+inline void ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>::
+    compute_jacobian_matrix(
+        dealii::TrilinosWrappers::SparseMatrix & /*matrix*/) const
+{
+  ASSERT_THROW_NOT_IMPLEMENTED();
 }
 
 } // namespace adamantine
@@ -11,6 +11,7 @@
 #include <Geometry.hh>
 #include <HeatSource.hh>
 #include <ImplicitOperator.hh>
+#include <MemoryBlock.hh>
 #include <ThermalOperatorBase.hh>
 #include <ThermalPhysicsInterface.hh>
 
@@ -18,10 +19,15 @@
 #include <deal.II/base/time_stepping.templates.h>
 #include <deal.II/distributed/cell_weights.h>
 #include <deal.II/hp/fe_collection.h>
+#include <deal.II/lac/diagonal_matrix.h>
+#include <deal.II/lac/trilinos_precondition.h>
+#include <deal.II/lac/trilinos_sparse_matrix.h>
 
 #include <boost/property_tree/ptree.hpp>
 
+#include <cstdint>
 #include <memory>
+#include <string>
 
 namespace adamantine
 {
@@ -44,6 +50,8 @@ public:
 
   void setup_dofs() override;
 
+  void set_dof_renumbering_timer(Timer &timer) override;
+
   void compute_inverse_mass_matrix() override;
 
   void add_material(
@@ -72,6 +80,17 @@ public:
 
   double get_delta_t_guess() const override;
 
+  unsigned int get_n_linear_iterations() const override;
+
+  unsigned int get_n_newton_iterations() const override;
+
+  /**
+   * If the time stepping method is explicit, the dwell method, an IMEX method,
+   * is used instead while @p dwell_mode is true. Otherwise, this function does
+   * nothing.
+   */
+  void set_dwell_mode(bool dwell_mode) override;
+
   void initialize_dof_vector(
       dealii::LA::distributed::Vector<double, MemorySpaceType> &vector)
       const override;
@@ -116,6 +135,12 @@ public:
 
   unsigned int get_fe_degree() const override;
 
+  dealii::Vector<float> compute_gradient_indicator(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const
+          &temperature) const override;
+
+  void add_memory_consumption(MemoryReport &memory_report) const override;
+
   /**
    * Return the current height of the heat source.
    */
@@ -125,12 +150,104 @@ private:
   using LA_Vector =
       typename dealii::LA::distributed::Vector<double, MemorySpaceType>;
 
+  /**
+   * Renumber the degrees of freedom of the DoFHandler to improve the locality
+   * of the accesses to the vectors in the matrix-free loops.
+   */
+  void renumber_dofs();
+
+  /**
+   * Activate the cells in @p elements_to_activate without modifying the
+   * Triangulation. Contrary to add_material, the mesh is not repartitioned and
+   * only the data on the cells that are already active is saved, the
+   * MaterialProperty does not need to be reinitialized.
+   */
+  void add_material_incremental(
+      std::vector<std::vector<
+          typename dealii::DoFHandler<dim>::active_cell_iterator>> const
+          &elements_to_activate,
+      std::vector<double> const &new_deposition_cos,
+      std::vector<double> const &new_deposition_sin,
+      std::vector<bool> &new_has_melted, unsigned int const activation_start,
+      unsigned int const activation_end, double const new_material_temperature,
+      dealii::LA::distributed::Vector<double, MemorySpaceType> &solution);
+
+  /**
+   * Copy the melted indicators from _has_melted to the bitset in
+   * MemorySpaceType, and recompute the material state indices of the cells.
+   * Nothing is done if the bitset is up to date.
+   */
+  void update_has_melted_on_device();
+
+  /**
+   * Copy the melted indicators from the bitset in MemorySpaceType to
+   * _has_melted. Nothing is done if _has_melted is up to date.
+   */
+  void update_has_melted_on_host() const;
+
   /**
    * Compute the right-hand side and apply the TermalOperator.
    */
   LA_Vector evaluate_thermal_physics(double const t, LA_Vector const &y,
                                      std::vector<Timer> &timers) const;
 
+  /**
+   * Compute the right-hand side and apply the TermalOperator. The result is
+   * written in @p value which needs to be initialized.
+   */
+  void evaluate_thermal_physics(double const t, LA_Vector const &y,
+                                LA_Vector &value,
+                                std::vector<Timer> &timers) const;
+
+  /**
+   * Evolve the solution by one time step using the explicit Runge-Kutta method
+   * described by _rk_a, _rk_b, and _rk_c. The stages are stored in _rk_stages.
+   */
+  double explicit_runge_kutta_step(double t, double delta_t,
+                                   LA_Vector &solution,
+                                   std::vector<Timer> &timers);
+
+  /**
+   * Set the Butcher tableaus of the IMEX Runge-Kutta method @p method.
+   */
+  void set_imex_tableaus(std::string const &method);
+
+  /**
+   * Evolve the solution by one time step using the multirate forward Euler
+   * method. The dofs of the cells whose level is at least _multirate_level are
+   * advanced with _multirate_sub_steps sub-steps while the other dofs are
+   * advanced with a single step. During the sub-steps, only the fast cells are
+   * evaluated and the coupling with the slow cells is frozen at the beginning
+   * of the time step.
+   */
+  double multirate_forward_euler_step(double t, double delta_t,
+                                      LA_Vector &solution,
+                                      std::vector<Timer> &timers);
+
+  /**
+   * Evolve the solution by one time step using the IMEX Runge-Kutta method
+   * described by _imex_a_explicit, _imex_a_implicit, and _imex_c. The diffusion
+   * is treated implicitly using the coefficients frozen at the beginning of
+   * the time step while the heat sources, the boundary conditions, and the
+   * nonlinear part of the operator are treated explicitly.
+   */
+  double imex_runge_kutta_step(double t, double delta_t, LA_Vector &solution,
+                               std::vector<Timer> &timers);
+
+  /**
+   * Return the time step following a step of length @p delta_t of an implicit
+   * method whose Newton solver needed @p n_newton_iterations iterations.
+   */
+  double
+  compute_implicit_time_step(double const delta_t,
+                             unsigned int const n_newton_iterations) const;
+
+  /**
+   * Assemble \f$M - \tau J\f$ using the frozen coefficients and build the
+   * algebraic multigrid preconditioner of the ImplicitOperator.
+   */
+  void build_amg_preconditioner(double const tau) const;
+
   /**
    * Compute the inverse of the ImplicitOperator.
    */
@@ -138,6 +255,10 @@ private:
                                    LA_Vector const &y,
                                    std::vector<Timer> &timers) const;
 
+  /**
+   * This flag is true if the heat sources are averaged over each time step.
+   */
+  bool _time_integrated_sources = false;
   /**
    * This flag is true if the time stepping method is embedded.
    */
@@ -146,6 +267,19 @@ private:
    * This flag is true if the time stepping method is implicit.
    */
   bool _implicit_method = false;
+  /**
+   * This flag is true if the time stepping method is an IMEX method.
+   */
+  bool _imex_method = false;
+  /**
+   * This flag is true if the time stepping method is explicit and an IMEX
+   * method is used during the dwell periods.
+   */
+  bool _dwell_imex = false;
+  /**
+   * This flag is true during a dwell period using the IMEX method.
+   */
+  bool _dwell_mode = false;
   /**
    * This flag is true if right preconditioning is used to invert the
    * ImplicitOperator.
@@ -167,6 +301,123 @@ private:
    * Tolerance to inverte the ImplicitOperator.
    */
   double _tolerance;
+  /**
+   * This flag is true if a Jacobi preconditioner is used to invert the
+   * ImplicitOperator.
+   */
+  bool _jacobi_preconditioner = false;
+  /**
+   * This flag is true if a Chebyshev preconditioner is used to invert the
+   * ImplicitOperator.
+   */
+  bool _chebyshev_preconditioner = false;
+  /**
+   * Degree of the Chebyshev polynomial.
+   */
+  unsigned int _chebyshev_degree = 4;
+  /**
+   * This flag is true if an algebraic multigrid preconditioner is used to
+   * invert the ImplicitOperator.
+   */
+  bool _use_amg = false;
+  /**
+   * This flag is true if the tolerance of the linear solver is adapted to the
+   * convergence of the Newton solver using the Eisenstat-Walker forcing terms.
+   */
+  bool _adaptive_linear_tolerance = false;
+  /**
+   * Tolerance of the Newton solver.
+   */
+  double _newton_tolerance;
+  /**
+   * Norm of the residual and forcing term of the previous Newton iteration. The
+   * norm is zero at the beginning of a time step.
+   */
+  mutable double _previous_newton_residual_norm = 0.;
+  mutable double _forcing_term = 0.;
+  /**
+   * This flag is true if the time step of the implicit method is adapted to
+   * the number of Newton iterations.
+   */
+  bool _adaptive_time_step = false;
+  /**
+   * Factors applied to the time step when the Newton solver converges in less,
+   * respectively more, than _newton_target_iteration iterations.
+   */
+  double _coarsening_parameter = 1.;
+  double _refining_parameter = 1.;
+  /**
+   * Bounds of the adaptive time step of the implicit method.
+   */
+  double _min_time_step = 0.;
+  double _max_time_step = 0.;
+  /**
+   * Number of Newton iterations for which the time step is kept constant.
+   */
+  unsigned int _newton_target_iteration = 0;
+  /**
+   * This flag is true if the preconditioner is reused across Newton iterations
+   * and time steps.
+   */
+  bool _reuse_preconditioner = false;
+  /**
+   * Flag set to true when the preconditioner needs to be rebuilt.
+   */
+  mutable bool _refresh_preconditioner = true;
+  /**
+   * Inverse of the diagonal of the ImplicitOperator used by the Jacobi and the
+   * Chebyshev preconditioners.
+   */
+  mutable std::shared_ptr<dealii::DiagonalMatrix<LA_Vector>>
+      _preconditioner_inverse_diagonal =
+          std::make_shared<dealii::DiagonalMatrix<LA_Vector>>();
+  /**
+   * Estimate of the largest eigenvalue of the ImplicitOperator preconditioned
+   * by its diagonal. The estimate is reused with the diagonal.
+   */
+  mutable double _chebyshev_max_eigenvalue = 0.;
+  /**
+   * Matrix \f$M - \tau J\f$ assembled with the frozen coefficients. The
+   * algebraic multigrid is built on this matrix.
+   */
+  mutable dealii::TrilinosWrappers::SparseMatrix _implicit_matrix;
+  /**
+   * Algebraic multigrid preconditioner.
+   */
+  mutable dealii::TrilinosWrappers::PreconditionAMG _amg_preconditioner;
+  /**
+   * Parameter \f$\tau\f$ of the ImplicitOperator when the preconditioner was
+   * built.
+   */
+  mutable double _preconditioner_tau = 0.;
+  /**
+   * Number of iterations of the linear solver right after the preconditioner
+   * was built. The preconditioner is rebuilt when the number of iterations
+   * doubles.
+   */
+  mutable unsigned int _preconditioner_n_iterations = 0;
+  /**
+   * Number of iterations of the linear solver during the current time step.
+   */
+  mutable unsigned int _n_linear_iterations = 0;
+  /**
+   * Number of Newton iterations during the last time step.
+   */
+  unsigned int _n_newton_iterations = 0;
+  /**
+   * This flag is true if the cells are activated without modifying the
+   * Triangulation.
+   */
+  bool _incremental_activation = false;
+  /**
+   * Renumbering of the degrees of freedom applied by setup_dofs(): none,
+   * matrix_free_data_locality, or cuthill_mckee.
+   */
+  std::string _dof_renumbering = "none";
+  /**
+   * Timer of the renumbering of the degrees of freedom.
+   */
+  Timer *_dof_renumbering_timer = nullptr;
   /**
    * Current height of the object.
    */
@@ -211,9 +462,30 @@ private:
   /**
    * Indicator variable for whether a point has ever been above the solidus. The
    * value is false for material that has not yet melted and true for material
-   * that has melted.
+   * that has melted. This is a copy of _has_melted_bits, updated when it is
+   * accessed.
    */
-  std::vector<bool> _has_melted;
+  mutable std::vector<bool> _has_melted;
+  /**
+   * Melted indicators packed in 32-bit words. The indicator i of _has_melted
+   * is the bit i % 32 of the word i / 32. The bitset is updated by
+   * mark_has_melted in MemorySpaceType.
+   */
+  MemoryBlock<std::uint32_t, MemorySpaceType> _has_melted_bits;
+  /**
+   * Index in the MaterialProperty of the cells associated with the indicators.
+   */
+  MemoryBlock<unsigned int, MemorySpaceType> _has_melted_mp_indices;
+  /**
+   * Flag set when _has_melted has been modified and _has_melted_bits needs to
+   * be updated.
+   */
+  bool _has_melted_device_outdated = true;
+  /**
+   * Flag set when _has_melted_bits has been modified and _has_melted needs to
+   * be updated.
+   */
+  mutable bool _has_melted_host_outdated = false;
   /**
    * Associated material properties.
    */
@@ -234,6 +506,58 @@ private:
    * Shared pointer to the underlying time stepping scheme.
    */
   std::unique_ptr<dealii::TimeStepping::RungeKutta<LA_Vector>> _time_stepping;
+  /**
+   * Butcher tableau of the explicit Runge-Kutta method used when the stages
+   * are stored in persistent vectors. The vectors are empty if
+   * _time_stepping is used instead.
+   */
+  std::vector<std::vector<double>> _rk_a;
+  std::vector<double> _rk_b;
+  std::vector<double> _rk_c;
+  /**
+   * Persistent vectors storing the stages of the explicit Runge-Kutta method.
+   */
+  std::vector<LA_Vector> _rk_stages;
+  /**
+   * Persistent vector storing the intermediate solution of the explicit
+   * Runge-Kutta method.
+   */
+  LA_Vector _rk_solution;
+  /**
+   * Butcher tableaus of the explicit and of the implicit parts of the IMEX
+   * Runge-Kutta method. The first stage is explicit and the methods are
+   * stiffly accurate, i.e., the solution is the last stage.
+   */
+  std::vector<std::vector<double>> _imex_a_explicit;
+  std::vector<std::vector<double>> _imex_a_implicit;
+  std::vector<double> _imex_c;
+  /**
+   * Persistent vectors storing the explicit and the implicit parts of the
+   * stages of the IMEX Runge-Kutta method.
+   */
+  std::vector<LA_Vector> _imex_explicit_stages;
+  std::vector<LA_Vector> _imex_implicit_stages;
+  /**
+   * Number of sub-steps of the fast cells in the multirate time stepping. If
+   * the value is one, the multirate time stepping is disabled.
+   */
+  unsigned int _multirate_sub_steps = 1;
+  /**
+   * Level from which the cells are advanced with the sub-steps of the
+   * multirate time stepping.
+   */
+  unsigned int _multirate_level = dealii::numbers::invalid_unsigned_int;
+  /**
+   * Local indices of the dofs advanced with the sub-steps of the multirate
+   * time stepping.
+   */
+  std::vector<unsigned int> _multirate_fast_dofs;
+  /**
+   * Persistent vectors of the multirate time stepping storing the rate of the
+   * solution and the contribution of the fast cells to the rate.
+   */
+  LA_Vector _multirate_rate;
+  LA_Vector _multirate_fast_rate;
 };
 
 template <int dim, int fe_degree, typename MemorySpaceType,
@@ -244,6 +568,24 @@ inline double ThermalPhysics<dim, fe_degree, MemorySpaceType,
   return _delta_t_guess;
 }
 
+template <int dim, int fe_degree, typename MemorySpaceType,
+          typename QuadratureType>
+inline unsigned int
+ThermalPhysics<dim, fe_degree, MemorySpaceType,
+               QuadratureType>::get_n_linear_iterations() const
+{
+  return _n_linear_iterations;
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType,
+          typename QuadratureType>
+inline unsigned int
+ThermalPhysics<dim, fe_degree, MemorySpaceType,
+               QuadratureType>::get_n_newton_iterations() const
+{
+  return _n_newton_iterations;
+}
+
 template <int dim, int fe_degree, typename MemorySpaceType,
           typename QuadratureType>
 inline void
@@ -290,6 +632,7 @@ inline std::vector<bool>
 ThermalPhysics<dim, fe_degree, MemorySpaceType,
                QuadratureType>::get_has_melted_vector() const
 {
+  update_has_melted_on_host();
   return _has_melted;
 }
 
@@ -299,6 +642,8 @@ inline void ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
     set_has_melted_vector(std::vector<bool> const &has_melted)
 {
   _has_melted = has_melted;
+  _has_melted_host_outdated = false;
+  _has_melted_device_outdated = true;
 }
 
 template <int dim, int fe_degree, typename MemorySpaceType,
@@ -307,6 +652,7 @@ inline bool
 ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::get_has_melted(
     unsigned int const i) const
 {
+  update_has_melted_on_host();
   return _has_melted[i];
 }
 
@@ -346,6 +692,20 @@ ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::get_fe_degree()
   return fe_degree;
 }
 
+template <int dim, int fe_degree, typename MemorySpaceType,
+          typename QuadratureType>
+inline dealii::Vector<float>
+ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
+    compute_gradient_indicator(
+        dealii::LA::distributed::Vector<double, MemorySpaceType> const
+            &temperature) const
+{
+  dealii::Vector<float> indicator;
+  _thermal_operator->compute_gradient_indicator(temperature, indicator);
+
+  return indicator;
+}
+
 template <int dim, int fe_degree, typename MemorySpaceType,
           typename QuadratureType>
 inline double ThermalPhysics<dim, fe_degree, MemorySpaceType,
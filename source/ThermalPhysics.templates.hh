@@ -18,27 +18,34 @@
 #include <CubeHeatSource.hh>
 #include <ElectronBeamHeatSource.hh>
 #include <GoldakHeatSource.hh>
+#include <MemoryReport.hh>
+#include <NewtonSolver.hh>
 #include <ThermalPhysics.hh>
 #include <Timer.hh>
 
 #include <deal.II/base/geometry_info.h>
+#include <deal.II/base/memory_consumption.h>
 #include <deal.II/base/quadrature_lib.h>
 #include <deal.II/distributed/cell_data_transfer.templates.h>
+#include <deal.II/dofs/dof_renumbering.h>
 #include <deal.II/dofs/dof_tools.h>
 #include <deal.II/fe/fe_nothing.h>
 #include <deal.II/fe/fe_q.h>
 #include <deal.II/grid/filtered_iterator.h>
 #include <deal.II/hp/fe_values.h>
 #include <deal.II/hp/q_collection.h>
+#include <deal.II/lac/diagonal_matrix.h>
 #include <deal.II/lac/precondition.h>
 #include <deal.II/lac/solver_gmres.h>
 #include <deal.II/lac/vector_operation.h>
+#include <deal.II/matrix_free/matrix_free.h>
 
 #ifdef ADAMANTINE_WITH_CALIPER
 #include <caliper/cali.h>
 #endif
 
 #include <algorithm>
+#include <cmath>
 #include <memory>
 
 namespace adamantine
@@ -49,28 +56,33 @@ template <int dim, int fe_degree, typename MemorySpaceType,
           std::enable_if_t<
               std::is_same<MemorySpaceType, dealii::MemorySpace::Host>::value,
               int> = 0>
-dealii::LA::distributed::Vector<double, MemorySpaceType>
-evaluate_thermal_physics_impl(
+void evaluate_thermal_physics_impl(
     std::shared_ptr<ThermalOperatorBase<dim, MemorySpaceType>> thermal_operator,
     double const t, double const current_source_height,
     dealii::LA::distributed::Vector<double, MemorySpaceType> const &y,
+    dealii::LA::distributed::Vector<double, MemorySpaceType> &value,
     std::vector<Timer> &timers)
 {
   timers[evol_time_eval_th_ph].start();
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_BEGIN("heat_sources");
+#endif
   thermal_operator->set_time_and_source_height(t, current_source_height);
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_END("heat_sources");
+#endif
 
-  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> value(
-      y.get_partitioner());
-  value = 0.;
-  // Apply the Thermal Operator.
-  thermal_operator->vmult_add(value, y);
-
-  // Multiply by the inverse of the mass matrix.
-  value.scale(*thermal_operator->get_inverse_mass_matrix());
+  // Apply the Thermal Operator and multiply by the inverse of the mass matrix.
+  // Both operations are fused in the loop over the cells.
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_BEGIN("thermal_operator");
+#endif
+  thermal_operator->inverse_mass_vmult(value, y);
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_END("thermal_operator");
+#endif
 
   timers[evol_time_eval_th_ph].stop();
-
-  return value;
 }
 
 template <int dim, int fe_degree, typename MemorySpaceType,
@@ -86,22 +98,53 @@ void init_dof_vector(
     vector.local_element(i) = value;
 }
 
+/**
+ * Preconditioner of the ImplicitOperator \f$I - \tau M^{-1} J\f$. Since the
+ * ImplicitOperator is \f$M^{-1} (M - \tau J)\f$, the algebraic multigrid built
+ * on \f$M - \tau J\f$ is applied to the vector multiplied by \f$M\f$.
+ */
+class ImplicitAMGPreconditioner
+{
+public:
+  ImplicitAMGPreconditioner(
+      dealii::TrilinosWrappers::PreconditionAMG const &amg_preconditioner,
+      dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> const
+          &inverse_mass_matrix)
+      : _amg_preconditioner(amg_preconditioner),
+        _inverse_mass_matrix(inverse_mass_matrix)
+  {
+  }
+
+  void vmult(
+      dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> &dst,
+      dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> const
+          &src) const
+  {
+    dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> mass_src(
+        src);
+    unsigned int const local_size = mass_src.locally_owned_size();
+    for (unsigned int i = 0; i < local_size; ++i)
+      mass_src.local_element(i) /= _inverse_mass_matrix.local_element(i);
+    _amg_preconditioner.vmult(dst, mass_src);
+  }
+
+private:
+  dealii::TrilinosWrappers::PreconditionAMG const &_amg_preconditioner;
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> const
+      &_inverse_mass_matrix;
+};
+
 #if defined(ADAMANTINE_HAVE_CUDA) && defined(__CUDACC__)
 template <int dim, int fe_degree, typename MemorySpaceType,
           std::enable_if_t<
               std::is_same<MemorySpaceType, dealii::MemorySpace::CUDA>::value,
               int> = 0>
-dealii::LA::distributed::Vector<double, MemorySpaceType>
-evaluate_thermal_physics_impl(
+void evaluate_thermal_physics_impl(
     std::shared_ptr<ThermalOperatorBase<dim, MemorySpaceType>> const
         &thermal_operator,
-    dealii::hp::FECollection<dim> const &fe_collection, double const t,
-    dealii::DoFHandler<dim> const &dof_handler,
-    std::vector<std::shared_ptr<HeatSource<dim>>> const &heat_sources,
-    double current_source_height, BoundaryType boundary_type,
-    MaterialProperty<dim, MemorySpaceType> &material_properties,
-    dealii::AffineConstraints<double> const &affine_constraints,
+    double const t, double const current_source_height,
     dealii::LA::distributed::Vector<double, MemorySpaceType> const &y,
+    dealii::LA::distributed::Vector<double, MemorySpaceType> &value_dev,
     std::vector<Timer> &timers)
 {
   auto thermal_operator_dev = std::dynamic_pointer_cast<
@@ -111,137 +154,26 @@ evaluate_thermal_physics_impl(
   timers[evol_time_update_bound_mat_prop].stop();
 
   timers[evol_time_eval_th_ph].start();
+  // Update the heat sources and copy them to the device. The source term is
+  // evaluated at the quadrature points when the operator is applied.
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_BEGIN("heat_sources");
+#endif
+  thermal_operator_dev->set_time_and_source_height(t, current_source_height);
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_END("heat_sources");
+#endif
 
-  dealii::LA::distributed::Vector<double, MemorySpaceType> value_dev(
-      y.get_partitioner());
-
-  // Apply the Thermal Operator.
-  thermal_operator_dev->vmult(value_dev, y);
-
-  // Compute the source term.
-  // TODO do this on the GPU
-  for (auto &beam : heat_sources)
-    beam->update_time(t);
-  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> source(
-      y.get_partitioner());
-  source = 0.;
-
-  // Compute inv_rho_cp at the cell level on the host. We would not need to do
-  // this if everything was done on the GPU.
-  thermal_operator_dev->update_inv_rho_cp_cell();
-
-  dealii::hp::QCollection<dim> source_q_collection;
-  source_q_collection.push_back(dealii::QGauss<dim>(fe_degree + 1));
-  source_q_collection.push_back(dealii::QGauss<dim>(1));
-  dealii::hp::FEValues<dim> hp_fe_values(fe_collection, source_q_collection,
-                                         dealii::update_quadrature_points |
-                                             dealii::update_values |
-                                             dealii::update_JxW_values);
-  unsigned int const dofs_per_cell = fe_collection.max_dofs_per_cell();
-  unsigned int const n_q_points = source_q_collection.max_n_quadrature_points();
-  std::vector<dealii::types::global_dof_index> local_dof_indices(dofs_per_cell);
-  dealii::QGauss<dim - 1> face_quadrature(fe_degree + 1);
-  dealii::FEFaceValues<dim> fe_face_values(
-      fe_collection[0], face_quadrature,
-      dealii::update_values | dealii::update_quadrature_points |
-          dealii::update_JxW_values);
-  unsigned int const n_face_q_points = face_quadrature.size();
-  dealii::Vector<double> cell_source(dofs_per_cell);
-
-  // Loop over the locally owned cells with an active FE index of zero
-  for (auto const &cell : dealii::filter_iterators(
-           dof_handler.active_cell_iterators(),
-           dealii::IteratorFilters::LocallyOwnedCell(),
-           dealii::IteratorFilters::ActiveFEIndexEqualTo(0)))
-  {
-    cell_source = 0.;
-    hp_fe_values.reinit(cell);
-    dealii::FEValues<dim> const &fe_values =
-        hp_fe_values.get_present_fe_values();
-
-    for (unsigned int i = 0; i < dofs_per_cell; ++i)
-    {
-      for (unsigned int q = 0; q < n_q_points; ++q)
-      {
-        double const inv_rho_cp = thermal_operator_dev->get_inv_rho_cp(cell, q);
-        double quad_pt_source = 0.;
-        dealii::Point<dim> const &q_point = fe_values.quadrature_point(q);
-        for (auto &beam : heat_sources)
-          quad_pt_source += beam->value(q_point, current_source_height);
-
-        cell_source[i] += inv_rho_cp * quad_pt_source *
-                          fe_values.shape_value(i, q) * fe_values.JxW(q);
-      }
-    }
-
-    // If we don't have a adiabatic boundary conditions, we need to add boundary
-    // conditions
-    if (!(boundary_type & BoundaryType::adiabatic))
-    {
-      for (unsigned int f = 0; f < dealii::GeometryInfo<dim>::faces_per_cell;
-           ++f)
-      {
-        // We need to add the boundary conditions on the faces on the boundary
-        // but also on the faces at the interface with FE_Nothing
-        auto const &face = cell->face(f);
-        if ((face->at_boundary()) &&
-            ((!face->at_boundary()) &&
-             (cell->neighbor(f)->active_fe_index() != 0)))
-        {
-          double conv_temperature_infty = 0.;
-          double conv_heat_transfer_coef = 0.;
-          double rad_temperature_infty = 0.;
-          double rad_heat_transfer_coef = 0.;
-          if (boundary_type & BoundaryType::convective)
-          {
-            conv_temperature_infty = material_properties.get_cell_value(
-                cell, Property::convection_temperature_infty);
-            conv_heat_transfer_coef = material_properties.get_cell_value(
-                cell, StateProperty::convection_heat_transfer_coef);
-          }
-          if (boundary_type & BoundaryType::radiative)
-          {
-            rad_temperature_infty = material_properties.get_cell_value(
-                cell, Property::radiation_temperature_infty);
-            rad_heat_transfer_coef = material_properties.get_cell_value(
-                cell, StateProperty::radiation_heat_transfer_coef);
-          }
-
-          fe_face_values.reinit(cell, face);
-          for (unsigned int i = 0; i < dofs_per_cell; ++i)
-          {
-            for (unsigned int q = 0; q < n_face_q_points; ++q)
-            {
-              double const inv_rho_cp =
-                  thermal_operator_dev->get_inv_rho_cp(cell, q);
-              cell_source[i] +=
-                  inv_rho_cp *
-                  (conv_heat_transfer_coef * conv_temperature_infty +
-                   rad_heat_transfer_coef * rad_temperature_infty) *
-                  fe_face_values.shape_value(i, q) * fe_face_values.JxW(q);
-            }
-          }
-        }
-      }
-    }
-    cell->get_dof_indices(local_dof_indices);
-    affine_constraints.distribute_local_to_global(cell_source,
-                                                  local_dof_indices, source);
-  }
-  source.compress(dealii::VectorOperation::add);
-
-  // Add source
-  dealii::LA::distributed::Vector<double, dealii::MemorySpace::CUDA> source_dev(
-      source.get_partitioner());
-  source_dev.import(source, dealii::VectorOperation::insert);
-  value_dev += source_dev;
-
-  // Multiply by the inverse of the mass matrix.
-  value_dev.scale(*thermal_operator_dev->get_inverse_mass_matrix());
+  // Apply the Thermal Operator and multiply by the inverse of the mass matrix.
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_BEGIN("thermal_operator");
+#endif
+  thermal_operator_dev->inverse_mass_vmult(value_dev, y);
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_MARK_END("thermal_operator");
+#endif
 
   timers[evol_time_eval_th_ph].stop();
-
-  return value_dev;
 }
 
 template <int dim, int fe_degree, typename MemorySpaceType,
@@ -354,17 +286,146 @@ ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::ThermalPhysics(
   }
   parse_boundary_type(boundary_type_str);
 
+  // PropertyTreeInput geometry.incremental_activation
+  _incremental_activation =
+      database.get("geometry.incremental_activation", false);
+
+  // PropertyTreeInput discretization.thermal.dof_renumbering
+  _dof_renumbering =
+      database.get("discretization.thermal.dof_renumbering", "none");
+
   // Create the thermal operator
+  // PropertyTreeInput discretization.thermal.precision
+  std::string const precision =
+      database.get("discretization.thermal.precision", "double");
+  ASSERT_THROW((precision == "double") || (precision == "single"),
+               "Error: Unknown precision '" + precision + "'.");
+  ASSERT_THROW(
+      (precision == "double") ||
+          std::is_same<MemorySpaceType, dealii::MemorySpace::Host>::value,
+      "Error: Single precision is only supported on the host.");
   if (std::is_same<MemorySpaceType, dealii::MemorySpace::Host>::value)
-    _thermal_operator =
-        std::make_shared<ThermalOperator<dim, fe_degree, MemorySpaceType>>(
-            communicator, _boundary_type, _material_properties, _heat_sources);
+  {
+    // In single precision, the kernels work on twice as many cells per SIMD
+    // instruction but the solution and the time stepping stay in double
+    // precision.
+    if (precision == "single")
+      _thermal_operator = std::make_shared<
+          ThermalOperator<dim, fe_degree, MemorySpaceType, float>>(
+          communicator, _boundary_type, _material_properties, _heat_sources);
+    else
+      _thermal_operator =
+          std::make_shared<ThermalOperator<dim, fe_degree, MemorySpaceType>>(
+              communicator, _boundary_type, _material_properties,
+              _heat_sources);
+  }
 #if defined(ADAMANTINE_HAVE_CUDA) && defined(__CUDACC__)
   else
+  {
+    // PropertyTreeInput discretization.thermal.overlap_communication
+    bool const overlap_communication =
+        database.get("discretization.thermal.overlap_communication", true);
     _thermal_operator = std::make_shared<
         ThermalOperatorDevice<dim, fe_degree, MemorySpaceType>>(
-        communicator, _boundary_type, _material_properties);
+        communicator, _boundary_type, _material_properties, _heat_sources,
+        overlap_communication);
+  }
 #endif
+  // The heat sources are only evaluated on the cells where they are larger
+  // than the cutoff.
+  // PropertyTreeInput sources.cutoff
+  double const heat_source_cutoff = database.get("sources.cutoff", 1.e-15);
+  _thermal_operator->set_heat_source_cutoff(heat_source_cutoff);
+
+  // PropertyTreeInput sources.time_integration
+  _time_integrated_sources = database.get("sources.time_integration", false);
+
+  // The cell batches far from the heat sources whose temperature does not
+  // change are skipped.
+  // PropertyTreeInput discretization.thermal.sleep_time_steps
+  unsigned int const sleep_time_steps =
+      database.get("discretization.thermal.sleep_time_steps", 0u);
+  // PropertyTreeInput discretization.thermal.sleep_tolerance
+  double const sleep_tolerance =
+      database.get("discretization.thermal.sleep_tolerance", 1e-3);
+  _thermal_operator->set_sleep_parameters(sleep_time_steps, sleep_tolerance);
+
+  // Set the cost model used for load balancing. The weight of a cell is
+  // proportional to its number of degrees of freedom if it is active and
+  // constant otherwise. It increases with the level of the cell and it is
+  // multiplied by beam_weight if one of the heat sources is larger than the
+  // cutoff on the cell. The cells of the layer being deposited and of the next
+  // one are weighted as active cells, even if the material has not been
+  // deposited yet, and their weight is multiplied by layer_weight. Since the
+  // cells of a layer are heavier than the others, the layer is split between
+  // all the processors instead of being owned by the few processors whose
+  // part of the space-filling curve contains it.
+  boost::optional<boost::property_tree::ptree const &> refinement_database =
+      database.get_child_optional("refinement");
+  // PropertyTreeInput refinement.active_cell_weight
+  double const active_cell_weight =
+      refinement_database ? refinement_database->get("active_cell_weight", 1.)
+                          : 1.;
+  // PropertyTreeInput refinement.inactive_cell_weight
+  double const inactive_cell_weight =
+      refinement_database ? refinement_database->get("inactive_cell_weight", 0.)
+                          : 0.;
+  // PropertyTreeInput refinement.level_weight
+  double const level_weight =
+      refinement_database ? refinement_database->get("level_weight", 0.) : 0.;
+  // PropertyTreeInput refinement.beam_weight
+  double const beam_weight =
+      refinement_database ? refinement_database->get("beam_weight", 1.) : 1.;
+  // PropertyTreeInput refinement.layer_weight
+  double const layer_weight =
+      refinement_database ? refinement_database->get("layer_weight", 1.) : 1.;
+  // PropertyTreeInput geometry.deposition_height
+  double const layer_thickness =
+      database.get("geometry.deposition_height", 0.);
+  unsigned int const active_n_dofs = _fe_collection[0].n_dofs_per_cell();
+  _cell_weights.reinit(
+      _dof_handler,
+      [=](typename dealii::DoFHandler<dim>::cell_iterator const &cell,
+          dealii::FiniteElement<dim> const &future_fe) -> unsigned int
+      {
+        unsigned int n_dofs = future_fe.n_dofs_per_cell();
+        double layer_factor = 1.;
+        if (layer_weight != 1.)
+        {
+          double const distance =
+              cell->center()[axis<dim>::z] - _current_source_height;
+          if ((distance > -layer_thickness) && (distance < layer_thickness))
+          {
+            n_dofs = active_n_dofs;
+            layer_factor = layer_weight;
+          }
+        }
+        double weight =
+            n_dofs > 0 ? active_cell_weight * n_dofs : inactive_cell_weight;
+        weight *= layer_factor;
+        weight *= 1. + level_weight * cell->level();
+        if (beam_weight != 1.)
+        {
+          dealii::BoundingBox<dim> const cell_box = cell->bounding_box();
+          for (auto const &beam : _heat_sources)
+          {
+            dealii::Point<dim> min_point;
+            dealii::Point<dim> max_point;
+            if (compute_heat_source_bounding_box(
+                    beam->get_data(), _current_source_height,
+                    heat_source_cutoff, &min_point[0], &max_point[0]) &&
+                cell_box.get_neighbor_type(dealii::BoundingBox<dim>(
+                    std::make_pair(min_point, max_point))) !=
+                    dealii::NeighborType::not_neighbors)
+            {
+              weight *= beam_weight;
+              break;
+            }
+          }
+        }
+
+        return static_cast<unsigned int>(std::round(weight));
+      });
 
   // Create the time stepping scheme
   boost::property_tree::ptree const &time_stepping_database =
@@ -448,13 +509,78 @@ ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::ThermalPhysics(
             dealii::TimeStepping::SDIRK_TWO_STAGES);
     _implicit_method = true;
   }
+  else if (method.compare(0, 5, "imex_") == 0)
+  {
+    set_imex_tableaus(method);
+    _imex_method = true;
+  }
+
+  // During the dwell periods, i.e., when the heat sources are off, the
+  // simulation uses a much larger time step. If the time stepping method is
+  // explicit, it is replaced by an IMEX method during these periods.
+  // PropertyTreeInput time_stepping.dwell_time_step
+  if ((time_stepping_database.get("dwell_time_step", 0.) > 0.) &&
+      !_implicit_method && !_imex_method)
+  {
+    // PropertyTreeInput time_stepping.dwell_method
+    std::string dwell_method =
+        time_stepping_database.get<std::string>("dwell_method", "imex_euler");
+    std::transform(dwell_method.begin(), dwell_method.end(),
+                   dwell_method.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    set_imex_tableaus(dwell_method);
+    _dwell_imex = true;
+  }
+
+  // PropertyTreeInput time_stepping.persistent_stages
+  if (time_stepping_database.get("persistent_stages", false))
+  {
+    // Use the same Butcher tableaus as deal.II
+    if (method.compare("forward_euler") == 0)
+    {
+      _rk_b = {1.};
+      _rk_c = {0.};
+    }
+    else if (method.compare("rk_third_order") == 0)
+    {
+      _rk_a = {{0.5}, {-1., 2.}};
+      _rk_b = {1. / 6., 2. / 3., 1. / 6.};
+      _rk_c = {0., 0.5, 1.};
+    }
+    else if (method.compare("rk_fourth_order") == 0)
+    {
+      _rk_a = {{0.5}, {0., 0.5}, {0., 0., 1.}};
+      _rk_b = {1. / 6., 1. / 3., 1. / 3., 1. / 6.};
+      _rk_c = {0., 0.5, 0.5, 1.};
+    }
+    ASSERT_THROW(!_rk_b.empty(),
+                 "persistent_stages is only supported by forward_euler, "
+                 "rk_third_order, and rk_fourth_order.");
+  }
+
+  // In the multirate time stepping, the refined cells under the beam are
+  // advanced with sub-steps of the time step while the rest of the domain is
+  // advanced with the time step.
+  // PropertyTreeInput time_stepping.multirate_sub_steps
+  _multirate_sub_steps = time_stepping_database.get("multirate_sub_steps", 1u);
+  if (_multirate_sub_steps > 1)
+  {
+    ASSERT_THROW(method.compare("forward_euler") == 0,
+                 "The multirate time stepping is only supported by "
+                 "forward_euler.");
+    ASSERT_THROW(std::is_same_v<MemorySpaceType, dealii::MemorySpace::Host>,
+                 "The multirate time stepping is not supported on the device.");
+    // PropertyTreeInput time_stepping.multirate_level
+    _multirate_level = time_stepping_database.get("multirate_level", 1u);
+    _thermal_operator->set_multirate_level(_multirate_level);
+  }
 
   if (_embedded_method == true)
   {
-    // PropertyTreeInput time_steppping.coarsening_parameter
+    // PropertyTreeInput time_stepping.coarsening_parameter
     double coarsen_param =
         time_stepping_database.get("coarsening_parameter", 1.2);
-    // PropertyTreeInput time_steppping.refining_parameter
+    // PropertyTreeInput time_stepping.refining_parameter
     double refine_param = time_stepping_database.get("refining_parameter", 0.8);
     // PropertyTreeInput time_stepping.min_time_step
     double min_delta = time_stepping_database.get("min_time_step", 1e-14);
@@ -474,9 +600,10 @@ ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::ThermalPhysics(
                                                 refine_tol, coarsen_tol);
   }
 
-  // If the time stepping scheme is implicit, set the parameters for the solver
-  // and create the implicit operator.
-  if (_implicit_method == true)
+  // If the time stepping scheme is implicit or IMEX, set the parameters for
+  // the solver and create the implicit operator.
+  if ((_implicit_method == true) || (_imex_method == true) ||
+      (_dwell_imex == true))
   {
     // PropertyTreeInput time_stepping.max_iteration
     _max_iter = time_stepping_database.get("max_iteration", 1000);
@@ -487,22 +614,96 @@ ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::ThermalPhysics(
         time_stepping_database.get("right_preconditioning", false);
     // PropertyTreeInput time_stepping.n_tmp_vectors
     _max_n_tmp_vectors = time_stepping_database.get("n_tmp_vectors", 30);
-    // PropertyTreeInput time_stepping.newton_max_iteration
-    unsigned int newton_max_iter =
-        time_stepping_database.get("newton_max_iteration", 100);
-    // PropertyTreeInput time_stepping.newton_tolerance
-    double newton_tolerance =
-        time_stepping_database.get("newton_tolerance", 1e-6);
-    dealii::TimeStepping::ImplicitRungeKutta<LA_Vector> *implicit_rk =
-        static_cast<dealii::TimeStepping::ImplicitRungeKutta<LA_Vector> *>(
-            _time_stepping.get());
-    implicit_rk->set_newton_solver_parameters(newton_max_iter,
-                                              newton_tolerance);
+    // The IMEX methods solve a linear system per stage and do not use the
+    // Newton solver.
+    if (_implicit_method == true)
+    {
+      // PropertyTreeInput time_stepping.newton_max_iteration
+      unsigned int newton_max_iter =
+          time_stepping_database.get("newton_max_iteration", 100);
+      // PropertyTreeInput time_stepping.newton_tolerance
+      _newton_tolerance = time_stepping_database.get("newton_tolerance", 1e-6);
+      dealii::TimeStepping::ImplicitRungeKutta<LA_Vector> *implicit_rk =
+          static_cast<dealii::TimeStepping::ImplicitRungeKutta<LA_Vector> *>(
+              _time_stepping.get());
+      implicit_rk->set_newton_solver_parameters(newton_max_iter,
+                                                _newton_tolerance);
+      // PropertyTreeInput time_stepping.adaptive_linear_tolerance
+      _adaptive_linear_tolerance =
+          time_stepping_database.get("adaptive_linear_tolerance", false);
+      // The time step of the implicit methods is adapted using the number of
+      // Newton iterations: the time step grows when the Newton solver converges
+      // quickly, e.g. during cooling, and it shrinks otherwise.
+      // PropertyTreeInput time_stepping.adaptive_time_step
+      _adaptive_time_step =
+          time_stepping_database.get("adaptive_time_step", false);
+      if (_adaptive_time_step)
+      {
+        // PropertyTreeInput time_stepping.coarsening_parameter
+        _coarsening_parameter =
+            time_stepping_database.get("coarsening_parameter", 1.2);
+        // PropertyTreeInput time_stepping.refining_parameter
+        _refining_parameter =
+            time_stepping_database.get("refining_parameter", 0.8);
+        // PropertyTreeInput time_stepping.min_time_step
+        _min_time_step = time_stepping_database.get("min_time_step", 1e-14);
+        // PropertyTreeInput time_stepping.max_time_step
+        _max_time_step = time_stepping_database.get("max_time_step", 1e100);
+        // PropertyTreeInput time_stepping.newton_target_iteration
+        _newton_target_iteration =
+            time_stepping_database.get("newton_target_iteration", 3u);
+        ASSERT_THROW((_coarsening_parameter >= 1.) &&
+                         (_refining_parameter > 0.) &&
+                         (_refining_parameter <= 1.),
+                     "The coarsening parameter must be greater or equal to one "
+                     "and the refining parameter must be in (0, 1].");
+      }
+    }
 
     // PropertyTreeInput time_stepping.jfnk
-    bool jfnk = time_stepping_database.get("jfnk", false);
+    bool const jfnk =
+        _implicit_method && time_stepping_database.get("jfnk", false);
     _implicit_operator = std::make_unique<ImplicitOperator<MemorySpaceType>>(
         _thermal_operator, jfnk);
+    // PropertyTreeInput time_stepping.preconditioner
+    std::string const preconditioner =
+        time_stepping_database.get<std::string>("preconditioner", "identity");
+    ASSERT_THROW((preconditioner == "identity") ||
+                     (preconditioner == "jacobi") ||
+                     (preconditioner == "chebyshev") ||
+                     (preconditioner == "amg"),
+                 "Unknown preconditioner. The choices are identity, jacobi, "
+                 "chebyshev, and amg.");
+    _jacobi_preconditioner = (preconditioner == "jacobi");
+    _chebyshev_preconditioner = (preconditioner == "chebyshev");
+    _use_amg = (preconditioner == "amg");
+    ASSERT_THROW(
+        (preconditioner == "identity") ||
+            std::is_same_v<MemorySpaceType, dealii::MemorySpace::Host>,
+        "The " + preconditioner +
+            " preconditioner is not supported on the device.");
+    // PropertyTreeInput time_stepping.chebyshev_degree
+    _chebyshev_degree = time_stepping_database.get("chebyshev_degree", 4u);
+    // PropertyTreeInput time_stepping.reuse_preconditioner
+    _reuse_preconditioner =
+        time_stepping_database.get("reuse_preconditioner", false);
+    // The frozen coefficients are used when the Jacobian is applied explicitly,
+    // i.e., they are ignored by JFNK, and to build the preconditioners.
+    // PropertyTreeInput time_stepping.frozen_coefficients
+    bool const frozen_coefficients =
+        time_stepping_database.get("frozen_coefficients", false);
+    // The IMEX methods treat the diffusion implicitly using the Jacobian with
+    // frozen coefficients. The boundary conditions are treated explicitly
+    // with the heat sources. When the IMEX method is only used during the
+    // dwell periods, the frozen coefficients are enabled by set_dwell_mode.
+    ASSERT_THROW(!(_imex_method || _dwell_imex) ||
+                     std::is_same_v<MemorySpaceType, dealii::MemorySpace::Host>,
+                 "The IMEX methods are not supported on the device.");
+    _thermal_operator->set_frozen_coefficients(
+        (frozen_coefficients && !jfnk) || (preconditioner != "identity") ||
+        _imex_method);
+    _thermal_operator->set_jacobian_boundary_conditions(!_imex_method &&
+                                                        !_dwell_imex);
   }
 
   // Set material on part of the domain
@@ -545,6 +746,7 @@ void ThermalPhysics<dim, fe_degree, MemorySpaceType,
                     QuadratureType>::setup_dofs()
 {
   _dof_handler.distribute_dofs(_fe_collection);
+  renumber_dofs();
   dealii::IndexSet locally_relevant_dofs;
   dealii::DoFTools::extract_locally_relevant_dofs(_dof_handler,
                                                   locally_relevant_dofs);
@@ -555,6 +757,56 @@ void ThermalPhysics<dim, fe_degree, MemorySpaceType,
   _affine_constraints.close();
 
   _thermal_operator->reinit(_dof_handler, _affine_constraints, _q_collection);
+  // The preconditioner belongs to the previous dofs, even when their
+  // partitioning is unchanged. The sparsity pattern of the matrix used by the
+  // algebraic multigrid is created again.
+  _refresh_preconditioner = true;
+  _amg_preconditioner.clear();
+  _implicit_matrix.clear();
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType,
+          typename QuadratureType>
+void ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
+    set_dof_renumbering_timer(Timer &timer)
+{
+  _dof_renumbering_timer = &timer;
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType,
+          typename QuadratureType>
+void ThermalPhysics<dim, fe_degree, MemorySpaceType,
+                    QuadratureType>::renumber_dofs()
+{
+  if (_dof_renumbering == "none")
+    return;
+
+  if (_dof_renumbering_timer)
+    _dof_renumbering_timer->start();
+  if (_dof_renumbering == "cuthill_mckee")
+  {
+    // Only the locally owned degrees of freedom are renumbered.
+    dealii::DoFRenumbering::Cuthill_McKee(_dof_handler);
+  }
+  else
+  {
+    // The order of the cells in the matrix-free loops depends on the hanging
+    // node constraints. The constraints are built again after the
+    // renumbering.
+    dealii::IndexSet locally_relevant_dofs;
+    dealii::DoFTools::extract_locally_relevant_dofs(_dof_handler,
+                                                    locally_relevant_dofs);
+    dealii::AffineConstraints<double> constraints(locally_relevant_dofs);
+    dealii::DoFTools::make_hanging_node_constraints(_dof_handler, constraints);
+    constraints.close();
+    typename dealii::MatrixFree<dim, double>::AdditionalData additional_data;
+    additional_data.tasks_parallel_scheme =
+        dealii::MatrixFree<dim, double>::AdditionalData::partition_color;
+    dealii::DoFRenumbering::matrix_free_data_locality(_dof_handler, constraints,
+                                                      additional_data);
+  }
+  if (_dof_renumbering_timer)
+    _dof_renumbering_timer->stop();
 }
 
 template <int dim, int fe_degree, typename MemorySpaceType,
@@ -564,7 +816,9 @@ void ThermalPhysics<dim, fe_degree, MemorySpaceType,
 {
   _thermal_operator->compute_inverse_mass_matrix(_dof_handler,
                                                  _affine_constraints);
-  if (_implicit_method == true)
+  // The implicit operator is also used by the IMEX methods, including the
+  // dwell method.
+  if (_implicit_operator)
     _implicit_operator->set_inverse_mass_matrix(
         _thermal_operator->get_inverse_mass_matrix());
 }
@@ -576,53 +830,78 @@ void ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
         double const threshold_temperature,
         dealii::LA::distributed::Vector<double, MemorySpaceType> &temperature)
 {
-  temperature.update_ghost_values();
-  auto dofs_per_cell = _dof_handler.get_fe().dofs_per_cell;
+  update_has_melted_on_device();
+
+  // The average temperature of the cells is computed in MemorySpaceType so
+  // the temperature never needs to be copied to the host.
+  dealii::LA::distributed::Vector<double, MemorySpaceType> const
+      temperature_average = _material_properties.compute_average_temperature(
+          _dof_handler, temperature);
+  double const *temperature_average_local = temperature_average.get_values();
+  MemoryBlockView<unsigned int, MemorySpaceType> mp_indices_view(
+      _has_melted_mp_indices);
+  MemoryBlockView<std::uint32_t, MemorySpaceType> has_melted_bits_view(
+      _has_melted_bits);
+  unsigned int const n_cells = _has_melted_mp_indices.size();
+  // Each thread owns a word of the bitset, so no atomic operation is needed.
+  for_each(MemorySpaceType{}, _has_melted_bits.size(),
+           [=] ADAMANTINE_HOST_DEV(int i) mutable
+           {
+             unsigned int const first_cell = 32 * i;
+             unsigned int const last_cell =
+                 (first_cell + 32 < n_cells) ? first_cell + 32 : n_cells;
+             std::uint32_t word = has_melted_bits_view(i);
+             for (unsigned int j = first_cell; j < last_cell; ++j)
+               if (temperature_average_local[mp_indices_view(j)] >
+                   threshold_temperature)
+                 word |= std::uint32_t(1) << (j - first_cell);
+             has_melted_bits_view(i) = word;
+           });
+  _has_melted_host_outdated = true;
+}
 
-  dealii::hp::FEValues<dim> hp_fe_values(
-      _dof_handler.get_fe_collection(), _q_collection,
-      dealii::UpdateFlags::update_values |
-          dealii::UpdateFlags::update_JxW_values);
+template <int dim, int fe_degree, typename MemorySpaceType,
+          typename QuadratureType>
+void ThermalPhysics<dim, fe_degree, MemorySpaceType,
+                    QuadratureType>::update_has_melted_on_device()
+{
+  if (!_has_melted_device_outdated)
+    return;
 
-  unsigned int const n_q_points = _q_collection.max_n_quadrature_points();
-  unsigned int cell_id = 0;
+  std::vector<unsigned int> mp_indices;
+  mp_indices.reserve(_has_melted.size());
   for (auto const &cell : dealii::filter_iterators(
            _dof_handler.active_cell_iterators(),
            dealii::IteratorFilters::LocallyOwnedCell(),
            dealii::IteratorFilters::ActiveFEIndexEqualTo(0)))
-  {
-    if (!_has_melted[cell_id])
-    {
-      hp_fe_values.reinit(cell);
-      dealii::FEValues<dim> const &fe_values =
-          hp_fe_values.get_present_fe_values();
+    mp_indices.push_back(_material_properties.get_dof_index(cell));
 
-      std::vector<dealii::types::global_dof_index> local_dof_indices(
-          fe_values.dofs_per_cell);
-      cell->get_dof_indices(local_dof_indices);
+  std::vector<std::uint32_t> has_melted_bits((_has_melted.size() + 31) / 32,
+                                             0);
+  for (unsigned int i = 0; i < _has_melted.size(); ++i)
+    if (_has_melted[i])
+      has_melted_bits[i / 32] |= std::uint32_t(1) << (i % 32);
 
-      double cell_temperature = 0.0;
-      double cell_volume = 0.0;
-      for (unsigned int i = 0; i < dofs_per_cell; ++i)
-      {
-        for (unsigned int q = 0; q < n_q_points; ++q)
-        {
-          cell_temperature += fe_values.shape_value(i, q) *
-                              temperature(local_dof_indices[i]) *
-                              fe_values.JxW(q);
-          cell_volume += fe_values.shape_value(i, q) * fe_values.JxW(q);
-        }
-      }
-      cell_temperature /= cell_volume;
+  _has_melted_mp_indices.reinit(mp_indices);
+  _has_melted_bits.reinit(has_melted_bits);
+  _has_melted_device_outdated = false;
+}
 
-      // Set the indicator that this cell has melted
-      if (cell_temperature > threshold_temperature)
-      {
-        _has_melted[cell_id] = true;
-      }
-    }
-    ++cell_id;
-  }
+template <int dim, int fe_degree, typename MemorySpaceType,
+          typename QuadratureType>
+void ThermalPhysics<dim, fe_degree, MemorySpaceType,
+                    QuadratureType>::update_has_melted_on_host() const
+{
+  if (!_has_melted_host_outdated)
+    return;
+
+  MemoryBlock<std::uint32_t, dealii::MemorySpace::Host> has_melted_bits(
+      _has_melted_bits);
+  MemoryBlockView<std::uint32_t, dealii::MemorySpace::Host>
+      has_melted_bits_view(has_melted_bits);
+  for (unsigned int i = 0; i < _has_melted.size(); ++i)
+    _has_melted[i] = (has_melted_bits_view(i / 32) >> (i % 32)) & 1;
+  _has_melted_host_outdated = false;
 }
 
 template <int dim, int fe_degree, typename MemorySpaceType,
@@ -643,6 +922,16 @@ void ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
   CALI_CXX_MARK_FUNCTION;
 #endif
 
+  update_has_melted_on_host();
+  if (_incremental_activation)
+  {
+    add_material_incremental(elements_to_activate, new_deposition_cos,
+                             new_deposition_sin, new_has_melted,
+                             activation_start, activation_end,
+                             new_material_temperature, solution);
+    return;
+  }
+
   // Update the material state from the ThermalOperator to MaterialProperty
   // because, for now, we need to use state from MaterialProperty to perform the
   // transfer to the refined mesh.
@@ -798,6 +1087,7 @@ void ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
   _deposition_cos.clear();
   _deposition_sin.clear();
   _has_melted.clear();
+  _has_melted_device_outdated = true;
   cell_id = 0;
   active_cell_id = 0;
   for (auto const &cell : _dof_handler.active_cell_iterators())
@@ -863,6 +1153,139 @@ void ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
   solution.import(rw_solution, dealii::VectorOperation::insert);
 }
 
+template <int dim, int fe_degree, typename MemorySpaceType,
+          typename QuadratureType>
+void ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
+    add_material_incremental(
+        std::vector<std::vector<
+            typename dealii::DoFHandler<dim>::active_cell_iterator>> const
+            &elements_to_activate,
+        std::vector<double> const &new_deposition_cos,
+        std::vector<double> const &new_deposition_sin,
+        std::vector<bool> &new_has_melted, unsigned int const activation_start,
+        unsigned int const activation_end,
+        double const new_material_temperature,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> &solution)
+{
+#ifdef ADAMANTINE_WITH_CALIPER
+  CALI_CXX_MARK_FUNCTION;
+#endif
+
+  // The material state is not transferred, we only need to make sure that
+  // MaterialProperty is up-to-date.
+  set_state_to_material_properties();
+
+  _thermal_operator->clear();
+
+  // The Triangulation is not modified, so the cell iterators stay valid and we
+  // can save the data on the cells directly. We need to move the solution on
+  // the host to access the values on the cells.
+  solution.update_ghost_values();
+  dealii::IndexSet rw_index_set = solution.locally_owned_elements();
+  rw_index_set.add_indices(solution.get_partitioner()->ghost_indices());
+  dealii::LA::ReadWriteVector<double> rw_solution(rw_index_set);
+  rw_solution.import(solution, dealii::VectorOperation::insert);
+
+  using cell_iterator = typename dealii::DoFHandler<dim>::active_cell_iterator;
+  unsigned int const n_dofs_per_cell = _dof_handler.get_fe().n_dofs_per_cell();
+  std::map<cell_iterator, dealii::Vector<double>> cell_solutions;
+  std::map<cell_iterator, unsigned int> cell_to_id;
+  unsigned int cell_id = 0;
+  for (auto const &cell : dealii::filter_iterators(
+           _dof_handler.active_cell_iterators(),
+           dealii::IteratorFilters::LocallyOwnedCell(),
+           dealii::IteratorFilters::ActiveFEIndexEqualTo(0)))
+  {
+    dealii::Vector<double> cell_solution(n_dofs_per_cell);
+    cell->get_dof_values(rw_solution, cell_solution);
+    cell_solutions.emplace(cell, std::move(cell_solution));
+    cell_to_id[cell] = cell_id;
+    ++cell_id;
+  }
+
+  // Activate elements by updating the fe_index directly instead of going
+  // through Triangulation::execute_coarsening_and_refinement(). This avoids
+  // the repartitioning of the mesh and the transfer of all the cell data.
+  std::map<cell_iterator, unsigned int> new_cell_to_deposition;
+  for (unsigned int i = activation_start; i < activation_end; ++i)
+  {
+    for (auto const &cell : elements_to_activate[i])
+    {
+      if (cell->is_locally_owned() && (cell->active_fe_index() != 0))
+      {
+        cell->set_active_fe_index(0);
+        new_cell_to_deposition[cell] = i;
+        new_has_melted[i] = false;
+      }
+    }
+  }
+
+  setup_dofs();
+
+  // Recompute the inverse of the mass matrix
+  compute_inverse_mass_matrix();
+
+  // Set the solution on the cells that were already active. The other dofs are
+  // set to the temperature of the new material.
+  initialize_dof_vector(std::numeric_limits<double>::infinity(), solution);
+  rw_index_set = solution.locally_owned_elements();
+  rw_index_set.add_indices(solution.get_partitioner()->ghost_indices());
+  rw_solution.reinit(rw_index_set);
+  for (auto val : solution.locally_owned_elements())
+    rw_solution[val] = new_material_temperature;
+
+  std::vector<double> deposition_cos;
+  std::vector<double> deposition_sin;
+  std::vector<bool> has_melted;
+  for (auto const &cell : dealii::filter_iterators(
+           _dof_handler.active_cell_iterators(),
+           dealii::IteratorFilters::LocallyOwnedCell(),
+           dealii::IteratorFilters::ActiveFEIndexEqualTo(0)))
+  {
+    auto const cell_solution = cell_solutions.find(cell);
+    if (cell_solution != cell_solutions.end())
+    {
+      cell->set_dof_values(cell_solution->second, rw_solution);
+      unsigned int const id = cell_to_id[cell];
+      deposition_cos.push_back(_deposition_cos[id]);
+      deposition_sin.push_back(_deposition_sin[id]);
+      has_melted.push_back(_has_melted[id]);
+    }
+    else
+    {
+      unsigned int const i = new_cell_to_deposition[cell];
+      deposition_cos.push_back(new_deposition_cos[i]);
+      deposition_sin.push_back(new_deposition_sin[i]);
+      has_melted.push_back(new_has_melted[i]);
+    }
+  }
+  _deposition_cos.swap(deposition_cos);
+  _deposition_sin.swap(deposition_sin);
+  _has_melted.swap(has_melted);
+  _has_melted_device_outdated = true;
+
+  get_state_from_material_properties();
+  _thermal_operator->set_material_deposition_orientation(_deposition_cos,
+                                                         _deposition_sin);
+
+  // Communicate the results.
+  solution.import(rw_solution, dealii::VectorOperation::insert);
+
+  // Set the value to the dofs that are only shared by newly activated cells.
+  // See add_material for the treatment of the hanging nodes.
+  rw_solution.reinit(solution.locally_owned_elements());
+  rw_solution.import(solution, dealii::VectorOperation::insert);
+  std::for_each(rw_solution.begin(), rw_solution.end(),
+                [&](double &val)
+                {
+                  if (val == std::numeric_limits<double>::infinity())
+                  {
+                    val = new_material_temperature;
+                  }
+                });
+  solution.import(rw_solution, dealii::VectorOperation::insert);
+}
+
 template <int dim, int fe_degree, typename MemorySpaceType,
           typename QuadratureType>
 void ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
@@ -905,18 +1328,63 @@ double ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
     temp_height = std::max(temp_height, source->get_current_height(t));
   }
   _current_source_height = temp_height;
+  // The sources are averaged over the time step so that the energy deposited
+  // does not depend on the positions of the beams at the stages.
+  if (_time_integrated_sources)
+  {
+    for (auto const &source : _heat_sources)
+      source->set_time_integration_interval(t, t + delta_t);
+  }
+  // A new Newton solve starts
+  _previous_newton_residual_norm = 0.;
+  _n_linear_iterations = 0;
+  _n_newton_iterations = 0;
 
   auto eval = [&](double const t, LA_Vector const &y)
   { return evaluate_thermal_physics(t, y, timers); };
   auto id_m_Jinv = [&](double const t, double const tau, LA_Vector const &y)
   { return id_minus_tau_J_inverse(t, tau, y, timers); };
 
-  double time = _time_stepping->evolve_one_time_step(eval, id_m_Jinv, t,
-                                                     delta_t, solution);
+  double time = 0.;
+  if (_dwell_mode)
+    time = imex_runge_kutta_step(t, delta_t, solution, timers);
+  else if (_multirate_sub_steps > 1)
+    time = multirate_forward_euler_step(t, delta_t, solution, timers);
+  else if (_imex_method)
+    time = imex_runge_kutta_step(t, delta_t, solution, timers);
+  else if (_rk_b.empty())
+  {
+    time = _time_stepping->evolve_one_time_step(eval, id_m_Jinv, t, delta_t,
+                                                solution);
+    if (_implicit_method)
+    {
+      _n_newton_iterations =
+          static_cast<dealii::TimeStepping::ImplicitRungeKutta<LA_Vector> *>(
+              _time_stepping.get())
+              ->get_status()
+              .n_iterations;
+    }
+  }
+  else
+    time = explicit_runge_kutta_step(t, delta_t, solution, timers);
 
-  // If the method is embedded, get the next time step. Otherwise, just use the
-  // current time step.
-  if (_embedded_method == false)
+  _thermal_operator->update_sleeping_cell_batches(solution);
+
+  // If the method is embedded, get the next time step. If the method is
+  // implicit and adaptive, the next time step depends on the number of Newton
+  // iterations. Otherwise, and during the dwell periods, just use the current
+  // time step.
+  if (_dwell_mode)
+    _delta_t_guess = delta_t;
+  else if (_adaptive_time_step)
+  {
+    dealii::TimeStepping::ImplicitRungeKutta<LA_Vector> *implicit_rk =
+        static_cast<dealii::TimeStepping::ImplicitRungeKutta<LA_Vector> *>(
+            _time_stepping.get());
+    _delta_t_guess = compute_implicit_time_step(
+        delta_t, implicit_rk->get_status().n_iterations);
+  }
+  else if (_embedded_method == false)
     _delta_t_guess = delta_t;
   else
   {
@@ -932,6 +1400,273 @@ double ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
   return time;
 }
 
+template <int dim, int fe_degree, typename MemorySpaceType,
+          typename QuadratureType>
+double ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
+    explicit_runge_kutta_step(
+        double t, double delta_t,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> &solution,
+        std::vector<Timer> &timers)
+{
+  // The vectors are only reallocated when the mesh or the set of active cells
+  // changes. Otherwise, the stages do not allocate, and thus do not
+  // synchronize the device, and the kernels can be queued ahead of time.
+  unsigned int const n_stages = _rk_b.size();
+  if ((_rk_stages.size() != n_stages) ||
+      (_rk_stages[0].get_partitioner() != solution.get_partitioner()) ||
+      (_rk_solution.get_partitioner() != solution.get_partitioner()))
+  {
+    _rk_stages.resize(n_stages);
+    for (auto &stage : _rk_stages)
+      stage.reinit(solution.get_partitioner());
+    _rk_solution.reinit(solution.get_partitioner());
+  }
+
+  for (unsigned int i = 0; i < n_stages; ++i)
+  {
+    if (i == 0)
+    {
+      evaluate_thermal_physics(t + _rk_c[i] * delta_t, solution, _rk_stages[i],
+                               timers);
+    }
+    else
+    {
+      _rk_solution = solution;
+      for (unsigned int j = 0; j < i; ++j)
+      {
+        if (_rk_a[i - 1][j] != 0.)
+          _rk_solution.add(delta_t * _rk_a[i - 1][j], _rk_stages[j]);
+      }
+      evaluate_thermal_physics(t + _rk_c[i] * delta_t, _rk_solution,
+                               _rk_stages[i], timers);
+    }
+  }
+
+  for (unsigned int i = 0; i < n_stages; ++i)
+    solution.add(delta_t * _rk_b[i], _rk_stages[i]);
+
+  return t + delta_t;
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType,
+          typename QuadratureType>
+void ThermalPhysics<dim, fe_degree, MemorySpaceType,
+                    QuadratureType>::set_dwell_mode(bool dwell_mode)
+{
+  if (!_dwell_imex || (_dwell_mode == dwell_mode))
+    return;
+
+  // The IMEX method needs the frozen coefficients, which would only slow down
+  // the explicit method.
+  _dwell_mode = dwell_mode;
+  _thermal_operator->set_frozen_coefficients(
+      _dwell_mode || _jacobi_preconditioner || _chebyshev_preconditioner ||
+      _use_amg);
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType,
+          typename QuadratureType>
+void ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
+    set_imex_tableaus(std::string const &method)
+{
+  // The IMEX methods are not provided by deal.II. We use the methods of
+  // Ascher, Ruuth, and Spiteri, Applied Numerical Mathematics 25 (1997).
+  if (method.compare("imex_euler") == 0)
+  {
+    _imex_a_explicit = {{1.}};
+    _imex_a_implicit = {{0., 1.}};
+    _imex_c = {0., 1.};
+  }
+  else if (method.compare("imex_ars222") == 0)
+  {
+    double const gamma = 1. - std::sqrt(2.) / 2.;
+    double const delta = 1. - 1. / (2. * gamma);
+    _imex_a_explicit = {{gamma}, {delta, 1. - delta}};
+    _imex_a_implicit = {{0., gamma}, {0., 1. - gamma, gamma}};
+    _imex_c = {0., gamma, 1.};
+  }
+  else if (method.compare("imex_ars443") == 0)
+  {
+    _imex_a_explicit = {{0.5},
+                        {11. / 18., 1. / 18.},
+                        {5. / 6., -5. / 6., 0.5},
+                        {0.25, 1.75, 0.75, -1.75}};
+    _imex_a_implicit = {{0., 0.5},
+                        {0., 1. / 6., 0.5},
+                        {0., -0.5, 0.5, 0.5},
+                        {0., 1.5, -1.5, 0.5, 0.5}};
+    _imex_c = {0., 0.5, 2. / 3., 0.5, 1.};
+  }
+  else
+  {
+    ASSERT_THROW(false, "Unknown IMEX method " + method +
+                            ". The choices are imex_euler, imex_ars222, and "
+                            "imex_ars443.");
+  }
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType,
+          typename QuadratureType>
+double ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
+    multirate_forward_euler_step(
+        double t, double delta_t,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> &solution,
+        std::vector<Timer> &timers)
+{
+  if constexpr (std::is_same_v<MemorySpaceType, dealii::MemorySpace::Host>)
+  {
+    if (_multirate_rate.get_partitioner() != solution.get_partitioner())
+    {
+      _multirate_rate.reinit(solution.get_partitioner());
+      _multirate_fast_rate.reinit(solution.get_partitioner());
+
+      // A dof is fast if it belongs to a fast cell, including the cells owned
+      // by other processors.
+      LA_Vector fast_dofs(solution.get_partitioner());
+      std::vector<dealii::types::global_dof_index> dof_indices;
+      for (auto const &cell : dealii::filter_iterators(
+               _dof_handler.active_cell_iterators(),
+               dealii::IteratorFilters::LocallyOwnedCell(),
+               dealii::IteratorFilters::ActiveFEIndexEqualTo(0)))
+      {
+        if (cell->level() >= static_cast<int>(_multirate_level))
+        {
+          dof_indices.resize(cell->get_fe().dofs_per_cell);
+          cell->get_dof_indices(dof_indices);
+          for (auto const dof : dof_indices)
+            fast_dofs(dof) = 1.;
+        }
+      }
+      fast_dofs.compress(dealii::VectorOperation::max);
+
+      _multirate_fast_dofs.clear();
+      unsigned int const local_size = fast_dofs.locally_owned_size();
+      for (unsigned int i = 0; i < local_size; ++i)
+        if (fast_dofs.local_element(i) > 0.)
+          _multirate_fast_dofs.push_back(i);
+    }
+
+    auto const &inverse_mass_matrix =
+        *_thermal_operator->get_inverse_mass_matrix();
+    double const sub_delta_t = delta_t / _multirate_sub_steps;
+
+    // The slow dofs only belong to slow cells and they are advanced with the
+    // whole time step. The fast dofs are advanced with the first sub-step. The
+    // difference between the rate and the contribution of the fast cells is
+    // the coupling with the slow cells, which is frozen for the next sub-steps.
+    evaluate_thermal_physics(t, solution, _multirate_rate, timers);
+    _thermal_operator->fast_cells_vmult(_multirate_fast_rate, solution);
+    solution.add(delta_t, _multirate_rate);
+    for (auto const i : _multirate_fast_dofs)
+    {
+      solution.local_element(i) +=
+          (sub_delta_t - delta_t) * _multirate_rate.local_element(i);
+      _multirate_rate.local_element(i) -=
+          inverse_mass_matrix.local_element(i) *
+          _multirate_fast_rate.local_element(i);
+    }
+
+    for (unsigned int k = 1; k < _multirate_sub_steps; ++k)
+    {
+      timers[evol_time_eval_th_ph].start();
+      _thermal_operator->set_time_and_source_height(t + k * sub_delta_t,
+                                                    _current_source_height);
+      _thermal_operator->fast_cells_vmult(_multirate_fast_rate, solution);
+      timers[evol_time_eval_th_ph].stop();
+      for (auto const i : _multirate_fast_dofs)
+      {
+        solution.local_element(i) +=
+            sub_delta_t * (inverse_mass_matrix.local_element(i) *
+                               _multirate_fast_rate.local_element(i) +
+                           _multirate_rate.local_element(i));
+      }
+    }
+  }
+  else
+  {
+    ASSERT_THROW_NOT_IMPLEMENTED();
+  }
+
+  return t + delta_t;
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType,
+          typename QuadratureType>
+double ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
+    imex_runge_kutta_step(
+        double t, double delta_t,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> &solution,
+        std::vector<Timer> &timers)
+{
+  unsigned int const n_stages = _imex_c.size();
+  if ((_imex_explicit_stages.size() != n_stages) ||
+      (_imex_explicit_stages[0].get_partitioner() !=
+       solution.get_partitioner()) ||
+      (_rk_solution.get_partitioner() != solution.get_partitioner()))
+  {
+    _imex_explicit_stages.resize(n_stages);
+    _imex_implicit_stages.resize(n_stages);
+    for (unsigned int i = 0; i < n_stages; ++i)
+    {
+      _imex_explicit_stages[i].reinit(solution.get_partitioner());
+      _imex_implicit_stages[i].reinit(solution.get_partitioner());
+    }
+    _rk_solution.reinit(solution.get_partitioner());
+  }
+
+  // Split the operator into an implicit part, the diffusion with the
+  // coefficients frozen at the beginning of the time step, and an explicit
+  // part, the rest of the operator. The coefficients are frozen once per time
+  // step so that the same splitting is used by all the stages. The implicit
+  // part of the later stages is the one given by the implicit solve, so that
+  // the sum of the two parts is the operator at every stage.
+  auto const inverse_mass_matrix = _thermal_operator->get_inverse_mass_matrix();
+  evaluate_thermal_physics(t, solution, _imex_explicit_stages[0], timers);
+  _thermal_operator->jacobian_vmult(_imex_implicit_stages[0], solution);
+  _imex_implicit_stages[0].scale(*inverse_mass_matrix);
+  _imex_explicit_stages[0] -= _imex_implicit_stages[0];
+  _thermal_operator->hold_frozen_coefficients(true);
+  for (unsigned int i = 1; i < n_stages; ++i)
+  {
+    _rk_solution = solution;
+    for (unsigned int j = 0; j < i; ++j)
+    {
+      if (_imex_a_explicit[i - 1][j] != 0.)
+        _rk_solution.add(delta_t * _imex_a_explicit[i - 1][j],
+                         _imex_explicit_stages[j]);
+      if (_imex_a_implicit[i - 1][j] != 0.)
+        _rk_solution.add(delta_t * _imex_a_implicit[i - 1][j],
+                         _imex_implicit_stages[j]);
+    }
+
+    // Solve (I - tau M^{-1} J) y_i = rhs. The linear systems of the different
+    // stages are independent so the stall detection of the preconditioner is
+    // reset.
+    double const tau = delta_t * _imex_a_implicit[i - 1][i];
+    _previous_newton_residual_norm = 0.;
+    LA_Vector stage_solution = id_minus_tau_J_inverse(
+        t + _imex_c[i] * delta_t, tau, _rk_solution, timers);
+
+    // The implicit part of the stage satisfies y_i = rhs + tau M^{-1} J y_i.
+    _imex_implicit_stages[i] = stage_solution;
+    _imex_implicit_stages[i] -= _rk_solution;
+    _imex_implicit_stages[i] /= tau;
+
+    // The methods are stiffly accurate: the last stage is the solution.
+    if (i == n_stages - 1)
+      solution.swap(stage_solution);
+    else
+    {
+      evaluate_thermal_physics(t + _imex_c[i] * delta_t, stage_solution,
+                               _imex_explicit_stages[i], timers);
+      _imex_explicit_stages[i] -= _imex_implicit_stages[i];
+    }
+  }
+  _thermal_operator->hold_frozen_coefficients(false);
+
+  return t + delta_t;
+}
+
 template <int dim, int fe_degree, typename MemorySpaceType,
           typename QuadratureType>
 void ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
@@ -970,6 +1705,42 @@ void ThermalPhysics<dim, fe_degree, MemorySpaceType,
   _thermal_operator->set_state_to_material_properties();
 }
 
+template <int dim, int fe_degree, typename MemorySpaceType,
+          typename QuadratureType>
+void ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
+    add_memory_consumption(MemoryReport &memory_report) const
+{
+  memory_report.add("thermal_dof_handler", _dof_handler.memory_consumption());
+  memory_report.add("thermal_affine_constraints",
+                    _affine_constraints.memory_consumption());
+  memory_report.add("thermal_operator",
+                    _thermal_operator->memory_consumption());
+
+  std::size_t time_stepping = _rk_solution.memory_consumption() +
+                              _multirate_rate.memory_consumption() +
+                              _multirate_fast_rate.memory_consumption() +
+                              dealii::MemoryConsumption::memory_consumption(
+                                  _multirate_fast_dofs);
+  for (auto const &stage : _rk_stages)
+    time_stepping += stage.memory_consumption();
+  for (auto const &stage : _imex_explicit_stages)
+    time_stepping += stage.memory_consumption();
+  for (auto const &stage : _imex_implicit_stages)
+    time_stepping += stage.memory_consumption();
+  memory_report.add("thermal_time_stepping", time_stepping);
+  memory_report.add(
+      "thermal_preconditioner",
+      _preconditioner_inverse_diagonal->get_vector().memory_consumption() +
+          _implicit_matrix.memory_consumption());
+
+  memory_report.add(
+      "thermal_deposition",
+      dealii::MemoryConsumption::memory_consumption(_deposition_cos) +
+          dealii::MemoryConsumption::memory_consumption(_deposition_sin) +
+          _has_melted.capacity() / 8 + _has_melted_bits.memory_consumption() +
+          _has_melted_mp_indices.memory_consumption());
+}
+
 template <int dim, int fe_degree, typename MemorySpaceType,
           typename QuadratureType>
 dealii::LA::distributed::Vector<double, MemorySpaceType>
@@ -978,25 +1749,89 @@ ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
         double const t,
         dealii::LA::distributed::Vector<double, MemorySpaceType> const &y,
         std::vector<Timer> &timers) const
+{
+  LA_Vector value(y.get_partitioner());
+  evaluate_thermal_physics(t, y, value, timers);
+
+  return value;
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType,
+          typename QuadratureType>
+void ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
+    evaluate_thermal_physics(
+        double const t,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> const &y,
+        dealii::LA::distributed::Vector<double, MemorySpaceType> &value,
+        std::vector<Timer> &timers) const
 {
 #ifdef ADAMANTINE_WITH_CALIPER
   CALI_CXX_MARK_FUNCTION;
 #endif
-  if constexpr (std::is_same<MemorySpaceType, dealii::MemorySpace::Host>::value)
+  evaluate_thermal_physics_impl<dim, fe_degree, MemorySpaceType>(
+      _thermal_operator, t, _current_source_height, y, value, timers);
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType,
+          typename QuadratureType>
+double ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
+    compute_implicit_time_step(double const delta_t,
+                               unsigned int const n_newton_iterations) const
+{
+  double next_delta_t = delta_t;
+  if (n_newton_iterations < _newton_target_iteration)
+    next_delta_t *= _coarsening_parameter;
+  else if (n_newton_iterations > _newton_target_iteration)
+    next_delta_t *= _refining_parameter;
+
+  return std::clamp(next_delta_t, _min_time_step, _max_time_step);
+}
+
+template <int dim, int fe_degree, typename MemorySpaceType,
+          typename QuadratureType>
+void ThermalPhysics<dim, fe_degree, MemorySpaceType,
+                    QuadratureType>::build_amg_preconditioner(double const tau)
+    const
+{
+  if constexpr (std::is_same_v<MemorySpaceType, dealii::MemorySpace::Host>)
   {
-    return evaluate_thermal_physics_impl<dim, fe_degree, MemorySpaceType>(
-        _thermal_operator, t, _current_source_height, y, timers);
+    // Assemble M - tau J. The constrained dofs are decoupled from the other
+    // dofs, so their rows are set to the identity like the rows of the mass
+    // matrix.
+    _thermal_operator->compute_jacobian_matrix(_implicit_matrix);
+    _implicit_matrix *= -tau;
+    auto const &inverse_mass_matrix =
+        *_thermal_operator->get_inverse_mass_matrix();
+    dealii::IndexSet const &locally_owned_dofs =
+        _dof_handler.locally_owned_dofs();
+    unsigned int const local_size = inverse_mass_matrix.locally_owned_size();
+    for (unsigned int i = 0; i < local_size; ++i)
+    {
+      auto const dof = locally_owned_dofs.nth_index_in_set(i);
+      if (!_affine_constraints.is_constrained(dof))
+        _implicit_matrix.add(dof, dof,
+                             1. / inverse_mass_matrix.local_element(i));
+    }
+    _implicit_matrix.compress(dealii::VectorOperation::add);
+    for (unsigned int i = 0; i < local_size; ++i)
+    {
+      auto const dof = locally_owned_dofs.nth_index_in_set(i);
+      if (_affine_constraints.is_constrained(dof))
+        _implicit_matrix.set(dof, dof, 1.);
+    }
+    _implicit_matrix.compress(dealii::VectorOperation::insert);
+
+    dealii::TrilinosWrappers::PreconditionAMG::AdditionalData amg_data;
+    amg_data.elliptic = true;
+    amg_data.higher_order_elements = fe_degree > 1;
+    amg_data.smoother_sweeps = 2;
+    amg_data.aggregation_threshold = 0.02;
+    _amg_preconditioner.initialize(_implicit_matrix, amg_data);
   }
   else
   {
-    return evaluate_thermal_physics_impl<dim, fe_degree, MemorySpaceType>(
-        _thermal_operator, _fe_collection, t, _dof_handler, _heat_sources,
-        _current_source_height, _boundary_type, _material_properties,
-        _affine_constraints, y, timers);
+    ASSERT_THROW_NOT_IMPLEMENTED();
   }
-
-  // Dummy to silence warning
-  return dealii::LA::distributed::Vector<double, MemorySpaceType>();
 }
 
 template <int dim, int fe_degree, typename MemorySpaceType,
@@ -1013,10 +1848,25 @@ ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
   dealii::LA::distributed::Vector<double, MemorySpaceType> solution(
       y.get_partitioner());
 
-  // TODO Add a geometric multigrid preconditioner.
-  dealii::PreconditionIdentity preconditioner;
-
-  dealii::SolverControl solver_control(_max_iter, _tolerance * y.l2_norm());
+  // y is the residual of the current Newton iteration. With the
+  // Eisenstat-Walker forcing terms, the linear system is only solved accurately
+  // when the Newton solver is close to convergence.
+  double const residual_norm = y.l2_norm();
+  double relative_tolerance = _tolerance;
+  if (_adaptive_linear_tolerance && (residual_norm > 0.))
+  {
+    _forcing_term = compute_forcing_term(
+        residual_norm, _previous_newton_residual_norm, _forcing_term,
+        std::max(_tolerance, 0.5 * _newton_tolerance / residual_norm));
+    relative_tolerance = _forcing_term;
+  }
+  // If the Newton solver stalls, the preconditioner is rebuilt.
+  if ((_previous_newton_residual_norm > 0.) &&
+      (residual_norm > 0.9 * _previous_newton_residual_norm))
+    _refresh_preconditioner = true;
+  _previous_newton_residual_norm = residual_norm;
+  dealii::SolverControl solver_control(_max_iter,
+                                       relative_tolerance * residual_norm);
   // We need to inverse (I - tau M^{-1} J). While M^{-1} and J are SPD,
   // (I - tau M^{-1} J) is symmetric indefinite in the general case.
   typename dealii::SolverGMRES<
@@ -1024,7 +1874,98 @@ ThermalPhysics<dim, fe_degree, MemorySpaceType, QuadratureType>::
       additional_data(_max_n_tmp_vectors, _right_preconditioning);
   dealii::SolverGMRES<dealii::LA::distributed::Vector<double, MemorySpaceType>>
       solver(solver_control, additional_data);
-  solver.solve(*_implicit_operator, solution, y, preconditioner);
+
+  bool solved = false;
+  if constexpr (std::is_same_v<MemorySpaceType, dealii::MemorySpace::Host>)
+  {
+    if (_jacobi_preconditioner || _chebyshev_preconditioner || _use_amg)
+    {
+      // The preconditioners are built from the Jacobian with the frozen
+      // coefficients at the current linearization point. When they are
+      // reused, they are only rebuilt if tau or the mesh changed, or if the
+      // convergence deteriorated.
+      bool const rebuild = !_reuse_preconditioner ||
+                           _refresh_preconditioner ||
+                           (_preconditioner_tau != tau);
+      if (rebuild)
+      {
+        if (_use_amg)
+          build_amg_preconditioner(tau);
+        else
+        {
+          auto &inverse_diagonal =
+              _preconditioner_inverse_diagonal->get_vector();
+          _thermal_operator->compute_jacobian_diagonal(inverse_diagonal);
+          _implicit_operator->compute_inverse_diagonal(inverse_diagonal);
+        }
+        _preconditioner_tau = tau;
+      }
+
+      if (_jacobi_preconditioner)
+      {
+        solver.solve(*_implicit_operator, solution, y,
+                     *_preconditioner_inverse_diagonal);
+      }
+      else if (_chebyshev_preconditioner)
+      {
+        // With the frozen coefficients, M - tau J is SPD. Since M is diagonal,
+        // the ImplicitOperator preconditioned by its diagonal D is similar to
+        // (MD)^{-1/2} (M - tau J) (MD)^{-1/2}, so its spectrum is real and
+        // positive. The operator is however not symmetric for the Euclidean
+        // inner product, so the largest eigenvalue is estimated with the power
+        // iteration instead of the Lanczos algorithm. The estimate is reused
+        // with the diagonal.
+        using PreconditionerType =
+            dealii::PreconditionChebyshev<ImplicitOperator<MemorySpaceType>,
+                                          LA_Vector>;
+        typename PreconditionerType::AdditionalData chebyshev_data;
+        chebyshev_data.degree = _chebyshev_degree;
+        chebyshev_data.smoothing_range = 20.;
+        chebyshev_data.eigenvalue_algorithm =
+            PreconditionerType::AdditionalData::EigenvalueAlgorithm::
+                power_iteration;
+        chebyshev_data.eig_cg_n_iterations = 20;
+        if (!rebuild)
+        {
+          chebyshev_data.eig_cg_n_iterations = 0;
+          chebyshev_data.max_eigenvalue = _chebyshev_max_eigenvalue;
+        }
+        chebyshev_data.preconditioner = _preconditioner_inverse_diagonal;
+        PreconditionerType preconditioner;
+        preconditioner.initialize(*_implicit_operator, chebyshev_data);
+        if (rebuild)
+        {
+          _chebyshev_max_eigenvalue =
+              preconditioner.estimate_eigenvalues(y).max_eigenvalue_estimate;
+        }
+        solver.solve(*_implicit_operator, solution, y, preconditioner);
+      }
+      else
+      {
+        ImplicitAMGPreconditioner const preconditioner(
+            _amg_preconditioner, *_thermal_operator->get_inverse_mass_matrix());
+        solver.solve(*_implicit_operator, solution, y, preconditioner);
+      }
+
+      if (rebuild)
+      {
+        _preconditioner_n_iterations = solver_control.last_step();
+        _refresh_preconditioner = false;
+      }
+      else if (solver_control.last_step() > 2 * _preconditioner_n_iterations)
+      {
+        _refresh_preconditioner = true;
+      }
+      solved = true;
+    }
+  }
+
+  if (!solved)
+  {
+    dealii::PreconditionIdentity preconditioner;
+    solver.solve(*_implicit_operator, solution, y, preconditioner);
+  }
+  _n_linear_iterations += solver_control.last_step();
 
   timers[evol_time_J_inv].stop();
 
@@ -14,10 +14,12 @@
 #include <deal.II/dofs/dof_handler.h>
 #include <deal.II/lac/affine_constraints.h>
 #include <deal.II/lac/la_parallel_vector.h>
+#include <deal.II/lac/vector.h>
 
 namespace adamantine
 {
 // Forward declarations
+class MemoryReport;
 class Timer;
 
 template <int dim>
@@ -42,6 +44,12 @@ public:
    */
   virtual void setup_dofs() = 0;
 
+  /**
+   * Set the Timer used to measure the time spent renumbering the degrees of
+   * freedom in setup_dofs().
+   */
+  virtual void set_dof_renumbering_timer(Timer &timer) = 0;
+
   /**
    * Compute the inverse of the mass matrix associated to the Physics.
    */
@@ -84,6 +92,25 @@ public:
    */
   virtual double get_delta_t_guess() const = 0;
 
+  /**
+   * Return the number of iterations of the linear solver during the last time
+   * step.
+   */
+  virtual unsigned int get_n_linear_iterations() const = 0;
+
+  /**
+   * Return the number of Newton iterations during the last time step. This is
+   * zero if the time stepping method is not implicit.
+   */
+  virtual unsigned int get_n_newton_iterations() const = 0;
+
+  /**
+   * Enable or disable the dwell mode used while the heat sources are off. In
+   * this mode, the time steps are much larger than the stable time step of an
+   * explicit method.
+   */
+  virtual void set_dwell_mode(bool dwell_mode) = 0;
+
   /**
    * Initialize the given vector.
    */
@@ -179,6 +206,21 @@ public:
    * Return the degree of the finite element.
    */
   virtual unsigned int get_fe_degree() const = 0;
+
+  /**
+   * Return the refinement indicator computed from the gradient of the
+   * @p temperature using the MatrixFree operator. The vector is indexed by the
+   * active cell index.
+   */
+  virtual dealii::Vector<float> compute_gradient_indicator(
+      dealii::LA::distributed::Vector<double, MemorySpaceType> const
+          &temperature) const = 0;
+
+  /**
+   * Add the memory used by the DoFHandler, the constraints, the operator, and
+   * the vectors of the time stepping to @p memory_report.
+   */
+  virtual void add_memory_consumption(MemoryReport &memory_report) const = 0;
 };
 } // namespace adamantine
 #endif
@@ -1,4 +1,4 @@
-/* Copyright (c) 2017 - 2021, the adamantine authors.
+/* Copyright (c) 2017 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -6,14 +6,19 @@
  */
 
 #include <Timer.hh>
+#include <utils.hh>
 
+#include <deal.II/base/mpi.h>
+
+#include <fstream>
+#include <functional>
 #include <iostream>
 
 namespace adamantine
 {
-Timer::Timer(MPI_Comm communicator, std::string const &section)
-    : _communicator(communicator), _section(section), _clock(), _t_start(),
-      _elapsed_time(boost::chrono::milliseconds(0))
+Timer::Timer(MPI_Comm communicator, std::string const &section, int parent)
+    : _communicator(communicator), _section(section), _parent(parent),
+      _clock(), _t_start(), _elapsed_time(boost::chrono::milliseconds(0))
 {
 }
 
@@ -36,8 +41,95 @@ void Timer::print()
   }
 }
 
-boost::chrono::process_real_cpu_clock::duration Timer::get_elapsed_time()
+boost::chrono::process_real_cpu_clock::duration
+Timer::get_elapsed_time() const
 {
   return _elapsed_time;
 }
+
+void print_timers(MPI_Comm communicator, std::vector<Timer> const &timers,
+                  std::string const &filename)
+{
+  unsigned int const n_timers = timers.size();
+  std::vector<double> elapsed_times(n_timers);
+  for (unsigned int i = 0; i < n_timers; ++i)
+  {
+    elapsed_times[i] =
+        boost::chrono::duration_cast<boost::chrono::milliseconds>(
+            timers[i].get_elapsed_time())
+            .count();
+  }
+  // All the timers are reduced using a single collective communication.
+  std::vector<dealii::Utilities::MPI::MinMaxAvg> const stats =
+      dealii::Utilities::MPI::min_max_avg(elapsed_times, communicator);
+
+  if (dealii::Utilities::MPI::this_mpi_process(communicator) != 0)
+    return;
+
+  std::vector<std::vector<unsigned int>> children(n_timers);
+  std::vector<unsigned int> roots;
+  for (unsigned int i = 0; i < n_timers; ++i)
+  {
+    int const parent = timers[i].get_parent();
+    ASSERT(parent < static_cast<int>(n_timers), "Unknown parent timer.");
+    if (parent < 0)
+      roots.push_back(i);
+    else
+      children[parent].push_back(i);
+  }
+  auto const imbalance = [&](unsigned int i)
+  { return stats[i].avg > 0. ? stats[i].max / stats[i].avg : 1.; };
+
+  std::function<void(unsigned int, unsigned int)> print_section =
+      [&](unsigned int i, unsigned int depth)
+  {
+    std::cout << std::string(2 * depth, ' ') << "Time elapsed in "
+              << timers[i].get_section() << ": min " << stats[i].min
+              << " ms, avg " << stats[i].avg << " ms, max " << stats[i].max
+              << " ms, imbalance " << imbalance(i) << std::endl;
+    for (auto const child : children[i])
+      print_section(child, depth + 1);
+  };
+  for (auto const root : roots)
+    print_section(root, 0);
+
+  if (filename.empty())
+    return;
+
+  std::ofstream file(filename);
+  ASSERT_THROW(file.good(), "Error: Cannot open the file " + filename + ".");
+  std::function<void(unsigned int, unsigned int)> write_section =
+      [&](unsigned int i, unsigned int depth)
+  {
+    std::string const indent(2 * depth, ' ');
+    file << indent << "{\n";
+    file << indent << "  \"section\": \"" << timers[i].get_section()
+         << "\",\n";
+    file << indent << "  \"min\": " << stats[i].min << ",\n";
+    file << indent << "  \"min_rank\": " << stats[i].min_index << ",\n";
+    file << indent << "  \"avg\": " << stats[i].avg << ",\n";
+    file << indent << "  \"max\": " << stats[i].max << ",\n";
+    file << indent << "  \"max_rank\": " << stats[i].max_index << ",\n";
+    file << indent << "  \"imbalance\": " << imbalance(i) << ",\n";
+    file << indent << "  \"children\": [";
+    for (unsigned int j = 0; j < children[i].size(); ++j)
+    {
+      file << ((j == 0) ? "\n" : ",\n");
+      write_section(children[i][j], depth + 2);
+    }
+    file << (children[i].empty() ? "]\n" : "\n" + indent + "  ]\n");
+    file << indent << "}";
+  };
+  file << "{\n";
+  file << "  \"unit\": \"ms\",\n";
+  file << "  \"n_processes\": "
+       << dealii::Utilities::MPI::n_mpi_processes(communicator) << ",\n";
+  file << "  \"timers\": [";
+  for (unsigned int j = 0; j < roots.size(); ++j)
+  {
+    file << ((j == 0) ? "\n" : ",\n");
+    write_section(roots[j], 2);
+  }
+  file << "\n  ]\n}\n";
+}
 } // namespace adamantine
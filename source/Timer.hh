@@ -11,15 +11,17 @@
 #include <boost/chrono/include.hpp>
 
 #include <string>
+#include <vector>
 
 #include <mpi.h>
 
 namespace adamantine
 {
 /**
- * This class measures the time spend in a given section by the rank 0 process.
+ * This class measures the time spend in a given section by each process.
  * This class does not use any MPI_Barrier to synchronize the timer among all
- * the processors.
+ * the processors. The timers are organized in a hierarchy: a section can be
+ * nested in another section, its parent.
  */
 class Timer
 {
@@ -30,9 +32,12 @@ public:
   Timer() = default;
 
   /**
-   * Constructor. The string @p section is used when the timing is output.
+   * Constructor. The string @p section is used when the timing is output. @p
+   * parent is the index of the timer of the enclosing section in the vector of
+   * timers given to print_timers(). A negative value means that the section is
+   * not nested.
    */
-  Timer(MPI_Comm communicator, std::string const &section);
+  Timer(MPI_Comm communicator, std::string const &section, int parent = -1);
 
   /**
    * Start the clock.
@@ -58,11 +63,22 @@ public:
   /**
    * Return the current elapsed time.
    */
-  boost::chrono::process_real_cpu_clock::duration get_elapsed_time();
+  boost::chrono::process_real_cpu_clock::duration get_elapsed_time() const;
+
+  /**
+   * Return the name of the section.
+   */
+  std::string const &get_section() const;
+
+  /**
+   * Return the index of the timer of the enclosing section.
+   */
+  int get_parent() const;
 
 private:
   MPI_Comm _communicator;
   std::string _section;
+  int _parent = -1;
   boost::chrono::process_cpu_clock _clock;
   boost::chrono::process_cpu_clock::time_point _t_start;
   /**
@@ -70,5 +86,20 @@ private:
    */
   boost::chrono::process_cpu_clock::duration _elapsed_time;
 };
+
+/**
+ * Print the elapsed time of the @p timers aggregated over the processors of
+ * @p communicator: the minimum, the average, the maximum, and the imbalance,
+ * i.e., the ratio between the maximum and the average. The times are
+ * reduced once for all the timers. The nested sections are printed below
+ * their parent. If @p filename is not empty, the report is also written in
+ * @p filename using the json format.
+ */
+void print_timers(MPI_Comm communicator, std::vector<Timer> const &timers,
+                  std::string const &filename = "");
+
+inline std::string const &Timer::get_section() const { return _section; }
+
+inline int Timer::get_parent() const { return _parent; }
 } // namespace adamantine
 #endif
@@ -0,0 +1,77 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <binding_report.hh>
+
+#include <deal.II/base/mpi.h>
+#include <deal.II/base/multithread_info.h>
+#include <deal.II/base/utilities.h>
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace adamantine
+{
+std::vector<unsigned int> get_process_cores()
+{
+  std::vector<unsigned int> cores;
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0)
+    for (unsigned int core = 0; core < CPU_SETSIZE; ++core)
+      if (CPU_ISSET(core, &cpu_set))
+        cores.push_back(core);
+#endif
+
+  return cores;
+}
+
+std::string format_core_list(std::vector<unsigned int> cores)
+{
+  std::sort(cores.begin(), cores.end());
+  cores.erase(std::unique(cores.begin(), cores.end()), cores.end());
+
+  std::string list;
+  for (unsigned int i = 0; i < cores.size();)
+  {
+    unsigned int j = i;
+    while ((j + 1 < cores.size()) && (cores[j + 1] == cores[j] + 1))
+      ++j;
+    if (!list.empty())
+      list += ",";
+    list += std::to_string(cores[i]);
+    if (j > i)
+      list += "-" + std::to_string(cores[j]);
+    i = j + 1;
+  }
+
+  return list;
+}
+
+void print_binding_report(MPI_Comm const &communicator, std::ostream &out)
+{
+  std::vector<unsigned int> const cores = get_process_cores();
+  std::string const binding =
+      dealii::Utilities::System::get_hostname() + ", " +
+      std::to_string(dealii::MultithreadInfo::n_threads()) +
+      " threads, cores " +
+      (cores.empty() ? std::string("unknown") : format_core_list(cores));
+
+  std::vector<std::string> const bindings =
+      dealii::Utilities::MPI::gather(communicator, binding);
+  if (dealii::Utilities::MPI::this_mpi_process(communicator) == 0)
+  {
+    out << "Process binding:" << std::endl;
+    for (unsigned int rank = 0; rank < bindings.size(); ++rank)
+      out << "  rank " << rank << ": " << bindings[rank] << std::endl;
+  }
+}
+} // namespace adamantine
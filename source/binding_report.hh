@@ -0,0 +1,39 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef BINDING_REPORT_HH
+#define BINDING_REPORT_HH
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+
+namespace adamantine
+{
+/**
+ * Return the cores on which the calling process is allowed to run. The list is
+ * empty if the binding cannot be queried on this platform.
+ */
+std::vector<unsigned int> get_process_cores();
+
+/**
+ * Return @p cores, sorted in increasing order, as a list of ranges, e.g.,
+ * "0-3,8,10-11".
+ */
+std::string format_core_list(std::vector<unsigned int> cores);
+
+/**
+ * Write, on the first processor of @p communicator, the host, the number of
+ * threads, and the cores to which every processor is bound. This function is
+ * collective.
+ */
+void print_binding_report(MPI_Comm const &communicator, std::ostream &out);
+} // namespace adamantine
+
+#endif
@@ -16,7 +16,9 @@
 
 #include <boost/algorithm/string.hpp>
 
+#include <cstdint>
 #include <fstream>
+#include <tuple>
 #include <unordered_set>
 
 namespace adamantine
@@ -67,17 +69,23 @@ get_dof_to_support_mapping(dealii::DoFHandler<dim> const &dof_handler)
 }
 
 template <int dim>
-std::pair<std::vector<int>, std::vector<int>>
-get_expt_to_dof_mapping(PointsValues<dim> const &points_values,
-                        dealii::DoFHandler<dim> const &dof_handler)
+ExperimentToDofMapper<dim>::ExperimentToDofMapper(
+    dealii::DoFHandler<dim> const &dof_handler)
 {
-  auto [dof_indices, support_points] = get_dof_to_support_mapping(dof_handler);
+  std::vector<dealii::Point<dim>> support_points;
+  std::tie(_dof_indices, support_points) =
+      get_dof_to_support_mapping(dof_handler);
+  _bvh = std::make_unique<dealii::ArborXWrappers::BVH>(support_points);
+}
 
+template <int dim>
+std::pair<std::vector<int>, std::vector<int>>
+ExperimentToDofMapper<dim>::map(PointsValues<dim> const &points_values) const
+{
   // Perform the search
-  dealii::ArborXWrappers::BVH bvh(support_points);
   dealii::ArborXWrappers::PointNearestPredicate pt_nearest(points_values.points,
                                                            1);
-  auto [indices, offset] = bvh.query(pt_nearest);
+  auto [indices, offset] = _bvh->query(pt_nearest);
 
   // Convert the indices and offsets to a pair that maps experimental indices to
   // dof indices
@@ -90,13 +98,23 @@ get_expt_to_dof_mapping(PointsValues<dim> const &points_values,
     for (int j = offset[i]; j < offset[i + 1]; ++j)
     {
       expt_to_dof_mapping.first[j] = i;
-      expt_to_dof_mapping.second[j] = dof_indices[indices[j]];
+      expt_to_dof_mapping.second[j] = _dof_indices[indices[j]];
     }
   }
 
   return expt_to_dof_mapping;
 }
 
+template <int dim>
+std::pair<std::vector<int>, std::vector<int>>
+get_expt_to_dof_mapping(PointsValues<dim> const &points_values,
+                        dealii::DoFHandler<dim> const &dof_handler)
+{
+  ExperimentToDofMapper<dim> expt_to_dof_mapper(dof_handler);
+
+  return expt_to_dof_mapper.map(points_values);
+}
+
 template <int dim>
 void set_with_experimental_data(
     MPI_Comm const &communicator, PointsValues<dim> const &points_values,
@@ -196,11 +214,81 @@ read_frame_timestamps(boost::property_tree::ptree const &experiment_database)
   return time_stamps;
 }
 
+std::vector<std::vector<double>>
+read_binary_frame_file(std::string const &filename, unsigned int n_columns)
+{
+  std::ifstream file(filename, std::ios::binary);
+  ASSERT_THROW(file.good(), "Error: Cannot open the file " + filename + ".");
+  std::uint64_t n_entries = 0;
+  file.read(reinterpret_cast<char *>(&n_entries), sizeof(n_entries));
+  ASSERT_THROW(file.good(),
+               "Error: The file " + filename + " is not a valid frame file.");
+
+  // Check the number of entries against the size of the file before
+  // allocating the columns. An invalid header would otherwise request an
+  // arbitrarily large allocation.
+  std::streampos const data_start = file.tellg();
+  file.seekg(0, std::ios::end);
+  std::uint64_t const data_size = file.tellg() - data_start;
+  file.seekg(data_start);
+  ASSERT_THROW((n_columns > 0) &&
+                   (n_entries <= data_size / (n_columns * sizeof(double))) &&
+                   (n_entries * n_columns * sizeof(double) == data_size),
+               "Error: The size of the file " + filename +
+                   " does not match the number of entries.");
+
+  // The columns are contiguous in the file so that each of them is read at
+  // once.
+  std::vector<std::vector<double>> columns(n_columns,
+                                           std::vector<double>(n_entries));
+  for (auto &column : columns)
+  {
+    file.read(reinterpret_cast<char *>(column.data()),
+              n_entries * sizeof(double));
+  }
+  ASSERT_THROW(file.good(),
+               "Error: The file " + filename + " is not a valid frame file.");
+
+  return columns;
+}
+
+std::vector<std::string>
+get_camera_filenames(std::string const &data_filename,
+                     unsigned int first_camera_id, unsigned int last_camera_id)
+{
+  std::vector<std::string> camera_filenames;
+  for (unsigned int camera_id = first_camera_id; camera_id < last_camera_id + 1;
+       ++camera_id)
+  {
+    camera_filenames.push_back(boost::replace_all_copy(
+        data_filename, "#camera", std::to_string(camera_id)));
+  }
+
+  return camera_filenames;
+}
+
+std::vector<std::string>
+get_frame_filenames(std::vector<std::string> const &camera_filenames,
+                    unsigned int frame)
+{
+  std::vector<std::string> filenames;
+  filenames.reserve(camera_filenames.size());
+  for (auto const &camera_filename : camera_filenames)
+  {
+    filenames.push_back(boost::replace_all_copy(camera_filename, "#frame",
+                                                std::to_string(frame)));
+  }
+
+  return filenames;
+}
+
 } // namespace adamantine
 
 //-------------------- Explicit Instantiations --------------------//
 namespace adamantine
 {
+template class ExperimentToDofMapper<2>;
+template class ExperimentToDofMapper<3>;
 template void set_with_experimental_data(
     MPI_Comm const &communicator, PointsValues<2> const &points_values,
     std::pair<std::vector<int>, std::vector<int>> &expt_to_dof_mapping,
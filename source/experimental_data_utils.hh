@@ -8,12 +8,17 @@
 #ifndef EXPERIMENTAL_DATA_UTILS_HH
 #define EXPERIMENTAL_DATA_UTILS_HH
 
+#include <deal.II/arborx/bvh.h>
 #include <deal.II/base/point.h>
 #include <deal.II/dofs/dof_handler.h>
 #include <deal.II/lac/la_parallel_vector.h>
 
 #include <boost/property_tree/ptree.hpp>
 
+#include <memory>
+#include <string>
+#include <vector>
+
 namespace adamantine
 {
 /**
@@ -45,9 +50,45 @@ std::pair<std::vector<dealii::types::global_dof_index>,
           std::vector<dealii::Point<dim>>>
 get_dof_to_support_mapping(dealii::DoFHandler<dim> const &dof_handler);
 
+/**
+ * Spatial search structure on the support points of the locally owned dofs. It
+ * maps the experimental points to their nearest dof. The structure only
+ * depends on the mesh so that it can be reused for all the frames until the
+ * mesh changes.
+ */
+template <int dim>
+class ExperimentToDofMapper
+{
+public:
+  /**
+   * Constructor. Build the search structure on the support points of the
+   * locally owned dofs of @p dof_handler.
+   */
+  ExperimentToDofMapper(dealii::DoFHandler<dim> const &dof_handler);
+
+  /**
+   * Get the pair of vectors that map the experimental observation indices to
+   * the dof indices. All the points of @p points_values are searched at once.
+   */
+  std::pair<std::vector<int>, std::vector<int>>
+  map(PointsValues<dim> const &points_values) const;
+
+private:
+  /**
+   * Indices of the dofs associated to the support points in the search
+   * structure.
+   */
+  std::vector<dealii::types::global_dof_index> _dof_indices;
+  /**
+   * Bounding volume hierarchy of the support points.
+   */
+  std::unique_ptr<dealii::ArborXWrappers::BVH> _bvh;
+};
+
 /**
  * Get the pair of vectors that map the experimental observation indices to the
- * dof indices.
+ * dof indices. When the mesh does not change between frames, it is cheaper to
+ * reuse an ExperimentToDofMapper.
  */
 template <int dim>
 std::pair<std::vector<int>, std::vector<int>>
@@ -78,6 +119,32 @@ void set_with_experimental_data(
 std::vector<std::vector<double>>
 read_frame_timestamps(boost::property_tree::ptree const &experiment_database);
 
+/**
+ * Read a frame file in the binary format. The file starts with the number of
+ * entries stored as a 64-bit unsigned integer. It is followed by @p n_columns
+ * arrays of doubles, one per column of the equivalent csv file, with one value
+ * per entry. The data is stored using the native byte order. Return the
+ * columns.
+ */
+std::vector<std::vector<double>>
+read_binary_frame_file(std::string const &filename, unsigned int n_columns);
+
+/**
+ * Replace #camera in the generic file name @p data_filename by the IDs of the
+ * cameras from @p first_camera_id to @p last_camera_id.
+ */
+std::vector<std::string>
+get_camera_filenames(std::string const &data_filename,
+                     unsigned int first_camera_id, unsigned int last_camera_id);
+
+/**
+ * Replace #frame in the file names @p camera_filenames returned by
+ * get_camera_filenames() by @p frame.
+ */
+std::vector<std::string>
+get_frame_filenames(std::vector<std::string> const &camera_filenames,
+                    unsigned int frame);
+
 } // namespace adamantine
 
 #endif
@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2021, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -34,6 +34,17 @@
   BOOST_PP_REPEAT_FROM_TO(1, 11, M_FE_DEGREE, BOOST_PP_TUPLE_REPLACE(TUPLE_0, 1, dim))
 #define INSTANTIATE_DIM_FEDEGREE_HOST(TUPLE_0) BOOST_PP_REPEAT_FROM_TO(2, 4, M_DIM, TUPLE_0)
 
+// Instantiation of the class for:
+//   - dim = 2 and 3
+//   - fe_degree = 1 to 10
+//   - Number = float
+#define MF_FE_DEGREE(z, fe_degree, TUPLE_1) \
+  template class adamantine::BOOST_PP_TUPLE_ELEM(0, TUPLE_1)<BOOST_PP_TUPLE_ELEM(1, TUPLE_1),\
+  fe_degree, dealii::MemorySpace::Host, float>;
+#define MF_DIM(z, dim, TUPLE_0) \
+  BOOST_PP_REPEAT_FROM_TO(1, 11, MF_FE_DEGREE, BOOST_PP_TUPLE_REPLACE(TUPLE_0, 1, dim))
+#define INSTANTIATE_DIM_FEDEGREE_HOST_FLOAT(TUPLE_0) BOOST_PP_REPEAT_FROM_TO(2, 4, MF_DIM, TUPLE_0)
+
 // Instantiation of the class for:
 //   - dim = 2 and 3
 //   - fe_degree = 1 to 10
@@ -14,17 +14,29 @@
 #include <boost/algorithm/string.hpp>
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
 #include <fstream>
+#include <numeric>
 #include <tuple>
 
 namespace adamantine
 {
+namespace
+{
+// First characters of the material deposition cache
+char constexpr deposition_cache_magic[8] = {'a', 'd', 'a', 'm',
+                                            'd', 'e', 'p', 'o'};
+} // namespace
+
 template <int dim>
 std::tuple<std::vector<dealii::BoundingBox<dim>>, std::vector<double>,
            std::vector<double>, std::vector<double>>
 create_material_deposition_boxes(
     boost::property_tree::ptree const &geometry_database,
-    std::vector<std::shared_ptr<HeatSource<dim>>> &heat_sources)
+    std::vector<std::shared_ptr<HeatSource<dim>>> &heat_sources,
+    double const start_time, double const end_time)
 {
   // PropertyTreeInput geometry.material_deposition
   bool material_deposition =
@@ -49,7 +61,7 @@ create_material_deposition_boxes(
     for (auto const &source : heat_sources)
     {
       deposition_paths.emplace_back(deposition_along_scan_path<dim>(
-          geometry_database, source->get_scan_path()));
+          geometry_database, source->get_scan_path(), start_time, end_time));
     }
 
     return merge_deposition_paths<dim>(deposition_paths);
@@ -61,6 +73,14 @@ std::tuple<std::vector<dealii::BoundingBox<dim>>, std::vector<double>,
            std::vector<double>, std::vector<double>>
 read_material_deposition(boost::property_tree::ptree const &geometry_database)
 {
+  // The file has already been parsed by a previous run
+  // PropertyTreeInput geometry.material_deposition_cache_file
+  boost::optional<std::string> const cache_filename =
+      geometry_database.get_optional<std::string>(
+          "material_deposition_cache_file");
+  if (cache_filename && std::filesystem::exists(cache_filename.get()))
+    return read_material_deposition_cache<dim>(cache_filename.get());
+
   // PropertyTreeInput geometry.material_deposition_file
   std::string material_deposition_filename =
       geometry_database.get<std::string>("material_deposition_file");
@@ -129,11 +149,87 @@ read_material_deposition(boost::property_tree::ptree const &geometry_database)
                          material_deposition_cos, material_deposition_sin);
 }
 
+template <int dim>
+void write_material_deposition_cache(
+    std::string const &filename,
+    std::tuple<std::vector<dealii::BoundingBox<dim>>, std::vector<double>,
+               std::vector<double>, std::vector<double>> const &deposition)
+{
+  auto const &[boxes, times, deposition_cos, deposition_sin] = deposition;
+  write_file_atomically(
+      filename,
+      [&](std::string const &tmp_filename)
+      {
+        std::ofstream file(tmp_filename, std::ios::binary);
+        ASSERT_THROW(file.good(), "Error: Cannot open " + tmp_filename + ".");
+        file.write(deposition_cache_magic, sizeof(deposition_cache_magic));
+        std::uint64_t const n_boxes = boxes.size();
+        file.write(reinterpret_cast<char const *>(&n_boxes), sizeof(n_boxes));
+        for (unsigned int i = 0; i < n_boxes; ++i)
+        {
+          std::array<double, 2 * dim + 3> values;
+          for (int d = 0; d < dim; ++d)
+          {
+            values[d] = boxes[i].get_boundary_points().first[d];
+            values[dim + d] = boxes[i].get_boundary_points().second[d];
+          }
+          values[2 * dim] = times[i];
+          values[2 * dim + 1] = deposition_cos[i];
+          values[2 * dim + 2] = deposition_sin[i];
+          file.write(reinterpret_cast<char const *>(values.data()),
+                     sizeof(values));
+        }
+        file.close();
+        ASSERT_THROW(file.good(), "Error: Cannot write " + tmp_filename + ".");
+      });
+}
+
+template <int dim>
+std::tuple<std::vector<dealii::BoundingBox<dim>>, std::vector<double>,
+           std::vector<double>, std::vector<double>>
+read_material_deposition_cache(std::string const &filename)
+{
+  std::ifstream file(filename, std::ios::binary);
+  std::array<char, sizeof(deposition_cache_magic)> magic;
+  std::uint64_t n_boxes = 0;
+  file.read(magic.data(), magic.size());
+  file.read(reinterpret_cast<char *>(&n_boxes), sizeof(n_boxes));
+  ASSERT_THROW(file.good() && std::equal(magic.begin(), magic.end(),
+                                         deposition_cache_magic),
+               "Error: " + filename + " is not a material deposition cache.");
+
+  std::vector<dealii::BoundingBox<dim>> boxes;
+  std::vector<double> times(n_boxes);
+  std::vector<double> deposition_cos(n_boxes);
+  std::vector<double> deposition_sin(n_boxes);
+  boxes.reserve(n_boxes);
+  for (unsigned int i = 0; i < n_boxes; ++i)
+  {
+    std::array<double, 2 * dim + 3> values;
+    file.read(reinterpret_cast<char *>(values.data()), sizeof(values));
+    dealii::Point<dim> min_point;
+    dealii::Point<dim> max_point;
+    for (int d = 0; d < dim; ++d)
+    {
+      min_point[d] = values[d];
+      max_point[d] = values[dim + d];
+    }
+    boxes.emplace_back(std::make_pair(min_point, max_point));
+    times[i] = values[2 * dim];
+    deposition_cos[i] = values[2 * dim + 1];
+    deposition_sin[i] = values[2 * dim + 2];
+  }
+  ASSERT_THROW(file.good(), "Error: " + filename + " is truncated.");
+
+  return std::make_tuple(boxes, times, deposition_cos, deposition_sin);
+}
+
 template <int dim>
 std::tuple<std::vector<dealii::BoundingBox<dim>>, std::vector<double>,
            std::vector<double>, std::vector<double>>
 deposition_along_scan_path(boost::property_tree::ptree const &geometry_database,
-                           ScanPath const &scan_path)
+                           ScanPath const &scan_path, double const start_time,
+                           double const end_time)
 {
   std::tuple<std::vector<dealii::BoundingBox<dim>>, std::vector<double>,
              std::vector<double>, std::vector<double>>
@@ -156,15 +252,36 @@ deposition_along_scan_path(boost::property_tree::ptree const &geometry_database,
   // PropertyTreeInput geometry.deposition_lead_time
   double lead_time = geometry_database.get<double>("deposition_lead_time");
 
+  // The deposition time of the boxes increases along the scan path. We skip the
+  // segments whose boxes are all deposited before start_time and we stop at the
+  // first segment whose boxes are all deposited after end_time.
+  double const eps_time = 1.0e-12;
+  auto const deposition_time = [&](double const scan_time)
+  { return std::max(scan_time - lead_time, eps_time); };
+  std::vector<ScanPathSegment> const &segment_list =
+      scan_path.get_segment_list();
+  auto const first_segment = std::lower_bound(
+      segment_list.begin(), segment_list.end(), start_time,
+      [&](ScanPathSegment const &segment, double const time)
+      { return deposition_time(segment.end_time) < time; });
+
   // Loop through the scan path segements, adding boxes inside each one
-  std::vector<ScanPathSegment> segment_list = scan_path.get_segment_list();
   double segment_start_time = 0.0;
   dealii::Point<3> segment_start_point = segment_list.at(0).end_point;
-  for (ScanPathSegment segment : segment_list)
+  if (first_segment != segment_list.begin())
   {
+    segment_start_time = std::prev(first_segment)->end_time;
+    segment_start_point = std::prev(first_segment)->end_point;
+  }
+  for (auto segment_it = first_segment; segment_it != segment_list.end();
+       ++segment_it)
+  {
+    ScanPathSegment const &segment = *segment_it;
+    if (deposition_time(segment_start_time) >= end_time)
+      break;
+
     // Only add material if the power is on
     double const eps = 1.0e-12;
-    double const eps_time = 1.0e-12;
     if (segment.power_modifier > eps)
     {
       dealii::Point<3> segment_end_point = segment.end_point;
@@ -220,13 +337,16 @@ deposition_along_scan_path(boost::property_tree::ptree const &geometry_database,
         bounding_pt_a[dim - 1] = center[dim - 1];
         bounding_pt_b[dim - 1] = center[dim - 1] + box_size[dim - 1];
 
-        std::get<tuple_box>(deposition_path)
-            .push_back(std::make_pair(bounding_pt_a, bounding_pt_b));
-        std::get<tuple_time>(deposition_path)
-            .push_back(std::max(
-                segment_start_time + time_to_box_center - lead_time, eps_time));
-        std::get<tuple_cos>(deposition_path).push_back(cos);
-        std::get<tuple_sin>(deposition_path).push_back(sin);
+        double const box_time =
+            deposition_time(segment_start_time + time_to_box_center);
+        if ((box_time >= start_time) && (box_time < end_time))
+        {
+          std::get<tuple_box>(deposition_path)
+              .push_back(std::make_pair(bounding_pt_a, bounding_pt_b));
+          std::get<tuple_time>(deposition_path).push_back(box_time);
+          std::get<tuple_cos>(deposition_path).push_back(cos);
+          std::get<tuple_sin>(deposition_path).push_back(sin);
+        }
 
         // Get the next box center
         if (distance_to_box_center + eps > segment_length)
@@ -308,47 +428,119 @@ template <int dim>
 std::vector<std::vector<typename dealii::DoFHandler<dim>::active_cell_iterator>>
 get_elements_to_activate(
     dealii::DoFHandler<dim> const &dof_handler,
-    std::vector<dealii::BoundingBox<dim>> const &material_deposition_boxes)
+    std::vector<dealii::BoundingBox<dim>> const &material_deposition_boxes,
+    unsigned int const first_box, unsigned int const last_box)
+{
+  unsigned int const end_box =
+      std::min(last_box, static_cast<unsigned int>(
+                             material_deposition_boxes.size()));
+  std::vector<unsigned int> box_indices;
+  if (first_box < end_box)
+  {
+    box_indices.resize(end_box - first_box);
+    std::iota(box_indices.begin(), box_indices.end(), first_box);
+  }
+
+  return get_elements_to_activate(dof_handler, material_deposition_boxes,
+                                  box_indices, first_box, end_box);
+}
+
+template <int dim>
+std::vector<std::vector<typename dealii::DoFHandler<dim>::active_cell_iterator>>
+get_elements_to_activate(
+    dealii::DoFHandler<dim> const &dof_handler,
+    std::vector<dealii::BoundingBox<dim>> const &material_deposition_boxes,
+    std::vector<unsigned int> const &box_indices, unsigned int const first_box,
+    unsigned int const last_box)
 {
+  unsigned int const n_boxes = material_deposition_boxes.size();
+  std::vector<
+      std::vector<typename dealii::DoFHandler<dim>::active_cell_iterator>>
+      elements_to_activate(n_boxes);
+
+  // Only the boxes in [first_box, last_box) are searched.
+  auto const query_begin =
+      std::lower_bound(box_indices.begin(), box_indices.end(), first_box);
+  auto const query_end =
+      std::lower_bound(query_begin, box_indices.end(), last_box);
+
   // Exit early if we can
-  if (material_deposition_boxes.size() == 0)
-    return std::vector<
-        std::vector<typename dealii::DoFHandler<dim>::active_cell_iterator>>();
+  if (query_begin == query_end)
+    return elements_to_activate;
 
   // We activate the cells that intersect a box. To do that we use ArborX.
   // First, we create the bounding boxes of all the non-activated cells.
-  std::vector<dealii::BoundingBox<dim>> bounding_boxes;
+  // The bounding boxes are computed by several threads.
   std::vector<typename dealii::DoFHandler<dim>::active_cell_iterator>
       cell_iterators;
   for (auto const &cell : dealii::filter_iterators(
            dof_handler.active_cell_iterators(),
            dealii::IteratorFilters::LocallyOwnedCell(),
            dealii::IteratorFilters::ActiveFEIndexEqualTo(1)))
-  {
-    bounding_boxes.push_back(cell->bounding_box());
     cell_iterators.push_back(cell);
-  }
-
-  // Perform the search
+  if (cell_iterators.empty())
+    return elements_to_activate;
+  std::vector<dealii::BoundingBox<dim>> bounding_boxes(cell_iterators.size());
+  for_each(dealii::MemorySpace::Host{}, cell_iterators.size(),
+           [&](unsigned int const i)
+           { bounding_boxes[i] = cell_iterators[i]->bounding_box(); });
+
+  // Perform the search. Only the requested boxes are used as queries.
   dealii::ArborXWrappers::BVH bvh(bounding_boxes);
+  std::vector<dealii::BoundingBox<dim>> query_boxes;
+  query_boxes.reserve(query_end - query_begin);
+  for (auto box = query_begin; box != query_end; ++box)
+    query_boxes.push_back(material_deposition_boxes[*box]);
   dealii::ArborXWrappers::BoundingBoxIntersectPredicate bb_intersect(
-      material_deposition_boxes);
+      query_boxes);
   auto [indices, offset] = bvh.query(bb_intersect);
 
-  unsigned int const n_queries = material_deposition_boxes.size();
-  std::vector<
-      std::vector<typename dealii::DoFHandler<dim>::active_cell_iterator>>
-      elements_to_activate(n_queries);
-  for (unsigned int i = 0; i < n_queries; ++i)
-  {
-    for (int j = offset[i]; j < offset[i + 1]; ++j)
-    {
-      elements_to_activate[i].push_back(cell_iterators[indices[j]]);
-    }
-  }
+  // Each query fills its own vector so the queries are processed by several
+  // threads.
+  for_each(dealii::MemorySpace::Host{}, query_boxes.size(),
+           [&](unsigned int const i)
+           {
+             auto &elements = elements_to_activate[*(query_begin + i)];
+             elements.reserve(offset[i + 1] - offset[i]);
+             for (int j = offset[i]; j < offset[i + 1]; ++j)
+               elements.push_back(cell_iterators[indices[j]]);
+           });
 
   return elements_to_activate;
 }
+
+template <int dim>
+std::vector<unsigned int> get_local_deposition_boxes(
+    dealii::DoFHandler<dim> const &dof_handler,
+    std::vector<dealii::BoundingBox<dim>> const &material_deposition_boxes)
+{
+  std::vector<unsigned int> box_indices;
+  bool empty = true;
+  dealii::BoundingBox<dim> local_box;
+  for (auto const &cell :
+       dealii::filter_iterators(dof_handler.active_cell_iterators(),
+                                dealii::IteratorFilters::LocallyOwnedCell()))
+  {
+    if (empty)
+      local_box = cell->bounding_box();
+    else
+      local_box.merge_with(cell->bounding_box());
+    empty = false;
+  }
+  if (empty)
+    return box_indices;
+
+  // Extend the box slightly so that the boxes that only touch the locally
+  // owned cells are not lost to roundoff.
+  local_box.extend(1e-12 * local_box.get_boundary_points().first.distance(
+                               local_box.get_boundary_points().second));
+  for (unsigned int i = 0; i < material_deposition_boxes.size(); ++i)
+    if (local_box.get_neighbor_type(material_deposition_boxes[i]) !=
+        dealii::NeighborType::not_neighbors)
+      box_indices.push_back(i);
+
+  return box_indices;
+}
 } // namespace adamantine
 
 //-------------------- Explicit Instantiations --------------------//
@@ -358,12 +550,14 @@ template std::tuple<std::vector<dealii::BoundingBox<2>>, std::vector<double>,
                     std::vector<double>, std::vector<double>>
 create_material_deposition_boxes(
     boost::property_tree::ptree const &geometry_database,
-    std::vector<std::shared_ptr<HeatSource<2>>> &heat_sources);
+    std::vector<std::shared_ptr<HeatSource<2>>> &heat_sources,
+    double const start_time, double const end_time);
 template std::tuple<std::vector<dealii::BoundingBox<3>>, std::vector<double>,
                     std::vector<double>, std::vector<double>>
 create_material_deposition_boxes(
     boost::property_tree::ptree const &geometry_database,
-    std::vector<std::shared_ptr<HeatSource<3>>> &heat_sources);
+    std::vector<std::shared_ptr<HeatSource<3>>> &heat_sources,
+    double const start_time, double const end_time);
 
 template std::tuple<std::vector<dealii::BoundingBox<2>>, std::vector<double>,
                     std::vector<double>, std::vector<double>>
@@ -372,14 +566,54 @@ template std::tuple<std::vector<dealii::BoundingBox<3>>, std::vector<double>,
                     std::vector<double>, std::vector<double>>
 read_material_deposition(boost::property_tree::ptree const &geometry_database);
 
+template void write_material_deposition_cache(
+    std::string const &filename,
+    std::tuple<std::vector<dealii::BoundingBox<2>>, std::vector<double>,
+               std::vector<double>, std::vector<double>> const &deposition);
+template void write_material_deposition_cache(
+    std::string const &filename,
+    std::tuple<std::vector<dealii::BoundingBox<3>>, std::vector<double>,
+               std::vector<double>, std::vector<double>> const &deposition);
+
+template std::tuple<std::vector<dealii::BoundingBox<2>>, std::vector<double>,
+                    std::vector<double>, std::vector<double>>
+read_material_deposition_cache(std::string const &filename);
+template std::tuple<std::vector<dealii::BoundingBox<3>>, std::vector<double>,
+                    std::vector<double>, std::vector<double>>
+read_material_deposition_cache(std::string const &filename);
+
 template std::vector<
     std::vector<typename dealii::DoFHandler<2>::active_cell_iterator>>
 get_elements_to_activate(
     dealii::DoFHandler<2> const &dof_handler,
-    std::vector<dealii::BoundingBox<2>> const &material_deposition_boxes);
+    std::vector<dealii::BoundingBox<2>> const &material_deposition_boxes,
+    unsigned int const first_box, unsigned int const last_box);
 template std::vector<
     std::vector<typename dealii::DoFHandler<3>::active_cell_iterator>>
 get_elements_to_activate(
+    dealii::DoFHandler<3> const &dof_handler,
+    std::vector<dealii::BoundingBox<3>> const &material_deposition_boxes,
+    unsigned int const first_box, unsigned int const last_box);
+
+template std::vector<
+    std::vector<typename dealii::DoFHandler<2>::active_cell_iterator>>
+get_elements_to_activate(
+    dealii::DoFHandler<2> const &dof_handler,
+    std::vector<dealii::BoundingBox<2>> const &material_deposition_boxes,
+    std::vector<unsigned int> const &box_indices, unsigned int const first_box,
+    unsigned int const last_box);
+template std::vector<
+    std::vector<typename dealii::DoFHandler<3>::active_cell_iterator>>
+get_elements_to_activate(
+    dealii::DoFHandler<3> const &dof_handler,
+    std::vector<dealii::BoundingBox<3>> const &material_deposition_boxes,
+    std::vector<unsigned int> const &box_indices, unsigned int const first_box,
+    unsigned int const last_box);
+
+template std::vector<unsigned int> get_local_deposition_boxes(
+    dealii::DoFHandler<2> const &dof_handler,
+    std::vector<dealii::BoundingBox<2>> const &material_deposition_boxes);
+template std::vector<unsigned int> get_local_deposition_boxes(
     dealii::DoFHandler<3> const &dof_handler,
     std::vector<dealii::BoundingBox<3>> const &material_deposition_boxes);
 } // namespace adamantine
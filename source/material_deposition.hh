@@ -1,4 +1,4 @@
-/* Copyright (c) 2021, the adamantine authors.
+/* Copyright (c) 2021 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -15,18 +15,25 @@
 
 #include <boost/property_tree/ptree.hpp>
 
+#include <limits>
+#include <string>
+
 namespace adamantine
 {
 /**
  * Return the bounding boxes, the deposition times, the cosine of the deposition
- * angles, and the sine of the deposition angles.
+ * angles, and the sine of the deposition angles. When the boxes are computed
+ * from the scan paths, only the boxes deposited in [@p start_time, @p end_time)
+ * are returned.
  */
 template <int dim>
 std::tuple<std::vector<dealii::BoundingBox<dim>>, std::vector<double>,
            std::vector<double>, std::vector<double>>
 create_material_deposition_boxes(
     boost::property_tree::ptree const &geometry_database,
-    std::vector<std::shared_ptr<HeatSource<dim>>> &heat_sources);
+    std::vector<std::shared_ptr<HeatSource<dim>>> &heat_sources,
+    double const start_time = std::numeric_limits<double>::lowest(),
+    double const end_time = std::numeric_limits<double>::max());
 /**
  * Read the material deposition file and return the bounding boxes, the
  * deposition times, the cosine of the deposition angles, and the sine of the
@@ -36,15 +43,36 @@ template <int dim>
 std::tuple<std::vector<dealii::BoundingBox<dim>>, std::vector<double>,
            std::vector<double>, std::vector<double>>
 read_material_deposition(boost::property_tree::ptree const &geometry_database);
+/**
+ * Write the bounding boxes, the deposition times, the cosine of the deposition
+ * angles, and the sine of the deposition angles in a binary file used by the
+ * preprocessing cache. The file uses the endianness of the machine.
+ */
+template <int dim>
+void write_material_deposition_cache(
+    std::string const &filename,
+    std::tuple<std::vector<dealii::BoundingBox<dim>>, std::vector<double>,
+               std::vector<double>, std::vector<double>> const &deposition);
+/**
+ * Read the binary file written by write_material_deposition_cache.
+ */
+template <int dim>
+std::tuple<std::vector<dealii::BoundingBox<dim>>, std::vector<double>,
+           std::vector<double>, std::vector<double>>
+read_material_deposition_cache(std::string const &filename);
 /**
  * Return the bounding boxes, the deposition times, the cosine of the deposition
- * angles, and the sine of deposition angles based on the scan path.
+ * angles, and the sine of deposition angles based on the scan path. Only the
+ * boxes deposited in [@p start_time, @p end_time) are returned.
  */
 template <int dim>
 std::tuple<std::vector<dealii::BoundingBox<dim>>, std::vector<double>,
            std::vector<double>, std::vector<double>>
-deposition_along_scan_path(boost::property_tree::ptree const &geometry_database,
-                           ScanPath const &scan_path);
+deposition_along_scan_path(
+    boost::property_tree::ptree const &geometry_database,
+    ScanPath const &scan_path,
+    double const start_time = std::numeric_limits<double>::lowest(),
+    double const end_time = std::numeric_limits<double>::max());
 /**
  * Merge a vector of tuple of bounding boxes, deposition times, cosine of
  * deposition angles, and sine of deposition angles into a
@@ -58,11 +86,35 @@ merge_deposition_paths(
                            std::vector<double>, std::vector<double>,
                            std::vector<double>>> const &bounding_box_lists);
 /**
- * Return a vector of cells to activate for each time deposition.
+ * Return a vector of cells to activate for each time deposition. Only the boxes
+ * in [@p first_box, @p last_box) are searched, the vectors associated with the
+ * other boxes are empty.
  */
 template <int dim>
 std::vector<std::vector<typename dealii::DoFHandler<dim>::active_cell_iterator>>
 get_elements_to_activate(
+    dealii::DoFHandler<dim> const &dof_handler,
+    std::vector<dealii::BoundingBox<dim>> const &material_deposition_boxes,
+    unsigned int const first_box = 0,
+    unsigned int const last_box = std::numeric_limits<unsigned int>::max());
+/**
+ * Same as above but only the boxes whose indices are in @p box_indices and in
+ * [@p first_box, @p last_box) are searched. @p box_indices must be sorted.
+ */
+template <int dim>
+std::vector<std::vector<typename dealii::DoFHandler<dim>::active_cell_iterator>>
+get_elements_to_activate(
+    dealii::DoFHandler<dim> const &dof_handler,
+    std::vector<dealii::BoundingBox<dim>> const &material_deposition_boxes,
+    std::vector<unsigned int> const &box_indices, unsigned int const first_box,
+    unsigned int const last_box);
+/**
+ * Return the sorted indices of the boxes in @p material_deposition_boxes that
+ * intersect the bounding box of the locally owned cells of @p dof_handler. The
+ * other boxes cannot activate any cell of this processor.
+ */
+template <int dim>
+std::vector<unsigned int> get_local_deposition_boxes(
     dealii::DoFHandler<dim> const &dof_handler,
     std::vector<dealii::BoundingBox<dim>> const &material_deposition_boxes);
 } // namespace adamantine
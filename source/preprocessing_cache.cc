@@ -0,0 +1,198 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <ScanPath.hh>
+#include <material_deposition.hh>
+#include <preprocessing_cache.hh>
+#include <utils.hh>
+
+#include <deal.II/base/mpi.h>
+
+#include <boost/property_tree/info_parser.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+
+namespace adamantine
+{
+namespace
+{
+/**
+ * Broadcast @p value from the first processor of @p communicator.
+ */
+void broadcast_string(MPI_Comm const &communicator, std::string &value)
+{
+  std::size_t size = value.size();
+  dealii::Utilities::MPI::broadcast(&size, 1, 0, communicator);
+  value.resize(size);
+  dealii::Utilities::MPI::broadcast(value.data(), size, 0, communicator);
+}
+
+/**
+ * Fill the cache on the first processor and return the entries of the
+ * database that need to be modified.
+ */
+boost::property_tree::ptree
+fill_preprocessing_cache(std::filesystem::path const &directory,
+                         boost::property_tree::ptree const &database)
+{
+  boost::property_tree::ptree cache_entries;
+  std::filesystem::create_directories(directory);
+
+  // The coarse mesh is written by Geometry the first time it is read.
+  boost::property_tree::ptree const &geometry_database =
+      database.get_child("geometry");
+  if (geometry_database.get<bool>("import_mesh"))
+  {
+    std::string const mesh_file =
+        geometry_database.get<std::string>("mesh_file");
+    std::string const key = file_cache_key(
+        mesh_file, geometry_database.get<std::string>("mesh_format"));
+    cache_entries.put("geometry.coarse_mesh_cache_file",
+                      (directory / ("mesh_" + key + ".bin")).string());
+  }
+
+  // The material deposition file is parsed once
+  if (geometry_database.get("material_deposition", false) &&
+      (geometry_database.get<std::string>("material_deposition_method") ==
+       "file"))
+  {
+    std::string const deposition_file =
+        geometry_database.get<std::string>("material_deposition_file");
+    wait_for_file(deposition_file,
+                  "Waiting for material deposition file: " + deposition_file);
+    int const dim = geometry_database.get<int>("dim");
+    std::string const cache_file =
+        (directory / ("deposition_" +
+                      file_cache_key(deposition_file, std::to_string(dim)) +
+                      ".bin"))
+            .string();
+    if (!std::filesystem::exists(cache_file))
+    {
+      if (dim == 2)
+        write_material_deposition_cache<2>(
+            cache_file, read_material_deposition<2>(geometry_database));
+      else
+        write_material_deposition_cache<3>(
+            cache_file, read_material_deposition<3>(geometry_database));
+    }
+    cache_entries.put("geometry.material_deposition_cache_file", cache_file);
+  }
+
+  // The scan paths are converted to the binary format
+  unsigned int const n_beams = database.get<unsigned int>("sources.n_beams");
+  for (unsigned int i = 0; i < n_beams; ++i)
+  {
+    std::string const beam = "sources.beam_" + std::to_string(i);
+    std::string const scan_path_file =
+        database.get<std::string>(beam + ".scan_path_file");
+    std::string const file_format =
+        database.get<std::string>(beam + ".scan_path_file_format");
+    if (file_format == "binary")
+      continue;
+
+    wait_for_file(scan_path_file,
+                  "Waiting for scan path file: " + scan_path_file);
+    std::string const cache_file =
+        (directory / ("scan_path_" +
+                      file_cache_key(scan_path_file, file_format) + ".bin"))
+            .string();
+    if (!std::filesystem::exists(cache_file))
+    {
+      write_file_atomically(
+          cache_file, [&](std::string const &tmp_file)
+          {
+            ScanPath(scan_path_file, file_format)
+                .write_binary_scan_path(tmp_file);
+          });
+    }
+    cache_entries.put(beam + ".scan_path_file", cache_file);
+    cache_entries.put(beam + ".scan_path_file_format", "binary");
+  }
+
+  return cache_entries;
+}
+} // namespace
+
+std::string file_cache_key(std::string const &filename,
+                           std::string const &salt)
+{
+  std::ostringstream inputs;
+  inputs << salt << '\n';
+  std::error_code error_code;
+  std::filesystem::path const path =
+      std::filesystem::absolute(filename, error_code);
+  inputs << path.string() << '\n';
+  if (std::filesystem::exists(path, error_code))
+  {
+    inputs << std::filesystem::file_size(path, error_code) << '\n'
+           << std::filesystem::last_write_time(path, error_code)
+                  .time_since_epoch()
+                  .count();
+  }
+
+  // 64-bit FNV-1a hash of the inputs
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char const c : inputs.str())
+  {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  std::ostringstream key;
+  key << std::hex << std::setw(16) << std::setfill('0') << hash;
+
+  return key.str();
+}
+
+void use_preprocessing_cache(MPI_Comm const &communicator,
+                             boost::property_tree::ptree &database)
+{
+  // PropertyTreeInput preprocessing_cache.directory
+  boost::optional<std::string> const directory =
+      database.get_optional<std::string>("preprocessing_cache.directory");
+  if (!directory)
+    return;
+
+  // The entries are computed on the first processor and then broadcast as a
+  // string. The errors are thrown on all the processors.
+  std::string cache_entries_string;
+  std::string error_message;
+  if (dealii::Utilities::MPI::this_mpi_process(communicator) == 0)
+  {
+    try
+    {
+      std::ostringstream stream;
+      boost::property_tree::info_parser::write_info(
+          stream, fill_preprocessing_cache(directory.get(), database));
+      cache_entries_string = stream.str();
+    }
+    catch (std::exception const &exception)
+    {
+      error_message = exception.what();
+    }
+  }
+  broadcast_string(communicator, error_message);
+  ASSERT_THROW(error_message.empty(),
+               "Error: Cannot fill the preprocessing cache. " + error_message);
+  broadcast_string(communicator, cache_entries_string);
+
+  std::istringstream stream(cache_entries_string);
+  boost::property_tree::ptree cache_entries;
+  boost::property_tree::info_parser::read_info(stream, cache_entries);
+  for (auto const &[tree_name, tree] : cache_entries)
+    for (auto const &[child_name, child] : tree)
+    {
+      if (child.empty())
+        database.put(tree_name + "." + child_name, child.data());
+      else
+        for (auto const &[key, value] : child)
+          database.put(tree_name + "." + child_name + "." + key, value.data());
+    }
+}
+} // namespace adamantine
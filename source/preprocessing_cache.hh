@@ -0,0 +1,41 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef PREPROCESSING_CACHE_HH
+#define PREPROCESSING_CACHE_HH
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <string>
+
+#include <mpi.h>
+
+namespace adamantine
+{
+/**
+ * Return a key of 16 hexadecimal characters identifying a file. The key
+ * depends on the absolute path, the size, and the time of the last
+ * modification of the file, and on @p salt.
+ */
+std::string file_cache_key(std::string const &filename,
+                           std::string const &salt);
+
+/**
+ * If the input contains a preprocessing_cache.directory, fill the cache with
+ * the data that is expensive to preprocess and modify @p database so that the
+ * cached data is used. The imported coarse mesh, the material deposition
+ * read from a file, and the scan paths converted to the binary format are
+ * stored in the directory. Each entry is named after the key of the input
+ * files it depends on, so that the runs of a parameter study share the
+ * entries as long as these files do not change. The cache is filled by the
+ * first processor of @p communicator.
+ */
+void use_preprocessing_cache(MPI_Comm const &communicator,
+                             boost::property_tree::ptree &database);
+} // namespace adamantine
+
+#endif
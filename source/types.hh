@@ -138,6 +138,7 @@ enum Timing
 {
   main,
   refine,
+  dof_renumbering,
   add_material_search,
   add_material_activate,
   da_experimental_data,
@@ -150,6 +151,7 @@ enum Timing
   evol_time_J_inv,
   evol_time_update_bound_mat_prop,
   output,
+  checkpoint,
   n_timers
 };
 
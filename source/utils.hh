@@ -11,6 +11,7 @@
 #include <deal.II/base/cuda.h>
 #include <deal.II/base/cuda_size.h>
 #include <deal.II/base/exceptions.h>
+#include <deal.II/base/parallel.h>
 
 #include <cassert>
 #include <cstring>
@@ -18,6 +19,7 @@
 #include <filesystem>
 #include <iostream>
 #include <numeric>
+#include <random>
 #include <stdexcept>
 #include <string>
 #include <utility>
@@ -30,12 +32,30 @@ namespace adamantine
 #define ADAMANTINE_HOST_DEV
 #endif
 
+/**
+ * Minimum number of iterations given to a thread by the host loops.
+ */
+unsigned int constexpr host_loop_grain_size = 512;
+
+/**
+ * Copy the host array @p input to @p output. The copy is split between the
+ * threads like the host loops of for_each() so that, on NUMA nodes, the pages
+ * of a newly allocated @p output are first touched by the threads that use
+ * them.
+ */
 template <typename Number>
 inline void deep_copy(Number *output, dealii::MemorySpace::Host const &,
                       Number const *input, dealii::MemorySpace::Host const &,
                       unsigned int size)
 {
-  std::memcpy(output, input, size * sizeof(Number));
+  dealii::parallel::apply_to_subranges(
+      0u, size,
+      [&](unsigned int const begin, unsigned int const end)
+      {
+        std::memcpy(output + begin, input + begin,
+                    (end - begin) * sizeof(Number));
+      },
+      host_loop_grain_size);
 }
 
 #ifdef __CUDACC__
@@ -101,17 +121,32 @@ struct Memory<Number, dealii::MemorySpace::Host>
 
   static void delete_data(Number *data_ptr) noexcept { delete[] data_ptr; }
 
+  // The memory is zeroed by the threads of the host loops, see deep_copy().
   static void set_zero(Number *data_ptr, std::size_t const size)
   {
-    std::memset(data_ptr, 0, size * sizeof(Number));
+    dealii::parallel::apply_to_subranges(
+        std::size_t(0), size,
+        [&](std::size_t const begin, std::size_t const end)
+        { std::memset(data_ptr + begin, 0, (end - begin) * sizeof(Number)); },
+        host_loop_grain_size);
   }
 };
 
+/**
+ * Apply @p f to the range [0, @p size) using the threads available on the
+ * processor. The iterations must be independent.
+ */
 template <typename Functor>
 void for_each(dealii::MemorySpace::Host, unsigned int const size, Functor f)
 {
-  for (unsigned int i = 0; i < size; ++i)
-    f(i);
+  dealii::parallel::apply_to_subranges(
+      0u, size,
+      [&](unsigned int const begin, unsigned int const end)
+      {
+        for (unsigned int i = begin; i < end; ++i)
+          f(i);
+      },
+      host_loop_grain_size);
 }
 
 #ifdef __CUDACC__
@@ -176,6 +211,21 @@ inline void wait_for_file(std::string const &filename,
   }
 }
 
+/**
+ * Call @p write_file with a temporary file name and rename the temporary file
+ * to @p filename afterwards, so that another run never reads an incomplete
+ * file.
+ */
+template <typename Functor>
+inline void write_file_atomically(std::string const &filename,
+                                  Functor const &write_file)
+{
+  std::string const tmp_filename =
+      filename + ".tmp" + std::to_string(std::random_device{}());
+  write_file(tmp_filename);
+  std::filesystem::rename(tmp_filename, filename);
+}
+
 #define ASSERT(condition, message) assert((condition) && (message))
 
 inline void ASSERT_THROW(bool cond, std::string const &message)
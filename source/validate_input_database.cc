@@ -1,4 +1,4 @@
-/* Copyright (c) 2021, the adamantine authors.
+/* Copyright (c) 2021 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -93,6 +93,50 @@ void validate_input_database(boost::property_tree::ptree &database)
         ASSERT_THROW(false, "Error: Unknown quadrature type.");
       }
     }
+
+    // PropertyTreeInput discretization.thermal.precision
+    boost::optional<std::string> precision_optional =
+        database.get_optional<std::string>("discretization.thermal.precision");
+
+    if (precision_optional)
+    {
+      std::string precision = precision_optional.get();
+      if (!((precision == "double") || (precision == "single")))
+      {
+        ASSERT_THROW(false, "Error: Unknown precision.");
+      }
+    }
+
+    // PropertyTreeInput discretization.thermal.dof_renumbering
+    std::string const dof_renumbering =
+        database.get("discretization.thermal.dof_renumbering", "none");
+    ASSERT_THROW((dof_renumbering == "none") ||
+                     (dof_renumbering == "matrix_free_data_locality") ||
+                     (dof_renumbering == "cuthill_mckee"),
+                 "Error: Unknown DoF renumbering.");
+
+    // PropertyTreeInput discretization.thermal.sleep_tolerance
+    ASSERT_THROW(database.get("discretization.thermal.sleep_tolerance", 1e-3) >
+                     0.,
+                 "Error: The sleep tolerance must be positive.");
+  }
+
+  // Tree: discretization.mechanical
+  if (use_mechanical_physics)
+  {
+    // PropertyTreeInput discretization.mechanical.preconditioner
+    boost::optional<std::string> preconditioner_optional =
+        database.get_optional<std::string>(
+            "discretization.mechanical.preconditioner");
+
+    if (preconditioner_optional)
+    {
+      std::string preconditioner = preconditioner_optional.get();
+      if (!((preconditioner == "ssor") || (preconditioner == "amg")))
+      {
+        ASSERT_THROW(false, "Error: Unknown mechanical preconditioner.");
+      }
+    }
   }
 
   // Tree: geometry
@@ -136,6 +180,9 @@ void validate_input_database(boost::property_tree::ptree &database)
       ASSERT_THROW(database.count("geometry.material_deposition_file") != 0,
                    "Error: If the material deposition method is 'file', "
                    "'material_deposition_file' must be given.");
+      ASSERT_THROW(database.get("geometry.deposition_time_window", 0.) == 0.,
+                   "Error: The deposition time window is only supported when "
+                   "the material deposition method is 'scan_paths'.");
     }
     else
     {
@@ -158,8 +205,12 @@ void validate_input_database(boost::property_tree::ptree &database)
           database.get_child("geometry").count("deposition_lead_time") != 0,
           "Error: If the material deposition method is 'scan_path', "
           "'deposition_lead_time' must be given.");
+      ASSERT_THROW(database.get("geometry.deposition_time_window", 0.) >= 0.,
+                   "Error: The deposition time window must be non-negative.");
     }
   }
+  ASSERT_THROW(database.get("geometry.activation_window", 0.) >= 0.,
+               "Error: The activation window must be non-negative.");
 
   bool import_mesh = database.get<bool>("geometry.import_mesh");
   if (import_mesh)
@@ -318,6 +369,62 @@ void validate_input_database(boost::property_tree::ptree &database)
       database.get_child("post_processor").count("filename_prefix") != 0,
       "Error: The filename prefix for the postprocessor must be specified.");
 
+  std::string const output_format =
+      database.get<std::string>("post_processor.output_format", "vtu");
+  ASSERT_THROW(boost::iequals(output_format, "vtu") ||
+                   boost::iequals(output_format, "hdf5"),
+               "Error: The output format must be 'vtu' or 'hdf5'.");
+
+  std::string const compression_level = database.get<std::string>(
+      "post_processor.compression_level", "best_compression");
+  ASSERT_THROW(boost::iequals(compression_level, "no_compression") ||
+                   boost::iequals(compression_level, "best_speed") ||
+                   boost::iequals(compression_level, "best_compression") ||
+                   boost::iequals(compression_level, "default_compression"),
+               "Error: The compression level must be 'no_compression', "
+               "'best_speed', 'best_compression', or 'default_compression'.");
+
+  // Tree: checkpoint
+  if (database.count("checkpoint") != 0)
+  {
+    ASSERT_THROW(
+        database.get_child("checkpoint").count("filename_prefix") != 0,
+        "Error: The filename prefix for the checkpoints must be specified.");
+    ASSERT_THROW(
+        database.get("checkpoint.time_steps_between_checkpoint", 0) > 0,
+        "Error: The number of time steps between checkpoints must be "
+        "positive.");
+  }
+
+  // Tree: profiling
+  ASSERT_THROW(
+      database.get("profiling.time_steps_between_memory_report", 100) > 0,
+      "Error: The number of time steps between memory reports must be "
+      "positive.");
+
+  // Tree: batch
+  if (database.count("batch") != 0)
+  {
+    ASSERT_THROW(database.get_child("batch").count("cases_file") != 0,
+                 "Error: The file with the cases of the batch must be "
+                 "specified.");
+    ASSERT_THROW(!database.get("ensemble.ensemble_simulation", false),
+                 "Error: Batch runs cannot be combined with ensemble "
+                 "simulations.");
+  }
+
+  // Tree: preprocessing_cache
+  ASSERT_THROW(
+      database.count("preprocessing_cache") == 0 ||
+          database.get_child("preprocessing_cache").count("directory") != 0,
+      "Error: The directory of the preprocessing cache must be specified.");
+
+  // Tree: restart
+  ASSERT_THROW(database.count("restart") == 0 ||
+                   database.get_child("restart").count("filename_prefix") != 0,
+               "Error: The filename prefix of the checkpoint used to restart "
+               "must be specified.");
+
   // Tree: refinement
   ASSERT_THROW(database.count("refinement") != 0,
                "Error: A refinement section of the input file must exist.");
@@ -330,7 +437,55 @@ void validate_input_database(boost::property_tree::ptree &database)
                  "Error: The refinement beam cutoff must be non-negative.");
   }
 
+  for (std::string const option :
+       {"refine_margin", "coarsen_margin", "dormant_temperature_variation",
+        "dormant_distance", "active_cell_weight", "inactive_cell_weight",
+        "level_weight", "beam_weight", "layer_weight"})
+  {
+    boost::optional<double> option_optional =
+        database.get_optional<double>("refinement." + option);
+    if (option_optional)
+    {
+      ASSERT_THROW(option_optional.get() >= 0.0, "Error: The refinement " +
+                                                      option +
+                                                      " must be non-negative.");
+    }
+  }
+
+  std::string const error_indicator =
+      database.get<std::string>("refinement.error_indicator", "kelly");
+  ASSERT_THROW((error_indicator == "kelly") || (error_indicator == "gradient"),
+               "Error: Unknown refinement error indicator. The choices are "
+               "kelly and gradient.");
+
+  boost::optional<double> load_imbalance_threshold_optional =
+      database.get_optional<double>("refinement.load_imbalance_threshold");
+  if (load_imbalance_threshold_optional)
+  {
+    ASSERT_THROW((load_imbalance_threshold_optional.get() == 0.) ||
+                     (load_imbalance_threshold_optional.get() >= 1.),
+                 "Error: The refinement load imbalance threshold must be zero "
+                 "or larger than one.");
+  }
+
+  boost::optional<double> layer_weight_optional =
+      database.get_optional<double>("refinement.layer_weight");
+  if (layer_weight_optional && (layer_weight_optional.get() != 1.))
+  {
+    ASSERT_THROW(database.get_child("geometry").count("deposition_height") != 0,
+                 "Error: If the refinement layer weight is used, the geometry "
+                 "deposition_height must be given.");
+  }
+
   // Tree: sources
+  boost::optional<double> source_cutoff_optional =
+      database.get_optional<double>("sources.cutoff");
+  if (source_cutoff_optional)
+  {
+    ASSERT_THROW(source_cutoff_optional.get() >= 0.0,
+                 "Error: The heat source cutoff must be non-negative.");
+  }
+
   unsigned int n_beams = database.get<unsigned int>("sources.n_beams");
   for (unsigned int beam_index = 0; beam_index < n_beams; ++beam_index)
   {
@@ -351,10 +506,11 @@ void validate_input_database(boost::property_tree::ptree &database)
         database.get<std::string>("sources.beam_" + std::to_string(beam_index) +
                                   ".scan_path_file_format");
     ASSERT_THROW(boost::iequals(file_format, "segment") ||
-                     boost::iequals(file_format, "event_series"),
+                     boost::iequals(file_format, "event_series") ||
+                     boost::iequals(file_format, "binary"),
                  "Error: Scan path file format, '" + file_format +
-                     "', is not recognized. Valid options are: 'segment' and "
-                     "'event_series'.");
+                     "', is not recognized. Valid options are: 'segment', "
+                     "'event_series', and 'binary'.");
     ASSERT_THROW(database.get<double>("sources.beam_" +
                                       std::to_string(beam_index) + ".depth") >=
                      0.0,
@@ -383,13 +539,64 @@ void validate_input_database(boost::property_tree::ptree &database)
           boost::iequals(time_stepping_method, "backward_euler") ||
           boost::iequals(time_stepping_method, "implicit_midpoint") ||
           boost::iequals(time_stepping_method, "crank_nicolson") ||
-          boost::iequals(time_stepping_method, "sdirk2"),
+          boost::iequals(time_stepping_method, "sdirk2") ||
+          boost::iequals(time_stepping_method, "imex_euler") ||
+          boost::iequals(time_stepping_method, "imex_ars222") ||
+          boost::iequals(time_stepping_method, "imex_ars443"),
       "Error: Time stepping method, '" + time_stepping_method +
           "', is not recognized. Valid options are: 'forward_euler', "
           "'rk_third_order', 'rk_fourth_order', 'heun_euler', "
           "'bogacki_shampine', 'dopri', 'fehlberg', 'cash_karp', "
-          "'backward_euler', 'implicit_midpoint', 'crank_nicolson', and "
-          "'sdirk2'.");
+          "'backward_euler', 'implicit_midpoint', 'crank_nicolson', "
+          "'sdirk2', 'imex_euler', 'imex_ars222', and 'imex_ars443'.");
+
+  if (database.get("time_stepping.persistent_stages", false))
+  {
+    ASSERT_THROW(boost::iequals(time_stepping_method, "forward_euler") ||
+                     boost::iequals(time_stepping_method, "rk_third_order") ||
+                     boost::iequals(time_stepping_method, "rk_fourth_order"),
+                 "Error: Persistent stages are only supported by "
+                 "'forward_euler', 'rk_third_order', and 'rk_fourth_order'.");
+  }
+
+  if (database.get("time_stepping.adaptive_time_step", false))
+  {
+    ASSERT_THROW(boost::iequals(time_stepping_method, "backward_euler") ||
+                     boost::iequals(time_stepping_method,
+                                    "implicit_midpoint") ||
+                     boost::iequals(time_stepping_method, "crank_nicolson") ||
+                     boost::iequals(time_stepping_method, "sdirk2"),
+                 "Error: Adaptive time step is only supported by the implicit "
+                 "methods. The embedded methods are always adaptive.");
+  }
+
+  if (database.get("time_stepping.multirate_sub_steps", 1u) > 1)
+  {
+    ASSERT_THROW(boost::iequals(time_stepping_method, "forward_euler"),
+                 "Error: Multirate time stepping is only supported by "
+                 "'forward_euler'.");
+  }
+
+  ASSERT_THROW(database.get("time_stepping.dwell_time_step", 0.) >= 0.,
+               "Error: Dwell time step must be non-negative.");
+  if (boost::optional<std::string> dwell_method =
+          database.get_optional<std::string>("time_stepping.dwell_method"))
+  {
+    ASSERT_THROW(boost::iequals(*dwell_method, "imex_euler") ||
+                     boost::iequals(*dwell_method, "imex_ars222") ||
+                     boost::iequals(*dwell_method, "imex_ars443"),
+                 "Error: Dwell method, '" + *dwell_method +
+                     "', is not recognized. Valid options are: 'imex_euler', "
+                     "'imex_ars222', and 'imex_ars443'.");
+  }
+
+  if (boost::istarts_with(time_stepping_method, "imex"))
+  {
+    ASSERT_THROW(
+        !database.get("time_stepping.adaptive_linear_tolerance", false),
+        "Error: The IMEX methods do not use the Newton solver, so the "
+        "adaptive linear tolerance is not supported.");
+  }
 
   ASSERT_THROW(database.get<double>("time_stepping.duration") >= 0.0,
                "Error: Time stepping duration must be non-negative.");
@@ -423,6 +630,12 @@ void validate_input_database(boost::property_tree::ptree &database)
                        boost::iequals(experiment_format, "ray"),
                    "Error: Experiment format must be 'point_cloud' or 'ray'.");
 
+      std::string file_format =
+          database.get<std::string>("experiment.file_format", "csv");
+      ASSERT_THROW(boost::iequals(file_format, "csv") ||
+                       boost::iequals(file_format, "binary"),
+                   "Error: Experiment file_format must be 'csv' or 'binary'.");
+
       unsigned int first_frame_index =
           database.get<unsigned int>("experiment.first_frame", 0);
       unsigned int last_frame_index =
@@ -464,6 +677,14 @@ void validate_input_database(boost::property_tree::ptree &database)
         "Error: The standard deviation for the new material temperature "
         "must be non-negative.");
   }
+  boost::optional<unsigned int> n_groups =
+      database.get_optional<unsigned int>("ensemble.n_groups");
+  if (n_groups)
+  {
+    ASSERT_THROW(n_groups.get() > 0,
+                 "Error: The number of groups of the ensemble must be "
+                 "positive.");
+  }
   boost::optional<double> beam_0_max_power_stddev =
       database.get_optional<double>("ensembe.beam_0_max_power_stddev");
   if (beam_0_max_power_stddev)
@@ -494,5 +715,25 @@ void validate_input_database(boost::property_tree::ptree &database)
                  "Error: Unknown localization cutoff function. Valid options "
                  "are 'gaspari_cohn', 'step_function', and 'none'.");
   }
+
+  std::string const da_solver_method =
+      database.get("data_assimilation.solver.method", "gmres");
+  ASSERT_THROW(boost::iequals(da_solver_method, "gmres") ||
+                   boost::iequals(da_solver_method, "cholesky"),
+               "Error: Unknown data assimilation solver. Valid options are "
+               "'gmres' and 'cholesky'.");
+
+  std::string da_method = database.get("data_assimilation.method", "enkf");
+  ASSERT_THROW(boost::iequals(da_method, "enkf") ||
+                   boost::iequals(da_method, "etkf") ||
+                   boost::iequals(da_method, "letkf"),
+               "Error: Unknown data assimilation method. Valid options are "
+               "'enkf', 'etkf', and 'letkf'.");
+  if (boost::iequals(da_method, "letkf"))
+  {
+    ASSERT_THROW(database.get_optional<double>(
+                     "data_assimilation.localization_cutoff_distance"),
+                 "Error: The LETKF requires a localization cutoff distance.");
+  }
 }
 } // namespace adamantine
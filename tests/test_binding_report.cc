@@ -0,0 +1,32 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#define BOOST_TEST_MODULE BindingReport
+
+#include <binding_report.hh>
+
+#include <sstream>
+
+#include "main.cc"
+
+BOOST_AUTO_TEST_CASE(format_core_list)
+{
+  BOOST_TEST(adamantine::format_core_list({}) == "");
+  BOOST_TEST(adamantine::format_core_list({4}) == "4");
+  BOOST_TEST(adamantine::format_core_list({0, 1, 2, 3}) == "0-3");
+  // The cores are sorted and the duplicates are removed.
+  BOOST_TEST(adamantine::format_core_list({11, 8, 0, 1, 10, 2, 3, 8}) ==
+             "0-3,8,10-11");
+}
+
+BOOST_AUTO_TEST_CASE(print_binding_report)
+{
+  std::ostringstream out;
+  adamantine::print_binding_report(MPI_COMM_WORLD, out);
+  BOOST_TEST(out.str().find("rank 0: ") != std::string::npos);
+  BOOST_TEST(out.str().find(" threads, cores ") != std::string::npos);
+}
@@ -46,7 +46,7 @@ public:
     BOOST_TEST(da1._additional_data.max_n_tmp_vectors == 4u);
   };
 
-  void test_calc_kalman_gain()
+  void test_calc_kalman_gain(std::string const &solver_method)
   {
     // Create the DoF mapping
     MPI_Comm communicator = MPI_COMM_WORLD;
@@ -81,6 +81,7 @@ public:
     expt_to_dof_mapping.second[1] = 3;
 
     boost::property_tree::ptree solver_settings_database;
+    solver_settings_database.put("solver.method", solver_method);
     DataAssimilator da(solver_settings_database);
     da._sim_size = sim_size;
     da._expt_size = expt_size;
@@ -194,6 +195,16 @@ public:
     BOOST_TEST(da._expt_to_dof_mapping.second[0] == 0);
     BOOST_TEST(da._expt_to_dof_mapping.second[1] == 1);
     BOOST_TEST(da._expt_to_dof_mapping.second[2] == 3);
+
+    // The cached observation matrix is only invalidated when the mapping
+    // changes
+    da._H_is_up_to_date = true;
+    da.update_dof_mapping<2>(expt_to_dof_mapping);
+    BOOST_TEST(da._H_is_up_to_date == true);
+    expt_to_dof_mapping.second[2] = 2;
+    da.update_dof_mapping<2>(expt_to_dof_mapping);
+    BOOST_TEST(da._H_is_up_to_date == false);
+    BOOST_TEST(da._expt_to_dof_mapping.second[2] == 2);
   };
 
   void test_calc_H()
@@ -558,6 +569,51 @@ public:
     BOOST_TEST(cov4.el(5, 5) == 0.005, tt::tolerance(tol));
   };
 
+  void test_calc_ensemble_anomalies()
+  {
+    dealii::LA::distributed::BlockVector<double> sim_vec0(2, 2);
+    sim_vec0[0] = 2.0;
+    sim_vec0[1] = 4.0;
+    sim_vec0[2] = 1.0;
+    sim_vec0[3] = 1.5;
+    dealii::LA::distributed::BlockVector<double> sim_vec1(2, 2);
+    sim_vec1[0] = 2.1;
+    sim_vec1[1] = 4.3;
+    sim_vec1[2] = 1.1;
+    sim_vec1[3] = 1.4;
+    dealii::LA::distributed::BlockVector<double> sim_vec2(2, 2);
+    sim_vec2[0] = 2.3;
+    sim_vec2[1] = 4.2;
+    sim_vec2[2] = 1.3;
+    sim_vec2[3] = 1.6;
+
+    std::vector<dealii::LA::distributed::BlockVector<double>> vec_ensemble;
+    vec_ensemble.push_back(sim_vec0);
+    vec_ensemble.push_back(sim_vec1);
+    vec_ensemble.push_back(sim_vec2);
+
+    boost::property_tree::ptree database;
+    DataAssimilator da(database);
+    da._num_ensemble_members = vec_ensemble.size();
+
+    auto anomalies = da.calc_ensemble_anomalies(vec_ensemble);
+
+    // Check results
+    BOOST_TEST(anomalies.m() == 4u);
+    BOOST_TEST(anomalies.n() == 3u);
+    double tol = 1e-10;
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+      double mean = 0.;
+      for (unsigned int k = 0; k < 3; ++k)
+        mean += vec_ensemble[k][i];
+      mean /= 3.;
+      for (unsigned int k = 0; k < 3; ++k)
+        BOOST_TEST(anomalies(i, k) == vec_ensemble[k][i] - mean,
+                   tt::tolerance(tol));
+    }
+  }
+
   void test_fill_noise_vector(bool R_is_diagonal)
   {
     if (R_is_diagonal)
@@ -751,6 +807,206 @@ public:
     }
   };
 
+  void test_update_ensemble_etkf()
+  {
+    MPI_Comm communicator = MPI_COMM_WORLD;
+
+    unsigned int const sim_size = 4;
+    unsigned int const expt_size = 2;
+    unsigned int const n_members = 3;
+
+    std::vector<double> expt_vec(expt_size);
+    expt_vec[0] = 2.5;
+    expt_vec[1] = 9.5;
+
+    std::pair<std::vector<int>, std::vector<int>> expt_to_dof_mapping;
+    expt_to_dof_mapping.first = {0, 1};
+    expt_to_dof_mapping.second = {1, 3};
+
+    boost::property_tree::ptree database;
+    database.put("method", "etkf");
+    DataAssimilator da(database);
+    da.update_dof_mapping<2>(expt_to_dof_mapping);
+
+    // Create the simulation data
+    std::vector<std::vector<double>> values = {
+        {1.0, 3.0, 6.0, 9.0}, {1.5, 3.2, 6.3, 9.7}, {1.1, 3.1, 6.1, 9.1}};
+    std::vector<dealii::LA::distributed::BlockVector<double>>
+        augmented_state_ensemble(n_members);
+    for (unsigned int member = 0; member < n_members; ++member)
+    {
+      augmented_state_ensemble[member].reinit(2);
+      augmented_state_ensemble[member].block(0).reinit(sim_size);
+      for (unsigned int i = 0; i < sim_size; ++i)
+        augmented_state_ensemble[member].block(0)(i) = values[member][i];
+      augmented_state_ensemble[member].collect_sizes();
+    }
+
+    // Build the sparse experimental covariance matrix
+    dealii::SparsityPattern pattern(expt_size, expt_size, 1);
+    pattern.add(0, 0);
+    pattern.add(1, 1);
+    pattern.compress();
+
+    dealii::SparseMatrix<double> R(pattern);
+    R.add(0, 0, 0.002);
+    R.add(1, 1, 0.001);
+
+    // Compute the reference solution using the Kalman gain computed from the
+    // sample covariance, K = P H^T (H P H^T + R)^-1
+    dealii::FullMatrix<double> P =
+        calc_sample_covariance_dense(augmented_state_ensemble);
+    dealii::Vector<double> mean(sim_size);
+    for (unsigned int member = 0; member < n_members; ++member)
+      for (unsigned int i = 0; i < sim_size; ++i)
+        mean[i] += values[member][i] / n_members;
+    dealii::FullMatrix<double> H(expt_size, sim_size);
+    H(0, 1) = 1.;
+    H(1, 3) = 1.;
+    dealii::FullMatrix<double> PHt(sim_size, expt_size);
+    P.mTmult(PHt, H);
+    dealii::FullMatrix<double> HPHt_plus_R(expt_size);
+    H.mmult(HPHt_plus_R, PHt);
+    for (unsigned int i = 0; i < expt_size; ++i)
+      HPHt_plus_R(i, i) += R(i, i);
+    HPHt_plus_R.gauss_jordan();
+    dealii::FullMatrix<double> K(sim_size, expt_size);
+    PHt.mmult(K, HPHt_plus_R);
+    dealii::Vector<double> innovation(expt_size);
+    dealii::Vector<double> observed_mean(expt_size);
+    H.vmult(observed_mean, mean);
+    for (unsigned int i = 0; i < expt_size; ++i)
+      innovation[i] = expt_vec[i] - observed_mean[i];
+    dealii::Vector<double> ref_mean(mean);
+    K.vmult_add(ref_mean, innovation);
+    dealii::FullMatrix<double> KH(sim_size);
+    K.mmult(KH, H);
+    dealii::FullMatrix<double> ref_P(sim_size);
+    KH.mmult(ref_P, P);
+    ref_P *= -1.;
+    ref_P.add(1., P);
+
+    // Update the simulation data
+    da.update_ensemble(communicator, augmented_state_ensemble, expt_vec, R);
+
+    // The mean and the covariance of the ensemble are the ones given by the
+    // Kalman filter
+    double const tol = 1e-8;
+    dealii::FullMatrix<double> analysis_P =
+        calc_sample_covariance_dense(augmented_state_ensemble);
+    for (unsigned int i = 0; i < sim_size; ++i)
+    {
+      double analysis_mean = 0.;
+      for (unsigned int member = 0; member < n_members; ++member)
+        analysis_mean += augmented_state_ensemble[member].block(0)(i);
+      analysis_mean /= n_members;
+      BOOST_TEST(analysis_mean == ref_mean[i], tt::tolerance(tol));
+      for (unsigned int j = 0; j < sim_size; ++j)
+        BOOST_TEST(analysis_P(i, j) == ref_P(i, j), tt::tolerance(tol));
+    }
+  }
+
+  void test_update_ensemble_letkf()
+  {
+    MPI_Comm communicator = MPI_COMM_WORLD;
+
+    boost::property_tree::ptree database;
+    database.put("import_mesh", false);
+    database.put("length", 1);
+    database.put("length_divisions", 1);
+    database.put("height", 1);
+    database.put("height_divisions", 1);
+    adamantine::Geometry<2> geometry(communicator, database);
+    dealii::parallel::distributed::Triangulation<2> const &tria =
+        geometry.get_triangulation();
+
+    dealii::FE_Q<2> fe(1);
+    dealii::DoFHandler<2> dof_handler(tria);
+    dof_handler.distribute_dofs(fe);
+
+    unsigned int const sim_size = 4;
+    unsigned int const expt_size = 2;
+    unsigned int const n_members = 3;
+
+    std::vector<double> expt_vec = {2.5, 9.5};
+    std::vector<dealii::Point<2>> expt_points = {dealii::Point<2>(0., 0.),
+                                                 dealii::Point<2>(1., 1.)};
+    std::pair<std::vector<int>, std::vector<int>> expt_to_dof_mapping;
+    expt_to_dof_mapping.first = {0, 1};
+    expt_to_dof_mapping.second = {1, 3};
+
+    std::vector<std::vector<double>> values = {
+        {1.0, 3.0, 6.0, 9.0}, {1.5, 3.2, 6.3, 9.7}, {1.1, 3.1, 6.1, 9.1}};
+    std::vector<dealii::LA::distributed::BlockVector<double>> etkf_ensemble(
+        n_members);
+    for (unsigned int member = 0; member < n_members; ++member)
+    {
+      etkf_ensemble[member].reinit(2);
+      etkf_ensemble[member].block(0).reinit(sim_size);
+      for (unsigned int i = 0; i < sim_size; ++i)
+        etkf_ensemble[member].block(0)(i) = values[member][i];
+      etkf_ensemble[member].collect_sizes();
+    }
+    auto letkf_ensemble = etkf_ensemble;
+
+    dealii::SparsityPattern pattern(expt_size, expt_size, 1);
+    pattern.add(0, 0);
+    pattern.add(1, 1);
+    pattern.compress();
+
+    dealii::SparseMatrix<double> R(pattern);
+    R.add(0, 0, 0.002);
+    R.add(1, 1, 0.001);
+
+    boost::property_tree::ptree etkf_database;
+    etkf_database.put("method", "etkf");
+    DataAssimilator etkf(etkf_database);
+    etkf.update_dof_mapping<2>(expt_to_dof_mapping);
+    etkf.update_ensemble(communicator, etkf_ensemble, expt_vec, R);
+
+    // When all the observations are within the cutoff distance and they are
+    // not weighted, the LETKF gives the same result as the ETKF
+    boost::property_tree::ptree letkf_database;
+    letkf_database.put("method", "letkf");
+    letkf_database.put("localization_cutoff_distance", 100.);
+    DataAssimilator letkf(letkf_database);
+    letkf.update_dof_mapping<2>(expt_to_dof_mapping);
+    letkf.update_covariance_sparsity_pattern<2>(dof_handler, 0);
+    letkf.update_local_observations<2>(communicator, expt_points);
+    BOOST_TEST(letkf._local_observation_indices.size() == 8u);
+    letkf.update_ensemble(communicator, letkf_ensemble, expt_vec, R);
+
+    double const tol = 1e-10;
+    for (unsigned int member = 0; member < n_members; ++member)
+      for (unsigned int i = 0; i < sim_size; ++i)
+        BOOST_TEST(letkf_ensemble[member].block(0)(i) ==
+                       etkf_ensemble[member].block(0)(i),
+                   tt::tolerance(tol));
+
+    // With a small cutoff distance, each observation only updates the dof at
+    // its location
+    letkf_ensemble = std::vector<dealii::LA::distributed::BlockVector<double>>(
+        n_members);
+    for (unsigned int member = 0; member < n_members; ++member)
+    {
+      letkf_ensemble[member].reinit(2);
+      letkf_ensemble[member].block(0).reinit(sim_size);
+      for (unsigned int i = 0; i < sim_size; ++i)
+        letkf_ensemble[member].block(0)(i) = values[member][i];
+      letkf_ensemble[member].collect_sizes();
+    }
+    letkf._localization_cutoff_distance = 1e-6;
+    letkf._localization_cutoff_function = LocalizationCutoff::step_function;
+    letkf.update_local_observations<2>(communicator, expt_points);
+    BOOST_TEST(letkf._local_observation_indices.size() == 2u);
+    letkf.update_ensemble(communicator, letkf_ensemble, expt_vec, R);
+    unsigned int n_updated_dofs = 0;
+    for (unsigned int i = 0; i < sim_size; ++i)
+      if (letkf_ensemble[0].block(0)(i) != values[0][i])
+        ++n_updated_dofs;
+    BOOST_TEST(n_updated_dofs == 2u);
+  }
+
   void test_update_ensemble_augmented()
   {
     // Create the DoF mapping
@@ -931,13 +1187,17 @@ BOOST_AUTO_TEST_CASE(data_assimilator)
   dat.test_constructor();
   dat.test_update_dof_mapping();
   dat.test_update_covariance_sparsity_pattern();
+  dat.test_calc_ensemble_anomalies();
   dat.test_calc_sample_covariance_sparse();
   dat.test_fill_noise_vector(true);
   dat.test_fill_noise_vector(false);
   dat.test_calc_H();
   dat.test_calc_Hx();
-  dat.test_calc_kalman_gain();
+  dat.test_calc_kalman_gain("gmres");
+  dat.test_calc_kalman_gain("cholesky");
   dat.test_update_ensemble();
   dat.test_update_ensemble_augmented();
+  dat.test_update_ensemble_etkf();
+  dat.test_update_ensemble_letkf();
 }
 } // namespace adamantine
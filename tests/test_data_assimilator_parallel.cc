@@ -0,0 +1,121 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#define BOOST_TEST_MODULE DataAssimilatorParallel
+
+#include <DataAssimilator.hh>
+#include <Geometry.hh>
+#include <experimental_data_utils.hh>
+
+#include <deal.II/base/function.h>
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/lac/la_parallel_block_vector.h>
+#include <deal.II/numerics/vector_tools.h>
+
+#include "main.cc"
+
+namespace tt = boost::test_tools;
+
+// Assimilate the same observations on a mesh distributed over the processors
+// of communicator and return the norm of each analysis member. The norms do
+// not depend on the partitioning of the mesh.
+std::vector<double> assimilate(MPI_Comm const &communicator,
+                               std::string const &method,
+                               unsigned int const n_divisions)
+{
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 1);
+  geometry_database.put("length_divisions", n_divisions);
+  geometry_database.put("height", 1);
+  geometry_database.put("height_divisions", n_divisions);
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  dealii::FE_Q<2> fe(1);
+  dealii::DoFHandler<2> dof_handler(geometry.get_triangulation());
+  dof_handler.distribute_dofs(fe);
+
+  // The members are linear so that they are represented exactly on every mesh
+  unsigned int const n_members = 3;
+  std::vector<dealii::LA::distributed::BlockVector<double>> ensemble(
+      n_members);
+  for (unsigned int member = 0; member < n_members; ++member)
+  {
+    ensemble[member].reinit(2);
+    ensemble[member].block(0).reinit(dof_handler.locally_owned_dofs(),
+                                     communicator);
+    dealii::VectorTools::interpolate(
+        dof_handler,
+        dealii::ScalarFunctionFromFunctionObject<2>(
+            [member](dealii::Point<2> const &p)
+            { return 300. + 10. * (member + 1.) * p[0] + 5. * member * p[1]; }),
+        ensemble[member].block(0));
+    ensemble[member].collect_sizes();
+  }
+
+  // The observations are located on vertices of the coarsest mesh
+  adamantine::PointsValues<2> points_values;
+  points_values.points = {dealii::Point<2>(0., 0.), dealii::Point<2>(1., 1.),
+                          dealii::Point<2>(1., 0.)};
+  points_values.values = {305., 330., 318.};
+  unsigned int const expt_size = points_values.values.size();
+  auto const expt_to_dof_mapping =
+      adamantine::get_expt_to_dof_mapping(points_values, dof_handler);
+
+  dealii::SparsityPattern pattern(expt_size, expt_size, 1);
+  for (unsigned int i = 0; i < expt_size; ++i)
+    pattern.add(i, i);
+  pattern.compress();
+  dealii::SparseMatrix<double> R(pattern);
+  for (unsigned int i = 0; i < expt_size; ++i)
+    R.add(i, i, 0.01);
+
+  boost::property_tree::ptree database;
+  database.put("method", method);
+  database.put("localization_cutoff_distance", 100.);
+  adamantine::DataAssimilator data_assimilator(database);
+  data_assimilator.update_dof_mapping<2>(expt_to_dof_mapping);
+  data_assimilator.update_covariance_sparsity_pattern<2>(dof_handler, 0);
+  data_assimilator.update_local_observations<2>(communicator,
+                                                points_values.points);
+  data_assimilator.update_ensemble(communicator, ensemble, points_values.values,
+                                   R);
+
+  std::vector<double> norms;
+  for (auto const &member : ensemble)
+    norms.push_back(member.l2_norm());
+
+  return norms;
+}
+
+BOOST_AUTO_TEST_CASE(letkf_parallel)
+{
+  // With a single cell and two processors, the second processor owns no dof.
+  for (unsigned int const n_divisions : {1, 4})
+  {
+    std::vector<double> const norms =
+        assimilate(MPI_COMM_WORLD, "letkf", n_divisions);
+    std::vector<double> const serial_norms =
+        assimilate(MPI_COMM_SELF, "letkf", n_divisions);
+    for (unsigned int member = 0; member < norms.size(); ++member)
+      BOOST_TEST(norms[member] == serial_norms[member], tt::tolerance(1e-10));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(etkf_parallel)
+{
+  // Each observation is evaluated by the processor that owns the closest dof,
+  // so the transform is the same on all the processors.
+  for (unsigned int const n_divisions : {1, 4})
+  {
+    std::vector<double> const norms =
+        assimilate(MPI_COMM_WORLD, "etkf", n_divisions);
+    std::vector<double> const serial_norms =
+        assimilate(MPI_COMM_SELF, "etkf", n_divisions);
+    for (unsigned int member = 0; member < norms.size(); ++member)
+      BOOST_TEST(norms[member] == serial_norms[member], tt::tolerance(1e-10));
+  }
+}
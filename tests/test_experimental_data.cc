@@ -18,6 +18,11 @@
 #include <deal.II/fe/fe_q.h>
 #include <deal.II/grid/filtered_iterator.h>
 
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
 #include "main.cc"
 
 namespace utf = boost::unit_test;
@@ -73,6 +78,94 @@ BOOST_AUTO_TEST_CASE(read_experimental_data_point_cloud_from_file)
   }
 }
 
+BOOST_AUTO_TEST_CASE(prefetch_experimental_data_point_cloud_from_file)
+{
+  boost::property_tree::ptree experiment_database;
+  experiment_database.put("file", "experimental_data_#camera_#frame.csv");
+  experiment_database.put("last_frame", 0);
+  experiment_database.put("first_camera_id", 0);
+  experiment_database.put("last_camera_id", 0);
+
+  adamantine::PointCloud<3> point_cloud(experiment_database);
+  point_cloud.read_next_frame();
+  auto points_values = point_cloud.get_points_values();
+
+  // Read the same frame on a helper thread
+  experiment_database.put("prefetch_frames", 2);
+  adamantine::PointCloud<3> prefetched_point_cloud(experiment_database);
+  BOOST_TEST(prefetched_point_cloud.read_next_frame() == 0);
+  auto prefetched_points_values = prefetched_point_cloud.get_points_values();
+
+  BOOST_TEST(prefetched_points_values.values == points_values.values);
+  BOOST_TEST((prefetched_points_values.points == points_values.points));
+
+  // There are no frames left
+  BOOST_CHECK_THROW(prefetched_point_cloud.read_next_frame(),
+                    std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(read_experimental_data_point_cloud_from_binary_file)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  boost::property_tree::ptree experiment_database;
+  experiment_database.put("file", "experimental_data_#camera_#frame.csv");
+  experiment_database.put("last_frame", 0);
+  experiment_database.put("first_camera_id", 0);
+  experiment_database.put("last_camera_id", 0);
+
+  adamantine::PointCloud<3> point_cloud(experiment_database);
+  point_cloud.read_next_frame();
+  auto points_values = point_cloud.get_points_values();
+
+  // Write the same frame in the binary format. Each processor writes its own
+  // file.
+  std::string const binary_prefix =
+      "experimental_data_binary_" +
+      std::to_string(dealii::Utilities::MPI::this_mpi_process(communicator));
+  std::string const binary_filename = binary_prefix + "_0.bin";
+  {
+    std::ofstream file(binary_filename, std::ios::binary);
+    std::uint64_t const n_entries = points_values.values.size();
+    file.write(reinterpret_cast<char const *>(&n_entries), sizeof(n_entries));
+    for (unsigned int d = 0; d < 3; ++d)
+      for (auto const &point : points_values.points)
+        file.write(reinterpret_cast<char const *>(&point[d]), sizeof(double));
+    file.write(reinterpret_cast<char const *>(points_values.values.data()),
+               n_entries * sizeof(double));
+  }
+
+  experiment_database.put("file", binary_prefix + "_#frame.bin");
+  experiment_database.put("file_format", "binary");
+  adamantine::PointCloud<3> binary_point_cloud(experiment_database);
+  binary_point_cloud.read_next_frame();
+  auto binary_points_values = binary_point_cloud.get_points_values();
+
+  BOOST_TEST(binary_points_values.values == points_values.values);
+  BOOST_TEST((binary_points_values.points == points_values.points));
+
+  // A header that does not match the size of the file is rejected before the
+  // columns are allocated.
+  {
+    std::ofstream file(binary_filename, std::ios::binary);
+    std::uint64_t const n_entries = std::numeric_limits<std::uint64_t>::max();
+    file.write(reinterpret_cast<char const *>(&n_entries), sizeof(n_entries));
+    double const value = 1.;
+    file.write(reinterpret_cast<char const *>(&value), sizeof(value));
+  }
+  BOOST_CHECK_THROW(adamantine::read_binary_frame_file(binary_filename, 4),
+                    std::runtime_error);
+  {
+    std::ofstream file(binary_filename, std::ios::binary);
+    std::uint64_t const n_entries = 2;
+    file.write(reinterpret_cast<char const *>(&n_entries), sizeof(n_entries));
+  }
+  BOOST_CHECK_THROW(adamantine::read_binary_frame_file(binary_filename, 4),
+                    std::runtime_error);
+
+  std::filesystem::remove(binary_filename);
+}
+
 BOOST_AUTO_TEST_CASE(set_vector_with_experimental_data_point_cloud)
 {
   MPI_Comm communicator = MPI_COMM_WORLD;
@@ -136,6 +229,14 @@ BOOST_AUTO_TEST_CASE(set_vector_with_experimental_data_point_cloud)
       BOOST_TEST(temperature.local_element(i) ==
                  temperature_ref[locally_owned_dofs.nth_index_in_set(i)]);
     }
+
+    // The search structure can be reused for several frames
+    adamantine::ExperimentToDofMapper<3> expt_to_dof_mapper(dof_handler);
+    for (unsigned int frame = 0; frame < 2; ++frame)
+    {
+      auto frame_expt_to_dof_mapping = expt_to_dof_mapper.map(points_values);
+      BOOST_TEST((frame_expt_to_dof_mapping == expt_to_dof_mapping));
+    }
   }
 }
 
@@ -192,6 +293,12 @@ BOOST_AUTO_TEST_CASE(read_experimental_data_ray_tracing_from_file)
         BOOST_TEST(points_values.values[i] == values_ref[i]);
         BOOST_TEST(points_values.points[i] == points_ref[i]);
       }
+
+      // The search tree is rebuilt when the mesh changes
+      ray_tracing.mesh_changed();
+      auto rebuilt_points_values = ray_tracing.get_points_values();
+      BOOST_TEST(rebuilt_points_values.values == points_values.values);
+      BOOST_TEST((rebuilt_points_values.points == points_values.points));
     }
     else
     {
@@ -11,6 +11,7 @@
 #include <types.hh>
 
 #include <deal.II/grid/filtered_iterator.h>
+#include <deal.II/grid/grid_in.h>
 
 #include <boost/property_tree/ptree.hpp>
 
@@ -119,3 +120,37 @@ BOOST_AUTO_TEST_CASE(gmsh)
   dealii::types::boundary_id const top_boundary = 1;
   check_material_id(tria, top_boundary);
 }
+
+BOOST_AUTO_TEST_CASE(gmsh_read_on_one_processor)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+  boost::property_tree::ptree database;
+  database.put("import_mesh", true);
+  database.put("mesh_file", "extruded_cube.msh");
+  database.put("mesh_format", "gmsh");
+
+  adamantine::Geometry<3> geometry(communicator, database);
+  dealii::parallel::distributed::Triangulation<3> const &tria =
+      geometry.get_triangulation();
+
+  // The coarse mesh broadcast from the first processor must be the same as the
+  // mesh read directly from the file.
+  dealii::Triangulation<3> serial_tria;
+  dealii::GridIn<3> grid_in;
+  grid_in.attach_triangulation(serial_tria);
+  grid_in.read("extruded_cube.msh", dealii::GridIn<3>::Format::msh);
+
+  BOOST_TEST(tria.n_global_coarse_cells() == serial_tria.n_cells(0));
+  BOOST_TEST(tria.n_vertices() == serial_tria.n_vertices());
+  auto serial_cell = serial_tria.begin(0);
+  for (auto cell = tria.begin(0); cell != tria.end(0); ++cell, ++serial_cell)
+  {
+    BOOST_TEST(cell->material_id() == serial_cell->material_id());
+    for (unsigned int v = 0; v < cell->n_vertices(); ++v)
+      BOOST_TEST(cell->vertex(v).distance(serial_cell->vertex(v)) == 0.);
+    for (unsigned int f = 0; f < cell->n_faces(); ++f)
+      if (cell->face(f)->at_boundary())
+        BOOST_TEST(cell->face(f)->boundary_id() ==
+                   serial_cell->face(f)->boundary_id());
+  }
+}
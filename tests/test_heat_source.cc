@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2021, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -7,6 +7,7 @@
 
 #define BOOST_TEST_MODULE HeatSource
 
+#include <CubeHeatSource.hh>
 #include <ElectronBeamHeatSource.hh>
 #include <GoldakHeatSource.hh>
 #include <HeatSource.hh>
@@ -15,6 +16,7 @@
 #include "main.cc"
 
 namespace utf = boost::unit_test;
+namespace tt = boost::test_tools;
 
 namespace adamantine
 {
@@ -168,6 +170,65 @@ BOOST_AUTO_TEST_CASE(heat_source_value_3d, *utf::tolerance(1e-12))
   BOOST_TEST(eb_value == expected_value);
 }
 
+BOOST_AUTO_TEST_CASE(heat_source_value_vectorized, *utf::tolerance(1e-12))
+{
+  boost::property_tree::ptree database;
+
+  database.put("depth", 0.1);
+  database.put("absorption_efficiency", 0.1);
+  database.put("diameter", 1.0);
+  database.put("max_power", 10.);
+  database.put("scan_path_file", "scan_path.txt");
+  database.put("scan_path_file_format", "segment");
+  GoldakHeatSource<3> goldak_heat_source(database);
+  ElectronBeamHeatSource<3> eb_heat_source(database);
+  goldak_heat_source.update_time(0.001001);
+  eb_heat_source.update_time(0.001001);
+
+  boost::property_tree::ptree cube_database;
+  cube_database.put("start_time", 0.);
+  cube_database.put("end_time", 1.);
+  cube_database.put("value", 10.);
+  cube_database.put("min_x", 0.);
+  cube_database.put("max_x", 8.e-4);
+  cube_database.put("min_y", 0.);
+  cube_database.put("max_y", 0.1);
+  cube_database.put("min_z", 0.1);
+  cube_database.put("max_z", 0.2);
+  CubeHeatSource<3> cube_heat_source(cube_database);
+  cube_heat_source.update_time(0.5);
+
+  // Fill the lanes with points below the beam, far from the beam, at the
+  // center of the beam, and slightly off the center.
+  std::vector<dealii::Point<3>> points = {
+      dealii::Point<3>(0.0, 0.0, 0.05), dealii::Point<3>(10.0, 0.0, 0.0),
+      dealii::Point<3>(8e-4, 0.0, 0.2), dealii::Point<3>(7.0e-4, 0.0, 0.19)};
+  unsigned int constexpr n_lanes = dealii::VectorizedArray<double>::size();
+  dealii::Point<3, dealii::VectorizedArray<double>> vectorized_points;
+  dealii::Point<3, dealii::VectorizedArray<float>> float_points;
+  for (unsigned int i = 0; i < n_lanes; ++i)
+    for (unsigned int d = 0; d < 3; ++d)
+      vectorized_points[d][i] = points[i % points.size()][d];
+  for (unsigned int i = 0; i < dealii::VectorizedArray<float>::size(); ++i)
+    for (unsigned int d = 0; d < 3; ++d)
+      float_points[d][i] = points[i % points.size()][d];
+
+  std::vector<HeatSource<3> const *> heat_sources = {
+      &goldak_heat_source, &eb_heat_source, &cube_heat_source};
+  for (auto heat_source : heat_sources)
+  {
+    auto const values = heat_source->value(vectorized_points, 0.2);
+    auto const float_values = heat_source->value(float_points, 0.2);
+    for (unsigned int i = 0; i < n_lanes; ++i)
+    {
+      double const expected_value =
+          heat_source->value(points[i % points.size()], 0.2);
+      BOOST_TEST(values[i] == expected_value);
+      BOOST_TEST(float_values[i] == expected_value, tt::tolerance(1e-5));
+    }
+  }
+}
+
 BOOST_AUTO_TEST_CASE(heat_source_height, *utf::tolerance(1e-12))
 {
   boost::property_tree::ptree database;
@@ -206,4 +267,69 @@ BOOST_AUTO_TEST_CASE(heat_source_height, *utf::tolerance(1e-12))
   BOOST_TEST(eb_height == 0.001);
 }
 
+BOOST_AUTO_TEST_CASE(heat_source_time_integration, *utf::tolerance(1e-6))
+{
+  boost::property_tree::ptree database;
+
+  database.put("depth", 1e-4);
+  database.put("absorption_efficiency", 0.1);
+  database.put("diameter", 1e-3);
+  database.put("max_power", 10.);
+  database.put("scan_path_file", "scan_path.txt");
+  database.put("scan_path_file_format", "segment");
+  GoldakHeatSource<3> goldak_heat_source(database);
+  ElectronBeamHeatSource<3> eb_heat_source(database);
+  GoldakHeatSource<3> goldak_reference(database);
+  ElectronBeamHeatSource<3> eb_reference(database);
+
+  // The beam moves by 8e-4 m during the interval, more than its radius.
+  double const start_time = 5.01e-4;
+  double const end_time = 1.501e-3;
+  std::vector<std::pair<HeatSource<3> *, HeatSource<3> *>> heat_sources = {
+      {&goldak_heat_source, &goldak_reference},
+      {&eb_heat_source, &eb_reference}};
+  std::vector<dealii::Point<3>> points = {
+      dealii::Point<3>(4e-4, 0., 0.2), dealii::Point<3>(8e-4, 2e-4, 0.2),
+      dealii::Point<3>(1.3e-3, -1e-4, 0.19995), dealii::Point<3>(-2e-4, 0., 0.2)};
+  unsigned int const n_samples = 4000;
+  for (auto &[heat_source, reference] : heat_sources)
+  {
+    heat_source->set_time_integration_interval(start_time, end_time);
+    heat_source->update_time(0.5 * (start_time + end_time));
+    HeatSourceData<3> const data = heat_source->get_data();
+    BOOST_TEST(data.beam_displacement[0] == 8e-4);
+
+    dealii::Point<3, dealii::VectorizedArray<double>> vectorized_points;
+    unsigned int constexpr n_lanes = dealii::VectorizedArray<double>::size();
+    for (unsigned int i = 0; i < n_lanes; ++i)
+      for (unsigned int d = 0; d < 3; ++d)
+        vectorized_points[d][i] = points[i % points.size()][d];
+    auto const values = heat_source->value(vectorized_points, 0.2);
+
+    for (unsigned int i = 0; i < points.size(); ++i)
+    {
+      // Average of the source using the midpoint rule
+      double expected_value = 0.;
+      for (unsigned int k = 0; k < n_samples; ++k)
+      {
+        reference->update_time(start_time + (k + 0.5) / n_samples *
+                                                 (end_time - start_time));
+        expected_value += reference->value(points[i], 0.2) / n_samples;
+      }
+      BOOST_TEST(heat_source->value(points[i], 0.2) == expected_value);
+      BOOST_TEST(compute_heat_source(data, &points[i][0], 0.2) ==
+                 expected_value);
+      if (i < n_lanes)
+        BOOST_TEST(values[i] == expected_value);
+    }
+
+    // Outside of the interval, the source is evaluated at the given time.
+    heat_source->update_time(2e-3);
+    reference->update_time(2e-3);
+    BOOST_TEST(heat_source->get_data().beam_displacement[0] == 0.);
+    BOOST_TEST(heat_source->value(points[1], 0.2) ==
+               reference->value(points[1], 0.2));
+  }
+}
+
 } // namespace adamantine
@@ -9,6 +9,10 @@
 
 #include "../application/adamantine.hh"
 
+#include <deal.II/base/function.h>
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/numerics/vector_tools.h>
+
 #include <filesystem>
 #include <fstream>
 
@@ -42,6 +46,38 @@ BOOST_AUTO_TEST_CASE(integration_2D, *utf::tolerance(0.1))
   }
 }
 
+BOOST_AUTO_TEST_CASE(integration_2D_restart, *utf::tolerance(0.1))
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  std::vector<adamantine::Timer> timers;
+  initialize_timers(communicator, timers);
+
+  // Read the input.
+  std::string const filename = "integration_2d.info";
+  adamantine::ASSERT_THROW(std::filesystem::exists(filename) == true,
+                           "The file " + filename + " does not exist.");
+  boost::property_tree::ptree database;
+  boost::property_tree::info_parser::read_info(filename, database);
+
+  // Write a checkpoint in the middle of the simulation and restart from it
+  database.put("checkpoint.filename_prefix", "integration_2d_checkpoint");
+  database.put("checkpoint.time_steps_between_checkpoint", 10);
+  run<2, dealii::MemorySpace::Host>(communicator, database, timers);
+  database.erase("checkpoint");
+  database.put("restart.filename_prefix", "integration_2d_checkpoint.10");
+  auto [temperature, displacement] =
+      run<2, dealii::MemorySpace::Host>(communicator, database, timers);
+
+  std::ifstream gold_file("integration_2d_gold.txt");
+  for (unsigned int i = 0; i < temperature.locally_owned_size(); ++i)
+  {
+    double gold_value = -1.;
+    gold_file >> gold_value;
+    BOOST_TEST(temperature.local_element(i) == gold_value);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(integration_2D_ensemble, *utf::tolerance(0.1))
 {
   MPI_Comm communicator = MPI_COMM_WORLD;
@@ -71,3 +107,280 @@ BOOST_AUTO_TEST_CASE(integration_2D_ensemble, *utf::tolerance(0.1))
     }
   }
 }
+
+BOOST_AUTO_TEST_CASE(integration_2D_ensemble_single_precision,
+                     *utf::tolerance(0.1))
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  std::vector<adamantine::Timer> timers;
+  initialize_timers(communicator, timers);
+
+  // Read the input.
+  std::string const filename = "integration_2d_ensemble.info";
+  adamantine::ASSERT_THROW(std::filesystem::exists(filename) == true,
+                           "The file " + filename + " does not exist.");
+  boost::property_tree::ptree database;
+  boost::property_tree::info_parser::read_info(filename, database);
+  // The idle members are stored in single precision
+  database.put("ensemble.single_precision_storage", true);
+
+  auto result = run_ensemble<2, dealii::MemorySpace::Host>(communicator,
+                                                           database, timers);
+
+  for (unsigned int member = 0; member < 3; ++member)
+  {
+    std::ifstream gold_file("integration_2d_gold.txt");
+    for (unsigned int i = 0; i < result[member].block(0).locally_owned_size();
+         ++i)
+    {
+      double gold_value = -1.;
+      gold_file >> gold_value;
+      BOOST_TEST(result[member].block(0).local_element(i) == gold_value);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(single_precision_storage_round_trip)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  // Small variations around a large temperature are lost when the temperature
+  // itself is rounded to single precision.
+  unsigned int const n_procs =
+      dealii::Utilities::MPI::n_mpi_processes(communicator);
+  unsigned int const rank =
+      dealii::Utilities::MPI::this_mpi_process(communicator);
+  unsigned int const local_size = 100;
+  dealii::IndexSet locally_owned(n_procs * local_size);
+  locally_owned.add_range(rank * local_size, (rank + 1) * local_size);
+  dealii::LA::distributed::Vector<double> temperature(locally_owned,
+                                                      communicator);
+  for (unsigned int i = 0; i < local_size; ++i)
+    temperature.local_element(i) = 1000. + 1e-4 * (rank * local_size + i);
+  dealii::LA::distributed::Vector<double> const reference(temperature);
+
+  // Store and restore the temperature several times like an idle member
+  dealii::LA::distributed::Vector<float> stored;
+  double offset = 0.;
+  for (unsigned int i = 0; i < 10; ++i)
+  {
+    store_in_single_precision(temperature, stored, offset);
+    BOOST_TEST(temperature.size() == 0u);
+    restore_from_single_precision(stored, offset, temperature);
+    BOOST_TEST(stored.size() == 0u);
+  }
+
+  temperature -= reference;
+  BOOST_TEST(temperature.linfty_norm() < 1e-7);
+}
+
+BOOST_AUTO_TEST_CASE(restore_scheduled_time_step_after_event)
+{
+  // The step was shortened to end at an event: the guess is based on the
+  // shortened step and the scheduled step is used again.
+  BOOST_TEST(restore_scheduled_time_step(0.2, 1., 0.2) == 1.);
+  BOOST_TEST(restore_scheduled_time_step(0.4, 1., 0.2) == 1.);
+  // The step was not shortened: the guess of the error controller is kept,
+  // whether it grows or shrinks the step.
+  BOOST_TEST(restore_scheduled_time_step(0.5, 1., 1.) == 0.5);
+  BOOST_TEST(restore_scheduled_time_step(2., 1., 1.) == 2.);
+  // A guess larger than the scheduled step is kept after an event.
+  BOOST_TEST(restore_scheduled_time_step(1.5, 1., 0.2) == 1.5);
+}
+
+BOOST_AUTO_TEST_CASE(activation_window_clamped_to_deposition_window)
+{
+  // The activation window ends before the deposition window.
+  BOOST_TEST(activation_window_end(1., 0.5, 3.) == 1.5);
+  // The boxes past the end of the deposition window have not been created:
+  // they are activated once the window has moved over them.
+  BOOST_TEST(activation_window_end(1., 5., 3.) == 3.);
+  // Without a deposition window, all the boxes are created.
+  double const no_window_end = std::numeric_limits<double>::max();
+  BOOST_TEST(activation_window_end(1., 5., no_window_end) == 6.);
+}
+
+// Cool down a perturbed temperature on the domain [0, 10]^2. The beam of
+// scan_path_test_thermal_physics.txt is on until t = 1 and forward Euler is
+// used with the beam time step. If dwell_time_step is positive, the time step
+// of the dwell period that follows is given by compute_dwell_time_step() and
+// the dwell method is used. Return the solution at t = 10.
+dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+cool_down(double const dwell_time_step, unsigned int &n_dwell_steps)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  // Build Geometry
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 10);
+  geometry_database.put("length_divisions", 10);
+  geometry_database.put("height", 10);
+  geometry_database.put("height_divisions", 10);
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  // Build MaterialProperty
+  boost::property_tree::ptree material_property_database;
+  material_property_database.put("property_format", "polynomial");
+  material_property_database.put("n_materials", 1);
+  for (std::string const state : {"solid", "powder", "liquid"})
+  {
+    material_property_database.put("material_0." + state + ".density", 0.5);
+    material_property_database.put("material_0." + state + ".specific_heat",
+                                   4.);
+    material_property_database.put(
+        "material_0." + state + ".thermal_conductivity_x", 2.);
+    material_property_database.put(
+        "material_0." + state + ".thermal_conductivity_z", 2.);
+  }
+  adamantine::MaterialProperty<2, dealii::MemorySpace::Host>
+      material_properties(communicator, geometry.get_triangulation(),
+                          material_property_database);
+  boost::property_tree::ptree database;
+  // Source database
+  database.put("sources.n_beams", 1);
+  database.put("sources.beam_0.type", "electron_beam");
+  database.put("sources.beam_0.depth", 1.);
+  database.put("sources.beam_0.diameter", 1.);
+  database.put("sources.beam_0.max_power", 1e-3);
+  database.put("sources.beam_0.absorption_efficiency", 0.1);
+  database.put("sources.beam_0.scan_path_file",
+               "scan_path_test_thermal_physics.txt");
+  database.put("sources.beam_0.scan_path_file_format", "segment");
+  // Boundary database
+  database.put("boundary.type", "adiabatic");
+  // Time-stepping database
+  database.put("time_stepping.method", "forward_euler");
+  database.put("time_stepping.dwell_time_step", dwell_time_step);
+  database.put("time_stepping.dwell_method", "imex_euler");
+  database.put("time_stepping.max_iteration", 1000);
+  database.put("time_stepping.tolerance", 1e-12);
+  database.put("time_stepping.n_tmp_vectors", 100);
+  // Build ThermalPhysics
+  adamantine::ThermalPhysics<2, 2, dealii::MemorySpace::Host, dealii::QGauss<1>>
+      physics(communicator, database, geometry, material_properties);
+  physics.setup_dofs();
+  physics.update_material_deposition_orientation();
+  physics.compute_inverse_mass_matrix();
+
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> solution;
+  physics.initialize_dof_vector(solution);
+  dealii::VectorTools::interpolate(
+      physics.get_dof_handler(),
+      dealii::ScalarFunctionFromFunctionObject<2>(
+          [](dealii::Point<2> const &p)
+          {
+            return 10. + std::cos(dealii::numbers::PI * p[0] / 10.) *
+                             std::cos(dealii::numbers::PI * p[1] / 10.);
+          }),
+      solution);
+  physics.get_state_from_material_properties();
+
+  // Same logic as the time loop of run()
+  std::vector<adamantine::Timer> timers(adamantine::Timing::n_timers);
+  double const final_time = 10.;
+  double const beam_time_step = 0.05;
+  double time = 0.;
+  double time_step = beam_time_step;
+  n_dwell_steps = 0;
+  while (time < final_time - 1e-9)
+  {
+    time = physics.evolve_one_time_step(time, time_step, solution, timers);
+    time_step = beam_time_step;
+    if (dwell_time_step > 0.)
+    {
+      double const dwell_step =
+          compute_dwell_time_step(physics.get_heat_sources(), {}, time,
+                                  std::min(dwell_time_step, final_time - time));
+      bool const dwell = dwell_step > beam_time_step;
+      if (dwell)
+      {
+        time_step = dwell_step;
+        ++n_dwell_steps;
+      }
+      physics.set_dwell_mode(dwell);
+    }
+  }
+
+  return solution;
+}
+
+BOOST_AUTO_TEST_CASE(dwell_period)
+{
+  unsigned int n_dwell_steps = 0;
+  auto const reference = cool_down(0., n_dwell_steps);
+  BOOST_TEST(n_dwell_steps == 0u);
+  auto solution = cool_down(1., n_dwell_steps);
+
+  // After the beam turns off, the time step is twenty times larger than the
+  // one of the beam, which is far past the stability limit of forward Euler.
+  // The IMEX method used during the dwell stays close to the reference.
+  BOOST_TEST(n_dwell_steps == 9u);
+  auto perturbation = reference;
+  perturbation.add(-10.);
+  BOOST_TEST(perturbation.linfty_norm() > 0.1);
+  solution -= reference;
+  BOOST_TEST(solution.linfty_norm() < 0.05);
+}
+
+BOOST_AUTO_TEST_CASE(gather_scatter_ensemble)
+{
+  // Each processor is a group. The groups own the same dofs on their own copy
+  // of the mesh and the members are distributed between them like in
+  // run_ensemble().
+  MPI_Comm communicator = MPI_COMM_WORLD;
+  unsigned int const n_groups =
+      dealii::Utilities::MPI::n_mpi_processes(communicator);
+  unsigned int const group =
+      dealii::Utilities::MPI::this_mpi_process(communicator);
+  unsigned int const ensemble_size = 3;
+  unsigned int const first_member = group * ensemble_size / n_groups;
+  unsigned int const local_ensemble_size =
+      (group + 1) * ensemble_size / n_groups - first_member;
+
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 1);
+  geometry_database.put("length_divisions", 4);
+  geometry_database.put("height", 1);
+  geometry_database.put("height_divisions", 4);
+  adamantine::Geometry<2> geometry(MPI_COMM_SELF, geometry_database);
+  dealii::FE_Q<2> fe(1);
+  dealii::DoFHandler<2> dof_handler(geometry.get_triangulation());
+  dof_handler.distribute_dofs(fe);
+
+  // The value of entry i of a member depends on the global member index.
+  auto value = [](unsigned int member, unsigned int i)
+  { return 300. + 10. * member + 0.1 * i; };
+  unsigned int const augmented_state_size = 2;
+  std::vector<dealii::LA::distributed::BlockVector<double>> local_ensemble(
+      local_ensemble_size);
+  for (unsigned int member = 0; member < local_ensemble_size; ++member)
+  {
+    local_ensemble[member].reinit(2);
+    local_ensemble[member].block(0).reinit(dof_handler.locally_owned_dofs(),
+                                           MPI_COMM_SELF);
+    local_ensemble[member].block(1).reinit(augmented_state_size);
+    local_ensemble[member].collect_sizes();
+    for (unsigned int i = 0; i < local_ensemble[member].size(); ++i)
+      local_ensemble[member][i] = value(first_member + member, i);
+  }
+
+  auto ensemble = gather_ensemble(communicator, local_ensemble);
+  BOOST_TEST(ensemble.size() == ensemble_size);
+  for (unsigned int member = 0; member < ensemble_size; ++member)
+  {
+    BOOST_TEST(ensemble[member].block(1).size() == augmented_state_size);
+    for (unsigned int i = 0; i < ensemble[member].size(); ++i)
+      BOOST_TEST(ensemble[member][i] == value(member, i));
+  }
+
+  // Every group updates the whole ensemble and keeps its own members.
+  for (auto &member : ensemble)
+    member.add(1.);
+  scatter_ensemble(ensemble, first_member, local_ensemble);
+  for (unsigned int member = 0; member < local_ensemble_size; ++member)
+    for (unsigned int i = 0; i < local_ensemble[member].size(); ++i)
+      BOOST_TEST(local_ensemble[member][i] ==
+                 value(first_member + member, i) + 1.);
+}
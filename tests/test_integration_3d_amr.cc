@@ -9,6 +9,12 @@
 
 #include "../application/adamantine.hh"
 
+#include <GoldakHeatSource.hh>
+
+#include <deal.II/fe/fe_nothing.h>
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/grid/grid_generator.h>
+
 #include <filesystem>
 #include <fstream>
 
@@ -55,3 +61,146 @@ BOOST_AUTO_TEST_CASE(integration_3D_amr, *utf::tolerance(0.1))
   BOOST_TEST(expected_max == global_max);
   BOOST_TEST(expected_min == global_min);
 }
+
+// Run amr_test.info with the given beam refinement and return the global
+// minimum and maximum of the temperature, and the number of dofs.
+std::tuple<double, double, dealii::types::global_dof_index>
+run_amr_test(bool const single_pass, unsigned int const n_beam_refinements)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  std::vector<adamantine::Timer> timers;
+  initialize_timers(communicator, timers);
+
+  // Read the input.
+  std::string const filename = "amr_test.info";
+  adamantine::ASSERT_THROW(std::filesystem::exists(filename) == true,
+                           "The file " + filename + " does not exist.");
+  boost::property_tree::ptree database;
+  boost::property_tree::info_parser::read_info(filename, database);
+  database.put("refinement.single_pass_beam_refinement", single_pass);
+  database.put("refinement.n_beam_refinements", n_beam_refinements);
+  database.put("refinement.max_level", n_beam_refinements);
+
+  auto [temperature, displacement] =
+      run<3, dealii::MemorySpace::Host>(communicator, database, timers);
+
+  double min_val = std::numeric_limits<double>::max();
+  double max_val = std::numeric_limits<double>::min();
+  for (unsigned int i = 0; i < temperature.locally_owned_size(); ++i)
+  {
+    if (temperature.local_element(i) < min_val)
+      min_val = temperature.local_element(i);
+
+    if (temperature.local_element(i) > max_val)
+      max_val = temperature.local_element(i);
+  }
+
+  double global_max =
+      dealii::Utilities::MPI::max(max_val, temperature.get_mpi_communicator());
+  double global_min =
+      dealii::Utilities::MPI::min(min_val, temperature.get_mpi_communicator());
+
+  return {global_min, global_max, temperature.size()};
+}
+
+BOOST_AUTO_TEST_CASE(integration_3D_amr_single_pass, *utf::tolerance(0.1))
+{
+  // With a single beam refinement, the mesh is the same as the one obtained
+  // using the default refinement.
+  auto const [global_min, global_max, n_dofs] = run_amr_test(true, 1);
+
+  double expected_max = 329.5;
+  double expected_min = 296.1;
+
+  BOOST_TEST(expected_max == global_max);
+  BOOST_TEST(expected_min == global_min);
+
+  // With two beam refinements, the cells on the paths of the beams are refined
+  // twice in a single pass. All the children of these cells are refined, so
+  // the mesh is at least as fine as the one of the default refinement.
+  auto const [two_level_min, two_level_max, two_level_n_dofs] =
+      run_amr_test(true, 2);
+  auto const [expected_two_level_min, expected_two_level_max,
+              expected_two_level_n_dofs] = run_amr_test(false, 2);
+
+  BOOST_TEST(two_level_n_dofs > n_dofs);
+  BOOST_TEST(two_level_n_dofs >= expected_two_level_n_dofs);
+  BOOST_TEST(two_level_max == expected_two_level_max);
+  BOOST_TEST(two_level_min == expected_two_level_min);
+}
+
+BOOST_AUTO_TEST_CASE(beam_position_trigger)
+{
+  boost::property_tree::ptree database;
+  database.put("depth", 0.1);
+  database.put("absorption_efficiency", 0.1);
+  database.put("diameter", 1.0);
+  database.put("max_power", 10.);
+  database.put("scan_path_file", "scan_path.txt");
+  database.put("scan_path_file_format", "segment");
+  std::vector<std::shared_ptr<adamantine::HeatSource<3>>> heat_sources = {
+      std::make_shared<adamantine::GoldakHeatSource<3>>(database)};
+
+  // The beam is turned off during the first microsecond.
+  BOOST_TEST(!beams_near_corridor_end(heat_sources, 0., 5e-7, 0., 0.));
+  // The corridor is empty.
+  BOOST_TEST(beams_near_corridor_end(heat_sources, 0., 1e-4, 0., 0.));
+  // The beam moves at 0.8 m/s so 0.72 mm of the corridor are left in front of
+  // the beam.
+  BOOST_TEST(!beams_near_corridor_end(heat_sources, 0., 1e-4, 1e-3, 0.));
+  BOOST_TEST(!beams_near_corridor_end(heat_sources, 0., 1e-4, 1e-3, 5e-4));
+  BOOST_TEST(beams_near_corridor_end(heat_sources, 0., 1e-4, 1e-3, 1e-3));
+}
+
+BOOST_AUTO_TEST_CASE(dormant_cells)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+  dealii::parallel::distributed::Triangulation<3> triangulation(communicator);
+  dealii::GridGenerator::hyper_cube(triangulation);
+  triangulation.refine_global(2);
+  dealii::hp::FECollection<3> fe_collection;
+  fe_collection.push_back(dealii::FE_Q<3>(1));
+  fe_collection.push_back(dealii::FE_Nothing<3>());
+  dealii::DoFHandler<3> dof_handler(triangulation);
+  dof_handler.distribute_dofs(fe_collection);
+  dealii::IndexSet locally_relevant_dofs;
+  dealii::DoFTools::extract_locally_relevant_dofs(dof_handler,
+                                                  locally_relevant_dofs);
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> solution(
+      dof_handler.locally_owned_dofs(), locally_relevant_dofs, communicator);
+  solution = 300.;
+
+  boost::property_tree::ptree database;
+  database.put("depth", 0.1);
+  database.put("absorption_efficiency", 0.1);
+  database.put("diameter", 1.0);
+  database.put("max_power", 10.);
+  database.put("scan_path_file", "scan_path.txt");
+  database.put("scan_path_file_format", "segment");
+  std::vector<std::shared_ptr<adamantine::HeatSource<3>>> heat_sources = {
+      std::make_shared<adamantine::GoldakHeatSource<3>>(database)};
+
+  // The beam stays at the origin during the first microsecond. Only the cells
+  // further than 0.5 from the origin are dormant.
+  unsigned int n_dormant_cells_ref = 0;
+  for (auto const &cell : dealii::filter_iterators(
+           triangulation.active_cell_iterators(),
+           dealii::IteratorFilters::LocallyOwnedCell()))
+    if (cell->center().norm() > 0.5)
+      ++n_dormant_cells_ref;
+  unsigned int n_dormant_cells = flag_dormant_cells(
+      dof_handler, solution, heat_sources, 0., 1e-6, 10, 500., 1., 0.5);
+  BOOST_TEST(n_dormant_cells == n_dormant_cells_ref);
+  for (auto const &cell : dealii::filter_iterators(
+           triangulation.active_cell_iterators(),
+           dealii::IteratorFilters::LocallyOwnedCell()))
+    BOOST_TEST(cell->coarsen_flag_set() == (cell->center().norm() > 0.5));
+
+  // The material is too hot to be dormant.
+  for (auto const &cell : triangulation.active_cell_iterators())
+    cell->clear_coarsen_flag();
+  n_dormant_cells = flag_dormant_cells(dof_handler, solution, heat_sources, 0.,
+                                       1e-6, 10, 200., 1., 0.5);
+  BOOST_TEST(n_dormant_cells == 0);
+}
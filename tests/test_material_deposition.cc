@@ -163,6 +163,39 @@ BOOST_AUTO_TEST_CASE(get_elements_to_activate_2d)
         BOOST_TEST(elements_to_activate[i][j]->id() == cell_id_ref[i][j]);
       }
     }
+
+    // Only search the elements for the second box
+    elements_to_activate =
+        adamantine::get_elements_to_activate(dof_handler, bounding_boxes, 1, 2);
+    BOOST_TEST(elements_to_activate.size() == bounding_boxes.size());
+    BOOST_TEST(elements_to_activate[0].empty());
+    BOOST_TEST(elements_to_activate[2].empty());
+    BOOST_TEST(elements_to_activate[1].size() == cell_id_ref[1].size());
+    for (unsigned int j = 0; j < cell_id_ref[1].size(); ++j)
+    {
+      BOOST_TEST(elements_to_activate[1][j]->id() == cell_id_ref[1][j]);
+    }
+
+    // A box outside of the domain is not kept by the local filtering
+    bounding_boxes.emplace_back(std::make_pair(dealii::Point<2>(20., 20.),
+                                               dealii::Point<2>(21., 21.)));
+    std::vector<unsigned int> local_boxes =
+        adamantine::get_local_deposition_boxes(dof_handler, bounding_boxes);
+    BOOST_TEST(local_boxes == std::vector<unsigned int>({0, 1, 2}),
+               boost::test_tools::per_element());
+
+    // Only search the elements for the first and the third boxes
+    elements_to_activate = adamantine::get_elements_to_activate(
+        dof_handler, bounding_boxes, std::vector<unsigned int>({0, 2}), 0, 4);
+    BOOST_TEST(elements_to_activate.size() == bounding_boxes.size());
+    BOOST_TEST(elements_to_activate[1].empty());
+    BOOST_TEST(elements_to_activate[3].empty());
+    for (unsigned int i : {0, 2})
+    {
+      BOOST_TEST(elements_to_activate[i].size() == cell_id_ref[i].size());
+      for (unsigned int j = 0; j < cell_id_ref[i].size(); ++j)
+        BOOST_TEST(elements_to_activate[i][j]->id() == cell_id_ref[i][j]);
+    }
   }
 }
 
@@ -232,7 +265,12 @@ BOOST_AUTO_TEST_CASE(get_elements_to_activate_3d)
   }
 }
 
-BOOST_AUTO_TEST_CASE(material_deposition)
+// Deposit the material of material_path_test_material_deposition.txt and
+// check the number of activated cells after each time step. The l2 norm of the
+// solution after each time step is returned.
+std::vector<double>
+deposit_material(bool const incremental_activation,
+                 double const new_material_temperature)
 {
   int constexpr dim = 3;
   MPI_Comm communicator = MPI_COMM_WORLD;
@@ -252,6 +290,7 @@ BOOST_AUTO_TEST_CASE(material_deposition)
   database.put("geometry.material_deposition", true);
   database.put("geometry.material_deposition_file",
                "material_path_test_material_deposition.txt");
+  database.put("geometry.incremental_activation", incremental_activation);
   // Build Geometry
   boost::property_tree::ptree geometry_database =
       database.get_child("geometry");
@@ -260,7 +299,7 @@ BOOST_AUTO_TEST_CASE(material_deposition)
   // MaterialProperty database
   database.put("materials.property_format", "polynomial");
   database.put("materials.initial_temperature", initial_temperature);
-  database.put("materials.new_material_temperature", initial_temperature);
+  database.put("materials.new_material_temperature", new_material_temperature);
   database.put("materials.n_materials", 1);
   database.put("materials.material_0.solid.density", 1.);
   database.put("materials.material_0.liquid.density", 1.);
@@ -306,6 +345,7 @@ BOOST_AUTO_TEST_CASE(material_deposition)
   double time =
       thermal_physics.evolve_one_time_step(0., time_step, solution, timers);
   double const eps = time_step / 1e12;
+  std::vector<double> solution_norms;
   // The build is too slow in debug mode when using sanitizer. In that case
   // reduce the size of the loop
 #ifdef ADAMANTINE_DEBUG
@@ -332,11 +372,13 @@ BOOST_AUTO_TEST_CASE(material_deposition)
 
       thermal_physics.add_material(
           elements_to_activate, deposition_cos, deposition_sin, has_melted,
-          activation_start, activation_end, initial_temperature, solution);
+          activation_start, activation_end, new_material_temperature,
+          solution);
     }
 
     time =
         thermal_physics.evolve_one_time_step(time, time_step, solution, timers);
+    solution_norms.push_back(solution.l2_norm());
 
     unsigned int n_cells = 0;
     for (auto const &cell : dealii::filter_iterators(
@@ -350,6 +392,23 @@ BOOST_AUTO_TEST_CASE(material_deposition)
     BOOST_TEST(dealii::Utilities::MPI::sum(n_cells, communicator) ==
                n_cells_ref[i]);
   }
+
+  return solution_norms;
+}
+
+BOOST_AUTO_TEST_CASE(material_deposition) { deposit_material(false, 300.); }
+
+BOOST_AUTO_TEST_CASE(material_deposition_incremental, *utf::tolerance(1e-12))
+{
+  // The new material is hotter than the initial material, so the solution
+  // depends on the activation. Activating the cells without modifying the
+  // Triangulation gives the same solution as the default activation, up to the
+  // numbering of the dofs.
+  auto const reference = deposit_material(false, 500.);
+  auto const solution_norms = deposit_material(true, 500.);
+  BOOST_TEST(solution_norms.size() == reference.size());
+  for (unsigned int i = 0; i < reference.size(); ++i)
+    BOOST_TEST(solution_norms[i] == reference[i]);
 }
 
 BOOST_AUTO_TEST_CASE(deposition_from_scan_path_2d, *utf::tolerance(1e-13))
@@ -537,6 +596,63 @@ BOOST_AUTO_TEST_CASE(deposition_from_L_scan_path_3d, *utf::tolerance(1e-13))
   BOOST_TEST(deposition_sin.at(8) == 1.);
 }
 
+BOOST_AUTO_TEST_CASE(deposition_from_L_scan_path_window_3d,
+                     *utf::tolerance(1e-13))
+{
+  adamantine::ScanPath scan_path("scan_path_L.txt", "segment");
+
+  boost::property_tree::ptree database;
+  database.put("deposition_length", 0.0005);
+  database.put("deposition_height", 0.1);
+  database.put("deposition_width", 0.1);
+  database.put("deposition_lead_time", 0.0);
+
+  auto [bounding_boxes, deposition_times, deposition_cos, deposition_sin] =
+      adamantine::deposition_along_scan_path<3>(database, scan_path);
+
+  // Creating the boxes over successive time windows gives the same boxes as
+  // creating all the boxes at once.
+  double const time_window = 1e-3;
+  double const end_time = deposition_times.back() + time_window;
+  std::vector<dealii::BoundingBox<3>> window_bounding_boxes;
+  std::vector<double> window_deposition_times;
+  std::vector<double> window_deposition_cos;
+  std::vector<double> window_deposition_sin;
+  for (double start_time = 0.; start_time < end_time; start_time += time_window)
+  {
+    auto [boxes, times, cos, sin] = adamantine::deposition_along_scan_path<3>(
+        database, scan_path, start_time, start_time + time_window);
+    for (auto const time : times)
+    {
+      BOOST_TEST(time >= start_time);
+      BOOST_TEST(time < start_time + time_window);
+    }
+    window_bounding_boxes.insert(window_bounding_boxes.end(), boxes.begin(),
+                                 boxes.end());
+    window_deposition_times.insert(window_deposition_times.end(),
+                                   times.begin(), times.end());
+    window_deposition_cos.insert(window_deposition_cos.end(), cos.begin(),
+                                 cos.end());
+    window_deposition_sin.insert(window_deposition_sin.end(), sin.begin(),
+                                 sin.end());
+  }
+
+  BOOST_TEST(window_deposition_times.size() == deposition_times.size());
+  for (unsigned int i = 0; i < deposition_times.size(); ++i)
+  {
+    for (unsigned int d = 0; d < 3; ++d)
+    {
+      BOOST_TEST(window_bounding_boxes[i].get_boundary_points().first[d] ==
+                 bounding_boxes[i].get_boundary_points().first[d]);
+      BOOST_TEST(window_bounding_boxes[i].get_boundary_points().second[d] ==
+                 bounding_boxes[i].get_boundary_points().second[d]);
+    }
+    BOOST_TEST(window_deposition_times[i] == deposition_times[i]);
+    BOOST_TEST(window_deposition_cos[i] == deposition_cos[i]);
+    BOOST_TEST(window_deposition_sin[i] == deposition_sin[i]);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(deposition_from_diagonal_scan_path_3d,
                      *utf::tolerance(1e-10))
 {
@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2021, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -29,3 +29,8 @@ BOOST_AUTO_TEST_CASE(material_property_polynomials_host)
 {
   material_property_polynomials<dealii::MemorySpace::Host>();
 }
+
+BOOST_AUTO_TEST_CASE(material_property_polynomials_vectorized_host)
+{
+  material_property_polynomials_vectorized<dealii::MemorySpace::Host>();
+}
@@ -1,4 +1,4 @@
-/* Copyright (c) 2021, the adamantine authors.
+/* Copyright (c) 2021 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -476,3 +476,83 @@ void material_property_polynomials()
     ++n;
   }
 }
+
+template <typename MemorySpaceType>
+void material_property_polynomials_vectorized()
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  // Create the Geometry
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 12);
+  geometry_database.put("length_divisions", 4);
+  geometry_database.put("height", 6);
+  geometry_database.put("height_divisions", 5);
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  auto const &triangulation = geometry.get_triangulation();
+
+  // Create the MaterialProperty
+  boost::property_tree::ptree database;
+  database.put("property_format", "polynomial");
+  database.put("n_materials", 2);
+  database.put("material_0.solid.density", "0., 1.");
+  database.put("material_0.solid.thermal_conductivity_x", "0., 1., 2.");
+  database.put("material_0.solid.thermal_conductivity_z", "0., 1., 2.");
+  database.put("material_1.solid.density", " 1., 2., 3.");
+  database.put("material_1.solid.thermal_conductivity_x",
+               "1.,  100., 20., 200.");
+  database.put("material_1.solid.thermal_conductivity_z",
+               "1.,  100., 20., 200.");
+  database.put("material_1.powder.density", "15., 2., 3.");
+  database.put("material_1.powder.thermal_conductivity_x", " 10., 18., 200.");
+  database.put("material_1.powder.thermal_conductivity_z", " 10., 18., 200.");
+  adamantine::MaterialProperty<2, MemorySpaceType> mat_prop(
+      communicator, triangulation, database);
+
+  // Alternate the materials between the lanes. The cells made of material 0
+  // are solid and the cells made of material 1 are half solid, half powder.
+  unsigned int constexpr n_lanes = dealii::VectorizedArray<double>::size();
+  unsigned int constexpr powder =
+      static_cast<unsigned int>(adamantine::MaterialState::powder);
+  unsigned int constexpr solid =
+      static_cast<unsigned int>(adamantine::MaterialState::solid);
+  unsigned int constexpr liquid =
+      static_cast<unsigned int>(adamantine::MaterialState::liquid);
+  std::array<dealii::types::material_id, n_lanes> material_id;
+  std::array<dealii::VectorizedArray<double>, adamantine::g_n_material_states>
+      state_ratios;
+  dealii::VectorizedArray<double> temperature = 15.;
+  for (unsigned int n = 0; n < n_lanes; ++n)
+  {
+    material_id[n] = n % 2;
+    state_ratios[powder][n] = (n % 2 == 0) ? 0. : 0.5;
+    state_ratios[solid][n] = (n % 2 == 0) ? 1. : 0.5;
+    state_ratios[liquid][n] = 0.;
+  }
+
+  auto const density = mat_prop.template compute_material_property<false>(
+      adamantine::StateProperty::density, material_id.data(),
+      state_ratios.data(), temperature);
+  auto const thermal_conductivity_x =
+      mat_prop.template compute_material_property<false>(
+          adamantine::StateProperty::thermal_conductivity_x, material_id.data(),
+          state_ratios.data(), temperature);
+
+  double constexpr tolerance = 1e-10;
+  for (unsigned int n = 0; n < n_lanes; ++n)
+  {
+    double const lane_state_ratios[adamantine::g_n_material_states] = {
+        state_ratios[0][n], state_ratios[1][n], state_ratios[2][n]};
+    BOOST_TEST(density[n] == ((n % 2 == 0) ? 15. : 713.),
+               tt::tolerance(tolerance));
+    BOOST_TEST(density[n] ==
+                   mat_prop.compute_material_property(
+                       adamantine::StateProperty::density, material_id[n],
+                       lane_state_ratios, temperature[n]),
+               tt::tolerance(tolerance));
+    BOOST_TEST(thermal_conductivity_x[n] ==
+                   ((n % 2 == 0) ? 465. : 0.5 * 681001. + 0.5 * 45280.),
+               tt::tolerance(tolerance));
+  }
+}
@@ -24,6 +24,8 @@
 
 #include <boost/property_tree/ptree.hpp>
 
+#include <cmath>
+
 #include "main.cc"
 
 namespace utf = boost::unit_test;
@@ -229,6 +231,142 @@ BOOST_AUTO_TEST_CASE(elastostatic, *utf::tolerance(1e-12))
   }
 }
 
+BOOST_AUTO_TEST_CASE(elastostatic_matrix_free, *utf::tolerance(1e-12))
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+  int constexpr dim = 3;
+
+  // Create the Geometry
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 6);
+  geometry_database.put("length_divisions", 3);
+  geometry_database.put("height", 6);
+  geometry_database.put("height_divisions", 3);
+  geometry_database.put("width", 6);
+  geometry_database.put("width_divisions", 3);
+  adamantine::Geometry<dim> geometry(communicator, geometry_database);
+  auto const &triangulation = geometry.get_triangulation();
+  unsigned int n = 0;
+  for (auto cell : triangulation.cell_iterators())
+  {
+    cell->set_material_id(n % 2);
+    cell->set_user_index(static_cast<int>(adamantine::MaterialState::solid));
+    ++n;
+  }
+  // Create the MaterialProperty
+  boost::property_tree::ptree material_database;
+  material_database.put("property_format", "polynomial");
+  material_database.put("n_materials", 2);
+  material_database.put("material_0.solid.lame_first_parameter", 2.);
+  material_database.put("material_0.solid.lame_second_parameter", 3.);
+  material_database.put("material_1.solid.lame_first_parameter", 5.);
+  material_database.put("material_1.solid.lame_second_parameter", 1.);
+  adamantine::MaterialProperty<dim, dealii::MemorySpace::Host>
+      material_properties(communicator, triangulation, material_database);
+  // Create the DoFHandler. Some of the cells use FE_Nothing.
+  dealii::hp::FECollection<dim> fe_collection;
+  fe_collection.push_back(dealii::FESystem<dim>(dealii::FE_Q<dim>(2) ^ dim));
+  fe_collection.push_back(
+      dealii::FESystem<dim>(dealii::FE_Nothing<dim>() ^ dim));
+  dealii::DoFHandler<dim> dof_handler(geometry.get_triangulation());
+  for (auto const &cell : dof_handler.active_cell_iterators())
+  {
+    if (cell->center()[axis<dim>::z] > 4.)
+      cell->set_active_fe_index(1);
+  }
+  dof_handler.distribute_dofs(fe_collection);
+  dealii::AffineConstraints<double> affine_constraints;
+  dealii::DoFTools::make_hanging_node_constraints(dof_handler,
+                                                  affine_constraints);
+  dealii::VectorTools::interpolate_boundary_values(
+      dof_handler, 4, dealii::Functions::ZeroFunction<dim>(dim),
+      affine_constraints);
+  affine_constraints.close();
+  dealii::hp::QCollection<dim> q_collection;
+  q_collection.push_back(dealii::QGauss<dim>(3));
+  q_collection.push_back(dealii::QGauss<dim>(1));
+
+  std::vector<double> empty_vector;
+  adamantine::MechanicalOperator<dim, dealii::MemorySpace::Host>
+      matrix_based_operator(communicator, material_properties, empty_vector,
+                            true);
+  matrix_based_operator.reinit(dof_handler, affine_constraints, q_collection);
+  adamantine::MechanicalOperator<dim, dealii::MemorySpace::Host>
+      matrix_free_operator(communicator, material_properties, empty_vector,
+                           true, true);
+  matrix_free_operator.reinit(dof_handler, affine_constraints, q_collection);
+  BOOST_TEST(matrix_free_operator.is_matrix_free());
+  BOOST_TEST(matrix_free_operator.m() == matrix_based_operator.m());
+
+  // The right-hand sides do not depend on the matrix
+  auto const &rhs_1 = matrix_based_operator.rhs();
+  auto const &rhs_2 = matrix_free_operator.rhs();
+  for (unsigned int i = 0; i < rhs_1.locally_owned_size(); ++i)
+    BOOST_TEST(rhs_1.local_element(i) == rhs_2.local_element(i));
+
+  // Compare the operators on the rows that are not constrained
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> src(
+      rhs_2.get_partitioner());
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> dst_1(
+      rhs_1.get_partitioner());
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> dst_2(
+      rhs_2.get_partitioner());
+  unsigned int const n_dofs = matrix_based_operator.m();
+  for (unsigned int i = 0; i < n_dofs; ++i)
+    src[i] = std::sin(static_cast<double>(i));
+  affine_constraints.set_zero(src);
+  matrix_based_operator.vmult(dst_1, src);
+  matrix_free_operator.vmult(dst_2, src);
+  for (unsigned int j = 0; j < n_dofs; ++j)
+  {
+    if (!affine_constraints.is_constrained(j))
+      BOOST_TEST(dst_1[j] == dst_2[j]);
+  }
+
+  // The inverse diagonal matches the diagonal of the matrix
+  auto const &system_matrix = matrix_based_operator.system_matrix();
+  auto const &inverse_diagonal =
+      matrix_free_operator.inverse_diagonal().get_vector();
+  for (unsigned int j = 0; j < n_dofs; ++j)
+  {
+    if (!affine_constraints.is_constrained(j))
+      BOOST_TEST(inverse_diagonal[j] * system_matrix.diag_element(j) == 1.);
+  }
+
+  // Nothing changed so only the right-hand-sides are reassembled
+  BOOST_TEST(matrix_based_operator.matrix_changed());
+  BOOST_TEST(matrix_free_operator.matrix_changed());
+  matrix_based_operator.reinit(dof_handler, affine_constraints, q_collection);
+  matrix_free_operator.reinit(dof_handler, affine_constraints, q_collection);
+  BOOST_TEST(!matrix_based_operator.matrix_changed());
+  BOOST_TEST(!matrix_free_operator.matrix_changed());
+  matrix_based_operator.vmult(dst_1, src);
+  matrix_free_operator.vmult(dst_2, src);
+  for (unsigned int j = 0; j < n_dofs; ++j)
+  {
+    if (!affine_constraints.is_constrained(j))
+      BOOST_TEST(dst_1[j] == dst_2[j]);
+  }
+
+  // The operators are rebuilt after the mesh changes even if the moduli and
+  // the number of dofs are the same.
+  geometry.get_triangulation().execute_coarsening_and_refinement();
+  dof_handler.distribute_dofs(fe_collection);
+  BOOST_TEST(dof_handler.n_dofs() == n_dofs);
+  affine_constraints.clear();
+  dealii::DoFTools::make_hanging_node_constraints(dof_handler,
+                                                  affine_constraints);
+  dealii::VectorTools::interpolate_boundary_values(
+      dof_handler, 4, dealii::Functions::ZeroFunction<dim>(dim),
+      affine_constraints);
+  affine_constraints.close();
+  matrix_based_operator.reinit(dof_handler, affine_constraints, q_collection);
+  matrix_free_operator.reinit(dof_handler, affine_constraints, q_collection);
+  BOOST_TEST(matrix_based_operator.matrix_changed());
+  BOOST_TEST(matrix_free_operator.matrix_changed());
+}
+
 BOOST_AUTO_TEST_CASE(thermoelastic, *utf::tolerance(1e-12))
 {
   MPI_Comm communicator = MPI_COMM_WORLD;
@@ -1,4 +1,4 @@
-/* Copyright (c) 2022, the adamantine authors.
+/* Copyright (c) 2022 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -250,6 +250,116 @@ BOOST_AUTO_TEST_CASE(elastostatic)
     BOOST_CHECK_SMALL(solution[i] - reference_solution[i], tolerance);
 }
 
+BOOST_AUTO_TEST_CASE(elastostatic_matrix_free)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  // Geometry database
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 12);
+  geometry_database.put("length_divisions", 6);
+  geometry_database.put("height", 6);
+  geometry_database.put("height_divisions", 3);
+  geometry_database.put("width", 6);
+  geometry_database.put("width_divisions", 3);
+  // Build Geometry
+  adamantine::Geometry<3> geometry(communicator, geometry_database);
+  auto const &triangulation = geometry.get_triangulation();
+  for (auto cell : triangulation.cell_iterators())
+  {
+    cell->set_material_id(0);
+    cell->set_user_index(static_cast<int>(adamantine::MaterialState::solid));
+  }
+  // Create the MaterialProperty
+  boost::property_tree::ptree material_database;
+  material_database.put("property_format", "polynomial");
+  material_database.put("n_materials", 1);
+  material_database.put("material_0.solid.density", 1.);
+  material_database.put("material_0.solid.lame_first_parameter", 2.);
+  material_database.put("material_0.solid.lame_second_parameter", 3.);
+  adamantine::MaterialProperty<3, dealii::MemorySpace::Host>
+      material_properties(communicator, triangulation, material_database);
+  // Build MechanicalPhysics using the matrix-free operator
+  unsigned int const fe_degree = 1;
+  std::vector<double> empty_vector;
+  adamantine::MechanicalPhysics<3, dealii::MemorySpace::Host>
+      mechanical_physics(communicator, fe_degree, geometry, material_properties,
+                         empty_vector, true, true);
+  mechanical_physics.setup_dofs();
+  auto solution = mechanical_physics.solve();
+
+  // Reference computation
+  ElastoStaticity elasto_staticity;
+  elasto_staticity.setup_system();
+  elasto_staticity.assemble_system();
+  auto reference_solution = elasto_staticity.solve();
+
+  double const tolerance = 2e-9;
+  BOOST_TEST(solution.size() == reference_solution.size());
+  for (unsigned int i = 0; i < reference_solution.size(); ++i)
+    BOOST_CHECK_SMALL(solution[i] - reference_solution[i], tolerance);
+}
+
+BOOST_AUTO_TEST_CASE(elastostatic_amg)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  // Geometry database
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 12);
+  geometry_database.put("length_divisions", 6);
+  geometry_database.put("height", 6);
+  geometry_database.put("height_divisions", 3);
+  geometry_database.put("width", 6);
+  geometry_database.put("width_divisions", 3);
+  // Build Geometry
+  adamantine::Geometry<3> geometry(communicator, geometry_database);
+  auto const &triangulation = geometry.get_triangulation();
+  for (auto cell : triangulation.cell_iterators())
+  {
+    cell->set_material_id(0);
+    cell->set_user_index(static_cast<int>(adamantine::MaterialState::solid));
+  }
+  // Create the MaterialProperty
+  boost::property_tree::ptree material_database;
+  material_database.put("property_format", "polynomial");
+  material_database.put("n_materials", 1);
+  material_database.put("material_0.solid.density", 1.);
+  material_database.put("material_0.solid.lame_first_parameter", 2.);
+  material_database.put("material_0.solid.lame_second_parameter", 3.);
+  adamantine::MaterialProperty<3, dealii::MemorySpace::Host>
+      material_properties(communicator, triangulation, material_database);
+  // Build MechanicalPhysics using the AMG preconditioner
+  unsigned int const fe_degree = 1;
+  std::vector<double> empty_vector;
+  adamantine::MechanicalPhysics<3, dealii::MemorySpace::Host>
+      mechanical_physics(communicator, fe_degree, geometry, material_properties,
+                         empty_vector, true, false, true);
+  mechanical_physics.setup_dofs();
+  auto solution = mechanical_physics.solve();
+  // The second solve reuses the AMG hierarchy
+  mechanical_physics.setup_dofs();
+  solution = mechanical_physics.solve();
+  // After a change of the mesh, the matrix is reinitialized and the AMG
+  // hierarchy is rebuilt
+  geometry.get_triangulation().execute_coarsening_and_refinement();
+  mechanical_physics.setup_dofs();
+  solution = mechanical_physics.solve();
+
+  // Reference computation
+  ElastoStaticity elasto_staticity;
+  elasto_staticity.setup_system();
+  elasto_staticity.assemble_system();
+  auto reference_solution = elasto_staticity.solve();
+
+  double const tolerance = 2e-9;
+  BOOST_TEST(solution.size() == reference_solution.size());
+  for (unsigned int i = 0; i < reference_solution.size(); ++i)
+    BOOST_CHECK_SMALL(solution[i] - reference_solution[i], tolerance);
+}
+
 BOOST_AUTO_TEST_CASE(fe_nothing)
 {
   MPI_Comm communicator = MPI_COMM_WORLD;
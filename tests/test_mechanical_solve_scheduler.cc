@@ -0,0 +1,80 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#define BOOST_TEST_MODULE MechanicalSolveScheduler
+
+#include <MechanicalSolveScheduler.hh>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include "main.cc"
+
+BOOST_AUTO_TEST_CASE(time_steps)
+{
+  boost::property_tree::ptree database;
+  database.put("time_steps_between_mechanical_solves", 3);
+  adamantine::MechanicalSolveScheduler scheduler(database, 1);
+  BOOST_TEST(!scheduler.layer_trigger());
+  BOOST_TEST(!scheduler.temperature_trigger());
+  // Nothing has been solved yet
+  BOOST_TEST(scheduler.solve_now(1, 0., false));
+  scheduler.mechanical_solved(0.);
+  BOOST_TEST(!scheduler.solve_now(1, 0., false));
+  BOOST_TEST(!scheduler.solve_now(2, 0., false));
+  BOOST_TEST(scheduler.solve_now(3, 0., false));
+  BOOST_TEST(!scheduler.solve_now(4, 0., false));
+  // The last time step is always solved
+  BOOST_TEST(scheduler.solve_now(4, 0., true));
+
+  // By default, use the number of time steps given to the constructor
+  boost::property_tree::ptree default_database;
+  adamantine::MechanicalSolveScheduler default_scheduler(default_database, 2);
+  default_scheduler.mechanical_solved(0.);
+  BOOST_TEST(!default_scheduler.solve_now(1, 0., false));
+  BOOST_TEST(default_scheduler.solve_now(2, 0., false));
+}
+
+BOOST_AUTO_TEST_CASE(new_layer)
+{
+  boost::property_tree::ptree database;
+  database.put("time_steps_between_mechanical_solves", 0);
+  database.put("mechanical_solve_at_new_layer", true);
+  adamantine::MechanicalSolveScheduler scheduler(database, 1);
+  BOOST_TEST(scheduler.layer_trigger());
+  scheduler.mechanical_solved(0.);
+
+  // The first layer is deposited on the substrate
+  scheduler.add_deposited_material(1.);
+  BOOST_TEST(!scheduler.solve_now(1, 0., false));
+  scheduler.add_deposited_material(1.);
+  BOOST_TEST(!scheduler.solve_now(2, 0., false));
+  // The second layer starts so the first layer is complete
+  scheduler.add_deposited_material(2.);
+  BOOST_TEST(scheduler.solve_now(3, 0., false));
+  scheduler.mechanical_solved(0.);
+  BOOST_TEST(!scheduler.solve_now(4, 0., false));
+  // Material deposited below the top does not start a new layer
+  scheduler.add_deposited_material(1.5);
+  BOOST_TEST(!scheduler.solve_now(5, 0., false));
+}
+
+BOOST_AUTO_TEST_CASE(temperature_change)
+{
+  boost::property_tree::ptree database;
+  database.put("time_steps_between_mechanical_solves", 0);
+  database.put("mechanical_solve_temperature_change", 100.);
+  adamantine::MechanicalSolveScheduler scheduler(database, 1);
+  BOOST_TEST(scheduler.temperature_trigger());
+  scheduler.mechanical_solved(300.);
+
+  BOOST_TEST(!scheduler.solve_now(1, 350., false));
+  BOOST_TEST(scheduler.solve_now(2, 450., false));
+  scheduler.mechanical_solved(450.);
+  BOOST_TEST(!scheduler.solve_now(3, 400., false));
+  // Cooling also triggers a solve
+  BOOST_TEST(scheduler.solve_now(4, 320., false));
+}
@@ -0,0 +1,98 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#define BOOST_TEST_MODULE MeltPoolMonitor
+
+#include <Geometry.hh>
+#include <MeltPoolMonitor.hh>
+
+#include <deal.II/base/function.h>
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/numerics/vector_tools.h>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <filesystem>
+
+#include "main.cc"
+
+namespace utf = boost::unit_test;
+
+class MeltPool : public dealii::Function<2>
+{
+public:
+  MeltPool(double melt_temperature)
+      : dealii::Function<2>(), _melt_temperature(melt_temperature)
+  {
+  }
+
+  double value(dealii::Point<2> const &p,
+               unsigned int const /*component*/) const override
+  {
+    return ((p[0] < 0.5 + 1e-12) && (p[1] > 0.75 - 1e-12)) ? _melt_temperature
+                                                            : 300.;
+  }
+
+private:
+  double _melt_temperature;
+};
+
+BOOST_AUTO_TEST_CASE(melt_pool_metrics, *utf::tolerance(1e-12))
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 1);
+  geometry_database.put("length_divisions", 4);
+  geometry_database.put("height", 1);
+  geometry_database.put("height_divisions", 4);
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  dealii::FE_Q<2> fe(1);
+  dealii::DoFHandler<2> dof_handler(geometry.get_triangulation());
+  dof_handler.distribute_dofs(fe);
+
+  boost::property_tree::ptree material_database;
+  material_database.put("n_materials", 1);
+  material_database.put("material_0.solidus", 900.);
+  material_database.put("material_0.liquidus", 1000.);
+  std::string const filename = "melt_pool_metrics.csv";
+  adamantine::MeltPoolMonitor<2> melt_pool_monitor(
+      communicator, material_database, filename);
+
+  dealii::LA::distributed::Vector<double> temperature(
+      dof_handler.locally_owned_dofs(), communicator);
+  bool const first_rank =
+      dealii::Utilities::MPI::this_mpi_process(communicator) == 0;
+
+  // The top left corner of the domain has melted. The support points in the
+  // melt pool are at x = 0, 0.25, 0.5 and z = 0.75, 1.
+  dealii::VectorTools::interpolate(dof_handler, MeltPool(2000.), temperature);
+  melt_pool_monitor.write_metrics(0., dof_handler, temperature);
+  if (first_rank)
+  {
+    auto const &metrics = melt_pool_monitor.get_metrics();
+    BOOST_TEST(metrics.peak_temperature == 2000.);
+    BOOST_TEST(metrics.length == 0.5);
+    BOOST_TEST(metrics.depth == 0.25);
+    // There is no previous temperature
+    BOOST_TEST(metrics.cooling_rate == 0.);
+  }
+
+  // Everything has solidified
+  dealii::VectorTools::interpolate(dof_handler, MeltPool(300.), temperature);
+  melt_pool_monitor.write_metrics(0.5, dof_handler, temperature);
+  if (first_rank)
+  {
+    auto const &metrics = melt_pool_monitor.get_metrics();
+    BOOST_TEST(metrics.peak_temperature == 300.);
+    BOOST_TEST(metrics.length == 0.);
+    BOOST_TEST(metrics.depth == 0.);
+    BOOST_TEST(metrics.cooling_rate == (2000. - 300.) / 0.5);
+    BOOST_TEST(std::filesystem::exists(filename));
+  }
+}
@@ -0,0 +1,58 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#define BOOST_TEST_MODULE MemoryBlock
+
+#include <MemoryBlock.hh>
+#include <MemoryBlockView.hh>
+
+#include <vector>
+
+#include "main.cc"
+
+BOOST_AUTO_TEST_CASE(memory_block_reuse)
+{
+  adamantine::MemoryBlock<double, dealii::MemorySpace::Host> memory_block(
+      10, 2);
+  BOOST_TEST(memory_block.size() == 20);
+  BOOST_TEST(memory_block.capacity() == 20);
+  double *const data = memory_block.data();
+
+  // Shrinking the block reuses the memory
+  memory_block.reinit(5);
+  BOOST_TEST(memory_block.size() == 5);
+  BOOST_TEST(memory_block.extent(0) == 5);
+  BOOST_TEST(memory_block.extent(1) == 0);
+  BOOST_TEST(memory_block.capacity() == 20);
+  BOOST_TEST(memory_block.data() == data);
+
+  // Growing the block up to the capacity reuses the memory
+  std::vector<double> values(20);
+  for (unsigned int i = 0; i < values.size(); ++i)
+    values[i] = i;
+  memory_block.reinit(values);
+  BOOST_TEST(memory_block.size() == 20);
+  BOOST_TEST(memory_block.data() == data);
+  adamantine::MemoryBlockView<double, dealii::MemorySpace::Host> view(
+      memory_block);
+  for (unsigned int i = 0; i < values.size(); ++i)
+    BOOST_TEST(view(i) == values[i]);
+
+  // Growing the block past the capacity reallocates the memory
+  adamantine::MemoryBlock<double, dealii::MemorySpace::Host> other(6, 4);
+  memory_block.reinit(other);
+  BOOST_TEST(memory_block.size() == 24);
+  BOOST_TEST(memory_block.extent(0) == 6);
+  BOOST_TEST(memory_block.extent(1) == 4);
+  BOOST_TEST(memory_block.capacity() == 24);
+
+  // clear() releases the memory
+  memory_block.clear();
+  BOOST_TEST(memory_block.size() == 0);
+  BOOST_TEST(memory_block.capacity() == 0);
+  BOOST_TEST(memory_block.data() == nullptr);
+}
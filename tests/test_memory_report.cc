@@ -0,0 +1,74 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#define BOOST_TEST_MODULE MemoryReport
+
+#include <MemoryBlock.hh>
+#include <MemoryReport.hh>
+
+#include <deal.II/base/mpi.h>
+
+#include <boost/algorithm/string.hpp>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "main.cc"
+
+BOOST_AUTO_TEST_CASE(memory_report)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+  unsigned int const rank =
+      dealii::Utilities::MPI::this_mpi_process(communicator);
+  unsigned int const n_processes =
+      dealii::Utilities::MPI::n_mpi_processes(communicator);
+
+  adamantine::MemoryBlock<double, dealii::MemorySpace::Host> block(10, 20);
+  BOOST_TEST(block.memory_consumption() == 200 * sizeof(double));
+
+  {
+    adamantine::MemoryReport memory_report(communicator, "test_memory.csv");
+    memory_report.add("block", block.memory_consumption());
+    memory_report.add("rank", rank);
+    // The bytes of a subsystem added twice are summed.
+    memory_report.add("rank", rank);
+    auto const &entries = memory_report.get_entries();
+    BOOST_TEST(entries.size() == 2);
+    BOOST_TEST(entries[1].first == "rank");
+    BOOST_TEST(entries[1].second == 2 * rank);
+    memory_report.write(10, 0.5);
+    BOOST_TEST(memory_report.get_entries().empty());
+  }
+
+  if (rank == 0)
+  {
+    std::ifstream file("test_memory.csv");
+    std::string line;
+    std::getline(file, line);
+    BOOST_TEST(line == "time_step,time,rank,subsystem,bytes");
+    for (unsigned int r = 0; r < n_processes; ++r)
+    {
+      std::getline(file, line);
+      BOOST_TEST(line ==
+                 "10,0.5," + std::to_string(r) + ",block," +
+                     std::to_string(200 * sizeof(double)));
+      std::getline(file, line);
+      BOOST_TEST(line == "10,0.5," + std::to_string(r) + ",rank," +
+                             std::to_string(2 * r));
+      std::getline(file, line);
+      BOOST_TEST(line == "10,0.5," + std::to_string(r) + ",total," +
+                             std::to_string(200 * sizeof(double) + 2 * r));
+      std::getline(file, line);
+      std::vector<std::string> entries;
+      boost::split(entries, line, boost::is_any_of(","));
+      BOOST_TEST(entries.size() == 5);
+      BOOST_TEST(entries[3] == "process_resident");
+      BOOST_TEST(std::stoul(entries[4]) > 0);
+    }
+  }
+}
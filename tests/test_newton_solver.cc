@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2021, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -45,3 +45,55 @@ BOOST_AUTO_TEST_CASE(newton_solver, *utf::tolerance(1e-5))
   BOOST_TEST(1. == src[0]);
   BOOST_TEST(1. == src[1]);
 }
+
+BOOST_AUTO_TEST_CASE(newton_solver_jacobian_reuse, *utf::tolerance(1e-5))
+{
+  dealii::LA::distributed::Vector<double> src(2);
+  src[0] = 2.;
+  src[1] = 2.;
+
+  // Classic Newton computes the Jacobian at every iteration
+  adamantine::NewtonSolver newton_solver(20, 1e-7);
+  newton_solver.solve(&compute_residual, &compute_inv_jacobian, src);
+  unsigned int const n_newton_evaluations =
+      newton_solver.n_jacobian_evaluations();
+
+  src[0] = 2.;
+  src[1] = 2.;
+  adamantine::NewtonSolver shamanskii_solver(50, 1e-7, 3);
+  shamanskii_solver.solve(&compute_residual, &compute_inv_jacobian, src);
+
+  BOOST_TEST(1. == src[0]);
+  BOOST_TEST(1. == src[1]);
+  BOOST_TEST(shamanskii_solver.n_jacobian_evaluations() <
+             n_newton_evaluations);
+
+  // The Jacobian of the previous solve is reused
+  unsigned int const n_evaluations = shamanskii_solver.n_jacobian_evaluations();
+  src[0] = 1.1;
+  src[1] = 1.1;
+  shamanskii_solver.solve(&compute_residual, &compute_inv_jacobian, src);
+  BOOST_TEST(1. == src[0]);
+  BOOST_TEST(1. == src[1]);
+  shamanskii_solver.reset_jacobian();
+  shamanskii_solver.solve(&compute_residual, &compute_inv_jacobian, src);
+  BOOST_TEST(shamanskii_solver.n_jacobian_evaluations() > n_evaluations);
+}
+
+BOOST_AUTO_TEST_CASE(forcing_term)
+{
+  // First iteration
+  BOOST_TEST(adamantine::compute_forcing_term(1., 0., 0., 1e-12) == 0.9);
+  // Fast convergence
+  double const forcing_term =
+      adamantine::compute_forcing_term(1e-2, 1., 0.2, 1e-12);
+  BOOST_TEST(forcing_term == 0.9 * 1e-4, boost::test_tools::tolerance(1e-12));
+  // The safeguard prevents the forcing term from decreasing too fast
+  BOOST_TEST(adamantine::compute_forcing_term(1e-2, 1., 0.9, 1e-12) ==
+                 0.9 * 0.81,
+             boost::test_tools::tolerance(1e-12));
+  // Slow convergence is bounded by the maximum
+  BOOST_TEST(adamantine::compute_forcing_term(1., 1., 0.9, 1e-12) == 0.9);
+  // The forcing term is bounded by the minimum
+  BOOST_TEST(adamantine::compute_forcing_term(1e-8, 1., 0.1, 1e-6) == 1e-6);
+}
@@ -0,0 +1,72 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#define BOOST_TEST_MODULE PerformanceLog
+
+#include <PerformanceLog.hh>
+#include <types.hh>
+
+#include <boost/algorithm/string.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "main.cc"
+
+BOOST_AUTO_TEST_CASE(performance_log)
+{
+  std::vector<adamantine::Timer> timers(adamantine::n_timers);
+  for (auto &timer : timers)
+    timer = adamantine::Timer(MPI_COMM_WORLD, "test");
+
+  {
+    adamantine::PerformanceLog performance_log(MPI_COMM_WORLD,
+                                               "test_performance.csv");
+    adamantine::TimeStepRecord record;
+    record.n_active_cells = 10;
+    record.n_dofs = 1000;
+    for (unsigned int i = 1; i < 3; ++i)
+    {
+      timers[adamantine::evol_time].start();
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      timers[adamantine::evol_time].stop();
+      record.time_step = i;
+      record.time = 0.1 * i;
+      record.delta_t = 0.1;
+      record.n_linear_iterations = 5 * i;
+      performance_log.write_time_step(record, timers);
+    }
+  }
+
+  std::ifstream file("test_performance.csv");
+  std::string line;
+  std::getline(file, line);
+  std::vector<std::string> header;
+  boost::split(header, line, boost::is_any_of(","));
+  BOOST_TEST(header.size() == 15);
+  BOOST_TEST(header[7] == "evolve_time");
+  for (unsigned int i = 1; i < 3; ++i)
+  {
+    std::getline(file, line);
+    std::vector<std::string> entries;
+    boost::split(entries, line, boost::is_any_of(","));
+    BOOST_TEST(entries.size() == header.size());
+    BOOST_TEST(std::stoul(entries[0]) == i);
+    BOOST_TEST(std::stoul(entries[5]) == 5 * i);
+    // Each time step only measures its own time
+    double const evolve_time = std::stod(entries[7]);
+    BOOST_TEST(std::abs(evolve_time - 0.1) < 0.02);
+    double const dofs_per_second = std::stod(entries[14]);
+    BOOST_TEST(std::abs(dofs_per_second * evolve_time / 1000. - 1.) < 1e-4);
+  }
+  std::remove("test_performance.csv");
+}
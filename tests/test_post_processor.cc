@@ -21,6 +21,9 @@
 #include <deal.II/numerics/vector_tools.h>
 
 #include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
 
 #include "main.cc"
 
@@ -125,7 +128,65 @@ BOOST_AUTO_TEST_CASE(thermal_post_processor)
   BOOST_CHECK(std::filesystem::exists("test.1.0.vtu"));
   BOOST_CHECK(std::filesystem::exists("test.2.0.vtu"));
 
+  // Write the same output in the background
+  post_processor_database.put("filename_prefix", "test_background");
+  post_processor_database.put("background_writing", true);
+  adamantine::PostProcessor<2> background_post_processor(
+      communicator, post_processor_database, dof_handler);
+  background_post_processor.write_thermal_output(
+      0, 0., src, mat_properties.get_state(), mat_properties.get_dofs_map(),
+      mat_properties.get_dof_handler());
+  background_post_processor.write_pvd();
+  BOOST_CHECK(std::filesystem::exists("test_background.pvd"));
+  BOOST_CHECK(std::filesystem::exists("test_background.0.pvtu"));
+  BOOST_CHECK(std::filesystem::exists("test_background.0.0.vtu"));
+  // Each processor compares the file it has written
+  std::string const rank = std::to_string(
+      dealii::Utilities::MPI::this_mpi_process(communicator));
+  std::ifstream file("test.0." + rank + ".vtu");
+  std::ifstream background_file("test_background.0." + rank + ".vtu");
+  std::string const content((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+  std::string const background_content(
+      (std::istreambuf_iterator<char>(background_file)),
+      std::istreambuf_iterator<char>());
+  BOOST_TEST(background_content == content);
+
+  // Only write the cells in the left half of the domain and skip the material
+  // state
+  boost::property_tree::ptree reduced_database;
+  reduced_database.put("filename_prefix", "test_reduced");
+  reduced_database.put("thermal_output", true);
+  reduced_database.put("activated_cells_only", true);
+  reduced_database.put("output_box", "5., 6.; 0., 0.");
+  reduced_database.put("compression_level", "best_speed");
+  reduced_database.put("time_steps_between_material_output", 2);
+  adamantine::PostProcessor<2> reduced_post_processor(
+      communicator, reduced_database, dof_handler);
+  reduced_post_processor.write_thermal_output(
+      1, 0.1, src, mat_properties.get_state(), mat_properties.get_dofs_map(),
+      mat_properties.get_dof_handler());
+  reduced_post_processor.write_pvd();
+  std::ifstream reduced_file("test_reduced.1." + rank + ".vtu");
+  std::string const reduced_content(
+      (std::istreambuf_iterator<char>(reduced_file)),
+      std::istreambuf_iterator<char>());
+  BOOST_TEST(reduced_content.find("powder") == std::string::npos);
+  BOOST_TEST(reduced_content.find("temperature") != std::string::npos);
+  std::string const n_cells_attribute = "NumberOfCells=\"";
+  auto const n_cells_pos = reduced_content.find(n_cells_attribute);
+  BOOST_TEST(n_cells_pos != std::string::npos);
+  unsigned int const n_local_cells =
+      std::stoi(reduced_content.substr(n_cells_pos + n_cells_attribute.size()));
+  BOOST_TEST(dealii::Utilities::MPI::sum(n_local_cells, communicator) == 10);
+
   // Delete the files
+  std::remove("test_reduced.pvd");
+  std::remove("test_reduced.1.pvtu");
+  std::remove(("test_reduced.1." + rank + ".vtu").c_str());
+  std::remove("test_background.pvd");
+  std::remove("test_background.0.pvtu");
+  std::remove("test_background.0.0.vtu");
   std::remove("test.pvd");
   std::remove("test.0.pvtu");
   std::remove("test.1.pvtu");
@@ -0,0 +1,138 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#define BOOST_TEST_MODULE PreprocessingCache
+
+#include <ScanPath.hh>
+#include <material_deposition.hh>
+#include <preprocessing_cache.hh>
+
+#include <filesystem>
+#include <fstream>
+
+#include "main.cc"
+
+namespace utf = boost::unit_test;
+
+BOOST_AUTO_TEST_CASE(file_cache_key)
+{
+  std::string const filename = "file_cache_key.txt";
+  {
+    std::ofstream file(filename);
+    file << "abc\n";
+  }
+  std::string const key = adamantine::file_cache_key(filename, "segment");
+  BOOST_TEST(key.size() == 16u);
+  // The key is stable
+  BOOST_TEST(key == adamantine::file_cache_key(filename, "segment"));
+  // The key depends on the salt
+  BOOST_TEST(key != adamantine::file_cache_key(filename, "event_series"));
+  // The key depends on the content of the file
+  {
+    std::ofstream file(filename, std::ios::app);
+    file << "def\n";
+  }
+  BOOST_TEST(key != adamantine::file_cache_key(filename, "segment"));
+  std::filesystem::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(material_deposition_cache, *utf::tolerance(1e-15))
+{
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("material_deposition", true);
+  geometry_database.put("material_deposition_file",
+                        "material_deposition_3d.txt");
+  auto const deposition =
+      adamantine::read_material_deposition<3>(geometry_database);
+
+  std::string const cache_file = "material_deposition_cache.bin";
+  adamantine::write_material_deposition_cache<3>(cache_file, deposition);
+  auto const [bounding_boxes, time, deposition_cos, deposition_sin] =
+      adamantine::read_material_deposition_cache<3>(cache_file);
+  std::filesystem::remove(cache_file);
+
+  auto const &bounding_boxes_ref = std::get<0>(deposition);
+  BOOST_TEST(time == std::get<1>(deposition));
+  BOOST_TEST(deposition_cos == std::get<2>(deposition));
+  BOOST_TEST(deposition_sin == std::get<3>(deposition));
+  BOOST_TEST(bounding_boxes.size() == bounding_boxes_ref.size());
+  for (unsigned int i = 0; i < bounding_boxes_ref.size(); ++i)
+  {
+    auto points = bounding_boxes[i].get_boundary_points();
+    auto points_ref = bounding_boxes_ref[i].get_boundary_points();
+    for (int d = 0; d < 3; ++d)
+    {
+      BOOST_TEST(points.first[d] == points_ref.first[d]);
+      BOOST_TEST(points.second[d] == points_ref.second[d]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(use_preprocessing_cache, *utf::tolerance(1e-15))
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+  std::string const directory = "preprocessing_cache_test";
+  std::filesystem::remove_all(directory);
+
+  boost::property_tree::ptree database;
+  database.put("preprocessing_cache.directory", directory);
+  database.put("geometry.dim", 3);
+  database.put("geometry.import_mesh", false);
+  database.put("geometry.material_deposition", true);
+  database.put("geometry.material_deposition_method", "file");
+  database.put("geometry.material_deposition_file",
+               "material_deposition_3d.txt");
+  database.put("sources.n_beams", 1);
+  database.put("sources.beam_0.scan_path_file", "scan_path.txt");
+  database.put("sources.beam_0.scan_path_file_format", "segment");
+
+  adamantine::use_preprocessing_cache(communicator, database);
+
+  // The deposition cache is created and used
+  std::string const deposition_cache =
+      database.get<std::string>("geometry.material_deposition_cache_file");
+  BOOST_TEST(std::filesystem::exists(deposition_cache));
+  BOOST_TEST(std::filesystem::path(deposition_cache).parent_path() ==
+             std::filesystem::path(directory));
+  BOOST_TEST(database.count("geometry.coarse_mesh_cache_file") == 0u);
+
+  // The scan path is converted to the binary format
+  BOOST_TEST(database.get<std::string>(
+                 "sources.beam_0.scan_path_file_format") == "binary");
+  std::string const scan_path_cache =
+      database.get<std::string>("sources.beam_0.scan_path_file");
+  adamantine::ScanPath scan_path("scan_path.txt", "segment");
+  adamantine::ScanPath cached_scan_path(scan_path_cache, "binary");
+  auto const &segments = scan_path.get_segment_list();
+  auto const &cached_segments = cached_scan_path.get_segment_list();
+  BOOST_TEST(cached_segments.size() == segments.size());
+  for (unsigned int i = 0; i < segments.size(); ++i)
+  {
+    BOOST_TEST(cached_segments[i].end_time == segments[i].end_time);
+    BOOST_TEST(cached_segments[i].power_modifier ==
+               segments[i].power_modifier);
+    for (int d = 0; d < 3; ++d)
+      BOOST_TEST(cached_segments[i].end_point[d] == segments[i].end_point[d]);
+  }
+
+  // A second run reuses the same files
+  boost::property_tree::ptree second_database;
+  second_database.put("preprocessing_cache.directory", directory);
+  second_database.put_child("geometry", database.get_child("geometry"));
+  second_database.get_child("geometry").erase("material_deposition_cache_file");
+  second_database.put("sources.n_beams", 1);
+  second_database.put("sources.beam_0.scan_path_file", "scan_path.txt");
+  second_database.put("sources.beam_0.scan_path_file_format", "segment");
+  adamantine::use_preprocessing_cache(communicator, second_database);
+  BOOST_TEST(second_database.get<std::string>(
+                 "geometry.material_deposition_cache_file") ==
+             deposition_cache);
+  BOOST_TEST(second_database.get<std::string>(
+                 "sources.beam_0.scan_path_file") == scan_path_cache);
+
+  std::filesystem::remove_all(directory);
+}
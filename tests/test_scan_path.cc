@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2021, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -100,4 +100,87 @@ BOOST_AUTO_TEST_CASE(scan_path_location, *utf::tolerance(1e-10))
   BOOST_TEST(power == 0.0);
 }
 
+BOOST_AUTO_TEST_CASE(scan_path_binary)
+{
+  // Converting the text scan paths to the binary format does not change the
+  // segments.
+  std::vector<std::pair<std::string, std::string>> const files = {
+      {"scan_path.txt", "segment"},
+      {"scan_path_event_series.inp", "event_series"}};
+  for (auto const &[filename, file_format] : files)
+  {
+    ScanPath scan_path(filename, file_format);
+    scan_path.write_binary_scan_path("scan_path_binary.bin");
+    ScanPath binary_scan_path("scan_path_binary.bin", "binary");
+
+    auto const &segment_list = scan_path.get_segment_list();
+    auto const &binary_segment_list = binary_scan_path.get_segment_list();
+    BOOST_TEST(binary_segment_list.size() == segment_list.size());
+    for (unsigned int i = 0; i < segment_list.size(); ++i)
+    {
+      BOOST_TEST(binary_segment_list[i].end_time == segment_list[i].end_time);
+      BOOST_TEST(binary_segment_list[i].power_modifier ==
+                 segment_list[i].power_modifier);
+      for (unsigned int d = 0; d < 3; ++d)
+        BOOST_TEST(binary_segment_list[i].end_point[d] ==
+                   segment_list[i].end_point[d]);
+    }
+  }
+  std::remove("scan_path_binary.bin");
+}
+
+BOOST_AUTO_TEST_CASE(scan_path_lookup, *utf::tolerance(1e-10))
+{
+  // The lookup does not depend on the previous queries: querying the times
+  // forward, backward, and in a random order gives the same results.
+  ScanPath scan_path("scan_path.txt", "segment");
+  std::vector<double> times;
+  double const end_time = scan_path.get_segment_list().back().end_time;
+  unsigned int const n_times = 100;
+  for (unsigned int i = 0; i <= n_times; ++i)
+    times.push_back(static_cast<double>(i) / n_times * end_time);
+  std::vector<dealii::Point<3>> positions;
+  std::vector<double> powers;
+  for (auto const time : times)
+  {
+    positions.push_back(scan_path.value(time));
+    powers.push_back(scan_path.get_power_modifier(time));
+  }
+
+  for (int i = n_times; i >= 0; --i)
+  {
+    ScanPath new_scan_path("scan_path.txt", "segment");
+    dealii::Point<3> const position = new_scan_path.value(times[i]);
+    for (unsigned int d = 0; d < 3; ++d)
+    {
+      BOOST_TEST(scan_path.value(times[i])[d] == positions[i][d]);
+      BOOST_TEST(position[d] == positions[i][d]);
+    }
+    BOOST_TEST(scan_path.get_power_modifier(times[i]) == powers[i]);
+  }
+
+  for (unsigned int i = 0; i <= n_times; ++i)
+  {
+    unsigned int const j = (37 * i) % (n_times + 1);
+    for (unsigned int d = 0; d < 3; ++d)
+      BOOST_TEST(scan_path.value(times[j])[d] == positions[j][d]);
+    BOOST_TEST(scan_path.get_power_modifier(times[j]) == powers[j]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(scan_path_average_power, *utf::tolerance(1e-10))
+{
+  ScanPath scan_path("scan_path.txt", "segment");
+
+  // Half of the interval is in the first segment without power
+  BOOST_TEST(scan_path.get_average_power_modifier(0., 2e-6) == 0.5);
+  // Interval inside the second segment
+  BOOST_TEST(scan_path.get_average_power_modifier(1e-3, 2e-3) == 1.);
+  // The power is zero after the end of the scan path at 2.501e-3 s
+  BOOST_TEST(scan_path.get_average_power_modifier(2.5e-3, 3e-3) == 0.002);
+  // Empty interval
+  BOOST_TEST(scan_path.get_average_power_modifier(5e-7, 5e-7) == 0.);
+  BOOST_TEST(scan_path.get_average_power_modifier(1e-3, 1e-3) == 1.);
+}
+
 } // namespace adamantine
@@ -0,0 +1,116 @@
+/* Copyright (c) 2023, the adamantine authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#define BOOST_TEST_MODULE TemperatureProbes
+
+#include <Geometry.hh>
+#include <TemperatureProbes.hh>
+
+#include <deal.II/base/function.h>
+#include <deal.II/dofs/dof_tools.h>
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/numerics/vector_tools.h>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <cmath>
+
+#include "main.cc"
+
+namespace utf = boost::unit_test;
+
+BOOST_AUTO_TEST_CASE(temperature_probes, *utf::tolerance(1e-10))
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 1);
+  geometry_database.put("length_divisions", 4);
+  geometry_database.put("height", 1);
+  geometry_database.put("height_divisions", 4);
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  dealii::FE_Q<2> fe(1);
+  dealii::DoFHandler<2> dof_handler(geometry.get_triangulation());
+  dof_handler.distribute_dofs(fe);
+
+  // The last probe is outside of the domain
+  boost::property_tree::ptree database;
+  database.put("filename_prefix", "temperature_probes");
+  database.put("probes", "0.1, 0.2; 0.5,0.5;0.9,1.;2.,2.");
+  adamantine::TemperatureProbes<2> temperature_probes(communicator, database);
+  BOOST_TEST(temperature_probes.get_points().size() == 4);
+
+  // A linear temperature is represented exactly
+  dealii::IndexSet locally_relevant_dofs;
+  dealii::DoFTools::extract_locally_relevant_dofs(dof_handler,
+                                                  locally_relevant_dofs);
+  dealii::LA::distributed::Vector<double> temperature(
+      dof_handler.locally_owned_dofs(), locally_relevant_dofs, communicator);
+  dealii::VectorTools::interpolate(
+      dof_handler, dealii::ScalarFunctionFromFunctionObject<2>(
+                       [](dealii::Point<2> const &p)
+                       { return 300. + 100. * p[0] + 10. * p[1]; }),
+      temperature);
+
+  for (unsigned int step = 0; step < 2; ++step)
+  {
+    temperature_probes.write_values(0.1 * step, dof_handler, temperature);
+    if (dealii::Utilities::MPI::this_mpi_process(communicator) == 0)
+    {
+      auto const &values = temperature_probes.get_values();
+      BOOST_TEST(values[0] == 312.);
+      BOOST_TEST(values[1] == 355.);
+      BOOST_TEST(values[2] == 400.);
+      BOOST_TEST(std::isnan(values[3]));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(temperature_probes_single_processor,
+                     *utf::tolerance(1e-10))
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 1);
+  geometry_database.put("length_divisions", 4);
+  geometry_database.put("height", 1);
+  geometry_database.put("height_divisions", 4);
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  dealii::FE_Q<2> fe(1);
+  dealii::DoFHandler<2> dof_handler(geometry.get_triangulation());
+  dof_handler.distribute_dofs(fe);
+
+  // The probe is in the bottom row of cells, so with two processors only the
+  // first processor finds it.
+  boost::property_tree::ptree database;
+  database.put("filename_prefix", "temperature_probes_single_processor");
+  database.put("probes", "0.1, 0.1");
+  adamantine::TemperatureProbes<2> temperature_probes(communicator, database);
+
+  dealii::IndexSet locally_relevant_dofs;
+  dealii::DoFTools::extract_locally_relevant_dofs(dof_handler,
+                                                  locally_relevant_dofs);
+  dealii::LA::distributed::Vector<double> temperature(
+      dof_handler.locally_owned_dofs(), locally_relevant_dofs, communicator);
+  dealii::VectorTools::interpolate(
+      dof_handler, dealii::ScalarFunctionFromFunctionObject<2>(
+                       [](dealii::Point<2> const &p)
+                       { return 300. + 100. * p[0] + 10. * p[1]; }),
+      temperature);
+
+  for (unsigned int step = 0; step < 2; ++step)
+  {
+    // The ghost values need to be exchanged on every processor.
+    temperature.zero_out_ghost_values();
+    temperature_probes.write_values(0.1 * step, dof_handler, temperature);
+    if (dealii::Utilities::MPI::this_mpi_process(communicator) == 0)
+      BOOST_TEST(temperature_probes.get_values()[0] == 311.);
+  }
+}
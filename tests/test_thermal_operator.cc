@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2022, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -18,10 +18,12 @@
 #include <deal.II/fe/fe_q.h>
 #include <deal.II/fe/fe_values.h>
 #include <deal.II/fe/mapping_q1.h>
+#include <deal.II/grid/filtered_iterator.h>
 #include <deal.II/lac/dynamic_sparsity_pattern.h>
 #include <deal.II/lac/sparse_matrix.h>
 #include <deal.II/matrix_free/fe_point_evaluation.h>
 #include <deal.II/numerics/matrix_tools.h>
+#include <deal.II/numerics/vector_tools.h>
 
 #include <boost/property_tree/ptree.hpp>
 
@@ -39,6 +41,15 @@ public:
   }
 };
 
+class LinearTemperature : public dealii::Function<2>
+{
+public:
+  double value(const dealii::Point<2> &p, const unsigned int = 0) const final
+  {
+    return 2. * p[0];
+  }
+};
+
 BOOST_AUTO_TEST_CASE(thermal_operator, *utf::tolerance(1e-15))
 {
   MPI_Comm communicator = MPI_COMM_WORLD;
@@ -718,6 +729,16 @@ BOOST_AUTO_TEST_CASE(spmv_rad, *utf::tolerance(1e-12))
     sparse_matrix.vmult(dst_2, src);
     BOOST_TEST(dst_1 == dst_2, tt::per_element());
   }
+
+  // The fused evaluation matches vmult followed by the multiplication by the
+  // inverse of the mass matrix. dst_2 is not zeroed on purpose.
+  for (unsigned int i = 0; i < thermal_operator.m(); ++i)
+    src[i] = 1. + 0.1 * std::sin(static_cast<double>(i));
+  thermal_operator.vmult(dst_1, src);
+  dst_1.scale(*thermal_operator.get_inverse_mass_matrix());
+  dst_2 = 1.;
+  thermal_operator.inverse_mass_vmult(dst_2, src);
+  BOOST_TEST(dst_1 == dst_2, tt::per_element());
 }
 
 BOOST_AUTO_TEST_CASE(spmv_conv, *utf::tolerance(1e-12))
@@ -896,3 +917,615 @@ BOOST_AUTO_TEST_CASE(spmv_conv, *utf::tolerance(1e-12))
     BOOST_TEST(dst_1 == dst_2, tt::per_element());
   }
 }
+
+BOOST_AUTO_TEST_CASE(heat_source, *utf::tolerance(1e-12))
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  // Create the Geometry
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 12);
+  geometry_database.put("length_divisions", 4);
+  geometry_database.put("height", 6);
+  geometry_database.put("height_divisions", 5);
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  // Create the DoFHandler
+  dealii::hp::FECollection<2> fe_collection;
+  fe_collection.push_back(dealii::FE_Q<2>(2));
+  fe_collection.push_back(dealii::FE_Nothing<2>());
+  dealii::DoFHandler<2> dof_handler(geometry.get_triangulation());
+  dof_handler.distribute_dofs(fe_collection);
+  dealii::AffineConstraints<double> affine_constraints;
+  affine_constraints.close();
+  dealii::hp::QCollection<1> q_collection;
+  q_collection.push_back(dealii::QGauss<1>(3));
+  q_collection.push_back(dealii::QGauss<1>(1));
+
+  // Create the MaterialProperty
+  boost::property_tree::ptree mat_prop_database;
+  mat_prop_database.put("property_format", "polynomial");
+  mat_prop_database.put("n_materials", 1);
+  mat_prop_database.put("material_0.solid.density", 1.);
+  mat_prop_database.put("material_0.powder.density", 1.);
+  mat_prop_database.put("material_0.liquid.density", 1.);
+  mat_prop_database.put("material_0.solid.specific_heat", 1.);
+  mat_prop_database.put("material_0.powder.specific_heat", 1.);
+  mat_prop_database.put("material_0.liquid.specific_heat", 1.);
+  mat_prop_database.put("material_0.solid.thermal_conductivity_x", 1.);
+  mat_prop_database.put("material_0.solid.thermal_conductivity_z", 1.);
+  mat_prop_database.put("material_0.powder.thermal_conductivity_x", 1.);
+  mat_prop_database.put("material_0.powder.thermal_conductivity_z", 1.);
+  mat_prop_database.put("material_0.liquid.thermal_conductivity_x", 1.);
+  mat_prop_database.put("material_0.liquid.thermal_conductivity_z", 1.);
+  adamantine::MaterialProperty<2, dealii::MemorySpace::Host> mat_properties(
+      communicator, geometry.get_triangulation(), mat_prop_database);
+
+  // Create the heat sources
+  boost::property_tree::ptree beam_database;
+  beam_database.put("depth", 0.1);
+  beam_database.put("absorption_efficiency", 0.1);
+  beam_database.put("diameter", 1.0);
+  beam_database.put("max_power", 10.);
+  beam_database.put("scan_path_file", "scan_path.txt");
+  beam_database.put("scan_path_file_format", "segment");
+  std::vector<std::shared_ptr<adamantine::HeatSource<2>>> heat_sources;
+  heat_sources.resize(1);
+  heat_sources[0] =
+      std::make_shared<adamantine::GoldakHeatSource<2>>(beam_database);
+
+  // Initialize the ThermalOperator
+  adamantine::ThermalOperator<2, 2, dealii::MemorySpace::Host> thermal_operator(
+      communicator, adamantine::BoundaryType::adiabatic, mat_properties,
+      heat_sources);
+  std::vector<double> deposition_cos(
+      geometry.get_triangulation().n_locally_owned_active_cells(), 1.);
+  std::vector<double> deposition_sin(
+      geometry.get_triangulation().n_locally_owned_active_cells(), 0.);
+  thermal_operator.reinit(dof_handler, affine_constraints, q_collection);
+  thermal_operator.set_material_deposition_orientation(deposition_cos,
+                                                       deposition_sin);
+  thermal_operator.compute_inverse_mass_matrix(dof_handler, affine_constraints);
+  thermal_operator.get_state_from_material_properties();
+  double const time = 0.4;
+  double const height = 0.;
+  thermal_operator.set_time_and_source_height(time, height);
+
+  // Assemble the source term using FEValues. The material is solid and
+  // rho = cp = 1, so inv_rho_cp is one.
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> src;
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> dst_1;
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> dst_2;
+  dealii::MatrixFree<2, double> const &matrix_free =
+      thermal_operator.get_matrix_free();
+  matrix_free.initialize_dof_vector(src);
+  matrix_free.initialize_dof_vector(dst_1);
+  matrix_free.initialize_dof_vector(dst_2);
+
+  dealii::QGauss<2> quadrature(3);
+  dealii::FEValues<2> fe_values(fe_collection[0], quadrature,
+                                dealii::update_values |
+                                    dealii::update_quadrature_points |
+                                    dealii::update_JxW_values);
+  unsigned int const dofs_per_cell = fe_collection[0].n_dofs_per_cell();
+  dealii::Vector<double> cell_source(dofs_per_cell);
+  std::vector<dealii::types::global_dof_index> local_dof_indices(
+      dofs_per_cell);
+  for (auto const &cell : dof_handler.active_cell_iterators())
+  {
+    cell_source = 0.;
+    fe_values.reinit(cell);
+    for (unsigned int q = 0; q < quadrature.size(); ++q)
+    {
+      double const quad_pt_source =
+          heat_sources[0]->value(fe_values.quadrature_point(q), height);
+      for (unsigned int i = 0; i < dofs_per_cell; ++i)
+        cell_source[i] +=
+            quad_pt_source * fe_values.shape_value(i, q) * fe_values.JxW(q);
+    }
+    cell->get_dof_indices(local_dof_indices);
+    affine_constraints.distribute_local_to_global(cell_source,
+                                                  local_dof_indices, dst_2);
+  }
+  BOOST_TEST(dst_2.l1_norm() > 0.);
+
+  // With a zero temperature, vmult only applies the source term.
+  src = 0.;
+  thermal_operator.vmult(dst_1, src);
+  BOOST_TEST(dst_1 == dst_2, tt::per_element());
+
+  // The fused evaluation matches vmult followed by the multiplication by the
+  // inverse of the mass matrix.
+  for (unsigned int i = 0; i < thermal_operator.m(); ++i)
+    src[i] = std::sin(static_cast<double>(i));
+  thermal_operator.vmult(dst_1, src);
+  dst_1.scale(*thermal_operator.get_inverse_mass_matrix());
+  dst_2 = 1.;
+  thermal_operator.inverse_mass_vmult(dst_2, src);
+  BOOST_TEST(dst_1 == dst_2, tt::per_element());
+
+  // Culling the cell batches where the source is negligible does not change
+  // the result.
+  src = 0.;
+  thermal_operator.vmult(dst_1, src);
+  thermal_operator.set_heat_source_cutoff(1e-15);
+  thermal_operator.vmult(dst_2, src);
+  dst_2 -= dst_1;
+  BOOST_TEST(dst_2.linfty_norm() < 1e-12 * dst_1.linfty_norm());
+
+  // With a large cutoff, every cell batch is culled.
+  thermal_operator.set_heat_source_cutoff(1e100);
+  thermal_operator.vmult(dst_2, src);
+  BOOST_TEST(dst_2.l1_norm() == 0.);
+}
+
+BOOST_AUTO_TEST_CASE(frozen_coefficients, *utf::tolerance(1e-12))
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  // Create the Geometry
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 12);
+  geometry_database.put("length_divisions", 4);
+  geometry_database.put("height", 6);
+  geometry_database.put("height_divisions", 5);
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  // Create the DoFHandler
+  dealii::hp::FECollection<2> fe_collection;
+  fe_collection.push_back(dealii::FE_Q<2>(2));
+  fe_collection.push_back(dealii::FE_Nothing<2>());
+  dealii::DoFHandler<2> dof_handler(geometry.get_triangulation());
+  dof_handler.distribute_dofs(fe_collection);
+  dealii::AffineConstraints<double> affine_constraints;
+  affine_constraints.close();
+  dealii::hp::QCollection<1> q_collection;
+  q_collection.push_back(dealii::QGauss<1>(3));
+  q_collection.push_back(dealii::QGauss<1>(1));
+
+  // Create the MaterialProperty. The thermal conductivity depends on the
+  // temperature so that the operator is nonlinear.
+  boost::property_tree::ptree mat_prop_database;
+  mat_prop_database.put("property_format", "polynomial");
+  mat_prop_database.put("n_materials", 1);
+  mat_prop_database.put("material_0.solid.density", 1.);
+  mat_prop_database.put("material_0.powder.density", 1.);
+  mat_prop_database.put("material_0.liquid.density", 1.);
+  mat_prop_database.put("material_0.solid.specific_heat", 1.);
+  mat_prop_database.put("material_0.powder.specific_heat", 1.);
+  mat_prop_database.put("material_0.liquid.specific_heat", 1.);
+  mat_prop_database.put("material_0.solid.thermal_conductivity_x", "1., 0.5");
+  mat_prop_database.put("material_0.solid.thermal_conductivity_z", "1., 0.5");
+  mat_prop_database.put("material_0.powder.thermal_conductivity_x", "1., 0.5");
+  mat_prop_database.put("material_0.powder.thermal_conductivity_z", "1., 0.5");
+  mat_prop_database.put("material_0.liquid.thermal_conductivity_x", "1., 0.5");
+  mat_prop_database.put("material_0.liquid.thermal_conductivity_z", "1., 0.5");
+  adamantine::MaterialProperty<2, dealii::MemorySpace::Host> mat_properties(
+      communicator, geometry.get_triangulation(), mat_prop_database);
+
+  // Initialize the ThermalOperator
+  std::vector<std::shared_ptr<adamantine::HeatSource<2>>> heat_sources;
+  adamantine::ThermalOperator<2, 2, dealii::MemorySpace::Host> thermal_operator(
+      communicator, adamantine::BoundaryType::adiabatic, mat_properties,
+      heat_sources);
+  std::vector<double> deposition_cos(
+      geometry.get_triangulation().n_locally_owned_active_cells(), 1.);
+  std::vector<double> deposition_sin(
+      geometry.get_triangulation().n_locally_owned_active_cells(), 0.);
+  thermal_operator.reinit(dof_handler, affine_constraints, q_collection);
+  thermal_operator.set_material_deposition_orientation(deposition_cos,
+                                                       deposition_sin);
+  thermal_operator.get_state_from_material_properties();
+  thermal_operator.set_frozen_coefficients(true);
+
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+      linearization_point;
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> src;
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> sum;
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> dst_1;
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> dst_2;
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> dst_3;
+  thermal_operator.initialize_dof_vector(linearization_point);
+  thermal_operator.initialize_dof_vector(src);
+  thermal_operator.initialize_dof_vector(sum);
+  thermal_operator.initialize_dof_vector(dst_1);
+  thermal_operator.initialize_dof_vector(dst_2);
+  thermal_operator.initialize_dof_vector(dst_3);
+  for (unsigned int i = 0; i < thermal_operator.m(); ++i)
+  {
+    linearization_point[i] = 10. * std::sin(static_cast<double>(i));
+    src[i] = std::cos(static_cast<double>(i));
+  }
+  sum = linearization_point;
+  sum += src;
+
+  // vmult saves the coefficients at the linearization point. Since there is
+  // no heat source, applying the Jacobian to the linearization point gives
+  // the same result as vmult.
+  thermal_operator.vmult(dst_1, linearization_point);
+  thermal_operator.jacobian_vmult(dst_2, linearization_point);
+  BOOST_TEST(dst_1.l1_norm() > 0.);
+  BOOST_TEST(dst_1 == dst_2, tt::per_element());
+
+  // The frozen Jacobian is linear.
+  thermal_operator.jacobian_vmult(dst_1, sum);
+  thermal_operator.jacobian_vmult(dst_3, src);
+  dst_2 += dst_3;
+  BOOST_TEST(dst_1 == dst_2, tt::per_element());
+
+  // Once the material state has changed, the coefficients are recomputed and
+  // jacobian_vmult falls back to vmult.
+  thermal_operator.get_state_from_material_properties();
+  thermal_operator.jacobian_vmult(dst_1, src);
+  thermal_operator.set_frozen_coefficients(false);
+  thermal_operator.vmult(dst_2, src);
+  BOOST_TEST(dst_1 == dst_2, tt::per_element());
+
+  // Check the diagonal of the frozen Jacobian against jacobian_vmult applied
+  // to the unit vectors.
+  thermal_operator.set_frozen_coefficients(true);
+  thermal_operator.vmult(dst_1, linearization_point);
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> diagonal;
+  thermal_operator.compute_jacobian_diagonal(diagonal);
+  for (unsigned int i = 0; i < thermal_operator.m(); ++i)
+  {
+    src = 0.;
+    src[i] = 1.;
+    thermal_operator.jacobian_vmult(dst_1, src);
+    BOOST_TEST(diagonal[i] == dst_1[i]);
+  }
+
+  // Once the material state has changed, the diagonal is computed with the
+  // coefficients recomputed at the last linearization point.
+  thermal_operator.get_state_from_material_properties();
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+      updated_diagonal;
+  thermal_operator.compute_jacobian_diagonal(updated_diagonal);
+  BOOST_TEST(updated_diagonal == diagonal, tt::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(multirate, *utf::tolerance(1e-12))
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  // Create the Geometry
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 12);
+  geometry_database.put("length_divisions", 4);
+  geometry_database.put("height", 6);
+  geometry_database.put("height_divisions", 5);
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  // Create the DoFHandler
+  dealii::hp::FECollection<2> fe_collection;
+  fe_collection.push_back(dealii::FE_Q<2>(2));
+  fe_collection.push_back(dealii::FE_Nothing<2>());
+  dealii::DoFHandler<2> dof_handler(geometry.get_triangulation());
+  dof_handler.distribute_dofs(fe_collection);
+  dealii::AffineConstraints<double> affine_constraints;
+  affine_constraints.close();
+  dealii::hp::QCollection<1> q_collection;
+  q_collection.push_back(dealii::QGauss<1>(3));
+  q_collection.push_back(dealii::QGauss<1>(1));
+
+  // Create the MaterialProperty
+  boost::property_tree::ptree mat_prop_database;
+  mat_prop_database.put("property_format", "polynomial");
+  mat_prop_database.put("n_materials", 1);
+  mat_prop_database.put("material_0.solid.density", 1.);
+  mat_prop_database.put("material_0.powder.density", 1.);
+  mat_prop_database.put("material_0.liquid.density", 1.);
+  mat_prop_database.put("material_0.solid.specific_heat", 1.);
+  mat_prop_database.put("material_0.powder.specific_heat", 1.);
+  mat_prop_database.put("material_0.liquid.specific_heat", 1.);
+  mat_prop_database.put("material_0.solid.thermal_conductivity_x", 10.);
+  mat_prop_database.put("material_0.solid.thermal_conductivity_z", 10.);
+  mat_prop_database.put("material_0.powder.thermal_conductivity_x", 10.);
+  mat_prop_database.put("material_0.powder.thermal_conductivity_z", 10.);
+  mat_prop_database.put("material_0.liquid.thermal_conductivity_x", 10.);
+  mat_prop_database.put("material_0.liquid.thermal_conductivity_z", 10.);
+  adamantine::MaterialProperty<2, dealii::MemorySpace::Host> mat_properties(
+      communicator, geometry.get_triangulation(), mat_prop_database);
+
+  std::vector<std::shared_ptr<adamantine::HeatSource<2>>> heat_sources;
+  std::vector<double> deposition_cos(
+      geometry.get_triangulation().n_locally_owned_active_cells(), 1.);
+  std::vector<double> deposition_sin(
+      geometry.get_triangulation().n_locally_owned_active_cells(), 0.);
+
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> src;
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> dst_1;
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> dst_2;
+
+  // The mesh is not refined, so all the cells are fast if the multirate level
+  // is zero and none of them is fast otherwise.
+  for (unsigned int level = 0; level < 2; ++level)
+  {
+    adamantine::ThermalOperator<2, 2, dealii::MemorySpace::Host>
+        thermal_operator(communicator, adamantine::BoundaryType::adiabatic,
+                         mat_properties, heat_sources);
+    thermal_operator.set_multirate_level(level);
+    thermal_operator.reinit(dof_handler, affine_constraints, q_collection);
+    thermal_operator.set_material_deposition_orientation(deposition_cos,
+                                                         deposition_sin);
+    thermal_operator.get_state_from_material_properties();
+
+    thermal_operator.initialize_dof_vector(src);
+    thermal_operator.initialize_dof_vector(dst_1);
+    thermal_operator.initialize_dof_vector(dst_2);
+    for (unsigned int i = 0; i < thermal_operator.m(); ++i)
+      src[i] = std::cos(static_cast<double>(i));
+
+    thermal_operator.fast_cells_vmult(dst_1, src);
+    if (level == 0)
+    {
+      thermal_operator.vmult(dst_2, src);
+      BOOST_TEST(dst_2.l1_norm() > 0.);
+      BOOST_TEST(dst_1 == dst_2, tt::per_element());
+    }
+    else
+    {
+      BOOST_TEST(dst_1.l1_norm() == 0.);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(single_precision, *utf::tolerance(1e-12))
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  // Create the Geometry
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 12);
+  geometry_database.put("length_divisions", 4);
+  geometry_database.put("height", 6);
+  geometry_database.put("height_divisions", 5);
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  // Create the DoFHandler
+  dealii::hp::FECollection<2> fe_collection;
+  fe_collection.push_back(dealii::FE_Q<2>(2));
+  fe_collection.push_back(dealii::FE_Nothing<2>());
+  dealii::DoFHandler<2> dof_handler(geometry.get_triangulation());
+  dof_handler.distribute_dofs(fe_collection);
+  dealii::AffineConstraints<double> affine_constraints;
+  affine_constraints.close();
+  dealii::hp::QCollection<1> q_collection;
+  q_collection.push_back(dealii::QGauss<1>(3));
+  q_collection.push_back(dealii::QGauss<1>(1));
+
+  // Create the MaterialProperty. The thermal conductivity depends on the
+  // temperature so that the polynomials are evaluated in single precision.
+  boost::property_tree::ptree mat_prop_database;
+  mat_prop_database.put("property_format", "polynomial");
+  mat_prop_database.put("n_materials", 1);
+  mat_prop_database.put("material_0.solid.density", 1.);
+  mat_prop_database.put("material_0.powder.density", 1.);
+  mat_prop_database.put("material_0.liquid.density", 1.);
+  mat_prop_database.put("material_0.solid.specific_heat", 1.);
+  mat_prop_database.put("material_0.powder.specific_heat", 1.);
+  mat_prop_database.put("material_0.liquid.specific_heat", 1.);
+  mat_prop_database.put("material_0.solid.thermal_conductivity_x", "1., 0.5");
+  mat_prop_database.put("material_0.solid.thermal_conductivity_z", "1., 0.5");
+  mat_prop_database.put("material_0.powder.thermal_conductivity_x", "1., 0.5");
+  mat_prop_database.put("material_0.powder.thermal_conductivity_z", "1., 0.5");
+  mat_prop_database.put("material_0.liquid.thermal_conductivity_x", "1., 0.5");
+  mat_prop_database.put("material_0.liquid.thermal_conductivity_z", "1., 0.5");
+  adamantine::MaterialProperty<2, dealii::MemorySpace::Host> mat_properties(
+      communicator, geometry.get_triangulation(), mat_prop_database);
+
+  // Initialize the double and the single precision ThermalOperator
+  std::vector<std::shared_ptr<adamantine::HeatSource<2>>> heat_sources;
+  std::vector<double> deposition_cos(
+      geometry.get_triangulation().n_locally_owned_active_cells(), 1.);
+  std::vector<double> deposition_sin(
+      geometry.get_triangulation().n_locally_owned_active_cells(), 0.);
+  adamantine::ThermalOperator<2, 2, dealii::MemorySpace::Host>
+      thermal_operator_double(communicator, adamantine::BoundaryType::adiabatic,
+                              mat_properties, heat_sources);
+  thermal_operator_double.reinit(dof_handler, affine_constraints,
+                                 q_collection);
+  thermal_operator_double.set_material_deposition_orientation(deposition_cos,
+                                                              deposition_sin);
+  thermal_operator_double.compute_inverse_mass_matrix(dof_handler,
+                                                      affine_constraints);
+  thermal_operator_double.get_state_from_material_properties();
+  adamantine::ThermalOperator<2, 2, dealii::MemorySpace::Host, float>
+      thermal_operator_float(communicator, adamantine::BoundaryType::adiabatic,
+                             mat_properties, heat_sources);
+  thermal_operator_float.reinit(dof_handler, affine_constraints, q_collection);
+  thermal_operator_float.set_material_deposition_orientation(deposition_cos,
+                                                             deposition_sin);
+  thermal_operator_float.compute_inverse_mass_matrix(dof_handler,
+                                                     affine_constraints);
+  thermal_operator_float.get_state_from_material_properties();
+
+  BOOST_TEST(thermal_operator_float.m() == thermal_operator_double.m());
+
+  // The inverse of the mass matrix is always computed in double precision.
+  BOOST_TEST(*thermal_operator_float.get_inverse_mass_matrix() ==
+                 *thermal_operator_double.get_inverse_mass_matrix(),
+             tt::per_element());
+
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> src;
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> dst_1;
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> dst_2;
+  thermal_operator_double.initialize_dof_vector(src);
+  thermal_operator_double.initialize_dof_vector(dst_1);
+  thermal_operator_float.initialize_dof_vector(dst_2);
+  for (unsigned int i = 0; i < thermal_operator_double.m(); ++i)
+    src[i] = 10. * std::sin(static_cast<double>(i));
+
+  // The single precision operator matches the double precision operator up to
+  // the round-off of single precision.
+  thermal_operator_double.vmult(dst_1, src);
+  thermal_operator_float.vmult(dst_2, src);
+  BOOST_TEST(dst_1.l2_norm() > 0.);
+  dst_2 -= dst_1;
+  BOOST_TEST(dst_2.l2_norm() / dst_1.l2_norm() < 1e-5);
+}
+
+BOOST_AUTO_TEST_CASE(sleeping_cells, *utf::tolerance(1e-12))
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  // Create the Geometry
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 12);
+  geometry_database.put("length_divisions", 4);
+  geometry_database.put("height", 6);
+  geometry_database.put("height_divisions", 5);
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  // Create the DoFHandler
+  dealii::hp::FECollection<2> fe_collection;
+  fe_collection.push_back(dealii::FE_Q<2>(2));
+  fe_collection.push_back(dealii::FE_Nothing<2>());
+  dealii::DoFHandler<2> dof_handler(geometry.get_triangulation());
+  dof_handler.distribute_dofs(fe_collection);
+  dealii::AffineConstraints<double> affine_constraints;
+  affine_constraints.close();
+  dealii::hp::QCollection<1> q_collection;
+  q_collection.push_back(dealii::QGauss<1>(3));
+  q_collection.push_back(dealii::QGauss<1>(1));
+
+  // Create the MaterialProperty
+  boost::property_tree::ptree mat_prop_database;
+  mat_prop_database.put("property_format", "polynomial");
+  mat_prop_database.put("n_materials", 1);
+  mat_prop_database.put("material_0.solid.density", 1.);
+  mat_prop_database.put("material_0.powder.density", 1.);
+  mat_prop_database.put("material_0.liquid.density", 1.);
+  mat_prop_database.put("material_0.solid.specific_heat", 1.);
+  mat_prop_database.put("material_0.powder.specific_heat", 1.);
+  mat_prop_database.put("material_0.liquid.specific_heat", 1.);
+  mat_prop_database.put("material_0.solid.thermal_conductivity_x", 10.);
+  mat_prop_database.put("material_0.solid.thermal_conductivity_z", 10.);
+  mat_prop_database.put("material_0.powder.thermal_conductivity_x", 10.);
+  mat_prop_database.put("material_0.powder.thermal_conductivity_z", 10.);
+  mat_prop_database.put("material_0.liquid.thermal_conductivity_x", 10.);
+  mat_prop_database.put("material_0.liquid.thermal_conductivity_z", 10.);
+  adamantine::MaterialProperty<2, dealii::MemorySpace::Host> mat_properties(
+      communicator, geometry.get_triangulation(), mat_prop_database);
+
+  std::vector<std::shared_ptr<adamantine::HeatSource<2>>> heat_sources;
+  std::vector<double> deposition_cos(
+      geometry.get_triangulation().n_locally_owned_active_cells(), 1.);
+  std::vector<double> deposition_sin(
+      geometry.get_triangulation().n_locally_owned_active_cells(), 0.);
+
+  // A cell batch falls asleep after two quiet time steps.
+  adamantine::ThermalOperator<2, 2, dealii::MemorySpace::Host> thermal_operator(
+      communicator, adamantine::BoundaryType::adiabatic, mat_properties,
+      heat_sources);
+  thermal_operator.set_heat_source_cutoff(1e-15);
+  thermal_operator.set_sleep_parameters(2, 1e-10);
+  thermal_operator.set_frozen_coefficients(true);
+  thermal_operator.reinit(dof_handler, affine_constraints, q_collection);
+  thermal_operator.set_material_deposition_orientation(deposition_cos,
+                                                       deposition_sin);
+  thermal_operator.get_state_from_material_properties();
+  unsigned int const n_cell_batches =
+      thermal_operator.get_matrix_free().n_cell_batches();
+
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+      temperature;
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> src;
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> dst;
+  thermal_operator.initialize_dof_vector(temperature);
+  thermal_operator.initialize_dof_vector(src);
+  thermal_operator.initialize_dof_vector(dst);
+  temperature = 300.;
+  for (unsigned int i = 0; i < thermal_operator.m(); ++i)
+    src[i] = std::cos(static_cast<double>(i));
+
+  // The first call only saves the temperature.
+  thermal_operator.update_sleeping_cell_batches(temperature);
+  BOOST_TEST(thermal_operator.n_sleeping_cell_batches() == 0u);
+  thermal_operator.update_sleeping_cell_batches(temperature);
+  BOOST_TEST(thermal_operator.n_sleeping_cell_batches() == 0u);
+  thermal_operator.update_sleeping_cell_batches(temperature);
+  BOOST_TEST(thermal_operator.n_sleeping_cell_batches() == n_cell_batches);
+
+  // Every cell batch is skipped, also by the diagonal of the Jacobian.
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> diagonal;
+  thermal_operator.vmult(dst, src);
+  BOOST_TEST(dst.l1_norm() == 0.);
+  thermal_operator.compute_jacobian_diagonal(diagonal);
+  BOOST_TEST(diagonal.l1_norm() == 0.);
+
+  // The cell batches that share the modified dof wake up.
+  temperature[0] += 1.;
+  thermal_operator.update_sleeping_cell_batches(temperature);
+  BOOST_TEST(thermal_operator.n_sleeping_cell_batches() < n_cell_batches);
+  thermal_operator.vmult(dst, src);
+  BOOST_TEST(dst.l1_norm() > 0.);
+  thermal_operator.compute_jacobian_diagonal(diagonal);
+  BOOST_TEST(diagonal.l1_norm() > 0.);
+
+  // A new mesh wakes up every cell batch.
+  thermal_operator.reinit(dof_handler, affine_constraints, q_collection);
+  BOOST_TEST(thermal_operator.n_sleeping_cell_batches() == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(gradient_indicator, *utf::tolerance(1e-6))
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  // Create the Geometry
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 12);
+  geometry_database.put("length_divisions", 4);
+  geometry_database.put("height", 6);
+  geometry_database.put("height_divisions", 5);
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  // Create the DoFHandler
+  dealii::hp::FECollection<2> fe_collection;
+  fe_collection.push_back(dealii::FE_Q<2>(2));
+  fe_collection.push_back(dealii::FE_Nothing<2>());
+  dealii::DoFHandler<2> dof_handler(geometry.get_triangulation());
+  dof_handler.distribute_dofs(fe_collection);
+  dealii::AffineConstraints<double> affine_constraints;
+  affine_constraints.close();
+  dealii::hp::QCollection<1> q_collection;
+  q_collection.push_back(dealii::QGauss<1>(3));
+  q_collection.push_back(dealii::QGauss<1>(1));
+
+  // Create the MaterialProperty
+  boost::property_tree::ptree mat_prop_database;
+  mat_prop_database.put("property_format", "polynomial");
+  mat_prop_database.put("n_materials", 1);
+  mat_prop_database.put("material_0.solid.density", 1.);
+  mat_prop_database.put("material_0.solid.specific_heat", 1.);
+  mat_prop_database.put("material_0.solid.thermal_conductivity_x", 10.);
+  mat_prop_database.put("material_0.solid.thermal_conductivity_z", 10.);
+  adamantine::MaterialProperty<2, dealii::MemorySpace::Host> mat_properties(
+      communicator, geometry.get_triangulation(), mat_prop_database);
+
+  std::vector<std::shared_ptr<adamantine::HeatSource<2>>> heat_sources;
+  adamantine::ThermalOperator<2, 2, dealii::MemorySpace::Host> thermal_operator(
+      communicator, adamantine::BoundaryType::adiabatic, mat_properties,
+      heat_sources);
+  thermal_operator.reinit(dof_handler, affine_constraints, q_collection);
+
+  // The gradient of the temperature is constant, the indicator is
+  // h_K |grad T| |K|^(1/2).
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+      temperature;
+  thermal_operator.initialize_dof_vector(temperature);
+  dealii::VectorTools::interpolate(dof_handler, LinearTemperature(),
+                                   temperature);
+  dealii::Vector<float> indicator;
+  thermal_operator.compute_gradient_indicator(temperature, indicator);
+
+  // The ghost values of the temperature are left as they were.
+  BOOST_TEST(!temperature.has_ghost_elements());
+  BOOST_TEST(indicator.size() == geometry.get_triangulation().n_active_cells());
+  double const reference = std::sqrt(3. * 3. + 1.2 * 1.2) * 2. *
+                           std::sqrt(3. * 1.2);
+  for (auto const &cell :
+       dealii::filter_iterators(dof_handler.active_cell_iterators(),
+                                dealii::IteratorFilters::LocallyOwnedCell()))
+    BOOST_TEST(indicator[cell->active_cell_index()] == reference);
+}
@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2022, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -17,6 +17,7 @@
 #include <deal.II/fe/fe_nothing.h>
 #include <deal.II/fe/fe_q.h>
 #include <deal.II/fe/fe_values.h>
+#include <deal.II/grid/grid_tools.h>
 #include <deal.II/lac/dynamic_sparsity_pattern.h>
 #include <deal.II/lac/read_write_vector.h>
 #include <deal.II/lac/sparse_matrix.h>
@@ -73,9 +74,10 @@ BOOST_AUTO_TEST_CASE(thermal_operator_dev, *utf::tolerance(1e-10))
       communicator, geometry.get_triangulation(), mat_prop_database);
 
   // Initialize the ThermalOperator
+  std::vector<std::shared_ptr<adamantine::HeatSource<2>>> heat_sources;
   adamantine::ThermalOperatorDevice<2, 2, dealii::MemorySpace::CUDA>
       thermal_operator_dev(communicator, adamantine::BoundaryType::adiabatic,
-                           mat_properties);
+                           mat_properties, heat_sources);
   thermal_operator_dev.compute_inverse_mass_matrix(dof_handler,
                                                    affine_constraints);
   std::vector<double> deposition_cos(
@@ -161,9 +163,10 @@ BOOST_AUTO_TEST_CASE(spmv, *utf::tolerance(1e-12))
       communicator, geometry.get_triangulation(), mat_prop_database);
 
   // Initialize the ThermalOperator
+  std::vector<std::shared_ptr<adamantine::HeatSource<2>>> heat_sources;
   adamantine::ThermalOperatorDevice<2, 2, dealii::MemorySpace::CUDA>
       thermal_operator_dev(communicator, adamantine::BoundaryType::adiabatic,
-                           mat_properties);
+                           mat_properties, heat_sources);
   thermal_operator_dev.compute_inverse_mass_matrix(dof_handler,
                                                    affine_constraints);
   std::vector<double> deposition_cos(
@@ -280,7 +283,7 @@ BOOST_AUTO_TEST_CASE(mf_spmv, *utf::tolerance(1.5e-12))
   // Initialize the ThermalOperator
   adamantine::ThermalOperatorDevice<2, 2, dealii::MemorySpace::CUDA>
       thermal_operator_dev(communicator, adamantine::BoundaryType::adiabatic,
-                           mat_properties);
+                           mat_properties, heat_sources);
   thermal_operator_dev.compute_inverse_mass_matrix(dof_handler,
                                                    affine_constraints);
   std::vector<double> deposition_cos(
@@ -393,9 +396,10 @@ BOOST_AUTO_TEST_CASE(spmv_anisotropic_angle, *utf::tolerance(1e-10))
       communicator, geometry.get_triangulation(), mat_prop_database);
 
   // Initialize the ThermalOperatorDevice
+  std::vector<std::shared_ptr<adamantine::HeatSource<3>>> heat_sources;
   adamantine::ThermalOperatorDevice<3, 2, dealii::MemorySpace::CUDA>
       thermal_operator_dev(communicator, adamantine::BoundaryType::adiabatic,
-                           mat_properties);
+                           mat_properties, heat_sources);
   double constexpr deposition_angle = M_PI / 6.;
   std::vector<double> deposition_cos(
       geometry.get_triangulation().n_locally_owned_active_cells(),
@@ -491,3 +495,127 @@ BOOST_AUTO_TEST_CASE(spmv_anisotropic_angle, *utf::tolerance(1e-10))
       BOOST_TEST(dst_dev_to_host[j] == -dst_host[j]);
   }
 }
+
+// Compare the source term applied on the device and on the host. When
+// rotate_mesh is true, the mesh is rotated onto itself such that the first
+// vertex of every cell is the upper corner of the cell.
+void check_source(bool const rotate_mesh)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  // Create the Geometry
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 12);
+  geometry_database.put("length_divisions", 4);
+  geometry_database.put("height", 6);
+  geometry_database.put("height_divisions", 5);
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  if (rotate_mesh)
+  {
+    dealii::GridTools::rotate(dealii::numbers::PI,
+                              geometry.get_triangulation());
+    dealii::GridTools::shift(dealii::Point<2>(12., 6.),
+                             geometry.get_triangulation());
+  }
+  // Create the DoFHandler
+  dealii::hp::FECollection<2> fe_collection;
+  fe_collection.push_back(dealii::FE_Q<2>(2));
+  fe_collection.push_back(dealii::FE_Nothing<2>());
+  dealii::DoFHandler<2> dof_handler(geometry.get_triangulation());
+  dof_handler.distribute_dofs(fe_collection);
+  dealii::AffineConstraints<double> affine_constraints;
+  affine_constraints.close();
+  dealii::hp::QCollection<1> q_collection;
+  q_collection.push_back(dealii::QGauss<1>(3));
+  q_collection.push_back(dealii::QGauss<1>(1));
+
+  // Create the MaterialProperty
+  boost::property_tree::ptree mat_prop_database;
+  mat_prop_database.put("property_format", "polynomial");
+  mat_prop_database.put("n_materials", 1);
+  mat_prop_database.put("material_0.solid.density", 1.);
+  mat_prop_database.put("material_0.powder.density", 1.);
+  mat_prop_database.put("material_0.liquid.density", 1.);
+  mat_prop_database.put("material_0.solid.specific_heat", 1.);
+  mat_prop_database.put("material_0.powder.specific_heat", 1.);
+  mat_prop_database.put("material_0.liquid.specific_heat", 1.);
+  mat_prop_database.put("material_0.solid.thermal_conductivity_x", 1.);
+  mat_prop_database.put("material_0.solid.thermal_conductivity_z", 1.);
+  mat_prop_database.put("material_0.powder.thermal_conductivity_x", 1.);
+  mat_prop_database.put("material_0.powder.thermal_conductivity_z", 1.);
+  mat_prop_database.put("material_0.liquid.thermal_conductivity_x", 1.);
+  mat_prop_database.put("material_0.liquid.thermal_conductivity_z", 1.);
+  adamantine::MaterialProperty<2, dealii::MemorySpace::Host>
+      mat_properties_host(communicator, geometry.get_triangulation(),
+                          mat_prop_database);
+  adamantine::MaterialProperty<2, dealii::MemorySpace::CUDA> mat_properties(
+      communicator, geometry.get_triangulation(), mat_prop_database);
+
+  // Create the heat sources
+  boost::property_tree::ptree beam_database;
+  beam_database.put("depth", 0.1);
+  beam_database.put("absorption_efficiency", 0.1);
+  beam_database.put("diameter", 1.0);
+  beam_database.put("max_power", 10.);
+  beam_database.put("scan_path_file", "scan_path.txt");
+  beam_database.put("scan_path_file_format", "segment");
+  std::vector<std::shared_ptr<adamantine::HeatSource<2>>> heat_sources;
+  heat_sources.resize(1);
+  heat_sources[0] =
+      std::make_shared<adamantine::GoldakHeatSource<2>>(beam_database);
+
+  // Initialize the ThermalOperators
+  std::vector<double> deposition_cos(
+      geometry.get_triangulation().n_locally_owned_active_cells(), 1.);
+  std::vector<double> deposition_sin(
+      geometry.get_triangulation().n_locally_owned_active_cells(), 0.);
+  adamantine::ThermalOperatorDevice<2, 2, dealii::MemorySpace::CUDA>
+      thermal_operator_dev(communicator, adamantine::BoundaryType::adiabatic,
+                           mat_properties, heat_sources);
+  thermal_operator_dev.reinit(dof_handler, affine_constraints, q_collection);
+  thermal_operator_dev.set_material_deposition_orientation(deposition_cos,
+                                                           deposition_sin);
+  thermal_operator_dev.get_state_from_material_properties();
+
+  adamantine::ThermalOperator<2, 2, dealii::MemorySpace::Host>
+      thermal_operator_host(communicator, adamantine::BoundaryType::adiabatic,
+                            mat_properties_host, heat_sources);
+  thermal_operator_host.reinit(dof_handler, affine_constraints, q_collection);
+  thermal_operator_host.set_material_deposition_orientation(deposition_cos,
+                                                            deposition_sin);
+  thermal_operator_host.get_state_from_material_properties();
+
+  double const time = 0.4;
+  double const height = 0.;
+  thermal_operator_dev.set_time_and_source_height(time, height);
+  thermal_operator_host.set_time_and_source_height(time, height);
+
+  // With a zero temperature, vmult only applies the source term.
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::CUDA> src_dev;
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::CUDA> dst_dev;
+  thermal_operator_dev.initialize_dof_vector(src_dev);
+  thermal_operator_dev.initialize_dof_vector(dst_dev);
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> src_host(
+      src_dev.get_partitioner());
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> dst_host(
+      dst_dev.get_partitioner());
+  src_dev = 0.;
+  src_host = 0.;
+  thermal_operator_dev.vmult(dst_dev, src_dev);
+  thermal_operator_host.vmult(dst_host, src_host);
+  BOOST_TEST(dst_host.l1_norm() > 0.);
+
+  dealii::LinearAlgebra::ReadWriteVector<double> rw_vector(
+      thermal_operator_dev.m());
+  rw_vector.import(dst_dev, dealii::VectorOperation::insert);
+  for (unsigned int j = 0; j < thermal_operator_dev.m(); ++j)
+    BOOST_TEST(rw_vector[j] == dst_host[j]);
+}
+
+BOOST_AUTO_TEST_CASE(mf_source, *utf::tolerance(1e-12)) { check_source(false); }
+
+BOOST_AUTO_TEST_CASE(mf_source_rotated_mesh, *utf::tolerance(1e-12))
+{
+  check_source(true);
+}
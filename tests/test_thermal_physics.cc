@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2021, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -26,6 +26,56 @@ BOOST_AUTO_TEST_CASE(thermal_2d_explicit_host)
   thermal_2d<dealii::MemorySpace::Host>(database, 0.05);
 }
 
+BOOST_AUTO_TEST_CASE(thermal_2d_explicit_persistent_stages_host)
+{
+  boost::property_tree::ptree database;
+  // Time-stepping database
+  database.put("time_stepping.method", "forward_euler");
+  database.put("time_stepping.persistent_stages", true);
+  database.put("sources.beam_0.scan_path_file",
+               "scan_path_test_thermal_physics.txt");
+  database.put("sources.beam_0.type", "electron_beam");
+  database.put("sources.beam_0.scan_path_file_format", "segment");
+
+  thermal_2d<dealii::MemorySpace::Host>(database, 0.05);
+}
+
+BOOST_AUTO_TEST_CASE(thermal_2d_explicit_dof_renumbering_host)
+{
+  // The renumbering of the dofs does not change the solution.
+  for (std::string const renumbering :
+       {"matrix_free_data_locality", "cuthill_mckee"})
+  {
+    boost::property_tree::ptree database;
+    // Time-stepping database
+    database.put("time_stepping.method", "forward_euler");
+    database.put("discretization.thermal.dof_renumbering", renumbering);
+    database.put("sources.beam_0.scan_path_file",
+                 "scan_path_test_thermal_physics.txt");
+    database.put("sources.beam_0.type", "electron_beam");
+    database.put("sources.beam_0.scan_path_file_format", "segment");
+
+    thermal_2d<dealii::MemorySpace::Host>(database, 0.05);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(thermal_2d_explicit_dwell_host)
+{
+  // The dwell method is set up but the dwell mode is not enabled, so the
+  // solution is the same as with the explicit method.
+  boost::property_tree::ptree database;
+  // Time-stepping database
+  database.put("time_stepping.method", "forward_euler");
+  database.put("time_stepping.dwell_time_step", 1.);
+  database.put("time_stepping.dwell_method", "imex_euler");
+  database.put("sources.beam_0.scan_path_file",
+               "scan_path_test_thermal_physics.txt");
+  database.put("sources.beam_0.type", "electron_beam");
+  database.put("sources.beam_0.scan_path_file_format", "segment");
+
+  thermal_2d<dealii::MemorySpace::Host>(database, 0.05);
+}
+
 BOOST_AUTO_TEST_CASE(thermal_2d_implicit_host)
 {
   boost::property_tree::ptree database;
@@ -42,6 +92,49 @@ BOOST_AUTO_TEST_CASE(thermal_2d_implicit_host)
   thermal_2d<dealii::MemorySpace::Host>(database, 0.025);
 }
 
+BOOST_AUTO_TEST_CASE(thermal_2d_imex_host)
+{
+  boost::property_tree::ptree database;
+  // Time-stepping database
+  database.put("time_stepping.method", "imex_ars222");
+  database.put("time_stepping.max_iteration", 100);
+  database.put("time_stepping.tolerance", 1e-6);
+  database.put("time_stepping.n_tmp_vectors", 100);
+  database.put("sources.beam_0.scan_path_file",
+               "scan_path_test_thermal_physics.txt");
+  database.put("sources.beam_0.type", "electron_beam");
+  database.put("sources.beam_0.scan_path_file_format", "segment");
+
+  thermal_2d<dealii::MemorySpace::Host>(database, 0.025);
+}
+
+BOOST_AUTO_TEST_CASE(imex_convergence_host)
+{
+  imex_convergence("imex_euler", 1.);
+  imex_convergence("imex_ars222", 2.);
+  imex_convergence("imex_ars443", 3.);
+}
+
+BOOST_AUTO_TEST_CASE(jacobi_preconditioner_reuse_host)
+{
+  jacobi_preconditioner_reuse();
+}
+
+BOOST_AUTO_TEST_CASE(preconditioner_refinement_host)
+{
+  preconditioner_refinement();
+}
+
+BOOST_AUTO_TEST_CASE(thermal_2d_implicit_adaptive_time_step_host)
+{
+  // The Newton solver needs fewer iterations than the target so the time step
+  // grows.
+  thermal_2d_adaptive_time_step<dealii::MemorySpace::Host>(100, 1.2);
+  // The Newton solver needs more iterations than the target so the time step
+  // shrinks.
+  thermal_2d_adaptive_time_step<dealii::MemorySpace::Host>(0, 0.8);
+}
+
 BOOST_AUTO_TEST_CASE(thermal_2d_manufactured_solution_host)
 {
   thermal_2d_manufactured_solution<dealii::MemorySpace::Host>();
@@ -67,6 +160,21 @@ BOOST_AUTO_TEST_CASE(convection_bcs_host)
   convection_bcs<dealii::MemorySpace::Host>();
 }
 
+BOOST_AUTO_TEST_CASE(convection_bcs_partial_domain_host)
+{
+  convection_bcs_partial_domain<dealii::MemorySpace::Host>();
+}
+
+BOOST_AUTO_TEST_CASE(sleeping_cells_host)
+{
+  sleeping_cells();
+}
+
+BOOST_AUTO_TEST_CASE(multirate_host)
+{
+  multirate();
+}
+
 BOOST_AUTO_TEST_CASE(reference_temperature_host)
 {
   reference_temperature<dealii::MemorySpace::Host>();
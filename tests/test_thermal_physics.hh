@@ -10,7 +10,13 @@
 #include <ThermalPhysics.hh>
 #include <Timer.hh>
 
+#include <deal.II/base/function.h>
 #include <deal.II/base/quadrature_lib.h>
+#include <deal.II/numerics/vector_tools.h>
+
+#include <map>
+#include <string>
+#include <vector>
 
 namespace tt = boost::test_tools;
 
@@ -149,6 +155,88 @@ void thermal_2d(boost::property_tree::ptree &database, double time_step)
   BOOST_TEST(solution.l1_norm() == 1000. * solution.size());
 }
 
+template <typename MemorySpaceType>
+void thermal_2d_adaptive_time_step(unsigned int newton_target_iteration,
+                                   double expected_ratio)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  boost::property_tree::ptree database;
+  // Time-stepping database
+  database.put("time_stepping.method", "backward_euler");
+  database.put("time_stepping.max_iteration", 100);
+  database.put("time_stepping.tolerance", 1e-6);
+  database.put("time_stepping.n_tmp_vectors", 100);
+  database.put("time_stepping.adaptive_time_step", true);
+  database.put("time_stepping.newton_target_iteration",
+               newton_target_iteration);
+
+  // Geometry database
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 12e-3);
+  geometry_database.put("length_divisions", 4);
+  geometry_database.put("height", 6e-3);
+  geometry_database.put("height_divisions", 5);
+  // Build Geometry
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  // MaterialProperty database
+  boost::property_tree::ptree material_property_database;
+  material_property_database.put("property_format", "polynomial");
+  material_property_database.put("n_materials", 1);
+  material_property_database.put("material_0.solid.density", 1.);
+  material_property_database.put("material_0.powder.density", 1.);
+  material_property_database.put("material_0.liquid.density", 1.);
+  material_property_database.put("material_0.solid.specific_heat", 1.);
+  material_property_database.put("material_0.powder.specific_heat", 1.);
+  material_property_database.put("material_0.liquid.specific_heat", 1.);
+  material_property_database.put("material_0.solid.thermal_conductivity_x", 1.);
+  material_property_database.put("material_0.solid.thermal_conductivity_z", 1.);
+  material_property_database.put("material_0.powder.thermal_conductivity_x",
+                                 1.);
+  material_property_database.put("material_0.powder.thermal_conductivity_z",
+                                 1.);
+  material_property_database.put("material_0.liquid.thermal_conductivity_x",
+                                 1.);
+  material_property_database.put("material_0.liquid.thermal_conductivity_z",
+                                 1.);
+  // Build MaterialProperty
+  adamantine::MaterialProperty<2, MemorySpaceType> material_properties(
+      communicator, geometry.get_triangulation(), material_property_database);
+  // Source database
+  database.put("sources.n_beams", 1);
+  database.put("sources.beam_0.depth", 1e100);
+  database.put("sources.beam_0.diameter", 1e100);
+  database.put("sources.beam_0.max_power", 1e300);
+  database.put("sources.beam_0.absorption_efficiency", 0.1);
+  database.put("sources.beam_0.type", "electron_beam");
+  database.put("sources.beam_0.scan_path_file",
+               "scan_path_test_thermal_physics.txt");
+  database.put("sources.beam_0.scan_path_file_format", "segment");
+  // Boundary database
+  database.put("boundary.type", "adiabatic");
+
+  // Build ThermalPhysics
+  adamantine::ThermalPhysics<2, 2, MemorySpaceType, dealii::QGauss<1>> physics(
+      communicator, database, geometry, material_properties);
+  physics.setup_dofs();
+  physics.update_material_deposition_orientation();
+  physics.compute_inverse_mass_matrix();
+
+  dealii::LA::distributed::Vector<double, MemorySpaceType> solution;
+  physics.initialize_dof_vector(solution);
+  physics.get_state_from_material_properties();
+  std::vector<adamantine::Timer> timers(adamantine::Timing::n_timers);
+  double const time_step = 0.025;
+  double const time =
+      physics.evolve_one_time_step(0., time_step, solution, timers);
+
+  // The time step is not modified but the next one is adapted
+  BOOST_TEST(time == time_step, tt::tolerance(1e-12));
+  BOOST_TEST(physics.get_delta_t_guess() == expected_ratio * time_step,
+             tt::tolerance(1e-12));
+}
+
 template <typename MemorySpaceType>
 void thermal_2d_manufactured_solution()
 {
@@ -240,6 +328,266 @@ void thermal_2d_manufactured_solution()
   }
 }
 
+// Evolve a nonlinear diffusion problem with an IMEX method using n_time_steps
+// time steps and return the solution at the final time. The conductivity
+// depends on the temperature, so the explicit part of the operator is not zero.
+dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+imex_nonlinear_diffusion(std::string const &method, unsigned int n_time_steps)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  // Geometry database
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 1);
+  geometry_database.put("length_divisions", 4);
+  geometry_database.put("height", 1);
+  geometry_database.put("height_divisions", 4);
+  // Build Geometry
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  // MaterialProperty database
+  boost::property_tree::ptree material_property_database;
+  material_property_database.put("property_format", "polynomial");
+  material_property_database.put("n_materials", 1);
+  for (std::string const state : {"solid", "powder", "liquid"})
+  {
+    material_property_database.put("material_0." + state + ".density", 1.);
+    material_property_database.put("material_0." + state + ".specific_heat",
+                                   1.);
+    material_property_database.put(
+        "material_0." + state + ".thermal_conductivity_x", "1., 0.5");
+    material_property_database.put(
+        "material_0." + state + ".thermal_conductivity_z", "1., 0.5");
+  }
+  // Build MaterialProperty
+  adamantine::MaterialProperty<2, dealii::MemorySpace::Host>
+      material_properties(communicator, geometry.get_triangulation(),
+                          material_property_database);
+  boost::property_tree::ptree database;
+  // Source database
+  database.put("sources.n_beams", 0);
+  // Boundary database
+  database.put("boundary.type", "adiabatic");
+  // Time-stepping database
+  database.put("time_stepping.method", method);
+  database.put("time_stepping.max_iteration", 1000);
+  database.put("time_stepping.tolerance", 1e-13);
+  database.put("time_stepping.n_tmp_vectors", 100);
+  // Build ThermalPhysics
+  adamantine::ThermalPhysics<2, 2, dealii::MemorySpace::Host, dealii::QGauss<1>>
+      physics(communicator, database, geometry, material_properties);
+  physics.setup_dofs();
+  physics.update_material_deposition_orientation();
+  physics.compute_inverse_mass_matrix();
+
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> solution;
+  physics.initialize_dof_vector(solution);
+  dealii::VectorTools::interpolate(
+      physics.get_dof_handler(),
+      dealii::ScalarFunctionFromFunctionObject<2>(
+          [](dealii::Point<2> const &p)
+          {
+            return 0.1 + 0.1 * std::cos(dealii::numbers::PI * p[0]) *
+                             std::cos(dealii::numbers::PI * p[1]);
+          }),
+      solution);
+  physics.get_state_from_material_properties();
+  std::vector<adamantine::Timer> timers(adamantine::Timing::n_timers);
+  double const final_time = 0.05;
+  double const time_step = final_time / n_time_steps;
+  double time = 0.;
+  for (unsigned int i = 0; i < n_time_steps; ++i)
+    time = physics.evolve_one_time_step(time, time_step, solution, timers);
+  BOOST_TEST(time == final_time, tt::tolerance(1e-12));
+
+  return solution;
+}
+
+// Check the order of convergence of an IMEX method against a solution computed
+// with a much smaller time step.
+void imex_convergence(std::string const &method, double const order)
+{
+  auto const reference = imex_nonlinear_diffusion(method, 256);
+  auto error_coarse = imex_nonlinear_diffusion(method, 4);
+  auto error_fine = imex_nonlinear_diffusion(method, 8);
+  error_coarse -= reference;
+  error_fine -= reference;
+  double const computed_order =
+      std::log2(error_coarse.l2_norm() / error_fine.l2_norm());
+  BOOST_TEST(error_fine.l2_norm() > 0.);
+  BOOST_TEST(computed_order > order - 0.3);
+}
+
+// Evolve a nonlinear diffusion problem with backward Euler and the given
+// preconditioner on a mesh with n_divisions cells in each direction. The dofs
+// are redistributed in the middle of the simulation. Return the solution at the
+// final time and the number of iterations of the linear and of the Newton
+// solvers.
+dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+preconditioned_nonlinear_diffusion(std::string const &preconditioner,
+                                   unsigned int const n_divisions,
+                                   bool const reuse_preconditioner,
+                                   bool const adaptive_linear_tolerance,
+                                   unsigned int &n_linear_iterations,
+                                   unsigned int &n_newton_iterations)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  // Geometry database
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 1);
+  geometry_database.put("length_divisions", n_divisions);
+  geometry_database.put("height", 1);
+  geometry_database.put("height_divisions", n_divisions);
+  // Build Geometry
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  // MaterialProperty database
+  boost::property_tree::ptree material_property_database;
+  material_property_database.put("property_format", "polynomial");
+  material_property_database.put("n_materials", 1);
+  for (std::string const state : {"solid", "powder", "liquid"})
+  {
+    material_property_database.put("material_0." + state + ".density", 1.);
+    material_property_database.put("material_0." + state + ".specific_heat",
+                                   1.);
+    material_property_database.put(
+        "material_0." + state + ".thermal_conductivity_x", "1., 0.5");
+    material_property_database.put(
+        "material_0." + state + ".thermal_conductivity_z", "1., 0.5");
+  }
+  // Build MaterialProperty
+  adamantine::MaterialProperty<2, dealii::MemorySpace::Host>
+      material_properties(communicator, geometry.get_triangulation(),
+                          material_property_database);
+  boost::property_tree::ptree database;
+  // Source database
+  database.put("sources.n_beams", 0);
+  // Boundary database
+  database.put("boundary.type", "adiabatic");
+  // Time-stepping database
+  database.put("time_stepping.method", "backward_euler");
+  database.put("time_stepping.max_iteration", 1000);
+  database.put("time_stepping.tolerance", 1e-12);
+  database.put("time_stepping.n_tmp_vectors", 100);
+  database.put("time_stepping.newton_tolerance", 1e-10);
+  database.put("time_stepping.preconditioner", preconditioner);
+  database.put("time_stepping.reuse_preconditioner", reuse_preconditioner);
+  database.put("time_stepping.adaptive_linear_tolerance",
+               adaptive_linear_tolerance);
+  // Build ThermalPhysics
+  adamantine::ThermalPhysics<2, 2, dealii::MemorySpace::Host, dealii::QGauss<1>>
+      physics(communicator, database, geometry, material_properties);
+  physics.setup_dofs();
+  physics.update_material_deposition_orientation();
+  physics.compute_inverse_mass_matrix();
+
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> solution;
+  physics.initialize_dof_vector(solution);
+  dealii::VectorTools::interpolate(
+      physics.get_dof_handler(),
+      dealii::ScalarFunctionFromFunctionObject<2>(
+          [](dealii::Point<2> const &p)
+          {
+            return 1. + std::cos(dealii::numbers::PI * p[0]) *
+                            std::cos(dealii::numbers::PI * p[1]);
+          }),
+      solution);
+  physics.get_state_from_material_properties();
+  std::vector<adamantine::Timer> timers(adamantine::Timing::n_timers);
+  double time = 0.;
+  n_linear_iterations = 0;
+  n_newton_iterations = 0;
+  for (unsigned int i = 0; i < 10; ++i)
+  {
+    if (i == 5)
+    {
+      // The dofs have the same partitioning, but the preconditioner is built
+      // again.
+      physics.setup_dofs();
+      physics.update_material_deposition_orientation();
+      physics.compute_inverse_mass_matrix();
+      dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+          new_solution;
+      physics.initialize_dof_vector(new_solution);
+      new_solution.copy_locally_owned_data_from(solution);
+      solution.swap(new_solution);
+    }
+    time = physics.evolve_one_time_step(time, 0.01, solution, timers);
+    n_linear_iterations += physics.get_n_linear_iterations();
+    n_newton_iterations += physics.get_n_newton_iterations();
+  }
+
+  return solution;
+}
+
+// Check that reusing the Jacobi preconditioner and adapting the tolerance of
+// the linear solver do not change the solution of the Newton solver.
+void jacobi_preconditioner_reuse()
+{
+  unsigned int reference_n_iterations = 0;
+  unsigned int n_newton_iterations = 0;
+  auto const reference = preconditioned_nonlinear_diffusion(
+      "jacobi", 8, false, false, reference_n_iterations, n_newton_iterations);
+  BOOST_TEST(reference_n_iterations > 0u);
+  for (bool const reuse_preconditioner : {false, true})
+  {
+    for (bool const adaptive_linear_tolerance : {false, true})
+    {
+      unsigned int n_iterations = 0;
+      auto solution = preconditioned_nonlinear_diffusion(
+          "jacobi", 8, reuse_preconditioner, adaptive_linear_tolerance,
+          n_iterations, n_newton_iterations);
+      BOOST_TEST(n_iterations > 0u);
+      solution -= reference;
+      BOOST_TEST(solution.linfty_norm() < 1e-8 * reference.linfty_norm());
+    }
+  }
+}
+
+// Check that the number of iterations of the linear solver per Newton
+// iteration does not grow with the refinement of the mesh when using the
+// algebraic multigrid while it grows without preconditioner. The Chebyshev and
+// the algebraic multigrid preconditioners do not change the solution of the
+// Newton solver.
+void preconditioner_refinement()
+{
+  std::map<std::string, std::vector<double>> n_iterations_per_solve;
+  for (unsigned int const n_divisions : {8u, 16u, 32u})
+  {
+    dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+        reference;
+    for (std::string const preconditioner : {"identity", "chebyshev", "amg"})
+    {
+      unsigned int n_linear_iterations = 0;
+      unsigned int n_newton_iterations = 0;
+      auto solution = preconditioned_nonlinear_diffusion(
+          preconditioner, n_divisions, false, false, n_linear_iterations,
+          n_newton_iterations);
+      BOOST_TEST(n_newton_iterations > 0u);
+      n_iterations_per_solve[preconditioner].push_back(
+          static_cast<double>(n_linear_iterations) / n_newton_iterations);
+      if (preconditioner == "identity")
+      {
+        reference = solution;
+      }
+      else
+      {
+        solution -= reference;
+        BOOST_TEST(solution.linfty_norm() < 1e-8 * reference.linfty_norm());
+      }
+    }
+  }
+
+  auto const &identity = n_iterations_per_solve["identity"];
+  auto const &chebyshev = n_iterations_per_solve["chebyshev"];
+  auto const &amg = n_iterations_per_solve["amg"];
+  BOOST_TEST(identity.back() > 2. * identity.front());
+  BOOST_TEST(amg.back() <= 1.5 * amg.front() + 2.);
+  BOOST_TEST(chebyshev.back() < identity.back());
+  BOOST_TEST(amg.back() < identity.back());
+}
+
 template <typename MemorySpaceType>
 void initial_temperature()
 {
@@ -592,6 +940,290 @@ void convection_bcs()
   BOOST_TEST(max <= 20.);
 }
 
+template <typename MemorySpaceType>
+void convection_bcs_partial_domain()
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  // Geometry database
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 5);
+  geometry_database.put("length_divisions", 5);
+  geometry_database.put("height", 5);
+  geometry_database.put("height_divisions", 5);
+  // Build Geometry
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  boost::property_tree::ptree material_property_database;
+  // MaterialProperty database
+  material_property_database.put("property_format", "polynomial");
+  material_property_database.put("n_materials", 1);
+  material_property_database.put("material_0.solid.density", 1.);
+  material_property_database.put("material_0.powder.density", 1.);
+  material_property_database.put("material_0.liquid.density", 1.);
+  material_property_database.put("material_0.solid.specific_heat", 1.);
+  material_property_database.put("material_0.powder.specific_heat", 1.);
+  material_property_database.put("material_0.liquid.specific_heat", 1.);
+  material_property_database.put("material_0.solid.thermal_conductivity_x", 1.);
+  material_property_database.put("material_0.solid.thermal_conductivity_z", 1.);
+  material_property_database.put("material_0.powder.thermal_conductivity_x",
+                                 1.);
+  material_property_database.put("material_0.powder.thermal_conductivity_z",
+                                 1.);
+  material_property_database.put("material_0.liquid.thermal_conductivity_x",
+                                 1.);
+  material_property_database.put("material_0.liquid.thermal_conductivity_z",
+                                 1.);
+  material_property_database.put(
+      "material_0.solid.convection_heat_transfer_coef", 1.);
+  material_property_database.put(
+      "material_0.powder.convection_heat_transfer_coef", 1.);
+  material_property_database.put(
+      "material_0.liquid.convection_heat_transfer_coef", 1.);
+  material_property_database.put("material_0.convection_temperature_infty",
+                                 20.0);
+  // Build MaterialProperty
+  adamantine::MaterialProperty<2, MemorySpaceType> material_properties(
+      communicator, geometry.get_triangulation(), material_property_database);
+  boost::property_tree::ptree database;
+  // Only the bottom row of cells has material. With two processors, the second
+  // processor owns the top rows and thus no face at the boundary of the
+  // activated domain.
+  database.put("geometry.material_height", 1.);
+  // Source database
+  database.put("sources.n_beams", 0);
+  // Time-stepping database
+  database.put("time_stepping.method", "forward_euler");
+  // Boundary database
+  database.put("boundary.type", "convective");
+  // Build ThermalPhysics
+  adamantine::ThermalPhysics<2, 2, dealii::MemorySpace::Host, dealii::QGauss<1>>
+      physics(communicator, database, geometry, material_properties);
+  physics.setup_dofs();
+  physics.update_material_deposition_orientation();
+  physics.compute_inverse_mass_matrix();
+
+  unsigned int n_activated_cells = 0;
+  for (auto const &cell : physics.get_dof_handler().active_cell_iterators())
+    if (cell->is_locally_owned() && (cell->active_fe_index() == 0))
+      ++n_activated_cells;
+  unsigned int const rank =
+      dealii::Utilities::MPI::this_mpi_process(communicator);
+  if (dealii::Utilities::MPI::n_mpi_processes(communicator) == 2)
+    BOOST_TEST((rank == 0) == (n_activated_cells > 0));
+
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> solution;
+  double constexpr initial_temperature = 10;
+  physics.initialize_dof_vector(initial_temperature, solution);
+  physics.get_state_from_material_properties();
+  std::vector<adamantine::Timer> timers(adamantine::Timing::n_timers);
+  double time = 0;
+  while (time < 10)
+  {
+    time = physics.evolve_one_time_step(time, 0.005, solution, timers);
+  }
+
+  // The activated domain warms up towards the temperature of the fluid.
+  double const max = solution.linfty_norm();
+  BOOST_TEST(max > 10.);
+  BOOST_TEST(max <= 20.);
+  for (unsigned int i = 0; i < solution.locally_owned_size(); ++i)
+    BOOST_TEST(solution.local_element(i) <= 20.);
+}
+
+// Heat up a corner of the domain and let the conduction front reach the rest
+// of the domain, which can fall asleep before the front arrives.
+dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+conduction_front(unsigned int sleep_time_steps)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  // Geometry database
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 10);
+  geometry_database.put("length_divisions", 10);
+  geometry_database.put("height", 10);
+  geometry_database.put("height_divisions", 10);
+  // Build Geometry
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  boost::property_tree::ptree material_property_database;
+  // MaterialProperty database
+  material_property_database.put("property_format", "polynomial");
+  material_property_database.put("n_materials", 1);
+  material_property_database.put("material_0.solid.density", 0.5);
+  material_property_database.put("material_0.powder.density", 0.5);
+  material_property_database.put("material_0.liquid.density", 0.5);
+  material_property_database.put("material_0.solid.specific_heat", 4.);
+  material_property_database.put("material_0.powder.specific_heat", 4.);
+  material_property_database.put("material_0.liquid.specific_heat", 4.);
+  material_property_database.put("material_0.solid.thermal_conductivity_x", 2.);
+  material_property_database.put("material_0.solid.thermal_conductivity_z", 2.);
+  material_property_database.put("material_0.powder.thermal_conductivity_x",
+                                 2.);
+  material_property_database.put("material_0.powder.thermal_conductivity_z",
+                                 2.);
+  material_property_database.put("material_0.liquid.thermal_conductivity_x",
+                                 2.);
+  material_property_database.put("material_0.liquid.thermal_conductivity_z",
+                                 2.);
+  // Build MaterialProperty
+  adamantine::MaterialProperty<2, dealii::MemorySpace::Host>
+      material_properties(communicator, geometry.get_triangulation(),
+                          material_property_database);
+  boost::property_tree::ptree database;
+  // Source database
+  database.put("sources.n_beams", 1);
+  database.put("sources.beam_0.type", "cube");
+  database.put("sources.beam_0.start_time", 0);
+  database.put("sources.beam_0.end_time", 5);
+  database.put("sources.beam_0.value", 5);
+  database.put("sources.beam_0.min_x", 0);
+  database.put("sources.beam_0.min_y", 0);
+  database.put("sources.beam_0.max_x", 2);
+  database.put("sources.beam_0.max_y", 2);
+  // Time-stepping database
+  database.put("time_stepping.method", "forward_euler");
+  // Boundary database
+  database.put("boundary.type", "adiabatic");
+  // Sleeping cells
+  database.put("discretization.thermal.sleep_time_steps", sleep_time_steps);
+  database.put("discretization.thermal.sleep_tolerance", 1e-4);
+  // Build ThermalPhysics
+  adamantine::ThermalPhysics<2, 2, dealii::MemorySpace::Host, dealii::QGauss<1>>
+      physics(communicator, database, geometry, material_properties);
+  physics.setup_dofs();
+  physics.update_material_deposition_orientation();
+  physics.compute_inverse_mass_matrix();
+
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> solution;
+  physics.initialize_dof_vector(10., solution);
+  physics.get_state_from_material_properties();
+  std::vector<adamantine::Timer> timers(adamantine::Timing::n_timers);
+  double time = 0;
+  while (time < 30)
+  {
+    time = physics.evolve_one_time_step(time, 0.05, solution, timers);
+  }
+
+  return solution;
+}
+
+void sleeping_cells()
+{
+  auto const reference = conduction_front(0);
+  auto solution = conduction_front(2);
+
+  // The energy is conserved and the cells that were asleep when the front
+  // arrived have woken up.
+  double constexpr tolerance = 1e-9;
+  BOOST_TEST(solution.mean_value() == reference.mean_value(),
+             tt::tolerance(tolerance));
+  BOOST_TEST(reference.linfty_norm() > 10.);
+  solution -= reference;
+  BOOST_TEST(solution.linfty_norm() < 1e-2);
+}
+
+// Heat up a corner of the domain where the mesh is refined once. When
+// multirate_sub_steps is larger than one, the refined cells are advanced with
+// sub-steps of the time step.
+dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host>
+refined_corner_heating(unsigned int multirate_sub_steps, double time_step)
+{
+  MPI_Comm communicator = MPI_COMM_WORLD;
+
+  // Geometry database
+  boost::property_tree::ptree geometry_database;
+  geometry_database.put("import_mesh", false);
+  geometry_database.put("length", 10);
+  geometry_database.put("length_divisions", 8);
+  geometry_database.put("height", 10);
+  geometry_database.put("height_divisions", 8);
+  // Build Geometry and refine the corner
+  adamantine::Geometry<2> geometry(communicator, geometry_database);
+  auto &triangulation = geometry.get_triangulation();
+  for (auto const &cell : triangulation.active_cell_iterators())
+    if (cell->is_locally_owned() && (cell->center()[0] < 2.5) &&
+        (cell->center()[1] < 2.5))
+      cell->set_refine_flag();
+  triangulation.execute_coarsening_and_refinement();
+  boost::property_tree::ptree material_property_database;
+  // MaterialProperty database
+  material_property_database.put("property_format", "polynomial");
+  material_property_database.put("n_materials", 1);
+  material_property_database.put("material_0.solid.density", 0.5);
+  material_property_database.put("material_0.powder.density", 0.5);
+  material_property_database.put("material_0.liquid.density", 0.5);
+  material_property_database.put("material_0.solid.specific_heat", 4.);
+  material_property_database.put("material_0.powder.specific_heat", 4.);
+  material_property_database.put("material_0.liquid.specific_heat", 4.);
+  material_property_database.put("material_0.solid.thermal_conductivity_x", 2.);
+  material_property_database.put("material_0.solid.thermal_conductivity_z", 2.);
+  material_property_database.put("material_0.powder.thermal_conductivity_x",
+                                 2.);
+  material_property_database.put("material_0.powder.thermal_conductivity_z",
+                                 2.);
+  material_property_database.put("material_0.liquid.thermal_conductivity_x",
+                                 2.);
+  material_property_database.put("material_0.liquid.thermal_conductivity_z",
+                                 2.);
+  // Build MaterialProperty
+  adamantine::MaterialProperty<2, dealii::MemorySpace::Host>
+      material_properties(communicator, triangulation,
+                          material_property_database);
+  boost::property_tree::ptree database;
+  // Source database
+  database.put("sources.n_beams", 1);
+  database.put("sources.beam_0.type", "cube");
+  database.put("sources.beam_0.start_time", 0);
+  database.put("sources.beam_0.end_time", 5);
+  database.put("sources.beam_0.value", 5);
+  database.put("sources.beam_0.min_x", 0);
+  database.put("sources.beam_0.min_y", 0);
+  database.put("sources.beam_0.max_x", 2);
+  database.put("sources.beam_0.max_y", 2);
+  // Time-stepping database
+  database.put("time_stepping.method", "forward_euler");
+  database.put("time_stepping.multirate_sub_steps", multirate_sub_steps);
+  // Boundary database
+  database.put("boundary.type", "adiabatic");
+  // Build ThermalPhysics
+  adamantine::ThermalPhysics<2, 2, dealii::MemorySpace::Host, dealii::QGauss<1>>
+      physics(communicator, database, geometry, material_properties);
+  physics.setup_dofs();
+  physics.update_material_deposition_orientation();
+  physics.compute_inverse_mass_matrix();
+
+  dealii::LA::distributed::Vector<double, dealii::MemorySpace::Host> solution;
+  physics.initialize_dof_vector(10., solution);
+  physics.get_state_from_material_properties();
+  std::vector<adamantine::Timer> timers(adamantine::Timing::n_timers);
+  double time = 0;
+  while (time < 10. - 1e-9)
+  {
+    time = physics.evolve_one_time_step(time, time_step, solution, timers);
+  }
+
+  return solution;
+}
+
+void multirate()
+{
+  // The reference uses the sub-step on the whole domain.
+  auto const reference = refined_corner_heating(1, 0.01);
+  auto const single_rate = refined_corner_heating(1, 0.04);
+  auto solution = refined_corner_heating(4, 0.04);
+
+  // The sub-steps change the solution in the refined corner, which stays
+  // close to the reference.
+  BOOST_TEST(reference.linfty_norm() > 10.);
+  auto difference = single_rate;
+  difference -= solution;
+  BOOST_TEST(difference.linfty_norm() > 0.);
+  solution -= reference;
+  BOOST_TEST(solution.linfty_norm() < 1e-2 * reference.linfty_norm());
+}
+
 template <typename MemorySpaceType>
 void reference_temperature()
 {
@@ -661,4 +1293,19 @@ void reference_temperature()
 
   for (auto indicator : has_melted)
     BOOST_CHECK(indicator == true);
+
+  // Reset some of the indicators, expect the cells below the reference
+  // temperature to keep their indicators
+  std::vector<bool> reference_has_melted(has_melted.size());
+  for (unsigned int i = 0; i < reference_has_melted.size(); ++i)
+    reference_has_melted[i] = (i % 3 == 0);
+  physics.set_has_melted_vector(reference_has_melted);
+  physics.mark_has_melted(reference_temperatures[0], solution);
+  has_melted = physics.get_has_melted_vector();
+
+  for (unsigned int i = 0; i < has_melted.size(); ++i)
+  {
+    BOOST_CHECK(has_melted[i] == reference_has_melted[i]);
+    BOOST_CHECK(physics.get_has_melted(i) == reference_has_melted[i]);
+  }
 }
@@ -1,4 +1,4 @@
-/* Copyright (c) 2016 - 2021, the adamantine authors.
+/* Copyright (c) 2016 - 2023, the adamantine authors.
  *
  * This file is subject to the Modified BSD License and may not be distributed
  * without copyright and license information. Please refer to the file LICENSE
@@ -26,6 +26,20 @@ BOOST_AUTO_TEST_CASE(thermal_2d_explicit_device)
   thermal_2d<dealii::MemorySpace::CUDA>(database, 0.05);
 }
 
+BOOST_AUTO_TEST_CASE(thermal_2d_explicit_persistent_stages_device)
+{
+  boost::property_tree::ptree database;
+  // Time-stepping database
+  database.put("time_stepping.method", "forward_euler");
+  database.put("time_stepping.persistent_stages", true);
+  database.put("sources.beam_0.scan_path_file",
+               "scan_path_test_thermal_physics.txt");
+  database.put("sources.beam_0.type", "electron_beam");
+  database.put("sources.beam_0.scan_path_file_format", "segment");
+
+  thermal_2d<dealii::MemorySpace::CUDA>(database, 0.05);
+}
+
 BOOST_AUTO_TEST_CASE(thermal_2d_implicit_device)
 {
   boost::property_tree::ptree database;
@@ -10,8 +10,12 @@
 #include <Timer.hh>
 
 #include <chrono>
+#include <cstdio>
 #include <fstream>
+#include <iterator>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include "main.cc"
 
@@ -44,3 +48,32 @@ BOOST_AUTO_TEST_CASE(test_timer)
   ms = boost::chrono::duration_cast<boost::chrono::milliseconds>(duration);
   BOOST_TEST(std::abs(ms.count() - 200) < tolerance);
 }
+
+BOOST_AUTO_TEST_CASE(test_print_timers)
+{
+  std::vector<adamantine::Timer> timers;
+  timers.push_back(adamantine::Timer(MPI_COMM_WORLD, "parent"));
+  timers.push_back(adamantine::Timer(MPI_COMM_WORLD, "child", 0));
+  timers[0].start();
+  timers[1].start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  timers[1].stop();
+  timers[0].stop();
+  BOOST_TEST(timers[1].get_section() == "child");
+  BOOST_TEST(timers[1].get_parent() == 0);
+
+  adamantine::print_timers(MPI_COMM_WORLD, timers, "test_timers.json");
+
+  // The child is written inside its parent
+  std::ifstream file("test_timers.json");
+  std::string const content((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+  auto const parent_pos = content.find("\"section\": \"parent\"");
+  auto const children_pos = content.find("\"children\": [", parent_pos);
+  auto const child_pos = content.find("\"section\": \"child\"");
+  BOOST_TEST(parent_pos != std::string::npos);
+  BOOST_TEST(child_pos != std::string::npos);
+  BOOST_TEST(children_pos < child_pos);
+  BOOST_TEST(content.find("\"imbalance\": 1") != std::string::npos);
+  std::remove("test_timers.json");
+}
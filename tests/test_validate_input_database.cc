@@ -360,6 +360,23 @@ BOOST_AUTO_TEST_CASE(expected_failures)
   BOOST_CHECK_THROW(validate_input_database(database), std::runtime_error);
   database.put("post_processor.filename_prefix", "output");
 
+  // Check 18: Invalid output format
+  database.put("post_processor.output_format", "vtk");
+  BOOST_CHECK_THROW(validate_input_database(database), std::runtime_error);
+  database.get_child("post_processor").erase("output_format");
+
+  // Check 18: Invalid compression level
+  database.put("post_processor.compression_level", "fastest");
+  BOOST_CHECK_THROW(validate_input_database(database), std::runtime_error);
+  database.get_child("post_processor").erase("compression_level");
+
+  // Check 18: Invalid checkpoint
+  database.put("checkpoint.filename_prefix", "checkpoint");
+  BOOST_CHECK_THROW(validate_input_database(database), std::runtime_error);
+  database.put("checkpoint.time_steps_between_checkpoint", 0);
+  BOOST_CHECK_THROW(validate_input_database(database), std::runtime_error);
+  database.erase("checkpoint");
+
   // Check 19: Missing refinement block
   database.get_child("refinement").erase("n_heat_refinements");
   database.erase("refinement");
@@ -476,6 +493,68 @@ BOOST_AUTO_TEST_CASE(expected_failures)
   database.put("geometry.dim", 3);
   database.get_child("experiment").erase("read_in_experimental_data");
 
+  // Check 31: Negative refinement margin and invalid load imbalance threshold
+  database.put("refinement.refine_margin", -1.);
+  BOOST_CHECK_THROW(validate_input_database(database), std::runtime_error);
+  database.get_child("refinement").erase("refine_margin");
+  database.put("refinement.load_imbalance_threshold", 0.5);
+  BOOST_CHECK_THROW(validate_input_database(database), std::runtime_error);
+  database.get_child("refinement").erase("load_imbalance_threshold");
+
+  // Check 32: Non-positive number of time steps between memory reports
+  database.put("profiling.time_steps_between_memory_report", 0);
+  BOOST_CHECK_THROW(validate_input_database(database), std::runtime_error);
+  database.get_child("profiling").erase("time_steps_between_memory_report");
+
+  // Check 33: Preprocessing cache without a directory
+  database.put("preprocessing_cache.directory", "cache");
+  database.get_child("preprocessing_cache").erase("directory");
+  BOOST_CHECK_THROW(validate_input_database(database), std::runtime_error);
+  database.erase("preprocessing_cache");
+
+  // Check 34: Unknown DoF renumbering
+  database.put("discretization.thermal.dof_renumbering", "random");
+  BOOST_CHECK_THROW(validate_input_database(database), std::runtime_error);
+  database.get_child("discretization.thermal").erase("dof_renumbering");
+
+  // Check 35: Non-positive sleep tolerance
+  database.put("discretization.thermal.sleep_tolerance", 0.);
+  BOOST_CHECK_THROW(validate_input_database(database), std::runtime_error);
+  database.get_child("discretization.thermal").erase("sleep_tolerance");
+
+  // Check 36: Batch without a cases file
+  database.put("batch.cases_file", "cases.info");
+  database.get_child("batch").erase("cases_file");
+  BOOST_CHECK_THROW(validate_input_database(database), std::runtime_error);
+  database.erase("batch");
+
+  // Check 37: Batch combined with an ensemble simulation
+  database.put("batch.cases_file", "cases.info");
+  database.put("ensemble.ensemble_simulation", true);
+  BOOST_CHECK_THROW(validate_input_database(database), std::runtime_error);
+  database.erase("batch");
+  database.erase("ensemble");
+
+  // Check 38: Layer weight without a deposition height
+  database.put("refinement.layer_weight", 10.);
+  BOOST_CHECK_THROW(validate_input_database(database), std::runtime_error);
+  database.get_child("refinement").erase("layer_weight");
+
+  // Check 39: Negative activation window
+  database.put("geometry.activation_window", -1.);
+  BOOST_CHECK_THROW(validate_input_database(database), std::runtime_error);
+  database.get_child("geometry").erase("activation_window");
+
+  // Check 40: Unknown error indicator
+  database.put("refinement.error_indicator", "residual");
+  BOOST_CHECK_THROW(validate_input_database(database), std::runtime_error);
+  database.get_child("refinement").erase("error_indicator");
+
+  // Check 41: Unknown data assimilation solver
+  database.put("data_assimilation.solver.method", "cg");
+  BOOST_CHECK_THROW(validate_input_database(database), std::runtime_error);
+  database.erase("data_assimilation");
+
   // Final Check: This should be back to the base database (this should be
   // valid)
   validate_input_database(database);